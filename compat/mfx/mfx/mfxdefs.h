@@ -0,0 +1,72 @@
+/*
+ * Basic types and status codes of the Intel Media SDK API, as implemented
+ * by the software MFX stand-in (see compat/mfx/mfxsw.c).
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef COMPAT_MFX_MFXDEFS_H
+#define COMPAT_MFX_MFXDEFS_H
+
+#include <stdint.h>
+
+typedef uint8_t   mfxU8;
+typedef int8_t    mfxI8;
+typedef uint16_t  mfxU16;
+typedef int16_t   mfxI16;
+typedef uint32_t  mfxU32;
+typedef int32_t   mfxI32;
+typedef uint64_t  mfxU64;
+typedef int64_t   mfxI64;
+typedef float     mfxF32;
+typedef double    mfxF64;
+typedef void     *mfxHDL;
+typedef mfxHDL    mfxMemId;
+typedef void     *mfxThreadTask;
+
+typedef enum {
+    MFX_ERR_NONE                     = 0,
+
+    MFX_ERR_UNKNOWN                  = -1,
+    MFX_ERR_NULL_PTR                 = -2,
+    MFX_ERR_UNSUPPORTED              = -3,
+    MFX_ERR_MEMORY_ALLOC             = -4,
+    MFX_ERR_NOT_ENOUGH_BUFFER        = -5,
+    MFX_ERR_INVALID_HANDLE           = -6,
+    MFX_ERR_LOCK_MEMORY              = -7,
+    MFX_ERR_NOT_INITIALIZED          = -8,
+    MFX_ERR_NOT_FOUND                = -9,
+    MFX_ERR_MORE_DATA                = -10,
+    MFX_ERR_MORE_SURFACE             = -11,
+    MFX_ERR_ABORTED                  = -12,
+    MFX_ERR_DEVICE_LOST              = -13,
+    MFX_ERR_INCOMPATIBLE_VIDEO_PARAM = -14,
+    MFX_ERR_INVALID_VIDEO_PARAM      = -15,
+    MFX_ERR_UNDEFINED_BEHAVIOR       = -16,
+    MFX_ERR_DEVICE_FAILED            = -17,
+    MFX_ERR_MORE_BITSTREAM           = -18,
+
+    MFX_WRN_IN_EXECUTION             = 1,
+    MFX_WRN_DEVICE_BUSY              = 2,
+    MFX_WRN_VIDEO_PARAM_CHANGED      = 3,
+    MFX_WRN_PARTIAL_ACCELERATION     = 4,
+    MFX_WRN_INCOMPATIBLE_VIDEO_PARAM = 5,
+    MFX_WRN_VALUE_NOT_CHANGED        = 6,
+    MFX_WRN_OUT_OF_RANGE             = 7,
+} mfxStatus;
+
+#endif /* COMPAT_MFX_MFXDEFS_H */
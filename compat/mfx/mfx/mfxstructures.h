@@ -0,0 +1,341 @@
+/*
+ * Parameter structures and constants of the Intel Media SDK API, as
+ * implemented by the software MFX stand-in (see compat/mfx/mfxsw.c).
+ *
+ * Only the subset used by the libavcodec QSV wrappers is provided; field
+ * names and constant values follow the Media SDK 1.x headers.
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef COMPAT_MFX_MFXSTRUCTURES_H
+#define COMPAT_MFX_MFXSTRUCTURES_H
+
+#include "mfxdefs.h"
+
+#define MFX_MAKEFOURCC(A, B, C, D) \
+    ((((int)A)) + (((int)B) << 8) + (((int)C) << 16) + (((int)D) << 24))
+
+typedef union {
+    struct {
+        mfxU16 Minor;
+        mfxU16 Major;
+    };
+    mfxU32 Version;
+} mfxVersion;
+
+typedef mfxI32 mfxIMPL;
+
+enum {
+    MFX_IMPL_AUTO         = 0x0000,
+    MFX_IMPL_SOFTWARE     = 0x0001,
+    MFX_IMPL_HARDWARE     = 0x0002,
+    MFX_IMPL_AUTO_ANY     = 0x0003,
+    MFX_IMPL_HARDWARE_ANY = 0x0004,
+};
+
+typedef struct {
+    mfxU32 FourCC;
+    mfxU16 Width;
+    mfxU16 Height;
+    mfxU16 CropX;
+    mfxU16 CropY;
+    mfxU16 CropW;
+    mfxU16 CropH;
+    mfxU32 FrameRateExtN;
+    mfxU32 FrameRateExtD;
+    mfxU16 AspectRatioW;
+    mfxU16 AspectRatioH;
+    mfxU16 PicStruct;
+    mfxU16 ChromaFormat;
+} mfxFrameInfo;
+
+enum {
+    MFX_FOURCC_NV12 = MFX_MAKEFOURCC('N', 'V', '1', '2'),
+};
+
+enum {
+    MFX_CHROMAFORMAT_MONOCHROME = 0,
+    MFX_CHROMAFORMAT_YUV420     = 1,
+    MFX_CHROMAFORMAT_YUV422     = 2,
+    MFX_CHROMAFORMAT_YUV444     = 3,
+};
+
+enum {
+    MFX_PICSTRUCT_UNKNOWN        = 0x00,
+    MFX_PICSTRUCT_PROGRESSIVE    = 0x01,
+    MFX_PICSTRUCT_FIELD_TFF      = 0x02,
+    MFX_PICSTRUCT_FIELD_BFF      = 0x04,
+    MFX_PICSTRUCT_FIELD_REPEATED = 0x10,
+    MFX_PICSTRUCT_FRAME_DOUBLING = 0x20,
+    MFX_PICSTRUCT_FRAME_TRIPLING = 0x40,
+};
+
+#define MFX_TIMESTAMP_UNKNOWN ((mfxU64)-1)
+
+typedef struct {
+    mfxU64 TimeStamp;
+    mfxU32 FrameOrder;
+    mfxU16 Locked;
+    mfxU16 Pitch;
+    mfxU8 *Y;
+    union {
+        mfxU8 *UV;
+        mfxU8 *U;
+        mfxU8 *Cb;
+    };
+    mfxU8 *V;
+    mfxU8 *A;
+    mfxMemId MemId;
+    mfxU16 Corrupted;
+    mfxU16 DataFlag;
+} mfxFrameData;
+
+typedef struct {
+    mfxFrameInfo Info;
+    mfxFrameData Data;
+} mfxFrameSurface1;
+
+enum {
+    MFX_CODEC_AVC   = MFX_MAKEFOURCC('A', 'V', 'C', ' '),
+    MFX_CODEC_MPEG2 = MFX_MAKEFOURCC('M', 'P', 'G', '2'),
+    MFX_CODEC_VC1   = MFX_MAKEFOURCC('V', 'C', '1', ' '),
+};
+
+enum {
+    MFX_PROFILE_UNKNOWN      = 0,
+
+    MFX_PROFILE_AVC_BASELINE = 66,
+    MFX_PROFILE_AVC_MAIN     = 77,
+    MFX_PROFILE_AVC_EXTENDED = 88,
+    MFX_PROFILE_AVC_HIGH     = 100,
+
+    MFX_PROFILE_MPEG2_SIMPLE = 0x50,
+    MFX_PROFILE_MPEG2_MAIN   = 0x40,
+    MFX_PROFILE_MPEG2_HIGH   = 0x10,
+};
+
+enum {
+    MFX_LEVEL_UNKNOWN        = 0,
+
+    MFX_LEVEL_AVC_1          = 10,
+    MFX_LEVEL_AVC_1b         = 9,
+    MFX_LEVEL_AVC_11         = 11,
+    MFX_LEVEL_AVC_12         = 12,
+    MFX_LEVEL_AVC_13         = 13,
+    MFX_LEVEL_AVC_2          = 20,
+    MFX_LEVEL_AVC_21         = 21,
+    MFX_LEVEL_AVC_22         = 22,
+    MFX_LEVEL_AVC_3          = 30,
+    MFX_LEVEL_AVC_31         = 31,
+    MFX_LEVEL_AVC_32         = 32,
+    MFX_LEVEL_AVC_4          = 40,
+    MFX_LEVEL_AVC_41         = 41,
+    MFX_LEVEL_AVC_42         = 42,
+    MFX_LEVEL_AVC_5          = 50,
+    MFX_LEVEL_AVC_51         = 51,
+    MFX_LEVEL_AVC_52         = 52,
+
+    MFX_LEVEL_MPEG2_LOW      = 0xA,
+    MFX_LEVEL_MPEG2_MAIN     = 0x8,
+    MFX_LEVEL_MPEG2_HIGH1440 = 0x6,
+    MFX_LEVEL_MPEG2_HIGH     = 0x4,
+};
+
+enum {
+    MFX_TARGETUSAGE_UNKNOWN      = 0,
+    MFX_TARGETUSAGE_BEST_QUALITY = 1,
+    MFX_TARGETUSAGE_BALANCED     = 4,
+    MFX_TARGETUSAGE_BEST_SPEED   = 7,
+};
+
+enum {
+    MFX_RATECONTROL_CBR  = 1,
+    MFX_RATECONTROL_VBR  = 2,
+    MFX_RATECONTROL_CQP  = 3,
+    MFX_RATECONTROL_AVBR = 4,
+    MFX_RATECONTROL_LA   = 8,
+};
+
+enum {
+    MFX_GOP_CLOSED = 1,
+    MFX_GOP_STRICT = 2,
+};
+
+typedef struct {
+    mfxU32 CodecId;
+    mfxU16 CodecProfile;
+    mfxU16 CodecLevel;
+    mfxU16 NumThread;
+    mfxU16 TargetUsage;
+    mfxU16 GopPicSize;
+    mfxU16 GopRefDist;
+    mfxU16 GopOptFlag;
+    mfxU16 IdrInterval;
+    mfxU16 RateControlMethod;
+    mfxU16 InitialDelayInKB;
+    mfxU16 BufferSizeInKB;
+    mfxU16 TargetKbps;
+    mfxU16 MaxKbps;
+    mfxU16 QPI;
+    mfxU16 QPP;
+    mfxU16 QPB;
+    mfxU16 Accuracy;
+    mfxU16 Convergence;
+    mfxU16 NumSlice;
+    mfxU16 NumRefFrame;
+    mfxU16 EncodedOrder;
+    mfxU16 DecodedOrder;
+    mfxFrameInfo FrameInfo;
+} mfxInfoMFX;
+
+typedef struct {
+    mfxU32 BufferId;
+    mfxU32 BufferSz;
+} mfxExtBuffer;
+
+enum {
+    MFX_IOPATTERN_IN_VIDEO_MEMORY   = 0x01,
+    MFX_IOPATTERN_IN_SYSTEM_MEMORY  = 0x02,
+    MFX_IOPATTERN_OUT_VIDEO_MEMORY  = 0x10,
+    MFX_IOPATTERN_OUT_SYSTEM_MEMORY = 0x20,
+};
+
+typedef struct {
+    mfxU16 AsyncDepth;
+    mfxInfoMFX mfx;
+    mfxU16 Protected;
+    mfxU16 IOPattern;
+    mfxExtBuffer **ExtParam;
+    mfxU16 NumExtParam;
+} mfxVideoParam;
+
+enum {
+    MFX_MEMTYPE_SYSTEM_MEMORY = 0x0040,
+    MFX_MEMTYPE_FROM_ENCODE   = 0x0100,
+    MFX_MEMTYPE_FROM_DECODE   = 0x0200,
+    MFX_MEMTYPE_EXTERNAL_FRAME = 0x1000,
+};
+
+typedef struct {
+    mfxFrameInfo Info;
+    mfxU16 Type;
+    mfxU16 NumFrameMin;
+    mfxU16 NumFrameSuggested;
+} mfxFrameAllocRequest;
+
+enum {
+    MFX_FRAMETYPE_UNKNOWN = 0x0000,
+    MFX_FRAMETYPE_I       = 0x0001,
+    MFX_FRAMETYPE_P       = 0x0002,
+    MFX_FRAMETYPE_B       = 0x0004,
+    MFX_FRAMETYPE_S       = 0x0008,
+    MFX_FRAMETYPE_REF     = 0x0040,
+    MFX_FRAMETYPE_IDR     = 0x0080,
+    MFX_FRAMETYPE_xI      = 0x0100,
+    MFX_FRAMETYPE_xP      = 0x0200,
+    MFX_FRAMETYPE_xB      = 0x0400,
+    MFX_FRAMETYPE_xS      = 0x0800,
+    MFX_FRAMETYPE_xREF    = 0x4000,
+    MFX_FRAMETYPE_xIDR    = 0x8000,
+};
+
+enum {
+    MFX_BITSTREAM_COMPLETE_FRAME = 0x0001,
+};
+
+typedef struct {
+    mfxU64 TimeStamp;
+    mfxU8 *Data;
+    mfxU32 DataOffset;
+    mfxU32 DataLength;
+    mfxU32 MaxLength;
+    mfxU16 PicStruct;
+    mfxU16 FrameType;
+    mfxU16 DataFlag;
+} mfxBitstream;
+
+typedef struct {
+    mfxExtBuffer Header;
+    mfxU16 SkipFrame;
+    mfxU16 QP;
+    mfxU16 FrameType;
+    mfxU16 NumExtParam;
+    mfxExtBuffer **ExtParam;
+} mfxEncodeCtrl;
+
+enum {
+    MFX_CODINGOPTION_UNKNOWN = 0x00,
+    MFX_CODINGOPTION_ON      = 0x10,
+    MFX_CODINGOPTION_OFF     = 0x20,
+};
+
+enum {
+    MFX_EXTBUFF_CODING_OPTION        = MFX_MAKEFOURCC('C', 'D', 'O', 'P'),
+    MFX_EXTBUFF_CODING_OPTION_SPSPPS = MFX_MAKEFOURCC('C', 'O', 'S', 'P'),
+    MFX_EXTBUFF_CODING_OPTION2       = MFX_MAKEFOURCC('C', 'D', 'O', '2'),
+};
+
+typedef struct {
+    mfxExtBuffer Header;
+    mfxU16 RateDistortionOpt;
+    mfxU16 MECostType;
+    mfxU16 MESearchType;
+    mfxU16 EndOfSequence;
+    mfxU16 FramePicture;
+    mfxU16 CAVLC;
+    mfxU16 RecoveryPointSEI;
+    mfxU16 ViewOutput;
+    mfxU16 NalHrdConformance;
+    mfxU16 SingleSeiNalUnit;
+    mfxU16 VuiVclHrdParameters;
+    mfxU16 RefPicListReordering;
+    mfxU16 ResetRefList;
+    mfxU16 RefPicMarkRep;
+    mfxU16 FieldOutput;
+    mfxU16 MaxDecFrameBuffering;
+    mfxU16 AUDelimiter;
+    mfxU16 EndOfStream;
+    mfxU16 PicTimingSEI;
+    mfxU16 VuiNalHrdParameters;
+} mfxExtCodingOption;
+
+typedef struct {
+    mfxExtBuffer Header;
+    mfxU16 IntRefType;
+    mfxU16 IntRefCycleSize;
+    mfxI16 IntRefQPDelta;
+    mfxU32 MaxFrameSize;
+    mfxU32 MaxSliceSize;
+    mfxU16 BitrateLimit;
+    mfxU16 MBBRC;
+    mfxU16 ExtBRC;
+    mfxU16 LookAheadDepth;
+    mfxU16 Trellis;
+} mfxExtCodingOption2;
+
+typedef struct {
+    mfxExtBuffer Header;
+    mfxU8 *SPSBuffer;
+    mfxU8 *PPSBuffer;
+    mfxU16 SPSBufSize;
+    mfxU16 PPSBufSize;
+    mfxU16 SPSId;
+    mfxU16 PPSId;
+} mfxExtCodingOptionSPSPPS;
+
+#endif /* COMPAT_MFX_MFXSTRUCTURES_H */
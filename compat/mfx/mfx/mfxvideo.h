@@ -0,0 +1,72 @@
+/*
+ * Session, core, decode and encode entry points of the Intel Media SDK API,
+ * as implemented by the software MFX stand-in (see compat/mfx/mfxsw.c).
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef COMPAT_MFX_MFXVIDEO_H
+#define COMPAT_MFX_MFXVIDEO_H
+
+#include "mfxdefs.h"
+#include "mfxstructures.h"
+
+typedef struct _mfxSession   *mfxSession;
+typedef struct _mfxSyncPoint *mfxSyncPoint;
+
+#define MFX_INFINITE 0xFFFFFFFF
+
+mfxStatus MFXInit(mfxIMPL impl, mfxVersion *ver, mfxSession *session);
+mfxStatus MFXClose(mfxSession session);
+mfxStatus MFXQueryIMPL(mfxSession session, mfxIMPL *impl);
+mfxStatus MFXQueryVersion(mfxSession session, mfxVersion *version);
+mfxStatus MFXJoinSession(mfxSession session, mfxSession child);
+mfxStatus MFXDisjoinSession(mfxSession session);
+
+mfxStatus MFXVideoCORE_SyncOperation(mfxSession session, mfxSyncPoint syncp,
+                                     mfxU32 wait);
+
+mfxStatus MFXVideoDECODE_Query(mfxSession session, mfxVideoParam *in,
+                               mfxVideoParam *out);
+mfxStatus MFXVideoDECODE_DecodeHeader(mfxSession session, mfxBitstream *bs,
+                                      mfxVideoParam *par);
+mfxStatus MFXVideoDECODE_QueryIOSurf(mfxSession session, mfxVideoParam *par,
+                                     mfxFrameAllocRequest *request);
+mfxStatus MFXVideoDECODE_Init(mfxSession session, mfxVideoParam *par);
+mfxStatus MFXVideoDECODE_Reset(mfxSession session, mfxVideoParam *par);
+mfxStatus MFXVideoDECODE_Close(mfxSession session);
+mfxStatus MFXVideoDECODE_GetVideoParam(mfxSession session, mfxVideoParam *par);
+mfxStatus MFXVideoDECODE_DecodeFrameAsync(mfxSession session, mfxBitstream *bs,
+                                          mfxFrameSurface1 *surface_work,
+                                          mfxFrameSurface1 **surface_out,
+                                          mfxSyncPoint *syncp);
+
+mfxStatus MFXVideoENCODE_Query(mfxSession session, mfxVideoParam *in,
+                               mfxVideoParam *out);
+mfxStatus MFXVideoENCODE_QueryIOSurf(mfxSession session, mfxVideoParam *par,
+                                     mfxFrameAllocRequest *request);
+mfxStatus MFXVideoENCODE_Init(mfxSession session, mfxVideoParam *par);
+mfxStatus MFXVideoENCODE_Reset(mfxSession session, mfxVideoParam *par);
+mfxStatus MFXVideoENCODE_Close(mfxSession session);
+mfxStatus MFXVideoENCODE_GetVideoParam(mfxSession session, mfxVideoParam *par);
+mfxStatus MFXVideoENCODE_EncodeFrameAsync(mfxSession session,
+                                          mfxEncodeCtrl *ctrl,
+                                          mfxFrameSurface1 *surface,
+                                          mfxBitstream *bs,
+                                          mfxSyncPoint *syncp);
+
+#endif /* COMPAT_MFX_MFXVIDEO_H */
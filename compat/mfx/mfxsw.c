@@ -0,0 +1,345 @@
+/*
+ * Software MFX stand-in: sessions and the emulated device scheduler
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "mfxsw.h"
+#include "mfxsw_internal.h"
+
+#define MFXSW_VERSION_MAJOR 1
+#define MFXSW_VERSION_MINOR 1
+
+static MFXSWStats stats;
+#if HAVE_PTHREADS
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+#if HAVE_PTHREADS
+#define sched_lock(s)   pthread_mutex_lock(&(s)->lock)
+#define sched_unlock(s) pthread_mutex_unlock(&(s)->lock)
+#else
+#define sched_lock(s)
+#define sched_unlock(s)
+#endif
+
+static void stats_add(int64_t *counter, int64_t val)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&stats_lock);
+#endif
+    *counter += val;
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&stats_lock);
+#endif
+}
+
+void MFXSW_GetStats(MFXSWStats *st)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&stats_lock);
+#endif
+    *st = stats;
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&stats_lock);
+#endif
+}
+
+void MFXSW_ResetStats(void)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&stats_lock);
+#endif
+    memset(&stats, 0, sizeof(stats));
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&stats_lock);
+#endif
+}
+
+void ff_mfxsw_add_device_time(int64_t start)
+{
+    stats_add(&stats.device_time, av_gettime() - start);
+}
+
+static int64_t getenv_int(const char *name)
+{
+    const char *val = getenv(name);
+
+    return val ? FFMAX(strtoll(val, NULL, 0), 0) : 0;
+}
+
+mfxStatus MFXInit(mfxIMPL impl, mfxVersion *ver, mfxSession *session)
+{
+    mfxSession s;
+
+    if (!session)
+        return MFX_ERR_NULL_PTR;
+
+    if (impl == MFX_IMPL_HARDWARE || impl == MFX_IMPL_HARDWARE_ANY)
+        return MFX_ERR_UNSUPPORTED;
+
+    if (ver && (ver->Major > MFXSW_VERSION_MAJOR ||
+                (ver->Major == MFXSW_VERSION_MAJOR &&
+                 ver->Minor > MFXSW_VERSION_MINOR)))
+        return MFX_ERR_UNSUPPORTED;
+
+    if (!(s = av_mallocz(sizeof(*s))))
+        return MFX_ERR_MEMORY_ALLOC;
+#if HAVE_PTHREADS
+    if (pthread_mutex_init(&s->sched_mem.lock, NULL)) {
+        av_free(s);
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+#endif
+
+    s->impl          = MFX_IMPL_SOFTWARE;
+    s->version.Major = MFXSW_VERSION_MAJOR;
+    s->version.Minor = MFXSW_VERSION_MINOR;
+
+    s->sched                = &s->sched_mem;
+    s->sched->refs          = 1;
+    s->sched->latency       = getenv_int("MFXSW_LATENCY");
+    s->sched->busy_interval = getenv_int("MFXSW_BUSY_INTERVAL");
+    s->sched->surface_hold  = getenv_int("MFXSW_SURFACE_HOLD");
+
+    *session = s;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXClose(mfxSession session)
+{
+    struct _mfxSyncPoint *sp;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    if (session->nb_children)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    ff_mfxsw_dec_close(session);
+    ff_mfxsw_enc_close(session);
+
+    if (session->parent)
+        MFXDisjoinSession(session);
+
+    while ((sp = session->syncs)) {
+        session->syncs = sp->next;
+        av_free(sp);
+    }
+
+#if HAVE_PTHREADS
+    pthread_mutex_destroy(&session->sched_mem.lock);
+#endif
+    av_free(session);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXQueryIMPL(mfxSession session, mfxIMPL *impl)
+{
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!impl)
+        return MFX_ERR_NULL_PTR;
+
+    *impl = session->impl;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXQueryVersion(mfxSession session, mfxVersion *version)
+{
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!version)
+        return MFX_ERR_NULL_PTR;
+
+    *version = session->version;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXJoinSession(mfxSession session, mfxSession child)
+{
+    int busy;
+
+    if (!session || !child)
+        return MFX_ERR_INVALID_HANDLE;
+
+    if (child->parent || session->parent || session == child)
+        return MFX_ERR_UNSUPPORTED;
+
+    sched_lock(child->sched);
+    busy = child->nb_children || child->sched->in_flight;
+    sched_unlock(child->sched);
+    if (busy)
+        return MFX_ERR_UNSUPPORTED;
+
+    sched_lock(session->sched);
+    child->parent = session;
+    child->sched  = session->sched;
+    child->sched->refs++;
+    session->nb_children++;
+    sched_unlock(session->sched);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXDisjoinSession(mfxSession session)
+{
+    struct _mfxSyncPoint *sp;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!session->parent)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    for (sp = session->syncs; sp; sp = sp->next)
+        if (sp->pending)
+            return MFX_WRN_IN_EXECUTION;
+
+    sched_lock(session->sched);
+    session->sched->refs--;
+    session->parent->nb_children--;
+    sched_unlock(session->sched);
+    session->parent = NULL;
+    session->sched  = &session->sched_mem;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus ff_mfxsw_submit(mfxSession session)
+{
+    MFXSWScheduler *sched = session->sched;
+    int busy;
+
+    sched_lock(sched);
+    sched->submitted++;
+    busy = sched->in_flight >= sched->capacity ||
+           (sched->busy_interval && !(sched->submitted % sched->busy_interval));
+    sched_unlock(sched);
+
+    if (busy) {
+        stats_add(&stats.busy, 1);
+        return MFX_WRN_DEVICE_BUSY;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+void ff_mfxsw_add_capacity(mfxSession session, int delta)
+{
+    sched_lock(session->sched);
+    session->sched->capacity += delta;
+    sched_unlock(session->sched);
+}
+
+mfxSyncPoint ff_mfxsw_sync_alloc(mfxSession session, enum MFXSWTaskOwner owner,
+                                 mfxFrameSurface1 *surface, int64_t start)
+{
+    struct _mfxSyncPoint *sp = session->free_syncs;
+
+    if (sp) {
+        session->free_syncs = sp->next_free;
+    } else {
+        if (!(sp = av_mallocz(sizeof(*sp))))
+            return NULL;
+        sp->next       = session->syncs;
+        session->syncs = sp;
+    }
+
+    sp->next_free = NULL;
+    sp->pending   = 1;
+    sp->owner     = owner;
+    sp->ready     = start + session->sched->latency;
+    sp->surface   = surface;
+
+    sched_lock(session->sched);
+    session->sched->in_flight++;
+    sched_unlock(session->sched);
+
+    return sp;
+}
+
+static void sync_release(mfxSession session, struct _mfxSyncPoint *sp)
+{
+    sp->pending   = 0;
+    sp->surface   = NULL;
+    sp->next_free = session->free_syncs;
+    session->free_syncs = sp;
+
+    sched_lock(session->sched);
+    session->sched->in_flight--;
+    sched_unlock(session->sched);
+}
+
+void ff_mfxsw_sync_cancel(mfxSession session, enum MFXSWTaskOwner owner)
+{
+    struct _mfxSyncPoint *sp;
+
+    for (sp = session->syncs; sp; sp = sp->next)
+        if (sp->pending && sp->owner == owner)
+            sync_release(session, sp);
+}
+
+mfxStatus MFXVideoCORE_SyncOperation(mfxSession session, mfxSyncPoint syncp,
+                                     mfxU32 wait)
+{
+    int64_t now;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!syncp)
+        return MFX_ERR_NULL_PTR;
+    if (!syncp->pending)
+        return MFX_ERR_NOT_FOUND;
+
+    now = av_gettime();
+    if (now < syncp->ready) {
+        int64_t left = syncp->ready - now;
+
+        if (wait != MFX_INFINITE && left > wait * INT64_C(1000)) {
+            if (wait)
+                av_usleep(wait * 1000);
+            stats_add(&stats.sync_wait, av_gettime() - now);
+            return MFX_WRN_IN_EXECUTION;
+        }
+
+        av_usleep(left);
+        stats_add(&stats.sync_wait, av_gettime() - now);
+    }
+
+    if (syncp->surface)
+        syncp->surface->Data.Locked--;
+
+    sync_release(session, syncp);
+    stats_add(&stats.tasks, 1);
+
+    return MFX_ERR_NONE;
+}
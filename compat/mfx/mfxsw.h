@@ -0,0 +1,52 @@
+/*
+ * Software MFX stand-in: statistics interface for benchmarking tools
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef COMPAT_MFX_MFXSW_H
+#define COMPAT_MFX_MFXSW_H
+
+/**
+ * @file
+ * The stand-in implements the Media SDK API on top of the native h264 and
+ * mpeg2video decoders and a trivial intra-only encoder. Its emulated device
+ * is configured through the environment when a session is created:
+ *
+ * - MFXSW_LATENCY:        task completion latency in microseconds
+ * - MFXSW_BUSY_INTERVAL:  return MFX_WRN_DEVICE_BUSY on every Nth submission
+ * - MFXSW_SURFACE_HOLD:   number of decoded surfaces kept locked as
+ *                         references after they have been output
+ */
+
+#include <stdint.h>
+
+typedef struct MFXSWStats {
+    int64_t tasks;          ///< tasks completed through SyncOperation
+    int64_t busy;           ///< MFX_WRN_DEVICE_BUSY returned
+    int64_t device_time;    ///< microseconds spent emulating the device
+    int64_t sync_wait;      ///< microseconds spent waiting for latency
+} MFXSWStats;
+
+/**
+ * Get the counters accumulated by all sessions of the process.
+ */
+void MFXSW_GetStats(MFXSWStats *stats);
+
+void MFXSW_ResetStats(void);
+
+#endif /* COMPAT_MFX_MFXSW_H */
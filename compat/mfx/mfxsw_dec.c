@@ -0,0 +1,838 @@
+/*
+ * Software MFX stand-in: decoding on top of the native h264/mpeg2 decoders
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavcodec/avcodec.h"
+#include "libavcodec/get_bits.h"
+#include "libavcodec/golomb.h"
+#include "libavcodec/internal.h"
+#include "libavcodec/mpeg12data.h"
+#include "mfxsw_internal.h"
+
+extern AVCodec ff_h264_decoder;
+extern AVCodec ff_mpeg2video_decoder;
+
+struct MFXSWDecoder {
+    mfxVideoParam param;
+    int initialized;
+    int async_depth;
+    uint8_t *headers;           ///< sequence headers seen by DecodeHeader
+    int headers_size;
+    AVCodecContext *avctx;
+    AVCodecParserContext *parser;
+    AVFrame *frame;
+    int frame_ready;
+    int parser_drained;
+    int interpolate_ts;
+    int64_t last_ts;
+    mfxFrameSurface1 **held;
+    int nb_held;
+};
+
+static const AVRational h264_pixel_aspect[17] = {
+    {   0,  1 }, {   1,  1 }, {  12, 11 }, {  10, 11 }, {  16, 11 },
+    {  40, 33 }, {  24, 11 }, {  20, 11 }, {  32, 11 }, {  80, 33 },
+    {  18, 11 }, {  15, 11 }, {  64, 33 }, { 160, 99 }, {   4,  3 },
+    {   3,  2 }, {   2,  1 },
+};
+
+static MFXSWDecoder *get_decoder(mfxSession session)
+{
+    if (!session->dec)
+        session->dec = av_mallocz(sizeof(*session->dec));
+
+    return session->dec;
+}
+
+static const uint8_t *find_start_code(const uint8_t *p, const uint8_t *end)
+{
+    for (; p + 3 <= end; p++)
+        if (!p[0] && !p[1] && p[2] == 1)
+            return p;
+
+    return end;
+}
+
+static int save_headers(MFXSWDecoder *dec, const uint8_t *data, int size,
+                        int append)
+{
+    int offset = append ? dec->headers_size : 0;
+
+    if (av_reallocp(&dec->headers, offset + size +
+                    FF_INPUT_BUFFER_PADDING_SIZE) < 0) {
+        dec->headers_size = 0;
+        return AVERROR(ENOMEM);
+    }
+
+    memcpy(dec->headers + offset, data, size);
+    dec->headers_size = offset + size;
+    memset(dec->headers + dec->headers_size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+    return 0;
+}
+
+static void skip_scaling_list(GetBitContext *gb, int size)
+{
+    int i, last = 8, next = 8;
+
+    for (i = 0; i < size; i++) {
+        if (next)
+            next = (last + get_se_golomb(gb)) & 0xff;
+        if (next)
+            last = next;
+    }
+}
+
+static mfxStatus parse_h264_sps(const uint8_t *nal, int size,
+                                mfxVideoParam *par)
+{
+    mfxFrameInfo *fi = &par->mfx.FrameInfo;
+    GetBitContext gb;
+    uint8_t *rbsp;
+    int i, rbsp_size = 0;
+    int profile, level, chroma_format_idc = 1, depth_luma = 8, depth_chroma = 8;
+    int poc_type, mb_w, mb_h, frame_mbs_only;
+    int crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    int crop_unit_y;
+    AVRational sar = { 0, 1 };
+    uint32_t num_units_in_tick = 0, time_scale = 0;
+
+    if (!(rbsp = av_malloc(size + FF_INPUT_BUFFER_PADDING_SIZE)))
+        return MFX_ERR_MEMORY_ALLOC;
+
+    for (i = 0; i < size; i++) {
+        if (i + 2 < size && !nal[i] && !nal[i + 1] && nal[i + 2] == 3) {
+            rbsp[rbsp_size++] = 0;
+            rbsp[rbsp_size++] = 0;
+            i += 2;
+            continue;
+        }
+        rbsp[rbsp_size++] = nal[i];
+    }
+    memset(rbsp + rbsp_size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+    init_get_bits(&gb, rbsp, rbsp_size * 8);
+
+    skip_bits(&gb, 8); // NAL header
+    profile = get_bits(&gb, 8);
+    skip_bits(&gb, 8); // constraint_set flags
+    level = get_bits(&gb, 8);
+    get_ue_golomb_31(&gb); // seq_parameter_set_id
+
+    if (profile == 100 || profile == 110 || profile == 122 ||
+        profile == 244 || profile ==  44 || profile ==  83 ||
+        profile ==  86 || profile == 118 || profile == 128) {
+        chroma_format_idc = get_ue_golomb_31(&gb);
+        if (chroma_format_idc == 3)
+            skip_bits1(&gb); // separate_colour_plane_flag
+        depth_luma   = get_ue_golomb(&gb) + 8;
+        depth_chroma = get_ue_golomb(&gb) + 8;
+        skip_bits1(&gb); // qpprime_y_zero_transform_bypass_flag
+        if (get_bits1(&gb))
+            for (i = 0; i < (chroma_format_idc == 3 ? 12 : 8); i++)
+                if (get_bits1(&gb))
+                    skip_scaling_list(&gb, i < 6 ? 16 : 64);
+    }
+
+    if (chroma_format_idc != 1 || depth_luma != 8 || depth_chroma != 8) {
+        av_free(rbsp);
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    get_ue_golomb(&gb); // log2_max_frame_num_minus4
+    poc_type = get_ue_golomb_31(&gb);
+    if (poc_type == 0) {
+        get_ue_golomb(&gb);
+    } else if (poc_type == 1) {
+        int cycle;
+
+        skip_bits1(&gb);
+        get_se_golomb(&gb);
+        get_se_golomb(&gb);
+        cycle = get_ue_golomb(&gb);
+        for (i = 0; i < cycle; i++)
+            get_se_golomb(&gb);
+    }
+    get_ue_golomb(&gb); // max_num_ref_frames
+    skip_bits1(&gb);    // gaps_in_frame_num_value_allowed_flag
+    mb_w           = get_ue_golomb(&gb) + 1;
+    mb_h           = get_ue_golomb(&gb) + 1;
+    frame_mbs_only = get_bits1(&gb);
+    if (!frame_mbs_only)
+        skip_bits1(&gb);
+    skip_bits1(&gb);    // direct_8x8_inference_flag
+    if (get_bits1(&gb)) {
+        crop_left   = get_ue_golomb(&gb);
+        crop_right  = get_ue_golomb(&gb);
+        crop_top    = get_ue_golomb(&gb);
+        crop_bottom = get_ue_golomb(&gb);
+    }
+
+    if (get_bits1(&gb)) { // vui_parameters_present_flag
+        if (get_bits1(&gb)) {
+            int idc = get_bits(&gb, 8);
+            if (idc == 255) {
+                sar.num = get_bits(&gb, 16);
+                sar.den = get_bits(&gb, 16);
+            } else if (idc < FF_ARRAY_ELEMS(h264_pixel_aspect)) {
+                sar = h264_pixel_aspect[idc];
+            }
+        }
+        if (get_bits1(&gb))
+            skip_bits1(&gb);
+        if (get_bits1(&gb)) {
+            skip_bits(&gb, 4);
+            if (get_bits1(&gb))
+                skip_bits(&gb, 24);
+        }
+        if (get_bits1(&gb)) {
+            get_ue_golomb(&gb);
+            get_ue_golomb(&gb);
+        }
+        if (get_bits1(&gb)) {
+            num_units_in_tick = get_bits_long(&gb, 32);
+            time_scale        = get_bits_long(&gb, 32);
+        }
+    }
+
+    av_free(rbsp);
+
+    if (mb_w > 4096 / 16 * 2 || mb_h > 4096 / 16 * 2)
+        return MFX_ERR_UNSUPPORTED;
+
+    crop_unit_y = 2 * (2 - frame_mbs_only);
+
+    par->mfx.CodecProfile = profile;
+    par->mfx.CodecLevel   = level;
+
+    fi->FourCC        = MFX_FOURCC_NV12;
+    fi->ChromaFormat  = MFX_CHROMAFORMAT_YUV420;
+    fi->Width         = mb_w * 16;
+    fi->Height        = mb_h * 16 * (2 - frame_mbs_only);
+    fi->CropX         = crop_left * 2;
+    fi->CropY         = crop_top  * crop_unit_y;
+    fi->CropW         = fi->Width  - (crop_left + crop_right)  * 2;
+    fi->CropH         = fi->Height - (crop_top  + crop_bottom) * crop_unit_y;
+    fi->PicStruct     = frame_mbs_only ? MFX_PICSTRUCT_PROGRESSIVE :
+                                         MFX_PICSTRUCT_UNKNOWN;
+    fi->AspectRatioW  = sar.num;
+    fi->AspectRatioH  = sar.num ? sar.den : 0;
+    if (num_units_in_tick && time_scale) {
+        fi->FrameRateExtN = time_scale;
+        fi->FrameRateExtD = 2 * num_units_in_tick;
+    } else {
+        fi->FrameRateExtN = 30000;
+        fi->FrameRateExtD = 1001;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+static mfxStatus decode_header_h264(MFXSWDecoder *dec, mfxBitstream *bs,
+                                    mfxVideoParam *par)
+{
+    const uint8_t *buf = bs->Data + bs->DataOffset;
+    const uint8_t *end = buf + bs->DataLength;
+    const uint8_t *p   = find_start_code(buf, end);
+    const uint8_t *sps = NULL;
+    mfxStatus ret      = MFX_ERR_MORE_DATA;
+
+    dec->headers_size = 0;
+
+    while (p < end) {
+        const uint8_t *nal  = p + 3;
+        const uint8_t *next = find_start_code(nal, end);
+        int type            = nal < end ? nal[0] & 0x1f : 0;
+
+        if (type == 7 || type == 8) {
+            if (type == 7 && !sps) {
+                sps = p;
+                ret = parse_h264_sps(nal, next - nal, par);
+                if (ret < 0)
+                    return ret;
+            }
+            if (save_headers(dec, p, next - p, 1) < 0)
+                return MFX_ERR_MEMORY_ALLOC;
+        }
+        p = next;
+    }
+
+    if (sps) {
+        bs->DataLength -= sps - buf;
+        bs->DataOffset += sps - buf;
+    } else {
+        bs->DataOffset += bs->DataLength;
+        bs->DataLength  = 0;
+    }
+
+    return ret;
+}
+
+static mfxStatus decode_header_mpeg2(MFXSWDecoder *dec, mfxBitstream *bs,
+                                     mfxVideoParam *par)
+{
+    mfxFrameInfo *fi = &par->mfx.FrameInfo;
+    const uint8_t *buf = bs->Data + bs->DataOffset;
+    const uint8_t *end = buf + bs->DataLength;
+    const uint8_t *p   = find_start_code(buf, end);
+    const uint8_t *seq = NULL;
+    GetBitContext gb;
+    int width = 0, height = 0, aspect = 0, frame_rate_code = 0;
+    int progressive = 1, ext_n = 0, ext_d = 0, profile_level = 0;
+    AVRational frame_rate;
+
+    for (; p + 4 <= end; p = find_start_code(p + 3, end)) {
+        if (p[3] == 0xb3 && !seq) {
+            seq = p;
+            if (end - p < 12)
+                return MFX_ERR_MORE_DATA;
+            init_get_bits(&gb, p + 4, (end - p - 4) * 8);
+            width           = get_bits(&gb, 12);
+            height          = get_bits(&gb, 12);
+            aspect          = get_bits(&gb, 4);
+            frame_rate_code = get_bits(&gb, 4);
+        } else if (p[3] == 0xb5 && seq && end - p >= 10 && p[4] >> 4 == 1) {
+            init_get_bits(&gb, p + 4, (end - p - 4) * 8);
+            skip_bits(&gb, 4);
+            profile_level = get_bits(&gb, 8);
+            progressive   = get_bits1(&gb);
+            if (get_bits(&gb, 2) != 1)
+                return MFX_ERR_UNSUPPORTED;
+            width  |= get_bits(&gb, 2) << 12;
+            height |= get_bits(&gb, 2) << 12;
+            skip_bits(&gb, 12 + 1 + 8 + 1);
+            ext_n = get_bits(&gb, 2);
+            ext_d = get_bits(&gb, 5);
+        } else if (seq && p[3] != 0xb3 && p[3] != 0xb5) {
+            break;
+        }
+    }
+
+    if (!seq || !width || !height) {
+        bs->DataOffset += bs->DataLength;
+        bs->DataLength  = 0;
+        return MFX_ERR_MORE_DATA;
+    }
+
+    if (save_headers(dec, seq, p - seq, 0) < 0)
+        return MFX_ERR_MEMORY_ALLOC;
+
+    bs->DataLength -= seq - buf;
+    bs->DataOffset += seq - buf;
+
+    frame_rate = ff_mpeg12_frame_rate_tab[frame_rate_code];
+    if (!frame_rate.den)
+        frame_rate = (AVRational){ 30000, 1001 };
+    frame_rate.num *= ext_n + 1;
+    frame_rate.den *= ext_d + 1;
+
+    par->mfx.CodecProfile = profile_level & 0x70;
+    par->mfx.CodecLevel   = profile_level & 0x0f;
+
+    fi->FourCC        = MFX_FOURCC_NV12;
+    fi->ChromaFormat  = MFX_CHROMAFORMAT_YUV420;
+    fi->Width         = FFALIGN(width, 16);
+    fi->Height        = FFALIGN(height, progressive ? 16 : 32);
+    fi->CropX         = 0;
+    fi->CropY         = 0;
+    fi->CropW         = width;
+    fi->CropH         = height;
+    fi->PicStruct     = progressive ? MFX_PICSTRUCT_PROGRESSIVE :
+                                      MFX_PICSTRUCT_UNKNOWN;
+    fi->FrameRateExtN = frame_rate.num;
+    fi->FrameRateExtD = frame_rate.den;
+    fi->AspectRatioW  = 0;
+    fi->AspectRatioH  = 0;
+    if (aspect == 1) {
+        fi->AspectRatioW = fi->AspectRatioH = 1;
+    } else if (aspect > 1 && aspect < 5) {
+        static const AVRational dar[] = { { 4, 3 }, { 16, 9 }, { 221, 100 } };
+        int num, den;
+
+        av_reduce(&num, &den, dar[aspect - 2].num * height,
+                  dar[aspect - 2].den * width, 65535);
+        fi->AspectRatioW = num;
+        fi->AspectRatioH = den;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoDECODE_Query(mfxSession session, mfxVideoParam *in,
+                               mfxVideoParam *out)
+{
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!out)
+        return MFX_ERR_NULL_PTR;
+
+    if (!in) {
+        memset(out, 0, sizeof(*out));
+        return MFX_ERR_NONE;
+    }
+
+    *out = *in;
+
+    if (in->mfx.CodecId != MFX_CODEC_AVC && in->mfx.CodecId != MFX_CODEC_MPEG2)
+        return MFX_ERR_UNSUPPORTED;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoDECODE_DecodeHeader(mfxSession session, mfxBitstream *bs,
+                                      mfxVideoParam *par)
+{
+    MFXSWDecoder *dec;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!bs || !par)
+        return MFX_ERR_NULL_PTR;
+    if (!(dec = get_decoder(session)))
+        return MFX_ERR_MEMORY_ALLOC;
+
+    switch (par->mfx.CodecId) {
+    case MFX_CODEC_AVC:
+        return decode_header_h264(dec, bs, par);
+    case MFX_CODEC_MPEG2:
+        return decode_header_mpeg2(dec, bs, par);
+    }
+
+    return MFX_ERR_UNSUPPORTED;
+}
+
+static int get_async_depth(mfxVideoParam *par)
+{
+    return par->AsyncDepth ? par->AsyncDepth : 4;
+}
+
+mfxStatus MFXVideoDECODE_QueryIOSurf(mfxSession session, mfxVideoParam *par,
+                                     mfxFrameAllocRequest *request)
+{
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!par || !request)
+        return MFX_ERR_NULL_PTR;
+    if (par->mfx.CodecId != MFX_CODEC_AVC && par->mfx.CodecId != MFX_CODEC_MPEG2)
+        return MFX_ERR_UNSUPPORTED;
+
+    request->Info              = par->mfx.FrameInfo;
+    request->Type              = MFX_MEMTYPE_SYSTEM_MEMORY |
+                                 MFX_MEMTYPE_FROM_DECODE   |
+                                 MFX_MEMTYPE_EXTERNAL_FRAME;
+    request->NumFrameMin       = get_async_depth(par);
+    request->NumFrameSuggested = request->NumFrameMin + 1 +
+                                 session->sched->surface_hold;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoDECODE_Init(mfxSession session, mfxVideoParam *par)
+{
+    MFXSWDecoder *dec;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+    if (!(dec = get_decoder(session)))
+        return MFX_ERR_MEMORY_ALLOC;
+    if (dec->initialized)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    if (par->mfx.CodecId != MFX_CODEC_AVC && par->mfx.CodecId != MFX_CODEC_MPEG2)
+        return MFX_ERR_UNSUPPORTED;
+    if (!(par->IOPattern & MFX_IOPATTERN_OUT_SYSTEM_MEMORY))
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+    if (!par->mfx.FrameInfo.Width || !par->mfx.FrameInfo.Height)
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+
+    if (session->sched->surface_hold &&
+        !(dec->held = av_mallocz_array(session->sched->surface_hold,
+                                       sizeof(*dec->held))))
+        return MFX_ERR_MEMORY_ALLOC;
+
+    dec->param       = *par;
+    dec->async_depth = get_async_depth(par);
+    dec->initialized = 1;
+    dec->last_ts     = AV_NOPTS_VALUE;
+
+    ff_mfxsw_add_capacity(session, dec->async_depth);
+
+    return MFX_ERR_NONE;
+}
+
+/**
+ * The backend is opened on the first DecodeFrameAsync() call rather than in
+ * Init(): the QSV wrappers may call Init() from their own codec init, where
+ * the avcodec lock is already held.
+ */
+static mfxStatus open_backend(MFXSWDecoder *dec)
+{
+    AVCodec *codec = dec->param.mfx.CodecId == MFX_CODEC_AVC ?
+                     &ff_h264_decoder : &ff_mpeg2video_decoder;
+
+    if (!(dec->avctx = avcodec_alloc_context3(codec)) ||
+        !(dec->frame = av_frame_alloc()))
+        return MFX_ERR_MEMORY_ALLOC;
+
+    dec->avctx->refcounted_frames = 1;
+
+    if (dec->headers_size) {
+        dec->avctx->extradata = av_mallocz(dec->headers_size +
+                                           FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!dec->avctx->extradata)
+            return MFX_ERR_MEMORY_ALLOC;
+        memcpy(dec->avctx->extradata, dec->headers, dec->headers_size);
+        dec->avctx->extradata_size = dec->headers_size;
+    }
+
+    if (avcodec_open2(dec->avctx, codec, NULL) < 0)
+        return MFX_ERR_DEVICE_FAILED;
+
+    dec->parser = av_parser_init(codec->id);
+
+    return MFX_ERR_NONE;
+}
+
+static void close_backend(MFXSWDecoder *dec)
+{
+    if (dec->parser)
+        av_parser_close(dec->parser);
+    dec->parser = NULL;
+    // MFXClose() usually runs from the wrapper's close callback, which
+    // already holds the libavcodec lock
+    if (dec->avctx && ff_avcodec_locked)
+        ff_codec_close_recursive(dec->avctx);
+    else if (dec->avctx)
+        avcodec_close(dec->avctx);
+    if (dec->avctx)
+        av_freep(&dec->avctx->extradata);
+    av_freep(&dec->avctx);
+    av_frame_free(&dec->frame);
+    dec->frame_ready    = 0;
+    dec->parser_drained = 0;
+}
+
+static void release_held(MFXSWDecoder *dec)
+{
+    int i;
+
+    for (i = 0; i < dec->nb_held; i++)
+        dec->held[i]->Data.Locked--;
+    dec->nb_held = 0;
+}
+
+static mfxStatus decode_packet(MFXSWDecoder *dec, uint8_t *data, int size,
+                               int64_t pts)
+{
+    AVPacket pkt;
+    int got_frame = 0, ret;
+
+    av_init_packet(&pkt);
+    pkt.data = data;
+    pkt.size = size;
+    pkt.pts  = pts;
+
+    ret = avcodec_decode_video2(dec->avctx, dec->frame, &got_frame, &pkt);
+    if (ret < 0 && !size)
+        return MFX_ERR_MORE_DATA;
+
+    dec->frame_ready = got_frame;
+
+    if (!size && !got_frame)
+        return MFX_ERR_MORE_DATA;
+
+    return MFX_ERR_NONE;
+}
+
+/**
+ * Feed the next access unit of bs to the backend.
+ *
+ * @return MFX_ERR_NONE if progress was made, MFX_ERR_MORE_DATA when the
+ *         bitstream (or, when draining, the backend) is exhausted
+ */
+static mfxStatus decode_next(MFXSWDecoder *dec, mfxBitstream *bs)
+{
+    uint8_t *data = NULL;
+    int64_t pts   = AV_NOPTS_VALUE;
+    int size      = 0;
+
+    if (bs && bs->DataLength) {
+        uint8_t *buf = bs->Data + bs->DataOffset;
+        int len;
+
+        if (!bs->DataOffset)
+            pts = bs->TimeStamp;
+        if (bs->TimeStamp == MFX_TIMESTAMP_UNKNOWN)
+            dec->interpolate_ts = 1;
+
+        if (!dec->parser || bs->DataFlag & MFX_BITSTREAM_COMPLETE_FRAME) {
+            data = buf;
+            size = len = bs->DataLength;
+        } else {
+            len = av_parser_parse2(dec->parser, dec->avctx, &data, &size,
+                                   buf, bs->DataLength, pts, pts, 0);
+            pts = dec->parser->pts;
+        }
+
+        bs->DataOffset += len;
+        bs->DataLength -= len;
+    } else if (!bs && dec->parser && !dec->parser_drained) {
+        av_parser_parse2(dec->parser, dec->avctx, &data, &size,
+                         NULL, 0, AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+        pts = dec->parser->pts;
+        dec->parser_drained = 1;
+    } else if (!bs) {
+        return decode_packet(dec, NULL, 0, AV_NOPTS_VALUE);
+    } else {
+        return MFX_ERR_MORE_DATA;
+    }
+
+    if (!size)
+        return MFX_ERR_NONE;
+
+    return decode_packet(dec, data, size, pts);
+}
+
+static mfxU64 output_timestamp(MFXSWDecoder *dec, int64_t pts)
+{
+    mfxFrameInfo *fi = &dec->param.mfx.FrameInfo;
+
+    if (dec->interpolate_ts &&
+        (pts == AV_NOPTS_VALUE || pts == (int64_t)MFX_TIMESTAMP_UNKNOWN)) {
+        if (dec->last_ts == AV_NOPTS_VALUE)
+            return MFX_TIMESTAMP_UNKNOWN;
+        pts = dec->last_ts + av_rescale(90000, fi->FrameRateExtD,
+                                        fi->FrameRateExtN);
+    }
+
+    if (pts != AV_NOPTS_VALUE && pts != (int64_t)MFX_TIMESTAMP_UNKNOWN)
+        dec->last_ts = pts;
+
+    return pts;
+}
+
+static mfxStatus output_frame(MFXSWDecoder *dec, mfxFrameSurface1 *surf)
+{
+    AVFrame *frame = dec->frame;
+    int w = FFMIN(frame->width,  surf->Info.CropW ? surf->Info.CropW : surf->Info.Width);
+    int h = FFMIN(frame->height, surf->Info.CropH ? surf->Info.CropH : surf->Info.Height);
+    int x, y;
+
+    if (frame->format != AV_PIX_FMT_YUV420P &&
+        frame->format != AV_PIX_FMT_YUVJ420P)
+        return MFX_ERR_UNSUPPORTED;
+    if (!surf->Data.Y || !surf->Data.UV)
+        return MFX_ERR_NULL_PTR;
+
+    for (y = 0; y < h; y++)
+        memcpy(surf->Data.Y + y * surf->Data.Pitch,
+               frame->data[0] + y * frame->linesize[0], w);
+
+    for (y = 0; y < (h + 1) >> 1; y++) {
+        const uint8_t *u = frame->data[1] + y * frame->linesize[1];
+        const uint8_t *v = frame->data[2] + y * frame->linesize[2];
+        uint8_t *uv      = surf->Data.UV + y * surf->Data.Pitch;
+
+        for (x = 0; x < (w + 1) >> 1; x++) {
+            uv[2 * x    ] = u[x];
+            uv[2 * x + 1] = v[x];
+        }
+    }
+
+    surf->Info.PicStruct =
+        !frame->interlaced_frame ? MFX_PICSTRUCT_PROGRESSIVE :
+        frame->top_field_first   ? MFX_PICSTRUCT_FIELD_TFF :
+                                   MFX_PICSTRUCT_FIELD_BFF;
+    if (frame->repeat_pict == 1)
+        surf->Info.PicStruct |= MFX_PICSTRUCT_FIELD_REPEATED;
+    else if (frame->repeat_pict == 2)
+        surf->Info.PicStruct |= MFX_PICSTRUCT_FRAME_DOUBLING;
+    else if (frame->repeat_pict == 4)
+        surf->Info.PicStruct |= MFX_PICSTRUCT_FRAME_TRIPLING;
+
+    if (frame->sample_aspect_ratio.num) {
+        surf->Info.AspectRatioW = frame->sample_aspect_ratio.num;
+        surf->Info.AspectRatioH = frame->sample_aspect_ratio.den;
+    }
+
+    surf->Data.TimeStamp = output_timestamp(dec, frame->pkt_pts);
+    surf->Data.Corrupted = 0;
+
+    return MFX_ERR_NONE;
+}
+
+static void hold_surface(mfxSession session, MFXSWDecoder *dec,
+                         mfxFrameSurface1 *surf)
+{
+    int hold = session->sched->surface_hold;
+
+    if (!hold)
+        return;
+
+    if (dec->nb_held == hold) {
+        dec->held[0]->Data.Locked--;
+        memmove(dec->held, dec->held + 1, (hold - 1) * sizeof(*dec->held));
+        dec->nb_held--;
+    }
+
+    surf->Data.Locked++;
+    dec->held[dec->nb_held++] = surf;
+}
+
+mfxStatus MFXVideoDECODE_DecodeFrameAsync(mfxSession session, mfxBitstream *bs,
+                                          mfxFrameSurface1 *surface_work,
+                                          mfxFrameSurface1 **surface_out,
+                                          mfxSyncPoint *syncp)
+{
+    MFXSWDecoder *dec = session ? session->dec : NULL;
+    int64_t start;
+    mfxStatus ret;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!dec || !dec->initialized)
+        return MFX_ERR_NOT_INITIALIZED;
+    if (!surface_work || !surface_out || !syncp)
+        return MFX_ERR_NULL_PTR;
+
+    *syncp       = NULL;
+    *surface_out = NULL;
+
+    if ((ret = ff_mfxsw_submit(session)) != MFX_ERR_NONE)
+        return ret;
+
+    if (surface_work->Data.Locked)
+        return MFX_ERR_MORE_SURFACE;
+
+    start = av_gettime();
+
+    if (!dec->avctx && (ret = open_backend(dec)) < 0) {
+        close_backend(dec);
+        return ret;
+    }
+
+    ret = MFX_ERR_NONE;
+    while (!dec->frame_ready && ret == MFX_ERR_NONE)
+        ret = decode_next(dec, bs);
+
+    if (!dec->frame_ready) {
+        ff_mfxsw_add_device_time(start);
+        return ret;
+    }
+
+    ret = output_frame(dec, surface_work);
+    av_frame_unref(dec->frame);
+    dec->frame_ready = 0;
+    if (ret < 0) {
+        ff_mfxsw_add_device_time(start);
+        return ret;
+    }
+
+    surface_work->Data.Locked++;
+    if (!(*syncp = ff_mfxsw_sync_alloc(session, MFXSW_TASK_DECODE,
+                                       surface_work, start))) {
+        surface_work->Data.Locked--;
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+    hold_surface(session, dec, surface_work);
+
+    *surface_out = surface_work;
+
+    ff_mfxsw_add_device_time(start);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoDECODE_GetVideoParam(mfxSession session, mfxVideoParam *par)
+{
+    MFXSWDecoder *dec = session ? session->dec : NULL;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+    if (!dec || !dec->initialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    par->AsyncDepth = dec->param.AsyncDepth;
+    par->IOPattern  = dec->param.IOPattern;
+    par->mfx        = dec->param.mfx;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoDECODE_Reset(mfxSession session, mfxVideoParam *par)
+{
+    MFXSWDecoder *dec = session ? session->dec : NULL;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+    if (!dec || !dec->initialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    ff_mfxsw_sync_cancel(session, MFXSW_TASK_DECODE);
+    release_held(dec);
+    close_backend(dec);
+
+    dec->param.mfx.FrameInfo = par->mfx.FrameInfo;
+    dec->interpolate_ts      = 0;
+    dec->last_ts             = AV_NOPTS_VALUE;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoDECODE_Close(mfxSession session)
+{
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!session->dec || !session->dec->initialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    ff_mfxsw_dec_close(session);
+
+    return MFX_ERR_NONE;
+}
+
+void ff_mfxsw_dec_close(mfxSession session)
+{
+    MFXSWDecoder *dec = session->dec;
+
+    if (!dec)
+        return;
+
+    ff_mfxsw_sync_cancel(session, MFXSW_TASK_DECODE);
+
+    if (dec->initialized)
+        ff_mfxsw_add_capacity(session, -dec->async_depth);
+
+    release_held(dec);
+    close_backend(dec);
+    av_freep(&dec->held);
+    av_freep(&dec->headers);
+    av_freep(&session->dec);
+}
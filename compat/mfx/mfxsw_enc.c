@@ -0,0 +1,685 @@
+/*
+ * Software MFX stand-in: trivial intra-only encoding
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * The encoder only has to produce valid, cheap bitstreams: H.264 is coded
+ * as I_PCM macroblocks, MPEG-2 as DC-only intra macroblocks. Every GOP
+ * starts with a reference (IDR) picture followed by non-reference intra
+ * pictures, so each output packet is self-contained.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavcodec/put_bits.h"
+#include "libavcodec/golomb.h"
+#include "libavcodec/mpeg12data.h"
+#include "mfxsw_internal.h"
+
+#define H264_LOG2_MAX_FRAME_NUM 4
+#define H264_LOG2_MAX_POC_LSB   8
+#define H264_MB_TYPE_I_PCM      25
+
+struct MFXSWEncoder {
+    mfxVideoParam param;
+    int initialized;
+    int async_depth;
+    int mb_width, mb_height;
+    int max_frame_size;
+    int64_t frame_num;          ///< pictures since the last GOP start
+    int idr_pic_id;
+    uint8_t *rbsp;
+    int rbsp_size;
+};
+
+static int get_async_depth(mfxVideoParam *par)
+{
+    return par->AsyncDepth ? par->AsyncDepth : 4;
+}
+
+static mfxStatus check_param(mfxVideoParam *par)
+{
+    mfxFrameInfo *fi = &par->mfx.FrameInfo;
+
+    if (par->mfx.CodecId != MFX_CODEC_AVC && par->mfx.CodecId != MFX_CODEC_MPEG2)
+        return MFX_ERR_UNSUPPORTED;
+    if (!(par->IOPattern & MFX_IOPATTERN_IN_SYSTEM_MEMORY))
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+    if (fi->FourCC != MFX_FOURCC_NV12 ||
+        fi->ChromaFormat != MFX_CHROMAFORMAT_YUV420)
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+    if (!fi->Width || !fi->Height || fi->Width & 15 || fi->Height & 15 ||
+        fi->CropW > fi->Width || fi->CropH > fi->Height)
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+    // one slice per macroblock row without slice_vertical_position_extension
+    if (par->mfx.CodecId == MFX_CODEC_MPEG2 &&
+        (fi->Height > 175 * 16 || fi->Width > 4095))
+        return MFX_ERR_UNSUPPORTED;
+
+    return MFX_ERR_NONE;
+}
+
+static int max_frame_size(MFXSWEncoder *enc)
+{
+    int mbs = enc->mb_width * enc->mb_height;
+
+    if (enc->param.mfx.CodecId == MFX_CODEC_AVC)
+        return (mbs * 386 + 256) * 3 / 2 + 1024;
+
+    return mbs * 24 + enc->mb_height * 8 + 1024;
+}
+
+mfxStatus MFXVideoENCODE_Query(mfxSession session, mfxVideoParam *in,
+                               mfxVideoParam *out)
+{
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!out)
+        return MFX_ERR_NULL_PTR;
+
+    if (!in) {
+        memset(out, 0, sizeof(*out));
+        return MFX_ERR_NONE;
+    }
+
+    *out = *in;
+
+    return check_param(in);
+}
+
+mfxStatus MFXVideoENCODE_QueryIOSurf(mfxSession session, mfxVideoParam *par,
+                                     mfxFrameAllocRequest *request)
+{
+    mfxStatus ret;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!par || !request)
+        return MFX_ERR_NULL_PTR;
+    if ((ret = check_param(par)) < 0)
+        return ret;
+
+    request->Info              = par->mfx.FrameInfo;
+    request->Type              = MFX_MEMTYPE_SYSTEM_MEMORY |
+                                 MFX_MEMTYPE_FROM_ENCODE   |
+                                 MFX_MEMTYPE_EXTERNAL_FRAME;
+    request->NumFrameMin       = get_async_depth(par);
+    request->NumFrameSuggested = request->NumFrameMin + 1;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_Init(mfxSession session, mfxVideoParam *par)
+{
+    MFXSWEncoder *enc;
+    mfxStatus ret;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+    if (session->enc)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    if ((ret = check_param(par)) < 0)
+        return ret;
+
+    if (!(enc = av_mallocz(sizeof(*enc))))
+        return MFX_ERR_MEMORY_ALLOC;
+
+    enc->param       = *par;
+    enc->async_depth = get_async_depth(par);
+    enc->mb_width    = par->mfx.FrameInfo.Width  / 16;
+    enc->mb_height   = par->mfx.FrameInfo.Height / 16;
+
+    if (!enc->param.mfx.FrameInfo.CropW)
+        enc->param.mfx.FrameInfo.CropW = par->mfx.FrameInfo.Width;
+    if (!enc->param.mfx.FrameInfo.CropH)
+        enc->param.mfx.FrameInfo.CropH = par->mfx.FrameInfo.Height;
+
+    enc->max_frame_size = max_frame_size(enc);
+    enc->param.mfx.BufferSizeInKB = FFMIN((enc->max_frame_size + 999) / 1000,
+                                          UINT16_MAX);
+    if (enc->param.mfx.BufferSizeInKB * 1000 < enc->max_frame_size) {
+        av_free(enc);
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    enc->rbsp_size = enc->max_frame_size;
+    if (!(enc->rbsp = av_malloc(enc->rbsp_size))) {
+        av_free(enc);
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+
+    enc->initialized = 1;
+    session->enc     = enc;
+    ff_mfxsw_add_capacity(session, enc->async_depth);
+
+    return MFX_ERR_NONE;
+}
+
+static int get_gop_size(MFXSWEncoder *enc)
+{
+    return enc->param.mfx.GopPicSize ? enc->param.mfx.GopPicSize : INT_MAX;
+}
+
+static inline const uint8_t *get_pixel(const mfxFrameSurface1 *surf,
+                                       const uint8_t *plane, int x, int y,
+                                       int w, int h)
+{
+    return plane + FFMIN(y, h - 1) * surf->Data.Pitch + FFMIN(x, w - 1);
+}
+
+/* H.264 */
+
+static void write_nal(mfxBitstream *bs, int ref_idc, int type,
+                      const uint8_t *rbsp, int size)
+{
+    uint8_t *dst = bs->Data + bs->DataOffset + bs->DataLength;
+    uint8_t *p   = dst;
+    int i, zeros = 0;
+
+    *p++ = 0;
+    *p++ = 0;
+    *p++ = 0;
+    *p++ = 1;
+    *p++ = ref_idc << 5 | type;
+
+    for (i = 0; i < size; i++) {
+        if (zeros >= 2 && rbsp[i] <= 3) {
+            *p++  = 3;
+            zeros = 0;
+        }
+        zeros = rbsp[i] ? 0 : zeros + 1;
+        *p++  = rbsp[i];
+    }
+
+    bs->DataLength += p - dst;
+}
+
+static void put_rbsp_trailing_bits(PutBitContext *pb)
+{
+    put_bits(pb, 1, 1);
+    flush_put_bits(pb);
+}
+
+static void write_h264_sps(MFXSWEncoder *enc, mfxBitstream *bs)
+{
+    mfxFrameInfo *fi = &enc->param.mfx.FrameInfo;
+    int crop_right   = (fi->Width  - fi->CropW) / 2;
+    int crop_bottom  = (fi->Height - fi->CropH) / 2;
+    int level        = enc->param.mfx.CodecLevel ? enc->param.mfx.CodecLevel :
+                       enc->mb_width * enc->mb_height > 8192 ? 51 : 40;
+    PutBitContext pb;
+
+    init_put_bits(&pb, enc->rbsp, enc->rbsp_size);
+
+    put_bits(&pb, 8, 66);       // profile_idc: Baseline
+    put_bits(&pb, 8, 0xc0);     // constraint_set0_flag, constraint_set1_flag
+    put_bits(&pb, 8, level);
+    set_ue_golomb(&pb, 0);      // seq_parameter_set_id
+    set_ue_golomb(&pb, H264_LOG2_MAX_FRAME_NUM - 4);
+    set_ue_golomb(&pb, 0);      // pic_order_cnt_type
+    set_ue_golomb(&pb, H264_LOG2_MAX_POC_LSB - 4);
+    set_ue_golomb(&pb, 1);      // max_num_ref_frames
+    put_bits(&pb, 1, 0);        // gaps_in_frame_num_value_allowed_flag
+    set_ue_golomb(&pb, enc->mb_width  - 1);
+    set_ue_golomb(&pb, enc->mb_height - 1);
+    put_bits(&pb, 1, 1);        // frame_mbs_only_flag
+    put_bits(&pb, 1, 1);        // direct_8x8_inference_flag
+    put_bits(&pb, 1, crop_right || crop_bottom);
+    if (crop_right || crop_bottom) {
+        set_ue_golomb(&pb, 0);
+        set_ue_golomb(&pb, crop_right);
+        set_ue_golomb(&pb, 0);
+        set_ue_golomb(&pb, crop_bottom);
+    }
+
+    put_bits(&pb, 1, 1);        // vui_parameters_present_flag
+    if (fi->AspectRatioW && fi->AspectRatioH) {
+        put_bits(&pb, 1, 1);
+        put_bits(&pb, 8, 255);  // Extended_SAR
+        put_bits(&pb, 16, fi->AspectRatioW);
+        put_bits(&pb, 16, fi->AspectRatioH);
+    } else {
+        put_bits(&pb, 1, 0);
+    }
+    put_bits(&pb, 1, 0);        // overscan_info_present_flag
+    put_bits(&pb, 1, 0);        // video_signal_type_present_flag
+    put_bits(&pb, 1, 0);        // chroma_loc_info_present_flag
+    if (fi->FrameRateExtN && fi->FrameRateExtD) {
+        put_bits(&pb, 1, 1);
+        put_bits32(&pb, fi->FrameRateExtD);
+        put_bits32(&pb, fi->FrameRateExtN * 2);
+        put_bits(&pb, 1, 1);    // fixed_frame_rate_flag
+    } else {
+        put_bits(&pb, 1, 0);
+    }
+    put_bits(&pb, 1, 0);        // nal_hrd_parameters_present_flag
+    put_bits(&pb, 1, 0);        // vcl_hrd_parameters_present_flag
+    put_bits(&pb, 1, 0);        // pic_struct_present_flag
+    put_bits(&pb, 1, 0);        // bitstream_restriction_flag
+
+    put_rbsp_trailing_bits(&pb);
+
+    write_nal(bs, 3, 7, enc->rbsp, put_bits_count(&pb) >> 3);
+}
+
+static void write_h264_pps(MFXSWEncoder *enc, mfxBitstream *bs)
+{
+    PutBitContext pb;
+
+    init_put_bits(&pb, enc->rbsp, enc->rbsp_size);
+
+    set_ue_golomb(&pb, 0);      // pic_parameter_set_id
+    set_ue_golomb(&pb, 0);      // seq_parameter_set_id
+    put_bits(&pb, 1, 0);        // entropy_coding_mode_flag
+    put_bits(&pb, 1, 0);        // bottom_field_pic_order_in_frame_present_flag
+    set_ue_golomb(&pb, 0);      // num_slice_groups_minus1
+    set_ue_golomb(&pb, 0);      // num_ref_idx_l0_default_active_minus1
+    set_ue_golomb(&pb, 0);      // num_ref_idx_l1_default_active_minus1
+    put_bits(&pb, 1, 0);        // weighted_pred_flag
+    put_bits(&pb, 2, 0);        // weighted_bipred_idc
+    set_se_golomb(&pb, 0);      // pic_init_qp_minus26
+    set_se_golomb(&pb, 0);      // pic_init_qs_minus26
+    set_se_golomb(&pb, 0);      // chroma_qp_index_offset
+    put_bits(&pb, 1, 0);        // deblocking_filter_control_present_flag
+    put_bits(&pb, 1, 0);        // constrained_intra_pred_flag
+    put_bits(&pb, 1, 0);        // redundant_pic_cnt_present_flag
+
+    put_rbsp_trailing_bits(&pb);
+
+    write_nal(bs, 3, 8, enc->rbsp, put_bits_count(&pb) >> 3);
+}
+
+static void put_pcm_block(PutBitContext *pb, const mfxFrameSurface1 *surf,
+                          const uint8_t *plane, int x0, int y0, int size,
+                          int step, int w, int h)
+{
+    int x, y;
+
+    for (y = 0; y < size; y++)
+        for (x = 0; x < size; x++)
+            put_bits(pb, 8, *get_pixel(surf, plane, (x0 + x) * step,
+                                       y0 + y, w * step, h));
+}
+
+static void encode_h264(MFXSWEncoder *enc, mfxFrameSurface1 *surf,
+                        mfxBitstream *bs)
+{
+    mfxFrameInfo *fi = &enc->param.mfx.FrameInfo;
+    int idr          = !enc->frame_num;
+    int w            = fi->CropW, h = fi->CropH;
+    PutBitContext pb;
+    int mb_x, mb_y;
+
+    if (idr) {
+        write_h264_sps(enc, bs);
+        write_h264_pps(enc, bs);
+    }
+
+    init_put_bits(&pb, enc->rbsp, enc->rbsp_size);
+
+    set_ue_golomb(&pb, 0);      // first_mb_in_slice
+    set_ue_golomb(&pb, 7);      // slice_type: I, all slices
+    set_ue_golomb(&pb, 0);      // pic_parameter_set_id
+    put_bits(&pb, H264_LOG2_MAX_FRAME_NUM, !idr);
+    if (idr)
+        set_ue_golomb(&pb, enc->idr_pic_id);
+    put_bits(&pb, H264_LOG2_MAX_POC_LSB,
+             (2 * enc->frame_num) & ((1 << H264_LOG2_MAX_POC_LSB) - 1));
+    if (idr) {
+        put_bits(&pb, 1, 0);    // no_output_of_prior_pics_flag
+        put_bits(&pb, 1, 0);    // long_term_reference_flag
+    }
+    set_se_golomb(&pb, 0);      // slice_qp_delta
+
+    for (mb_y = 0; mb_y < enc->mb_height; mb_y++) {
+        for (mb_x = 0; mb_x < enc->mb_width; mb_x++) {
+            set_ue_golomb(&pb, H264_MB_TYPE_I_PCM);
+            avpriv_align_put_bits(&pb);
+            put_pcm_block(&pb, surf, surf->Data.Y, mb_x * 16, mb_y * 16,
+                          16, 1, w, h);
+            put_pcm_block(&pb, surf, surf->Data.UV, mb_x * 8, mb_y * 8,
+                          8, 2, (w + 1) >> 1, (h + 1) >> 1);
+            put_pcm_block(&pb, surf, surf->Data.UV + 1, mb_x * 8, mb_y * 8,
+                          8, 2, (w + 1) >> 1, (h + 1) >> 1);
+        }
+    }
+
+    put_rbsp_trailing_bits(&pb);
+
+    write_nal(bs, idr ? 3 : 0, idr ? 5 : 1, enc->rbsp,
+              put_bits_count(&pb) >> 3);
+
+    bs->FrameType = idr ? MFX_FRAMETYPE_I | MFX_FRAMETYPE_REF | MFX_FRAMETYPE_IDR :
+                          MFX_FRAMETYPE_I;
+
+    if (idr)
+        enc->idr_pic_id = (enc->idr_pic_id + 1) & 0xffff;
+}
+
+/* MPEG-2 */
+
+static void put_start_code(PutBitContext *pb, int code)
+{
+    avpriv_align_put_bits(pb);
+    put_bits(pb, 16, 0);
+    put_bits(pb, 16, 0x100 | code);
+}
+
+static int mpeg2_frame_rate_code(mfxFrameInfo *fi)
+{
+    AVRational fps = { fi->FrameRateExtN, fi->FrameRateExtD };
+    int i, best = 4;
+
+    if (!fps.num || !fps.den)
+        return best;
+
+    for (i = 1; i < 9; i++)
+        if (av_nearer_q(fps, ff_mpeg12_frame_rate_tab[i],
+                        ff_mpeg12_frame_rate_tab[best]) > 0)
+            best = i;
+
+    return best;
+}
+
+static int mpeg2_aspect_ratio_info(mfxFrameInfo *fi)
+{
+    AVRational dar;
+
+    if (!fi->AspectRatioW || !fi->AspectRatioH ||
+        fi->AspectRatioW == fi->AspectRatioH)
+        return 1;
+
+    dar = av_mul_q((AVRational){ fi->AspectRatioW, fi->AspectRatioH },
+                   (AVRational){ fi->CropW, fi->CropH });
+
+    return av_nearer_q(dar, (AVRational){ 16, 9 }, (AVRational){ 4, 3 }) > 0 ?
+           3 : 2;
+}
+
+static void write_mpeg2_sequence(MFXSWEncoder *enc, PutBitContext *pb)
+{
+    mfxFrameInfo *fi = &enc->param.mfx.FrameInfo;
+    int level = fi->CropW <= 720  && fi->CropH <= 576  ? MFX_LEVEL_MPEG2_MAIN :
+                fi->CropW <= 1440 && fi->CropH <= 1152 ? MFX_LEVEL_MPEG2_HIGH1440 :
+                                                          MFX_LEVEL_MPEG2_HIGH;
+
+    put_start_code(pb, 0xb3);
+    put_bits(pb, 12, fi->CropW & 0xfff);
+    put_bits(pb, 12, fi->CropH & 0xfff);
+    put_bits(pb, 4, mpeg2_aspect_ratio_info(fi));
+    put_bits(pb, 4, mpeg2_frame_rate_code(fi));
+    put_bits(pb, 18, 0x3ffff);  // bit_rate_value
+    put_bits(pb, 1, 1);         // marker_bit
+    put_bits(pb, 10, 0x3ff);    // vbv_buffer_size_value
+    put_bits(pb, 1, 0);         // constrained_parameters_flag
+    put_bits(pb, 1, 0);         // load_intra_quantiser_matrix
+    put_bits(pb, 1, 0);         // load_non_intra_quantiser_matrix
+
+    put_start_code(pb, 0xb5);
+    put_bits(pb, 4, 1);         // sequence_extension
+    put_bits(pb, 8, MFX_PROFILE_MPEG2_MAIN | level);
+    put_bits(pb, 1, 1);         // progressive_sequence
+    put_bits(pb, 2, 1);         // chroma_format: 4:2:0
+    put_bits(pb, 2, fi->CropW >> 12);
+    put_bits(pb, 2, fi->CropH >> 12);
+    put_bits(pb, 12, 0xfff);    // bit_rate_extension
+    put_bits(pb, 1, 1);         // marker_bit
+    put_bits(pb, 8, 0);         // vbv_buffer_size_extension
+    put_bits(pb, 1, 1);         // low_delay
+    put_bits(pb, 2, 0);         // frame_rate_extension_n
+    put_bits(pb, 5, 0);         // frame_rate_extension_d
+
+    put_start_code(pb, 0xb8);
+    put_bits(pb, 25, 1 << 12);  // time_code with its marker_bit
+    put_bits(pb, 1, 1);         // closed_gop
+    put_bits(pb, 1, 0);         // broken_link
+}
+
+static void put_dc(PutBitContext *pb, int diff, int chroma)
+{
+    int size = diff ? av_log2(FFABS(diff)) + 1 : 0;
+
+    if (chroma)
+        put_bits(pb, ff_mpeg12_vlc_dc_chroma_bits[size],
+                 ff_mpeg12_vlc_dc_chroma_code[size]);
+    else
+        put_bits(pb, ff_mpeg12_vlc_dc_lum_bits[size],
+                 ff_mpeg12_vlc_dc_lum_code[size]);
+
+    if (size)
+        put_bits(pb, size, (diff > 0 ? diff : diff + (1 << size) - 1) &
+                           ((1 << size) - 1));
+
+    put_bits(pb, 2, 2);         // End of Block
+}
+
+static int block_dc(const mfxFrameSurface1 *surf, const uint8_t *plane,
+                    int x0, int y0, int step, int w, int h)
+{
+    int x, y, sum = 0;
+
+    for (y = 0; y < 8; y++)
+        for (x = 0; x < 8; x++)
+            sum += *get_pixel(surf, plane, (x0 + x) * step, y0 + y,
+                              w * step, h);
+
+    return (sum + 32) >> 6;
+}
+
+static void encode_mpeg2(MFXSWEncoder *enc, mfxFrameSurface1 *surf,
+                         mfxBitstream *bs)
+{
+    mfxFrameInfo *fi = &enc->param.mfx.FrameInfo;
+    int w  = fi->CropW, h = fi->CropH;
+    int cw = (w + 1) >> 1, ch = (h + 1) >> 1;
+    uint8_t *dst = bs->Data + bs->DataOffset + bs->DataLength;
+    PutBitContext pb;
+    int mb_x, mb_y, i;
+
+    init_put_bits(&pb, dst, bs->MaxLength - bs->DataOffset - bs->DataLength);
+
+    if (!enc->frame_num)
+        write_mpeg2_sequence(enc, &pb);
+
+    put_start_code(&pb, 0x00);
+    put_bits(&pb, 10, enc->frame_num & 0x3ff); // temporal_reference
+    put_bits(&pb, 3, 1);        // picture_coding_type: I
+    put_bits(&pb, 16, 0xffff);  // vbv_delay
+    put_bits(&pb, 1, 0);        // extra_bit_picture
+
+    put_start_code(&pb, 0xb5);
+    put_bits(&pb, 4, 8);        // picture_coding_extension
+    put_bits(&pb, 16, 0xffff);  // f_code[][]
+    put_bits(&pb, 2, 0);        // intra_dc_precision: 8 bits
+    put_bits(&pb, 2, 3);        // picture_structure: frame
+    put_bits(&pb, 1, 0);        // top_field_first
+    put_bits(&pb, 1, 1);        // frame_pred_frame_dct
+    put_bits(&pb, 1, 0);        // concealment_motion_vectors
+    put_bits(&pb, 1, 0);        // q_scale_type
+    put_bits(&pb, 1, 0);        // intra_vlc_format
+    put_bits(&pb, 1, 0);        // alternate_scan
+    put_bits(&pb, 1, 0);        // repeat_first_field
+    put_bits(&pb, 1, 1);        // chroma_420_type
+    put_bits(&pb, 1, 1);        // progressive_frame
+    put_bits(&pb, 1, 0);        // composite_display_flag
+
+    for (mb_y = 0; mb_y < enc->mb_height; mb_y++) {
+        int pred[3] = { 128, 128, 128 };
+
+        put_start_code(&pb, 1 + mb_y);
+        put_bits(&pb, 5, 1);    // quantiser_scale_code
+        put_bits(&pb, 1, 0);    // extra_bit_slice
+
+        for (mb_x = 0; mb_x < enc->mb_width; mb_x++) {
+            put_bits(&pb, 1, 1); // macroblock_address_increment: 1
+            put_bits(&pb, 1, 1); // macroblock_type: intra
+
+            for (i = 0; i < 4; i++) {
+                int dc = block_dc(surf, surf->Data.Y, mb_x * 16 + (i & 1) * 8,
+                                  mb_y * 16 + (i >> 1) * 8, 1, w, h);
+                put_dc(&pb, dc - pred[0], 0);
+                pred[0] = dc;
+            }
+            for (i = 0; i < 2; i++) {
+                int dc = block_dc(surf, surf->Data.UV + i, mb_x * 8, mb_y * 8,
+                                  2, cw, ch);
+                put_dc(&pb, dc - pred[1 + i], 1);
+                pred[1 + i] = dc;
+            }
+        }
+    }
+
+    flush_put_bits(&pb);
+
+    bs->DataLength += put_bits_count(&pb) >> 3;
+    bs->FrameType   = enc->frame_num ? MFX_FRAMETYPE_I :
+                      MFX_FRAMETYPE_I | MFX_FRAMETYPE_REF;
+}
+
+mfxStatus MFXVideoENCODE_EncodeFrameAsync(mfxSession session,
+                                          mfxEncodeCtrl *ctrl,
+                                          mfxFrameSurface1 *surface,
+                                          mfxBitstream *bs,
+                                          mfxSyncPoint *syncp)
+{
+    MFXSWEncoder *enc = session ? session->enc : NULL;
+    int64_t start;
+    mfxStatus ret;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!enc || !enc->initialized)
+        return MFX_ERR_NOT_INITIALIZED;
+    if (!bs || !syncp)
+        return MFX_ERR_NULL_PTR;
+
+    *syncp = NULL;
+
+    // intra-only: nothing is buffered inside the encoder
+    if (!surface)
+        return MFX_ERR_MORE_DATA;
+
+    if (!surface->Data.Y || !surface->Data.UV)
+        return MFX_ERR_NULL_PTR;
+
+    if ((ret = ff_mfxsw_submit(session)) != MFX_ERR_NONE)
+        return ret;
+
+    if (!bs->Data ||
+        bs->MaxLength - bs->DataOffset - bs->DataLength < enc->max_frame_size)
+        return MFX_ERR_NOT_ENOUGH_BUFFER;
+
+    start = av_gettime();
+
+    if (enc->frame_num >= get_gop_size(enc) ||
+        (ctrl && ctrl->FrameType & MFX_FRAMETYPE_IDR))
+        enc->frame_num = 0;
+
+    if (enc->param.mfx.CodecId == MFX_CODEC_AVC)
+        encode_h264(enc, surface, bs);
+    else
+        encode_mpeg2(enc, surface, bs);
+
+    enc->frame_num++;
+
+    bs->TimeStamp = surface->Data.TimeStamp;
+    bs->PicStruct = MFX_PICSTRUCT_PROGRESSIVE;
+
+    surface->Data.Locked++;
+    if (!(*syncp = ff_mfxsw_sync_alloc(session, MFXSW_TASK_ENCODE,
+                                       surface, start))) {
+        surface->Data.Locked--;
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+
+    ff_mfxsw_add_device_time(start);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_GetVideoParam(mfxSession session, mfxVideoParam *par)
+{
+    MFXSWEncoder *enc = session ? session->enc : NULL;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+    if (!enc)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    par->AsyncDepth = enc->param.AsyncDepth;
+    par->IOPattern  = enc->param.IOPattern;
+    par->mfx        = enc->param.mfx;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_Reset(mfxSession session, mfxVideoParam *par)
+{
+    MFXSWEncoder *enc = session ? session->enc : NULL;
+    mfxStatus ret;
+
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+    if (!enc)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    ff_mfxsw_enc_close(session);
+
+    if ((ret = MFXVideoENCODE_Init(session, par)) < 0)
+        return ret;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus MFXVideoENCODE_Close(mfxSession session)
+{
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!session->enc)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    ff_mfxsw_enc_close(session);
+
+    return MFX_ERR_NONE;
+}
+
+void ff_mfxsw_enc_close(mfxSession session)
+{
+    MFXSWEncoder *enc = session->enc;
+
+    if (!enc)
+        return;
+
+    ff_mfxsw_sync_cancel(session, MFXSW_TASK_ENCODE);
+
+    ff_mfxsw_add_capacity(session, -enc->async_depth);
+
+    av_freep(&enc->rbsp);
+    av_freep(&session->enc);
+}
@@ -0,0 +1,117 @@
+/*
+ * Software MFX stand-in: internal definitions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef COMPAT_MFX_MFXSW_INTERNAL_H
+#define COMPAT_MFX_MFXSW_INTERNAL_H
+
+#include <stdint.h>
+
+#include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "mfx/mfxvideo.h"
+
+typedef struct MFXSWDecoder MFXSWDecoder;
+typedef struct MFXSWEncoder MFXSWEncoder;
+
+enum MFXSWTaskOwner {
+    MFXSW_TASK_DECODE,
+    MFXSW_TASK_ENCODE,
+};
+
+/**
+ * Emulated device scheduler. Sessions joined with MFXJoinSession() share
+ * the scheduler of their parent, so AsyncDepth and busy reporting apply to
+ * the whole join group as they do on real hardware. Joined sessions are
+ * usually driven from different threads, so the counters are protected by
+ * lock.
+ */
+typedef struct MFXSWScheduler {
+#if HAVE_PTHREADS
+    pthread_mutex_t lock;
+#endif
+    int refs;
+    int in_flight;              ///< submitted tasks not yet synchronized
+    int capacity;               ///< sum of AsyncDepth of the initialized components
+    unsigned submitted;
+    int64_t latency;            ///< per-task completion latency in us
+    unsigned busy_interval;     ///< report busy on every Nth submission
+    int surface_hold;           ///< decoded surfaces kept as references
+} MFXSWScheduler;
+
+struct _mfxSyncPoint {
+    struct _mfxSyncPoint *next;     ///< all sync points of the session
+    struct _mfxSyncPoint *next_free;
+    int pending;
+    enum MFXSWTaskOwner owner;
+    int64_t ready;                  ///< av_gettime() at task completion
+    mfxFrameSurface1 *surface;      ///< unlocked on completion
+};
+
+struct _mfxSession {
+    mfxIMPL impl;
+    mfxVersion version;
+    MFXSWScheduler *sched;
+    MFXSWScheduler sched_mem;
+    struct _mfxSession *parent;
+    int nb_children;
+    struct _mfxSyncPoint *syncs;
+    struct _mfxSyncPoint *free_syncs;
+    MFXSWDecoder *dec;
+    MFXSWEncoder *enc;
+};
+
+/**
+ * Check whether the device accepts a new task.
+ *
+ * @return MFX_ERR_NONE or MFX_WRN_DEVICE_BUSY
+ */
+mfxStatus ff_mfxsw_submit(mfxSession session);
+
+/**
+ * Add the AsyncDepth of a component to the device capacity on Init(),
+ * or remove it (with a negative delta) on Close().
+ */
+void ff_mfxsw_add_capacity(mfxSession session, int delta);
+
+/**
+ * Create the sync point of a task submitted with ff_mfxsw_submit().
+ * The task completes after the configured latency counted from start.
+ */
+mfxSyncPoint ff_mfxsw_sync_alloc(mfxSession session, enum MFXSWTaskOwner owner,
+                                 mfxFrameSurface1 *surface, int64_t start);
+
+/**
+ * Drop all pending tasks of the given owner, e.g. on Reset() or Close().
+ * Surfaces referenced by them are not touched.
+ */
+void ff_mfxsw_sync_cancel(mfxSession session, enum MFXSWTaskOwner owner);
+
+/**
+ * Account time spent emulating the device.
+ */
+void ff_mfxsw_add_device_time(int64_t start);
+
+void ff_mfxsw_dec_close(mfxSession session);
+void ff_mfxsw_enc_close(mfxSession session);
+
+#endif /* COMPAT_MFX_MFXSW_INTERNAL_H */
@@ -56,6 +56,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/timestamp.h"
 #include "libavutil/bprint.h"
+#include "libavutil/internal.h"
 #include "libavutil/time.h"
 #include "libavformat/os_support.h"
 
@@ -121,13 +122,9 @@ static int64_t getutime(void);
 static int64_t getmaxrss(void);
 
 static int run_as_daemon  = 0;
-static int64_t video_size = 0;
-static int64_t audio_size = 0;
-static int64_t subtitle_size = 0;
 static int64_t extra_size = 0;
 static int nb_frames_dup = 0;
 static int nb_frames_drop = 0;
-static int64_t decode_error_stat[2];
 
 static int current_time;
 AVIOContext *progress_avio = NULL;
@@ -137,6 +134,9 @@ static uint8_t *subtitle_out;
 #if HAVE_PTHREADS
 /* signal to input threads that they should exit; set by the main thread */
 static int transcoding_finished;
+
+/* muxer thread of the -pipeline mode, NULL when it is not used */
+static PipelineStage *mux_stage;
 #endif
 
 #define DEFAULT_PASS_LOGFILENAME_PREFIX "ffmpeg2pass"
@@ -162,6 +162,19 @@ static int restore_tty;
 #endif
 
 static void free_input_threads(void);
+#if HAVE_PTHREADS
+static int pipeline_submit_frame(OutputStream *ost, AVFrame *frame);
+static int pipeline_submit_packet(OutputStream *ost, AVPacket *pkt);
+static int pipeline_submit_decoded(InputStream *ist, AVFrame *frame, int reinit);
+static int pipeline_submit_input(InputStream *ist, AVPacket *pkt);
+static void pipeline_finish_decoder(InputStream *ist);
+static void pipeline_decoder_state(InputStream *ist, int64_t pkt_dts, int sync,
+                                   int64_t *next_dts, int64_t *next_pts, int64_t *pts);
+static int pipeline_ts_jump(InputStream *ist, const AVPacket *pkt,
+                            int64_t next_dts, int64_t last_pts);
+static void print_pipeline_stats(AVBPrint *buf_script, int64_t cur_time);
+static void free_pipeline(void);
+#endif
 
 
 /* sub2video hack:
@@ -430,6 +443,10 @@ static void ffmpeg_cleanup(int ret)
         printf("bench: maxrss=%ikB\n", maxrss);
     }
 
+#if HAVE_PTHREADS
+    free_pipeline();
+#endif
+
     for (i = 0; i < nb_filtergraphs; i++) {
         avfilter_graph_free(&filtergraphs[i]->graph);
         for (j = 0; j < filtergraphs[i]->nb_inputs; j++) {
@@ -542,31 +559,12 @@ static void update_benchmark(const char *fmt, ...)
     }
 }
 
-static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
+static void mux_packet(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
 {
     AVBitStreamFilterContext *bsfc = ost->bitstream_filters;
     AVCodecContext          *avctx = ost->st->codec;
     int ret;
 
-    if ((avctx->codec_type == AVMEDIA_TYPE_VIDEO && video_sync_method == VSYNC_DROP) ||
-        (avctx->codec_type == AVMEDIA_TYPE_AUDIO && audio_sync_method < 0))
-        pkt->pts = pkt->dts = AV_NOPTS_VALUE;
-
-    /*
-     * Audio encoders may split the packets --  #frames in != #packets out.
-     * But there is no reordering, so we can limit the number of output packets
-     * by simply dropping them here.
-     * Counting encoded video frames needs to be done separately because of
-     * reordering, see do_video_out()
-     */
-    if (!(avctx->codec_type == AVMEDIA_TYPE_VIDEO && avctx->codec)) {
-        if (ost->frame_number >= ost->max_frames) {
-            av_free_packet(pkt);
-            return;
-        }
-        ost->frame_number++;
-    }
-
     while (bsfc) {
         AVPacket new_pkt = *pkt;
         int a = av_bitstream_filter_filter(bsfc, avctx, NULL,
@@ -646,6 +644,55 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
     }
 }
 
+/* Send a packet to the muxer, directly or through the muxer thread in
+ * -pipeline mode. */
+static int write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
+{
+    AVCodecContext *avctx = ost->st->codec;
+
+    if ((avctx->codec_type == AVMEDIA_TYPE_VIDEO && video_sync_method == VSYNC_DROP) ||
+        (avctx->codec_type == AVMEDIA_TYPE_AUDIO && audio_sync_method < 0))
+        pkt->pts = pkt->dts = AV_NOPTS_VALUE;
+
+    /*
+     * Audio encoders may split the packets --  #frames in != #packets out.
+     * But there is no reordering, so we can limit the number of output packets
+     * by simply dropping them here.
+     * Counting encoded video frames needs to be done separately because of
+     * reordering, see do_video_out()
+     */
+    if (!(avctx->codec_type == AVMEDIA_TYPE_VIDEO && avctx->codec)) {
+        if (ost->frame_number >= ost->max_frames) {
+            av_free_packet(pkt);
+            return 0;
+        }
+        ost->frame_number++;
+    }
+
+#if HAVE_PTHREADS
+    if (mux_stage)
+        return pipeline_submit_packet(ost, pkt);
+#endif
+    mux_packet(s, pkt, ost);
+    return 0;
+}
+
+/* Return the number of bytes written to an output file so far. */
+static int64_t output_file_tell(OutputFile *of)
+{
+#if HAVE_PTHREADS
+    /* the muxer thread owns the AVIOContext while it runs */
+    if (mux_stage && !mux_stage->joined) {
+        int64_t size;
+        pthread_mutex_lock(&mux_stage->lock);
+        size = of->muxed_size;
+        pthread_mutex_unlock(&mux_stage->lock);
+        return size;
+    }
+#endif
+    return avio_tell(of->ctx->pb);
+}
+
 static void close_output_stream(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
@@ -670,29 +717,22 @@ static int check_recording_time(OutputStream *ost)
     return 1;
 }
 
-static void do_audio_out(AVFormatContext *s, OutputStream *ost,
-                         AVFrame *frame)
+static int encode_audio_frame(OutputStream *ost, AVFrame *frame)
 {
+    AVFormatContext *s = output_files[ost->file_index]->ctx;
     AVCodecContext *enc = ost->st->codec;
     AVPacket pkt;
-    int got_packet = 0;
+    int got_packet = 0, ret = 0;
 
     av_init_packet(&pkt);
     pkt.data = NULL;
     pkt.size = 0;
 
-    if (!check_recording_time(ost))
-        return;
-
-    if (frame->pts == AV_NOPTS_VALUE || audio_sync_method < 0)
-        frame->pts = ost->sync_opts;
-    ost->sync_opts = frame->pts + frame->nb_samples;
-
     av_assert0(pkt.size || !pkt.data);
     update_benchmark(NULL);
     if (avcodec_encode_audio2(enc, &pkt, frame, &got_packet) < 0) {
         av_log(NULL, AV_LOG_FATAL, "Audio encoding failed (avcodec_encode_audio2)\n");
-        exit_program(1);
+        return AVERROR_EXTERNAL;
     }
     update_benchmark("encode_audio %d.%d", ost->file_index, ost->index);
 
@@ -711,11 +751,34 @@ static void do_audio_out(AVFormatContext *s, OutputStream *ost,
                    av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ost->st->time_base));
         }
 
-        audio_size += pkt.size;
-        write_frame(s, &pkt, ost);
+        ost->data_size += pkt.size;
+        ret = write_frame(s, &pkt, ost);
 
         av_free_packet(&pkt);
     }
+    return ret;
+}
+
+static void do_audio_out(AVFormatContext *s, OutputStream *ost,
+                         AVFrame *frame)
+{
+    int ret;
+
+    if (!check_recording_time(ost))
+        return;
+
+    if (frame->pts == AV_NOPTS_VALUE || audio_sync_method < 0)
+        frame->pts = ost->sync_opts;
+    ost->sync_opts = frame->pts + frame->nb_samples;
+
+#if HAVE_PTHREADS
+    if (ost->enc_stage)
+        ret = pipeline_submit_frame(ost, frame);
+    else
+#endif
+        ret = encode_audio_frame(ost, frame);
+    if (ret < 0)
+        exit_program(1);
 }
 
 static void do_subtitle_out(AVFormatContext *s,
@@ -786,9 +849,75 @@ static void do_subtitle_out(AVFormatContext *s,
             else
                 pkt.pts += 90 * sub->end_display_time;
         }
-        subtitle_size += pkt.size;
-        write_frame(s, &pkt, ost);
+        ost->data_size += pkt.size;
+        if (write_frame(s, &pkt, ost) < 0)
+            exit_program(1);
+    }
+}
+
+/* Encode one video frame and send the resulting packet, if any, to the muxer.
+ * Returns the size of that packet or a negative error code. */
+static int encode_video_frame(OutputStream *ost, AVFrame *in_picture)
+{
+    AVFormatContext *s = output_files[ost->file_index]->ctx;
+    AVCodecContext *enc = ost->st->codec;
+    AVPacket pkt;
+    int got_packet, ret, frame_size = 0;
+
+    av_init_packet(&pkt);
+    pkt.data = NULL;
+    pkt.size = 0;
+
+    /* set here rather than when the frame leaves the filters, as the frames
+     * queued for an encoder thread still need the aspect of their own */
+    if (!ost->frame_aspect_ratio.num)
+        enc->sample_aspect_ratio = in_picture->sample_aspect_ratio;
+
+    if (in_picture->interlaced_frame) {
+        if (enc->codec->id == AV_CODEC_ID_MJPEG)
+            enc->field_order = in_picture->top_field_first ? AV_FIELD_TT:AV_FIELD_BB;
+        else
+            enc->field_order = in_picture->top_field_first ? AV_FIELD_TB:AV_FIELD_BT;
+    } else
+        enc->field_order = AV_FIELD_PROGRESSIVE;
+
+    update_benchmark(NULL);
+    ret = avcodec_encode_video2(enc, &pkt, in_picture, &got_packet);
+    update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "Video encoding failed\n");
+        return ret;
+    }
+
+    if (got_packet) {
+        if (pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & CODEC_CAP_DELAY))
+            pkt.pts = in_picture->pts;
+
+        if (pkt.pts != AV_NOPTS_VALUE)
+            pkt.pts = av_rescale_q(pkt.pts, enc->time_base, ost->st->time_base);
+        if (pkt.dts != AV_NOPTS_VALUE)
+            pkt.dts = av_rescale_q(pkt.dts, enc->time_base, ost->st->time_base);
+
+        if (debug_ts) {
+            av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
+                "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
+                av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &ost->st->time_base),
+                av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ost->st->time_base));
+        }
+
+        frame_size = pkt.size;
+        ost->data_size += pkt.size;
+        ret = write_frame(s, &pkt, ost);
+        av_free_packet(&pkt);
+        if (ret < 0)
+            return ret;
+
+        /* if two pass, output log */
+        if (ost->logfile && enc->stats_out) {
+            fprintf(ost->logfile, "%s", enc->stats_out);
+        }
     }
+    return frame_size;
 }
 
 static void do_video_out(AVFormatContext *s,
@@ -877,6 +1006,8 @@ static void do_video_out(AVFormatContext *s,
         /* raw pictures are written as AVPicture structure to
            avoid any copies. We support temporarily the older
            method. */
+        if (!ost->frame_aspect_ratio.num)
+            enc->sample_aspect_ratio = in_picture->sample_aspect_ratio;
         enc->coded_frame->interlaced_frame = in_picture->interlaced_frame;
         enc->coded_frame->top_field_first  = in_picture->top_field_first;
         if (enc->coded_frame->interlaced_frame)
@@ -888,24 +1019,17 @@ static void do_video_out(AVFormatContext *s,
         pkt.pts    = av_rescale_q(in_picture->pts, enc->time_base, ost->st->time_base);
         pkt.flags |= AV_PKT_FLAG_KEY;
 
-        video_size += pkt.size;
-        write_frame(s, &pkt, ost);
+        ost->data_size += pkt.size;
+        if (write_frame(s, &pkt, ost) < 0)
+            exit_program(1);
     } else {
-        int got_packet, forced_keyframe = 0;
+        int forced_keyframe = 0;
         double pts_time;
 
         if (ost->st->codec->flags & (CODEC_FLAG_INTERLACED_DCT|CODEC_FLAG_INTERLACED_ME) &&
             ost->top_field_first >= 0)
             in_picture->top_field_first = !!ost->top_field_first;
 
-        if (in_picture->interlaced_frame) {
-            if (enc->codec->id == AV_CODEC_ID_MJPEG)
-                enc->field_order = in_picture->top_field_first ? AV_FIELD_TT:AV_FIELD_BB;
-            else
-                enc->field_order = in_picture->top_field_first ? AV_FIELD_TB:AV_FIELD_BT;
-        } else
-            enc->field_order = AV_FIELD_PROGRESSIVE;
-
         in_picture->quality = ost->st->codec->global_quality;
         if (!enc->me_threshold)
             in_picture->pict_type = 0;
@@ -944,40 +1068,16 @@ static void do_video_out(AVFormatContext *s,
             av_log(NULL, AV_LOG_DEBUG, "Forced keyframe at time %f\n", pts_time);
         }
 
-        update_benchmark(NULL);
-        ret = avcodec_encode_video2(enc, &pkt, in_picture, &got_packet);
-        update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
-        if (ret < 0) {
-            av_log(NULL, AV_LOG_FATAL, "Video encoding failed\n");
+#if HAVE_PTHREADS
+        if (ost->enc_stage)
+            ret = pipeline_submit_frame(ost, in_picture);
+        else
+#endif
+            ret = encode_video_frame(ost, in_picture);
+        if (ret < 0)
             exit_program(1);
-        }
-
-        if (got_packet) {
-            if (pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & CODEC_CAP_DELAY))
-                pkt.pts = ost->sync_opts;
-
-            if (pkt.pts != AV_NOPTS_VALUE)
-                pkt.pts = av_rescale_q(pkt.pts, enc->time_base, ost->st->time_base);
-            if (pkt.dts != AV_NOPTS_VALUE)
-                pkt.dts = av_rescale_q(pkt.dts, enc->time_base, ost->st->time_base);
-
-            if (debug_ts) {
-                av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
-                    "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
-                    av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &ost->st->time_base),
-                    av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ost->st->time_base));
-            }
-
-            frame_size = pkt.size;
-            video_size += pkt.size;
-            write_frame(s, &pkt, ost);
-            av_free_packet(&pkt);
-
-            /* if two pass, output log */
-            if (ost->logfile && enc->stats_out) {
-                fprintf(ost->logfile, "%s", enc->stats_out);
-            }
-        }
+        if (ret > 0)
+            frame_size = ret;
     }
     ost->sync_opts++;
     /*
@@ -1026,9 +1126,9 @@ static void do_video_stats(OutputStream *ost, int frame_size)
             ti1 = 0.01;
 
         bitrate     = (frame_size * 8) / av_q2d(enc->time_base) / 1000.0;
-        avg_bitrate = (double)(video_size * 8) / ti1 / 1000.0;
+        avg_bitrate = (double)(ost->data_size * 8) / ti1 / 1000.0;
         fprintf(vstats_file, "s_size= %8.0fkB time= %0.3f br= %7.1fkbits/s avg_br= %7.1fkbits/s ",
-               (double)video_size / 1024, ti1, bitrate, avg_bitrate);
+               (double)ost->data_size / 1024, ti1, bitrate, avg_bitrate);
         fprintf(vstats_file, "type= %c\n", av_get_picture_type_char(enc->coded_frame->pict_type));
     }
 }
@@ -1087,9 +1187,6 @@ static int reap_filters(void)
             switch (ost->filter->filter->inputs[0]->type) {
             case AVMEDIA_TYPE_VIDEO:
                 filtered_frame->pts = frame_pts;
-                if (!ost->frame_aspect_ratio.num)
-                    ost->st->codec->sample_aspect_ratio = filtered_frame->sample_aspect_ratio;
-
                 do_video_out(of->ctx, ost, filtered_frame);
                 break;
             case AVMEDIA_TYPE_AUDIO:
@@ -1145,9 +1242,16 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 
     oc = output_files[0]->ctx;
 
-    total_size = avio_size(oc->pb);
-    if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
-        total_size = avio_tell(oc->pb);
+#if HAVE_PTHREADS
+    if (mux_stage && !mux_stage->joined)
+        total_size = output_file_tell(output_files[0]);
+    else
+#endif
+    {
+        total_size = avio_size(oc->pb);
+        if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
+            total_size = avio_tell(oc->pb);
+    }
 
     buf[0] = '\0';
     vid = 0;
@@ -1252,6 +1356,9 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                 nb_frames_dup, nb_frames_drop);
     av_bprintf(&buf_script, "dup_frames=%d\n", nb_frames_dup);
     av_bprintf(&buf_script, "drop_frames=%d\n", nb_frames_drop);
+#if HAVE_PTHREADS
+    print_pipeline_stats(&buf_script, cur_time);
+#endif
 
     if (print_stats || is_last_report) {
         if (print_stats==1 && AV_LOG_INFO > av_log_get_level()) {
@@ -1276,7 +1383,19 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     }
 
     if (is_last_report) {
-        int64_t raw= audio_size + video_size + subtitle_size + extra_size;
+        int64_t video_size = 0, audio_size = 0, subtitle_size = 0, raw;
+
+        for (i = 0; i < nb_output_streams; i++) {
+            ost = output_streams[i];
+            switch (ost->st->codec->codec_type) {
+            case AVMEDIA_TYPE_VIDEO:    video_size    += ost->data_size; break;
+            case AVMEDIA_TYPE_AUDIO:    audio_size    += ost->data_size; break;
+            case AVMEDIA_TYPE_SUBTITLE: subtitle_size += ost->data_size; break;
+            default:                                                     break;
+            }
+        }
+        raw = audio_size + video_size + subtitle_size + extra_size;
+
         av_log(NULL, AV_LOG_INFO, "\n");
         av_log(NULL, AV_LOG_INFO, "video:%1.0fkB audio:%1.0fkB subtitle:%1.0f global headers:%1.0fkB muxing overhead %f%%\n",
                video_size / 1024.0,
@@ -1285,87 +1404,101 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                extra_size / 1024.0,
                100.0 * (total_size - raw) / raw
         );
+#if HAVE_PTHREADS
+        print_pipeline_stats(NULL, cur_time);
+#endif
         if(video_size + audio_size + subtitle_size + extra_size == 0){
             av_log(NULL, AV_LOG_WARNING, "Output file is empty, nothing was encoded (check -ss / -t / -frames parameters if used)\n");
         }
     }
 }
 
-static void flush_encoders(void)
+static int flush_encoder(OutputStream *ost)
 {
-    int i, ret;
+    AVCodecContext *enc = ost->st->codec;
+    AVFormatContext *os = output_files[ost->file_index]->ctx;
+    int stop_encoding = 0;
+    int ret;
 
-    for (i = 0; i < nb_output_streams; i++) {
-        OutputStream   *ost = output_streams[i];
-        AVCodecContext *enc = ost->st->codec;
-        AVFormatContext *os = output_files[ost->file_index]->ctx;
-        int stop_encoding = 0;
+    if (ost->st->codec->codec_type == AVMEDIA_TYPE_AUDIO && enc->frame_size <= 1)
+        return 0;
+    if (ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO && (os->oformat->flags & AVFMT_RAWPICTURE) && enc->codec->id == AV_CODEC_ID_RAWVIDEO)
+        return 0;
 
-        if (!ost->encoding_needed)
-            continue;
+    for (;;) {
+        int (*encode)(AVCodecContext*, AVPacket*, const AVFrame*, int*) = NULL;
+        const char *desc;
 
-        if (ost->st->codec->codec_type == AVMEDIA_TYPE_AUDIO && enc->frame_size <= 1)
-            continue;
-        if (ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO && (os->oformat->flags & AVFMT_RAWPICTURE) && enc->codec->id == AV_CODEC_ID_RAWVIDEO)
-            continue;
+        switch (ost->st->codec->codec_type) {
+        case AVMEDIA_TYPE_AUDIO:
+            encode = avcodec_encode_audio2;
+            desc   = "Audio";
+            break;
+        case AVMEDIA_TYPE_VIDEO:
+            encode = avcodec_encode_video2;
+            desc   = "Video";
+            break;
+        default:
+            stop_encoding = 1;
+        }
 
-        for (;;) {
-            int (*encode)(AVCodecContext*, AVPacket*, const AVFrame*, int*) = NULL;
-            const char *desc;
-            int64_t *size;
+        if (encode) {
+            AVPacket pkt;
+            int got_packet;
+            av_init_packet(&pkt);
+            pkt.data = NULL;
+            pkt.size = 0;
 
-            switch (ost->st->codec->codec_type) {
-            case AVMEDIA_TYPE_AUDIO:
-                encode = avcodec_encode_audio2;
-                desc   = "Audio";
-                size   = &audio_size;
-                break;
-            case AVMEDIA_TYPE_VIDEO:
-                encode = avcodec_encode_video2;
-                desc   = "Video";
-                size   = &video_size;
-                break;
-            default:
-                stop_encoding = 1;
+            update_benchmark(NULL);
+            ret = encode(enc, &pkt, NULL, &got_packet);
+            update_benchmark("flush %s %d.%d", desc, ost->file_index, ost->index);
+            if (ret < 0) {
+                av_log(NULL, AV_LOG_FATAL, "%s encoding failed\n", desc);
+                return ret;
             }
-
-            if (encode) {
-                AVPacket pkt;
-                int got_packet;
-                av_init_packet(&pkt);
-                pkt.data = NULL;
-                pkt.size = 0;
-
-                update_benchmark(NULL);
-                ret = encode(enc, &pkt, NULL, &got_packet);
-                update_benchmark("flush %s %d.%d", desc, ost->file_index, ost->index);
-                if (ret < 0) {
-                    av_log(NULL, AV_LOG_FATAL, "%s encoding failed\n", desc);
-                    exit_program(1);
-                }
-                *size += pkt.size;
-                if (ost->logfile && enc->stats_out) {
-                    fprintf(ost->logfile, "%s", enc->stats_out);
-                }
-                if (!got_packet) {
-                    stop_encoding = 1;
-                    break;
-                }
-                if (pkt.pts != AV_NOPTS_VALUE)
-                    pkt.pts = av_rescale_q(pkt.pts, enc->time_base, ost->st->time_base);
-                if (pkt.dts != AV_NOPTS_VALUE)
-                    pkt.dts = av_rescale_q(pkt.dts, enc->time_base, ost->st->time_base);
-                if (pkt.duration > 0)
-                    pkt.duration = av_rescale_q(pkt.duration, enc->time_base, ost->st->time_base);
-                write_frame(os, &pkt, ost);
-                if (ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename) {
-                    do_video_stats(ost, pkt.size);
-                }
+            ost->data_size += pkt.size;
+            if (ost->logfile && enc->stats_out) {
+                fprintf(ost->logfile, "%s", enc->stats_out);
             }
-
-            if (stop_encoding)
+            if (!got_packet) {
+                stop_encoding = 1;
                 break;
+            }
+            if (pkt.pts != AV_NOPTS_VALUE)
+                pkt.pts = av_rescale_q(pkt.pts, enc->time_base, ost->st->time_base);
+            if (pkt.dts != AV_NOPTS_VALUE)
+                pkt.dts = av_rescale_q(pkt.dts, enc->time_base, ost->st->time_base);
+            if (pkt.duration > 0)
+                pkt.duration = av_rescale_q(pkt.duration, enc->time_base, ost->st->time_base);
+            if ((ret = write_frame(os, &pkt, ost)) < 0)
+                return ret;
+            if (ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename) {
+                do_video_stats(ost, pkt.size);
+            }
         }
+
+        if (stop_encoding)
+            break;
+    }
+    return 0;
+}
+
+static void flush_encoders(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (!ost->encoding_needed)
+            continue;
+#if HAVE_PTHREADS
+        /* the encoder thread flushes its encoder once its queue is drained */
+        if (ost->enc_stage)
+            continue;
+#endif
+        if (flush_encoder(ost) < 0)
+            exit_program(1);
     }
 }
 
@@ -1429,14 +1562,9 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
     }
 
     /* force the input stream PTS */
-    if (ost->st->codec->codec_type == AVMEDIA_TYPE_AUDIO)
-        audio_size += pkt->size;
-    else if (ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-        video_size += pkt->size;
+    if (ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO)
         ost->sync_opts++;
-    } else if (ost->st->codec->codec_type == AVMEDIA_TYPE_SUBTITLE) {
-        subtitle_size += pkt->size;
-    }
+    ost->data_size += pkt->size;
 
     if (pkt->pts != AV_NOPTS_VALUE)
         opkt.pts = av_rescale_q(pkt->pts, ist->st->time_base, ost->st->time_base) - ost_tb_start_time;
@@ -1485,7 +1613,8 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
         opkt.flags |= AV_PKT_FLAG_KEY;
     }
 
-    write_frame(of->ctx, &opkt, ost);
+    if (write_frame(of->ctx, &opkt, ost) < 0)
+        exit_program(1);
     ost->st->codec->frame_number++;
 }
 
@@ -1509,40 +1638,155 @@ int guess_input_channel_layout(InputStream *ist)
     return 1;
 }
 
-static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
+/* Reconfigure the filtergraphs fed by ist if the audio parameters changed
+ * and push a decoded frame into them. */
+static int filter_audio_frame(InputStream *ist, AVFrame *decoded_frame, int reinit)
 {
-    AVFrame *decoded_frame, *f;
-    AVCodecContext *avctx = ist->st->codec;
-    int i, ret, err = 0, resample_changed;
-    AVRational decoded_frame_tb;
-
-    if (!ist->decoded_frame && !(ist->decoded_frame = avcodec_alloc_frame()))
-        return AVERROR(ENOMEM);
-    if (!ist->filter_frame && !(ist->filter_frame = av_frame_alloc()))
-        return AVERROR(ENOMEM);
-    decoded_frame = ist->decoded_frame;
+    AVFrame *f;
+    int i, err = 0;
 
-    update_benchmark(NULL);
-    ret = avcodec_decode_audio4(avctx, decoded_frame, got_output, pkt);
-    update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
+    if (reinit) {
+        for (i = 0; i < nb_filtergraphs; i++)
+            if (ist_in_filtergraph(filtergraphs[i], ist)) {
+                FilterGraph *fg = filtergraphs[i];
+                int j;
+                if (configure_filtergraph(fg) < 0) {
+                    av_log(NULL, AV_LOG_FATAL, "Error reinitializing filters!\n");
+                    exit_program(1);
+                }
+                for (j = 0; j < fg->nb_outputs; j++) {
+                    OutputStream *ost = fg->outputs[j]->ost;
+                    if (ost->enc->type == AVMEDIA_TYPE_AUDIO &&
+                        !(ost->enc->capabilities & CODEC_CAP_VARIABLE_FRAME_SIZE))
+                        av_buffersink_set_frame_size(ost->filter->filter,
+                                                     ost->st->codec->frame_size);
+                }
+            }
+    }
 
-    if (ret >= 0 && avctx->sample_rate <= 0) {
-        av_log(avctx, AV_LOG_ERROR, "Sample rate %d invalid\n", avctx->sample_rate);
-        ret = AVERROR_INVALIDDATA;
+    for (i = 0; i < ist->nb_filters; i++) {
+        if (i < ist->nb_filters - 1) {
+            f = ist->filter_frame;
+            err = av_frame_ref(f, decoded_frame);
+            if (err < 0)
+                break;
+        } else
+            f = decoded_frame;
+        err = av_buffersrc_add_frame_flags(ist->filters[i]->filter, f,
+                                     AV_BUFFERSRC_FLAG_PUSH);
+        if (err == AVERROR_EOF)
+            err = 0; /* ignore */
+        if (err < 0)
+            break;
     }
 
-    if (*got_output || ret<0 || pkt->size)
-        decode_error_stat[ret<0] ++;
+    av_frame_unref(ist->filter_frame);
+    return err;
+}
 
-    if (!*got_output || ret < 0) {
-        if (!pkt->size) {
-            for (i = 0; i < ist->nb_filters; i++)
+/* Same as filter_audio_frame() for video. */
+static int filter_video_frame(InputStream *ist, AVFrame *decoded_frame, int reinit)
+{
+    AVFrame *f;
+    AVRational *frame_sample_aspect;
+    int i, ret, err = 0;
+
+    if (reinit) {
+        for (i = 0; i < nb_filtergraphs; i++) {
+            if (ist_in_filtergraph(filtergraphs[i], ist) && ist->reinit_filters &&
+                configure_filtergraph(filtergraphs[i]) < 0) {
+                av_log(NULL, AV_LOG_FATAL, "Error reinitializing filters!\n");
+                exit_program(1);
+            }
+        }
+    }
+
+    frame_sample_aspect= av_opt_ptr(avcodec_get_frame_class(), decoded_frame, "sample_aspect_ratio");
+    for (i = 0; i < ist->nb_filters; i++) {
+        if (!frame_sample_aspect->num)
+            *frame_sample_aspect = ist->st->sample_aspect_ratio;
+
+        if (i < ist->nb_filters - 1) {
+            f = ist->filter_frame;
+            err = av_frame_ref(f, decoded_frame);
+            if (err < 0)
+                break;
+        } else
+            f = decoded_frame;
+        ret = av_buffersrc_add_frame_flags(ist->filters[i]->filter, f, AV_BUFFERSRC_FLAG_PUSH);
+        if (ret == AVERROR_EOF) {
+            ret = 0; /* ignore */
+        } else if (ret < 0) {
+            av_log(NULL, AV_LOG_FATAL,
+                   "Failed to inject frame into filter network: %s\n", av_err2str(ret));
+            exit_program(1);
+        }
+    }
+
+    av_frame_unref(ist->filter_frame);
+    return err;
+}
+
+/* Pass a decoded frame, or EOF if frame is NULL, on to the filters of ist.
+ * reinit is set if the frame parameters differ from the previous frame. */
+static int filter_decoded_frame(InputStream *ist, AVFrame *frame, int reinit)
+{
+    int i;
+
+    if (!frame) {
+        for (i = 0; i < ist->nb_filters; i++)
 #if 1
-                av_buffersrc_add_ref(ist->filters[i]->filter, NULL, 0);
+            av_buffersrc_add_ref(ist->filters[i]->filter, NULL, 0);
 #else
-                av_buffersrc_add_frame(ist->filters[i]->filter, NULL);
+            av_buffersrc_add_frame(ist->filters[i]->filter, NULL);
 #endif
-        }
+        return 0;
+    }
+
+    if (ist->st->codec->codec_type == AVMEDIA_TYPE_AUDIO)
+        return filter_audio_frame(ist, frame, reinit);
+    return filter_video_frame(ist, frame, reinit);
+}
+
+/* Called by the decoder: filter the frame right away or, with -pipeline,
+ * hand it over to the main thread. */
+static int send_decoded_frame(InputStream *ist, AVFrame *frame, int reinit)
+{
+#if HAVE_PTHREADS
+    if (ist->dec_stage)
+        return pipeline_submit_decoded(ist, frame, reinit);
+#endif
+    return filter_decoded_frame(ist, frame, reinit);
+}
+
+static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
+{
+    AVFrame *decoded_frame;
+    AVCodecContext *avctx = ist->st->codec;
+    int ret, err = 0, resample_changed;
+    AVRational decoded_frame_tb;
+
+    if (!ist->decoded_frame && !(ist->decoded_frame = avcodec_alloc_frame()))
+        return AVERROR(ENOMEM);
+    if (!ist->filter_frame && !(ist->filter_frame = av_frame_alloc()))
+        return AVERROR(ENOMEM);
+    decoded_frame = ist->decoded_frame;
+
+    update_benchmark(NULL);
+    ret = avcodec_decode_audio4(avctx, decoded_frame, got_output, pkt);
+    update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
+
+    if (ret >= 0 && avctx->sample_rate <= 0) {
+        av_log(avctx, AV_LOG_ERROR, "Sample rate %d invalid\n", avctx->sample_rate);
+        ret = AVERROR_INVALIDDATA;
+    }
+
+    if (*got_output || ret<0 || pkt->size)
+        ist->decode_error_stat[ret<0] ++;
+
+    if (!*got_output || ret < 0) {
+        if (!pkt->size)
+            send_decoded_frame(ist, NULL, 0);
         return ret;
     }
 
@@ -1587,23 +1831,6 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
         ist->resample_sample_rate    = decoded_frame->sample_rate;
         ist->resample_channel_layout = decoded_frame->channel_layout;
         ist->resample_channels       = avctx->channels;
-
-        for (i = 0; i < nb_filtergraphs; i++)
-            if (ist_in_filtergraph(filtergraphs[i], ist)) {
-                FilterGraph *fg = filtergraphs[i];
-                int j;
-                if (configure_filtergraph(fg) < 0) {
-                    av_log(NULL, AV_LOG_FATAL, "Error reinitializing filters!\n");
-                    exit_program(1);
-                }
-                for (j = 0; j < fg->nb_outputs; j++) {
-                    OutputStream *ost = fg->outputs[j]->ost;
-                    if (ost->enc->type == AVMEDIA_TYPE_AUDIO &&
-                        !(ost->enc->capabilities & CODEC_CAP_VARIABLE_FRAME_SIZE))
-                        av_buffersink_set_frame_size(ost->filter->filter,
-                                                     ost->st->codec->frame_size);
-                }
-            }
     }
 
     /* if the decoder provides a pts, use it instead of the last packet pts.
@@ -1627,35 +1854,19 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
         decoded_frame->pts = av_rescale_delta(decoded_frame_tb, decoded_frame->pts,
                                               (AVRational){1, ist->st->codec->sample_rate}, decoded_frame->nb_samples, &ist->filter_in_rescale_delta_last,
                                               (AVRational){1, ist->st->codec->sample_rate});
-    for (i = 0; i < ist->nb_filters; i++) {
-        if (i < ist->nb_filters - 1) {
-            f = ist->filter_frame;
-            err = av_frame_ref(f, decoded_frame);
-            if (err < 0)
-                break;
-        } else
-            f = decoded_frame;
-        err = av_buffersrc_add_frame_flags(ist->filters[i]->filter, f,
-                                     AV_BUFFERSRC_FLAG_PUSH);
-        if (err == AVERROR_EOF)
-            err = 0; /* ignore */
-        if (err < 0)
-            break;
-    }
+    err = send_decoded_frame(ist, decoded_frame, resample_changed);
     decoded_frame->pts = AV_NOPTS_VALUE;
 
-    av_frame_unref(ist->filter_frame);
     av_frame_unref(decoded_frame);
     return err < 0 ? err : ret;
 }
 
 static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
 {
-    AVFrame *decoded_frame, *f;
+    AVFrame *decoded_frame;
     void *buffer_to_free = NULL;
-    int i, ret = 0, err = 0, resample_changed;
+    int ret = 0, err = 0, resample_changed;
     int64_t best_effort_timestamp;
-    AVRational *frame_sample_aspect;
 
     if (!ist->decoded_frame && !(ist->decoded_frame = av_frame_alloc()))
         return AVERROR(ENOMEM);
@@ -1670,17 +1881,11 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
     update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
 
     if (*got_output || ret<0 || pkt->size)
-        decode_error_stat[ret<0] ++;
+        ist->decode_error_stat[ret<0] ++;
 
     if (!*got_output || ret < 0) {
-        if (!pkt->size) {
-            for (i = 0; i < ist->nb_filters; i++)
-#if 1
-                av_buffersrc_add_ref(ist->filters[i]->filter, NULL, 0);
-#else
-                av_buffersrc_add_frame(ist->filters[i]->filter, NULL);
-#endif
-        }
+        if (!pkt->size)
+            send_decoded_frame(ist, NULL, 0);
         return ret;
     }
 
@@ -1719,39 +1924,10 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
         ist->resample_width   = decoded_frame->width;
         ist->resample_height  = decoded_frame->height;
         ist->resample_pix_fmt = decoded_frame->format;
-
-        for (i = 0; i < nb_filtergraphs; i++) {
-            if (ist_in_filtergraph(filtergraphs[i], ist) && ist->reinit_filters &&
-                configure_filtergraph(filtergraphs[i]) < 0) {
-                av_log(NULL, AV_LOG_FATAL, "Error reinitializing filters!\n");
-                exit_program(1);
-            }
-        }
     }
 
-    frame_sample_aspect= av_opt_ptr(avcodec_get_frame_class(), decoded_frame, "sample_aspect_ratio");
-    for (i = 0; i < ist->nb_filters; i++) {
-        if (!frame_sample_aspect->num)
-            *frame_sample_aspect = ist->st->sample_aspect_ratio;
+    err = send_decoded_frame(ist, decoded_frame, resample_changed);
 
-        if (i < ist->nb_filters - 1) {
-            f = ist->filter_frame;
-            err = av_frame_ref(f, decoded_frame);
-            if (err < 0)
-                break;
-        } else
-            f = decoded_frame;
-        ret = av_buffersrc_add_frame_flags(ist->filters[i]->filter, f, AV_BUFFERSRC_FLAG_PUSH);
-        if (ret == AVERROR_EOF) {
-            ret = 0; /* ignore */
-        } else if (ret < 0) {
-            av_log(NULL, AV_LOG_FATAL,
-                   "Failed to inject frame into filter network: %s\n", av_err2str(ret));
-            exit_program(1);
-        }
-    }
-
-    av_frame_unref(ist->filter_frame);
     av_frame_unref(decoded_frame);
     av_free(buffer_to_free);
     return err < 0 ? err : ret;
@@ -1764,7 +1940,7 @@ static int transcode_subtitles(InputStream *ist, AVPacket *pkt, int *got_output)
                                           &subtitle, got_output, pkt);
 
     if (*got_output || ret<0 || pkt->size)
-        decode_error_stat[ret<0] ++;
+        ist->decode_error_stat[ret<0] ++;
 
     if (ret < 0 || !*got_output) {
         if (!pkt->size)
@@ -1946,6 +2122,28 @@ static int output_packet(InputStream *ist, const AVPacket *pkt)
     return 0;
 }
 
+static void report_decode_error(InputStream *ist, int err)
+{
+    char buf[128];
+    av_strerror(err, buf, sizeof(buf));
+    av_log(NULL, AV_LOG_ERROR, "Error while decoding stream #%d:%d: %s\n",
+            ist->file_index, ist->st->index, buf);
+    if (exit_on_error)
+        exit_program(1);
+}
+
+/* Flush the decoder of ist at the end of its input. */
+static void flush_input_stream(InputStream *ist)
+{
+#if HAVE_PTHREADS
+    if (ist->dec_stage) {
+        pipeline_finish_decoder(ist);
+        return;
+    }
+#endif
+    output_packet(ist, NULL);
+}
+
 static void print_sdp(void)
 {
     char sdp[16384];
@@ -2628,7 +2826,7 @@ static int need_output(void)
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
 
         if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+            (os->pb && output_file_tell(of) >= of->limit_filesize))
             continue;
         if (ost->frame_number >= ost->max_frames) {
             int j;
@@ -2798,7 +2996,7 @@ static void free_input_threads(void)
 {
     int i;
 
-    if (nb_input_files == 1)
+    if (nb_input_files == 1 && !do_pipeline)
         return;
 
     transcoding_finished = 1;
@@ -2833,7 +3031,7 @@ static int init_input_threads(void)
 {
     int i, ret;
 
-    if (nb_input_files == 1)
+    if (nb_input_files == 1 && !do_pipeline)
         return 0;
 
     for (i = 0; i < nb_input_files; i++) {
@@ -2871,6 +3069,656 @@ static int get_input_packet_mt(InputFile *f, AVPacket *pkt)
 
     return ret;
 }
+
+/* The -pipeline mode moves the decoding of audio and video input streams,
+ * every audio and video encoder and all the muxing to threads of their own.
+ * Each of these stages is fed through a small bounded queue. Filtering stays
+ * in the main thread, which gets the decoded frames through a second queue of
+ * each decoder stage. */
+
+#define PIPELINE_QUEUE_SIZE 8
+
+typedef struct MuxPacket {
+    OutputStream *ost;
+    AVPacket pkt;
+} MuxPacket;
+
+typedef struct DecodedFrame {
+    AVFrame *frame;             /* NULL at the end of the stream */
+    int reinit;                 /* the filters must be reconfigured first */
+} DecodedFrame;
+
+enum DecoderWait {
+    DECODER_NOWAIT,             /* only filter what is already queued */
+    DECODER_SYNC,               /* until all the queued packets are decoded */
+    DECODER_EXIT,               /* until the decoder thread has exited */
+};
+
+static int stage_alloc(PipelineStage **pstage, const char *name, int elem_size)
+{
+    PipelineStage *st = av_mallocz(sizeof(*st));
+
+    if (!st)
+        return AVERROR(ENOMEM);
+    if (!(st->fifo = av_fifo_alloc(PIPELINE_QUEUE_SIZE * elem_size))) {
+        av_free(st);
+        return AVERROR(ENOMEM);
+    }
+    av_strlcpy(st->name, name, sizeof(st->name));
+    st->elem_size = elem_size;
+    st->nb_elems  = PIPELINE_QUEUE_SIZE;
+    pthread_mutex_init(&st->lock, NULL);
+    pthread_cond_init (&st->cond, NULL);
+
+    *pstage = st;
+    return 0;
+}
+
+static int stage_start(PipelineStage *st, void *(*worker)(void *), void *arg)
+{
+    int ret;
+
+    st->start_time = st->busy_start = av_gettime();
+    if ((ret = pthread_create(&st->thread, NULL, worker, arg)))
+        return AVERROR(ret);
+    st->started = 1;
+    return 0;
+}
+
+/* Queue an element, waiting while the queue is full. */
+static int stage_push(PipelineStage *st, const void *elem)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&st->lock);
+    while (!st->finished && !st->abort && av_fifo_space(st->fifo) < st->elem_size)
+        pthread_cond_wait(&st->cond, &st->lock);
+
+    if (st->finished || st->abort) {
+        ret = st->error < 0 ? st->error : AVERROR_EXIT;
+    } else {
+        av_fifo_generic_write(st->fifo, (void *)elem, st->elem_size, NULL);
+        st->nb_queued++;
+        st->depth_sum += av_fifo_size(st->fifo) / st->elem_size;
+        pthread_cond_broadcast(&st->cond);
+    }
+    pthread_mutex_unlock(&st->lock);
+
+    return ret;
+}
+
+/* Dequeue an element, waiting while the queue is empty. Called by the
+ * worker; returns AVERROR_EOF once the queue is drained after stage_finish(). */
+static int stage_pop(PipelineStage *st, void *elem)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&st->lock);
+    st->busy_time += av_gettime() - st->busy_start;
+
+    while (!st->abort && !st->eof && av_fifo_size(st->fifo) < st->elem_size)
+        pthread_cond_wait(&st->cond, &st->lock);
+
+    if (st->abort) {
+        ret = AVERROR_EXIT;
+    } else if (av_fifo_size(st->fifo) >= st->elem_size) {
+        av_fifo_generic_read(st->fifo, elem, st->elem_size, NULL);
+        pthread_cond_broadcast(&st->cond);
+    } else
+        ret = AVERROR_EOF;
+
+    st->busy_start = av_gettime();
+    pthread_mutex_unlock(&st->lock);
+
+    return ret;
+}
+
+/* Called by the worker right before it returns. */
+static void stage_exit(PipelineStage *st, int err)
+{
+    pthread_mutex_lock(&st->lock);
+    st->busy_time += av_gettime() - st->busy_start;
+    st->error      = err;
+    st->finished   = 1;
+    pthread_cond_broadcast(&st->cond);
+    pthread_mutex_unlock(&st->lock);
+}
+
+/* Signal the end of the input and wait until the worker has drained its
+ * queue and exited. */
+static int stage_finish(PipelineStage *st)
+{
+    pthread_mutex_lock(&st->lock);
+    st->eof = 1;
+    pthread_cond_broadcast(&st->cond);
+    pthread_mutex_unlock(&st->lock);
+
+    pthread_join(st->thread, NULL);
+    st->joined = 1;
+
+    return st->error;
+}
+
+static void stage_abort(PipelineStage *st)
+{
+    pthread_mutex_lock(&st->lock);
+    st->abort = 1;
+    pthread_cond_broadcast(&st->cond);
+    pthread_mutex_unlock(&st->lock);
+}
+
+static void stage_free(PipelineStage **pst, void (*free_elem)(void *elem))
+{
+    PipelineStage *st = *pst;
+    union {
+        AVFrame *frame;
+        AVPacket pkt;
+        MuxPacket mp;
+    } elem;
+    DecodedFrame df;
+
+    if (!st)
+        return;
+
+    if (st->started && !st->joined) {
+        stage_abort(st);
+        /* exit_program() may be called from one of the workers, which
+         * cannot join itself; leave its stage to the process exit */
+        if (pthread_equal(st->thread, pthread_self()))
+            return;
+        pthread_join(st->thread, NULL);
+        st->joined = 1;
+    }
+
+    while (av_fifo_size(st->fifo) >= st->elem_size) {
+        av_fifo_generic_read(st->fifo, &elem, st->elem_size, NULL);
+        free_elem(&elem);
+    }
+    av_fifo_free(st->fifo);
+    if (st->out_fifo) {
+        while (av_fifo_size(st->out_fifo)) {
+            av_fifo_generic_read(st->out_fifo, &df, sizeof(df), NULL);
+            av_frame_free(&df.frame);
+        }
+        av_fifo_free(st->out_fifo);
+    }
+    pthread_mutex_destroy(&st->lock);
+    pthread_cond_destroy (&st->cond);
+    av_freep(pst);
+}
+
+static void free_frame_elem(void *elem)
+{
+    av_frame_free((AVFrame **)elem);
+}
+
+static void free_packet_elem(void *elem)
+{
+    av_free_packet(&((MuxPacket *)elem)->pkt);
+}
+
+static void free_avpacket_elem(void *elem)
+{
+    av_free_packet(elem);
+}
+
+static void *decoder_thread(void *arg)
+{
+    InputStream *ist = arg;
+    PipelineStage *st = ist->dec_stage;
+    AVPacket pkt;
+    int ret;
+
+    while ((ret = stage_pop(st, &pkt)) >= 0) {
+        ret = output_packet(ist, &pkt);
+        av_free_packet(&pkt);
+        if (ret < 0 && ret != AVERROR_EXIT)
+            report_decode_error(ist, ret);
+
+        pthread_mutex_lock(&st->lock);
+        st->nb_done++;
+        st->next_dts = ist->next_dts;
+        st->next_pts = ist->next_pts;
+        st->pts      = ist->pts;
+        pthread_cond_broadcast(&st->cond);
+        pthread_mutex_unlock(&st->lock);
+    }
+    if (ret == AVERROR_EOF)
+        output_packet(ist, NULL);
+
+    stage_exit(st, ret == AVERROR_EOF ? 0 : ret);
+    return NULL;
+}
+
+static void *encoder_thread(void *arg)
+{
+    OutputStream *ost = arg;
+    AVFrame *frame;
+    int ret;
+
+    while ((ret = stage_pop(ost->enc_stage, &frame)) >= 0) {
+        if (ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+            ret = encode_video_frame(ost, frame);
+        else
+            ret = encode_audio_frame(ost, frame);
+        av_frame_free(&frame);
+        if (ret < 0)
+            break;
+    }
+    if (ret == AVERROR_EOF)
+        ret = flush_encoder(ost);
+
+    stage_exit(ost->enc_stage, FFMIN(ret, 0));
+    return NULL;
+}
+
+static void *mux_thread(void *arg)
+{
+    PipelineStage *st = arg;
+    MuxPacket mp;
+    int ret;
+
+    while ((ret = stage_pop(st, &mp)) >= 0) {
+        OutputFile *of = output_files[mp.ost->file_index];
+
+        mux_packet(of->ctx, &mp.pkt, mp.ost);
+        av_free_packet(&mp.pkt);
+
+        if (of->ctx->pb) {
+            int64_t size = avio_tell(of->ctx->pb);
+            pthread_mutex_lock(&st->lock);
+            of->muxed_size = size;
+            pthread_mutex_unlock(&st->lock);
+        }
+    }
+
+    stage_exit(st, ret == AVERROR_EOF ? 0 : ret);
+    return NULL;
+}
+
+static int pipeline_submit_frame(OutputStream *ost, AVFrame *frame)
+{
+    AVFrame *clone = av_frame_clone(frame);
+    int ret;
+
+    if (!clone)
+        return AVERROR(ENOMEM);
+    if ((ret = stage_push(ost->enc_stage, &clone)) < 0)
+        av_frame_free(&clone);
+    return ret;
+}
+
+/* Take over the packet data like av_interleaved_write_frame() does. */
+static int take_packet(AVPacket *dst, AVPacket *pkt)
+{
+    int ret;
+
+    *dst = *pkt;
+#if FF_API_DESTRUCT_PACKET
+FF_DISABLE_DEPRECATION_WARNINGS
+    pkt->destruct = NULL;
+FF_ENABLE_DEPRECATION_WARNINGS
+#endif
+    pkt->buf      = NULL;
+    if ((ret = av_dup_packet(dst)) < 0)
+        return ret;
+    return av_copy_packet_side_data(dst, dst);
+}
+
+static int pipeline_submit_packet(OutputStream *ost, AVPacket *pkt)
+{
+    MuxPacket mp = { ost };
+    int ret;
+
+    if ((ret = take_packet(&mp.pkt, pkt)) < 0)
+        return ret;
+
+    if ((ret = stage_push(mux_stage, &mp)) < 0)
+        av_free_packet(&mp.pkt);
+    return ret;
+}
+
+/* Queue a demuxed packet for the decoder thread of ist. */
+static int pipeline_submit_input(InputStream *ist, AVPacket *pkt)
+{
+    AVPacket copy;
+    int ret;
+
+    if ((ret = take_packet(&copy, pkt)) < 0)
+        return ret;
+
+    if ((ret = stage_push(ist->dec_stage, &copy)) < 0)
+        av_free_packet(&copy);
+    return ret;
+}
+
+/* Hand a decoded frame over to the main thread. On a parameter change, wait
+ * until the filters have been reconfigured, so that they are configured from
+ * the same decoder state as without -pipeline. */
+static int pipeline_submit_decoded(InputStream *ist, AVFrame *frame, int reinit)
+{
+    PipelineStage *st = ist->dec_stage;
+    DecodedFrame df = { NULL, reinit };
+    int ret = 0;
+
+    if (frame && !(df.frame = av_frame_clone(frame)))
+        return AVERROR(ENOMEM);
+
+    pthread_mutex_lock(&st->lock);
+    while (!st->abort && av_fifo_space(st->out_fifo) < sizeof(df))
+        pthread_cond_wait(&st->cond, &st->lock);
+
+    if (st->abort) {
+        ret = AVERROR_EXIT;
+    } else {
+        av_fifo_generic_write(st->out_fifo, &df, sizeof(df), NULL);
+        df.frame           = NULL;
+        st->reinit_pending = reinit;
+        pthread_cond_broadcast(&st->cond);
+        while (!st->abort && st->reinit_pending)
+            pthread_cond_wait(&st->cond, &st->lock);
+    }
+    pthread_mutex_unlock(&st->lock);
+
+    av_frame_free(&df.frame);
+    return ret;
+}
+
+/* Filter the frames output by the decoder thread of ist, waiting for more
+ * as told by wait. Called by the main thread. */
+static void pipeline_drain_decoder(InputStream *ist, enum DecoderWait wait)
+{
+    PipelineStage *st = ist->dec_stage;
+    DecodedFrame df;
+    int ret;
+
+    pthread_mutex_lock(&st->lock);
+    for (;;) {
+        if (av_fifo_size(st->out_fifo)) {
+            av_fifo_generic_read(st->out_fifo, &df, sizeof(df), NULL);
+            pthread_cond_broadcast(&st->cond);
+            pthread_mutex_unlock(&st->lock);
+
+            ret = filter_decoded_frame(ist, df.frame, df.reinit);
+            av_frame_free(&df.frame);
+            if (ret < 0)
+                report_decode_error(ist, ret);
+
+            pthread_mutex_lock(&st->lock);
+            if (df.reinit) {
+                st->reinit_pending = 0;
+                pthread_cond_broadcast(&st->cond);
+            }
+            continue;
+        }
+        if (wait == DECODER_NOWAIT || st->finished ||
+            (wait == DECODER_SYNC && st->nb_done == st->nb_queued))
+            break;
+        pthread_cond_wait(&st->cond, &st->lock);
+    }
+    pthread_mutex_unlock(&st->lock);
+}
+
+/* Get the timestamp state of ist the checks of the demuxed packet with the
+ * (unadjusted) dts pkt_dts need. The state left by the last packet decoded so
+ * far is used rather than waiting for the queued ones, so that several
+ * packets can be in flight. The queued packets are waited for if sync is set,
+ * before next_dts is known and when the dts does not increase, which the
+ * backward discontinuity checks look for. */
+static void pipeline_decoder_state(InputStream *ist, int64_t pkt_dts, int sync,
+                                   int64_t *next_dts, int64_t *next_pts, int64_t *pts)
+{
+    PipelineStage *st = ist->dec_stage;
+    int backward = pkt_dts != AV_NOPTS_VALUE && st->last_pkt_dts != AV_NOPTS_VALUE &&
+                   pkt_dts <= st->last_pkt_dts;
+
+    pthread_mutex_lock(&st->lock);
+    if ((sync || st->next_dts == AV_NOPTS_VALUE || backward) &&
+        st->nb_done < st->nb_queued) {
+        pthread_mutex_unlock(&st->lock);
+        pipeline_drain_decoder(ist, DECODER_SYNC);
+        pthread_mutex_lock(&st->lock);
+    }
+    if (pkt_dts != AV_NOPTS_VALUE)
+        st->last_pkt_dts = pkt_dts;
+    *next_dts = st->next_dts;
+    *next_pts = st->next_pts;
+    *pts      = st->pts;
+    pthread_mutex_unlock(&st->lock);
+}
+
+/* Tell whether the timestamp checks of process_input() may find a forward
+ * discontinuity or an invalid timestamp in pkt. A state that lags behind has
+ * a smaller next_dts, so this holds whenever it holds for the exact state. */
+static int pipeline_ts_jump(InputStream *ist, const AVPacket *pkt,
+                            int64_t next_dts, int64_t last_pts)
+{
+    int64_t pkt_dts = av_rescale_q(pkt->dts, ist->st->time_base, AV_TIME_BASE_Q);
+    float threshold = FFMIN(dts_delta_threshold, dts_error_threshold);
+
+    if (pkt_dts - next_dts > threshold * AV_TIME_BASE ||
+        pkt_dts + AV_TIME_BASE/10 < last_pts)
+        return 1;
+    if (pkt->pts != AV_NOPTS_VALUE) {
+        int64_t pkt_pts = av_rescale_q(pkt->pts, ist->st->time_base, AV_TIME_BASE_Q);
+        if (FFABS(pkt_pts - next_dts) > dts_error_threshold * AV_TIME_BASE)
+            return 1;
+    }
+    return 0;
+}
+
+static void pipeline_poll_decoders(void)
+{
+    int i;
+
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+        if (ist->dec_stage && !ist->dec_stage->joined)
+            pipeline_drain_decoder(ist, DECODER_NOWAIT);
+    }
+}
+
+/* Signal the end of the input to the decoder thread of ist, filter all it
+ * outputs until it exits and join it. */
+static void pipeline_finish_decoder(InputStream *ist)
+{
+    PipelineStage *st = ist->dec_stage;
+
+    if (st->joined)
+        return;
+
+    pthread_mutex_lock(&st->lock);
+    st->eof = 1;
+    pthread_cond_broadcast(&st->cond);
+    pthread_mutex_unlock(&st->lock);
+
+    pipeline_drain_decoder(ist, DECODER_EXIT);
+    pthread_join(st->thread, NULL);
+    st->joined = 1;
+}
+
+/* Decoding moves to a thread of its own only if nothing but the decoder and
+ * the filtergraphs fed by this stream alone use its decoding state: not
+ * with -re, which paces reading by the decoded timestamps, nor when the same
+ * stream is also copied or feeds a filtergraph with several inputs. */
+static int decoder_can_be_threaded(int ist_index)
+{
+    InputStream *ist = input_streams[ist_index];
+    enum AVMediaType type = ist->st->codec->codec_type;
+    int i;
+
+    if (!ist->decoding_needed ||
+        (type != AVMEDIA_TYPE_VIDEO && type != AVMEDIA_TYPE_AUDIO) ||
+        input_files[ist->file_index]->rate_emu)
+        return 0;
+    for (i = 0; i < nb_output_streams; i++)
+        if (output_streams[i]->source_index == ist_index &&
+            !output_streams[i]->encoding_needed)
+            return 0;
+    for (i = 0; i < ist->nb_filters; i++)
+        if (ist->filters[i]->graph->nb_inputs > 1)
+            return 0;
+    return 1;
+}
+
+static int init_pipeline(void)
+{
+    char name[32];
+    int i, ret;
+
+    if (!do_pipeline)
+        return 0;
+
+    if (vstats_filename || do_benchmark_all) {
+        av_log(NULL, AV_LOG_WARNING, "-pipeline cannot be combined with -vstats "
+               "or -benchmark_all, transcoding in a single thread.\n");
+        do_pipeline = 0;
+        return 0;
+    }
+    for (i = 0; i < nb_output_files; i++) {
+        if (output_files[i]->ctx->oformat->flags & AVFMT_RAWPICTURE) {
+            av_log(NULL, AV_LOG_WARNING, "Output format %s stores raw pictures, "
+                   "-pipeline is not supported for it.\n",
+                   output_files[i]->ctx->oformat->name);
+            do_pipeline = 0;
+            return 0;
+        }
+    }
+
+    if ((ret = stage_alloc(&mux_stage, "muxer", sizeof(MuxPacket))) < 0)
+        return ret;
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        enum AVMediaType type = ost->st->codec->codec_type;
+
+        if (!ost->encoding_needed ||
+            (type != AVMEDIA_TYPE_VIDEO && type != AVMEDIA_TYPE_AUDIO))
+            continue;
+
+        snprintf(name, sizeof(name), "encoder %d:%d", ost->file_index, ost->index);
+        if ((ret = stage_alloc(&ost->enc_stage, name, sizeof(AVFrame *))) < 0 ||
+            (ret = stage_start(ost->enc_stage, encoder_thread, ost)) < 0)
+            return ret;
+    }
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+
+        if (!decoder_can_be_threaded(i))
+            continue;
+
+        snprintf(name, sizeof(name), "decoder %d:%d", ist->file_index, ist->st->index);
+        if ((ret = stage_alloc(&ist->dec_stage, name, sizeof(AVPacket))) < 0)
+            return ret;
+        if (!(ist->dec_stage->out_fifo = av_fifo_alloc(PIPELINE_QUEUE_SIZE *
+                                                       sizeof(DecodedFrame))))
+            return AVERROR(ENOMEM);
+        ist->dec_stage->next_dts = ist->next_dts;
+        ist->dec_stage->next_pts = ist->next_pts;
+        ist->dec_stage->pts      = ist->pts;
+        ist->dec_stage->last_pkt_dts = AV_NOPTS_VALUE;
+        if ((ret = stage_start(ist->dec_stage, decoder_thread, ist)) < 0)
+            return ret;
+    }
+    return stage_start(mux_stage, mux_thread, mux_stage);
+}
+
+/* Flush all the encoders through the pipeline and wait for the last packet
+ * to be muxed. */
+static int finish_pipeline(void)
+{
+    int i, ret = 0;
+
+    if (!mux_stage)
+        return 0;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        if (ost->enc_stage && !ost->enc_stage->joined)
+            ret = FFMIN(ret, stage_finish(ost->enc_stage));
+    }
+    if (!mux_stage->joined)
+        ret = FFMIN(ret, stage_finish(mux_stage));
+    return ret;
+}
+
+static void free_pipeline(void)
+{
+    int i;
+
+    if (!mux_stage)
+        return;
+
+    /* wake up everything first, encoders may be waiting for the muxer */
+    for (i = 0; i < nb_input_streams; i++)
+        if (input_streams[i] && input_streams[i]->dec_stage)
+            stage_abort(input_streams[i]->dec_stage);
+    for (i = 0; i < nb_output_streams; i++)
+        if (output_streams[i] && output_streams[i]->enc_stage)
+            stage_abort(output_streams[i]->enc_stage);
+    stage_abort(mux_stage);
+
+    for (i = 0; i < nb_input_streams; i++)
+        if (input_streams[i])
+            stage_free(&input_streams[i]->dec_stage, free_avpacket_elem);
+    for (i = 0; i < nb_output_streams; i++)
+        if (output_streams[i])
+            stage_free(&output_streams[i]->enc_stage, free_frame_elem);
+    stage_free(&mux_stage, free_packet_elem);
+}
+
+static void print_stage_stats(AVBPrint *buf_script, const char *key,
+                              PipelineStage *st, int64_t cur_time)
+{
+    int64_t busy, elapsed, nb_queued, depth_sum;
+
+    pthread_mutex_lock(&st->lock);
+    busy = st->busy_time;
+    if (!st->finished)
+        busy += cur_time - st->busy_start;
+    nb_queued = st->nb_queued;
+    depth_sum = st->depth_sum;
+    pthread_mutex_unlock(&st->lock);
+
+    elapsed = FFMAX(cur_time - st->start_time, 1);
+    busy    = av_clip64(busy, 0, elapsed);
+
+    if (buf_script) {
+        av_bprintf(buf_script, "%s_busy=%.1f\n", key, 100.0 * busy / elapsed);
+        av_bprintf(buf_script, "%s_queue=%.1f\n", key,
+                   nb_queued ? (double)depth_sum / nb_queued : 0);
+    } else {
+        av_log(NULL, AV_LOG_INFO, "%-14s busy %5.1f%%, average queue %4.1f/%d\n",
+               st->name, 100.0 * busy / elapsed,
+               nb_queued ? (double)depth_sum / nb_queued : 0, st->nb_elems);
+    }
+}
+
+/* Print how busy each pipeline stage was and how full its queue was on
+ * average; to the progress script if buf_script is set, to the log otherwise. */
+static void print_pipeline_stats(AVBPrint *buf_script, int64_t cur_time)
+{
+    char key[64];
+    int i;
+
+    if (!mux_stage || !mux_stage->started)
+        return;
+
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+        if (!ist->dec_stage)
+            continue;
+        snprintf(key, sizeof(key), "input_%d_%d_decoder", ist->file_index, ist->st->index);
+        print_stage_stats(buf_script, key, ist->dec_stage, cur_time);
+    }
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        if (!ost->enc_stage)
+            continue;
+        snprintf(key, sizeof(key), "stream_%d_%d_encoder", ost->file_index, ost->index);
+        print_stage_stats(buf_script, key, ost->enc_stage, cur_time);
+    }
+    print_stage_stats(buf_script, "muxer", mux_stage, cur_time);
+}
 #endif
 
 static int get_input_packet(InputFile *f, AVPacket *pkt)
@@ -2887,7 +3735,7 @@ static int get_input_packet(InputFile *f, AVPacket *pkt)
     }
 
 #if HAVE_PTHREADS
-    if (nb_input_files > 1)
+    if (nb_input_files > 1 || do_pipeline)
         return get_input_packet_mt(f, pkt);
 #endif
     return av_read_frame(f->ctx, pkt);
@@ -2924,6 +3772,7 @@ static int process_input(int file_index)
     AVFormatContext *is;
     InputStream *ist;
     AVPacket pkt;
+    int64_t next_dts, next_pts, last_pts;
     int ret, i, j;
 
     is  = ifile->ctx;
@@ -2944,7 +3793,7 @@ static int process_input(int file_index)
         for (i = 0; i < ifile->nb_streams; i++) {
             ist = input_streams[ifile->ist_index + i];
             if (ist->decoding_needed)
-                output_packet(ist, NULL);
+                flush_input_stream(ist);
 
             /* mark all outputs that don't go through lavfi as finished */
             for (j = 0; j < nb_output_streams; j++) {
@@ -2976,12 +3825,24 @@ static int process_input(int file_index)
     if (ist->discard)
         goto discard_packet;
 
+#if HAVE_PTHREADS
+    /* the decoder thread updates the state of ist concurrently */
+    if (ist->dec_stage)
+        pipeline_decoder_state(ist, pkt.dts, 0, &next_dts, &next_pts, &last_pts);
+    else
+#endif
+    {
+        next_dts = ist->next_dts;
+        next_pts = ist->next_pts;
+        last_pts = ist->pts;
+    }
+
     if (debug_ts) {
         av_log(NULL, AV_LOG_INFO, "demuxer -> ist_index:%d type:%s "
                "next_dts:%s next_dts_time:%s next_pts:%s next_pts_time:%s pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s off:%s off_time:%s\n",
                ifile->ist_index + pkt.stream_index, av_get_media_type_string(ist->st->codec->codec_type),
-               av_ts2str(ist->next_dts), av_ts2timestr(ist->next_dts, &AV_TIME_BASE_Q),
-               av_ts2str(ist->next_pts), av_ts2timestr(ist->next_pts, &AV_TIME_BASE_Q),
+               av_ts2str(next_dts), av_ts2timestr(next_dts, &AV_TIME_BASE_Q),
+               av_ts2str(next_pts), av_ts2timestr(next_pts, &AV_TIME_BASE_Q),
                av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &ist->st->time_base),
                av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ist->st->time_base),
                av_ts2str(input_files[ist->file_index]->ts_offset),
@@ -2993,7 +3854,7 @@ static int process_input(int file_index)
         // Correcting starttime based on the enabled streams
         // FIXME this ideally should be done before the first use of starttime but we do not know which are the enabled streams at that point.
         //       so we instead do it here as part of discontinuity handling
-        if (   ist->next_dts == AV_NOPTS_VALUE
+        if (   next_dts == AV_NOPTS_VALUE
             && ifile->ts_offset == -is->start_time
             && (is->iformat->flags & AVFMT_TS_DISCONT)) {
             int64_t new_start_time = INT64_MAX;
@@ -3033,7 +3894,14 @@ static int process_input(int file_index)
     if (pkt.dts != AV_NOPTS_VALUE)
         pkt.dts *= ist->ts_scale;
 
-    if (pkt.dts != AV_NOPTS_VALUE && ist->next_dts == AV_NOPTS_VALUE && !copy_ts
+#if HAVE_PTHREADS
+    /* the checks below are then made with the exact decoder state */
+    if (ist->dec_stage && pkt.dts != AV_NOPTS_VALUE && next_dts != AV_NOPTS_VALUE &&
+        !copy_ts && pipeline_ts_jump(ist, &pkt, next_dts, last_pts))
+        pipeline_decoder_state(ist, AV_NOPTS_VALUE, 1, &next_dts, &next_pts, &last_pts);
+#endif
+
+    if (pkt.dts != AV_NOPTS_VALUE && next_dts == AV_NOPTS_VALUE && !copy_ts
         && (is->iformat->flags & AVFMT_TS_DISCONT) && ifile->last_ts != AV_NOPTS_VALUE) {
         int64_t pkt_dts = av_rescale_q(pkt.dts, ist->st->time_base, AV_TIME_BASE_Q);
         int64_t delta   = pkt_dts - ifile->last_ts;
@@ -3050,15 +3918,15 @@ static int process_input(int file_index)
         }
     }
 
-    if (pkt.dts != AV_NOPTS_VALUE && ist->next_dts != AV_NOPTS_VALUE &&
+    if (pkt.dts != AV_NOPTS_VALUE && next_dts != AV_NOPTS_VALUE &&
         !copy_ts) {
         int64_t pkt_dts = av_rescale_q(pkt.dts, ist->st->time_base, AV_TIME_BASE_Q);
-        int64_t delta   = pkt_dts - ist->next_dts;
+        int64_t delta   = pkt_dts - next_dts;
         if (is->iformat->flags & AVFMT_TS_DISCONT) {
         if(delta < -1LL*dts_delta_threshold*AV_TIME_BASE ||
             (delta > 1LL*dts_delta_threshold*AV_TIME_BASE &&
                 ist->st->codec->codec_type != AVMEDIA_TYPE_SUBTITLE) ||
-            pkt_dts + AV_TIME_BASE/10 < ist->pts){
+            pkt_dts + AV_TIME_BASE/10 < last_pts){
             ifile->ts_offset -= delta;
             av_log(NULL, AV_LOG_DEBUG,
                    "timestamp discontinuity %"PRId64", new offset= %"PRId64"\n",
@@ -3071,16 +3939,16 @@ static int process_input(int file_index)
             if ( delta < -1LL*dts_error_threshold*AV_TIME_BASE ||
                 (delta > 1LL*dts_error_threshold*AV_TIME_BASE && ist->st->codec->codec_type != AVMEDIA_TYPE_SUBTITLE)
                ) {
-                av_log(NULL, AV_LOG_WARNING, "DTS %"PRId64", next:%"PRId64" st:%d invalid dropping\n", pkt.dts, ist->next_dts, pkt.stream_index);
+                av_log(NULL, AV_LOG_WARNING, "DTS %"PRId64", next:%"PRId64" st:%d invalid dropping\n", pkt.dts, next_dts, pkt.stream_index);
                 pkt.dts = AV_NOPTS_VALUE;
             }
             if (pkt.pts != AV_NOPTS_VALUE){
                 int64_t pkt_pts = av_rescale_q(pkt.pts, ist->st->time_base, AV_TIME_BASE_Q);
-                delta   = pkt_pts - ist->next_dts;
+                delta   = pkt_pts - next_dts;
                 if ( delta < -1LL*dts_error_threshold*AV_TIME_BASE ||
                     (delta > 1LL*dts_error_threshold*AV_TIME_BASE && ist->st->codec->codec_type != AVMEDIA_TYPE_SUBTITLE)
                    ) {
-                    av_log(NULL, AV_LOG_WARNING, "PTS %"PRId64", next:%"PRId64" invalid dropping st:%d\n", pkt.pts, ist->next_dts, pkt.stream_index);
+                    av_log(NULL, AV_LOG_WARNING, "PTS %"PRId64", next:%"PRId64" invalid dropping st:%d\n", pkt.pts, next_dts, pkt.stream_index);
                     pkt.pts = AV_NOPTS_VALUE;
                 }
             }
@@ -3101,15 +3969,14 @@ static int process_input(int file_index)
 
     sub2video_heartbeat(ist, pkt.pts);
 
+#if HAVE_PTHREADS
+    if (ist->dec_stage)
+        ret = pipeline_submit_input(ist, &pkt);
+    else
+#endif
     ret = output_packet(ist, &pkt);
-    if (ret < 0) {
-        char buf[128];
-        av_strerror(ret, buf, sizeof(buf));
-        av_log(NULL, AV_LOG_ERROR, "Error while decoding stream #%d:%d: %s\n",
-                ist->file_index, ist->st->index, buf);
-        if (exit_on_error)
-            exit_program(1);
-    }
+    if (ret < 0)
+        report_decode_error(ist, ret);
 
 discard_packet:
     av_free_packet(&pkt);
@@ -3176,6 +4043,10 @@ static int transcode_step(void)
     InputStream  *ist;
     int ret;
 
+#if HAVE_PTHREADS
+    pipeline_poll_decoders();
+#endif
+
     ost = choose_output();
     if (!ost) {
         if (got_eagain()) {
@@ -3231,6 +4102,8 @@ static int transcode(void)
     timer_start = av_gettime();
 
 #if HAVE_PTHREADS
+    if ((ret = init_pipeline()) < 0)
+        goto fail;
     if ((ret = init_input_threads()) < 0)
         goto fail;
 #endif
@@ -3269,10 +4142,14 @@ static int transcode(void)
     for (i = 0; i < nb_input_streams; i++) {
         ist = input_streams[i];
         if (!input_files[ist->file_index]->eof_reached && ist->decoding_needed) {
-            output_packet(ist, NULL);
+            flush_input_stream(ist);
         }
     }
     flush_encoders();
+#if HAVE_PTHREADS
+    if (finish_pipeline() < 0)
+        exit_program(1);
+#endif
 
     term_exit();
 
@@ -3308,6 +4185,7 @@ static int transcode(void)
  fail:
 #if HAVE_PTHREADS
     free_input_threads();
+    free_pipeline();
 #endif
 
     if (output_streams) {
@@ -3375,8 +4253,9 @@ static void log_callback_null(void *ptr, int level, const char *fmt, va_list vl)
 
 int main(int argc, char **argv)
 {
-    int ret;
+    int ret, i;
     int64_t ti;
+    int64_t decode_error_stat[2] = { 0 };
 
     register_exit(ffmpeg_cleanup);
 
@@ -3433,6 +4312,10 @@ int main(int argc, char **argv)
     if (do_benchmark) {
         printf("bench: utime=%0.3fs\n", ti / 1000000.0);
     }
+    for (i = 0; i < nb_input_streams; i++) {
+        decode_error_stat[0] += input_streams[i]->decode_error_stat[0];
+        decode_error_stat[1] += input_streams[i]->decode_error_stat[1];
+    }
     av_log(NULL, AV_LOG_DEBUG, "%"PRIu64" frames successfully decoded, %"PRIu64" decoding errors\n",
            decode_error_stat[0], decode_error_stat[1]);
     if ((decode_error_stat[0] + decode_error_stat[1]) * max_error_rate < decode_error_stat[1])
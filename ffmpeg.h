@@ -274,6 +274,12 @@ typedef struct InputStream {
     int        nb_filters;
 
     int reinit_filters;
+
+    int64_t decode_error_stat[2];   /* frames decoded, decoding errors */
+
+#if HAVE_PTHREADS
+    struct PipelineStage *dec_stage; /* decoder thread of the -pipeline mode */
+#endif
 } InputStream;
 
 typedef struct InputFile {
@@ -312,6 +318,41 @@ enum forced_keyframes_const {
 
 extern const char *const forced_keyframes_const_names[];
 
+#if HAVE_PTHREADS
+/* a worker thread of the -pipeline mode, fed through a bounded queue */
+typedef struct PipelineStage {
+    char name[32];
+    pthread_t thread;
+    int started;                /* the thread has been created */
+    int joined;                 /* the thread has been joined */
+    int finished;               /* the thread has exited; set by the worker */
+    int eof;                    /* no more elements will be queued */
+    int abort;                  /* the worker should exit as soon as possible */
+    int error;                  /* error the worker exited with */
+    pthread_mutex_t lock;       /* lock for access to everything below */
+    pthread_cond_t  cond;       /* signaled on every queue or state change */
+    AVFifoBuffer *fifo;         /* queued elements of elem_size bytes each */
+    int elem_size;
+    int nb_elems;               /* queue capacity */
+
+    /* occupancy statistics */
+    int64_t start_time;         /* time the thread was started */
+    int64_t busy_start;         /* time the worker last got an element */
+    int64_t busy_time;          /* total time not spent waiting for input */
+    int64_t nb_queued;          /* number of elements queued so far */
+    int64_t depth_sum;          /* sum of the queue depths after each queueing */
+
+    /* decoder stages only */
+    AVFifoBuffer *out_fifo;     /* decoded frames for the main thread */
+    int64_t nb_done;            /* number of packets decoded so far */
+    int reinit_pending;         /* the filters are being reconfigured */
+    /* next_dts, next_pts and pts of the stream after the last decoded packet,
+     * for the timestamp checks of the packets being demuxed */
+    int64_t next_dts, next_pts, pts;
+    int64_t last_pkt_dts;       /* demuxed dts of the last queued packet */
+} PipelineStage;
+#endif
+
 typedef struct OutputStream {
     int file_index;          /* file index */
     int index;               /* stream index in the output file */
@@ -371,6 +412,13 @@ typedef struct OutputStream {
     int copy_prior_start;
 
     int keep_pix_fmt;
+
+    /* bytes of packets sent to the muxer for this stream */
+    uint64_t data_size;
+
+#if HAVE_PTHREADS
+    PipelineStage *enc_stage;   /* encoder thread in -pipeline mode */
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -382,6 +430,9 @@ typedef struct OutputFile {
     uint64_t limit_filesize; /* filesize limit expressed in bytes */
 
     int shortest;
+
+    /* output size as last seen by the muxer thread in -pipeline mode */
+    int64_t muxed_size;
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -408,6 +459,7 @@ extern int audio_sync_method;
 extern int video_sync_method;
 extern int do_benchmark;
 extern int do_benchmark_all;
+extern int do_pipeline;
 extern int do_deinterlace;
 extern int do_hex_dump;
 extern int do_pkt_dump;
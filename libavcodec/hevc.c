@@ -456,7 +456,7 @@ static int decode_lt_rps(HEVCContext *s, LongTermRPS *rps, GetBitContext *gb)
 
 static int hls_slice_header(HEVCContext *s)
 {
-    GetBitContext *gb = &s->HEVClc.gb;
+    GetBitContext *gb = &s->HEVClc->gb;
     SliceHeader   *sh = &s->sh;
     int i, ret;
 
@@ -759,12 +759,45 @@ static int hls_slice_header(HEVCContext *s)
 
     sh->num_entry_point_offsets = 0;
     if (s->pps->tiles_enabled_flag || s->pps->entropy_coding_sync_enabled_flag) {
-        sh->num_entry_point_offsets = get_ue_golomb(gb);
+        unsigned num_entries, max_entries;
+
+        if (s->pps->tiles_enabled_flag && s->pps->entropy_coding_sync_enabled_flag)
+            max_entries = s->pps->num_tile_columns * s->sps->ctb_height;
+        else if (s->pps->tiles_enabled_flag)
+            max_entries = s->pps->num_tile_columns * s->pps->num_tile_rows;
+        else
+            max_entries = s->sps->ctb_height;
+
+        num_entries = get_ue_golomb_long(gb);
+        if (num_entries >= max_entries) {
+            av_log(s->avctx, AV_LOG_ERROR, "num_entry_point_offsets %u is invalid\n",
+                   num_entries);
+            return AVERROR_INVALIDDATA;
+        }
+        sh->num_entry_point_offsets = num_entries;
         if (sh->num_entry_point_offsets > 0) {
             int offset_len = get_ue_golomb(gb) + 1;
 
+            if (offset_len > 32) {
+                av_log(s->avctx, AV_LOG_ERROR, "offset_len_minus1 %d is invalid\n",
+                       offset_len - 1);
+                sh->num_entry_point_offsets = 0;
+                return AVERROR_INVALIDDATA;
+            }
+
+            av_freep(&sh->entry_point_offset);
+            av_freep(&sh->offset);
+            av_freep(&sh->size);
+            sh->entry_point_offset = av_malloc_array(sh->num_entry_point_offsets, sizeof(int));
+            sh->offset             = av_malloc_array(sh->num_entry_point_offsets, sizeof(int));
+            sh->size               = av_malloc_array(sh->num_entry_point_offsets, sizeof(int));
+            if (!sh->entry_point_offset || !sh->offset || !sh->size) {
+                sh->num_entry_point_offsets = 0;
+                return AVERROR(ENOMEM);
+            }
+
             for (i = 0; i < sh->num_entry_point_offsets; i++)
-                skip_bits(gb, offset_len);
+                sh->entry_point_offset[i] = get_bits_long(gb, offset_len) + 1;
         }
     }
 
@@ -778,10 +811,10 @@ static int hls_slice_header(HEVCContext *s)
     sh->slice_qp = 26 + s->pps->pic_init_qp_minus26 + sh->slice_qp_delta;
     sh->slice_ctb_addr_rs = sh->slice_segment_addr;
 
-    s->HEVClc.first_qp_group = !s->sh.dependent_slice_segment_flag;
+    s->HEVClc->first_qp_group = !s->sh.dependent_slice_segment_flag;
 
     if (!s->pps->cu_qp_delta_enabled_flag)
-        s->HEVClc.qp_y = ((s->sh.slice_qp + 52 + 2 * s->sps->qp_bd_offset) %
+        s->HEVClc->qp_y = ((s->sh.slice_qp + 52 + 2 * s->sps->qp_bd_offset) %
                           (52 + s->sps->qp_bd_offset)) - s->sps->qp_bd_offset;
 
     s->slice_initialized = 1;
@@ -805,7 +838,7 @@ do {                                                    \
 
 static void hls_sao_param(HEVCContext *s, int rx, int ry)
 {
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     int sao_merge_left_flag = 0;
     int sao_merge_up_flag   = 0;
     int shift = s->sps->bit_depth - FFMIN(s->sps->bit_depth, 10);
@@ -882,7 +915,7 @@ static void hls_residual_coding(HEVCContext *s, int x0, int y0,
         x_c = (scan_x_cg[offset >> 4] << 2) + scan_x_off[n];    \
         y_c = (scan_y_cg[offset >> 4] << 2) + scan_y_off[n];    \
     } while (0)
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     int transform_skip_flag = 0;
 
     int last_significant_coeff_x, last_significant_coeff_y;
@@ -1192,7 +1225,7 @@ static void hls_residual_coding(HEVCContext *s, int x0, int y0,
 static void hls_transform_unit(HEVCContext *s, int x0, int  y0, int xBase, int yBase, int cb_xBase, int cb_yBase,
                                int log2_cb_size, int log2_trafo_size, int trafo_depth, int blk_idx)
 {
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     int scan_idx = SCAN_DIAG;
     int scan_idx_c = SCAN_DIAG;
 
@@ -1278,7 +1311,7 @@ static void set_deblocking_bypass(HEVCContext *s, int x0, int y0, int log2_cb_si
 static void hls_transform_tree(HEVCContext *s, int x0, int y0, int xBase, int yBase, int cb_xBase, int cb_yBase,
                                int log2_cb_size, int log2_trafo_size, int trafo_depth, int blk_idx)
 {
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     uint8_t split_transform_flag;
 
     if (trafo_depth > 0 && log2_trafo_size == 2) {
@@ -1376,7 +1409,7 @@ static void hls_transform_tree(HEVCContext *s, int x0, int y0, int xBase, int yB
 static int hls_pcm_sample(HEVCContext *s, int x0, int y0, int log2_cb_size)
 {
     //TODO: non-4:2:0 support
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     GetBitContext gb;
     int cb_size = 1 << log2_cb_size;
     int    stride0 = s->frame->linesize[0];
@@ -1387,7 +1420,7 @@ static int hls_pcm_sample(HEVCContext *s, int x0, int y0, int log2_cb_size)
     uint8_t *dst2 = &s->frame->data[2][(y0 >> s->sps->vshift[2]) * stride2 + ((x0 >> s->sps->hshift[2]) << s->sps->pixel_shift)];
 
     int length = cb_size * cb_size * s->sps->pcm.bit_depth + ((cb_size * cb_size) >> 1) * s->sps->pcm.bit_depth;
-    const uint8_t *pcm = skip_bytes(&s->HEVClc.cc, (length + 7) >> 3);
+    const uint8_t *pcm = skip_bytes(&s->HEVClc->cc, (length + 7) >> 3);
     int ret;
 
     ff_hevc_deblocking_boundary_strengths(s, x0, y0, log2_cb_size,
@@ -1406,7 +1439,7 @@ static int hls_pcm_sample(HEVCContext *s, int x0, int y0, int log2_cb_size)
 
 static void hls_mvd_coding(HEVCContext *s, int x0, int y0, int log2_cb_size)
 {
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     int x = ff_hevc_abs_mvd_greater0_flag_decode(s);
     int y = ff_hevc_abs_mvd_greater0_flag_decode(s);
 
@@ -1444,7 +1477,7 @@ static void hls_mvd_coding(HEVCContext *s, int x0, int y0, int log2_cb_size)
 static void luma_mc(HEVCContext *s, int16_t *dst, ptrdiff_t dststride, AVFrame *ref,
                     const Mv *mv, int x_off, int y_off, int block_w, int block_h)
 {
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     uint8_t *src = ref->data[0];
     ptrdiff_t srcstride = ref->linesize[0];
     int pic_width = s->sps->width;
@@ -1490,7 +1523,7 @@ static void luma_mc(HEVCContext *s, int16_t *dst, ptrdiff_t dststride, AVFrame *
 static void chroma_mc(HEVCContext *s, int16_t *dst1, int16_t *dst2, ptrdiff_t dststride, AVFrame *ref,
                       const Mv *mv, int x_off, int y_off, int block_w, int block_h)
 {
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     uint8_t *src1 = ref->data[1];
     uint8_t *src2 = ref->data[2];
     ptrdiff_t src1stride = ref->linesize[1];
@@ -1536,12 +1569,12 @@ static void chroma_mc(HEVCContext *s, int16_t *dst1, int16_t *dst2, ptrdiff_t ds
 }
 
 static void hevc_await_progress(HEVCContext *s, HEVCFrame *ref,
-                                const Mv *mv, int y0)
+                                const Mv *mv, int y0, int height)
 {
-    int y = (mv->y >> 2) + y0;
+    // last line read, the luma interpolation reads 4 lines below the block
+    int y = FFMAX(0, (mv->y >> 2) + y0 + height + 3);
 
-    //ff_thread_await_progress(&ref->tf, FFMIN(s->height, y), 0);
-    ff_thread_await_progress(&ref->tf, INT_MAX, 0);
+    ff_thread_await_progress(&ref->tf, y + 1, 0);
 }
 
 static void hls_prediction_unit(HEVCContext *s, int x0, int y0, int nPbW, int nPbH, int log2_cb_size, int partIdx)
@@ -1549,7 +1582,7 @@ static void hls_prediction_unit(HEVCContext *s, int x0, int y0, int nPbW, int nP
 #define POS(c_idx, x, y)                                                              \
     &s->frame->data[c_idx][((y) >> s->sps->vshift[c_idx]) * s->frame->linesize[c_idx] + \
                            (((x) >> s->sps->hshift[c_idx]) << s->sps->pixel_shift)]
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     int merge_idx = 0;
     enum InterPredIdc inter_pred_idc = PRED_L0;
     struct MvField current_mv = {{{ 0 }}};
@@ -1657,13 +1690,13 @@ static void hls_prediction_unit(HEVCContext *s, int x0, int y0, int nPbW, int nP
         ref0 = refPicList[0].ref[current_mv.ref_idx[0]];
         if (!ref0)
             return;
-        hevc_await_progress(s, ref0, &current_mv.mv[0], y0);
+        hevc_await_progress(s, ref0, &current_mv.mv[0], y0, nPbH);
     }
     if (current_mv.pred_flag[1]) {
         ref1 = refPicList[1].ref[current_mv.ref_idx[1]];
         if (!ref1)
             return;
-        hevc_await_progress(s, ref1, &current_mv.mv[1], y0);
+        hevc_await_progress(s, ref1, &current_mv.mv[1], y0, nPbH);
     }
 
     if (current_mv.pred_flag[0] && !current_mv.pred_flag[1]) {
@@ -1799,7 +1832,7 @@ static void hls_prediction_unit(HEVCContext *s, int x0, int y0, int nPbW, int nP
 static int luma_intra_pred_mode(HEVCContext *s, int x0, int y0, int pu_size,
                                 int prev_intra_luma_pred_flag)
 {
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     int x_pu = x0 >> s->sps->log2_min_pu_size;
     int y_pu = y0 >> s->sps->log2_min_pu_size;
     int pic_width_in_min_pu = s->sps->width >> s->sps->log2_min_pu_size;
@@ -1897,7 +1930,7 @@ static av_always_inline void set_ct_depth(HEVCContext *s, int x0, int y0,
 
 static void intra_prediction_unit(HEVCContext *s, int x0, int y0, int log2_cb_size)
 {
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     static const uint8_t intra_chroma_table[4] = {0, 26, 10, 1};
     uint8_t prev_intra_luma_pred_flag[4];
     int split   = lc->cu.part_mode == PART_NxN;
@@ -1936,7 +1969,7 @@ static void intra_prediction_unit(HEVCContext *s, int x0, int y0, int log2_cb_si
 
 static void intra_prediction_unit_default_value(HEVCContext *s, int x0, int y0, int log2_cb_size)
 {
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     int pb_size = 1 << log2_cb_size;
     int size_in_pus = pb_size >> s->sps->log2_min_pu_size;
     int pic_width_in_min_pu = s->sps->width >> s->sps->log2_min_pu_size;
@@ -1957,7 +1990,7 @@ static void intra_prediction_unit_default_value(HEVCContext *s, int x0, int y0,
 static int hls_coding_unit(HEVCContext *s, int x0, int y0, int log2_cb_size)
 {
     int cb_size          = 1 << log2_cb_size;
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     int log2_min_cb_size = s->sps->log2_min_coding_block_size;
     int length           = cb_size >> log2_min_cb_size;
     int pic_width_in_ctb = s->sps->width >> log2_min_cb_size;
@@ -2107,7 +2140,7 @@ static int hls_coding_unit(HEVCContext *s, int x0, int y0, int log2_cb_size)
 
 static int hls_coding_quadtree(HEVCContext *s, int x0, int y0, int log2_cb_size, int cb_depth)
 {
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     int ret;
 
     lc->ct.depth = cb_depth;
@@ -2175,7 +2208,7 @@ static int hls_coding_quadtree(HEVCContext *s, int x0, int y0, int log2_cb_size,
 
 static void hls_decode_neighbour(HEVCContext *s, int x_ctb, int y_ctb, int ctb_addr_ts)
 {
-    HEVCLocalContext *lc  = &s->HEVClc;
+    HEVCLocalContext *lc  = s->HEVClc;
     int ctb_size          = 1 << s->sps->log2_ctb_size;
     int ctb_addr_rs       = s->pps->ctb_addr_ts_to_rs[ctb_addr_ts];
     int ctb_addr_in_slice = ctb_addr_rs - s->sh.slice_addr;
@@ -2228,7 +2261,376 @@ static void hls_decode_neighbour(HEVCContext *s, int x_ctb, int y_ctb, int ctb_a
     lc->ctb_up_left_flag = ((x_ctb > 0) && (y_ctb > 0)  && (ctb_addr_in_slice-1 >= s->sps->ctb_width) && (s->pps->tile_id[ctb_addr_ts] == s->pps->tile_id[s->pps->ctb_addr_rs_to_ts[ctb_addr_rs-1 - s->sps->ctb_width]]));
 }
 
-static int hls_slice_data(HEVCContext *s)
+static int hls_decode_ctb(HEVCContext *s, int x_ctb, int y_ctb, int ctb_addr_rs)
+{
+    hls_sao_param(s, x_ctb >> s->sps->log2_ctb_size, y_ctb >> s->sps->log2_ctb_size);
+
+    s->deblock[ctb_addr_rs].disable     = s->sh.disable_deblocking_filter_flag;
+    s->deblock[ctb_addr_rs].beta_offset = s->sh.beta_offset;
+    s->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
+    s->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
+
+    return hls_coding_quadtree(s, x_ctb, y_ctb, s->sps->log2_ctb_size, 0);
+}
+
+/**
+ * Locate the substreams after the first one in the RBSP of the slice from
+ * the entry points, which count the emulation prevention bytes.
+ */
+static int hls_entry_points(HEVCContext *s, const HEVCNAL *nal)
+{
+    SliceHeader *sh = &s->sh;
+    int64_t pos = (get_bits_count(&s->HEVClc->gb) + 8) >> 3; // byte_alignment()
+    int i, j;
+
+    for (j = 0; j < nal->skipped_bytes && nal->skipped_bytes_pos[j] <= pos; j++)
+        pos++;
+
+    for (i = 0; i < sh->num_entry_point_offsets; i++) {
+        pos += sh->entry_point_offset[i];
+        while (j < nal->skipped_bytes && nal->skipped_bytes_pos[j] < pos)
+            j++;
+        if (pos - j >= nal->size) {
+            av_log(s->avctx, AV_LOG_ERROR, "Invalid entry point %d\n", i);
+            return AVERROR_INVALIDDATA;
+        }
+        sh->offset[i] = pos - j;
+    }
+    for (i = 0; i < sh->num_entry_point_offsets; i++) {
+        int end = i + 1 < sh->num_entry_point_offsets ? sh->offset[i + 1] : nal->size;
+        sh->size[i] = end - sh->offset[i];
+    }
+
+    return 0;
+}
+
+static void entry_await(HEVCLocalContext *lc, int pos)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&lc->lock);
+    if (lc->entry_pos < pos) {
+        lc->wait_pos = pos;
+        while (lc->entry_pos < pos)
+            pthread_cond_wait(&lc->cond, &lc->lock);
+        lc->wait_pos = INT_MAX;
+    }
+    pthread_mutex_unlock(&lc->lock);
+#endif
+}
+
+static void entry_report(HEVCLocalContext *lc, int pos)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&lc->lock);
+    lc->entry_pos = pos;
+    if (pos >= lc->wait_pos)
+        pthread_cond_broadcast(&lc->cond);
+    pthread_mutex_unlock(&lc->lock);
+#endif
+}
+
+/**
+ * Decode the CTB rows of a slice with entropy_coding_sync_enabled_flag in
+ * a wavefront: job n decodes the rows n, n + nb_jobs, ..., each CTB starting
+ * once the row above is two CTBs ahead, so that its CABAC contexts are
+ * saved and the above-right CTB is reconstructed and no longer filtered by
+ * anyone. The lagged loop filters stay with the CTB that triggers them.
+ */
+static int hls_decode_entry_wpp(AVCodecContext *avctx, void *arg, int job, int self_id)
+{
+    HEVCContext       *s = avctx->priv_data;
+    const HEVCNAL   *nal = arg;
+    int ctb_size         = 1 << s->sps->log2_ctb_size;
+    int ctb_width        = s->sps->ctb_width;
+    int nb_entries       = s->sh.num_entry_point_offsets + 1;
+    int nb_jobs          = FFMIN(s->threads_number, nb_entries);
+    int start_row        = s->sh.slice_ctb_addr_rs / ctb_width;
+    HEVCContext      *s1 = s->sList[job];
+    HEVCLocalContext *lc = s1->HEVClc;
+    HEVCLocalContext *prev = s->HEVClcList[(job + nb_jobs - 1) % nb_jobs];
+    int entry, more_data, ctb_addr_rs = 0;
+
+    for (entry = job; entry < nb_entries; entry += nb_jobs) {
+        int y = start_row + entry;
+
+        more_data   = 1;
+        ctb_addr_rs = entry ? y * ctb_width : s->sh.slice_ctb_addr_rs;
+
+        do {
+            int x     = ctb_addr_rs - y * ctb_width;
+            int x_ctb = x << s->sps->log2_ctb_size;
+            int y_ctb = y << s->sps->log2_ctb_size;
+
+            if (entry)
+                entry_await(prev, (y - 1) << 16 | FFMIN(x + 2, ctb_width));
+
+            hls_decode_neighbour(s1, x_ctb, y_ctb, ctb_addr_rs);
+            if (entry && !x)
+                ff_hevc_cabac_init_substream(s1, ctb_addr_rs,
+                                             nal->data + s->sh.offset[entry - 1],
+                                             s->sh.size[entry - 1]);
+            else
+                ff_hevc_cabac_init(s1, ctb_addr_rs);
+
+            more_data = hls_decode_ctb(s1, x_ctb, y_ctb, ctb_addr_rs);
+            if (more_data < 0)
+                goto fail;
+
+            ctb_addr_rs++;
+            ff_hevc_save_states(s1, ctb_addr_rs);
+            ff_hevc_hls_filters(s1, x_ctb, y_ctb, ctb_size);
+            if (ctb_addr_rs == s->sps->ctb_size)
+                ff_hevc_hls_filter(s1, x_ctb, y_ctb);
+
+            entry_report(lc, y << 16 | (x + 1));
+        } while (more_data && ctb_addr_rs % ctb_width);
+
+        if (entry + 1 < nb_entries ? !more_data :
+            more_data && ctb_addr_rs < s->sps->ctb_size) {
+            av_log(s->avctx, AV_LOG_ERROR,
+                   "Substream %d does not end with its CTB row\n", entry);
+            more_data = AVERROR_INVALIDDATA;
+            goto fail;
+        }
+    }
+
+    entry_report(lc, INT_MAX);
+    return ctb_addr_rs;
+fail:
+    entry_report(lc, INT_MAX);
+    return more_data;
+}
+
+/**
+ * Decode the tiles of a slice in parallel, job n decoding the tiles n,
+ * n + nb_jobs, ... Tiles do not predict from each other, but the loop
+ * filters cross tile boundaries, so they are left to a separate pass.
+ */
+static int hls_decode_entry_tiles(AVCodecContext *avctx, void *arg, int job, int self_id)
+{
+    HEVCContext       *s = avctx->priv_data;
+    const HEVCNAL   *nal = arg;
+    int nb_entries       = s->sh.num_entry_point_offsets + 1;
+    int nb_jobs          = FFMIN(s->threads_number, nb_entries);
+    int start_ts         = s->pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+    HEVCContext      *s1 = s->sList[job];
+    int entry, ctb_addr_ts = 0;
+
+    for (entry = job; entry < nb_entries; entry += nb_jobs) {
+        int tile      = s->pps->tile_id[start_ts] + entry;
+        int more_data = 1;
+
+        if (entry) {
+            int col = tile % s->pps->num_tile_columns;
+            int row = tile / s->pps->num_tile_columns;
+            ctb_addr_ts = s->pps->ctb_addr_rs_to_ts[s->pps->row_bd[row] * s->sps->ctb_width +
+                                                    s->pps->col_bd[col]];
+        } else
+            ctb_addr_ts = start_ts;
+
+        do {
+            int ctb_addr_rs = s->pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+            int x_ctb = (ctb_addr_rs % s->sps->ctb_width) << s->sps->log2_ctb_size;
+            int y_ctb = (ctb_addr_rs / s->sps->ctb_width) << s->sps->log2_ctb_size;
+
+            hls_decode_neighbour(s1, x_ctb, y_ctb, ctb_addr_ts);
+            if (entry && s->pps->tile_id[ctb_addr_ts] != s->pps->tile_id[ctb_addr_ts - 1])
+                ff_hevc_cabac_init_substream(s1, ctb_addr_ts,
+                                             nal->data + s->sh.offset[entry - 1],
+                                             s->sh.size[entry - 1]);
+            else
+                ff_hevc_cabac_init(s1, ctb_addr_ts);
+
+            more_data = hls_decode_ctb(s1, x_ctb, y_ctb, ctb_addr_rs);
+            if (more_data < 0)
+                return more_data;
+
+            ctb_addr_ts++;
+        } while (more_data && ctb_addr_ts < s->sps->ctb_size &&
+                 s->pps->tile_id[ctb_addr_ts] == tile);
+
+        if (entry + 1 < nb_entries ? !more_data :
+            more_data && ctb_addr_ts < s->sps->ctb_size) {
+            av_log(s->avctx, AV_LOG_ERROR,
+                   "Substream %d does not end with its tile\n", entry);
+            return AVERROR_INVALIDDATA;
+        }
+    }
+
+    return ctb_addr_ts;
+}
+
+/**
+ * Run the loop filters of the CTBs a slice decoded by tiles. Every CTB
+ * triggers the same filters as in hls_slice_data(), the rows are filtered
+ * in a wavefront like in hls_decode_entry_wpp(). The boundary strengths
+ * on the tile edges are computed again first, the CTBs across them may
+ * not have been decoded yet at the time. arg points to the first CTB after
+ * the slice, in tile scan.
+ */
+static int hls_filter_entry_tiles(AVCodecContext *avctx, void *arg, int job, int self_id)
+{
+    HEVCContext       *s = avctx->priv_data;
+    int end_ts           = *(int *)arg;
+    int ctb_size         = 1 << s->sps->log2_ctb_size;
+    int ctb_width        = s->sps->ctb_width;
+    int start_ts         = s->pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+    int start_row        = s->sh.slice_ctb_addr_rs / ctb_width;
+    int nb_rows          = s->sps->ctb_height - start_row;
+    int nb_jobs          = FFMIN(s->threads_number, nb_rows);
+    HEVCContext      *s1 = s->sList[job];
+    HEVCLocalContext *lc = s1->HEVClc;
+    HEVCLocalContext *prev = s->HEVClcList[(job + nb_jobs - 1) % nb_jobs];
+    int row, x;
+
+    for (row = job; row < nb_rows; row += nb_jobs) {
+        int y = start_row + row;
+
+        for (x = 0; x < ctb_width; x++) {
+            int ctb_addr_ts = s->pps->ctb_addr_rs_to_ts[y * ctb_width + x];
+
+            if (ctb_addr_ts < start_ts || ctb_addr_ts >= end_ts)
+                continue;
+
+            if (row)
+                entry_await(prev, (y - 1) << 16 | FFMIN(x + 2, ctb_width));
+
+            ff_hevc_deblocking_boundary_strengths_tiles(s1, x << s->sps->log2_ctb_size,
+                                                        y << s->sps->log2_ctb_size);
+            ff_hevc_hls_filters(s1, x << s->sps->log2_ctb_size,
+                                y << s->sps->log2_ctb_size, ctb_size);
+            if (ctb_addr_ts + 1 == s->sps->ctb_size)
+                ff_hevc_hls_filter(s1, x << s->sps->log2_ctb_size,
+                                   y << s->sps->log2_ctb_size);
+
+            entry_report(lc, y << 16 | (x + 1));
+        }
+        entry_report(lc, y << 16 | ctb_width);
+    }
+
+    entry_report(lc, INT_MAX);
+    return 0;
+}
+
+/**
+ * Prepare one copy of the context per job, each with its own local
+ * context starting from the state the slice header left in s->HEVClc.
+ */
+static int hls_slice_threads_init(HEVCContext *s, int nb_jobs)
+{
+    int i;
+
+    for (i = 0; i < nb_jobs; i++) {
+        HEVCLocalContext *lc = s->HEVClcList[i];
+
+        *s->sList[i]         = *s;
+        s->sList[i]->HEVClc  = lc;
+
+        lc->gb               = s->HEVClc->gb;
+        lc->first_qp_group   = s->HEVClc->first_qp_group;
+        lc->qp_y             = s->HEVClc->qp_y;
+        lc->start_of_tiles_x = s->HEVClc->start_of_tiles_x;
+        lc->end_of_tiles_x   = s->HEVClc->end_of_tiles_x;
+        memcpy(lc->cabac_state, s->HEVClc->cabac_state, HEVC_CONTEXTS);
+
+        lc->entry_pos = 0;
+        lc->wait_pos  = INT_MAX;
+
+        av_fast_malloc(&lc->edge_emu_buffer, &lc->edge_emu_buffer_size,
+                       (MAX_PB_SIZE + 7) * s->ref->frame->linesize[0]);
+        if (!lc->edge_emu_buffer)
+            return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
+/**
+ * Let a following dependent slice segment continue from the state the
+ * substream that ended the slice left in its local context.
+ */
+static void hls_slice_threads_uninit(HEVCContext *s, const HEVCLocalContext *lc)
+{
+    memcpy(s->HEVClc->cabac_state, lc->cabac_state, HEVC_CONTEXTS);
+    s->HEVClc->qp_y             = lc->qp_y;
+    s->HEVClc->start_of_tiles_x = lc->start_of_tiles_x;
+    s->HEVClc->end_of_tiles_x   = lc->end_of_tiles_x;
+}
+
+static int hls_slice_data_wpp(HEVCContext *s, const HEVCNAL *nal)
+{
+    int nb_entries = s->sh.num_entry_point_offsets + 1;
+    int nb_jobs    = FFMIN(s->threads_number, nb_entries);
+    int start_row  = s->sh.slice_ctb_addr_rs / s->sps->ctb_width;
+    int ret[MAX_NB_THREADS];
+    int i;
+
+    if (start_row + nb_entries > s->sps->ctb_height) {
+        av_log(s->avctx, AV_LOG_ERROR, "Too many entry points\n");
+        return AVERROR_INVALIDDATA;
+    }
+
+    if ((i = hls_entry_points(s, nal)) < 0 ||
+        (i = hls_slice_threads_init(s, nb_jobs)) < 0)
+        return i;
+
+    s->avctx->execute2(s->avctx, hls_decode_entry_wpp, (void *)nal, ret, nb_jobs);
+
+    for (i = 0; i < nb_jobs; i++)
+        if (ret[i] < 0)
+            return ret[i];
+
+    i = (nb_entries - 1) % nb_jobs;
+    hls_slice_threads_uninit(s, s->HEVClcList[i]);
+    return ret[i];
+}
+
+static int hls_slice_data_tiles(HEVCContext *s, const HEVCNAL *nal)
+{
+    int nb_entries = s->sh.num_entry_point_offsets + 1;
+    int nb_jobs    = FFMIN(s->threads_number, nb_entries);
+    int start_ts   = s->pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+    int start_row  = s->sh.slice_ctb_addr_rs / s->sps->ctb_width;
+    int nb_rows    = s->sps->ctb_height - start_row;
+    int ret[MAX_NB_THREADS];
+    int i, end_ts;
+
+    if (s->pps->tile_id[start_ts] + nb_entries >
+        s->pps->num_tile_columns * s->pps->num_tile_rows) {
+        av_log(s->avctx, AV_LOG_ERROR, "Too many entry points\n");
+        return AVERROR_INVALIDDATA;
+    }
+
+    if ((i = hls_entry_points(s, nal)) < 0 ||
+        (i = hls_slice_threads_init(s, FFMIN(s->threads_number,
+                                             FFMAX(nb_entries, nb_rows)))) < 0)
+        return i;
+
+    /* Tiles on the left and above may not be decoded yet when a CTB checks
+     * for a slice boundary, so mark all the tiles of the slice upfront. The
+     * CTBs of the last one that belong to the next slice are overwritten
+     * by it, nothing in this slice looks at them. */
+    for (end_ts = start_ts; end_ts < s->sps->ctb_size &&
+         s->pps->tile_id[end_ts] < s->pps->tile_id[start_ts] + nb_entries; end_ts++)
+        s->tab_slice_address[s->pps->ctb_addr_ts_to_rs[end_ts]] = s->sh.slice_addr;
+
+    s->avctx->execute2(s->avctx, hls_decode_entry_tiles, (void *)nal, ret, nb_jobs);
+
+    for (i = 0; i < nb_jobs; i++)
+        if (ret[i] < 0)
+            return ret[i];
+
+    i = (nb_entries - 1) % nb_jobs;
+    hls_slice_threads_uninit(s, s->HEVClcList[i]);
+    end_ts = ret[i];
+
+    nb_jobs = FFMIN(s->threads_number, nb_rows);
+    s->avctx->execute2(s->avctx, hls_filter_entry_tiles, &end_ts, NULL, nb_jobs);
+
+    return end_ts;
+}
+
+static int hls_slice_data(HEVCContext *s, const HEVCNAL *nal)
 {
     int ctb_size    = 1 << s->sps->log2_ctb_size;
     int more_data   = 1;
@@ -2236,6 +2638,13 @@ static int hls_slice_data(HEVCContext *s)
     int y_ctb       = 0;
     int ctb_addr_ts = s->pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
 
+    if (s->threads_number > 1 && s->sh.num_entry_point_offsets > 0) {
+        if (s->pps->entropy_coding_sync_enabled_flag && !s->pps->tiles_enabled_flag)
+            return hls_slice_data_wpp(s, nal);
+        if (s->pps->tiles_enabled_flag && !s->pps->entropy_coding_sync_enabled_flag)
+            return hls_slice_data_tiles(s, nal);
+    }
+
     while (more_data && ctb_addr_ts < s->sps->ctb_size) {
         int ctb_addr_rs = s->pps->ctb_addr_ts_to_rs[ctb_addr_ts];
 
@@ -2245,14 +2654,7 @@ static int hls_slice_data(HEVCContext *s)
 
         ff_hevc_cabac_init(s, ctb_addr_ts);
 
-        hls_sao_param(s, x_ctb >> s->sps->log2_ctb_size, y_ctb >> s->sps->log2_ctb_size);
-
-        s->deblock[ctb_addr_rs].disable     = s->sh.disable_deblocking_filter_flag;
-        s->deblock[ctb_addr_rs].beta_offset = s->sh.beta_offset;
-        s->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
-        s->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
-
-        more_data = hls_coding_quadtree(s, x_ctb, y_ctb, s->sps->log2_ctb_size, 0);
+        more_data = hls_decode_ctb(s, x_ctb, y_ctb, ctb_addr_rs);
         if (more_data < 0)
             return more_data;
 
@@ -2274,7 +2676,7 @@ static int hls_slice_data(HEVCContext *s)
  */
 static int hls_nal_unit(HEVCContext *s)
 {
-    GetBitContext *gb = &s->HEVClc.gb;
+    GetBitContext *gb = &s->HEVClc->gb;
     int nuh_layer_id;
 
     if (get_bits1(gb) != 0)
@@ -2325,7 +2727,7 @@ static void restore_tqb_pixels(HEVCContext *s)
 
 static int hevc_frame_start(HEVCContext *s)
 {
-    HEVCLocalContext *lc     = &s->HEVClc;
+    HEVCLocalContext *lc     = s->HEVClc;
     int pic_width_in_min_pu  = s->sps->width  >> s->sps->log2_min_pu_size;
     int pic_height_in_min_pu = s->sps->height >> s->sps->log2_min_pu_size;
     int pic_width_in_min_tu  = s->sps->width  >> s->sps->log2_min_transform_block_size;
@@ -2376,14 +2778,14 @@ fail:
     return ret;
 }
 
-static int decode_nal_unit(HEVCContext *s, const uint8_t *nal, int length)
+static int decode_nal_unit(HEVCContext *s, const HEVCNAL *nal)
 {
-    HEVCLocalContext *lc = &s->HEVClc;
+    HEVCLocalContext *lc = s->HEVClc;
     GetBitContext *gb = &lc->gb;
     int ctb_addr_ts;
     int ret;
 
-    ret = init_get_bits8(gb, nal, length);
+    ret = init_get_bits8(gb, nal->data, nal->size);
     if (ret < 0)
         return ret;
 
@@ -2480,7 +2882,7 @@ static int decode_nal_unit(HEVCContext *s, const uint8_t *nal, int length)
             }
         }
 
-        ctb_addr_ts = hls_slice_data(s);
+        ctb_addr_ts = hls_slice_data(s, nal);
         if (ctb_addr_ts >= (s->sps->ctb_width * s->sps->ctb_height)) {
             s->is_decoded = 1;
             if ((s->pps->transquant_bypass_enable_flag ||
@@ -2515,6 +2917,8 @@ static int extract_rbsp(const uint8_t *src, int length,
     int i, si, di;
     uint8_t *dst;
 
+    nal->skipped_bytes = 0;
+
 #define STARTCODE_TEST                                                  \
         if (i + 2 < length && src[i + 1] == 0 && src[i + 2] <= 3) {     \
             if (src[i + 2] != 3) {                                      \
@@ -2582,6 +2986,14 @@ static int extract_rbsp(const uint8_t *src, int length,
             dst[di++] = src[si++];
         } else if (src[si] == 0 && src[si + 1] == 0) {
             if (src[si + 2] == 3) { // escape
+                int *pos = av_fast_realloc(nal->skipped_bytes_pos,
+                                           &nal->skipped_bytes_pos_size,
+                                           (nal->skipped_bytes + 1) * sizeof(*pos));
+                if (!pos)
+                    return AVERROR(ENOMEM);
+                nal->skipped_bytes_pos = pos;
+                nal->skipped_bytes_pos[nal->skipped_bytes++] = si + 2;
+
                 dst[di++]  = 0;
                 dst[di++]  = 0;
                 si        += 3;
@@ -2668,7 +3080,7 @@ static int decode_nal_units(HEVCContext *s, const uint8_t *buf, int length)
             goto fail;
         }
 
-        ret = init_get_bits8(&s->HEVClc.gb, nal->data, nal->size);
+        ret = init_get_bits8(&s->HEVClc->gb, nal->data, nal->size);
         if (ret < 0)
             goto fail;
         hls_nal_unit(s);
@@ -2682,7 +3094,7 @@ static int decode_nal_units(HEVCContext *s, const uint8_t *buf, int length)
 
     /* parse the NAL units */
     for (i = 0; i < s->nb_nals; i++) {
-        int ret = decode_nal_unit(s, s->nals[i].data, s->nals[i].size);
+        int ret = decode_nal_unit(s, &s->nals[i]);
         if (ret < 0) {
             av_log(s->avctx, AV_LOG_WARNING, "Error parsing NAL unit #%d.\n", i);
             if (s->avctx->err_recognition & AV_EF_EXPLODE)
@@ -2851,14 +3263,33 @@ fail:
 static av_cold int hevc_decode_free(AVCodecContext *avctx)
 {
     HEVCContext       *s = avctx->priv_data;
-    HEVCLocalContext *lc = &s->HEVClc;
     int i;
 
     pic_arrays_free(s);
 
-    av_freep(&lc->edge_emu_buffer);
+    if (s->HEVClc)
+        av_freep(&s->HEVClc->edge_emu_buffer);
+    av_freep(&s->HEVClc);
+    av_freep(&s->cabac_state);
     av_freep(&s->md5_ctx);
 
+    for (i = 0; i < FF_ARRAY_ELEMS(s->HEVClcList); i++) {
+        HEVCLocalContext *lc = s->HEVClcList[i];
+        if (lc) {
+            av_freep(&lc->edge_emu_buffer);
+#if HAVE_THREADS
+            pthread_cond_destroy(&lc->cond);
+            pthread_mutex_destroy(&lc->lock);
+#endif
+        }
+        av_freep(&s->HEVClcList[i]);
+        av_freep(&s->sList[i]);
+    }
+
+    av_freep(&s->sh.entry_point_offset);
+    av_freep(&s->sh.offset);
+    av_freep(&s->sh.size);
+
     av_frame_free(&s->tmp_frame);
     av_frame_free(&s->output_frame);
 
@@ -2874,8 +3305,10 @@ static av_cold int hevc_decode_free(AVCodecContext *avctx)
     for (i = 0; i < FF_ARRAY_ELEMS(s->pps_list); i++)
         av_buffer_unref(&s->pps_list[i]);
 
-    for (i = 0; i < s->nals_allocated; i++)
+    for (i = 0; i < s->nals_allocated; i++) {
         av_freep(&s->nals[i].rbsp_buffer);
+        av_freep(&s->nals[i].skipped_bytes_pos);
+    }
     av_freep(&s->nals);
     s->nals_allocated = 0;
 
@@ -2889,6 +3322,29 @@ static av_cold int hevc_init_context(AVCodecContext *avctx)
 
     s->avctx = avctx;
 
+    s->HEVClc      = av_mallocz(sizeof(HEVCLocalContext));
+    s->cabac_state = av_malloc(HEVC_CONTEXTS);
+    if (!s->HEVClc || !s->cabac_state)
+        goto fail;
+
+    s->threads_number = 1;
+    if (avctx->active_thread_type & FF_THREAD_SLICE)
+        s->threads_number = FFMIN(avctx->thread_count, MAX_NB_THREADS);
+    if (s->threads_number > 1) {
+        for (i = 0; i < s->threads_number; i++) {
+            s->HEVClcList[i] = av_mallocz(sizeof(HEVCLocalContext));
+            if (!s->HEVClcList[i])
+                goto fail;
+#if HAVE_THREADS
+            pthread_mutex_init(&s->HEVClcList[i]->lock, NULL);
+            pthread_cond_init(&s->HEVClcList[i]->cond, NULL);
+#endif
+            s->sList[i] = av_malloc(sizeof(HEVCContext));
+            if (!s->sList[i])
+                goto fail;
+        }
+    }
+
     s->tmp_frame = av_frame_alloc();
     if (!s->tmp_frame)
         goto fail;
@@ -3114,5 +3570,6 @@ AVCodec ff_hevc_decoder = {
     .flush                 = hevc_decode_flush,
     .update_thread_context = hevc_update_thread_context,
     .init_thread_copy      = hevc_init_thread_copy,
-    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS | CODEC_CAP_EXPERIMENTAL,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_SLICE_THREADS |
+                      CODEC_CAP_FRAME_THREADS | CODEC_CAP_EXPERIMENTAL,
 };
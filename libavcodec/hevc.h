@@ -35,10 +35,19 @@
 #include "internal.h"
 #include "thread.h"
 #include "videodsp.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_OS2THREADS
+#include "compat/os2threads.h"
+#elif HAVE_W32THREADS
+#include "compat/w32pthreads.h"
+#endif
 
 #define MAX_DPB_SIZE 16 // A.4.1
 #define MAX_REFS 16
 
+#define MAX_NB_THREADS 32
+
 /**
  * 7.4.2.1
  */
@@ -563,6 +572,9 @@ typedef struct SliceHeader {
     uint8_t slice_loop_filter_across_slices_enabled_flag;
 
     int num_entry_point_offsets;
+    int *entry_point_offset; ///< entry_point_offset_minus1 + 1, in NAL unit bytes
+    int *offset;             ///< start of each substream after the first, in RBSP bytes
+    int *size;               ///< size of each substream after the first, in RBSP bytes
 
     uint8_t luma_log2_weight_denom;
     int16_t chroma_log2_weight_denom;
@@ -722,6 +734,11 @@ typedef struct HEVCNAL {
     int rbsp_buffer_size;
     const uint8_t *data;
     int size;
+
+    ///< positions of the removed emulation prevention bytes in the NAL unit
+    int *skipped_bytes_pos;
+    unsigned int skipped_bytes_pos_size;
+    int skipped_bytes;
 } HEVCNAL;
 
 typedef struct HEVCLocalContext {
@@ -757,19 +774,40 @@ typedef struct HEVCLocalContext {
     DECLARE_ALIGNED(16, int16_t, mc_buffer[(MAX_PB_SIZE + 7) * MAX_PB_SIZE]);
     FilterData *save_boundary_strengths;
     int nb_saved;
+
+    /**
+     * Slice threading: (ctb_y << 16) | ctb_x of the first CTB the job owning
+     * this context has not finished yet, and the position the next job is
+     * waiting for.
+     */
+    int entry_pos;
+    int wait_pos;
+#if HAVE_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+#endif
 } HEVCLocalContext;
 
 typedef struct HEVCContext {
     const AVClass *c;  // needed by private avoptions
     AVCodecContext      *avctx;
 
-    HEVCLocalContext     HEVClc;
+    HEVCLocalContext    *HEVClc;
+
+    /**
+     * Slice threading: copies of this context and their local contexts,
+     * one per job.
+     */
+    struct HEVCContext  *sList[MAX_NB_THREADS];
+    HEVCLocalContext    *HEVClcList[MAX_NB_THREADS];
+    int                  threads_number;
 
     int                 disable_au;
     int                 width;
     int                 height;
 
-    uint8_t cabac_state[HEVC_CONTEXTS];
+    ///< CABAC contexts saved after the second CTB of a row for WPP
+    uint8_t *cabac_state;
 
     AVFrame *frame;
     AVFrame *sao_frame;
@@ -898,6 +936,14 @@ int ff_hevc_slice_rpl(HEVCContext *s);
 
 void ff_hevc_save_states(HEVCContext *s, int ctb_addr_ts);
 void ff_hevc_cabac_init(HEVCContext *s, int ctb_addr_ts);
+
+/**
+ * Start decoding a WPP or tile substream read from its entry point instead
+ * of continuing the arithmetic decoder from the previous substream.
+ */
+void ff_hevc_cabac_init_substream(HEVCContext *s, int ctb_addr_ts,
+                                  const uint8_t *buf, int size);
+
 int ff_hevc_sao_merge_flag_decode(HEVCContext *s);
 int ff_hevc_sao_type_idx_decode(HEVCContext *s);
 int ff_hevc_sao_band_position_decode(HEVCContext *s);
@@ -969,11 +1015,30 @@ void ff_hevc_luma_mv_mvp_mode(HEVCContext *s, int x0, int y0, int nPbW, int nPbH
 void ff_hevc_set_qPy(HEVCContext *s, int xC, int yC, int xBase, int yBase, int log2_cb_size);
 void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0, int log2_trafo_size,
                                            int slice_or_tiles_up_boundary, int slice_or_tiles_left_boundary);
+
+/**
+ * Compute again the boundary strengths of the edges the CTB at x_ctb, y_ctb
+ * shares with other tiles, for when these were decoded after it.
+ */
+void ff_hevc_deblocking_boundary_strengths_tiles(HEVCContext *s, int x_ctb, int y_ctb);
+
 int ff_hevc_cu_qp_delta_sign_flag(HEVCContext *s);
 int ff_hevc_cu_qp_delta_abs(HEVCContext *s);
 void ff_hevc_hls_filter(HEVCContext *s, int x, int y);
+
+/**
+ * Run the loop filters the CTB at x_ctb, y_ctb completes. Once a CTB row is
+ * filtered, report HEVC_ROW_PROGRESS() of it to the frame threads.
+ */
 void ff_hevc_hls_filters(HEVCContext *s, int x_ctb, int y_ctb, int ctb_size);
 
+/**
+ * Number of luma lines of the reference that are final once the CTB row
+ * at y_ctb is filtered, the CTB row below being decoded: the deblocking of
+ * the next CTB row still changes the last 3 lines and SAO lags 4 lines behind.
+ */
+#define HEVC_ROW_PROGRESS(y_ctb, ctb_size) ((y_ctb) + (ctb_size) - 4)
+
 void ff_hevc_pps_free(HEVCPPS **ppps);
 
 extern const uint8_t ff_hevc_qpel_extra_before[4];
@@ -73,7 +73,7 @@ static int chroma_tc(HEVCContext *s, int qp_y, int c_idx, int tc_offset)
 
 static int get_qPy_pred(HEVCContext *s, int xC, int yC, int xBase, int yBase, int log2_cb_size)
 {
-    HEVCLocalContext *lc     = &s->HEVClc;
+    HEVCLocalContext *lc     = s->HEVClc;
     int ctb_size_mask        = (1 << s->sps->log2_ctb_size) - 1;
     int MinCuQpDeltaSizeMask = (1 << (s->sps->log2_ctb_size - s->pps->diff_cu_qp_delta_depth)) - 1;
     int xQgBase              = xBase - ( xBase & MinCuQpDeltaSizeMask );
@@ -153,11 +153,11 @@ void ff_hevc_set_qPy(HEVCContext *s, int xC, int yC, int xBase, int yBase, int l
 {
     int qp_y = get_qPy_pred(s, xC, yC, xBase, yBase, log2_cb_size);
 
-    if (s->HEVClc.tu.cu_qp_delta != 0) {
+    if (s->HEVClc->tu.cu_qp_delta != 0) {
         int off = s->sps->qp_bd_offset;
-        s->HEVClc.qp_y = ((qp_y + s->HEVClc.tu.cu_qp_delta + 52 + 2 * off) % (52 + off)) - off;
+        s->HEVClc->qp_y = ((qp_y + s->HEVClc->tu.cu_qp_delta + 52 + 2 * off) % (52 + off)) - off;
     } else
-        s->HEVClc.qp_y = qp_y;
+        s->HEVClc->qp_y = qp_y;
 }
 
 static int get_qPy(HEVCContext *s, int xC, int yC)
@@ -553,18 +553,16 @@ static int boundary_strength(HEVCContext *s, MvField *curr,
     return 1;
 }
 
-void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0, int log2_trafo_size,
-                                           int slice_or_tiles_up_boundary, int slice_or_tiles_left_boundary)
+// bs for the top edge of a TU, length samples wide
+static void top_boundary_strengths(HEVCContext *s, int x0, int y0, int length,
+                                   int slice_or_tiles_up_boundary)
 {
-    MvField *tab_mvf      = s->ref->tab_mvf;
-    int log2_min_pu_size  = s->sps->log2_min_pu_size;
-    int log2_min_tu_size  = s->sps->log2_min_transform_block_size;
+    MvField *tab_mvf        = s->ref->tab_mvf;
+    int log2_min_pu_size    = s->sps->log2_min_pu_size;
+    int log2_min_tu_size    = s->sps->log2_min_transform_block_size;
     int pic_width_in_min_pu = s->sps->width >> log2_min_pu_size;
     int pic_width_in_min_tu = s->sps->width >> log2_min_tu_size;
-    int is_intra = tab_mvf[(y0 >> log2_min_pu_size) * pic_width_in_min_pu + (x0 >> log2_min_pu_size)].is_intra;
-
-    int i, j;
-    int bs;
+    int i, bs;
 
     if (y0 > 0 && (y0 & 7) == 0) {
         int yp_pu = (y0 - 1) >> log2_min_pu_size;
@@ -572,7 +570,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0, int l
         int yp_tu = (y0 - 1) >> log2_min_tu_size;
         int yq_tu = y0 >> log2_min_tu_size;
 
-        for (i = 0; i < (1 << log2_trafo_size); i += 4) {
+        for (i = 0; i < length; i += 4) {
             int x_pu = (x0 + i) >> log2_min_pu_size;
             int x_tu = (x0 + i) >> log2_min_tu_size;
             MvField *top  = &tab_mvf[yp_pu * pic_width_in_min_pu + x_pu];
@@ -592,41 +590,26 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0, int l
                 s->horizontal_bs[((x0 + i) + y0 * s->bs_width) >> 2] = bs;
         }
     }
+}
 
-    // bs for TU internal horizontal PU boundaries
-    if (log2_trafo_size > s->sps->log2_min_pu_size && !is_intra)
-        for (j = 8; j < (1 << log2_trafo_size); j += 8) {
-            int yp_pu = (y0 + j - 1) >> log2_min_pu_size;
-            int yq_pu = (y0 + j)     >> log2_min_pu_size;
-            int yp_tu = (y0 + j - 1) >> log2_min_tu_size;
-            int yq_tu = (y0 + j)     >> log2_min_tu_size;
-
-
-            for (i = 0; i < (1<<log2_trafo_size); i += 4) {
-                int x_pu = (x0 + i) >> log2_min_pu_size;
-                int x_tu = (x0 + i) >> log2_min_tu_size;
-                MvField *top  = &tab_mvf[yp_pu * pic_width_in_min_pu + x_pu];
-                MvField *curr = &tab_mvf[yq_pu * pic_width_in_min_pu + x_pu];
-                uint8_t top_cbf_luma  = s->cbf_luma[yp_tu * pic_width_in_min_tu + x_tu];
-                uint8_t curr_cbf_luma = s->cbf_luma[yq_tu * pic_width_in_min_tu + x_tu];
-                RefPicList* top_refPicList = ff_hevc_get_ref_list(s, s->ref, x0 + i, y0 + j - 1);
-
-                bs = boundary_strength(s, curr, curr_cbf_luma, top, top_cbf_luma, top_refPicList, 0);
-                if (s->sh.disable_deblocking_filter_flag == 1)
-                    bs = 0;
-                if (bs)
-                    s->horizontal_bs[((x0 + i) + (y0 + j) * s->bs_width) >> 2] = bs;
-            }
-        }
+// bs for the left edge of a TU, length samples high
+static void left_boundary_strengths(HEVCContext *s, int x0, int y0, int length,
+                                    int slice_or_tiles_left_boundary)
+{
+    MvField *tab_mvf        = s->ref->tab_mvf;
+    int log2_min_pu_size    = s->sps->log2_min_pu_size;
+    int log2_min_tu_size    = s->sps->log2_min_transform_block_size;
+    int pic_width_in_min_pu = s->sps->width >> log2_min_pu_size;
+    int pic_width_in_min_tu = s->sps->width >> log2_min_tu_size;
+    int i, bs;
 
-    // bs for vertical TU boundaries
     if (x0 > 0 && (x0 & 7) == 0) {
         int xp_pu = (x0 - 1) >> log2_min_pu_size;
         int xq_pu =  x0      >> log2_min_pu_size;
         int xp_tu = (x0 - 1) >> log2_min_tu_size;
         int xq_tu =  x0      >> log2_min_tu_size;
 
-        for (i = 0; i < (1 << log2_trafo_size); i += 4) {
+        for (i = 0; i < length; i += 4) {
             int y_pu = (y0 + i) >> log2_min_pu_size;
             int y_tu = (y0 + i) >> log2_min_tu_size;
             MvField *left = &tab_mvf[y_pu * pic_width_in_min_pu + xp_pu];
@@ -647,6 +630,51 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0, int l
                 s->vertical_bs[(x0 >> 3) + ((y0 + i) >> 2) * s->bs_width] = bs;
         }
     }
+}
+
+void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0, int log2_trafo_size,
+                                           int slice_or_tiles_up_boundary, int slice_or_tiles_left_boundary)
+{
+    MvField *tab_mvf      = s->ref->tab_mvf;
+    int log2_min_pu_size  = s->sps->log2_min_pu_size;
+    int log2_min_tu_size  = s->sps->log2_min_transform_block_size;
+    int pic_width_in_min_pu = s->sps->width >> log2_min_pu_size;
+    int pic_width_in_min_tu = s->sps->width >> log2_min_tu_size;
+    int is_intra = tab_mvf[(y0 >> log2_min_pu_size) * pic_width_in_min_pu + (x0 >> log2_min_pu_size)].is_intra;
+
+    int i, j;
+    int bs;
+
+    top_boundary_strengths(s, x0, y0, 1 << log2_trafo_size, slice_or_tiles_up_boundary);
+
+    // bs for TU internal horizontal PU boundaries
+    if (log2_trafo_size > s->sps->log2_min_pu_size && !is_intra)
+        for (j = 8; j < (1 << log2_trafo_size); j += 8) {
+            int yp_pu = (y0 + j - 1) >> log2_min_pu_size;
+            int yq_pu = (y0 + j)     >> log2_min_pu_size;
+            int yp_tu = (y0 + j - 1) >> log2_min_tu_size;
+            int yq_tu = (y0 + j)     >> log2_min_tu_size;
+
+
+            for (i = 0; i < (1<<log2_trafo_size); i += 4) {
+                int x_pu = (x0 + i) >> log2_min_pu_size;
+                int x_tu = (x0 + i) >> log2_min_tu_size;
+                MvField *top  = &tab_mvf[yp_pu * pic_width_in_min_pu + x_pu];
+                MvField *curr = &tab_mvf[yq_pu * pic_width_in_min_pu + x_pu];
+                uint8_t top_cbf_luma  = s->cbf_luma[yp_tu * pic_width_in_min_tu + x_tu];
+                uint8_t curr_cbf_luma = s->cbf_luma[yq_tu * pic_width_in_min_tu + x_tu];
+                RefPicList* top_refPicList = ff_hevc_get_ref_list(s, s->ref, x0 + i, y0 + j - 1);
+
+                bs = boundary_strength(s, curr, curr_cbf_luma, top, top_cbf_luma, top_refPicList, 0);
+                if (s->sh.disable_deblocking_filter_flag == 1)
+                    bs = 0;
+                if (bs)
+                    s->horizontal_bs[((x0 + i) + (y0 + j) * s->bs_width) >> 2] = bs;
+            }
+        }
+
+    // bs for vertical TU boundaries
+    left_boundary_strengths(s, x0, y0, 1 << log2_trafo_size, slice_or_tiles_left_boundary);
 
     // bs for TU internal vertical PU boundaries
     if (log2_trafo_size > s->sps->log2_min_pu_size && !is_intra)
@@ -674,6 +702,39 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0, int l
             }
         }
 }
+
+void ff_hevc_deblocking_boundary_strengths_tiles(HEVCContext *s, int x_ctb, int y_ctb)
+{
+    int ctb_size    = 1 << s->sps->log2_ctb_size;
+    int ctb_width   = s->sps->ctb_width;
+    int ctb_addr_rs = (y_ctb >> s->sps->log2_ctb_size) * ctb_width +
+                      (x_ctb >> s->sps->log2_ctb_size);
+    int tile_id     = s->pps->tile_id[s->pps->ctb_addr_rs_to_ts[ctb_addr_rs]];
+    int i;
+
+    if (s->sh.disable_deblocking_filter_flag)
+        return;
+
+    if (y_ctb &&
+        tile_id != s->pps->tile_id[s->pps->ctb_addr_rs_to_ts[ctb_addr_rs - ctb_width]]) {
+        int length = FFMIN(ctb_size, s->sps->width - x_ctb);
+
+        memset(&s->horizontal_bs[(x_ctb + y_ctb * s->bs_width) >> 2], 0, length >> 2);
+        top_boundary_strengths(s, x_ctb, y_ctb, length, 2 |
+                               (s->tab_slice_address[ctb_addr_rs] !=
+                                s->tab_slice_address[ctb_addr_rs - ctb_width]));
+    }
+    if (x_ctb &&
+        tile_id != s->pps->tile_id[s->pps->ctb_addr_rs_to_ts[ctb_addr_rs - 1]]) {
+        int length = FFMIN(ctb_size, s->sps->height - y_ctb);
+
+        for (i = 0; i < length; i += 4)
+            s->vertical_bs[(x_ctb >> 3) + ((y_ctb + i) >> 2) * s->bs_width] = 0;
+        left_boundary_strengths(s, x_ctb, y_ctb, length, 2 |
+                                (s->tab_slice_address[ctb_addr_rs] !=
+                                 s->tab_slice_address[ctb_addr_rs - 1]));
+    }
+}
 #undef LUMA
 #undef CB
 #undef CR
@@ -691,8 +752,15 @@ void ff_hevc_hls_filters(HEVCContext *s, int x_ctb, int y_ctb, int ctb_size)
 {
     if (y_ctb && x_ctb)
         ff_hevc_hls_filter(s, x_ctb - ctb_size, y_ctb - ctb_size);
-    if (y_ctb && x_ctb >= s->sps->width - ctb_size)
+    if (y_ctb && x_ctb >= s->sps->width - ctb_size) {
         ff_hevc_hls_filter(s, x_ctb, y_ctb - ctb_size);
+        // the pixels of the lossless CUs are only put back after SAO at the end of the picture
+        if (!s->sps->sao_enabled ||
+            !(s->pps->transquant_bypass_enable_flag ||
+              (s->sps->pcm_enabled_flag && s->sps->pcm.loop_filter_disable_flag)))
+            ff_thread_report_progress(&s->ref->tf,
+                                      HEVC_ROW_PROGRESS(y_ctb - ctb_size, ctb_size), 0);
+    }
     if (x_ctb && y_ctb >= s->sps->height - ctb_size)
         ff_hevc_hls_filter(s, x_ctb - ctb_size, y_ctb);
 }
@@ -0,0 +1,354 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * HEVC DSP test: checks the optimized HEVCDSPContext functions against
+ * the C versions on random input.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/cpu.h"
+#include "libavutil/internal.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+
+#include "hevc.h"
+#include "hevcdsp.h"
+
+#undef printf
+
+#define ITERATIONS 200
+#define STRIDE     256
+#define ROWS       (MAX_PB_SIZE + 32)
+#define PIX_OFFSET (16 * STRIDE + 32)
+
+static AVLFG prng;
+
+DECLARE_ALIGNED(16, static uint8_t,  src0)[ROWS * STRIDE];
+DECLARE_ALIGNED(16, static uint8_t,  dst0)[ROWS * STRIDE];
+DECLARE_ALIGNED(16, static uint8_t,  dst1)[ROWS * STRIDE];
+DECLARE_ALIGNED(16, static int16_t,  mc0)[MAX_PB_SIZE * MAX_PB_SIZE];
+DECLARE_ALIGNED(16, static int16_t,  mc1)[MAX_PB_SIZE * MAX_PB_SIZE];
+DECLARE_ALIGNED(16, static int16_t,  coeffs0)[32 * 32];
+DECLARE_ALIGNED(16, static int16_t,  coeffs1)[32 * 32];
+DECLARE_ALIGNED(16, static int16_t,  mcbuffer)[(MAX_PB_SIZE + 7) * MAX_PB_SIZE];
+
+static int rnd(int max)
+{
+    return av_lfg_get(&prng) % max;
+}
+
+static void fill_pixels(uint8_t *buf, int size, int bit_depth)
+{
+    int i;
+
+    if (bit_depth > 8) {
+        uint16_t *buf16 = (uint16_t *)buf;
+        for (i = 0; i < size / 2; i++)
+            buf16[i] = av_lfg_get(&prng) & ((1 << bit_depth) - 1);
+    } else {
+        for (i = 0; i < size; i++)
+            buf[i] = av_lfg_get(&prng);
+    }
+}
+
+/* pixels around a random level, so that the content dependent filter
+ * decisions go both ways */
+static void fill_smooth(uint8_t *buf, int size, int bit_depth, int noise)
+{
+    int max = (1 << bit_depth) - 1;
+    int level = rnd(max + 1);
+    int i;
+
+    if (bit_depth > 8) {
+        uint16_t *buf16 = (uint16_t *)buf;
+        for (i = 0; i < size / 2; i++)
+            buf16[i] = av_clip(level + rnd(2 * noise + 1) - noise, 0, max);
+    } else {
+        for (i = 0; i < size; i++)
+            buf[i] = av_clip(level + rnd(2 * noise + 1) - noise, 0, max);
+    }
+}
+
+static void fill_int16(int16_t *buf, int size, int range)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        buf[i] = range ? rnd(2 * range + 1) - range : (int16_t)av_lfg_get(&prng);
+}
+
+static int check(const char *name, int bit_depth, const void *a, const void *b,
+                 int size)
+{
+    if (memcmp(a, b, size)) {
+        printf("%s (%d-bit): mismatch\n", name, bit_depth);
+        return 1;
+    }
+    return 0;
+}
+
+static int test_mc(HEVCDSPContext *ref, HEVCDSPContext *opt, int bit_depth)
+{
+    static const int widths[] = { 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+    uint8_t *src = src0 + PIX_OFFSET;
+    int it, err = 0;
+
+    for (it = 0; it < ITERATIONS; it++) {
+        int w  = widths[rnd(FF_ARRAY_ELEMS(widths))];
+        int h  = widths[rnd(FF_ARRAY_ELEMS(widths))];
+        int mx = rnd(4), my = rnd(4);
+        int ex = rnd(8),  ey = rnd(8);
+
+        fill_pixels(src0, sizeof(src0), bit_depth);
+
+        memset(mc0, 0, sizeof(mc0));
+        memset(mc1, 0, sizeof(mc1));
+        ref->put_hevc_qpel[my][mx](mc0, MAX_PB_SIZE, src, STRIDE, w, h, mcbuffer);
+        opt->put_hevc_qpel[my][mx](mc1, MAX_PB_SIZE, src, STRIDE, w, h, mcbuffer);
+        err |= check("put_hevc_qpel", bit_depth, mc0, mc1, sizeof(mc0));
+
+        memset(mc0, 0, sizeof(mc0));
+        memset(mc1, 0, sizeof(mc1));
+        ref->put_hevc_epel[!!ey][!!ex](mc0, MAX_PB_SIZE, src, STRIDE, w, h,
+                                       ex, ey, mcbuffer);
+        opt->put_hevc_epel[!!ey][!!ex](mc1, MAX_PB_SIZE, src, STRIDE, w, h,
+                                       ex, ey, mcbuffer);
+        err |= check("put_hevc_epel", bit_depth, mc0, mc1, sizeof(mc0));
+    }
+    return err;
+}
+
+static int test_pred(HEVCDSPContext *ref, HEVCDSPContext *opt, int bit_depth)
+{
+    static const int widths[] = { 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+    uint8_t *dst_ref = dst0 + PIX_OFFSET;
+    uint8_t *dst_opt = dst1 + PIX_OFFSET;
+    int it, err = 0;
+
+    for (it = 0; it < ITERATIONS; it++) {
+        int w = widths[rnd(FF_ARRAY_ELEMS(widths))];
+        int h = widths[rnd(FF_ARRAY_ELEMS(widths))];
+        int range = it & 1 ? 0 : 1 << 14;
+
+        fill_int16(mc0, FF_ARRAY_ELEMS(mc0), range);
+        fill_int16(mc1, FF_ARRAY_ELEMS(mc1), range);
+        fill_pixels(dst0, sizeof(dst0), bit_depth);
+        memcpy(dst1, dst0, sizeof(dst0));
+        ref->put_unweighted_pred(dst_ref, STRIDE, mc0, MAX_PB_SIZE, w, h);
+        opt->put_unweighted_pred(dst_opt, STRIDE, mc0, MAX_PB_SIZE, w, h);
+        err |= check("put_unweighted_pred", bit_depth, dst0, dst1, sizeof(dst0));
+
+        ref->put_weighted_pred_avg(dst_ref, STRIDE, mc0, mc1, MAX_PB_SIZE, w, h);
+        opt->put_weighted_pred_avg(dst_opt, STRIDE, mc0, mc1, MAX_PB_SIZE, w, h);
+        err |= check("put_weighted_pred_avg", bit_depth, dst0, dst1, sizeof(dst0));
+    }
+    return err;
+}
+
+static int test_transform(HEVCDSPContext *ref, HEVCDSPContext *opt, int bit_depth)
+{
+    uint8_t *dst_ref = dst0 + PIX_OFFSET;
+    uint8_t *dst_opt = dst1 + PIX_OFFSET;
+    int it, i, err = 0;
+
+    for (it = 0; it < ITERATIONS; it++) {
+        int range = it & 1 ? 0 : 1 << (it & 15);
+
+        for (i = 0; i < 5; i++) {
+            void (*f_ref)(uint8_t *, int16_t *, ptrdiff_t);
+            void (*f_opt)(uint8_t *, int16_t *, ptrdiff_t);
+
+            f_ref = i < 4 ? ref->transform_add[i] : ref->transform_4x4_luma_add;
+            f_opt = i < 4 ? opt->transform_add[i] : opt->transform_4x4_luma_add;
+
+            fill_int16(coeffs0, FF_ARRAY_ELEMS(coeffs0), range);
+            memcpy(coeffs1, coeffs0, sizeof(coeffs0));
+            fill_pixels(dst0, sizeof(dst0), bit_depth);
+            memcpy(dst1, dst0, sizeof(dst0));
+            f_ref(dst_ref, coeffs0, STRIDE);
+            f_opt(dst_opt, coeffs1, STRIDE);
+            err |= check(i < 4 ? "transform_add" : "transform_4x4_luma_add",
+                         bit_depth, dst0, dst1, sizeof(dst0));
+        }
+    }
+    return err;
+}
+
+static int test_loop_filter(HEVCDSPContext *ref, HEVCDSPContext *opt, int bit_depth)
+{
+    uint8_t *dst_ref = dst0 + PIX_OFFSET;
+    uint8_t *dst_opt = dst1 + PIX_OFFSET;
+    int it, err = 0;
+
+    for (it = 0; it < ITERATIONS; it++) {
+        int tc[2]        = { rnd(30) - 4, rnd(30) - 4 };
+        uint8_t no_p[2]  = { rnd(4) == 0, rnd(4) == 0 };
+        uint8_t no_q[2]  = { rnd(4) == 0, rnd(4) == 0 };
+
+        fill_pixels(dst0, sizeof(dst0), bit_depth);
+        memcpy(dst1, dst0, sizeof(dst0));
+        ref->hevc_h_loop_filter_chroma(dst_ref, STRIDE, tc, no_p, no_q);
+        opt->hevc_h_loop_filter_chroma(dst_opt, STRIDE, tc, no_p, no_q);
+        err |= check("hevc_h_loop_filter_chroma", bit_depth, dst0, dst1, sizeof(dst0));
+
+        ref->hevc_v_loop_filter_chroma(dst_ref, STRIDE, tc, no_p, no_q);
+        opt->hevc_v_loop_filter_chroma(dst_opt, STRIDE, tc, no_p, no_q);
+        err |= check("hevc_v_loop_filter_chroma", bit_depth, dst0, dst1, sizeof(dst0));
+    }
+    return err;
+}
+
+static int test_loop_filter_luma(HEVCDSPContext *ref, HEVCDSPContext *opt,
+                                 int bit_depth)
+{
+    static const int noise[] = { 0, 1, 2, 4, 8, 32 };
+    uint8_t *dst_ref = dst0 + PIX_OFFSET;
+    uint8_t *dst_opt = dst1 + PIX_OFFSET;
+    int it, err = 0;
+
+    for (it = 0; it < ITERATIONS * 4; it++) {
+        int beta[2]      = { rnd(65), rnd(65) };
+        int tc[2]        = { rnd(25), rnd(25) };
+        uint8_t no_p[2]  = { rnd(4) == 0, rnd(4) == 0 };
+        uint8_t no_q[2]  = { rnd(4) == 0, rnd(4) == 0 };
+
+        fill_smooth(dst0, sizeof(dst0), bit_depth,
+                    noise[rnd(FF_ARRAY_ELEMS(noise))] << (bit_depth - 8));
+        memcpy(dst1, dst0, sizeof(dst0));
+        ref->hevc_h_loop_filter_luma(dst_ref, STRIDE, beta, tc, no_p, no_q);
+        opt->hevc_h_loop_filter_luma(dst_opt, STRIDE, beta, tc, no_p, no_q);
+        err |= check("hevc_h_loop_filter_luma", bit_depth, dst0, dst1, sizeof(dst0));
+
+        ref->hevc_v_loop_filter_luma(dst_ref, STRIDE, beta, tc, no_p, no_q);
+        opt->hevc_v_loop_filter_luma(dst_opt, STRIDE, beta, tc, no_p, no_q);
+        err |= check("hevc_v_loop_filter_luma", bit_depth, dst0, dst1, sizeof(dst0));
+    }
+    return err;
+}
+
+static int test_sao_band(HEVCDSPContext *ref, HEVCDSPContext *opt, int bit_depth)
+{
+    uint8_t *src     = src0 + PIX_OFFSET;
+    uint8_t *dst_ref = dst0 + PIX_OFFSET;
+    uint8_t *dst_opt = dst1 + PIX_OFFSET;
+    int max_offset   = (1 << (FFMIN(bit_depth, 10) - 5)) - 1;
+    int it, k, err = 0;
+
+    for (it = 0; it < ITERATIONS; it++) {
+        SAOParams sao    = { { 0 } };
+        int borders[4]   = { rnd(2), rnd(2), rnd(2), rnd(2) };
+        int c_idx        = rnd(3);
+        int size         = c_idx ? 32 : 64;
+        int class        = rnd(4);
+
+        sao.band_position[c_idx] = rnd(32);
+        for (k = 1; k < 5; k++)
+            sao.offset_val[c_idx][k] = rnd(2 * max_offset + 1) - max_offset;
+
+        fill_pixels(src0, sizeof(src0), bit_depth);
+        memset(dst0, 0, sizeof(dst0));
+        memset(dst1, 0, sizeof(dst1));
+        ref->sao_band_filter[class](dst_ref, src, STRIDE, &sao, borders,
+                                    size, size, c_idx);
+        opt->sao_band_filter[class](dst_opt, src, STRIDE, &sao, borders,
+                                    size, size, c_idx);
+        err |= check("sao_band_filter", bit_depth, dst0, dst1, sizeof(dst0));
+    }
+    return err;
+}
+
+static int test_sao_edge(HEVCDSPContext *ref, HEVCDSPContext *opt, int bit_depth)
+{
+    uint8_t *src     = src0 + PIX_OFFSET;
+    uint8_t *dst_ref = dst0 + PIX_OFFSET;
+    uint8_t *dst_opt = dst1 + PIX_OFFSET;
+    int max_offset   = (1 << (FFMIN(bit_depth, 10) - 5)) - 1;
+    int it, k, err = 0;
+
+    for (it = 0; it < ITERATIONS * 2; it++) {
+        SAOParams sao    = { { 0 } };
+        int borders[4]   = { rnd(2), rnd(2), rnd(2), rnd(2) };
+        int c_idx        = rnd(3);
+        int size         = c_idx ? 32 : 64;
+        int class        = rnd(4);
+        int vert_edge    = rnd(2), horiz_edge = rnd(2), diag_edge = rnd(2);
+
+        sao.eo_class[c_idx] = rnd(4);
+        for (k = 1; k < 5; k++)
+            sao.offset_val[c_idx][k] = rnd(2 * max_offset + 1) - max_offset;
+
+        if (it & 1)
+            fill_smooth(src0, sizeof(src0), bit_depth, 1);
+        else
+            fill_pixels(src0, sizeof(src0), bit_depth);
+        memset(dst0, 0, sizeof(dst0));
+        memset(dst1, 0, sizeof(dst1));
+        ref->sao_edge_filter[class](dst_ref, src, STRIDE, &sao, borders,
+                                    size, size, c_idx,
+                                    vert_edge, horiz_edge, diag_edge);
+        opt->sao_edge_filter[class](dst_opt, src, STRIDE, &sao, borders,
+                                    size, size, c_idx,
+                                    vert_edge, horiz_edge, diag_edge);
+        err |= check("sao_edge_filter", bit_depth, dst0, dst1, sizeof(dst0));
+    }
+    return err;
+}
+
+int main(void)
+{
+    static const int bit_depths[] = { 8, 10 };
+    /* each instruction set level is tested without the ones above it,
+     * so that its functions are not all overridden */
+    static const int cpu_levels[] = {
+        AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMXEXT | AV_CPU_FLAG_SSE | AV_CPU_FLAG_SSE2,
+        AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMXEXT | AV_CPU_FLAG_SSE | AV_CPU_FLAG_SSE2 |
+        AV_CPU_FLAG_SSE3 | AV_CPU_FLAG_SSSE3,
+        -1,
+    };
+    HEVCDSPContext ref, opt;
+    int cpu_flags = av_get_cpu_flags();
+    int i, j, err = 0;
+
+    av_lfg_init(&prng, 1);
+
+    for (j = 0; j < FF_ARRAY_ELEMS(cpu_levels); j++) {
+        for (i = 0; i < FF_ARRAY_ELEMS(bit_depths); i++) {
+            int bit_depth = bit_depths[i];
+
+            av_force_cpu_flags(0);
+            ff_hevc_dsp_init(&ref, bit_depth);
+            av_force_cpu_flags(cpu_flags & cpu_levels[j]);
+            ff_hevc_dsp_init(&opt, bit_depth);
+
+            err |= test_mc(&ref, &opt, bit_depth);
+            err |= test_pred(&ref, &opt, bit_depth);
+            err |= test_transform(&ref, &opt, bit_depth);
+            err |= test_loop_filter(&ref, &opt, bit_depth);
+            err |= test_loop_filter_luma(&ref, &opt, bit_depth);
+            err |= test_sao_band(&ref, &opt, bit_depth);
+            err |= test_sao_edge(&ref, &opt, bit_depth);
+        }
+    }
+
+    return err;
+}
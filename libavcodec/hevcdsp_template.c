@@ -193,14 +193,14 @@ static void FUNC(transform_4x4_luma_add)(uint8_t *_dst, int16_t *coeffs, ptrdiff
 
 #define TR_4(dst, src, dstep, sstep, assign)                                    \
     do {                                                                        \
-        const int e0 = transform[8*0][0] * src[0*sstep] +                       \
-                       transform[8*2][0] * src[2*sstep];                        \
-        const int e1 = transform[8*0][1] * src[0*sstep] +                       \
-                       transform[8*2][1] * src[2*sstep];                        \
-        const int o0 = transform[8*1][0] * src[1*sstep] +                       \
-                       transform[8*3][0] * src[3*sstep];                        \
-        const int o1 = transform[8*1][1] * src[1*sstep] +                       \
-                       transform[8*3][1] * src[3*sstep];                        \
+        const int e0 = ff_hevc_transform[8*0][0] * src[0*sstep] +               \
+                       ff_hevc_transform[8*2][0] * src[2*sstep];                \
+        const int e1 = ff_hevc_transform[8*0][1] * src[0*sstep] +               \
+                       ff_hevc_transform[8*2][1] * src[2*sstep];                \
+        const int o0 = ff_hevc_transform[8*1][0] * src[1*sstep] +               \
+                       ff_hevc_transform[8*3][0] * src[3*sstep];                \
+        const int o1 = ff_hevc_transform[8*1][1] * src[1*sstep] +               \
+                       ff_hevc_transform[8*3][1] * src[3*sstep];                \
                                                                                 \
         assign(dst[0*dstep], e0 + o0);                                          \
         assign(dst[1*dstep], e1 + o1);                                          \
@@ -233,50 +233,50 @@ static void FUNC(transform_4x4_add)(uint8_t *_dst, int16_t *coeffs, ptrdiff_t _s
     }
 }
 
-#define TR_8(dst, src, dstep, sstep, assign)                \
-    do {                                                    \
-        int i, j;                                           \
-        int e_8[4];                                         \
-        int o_8[4] = { 0 };                                 \
-        for (i = 0; i < 4; i++)                             \
-            for (j = 1; j < 8; j += 2)                      \
-                o_8[i] += transform[4*j][i] * src[j*sstep]; \
-        TR_4(e_8, src, 1, 2*sstep, SET);                    \
-                                                            \
-        for (i = 0; i < 4; i++) {                           \
-            assign(dst[i*dstep], e_8[i] + o_8[i]);          \
-            assign(dst[(7-i)*dstep], e_8[i] - o_8[i]);      \
-        }                                                   \
+#define TR_8(dst, src, dstep, sstep, assign)                        \
+    do {                                                            \
+        int i, j;                                                   \
+        int e_8[4];                                                 \
+        int o_8[4] = { 0 };                                         \
+        for (i = 0; i < 4; i++)                                     \
+            for (j = 1; j < 8; j += 2)                              \
+                o_8[i] += ff_hevc_transform[4*j][i] * src[j*sstep]; \
+        TR_4(e_8, src, 1, 2*sstep, SET);                            \
+                                                                    \
+        for (i = 0; i < 4; i++) {                                   \
+            assign(dst[i*dstep], e_8[i] + o_8[i]);                  \
+            assign(dst[(7-i)*dstep], e_8[i] - o_8[i]);              \
+        }                                                           \
     } while (0)
-#define TR_16(dst, src, dstep, sstep, assign)                   \
-    do {                                                        \
-        int i, j;                                               \
-        int e_16[8];                                            \
-        int o_16[8] = { 0 };                                    \
-        for (i = 0; i < 8; i++)                                 \
-            for (j = 1; j < 16; j += 2)                         \
-                o_16[i] += transform[2*j][i] * src[j*sstep];    \
-        TR_8(e_16, src, 1, 2*sstep, SET);                       \
-                                                                \
-        for (i = 0; i < 8; i++) {                               \
-            assign(dst[i*dstep], e_16[i] + o_16[i]);            \
-            assign(dst[(15-i)*dstep], e_16[i] - o_16[i]);       \
-        }                                                       \
+#define TR_16(dst, src, dstep, sstep, assign)                        \
+    do {                                                             \
+        int i, j;                                                    \
+        int e_16[8];                                                 \
+        int o_16[8] = { 0 };                                         \
+        for (i = 0; i < 8; i++)                                      \
+            for (j = 1; j < 16; j += 2)                              \
+                o_16[i] += ff_hevc_transform[2*j][i] * src[j*sstep]; \
+        TR_8(e_16, src, 1, 2*sstep, SET);                            \
+                                                                     \
+        for (i = 0; i < 8; i++) {                                    \
+            assign(dst[i*dstep], e_16[i] + o_16[i]);                 \
+            assign(dst[(15-i)*dstep], e_16[i] - o_16[i]);            \
+        }                                                            \
     } while (0)
-#define TR_32(dst, src, dstep, sstep, assign)               \
-    do {                                                    \
-        int i, j;                                           \
-        int e_32[16];                                       \
-        int o_32[16] = { 0 };                               \
-        for (i = 0; i < 16; i++)                            \
-            for (j = 1; j < 32; j += 2)                     \
-                o_32[i] += transform[j][i] * src[j*sstep];  \
-        TR_16(e_32, src, 1, 2*sstep, SET);                \
-                                                            \
-        for (i = 0; i < 16; i++) {                          \
-            assign(dst[i*dstep], e_32[i] + o_32[i]);        \
-            assign(dst[(31-i)*dstep], e_32[i] - o_32[i]);   \
-        }                                                   \
+#define TR_32(dst, src, dstep, sstep, assign)                      \
+    do {                                                           \
+        int i, j;                                                  \
+        int e_32[16];                                              \
+        int o_32[16] = { 0 };                                      \
+        for (i = 0; i < 16; i++)                                   \
+            for (j = 1; j < 32; j += 2)                            \
+                o_32[i] += ff_hevc_transform[j][i] * src[j*sstep]; \
+        TR_16(e_32, src, 1, 2*sstep, SET);                         \
+                                                                   \
+        for (i = 0; i < 16; i++) {                                 \
+            assign(dst[i*dstep], e_32[i] + o_32[i]);               \
+            assign(dst[(31-i)*dstep], e_32[i] - o_32[i]);          \
+        }                                                          \
     } while (0)
 
 #define TR_8_1(dst, src) TR_8(dst, src, 8, 8, SCALE)
@@ -335,15 +335,15 @@ static void FUNC(transform_16x16_add)(uint8_t *_dst, int16_t *coeffs, ptrdiff_t
 
 static void FUNC(transform_32x32_add)(uint8_t *_dst, int16_t *coeffs, ptrdiff_t _stride)
 {
-#define IT32x32_even(i,w) ( src[ 0*w] * transform[ 0][i] ) + ( src[16*w] * transform[16][i] )
-#define IT32x32_odd(i,w)  ( src[ 8*w] * transform[ 8][i] ) + ( src[24*w] * transform[24][i] )
-#define IT16x16(i,w)      ( src[ 4*w] * transform[ 4][i] ) + ( src[12*w] * transform[12][i] ) + ( src[20*w] * transform[20][i] ) + ( src[28*w] * transform[28][i] )
-#define IT8x8(i,w)        ( src[ 2*w] * transform[ 2][i] ) + ( src[ 6*w] * transform[ 6][i] ) + ( src[10*w] * transform[10][i] ) + ( src[14*w] * transform[14][i] ) + \
-                          ( src[18*w] * transform[18][i] ) + ( src[22*w] * transform[22][i] ) + ( src[26*w] * transform[26][i] ) + ( src[30*w] * transform[30][i] )
-#define IT4x4(i,w)        ( src[ 1*w] * transform[ 1][i] ) + ( src[ 3*w] * transform[ 3][i] ) + ( src[ 5*w] * transform[ 5][i] ) + ( src[ 7*w] * transform[ 7][i] ) + \
-                          ( src[ 9*w] * transform[ 9][i] ) + ( src[11*w] * transform[11][i] ) + ( src[13*w] * transform[13][i] ) + ( src[15*w] * transform[15][i] ) + \
-                          ( src[17*w] * transform[17][i] ) + ( src[19*w] * transform[19][i] ) + ( src[21*w] * transform[21][i] ) + ( src[23*w] * transform[23][i] ) + \
-                          ( src[25*w] * transform[25][i] ) + ( src[27*w] * transform[27][i] ) + ( src[29*w] * transform[29][i] ) + ( src[31*w] * transform[31][i] )
+#define IT32x32_even(i,w) ( src[ 0*w] * ff_hevc_transform[ 0][i] ) + ( src[16*w] * ff_hevc_transform[16][i] )
+#define IT32x32_odd(i,w)  ( src[ 8*w] * ff_hevc_transform[ 8][i] ) + ( src[24*w] * ff_hevc_transform[24][i] )
+#define IT16x16(i,w)      ( src[ 4*w] * ff_hevc_transform[ 4][i] ) + ( src[12*w] * ff_hevc_transform[12][i] ) + ( src[20*w] * ff_hevc_transform[20][i] ) + ( src[28*w] * ff_hevc_transform[28][i] )
+#define IT8x8(i,w)        ( src[ 2*w] * ff_hevc_transform[ 2][i] ) + ( src[ 6*w] * ff_hevc_transform[ 6][i] ) + ( src[10*w] * ff_hevc_transform[10][i] ) + ( src[14*w] * ff_hevc_transform[14][i] ) + \
+                          ( src[18*w] * ff_hevc_transform[18][i] ) + ( src[22*w] * ff_hevc_transform[22][i] ) + ( src[26*w] * ff_hevc_transform[26][i] ) + ( src[30*w] * ff_hevc_transform[30][i] )
+#define IT4x4(i,w)        ( src[ 1*w] * ff_hevc_transform[ 1][i] ) + ( src[ 3*w] * ff_hevc_transform[ 3][i] ) + ( src[ 5*w] * ff_hevc_transform[ 5][i] ) + ( src[ 7*w] * ff_hevc_transform[ 7][i] ) + \
+                          ( src[ 9*w] * ff_hevc_transform[ 9][i] ) + ( src[11*w] * ff_hevc_transform[11][i] ) + ( src[13*w] * ff_hevc_transform[13][i] ) + ( src[15*w] * ff_hevc_transform[15][i] ) + \
+                          ( src[17*w] * ff_hevc_transform[17][i] ) + ( src[19*w] * ff_hevc_transform[19][i] ) + ( src[21*w] * ff_hevc_transform[21][i] ) + ( src[23*w] * ff_hevc_transform[23][i] ) + \
+                          ( src[25*w] * ff_hevc_transform[25][i] ) + ( src[27*w] * ff_hevc_transform[27][i] ) + ( src[29*w] * ff_hevc_transform[29][i] ) + ( src[31*w] * ff_hevc_transform[31][i] )
     int i;
     pixel *dst = (pixel*)_dst;
     ptrdiff_t stride = _stride / sizeof(pixel);
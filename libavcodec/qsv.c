@@ -31,6 +31,7 @@
 #include "internal.h"
 #include "avcodec.h"
 #include "qsv.h"
+#include "qsv_internal.h"
 
 int ff_qsv_error(int mfx_err)
 {
@@ -84,3 +85,129 @@ int ff_qsv_codec_id_to_mfx(enum AVCodecID codec_id)
     return AVERROR(ENOSYS);
 }
 
+
+int ff_qsv_sync(AVCodecContext *avctx, mfxSession session, mfxSyncPoint sync,
+                int block, int64_t *time_blocked)
+{
+    int64_t t = 0;
+    int ret;
+
+    if (block)
+        t = av_gettime();
+
+    ret = MFXVideoCORE_SyncOperation(session, sync,
+                                     block ? SYNC_TIME_DEFAULT : 0);
+    av_log(avctx, AV_LOG_DEBUG, "MFXVideoCORE_SyncOperation(): %d\n", ret);
+
+    if (block)
+        *time_blocked += av_gettime() - t;
+    else if (ret == MFX_WRN_IN_EXECUTION)
+        return AVERROR(EAGAIN);
+
+    return ff_qsv_error(ret);
+}
+
+typedef struct QSVSessionGroup {
+    int id;
+    int refs;
+    mfxSession session;
+    struct QSVSessionGroup *next;
+} QSVSessionGroup;
+
+/* Only used from codec init and close, which hold the avcodec lock. */
+static QSVSessionGroup *session_groups;
+
+static mfxSession get_group_session(AVCodecContext *avctx, int id)
+{
+    mfxVersion ver = { { QSV_VERSION_MINOR, QSV_VERSION_MAJOR } };
+    QSVSessionGroup *g;
+    int ret;
+
+    for (g = session_groups; g; g = g->next) {
+        if (g->id == id) {
+            g->refs++;
+            return g->session;
+        }
+    }
+
+    if (!(g = av_mallocz(sizeof(*g))))
+        return NULL;
+
+    ret = MFXInit(MFX_IMPL_AUTO_ANY, &ver, &g->session);
+    av_log(avctx, AV_LOG_DEBUG, "MFXInit(): %d\n", ret);
+    if (ret < 0) {
+        av_free(g);
+        return NULL;
+    }
+
+    g->id   = id;
+    g->refs = 1;
+    g->next = session_groups;
+    session_groups = g;
+
+    return g->session;
+}
+
+static void release_group_session(int id)
+{
+    QSVSessionGroup **p = &session_groups;
+    QSVSessionGroup *g;
+
+    while (*p && (*p)->id != id)
+        p = &(*p)->next;
+
+    if (!(g = *p) || --g->refs)
+        return;
+
+    *p = g->next;
+    MFXClose(g->session);
+    av_free(g);
+}
+
+int ff_qsv_init_session(AVCodecContext *avctx, mfxSession *session,
+                        int *group)
+{
+    mfxVersion ver       = { { QSV_VERSION_MINOR, QSV_VERSION_MAJOR } };
+    AVQSVContext *hwctx  = avctx->hwaccel_context;
+    mfxSession parent    = NULL;
+    int ret;
+
+    ret = MFXInit(MFX_IMPL_AUTO_ANY, &ver, session);
+    av_log(avctx, AV_LOG_DEBUG, "MFXInit(): %d\n", ret);
+    if (ret < 0)
+        return ff_qsv_error(ret);
+
+    if (hwctx && hwctx->session) {
+        parent = hwctx->session;
+        *group = 0;
+    } else if (*group) {
+        if (!(parent = get_group_session(avctx, *group)))
+            *group = 0;
+    }
+
+    if (!parent)
+        return 0;
+
+    ret = MFXJoinSession(parent, *session);
+    av_log(avctx, AV_LOG_DEBUG, "MFXJoinSession(): %d\n", ret);
+    if (ret < 0) {
+        av_log(avctx, AV_LOG_WARNING,
+               "Could not join the parent session, using a separate one\n");
+        if (*group)
+            release_group_session(*group);
+        *group = 0;
+        return 0;
+    }
+
+    return 1;
+}
+
+void ff_qsv_close_session(mfxSession session, int joined, int group)
+{
+    if (joined)
+        MFXDisjoinSession(session);
+    MFXClose(session);
+
+    if (group)
+        release_group_session(group);
+}
@@ -1,44 +1,62 @@
 /*
- * Intel MediaSDK QSV utility functions
+ * Intel MediaSDK QSV public API
  *
- * copyright (c) 2013 Luca Barbato
+ * This file is part of FFmpeg.
  *
- * This file is part of Libav.
- *
- * Libav is free software; you can redistribute it and/or
+ * FFmpeg is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
  * License as published by the Free Software Foundation; either
  * version 2.1 of the License, or (at your option) any later version.
  *
- * Libav is distributed in the hope that it will be useful,
+ * FFmpeg is distributed in the hope that it will be useful,
  * but WITHOUT ANY WARRANTY; without even the implied warranty of
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
  * Lesser General Public License for more details.
  *
  * You should have received a copy of the GNU Lesser General Public
- * License along with Libav; if not, write to the Free Software
+ * License along with FFmpeg; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
 #ifndef AVCODEC_QSV_H
 #define AVCODEC_QSV_H
 
-#include <stdint.h>
-#include <sys/types.h>
-#include <mfx/mfxvideo.h>
-
-#include "libavutil/avutil.h"
-
-#define QSV_VERSION_MAJOR 1
-#define QSV_VERSION_MINOR 1
-
-#define ASYNC_DEPTH_DEFAULT 4       // internal parallelism
-#define SYNC_TIME_DEFAULT 5 * 1000  // 5s
-#define TIMEOUT_DEFAULT 5 * 1000    // 5s
+/**
+ * @file
+ * @ingroup lavc_codec_hwaccel_qsv
+ * Public libavcodec QSV header.
+ */
 
+#include <mfx/mfxvideo.h>
 
-int ff_qsv_error(int mfx_err);
+/**
+ * @defgroup lavc_codec_hwaccel_qsv QSV
+ * @ingroup lavc_codec_hwaccel
+ *
+ * @{
+ */
 
-int ff_qsv_codec_id_to_mfx(enum AVCodecID codec_id);
+/**
+ * This structure lets several QSV decoders and encoders run on one device
+ * scheduler.
+ *
+ * The application may make it available as AVCodecContext.hwaccel_context
+ * before opening a QSV codec. The same structure can be shared by any
+ * number of codec contexts.
+ */
+typedef struct AVQSVContext {
+    /**
+     * Parent session. Every codec opened with this context creates its own
+     * session and joins it to the parent with MFXJoinSession(). The parent
+     * must stay valid until all these codecs are closed, libavcodec never
+     * closes it.
+     *
+     * - encoding: Set by user.
+     * - decoding: Set by user.
+     */
+    mfxSession session;
+} AVQSVContext;
+
+/* @} */
 
 #endif /* AVCODEC_QSV_H */
@@ -0,0 +1,77 @@
+/*
+ * Intel MediaSDK QSV utility functions
+ *
+ * copyright (c) 2013 Luca Barbato
+ *
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_QSV_INTERNAL_H
+#define AVCODEC_QSV_INTERNAL_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <mfx/mfxvideo.h>
+
+#include "libavutil/avutil.h"
+
+#define QSV_VERSION_MAJOR 1
+#define QSV_VERSION_MINOR 1
+
+#define ASYNC_DEPTH_DEFAULT 4       // internal parallelism
+#define SYNC_TIME_DEFAULT 5 * 1000  // 5s
+#define TIMEOUT_DEFAULT 5 * 1000    // 5s
+
+
+int ff_qsv_error(int mfx_err);
+
+int ff_qsv_codec_id_to_mfx(enum AVCodecID codec_id);
+
+/**
+ * Create the session of a codec and join it to its parent, taken from
+ * AVQSVContext.session if avctx->hwaccel_context is set, or else from the
+ * session group *group if it is not 0. Codecs of the same group share a
+ * parent that lives as long as one of them is open.
+ *
+ * *group is reset to 0 if the session could not be joined and runs on its
+ * own, it must be passed to ff_qsv_close_session() afterwards.
+ *
+ * @return 1 if the session was joined to a parent, 0 if it runs on its own,
+ *         a negative error code otherwise
+ */
+int ff_qsv_init_session(AVCodecContext *avctx, mfxSession *session,
+                        int *group);
+
+/**
+ * Close a session created by ff_qsv_init_session(), disjoining it from its
+ * parent first if joined is set.
+ */
+void ff_qsv_close_session(mfxSession session, int joined, int group);
+
+/**
+ * Complete the task behind a sync point.
+ *
+ * @param block        wait up to SYNC_TIME_DEFAULT for the device if set,
+ *                     otherwise only poll it
+ * @param time_blocked incremented by the microseconds spent waiting
+ * @return 0 once the task is done, AVERROR(EAGAIN) if polling found it
+ *         still running, another negative error code on failure
+ */
+int ff_qsv_sync(AVCodecContext *avctx, mfxSession session, mfxSyncPoint sync,
+                int block, int64_t *time_blocked);
+
+#endif /* AVCODEC_QSV_INTERNAL_H */
@@ -30,28 +30,64 @@
 #include "libavutil/time.h"
 #include "internal.h"
 #include "avcodec.h"
-#include "qsv.h"
+#include "qsv_internal.h"
 #include "qsvdec.h"
 
 
-static int realloc_ts(QSVDecContext *q, int old_nmemb, int new_nmemb)
+static unsigned ts_hash(QSVDecContext *q, int64_t pts)
 {
-    QSVDecTimeStamp *tmp = av_realloc_array(q->ts, new_nmemb, sizeof(*q->ts));
-    if (!tmp)
+    return ((uint64_t)pts * UINT64_C(0x9E3779B97F4A7C15) >> 32) & (q->nb_ts - 1);
+}
+
+static void insert_ts(QSVDecContext *q, int64_t pts, int64_t dts)
+{
+    unsigned i = ts_hash(q, pts);
+
+    while (q->ts[i].pts != AV_NOPTS_VALUE)
+        i = (i + 1) & (q->nb_ts - 1);
+
+    q->ts[i].pts = pts;
+    q->ts[i].dts = dts;
+    q->nb_ts_used++;
+}
+
+static int realloc_ts(QSVDecContext *q, int new_nmemb)
+{
+    QSVDecTimeStamp *old = q->ts;
+    int old_nmemb        = q->nb_ts;
+    int i;
+
+    q->ts = av_malloc_array(new_nmemb, sizeof(*q->ts));
+    if (!q->ts) {
+        q->ts = old;
         return AVERROR(ENOMEM);
+    }
 
-    q->ts = tmp;
-    q->nb_ts = new_nmemb;
+    q->nb_ts      = new_nmemb;
+    q->nb_ts_used = 0;
 
-    for (int i = old_nmemb; i < q->nb_ts; i++)
+    for (i = 0; i < q->nb_ts; i++)
         q->ts[i].pts = q->ts[i].dts = AV_NOPTS_VALUE;
 
+    for (i = 0; i < old_nmemb; i++)
+        if (old[i].pts != AV_NOPTS_VALUE)
+            insert_ts(q, old[i].pts, old[i].dts);
+
+    av_free(old);
+
     return 0;
 }
 
+static void free_ts(QSVDecContext *q)
+{
+    av_freep(&q->ts);
+    q->nb_ts      = 0;
+    q->nb_ts_used = 0;
+}
+
 static int get_dts(QSVDecContext *q, int64_t pts, int64_t *dts)
 {
-    int i;
+    unsigned i, j, k, mask = q->nb_ts - 1;
 
     if (q->ts_by_qsv) {
         *dts = pts;
@@ -63,11 +99,13 @@ static int get_dts(QSVDecContext *q, int64_t pts, int64_t *dts)
         return 0;
     }
 
-    for (i = 0; i < q->nb_ts; i++)
-        if (q->ts[i].pts == pts)
-            break;
+    if (q->nb_ts) {
+        i = ts_hash(q, pts);
+        while (q->ts[i].pts != AV_NOPTS_VALUE && q->ts[i].pts != pts)
+            i = (i + 1) & mask;
+    }
 
-    if (i == q->nb_ts) {
+    if (!q->nb_ts || q->ts[i].pts != pts) {
         av_log(q, AV_LOG_ERROR,
                "Requested pts %"PRId64" does not match any dts\n", pts);
         return AVERROR_BUG;
@@ -75,14 +113,25 @@ static int get_dts(QSVDecContext *q, int64_t pts, int64_t *dts)
 
     *dts = q->ts[i].dts;
 
+    // Close the gap so that the probe sequences of the following entries
+    // stay unbroken
+    for (j = (i + 1) & mask; q->ts[j].pts != AV_NOPTS_VALUE; j = (j + 1) & mask) {
+        k = ts_hash(q, q->ts[j].pts);
+        if (i <= j ? (k <= i || k > j) : (k <= i && k > j)) {
+            q->ts[i] = q->ts[j];
+            i = j;
+        }
+    }
+
     q->ts[i].pts = AV_NOPTS_VALUE;
+    q->nb_ts_used--;
 
     return 0;
 }
 
 static int put_dts(QSVDecContext *q, int64_t pts, int64_t dts)
 {
-    int i, ret;
+    int ret;
 
     if (q->ts_by_qsv) {
         q->ts_cnt++;
@@ -92,19 +141,18 @@ static int put_dts(QSVDecContext *q, int64_t pts, int64_t dts)
     if (pts == AV_NOPTS_VALUE)
         return 0;
 
-    for (i = 0; i < q->nb_ts; i++)
-        if (q->ts[i].pts == AV_NOPTS_VALUE)
-            break;
+    if ((q->nb_ts_used + 1) * 2 > q->nb_ts) {
+        int size = q->nb_ts ? q->nb_ts * 2 : 16;
+
+        while (size < 2 * q->req.NumFrameSuggested)
+            size *= 2;
 
-    if (i == q->nb_ts) {
-        ret = realloc_ts(q, q->nb_ts,
-                         q->nb_ts ? q->nb_ts * 2 : q->req.NumFrameSuggested);
+        ret = realloc_ts(q, size);
         if (ret < 0)
             return ret;
     }
 
-    q->ts[i].pts = pts;
-    q->ts[i].dts = dts;
+    insert_ts(q, pts, dts);
     q->ts_cnt++;
 
     return 0;
@@ -137,42 +185,56 @@ static int set_bitstream_data(QSVDecContext *q, QSVDecBitstreamList *list, AVPac
     return 0;
 }
 
+static QSVDecBitstreamList *bitstream_to_list(mfxBitstream *bs)
+{
+    return (QSVDecBitstreamList *)bs;
+}
+
 static mfxBitstream *get_bitstream_from_packet(QSVDecContext *q,
                                                AVPacket *pkt)
 {
-    QSVDecBitstreamList **pool = &q->bs_pool;
-    QSVDecBitstreamList *list;
-
-    while (*pool && (*pool)->bs.MaxLength)
-        pool = &(*pool)->pool;
+    QSVDecBitstreamList *list = q->bs_free;
 
-    if (!(*pool))
-        if (!(*pool = av_mallocz(sizeof(QSVDecBitstreamList))))
+    if (list) {
+        q->bs_free = list->next;
+    } else {
+        if (!(list = av_mallocz(sizeof(QSVDecBitstreamList))))
             return NULL;
+        list->pool = q->bs_pool;
+        q->bs_pool = list;
+    }
 
-    list = *pool;
+    list->next = NULL;
 
-    if (set_bitstream_data(q, list, pkt) < 0)
+    if (set_bitstream_data(q, list, pkt) < 0) {
+        list->next = q->bs_free;
+        q->bs_free = list;
         return NULL;
+    }
 
     return &list->bs;
 }
 
-static void put_pending_bitstream(QSVDecContext *q, mfxBitstream *bs)
+static void release_bitstream(QSVDecContext *q, mfxBitstream *bs)
 {
-    QSVDecBitstreamList *list = q->bs_pool;
+    QSVDecBitstreamList *list = bitstream_to_list(bs);
 
-    while (list && &list->bs != bs)
-        list = list->pool;
+    bs->MaxLength = 0;
 
-    if (list) {
-        if (q->pending_dec_end)
-            q->pending_dec_end->next = list;
-        else
-            q->pending_dec = list;
+    list->next = q->bs_free;
+    q->bs_free = list;
+}
 
-        q->pending_dec_end = list;
-    }
+static void put_pending_bitstream(QSVDecContext *q, mfxBitstream *bs)
+{
+    QSVDecBitstreamList *list = bitstream_to_list(bs);
+
+    if (q->pending_dec_end)
+        q->pending_dec_end->next = list;
+    else
+        q->pending_dec = list;
+
+    q->pending_dec_end = list;
 }
 
 static mfxBitstream *get_pending_bitstream(QSVDecContext *q)
@@ -201,6 +263,11 @@ static void free_bitstream_pool(QSVDecContext *q)
             av_packet_unref(&list->pkt);
         av_freep(&list);
     }
+
+    q->bs_free         = NULL;
+    q->pending_dec     = NULL;
+    q->pending_dec_end = NULL;
+    q->bs              = NULL;
 }
 
 static int set_surface_data(AVCodecContext *avctx, QSVDecContext *q,
@@ -235,38 +302,98 @@ static int set_surface_data(AVCodecContext *avctx, QSVDecContext *q,
     return 0;
 }
 
+static QSVDecSurfaceList *surface_to_list(mfxFrameSurface1 *surf)
+{
+    return (QSVDecSurfaceList *)surf;
+}
+
+static void push_free_surface(QSVDecContext *q, QSVDecSurfaceList *list)
+{
+    if (list->queued)
+        return;
+
+    list->queued    = 1;
+    list->next_free = NULL;
+
+    if (q->surf_free_end)
+        q->surf_free_end->next_free = list;
+    else
+        q->surf_free = list;
+
+    q->surf_free_end = list;
+    q->nb_surf_free++;
+}
+
+static QSVDecSurfaceList *pop_free_surface(QSVDecContext *q)
+{
+    QSVDecSurfaceList *list = q->surf_free;
+
+    q->surf_free = list->next_free;
+
+    if (!q->surf_free)
+        q->surf_free_end = NULL;
+
+    list->queued    = 0;
+    list->next_free = NULL;
+    q->nb_surf_free--;
+
+    return list;
+}
+
+/**
+ * Surfaces are recycled in FIFO order, so the oldest released surface is
+ * tried first. Surfaces still locked by the SDK as references go back to
+ * the end of the queue and the ones waiting for output are dropped from it
+ * until release_surface(); the cost does not depend on the pool size.
+ */
 static mfxFrameSurface1 *get_surface(AVCodecContext *avctx, QSVDecContext *q)
 {
-    QSVDecSurfaceList **pool = &q->surf_pool;
-    QSVDecSurfaceList *list;
+    QSVDecSurfaceList *list = NULL;
+    int n = q->nb_surf_free;
     mfxFrameSurface1 *surf;
 
-    while (*pool && ((*pool)->surface.Data.Locked || (*pool)->sync))
-        pool = &(*pool)->pool;
+    while (n-- > 0) {
+        list = pop_free_surface(q);
+        if (!list->sync && !list->surface.Data.Locked)
+            break;
+        if (!list->sync)
+            push_free_surface(q, list);
+        list = NULL;
+    }
 
-    if (!(*pool))
-        if (!(*pool = av_mallocz(sizeof(QSVDecSurfaceList))))
+    if (!list) {
+        if (!(list = av_mallocz(sizeof(QSVDecSurfaceList))))
             return NULL;
+        list->pool   = q->surf_pool;
+        q->surf_pool = list;
+    }
 
-    list = *pool;
     list->next = NULL;
 
     surf = &list->surface;
-    if (set_surface_data(avctx, q, surf) < 0)
+    if (set_surface_data(avctx, q, surf) < 0) {
+        push_free_surface(q, list);
         return NULL;
+    }
 
     return surf;
 }
 
-static void release_surface(QSVDecContext *q, mfxFrameSurface1 *surf)
+/**
+ * Give a work surface back after a DecodeFrameAsync() call, whether the SDK
+ * kept it locked or not.
+ */
+static void put_surface(QSVDecContext *q, mfxFrameSurface1 *surf)
 {
-    QSVDecSurfaceList *list = q->surf_pool;
+    push_free_surface(q, surface_to_list(surf));
+}
 
-    while (list && &list->surface != surf)
-        list = list->pool;
+static void release_surface(QSVDecContext *q, mfxFrameSurface1 *surf)
+{
+    QSVDecSurfaceList *list = surface_to_list(surf);
 
-    if (list)
-        list->sync = 0;
+    list->sync = 0;
+    push_free_surface(q, list);
 }
 
 static void free_surface_pool(QSVDecContext *q)
@@ -280,29 +407,28 @@ static void free_surface_pool(QSVDecContext *q)
         av_frame_free((AVFrame **)&list->surface.Data.MemId);
         av_freep(&list);
     }
+
+    q->surf_free     = NULL;
+    q->surf_free_end = NULL;
+    q->nb_surf_free  = 0;
 }
 
 static void put_sync(QSVDecContext *q, mfxFrameSurface1 *surf,
                      mfxSyncPoint sync)
 {
-    QSVDecSurfaceList *list = q->surf_pool;
-
-    while (list && &list->surface != surf)
-        list = list->pool;
+    QSVDecSurfaceList *list = surface_to_list(surf);
 
-    if (list) {
-        list->sync = sync;
-        list->next = NULL;
+    list->sync = sync;
+    list->next = NULL;
 
-        if (q->pending_sync_end)
-            q->pending_sync_end->next = list;
-        else
-            q->pending_sync = list;
+    if (q->pending_sync_end)
+        q->pending_sync_end->next = list;
+    else
+        q->pending_sync = list;
 
-        q->pending_sync_end = list;
+    q->pending_sync_end = list;
 
-        q->nb_sync++;
-    }
+    q->nb_sync++;
 }
 
 static void get_sync(QSVDecContext *q, mfxFrameSurface1 **surf,
@@ -332,8 +458,7 @@ static void free_sync(QSVDecContext *q)
 
 int ff_qsv_dec_init_mfx(AVCodecContext *avctx, QSVDecContext *q)
 {
-    mfxIMPL impl   = MFX_IMPL_AUTO_ANY;
-    mfxVersion ver = { { QSV_VERSION_MINOR, QSV_VERSION_MAJOR } };
+    mfxIMPL impl = MFX_IMPL_AUTO_ANY;
     int ret;
 
     ret = ff_qsv_codec_id_to_mfx(avctx->codec_id);
@@ -342,10 +467,11 @@ int ff_qsv_dec_init_mfx(AVCodecContext *avctx, QSVDecContext *q)
 
     q->param.mfx.CodecId = ret;
 
-    ret = MFXInit(impl, &ver, &q->session);
-    av_log(avctx, AV_LOG_DEBUG, "MFXInit(): %d\n", ret);
+    ret = ff_qsv_init_session(avctx, &q->session,
+                              &q->options.session_group);
     if (ret < 0)
-        return ff_qsv_error(ret);
+        return ret;
+    q->joined = ret;
 
     MFXQueryIMPL(q->session, &impl);
 
@@ -362,6 +488,10 @@ int ff_qsv_dec_init_mfx(AVCodecContext *avctx, QSVDecContext *q)
     q->param.IOPattern  = MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
     q->param.AsyncDepth = q->options.async_depth;
 
+    // output only, not settings
+    q->time_blocked = 0;
+    q->time_busy    = 0;
+
     return 0;
 }
 
@@ -427,7 +557,7 @@ static void init_decoder(AVCodecContext *avctx, QSVDecContext *q,
         mfxBitstream *bs = get_bitstream_from_packet(q, avpkt);
         if (bs) {
             ff_qsv_dec_init_decoder(avctx, q, bs);
-            bs->MaxLength = 0;
+            release_bitstream(q, bs);
         }
     }
 }
@@ -445,7 +575,10 @@ int ff_qsv_dec_frame(AVCodecContext *avctx, QSVDecContext *q,
     int size                   = avpkt->size;
     int busymsec               = 0;
     int flush                  = 0;
-    int ret;
+    int busy                   = 0;
+    int more                   = 0;
+    int block, ret;
+    int64_t t;
 
     *got_frame = 0;
 
@@ -477,11 +610,11 @@ int ff_qsv_dec_frame(AVCodecContext *avctx, QSVDecContext *q,
 
     do {
         if (inbs && !inbs->DataLength) {
-            inbs->MaxLength = 0;
+            release_bitstream(q, inbs);
             inbs = NULL;
         }
 
-        if (ret == MFX_ERR_MORE_DATA) {
+        if (ret == MFX_ERR_MORE_DATA || (more && ret == MFX_ERR_NONE)) {
             if (flush) {
                 break;
             } else if (inbs && inbs->DataLength > 0) {
@@ -523,18 +656,41 @@ int ff_qsv_dec_frame(AVCodecContext *avctx, QSVDecContext *q,
         av_log(avctx, AV_LOG_DEBUG,
                "MFXVideoDECODE_DecodeFrameAsync(): %d\n", ret);
 
+        put_surface(q, worksurf);
+
+        if (outsync) {
+            put_sync(q, outsurf, outsync);
+            outsync = 0;
+        }
+
+        // Without blocking, bitstreams deferred while the device was busy
+        // would pile up if only one frame was submitted per call.
+        more = q->options.nonblock && size &&
+               q->nb_sync < q->req.NumFrameMin + q->param.AsyncDepth &&
+               ((inbs && inbs->DataLength) || q->pending_dec || curbs);
+
         if (ret == MFX_WRN_DEVICE_BUSY) {
+            // Keep the bitstream and retry on the next call instead of
+            // sleeping, the sync points below are what free the device.
+            // Draining must not return without a frame though.
+            if (q->options.nonblock && (size || q->pending_sync)) {
+                busy = 1;
+                break;
+            }
             if (busymsec > q->options.timeout) {
                 av_log(avctx, AV_LOG_WARNING, "Timeout, device is so busy\n");
                 break;
             }
+            t = av_gettime();
             av_usleep(1000);
+            q->time_busy += av_gettime() - t;
             busymsec++;
         } else {
             busymsec = 0;
         }
     } while (ret == MFX_ERR_MORE_SURFACE ||
              ret == MFX_ERR_MORE_DATA ||
+             (more && ret == MFX_ERR_NONE) ||
              ret == MFX_WRN_DEVICE_BUSY ||
              ret == MFX_WRN_VIDEO_PARAM_CHANGED ||
              ret == MFX_ERR_INCOMPATIBLE_VIDEO_PARAM);
@@ -545,22 +701,28 @@ int ff_qsv_dec_frame(AVCodecContext *avctx, QSVDecContext *q,
     if (curbs)
         put_pending_bitstream(q, curbs);
 
-    if (outsync)
-        put_sync(q, outsurf, outsync);
+    ret = ret == MFX_ERR_MORE_DATA || busy ? 0 : ff_qsv_error(ret);
 
-    ret = ret == MFX_ERR_MORE_DATA ? 0 : ff_qsv_error(ret);
+    // In nonblocking mode the oldest frame is only returned once the device
+    // is done with it, unless waiting is the only way to make progress.
+    if (q->options.nonblock)
+        block = !size || q->reinit ||
+                q->nb_sync >= q->req.NumFrameMin + q->param.AsyncDepth;
+    else
+        block = !size || q->reinit || q->nb_sync >= q->req.NumFrameMin;
 
-    if (q->pending_sync &&
-        (q->nb_sync >= q->req.NumFrameMin || !size || q->reinit)) {
+    if (q->pending_sync && (block || q->options.nonblock)) {
         int64_t pts, dts;
+        int err = ff_qsv_sync(avctx, q->session, q->pending_sync->sync,
+                              block, &q->time_blocked);
+
+        if (err == AVERROR(EAGAIN))
+            return (ret < 0) ? ret : size;
 
         get_sync(q, &surf, &sync);
 
-        ret = MFXVideoCORE_SyncOperation(q->session, sync, SYNC_TIME_DEFAULT);
-        av_log(avctx, AV_LOG_DEBUG,
-               "MFXVideoCORE_SyncOperation(): %d\n", ret);
-        if (ret < 0)
-            return ff_qsv_error(ret);
+        if ((ret = err) < 0)
+            return ret;
 
         pts = surf->Data.TimeStamp;
         ret = get_dts(q, pts, &dts);
@@ -596,30 +758,34 @@ int ff_qsv_dec_flush(QSVDecContext *q)
 {
     int ret = MFXVideoDECODE_Reset(q->session, &q->param);
 
-    q->last_ret       = MFX_ERR_MORE_DATA;
-    q->bs->DataOffset = q->bs->DataLength = 0;
+    q->last_ret = MFX_ERR_MORE_DATA;
+    q->reinit   = NULL;
 
     free_surface_pool(q);
 
     free_sync(q);
 
-    av_freep(&q->ts);
+    free_ts(q);
 
     free_bitstream_pool(q);
 
     return ff_qsv_error(ret);
 }
 
-int ff_qsv_dec_close(QSVDecContext *q)
+int ff_qsv_dec_close(AVCodecContext *avctx, QSVDecContext *q)
 {
+    av_log(avctx, AV_LOG_VERBOSE,
+           "%"PRId64" us blocked on the device, %"PRId64" us busy-waiting\n",
+           q->time_blocked, q->time_busy);
+
     if (q->initialized)
         MFXVideoDECODE_Close(q->session);
 
-    MFXClose(q->session);
+    ff_qsv_close_session(q->session, q->joined, q->options.session_group);
 
     free_surface_pool(q);
 
-    av_freep(&q->ts);
+    free_ts(q);
 
     free_bitstream_pool(q);
 
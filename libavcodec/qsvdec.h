@@ -35,29 +35,38 @@ typedef struct QSVDecTimeStamp {
     int64_t dts;
 } QSVDecTimeStamp;
 
+/**
+ * Entries are looked up from the mfxBitstream / mfxFrameSurface1 pointers
+ * the SDK hands back, so those must stay the first member.
+ */
 typedef struct QSVDecBitstreamList {
     mfxBitstream bs;
     AVPacket pkt;
-    struct QSVDecBitstreamList *next;
-    struct QSVDecBitstreamList *pool;
+    struct QSVDecBitstreamList *next;   ///< link in the pending or free list
+    struct QSVDecBitstreamList *pool;   ///< link in the list of all entries
 } QSVDecBitstreamList;
 
 typedef struct QSVDecSurfaceList {
     mfxFrameSurface1 surface;
     mfxSyncPoint sync;
-    struct QSVDecSurfaceList *next;
-    struct QSVDecSurfaceList *pool;
+    int queued;                         ///< in the free queue
+    struct QSVDecSurfaceList *next;     ///< link in the pending sync list
+    struct QSVDecSurfaceList *next_free;
+    struct QSVDecSurfaceList *pool;     ///< link in the list of all entries
 } QSVDecSurfaceList;
 
 typedef struct QSVDecOptions {
     int async_depth;
     int timeout;
+    int nonblock;
+    int session_group;
 } QSVDecOptions;
 
 typedef struct QSVDecContext {
     AVClass *class;
     QSVDecOptions options;
     mfxSession session;
+    int joined;                 ///< session is joined to a parent session
     mfxVideoParam param;
     mfxFrameAllocRequest req;
     mfxBitstream *bs;
@@ -66,13 +75,19 @@ typedef struct QSVDecContext {
     int ts_cnt;
     int ts_by_qsv;
     int last_ret;
-    QSVDecTimeStamp *ts;
-    int nb_ts;
+    QSVDecTimeStamp *ts;                ///< pts -> dts hash table
+    int nb_ts;                          ///< size of ts, a power of two
+    int nb_ts_used;
     QSVDecBitstreamList *bs_pool;
+    QSVDecBitstreamList *bs_free;
     QSVDecBitstreamList *pending_dec, *pending_dec_end;
     QSVDecSurfaceList *surf_pool;
+    QSVDecSurfaceList *surf_free, *surf_free_end;
+    int nb_surf_free;
     QSVDecSurfaceList *pending_sync, *pending_sync_end;
     int nb_sync;
+    int64_t time_blocked;               ///< us spent waiting on sync points, output only
+    int64_t time_busy;                  ///< us slept while the device was busy, output only
 } QSVDecContext;
 
 int ff_qsv_dec_init_mfx(AVCodecContext *c, QSVDecContext *q);
@@ -86,6 +101,6 @@ int ff_qsv_dec_frame(AVCodecContext *c, QSVDecContext *q,
 
 int ff_qsv_dec_flush(QSVDecContext *q);
 
-int ff_qsv_dec_close(QSVDecContext *q);
+int ff_qsv_dec_close(AVCodecContext *c, QSVDecContext *q);
 
 #endif /* AVCODEC_QSVDEC_H */
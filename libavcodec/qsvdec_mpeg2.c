@@ -28,7 +28,7 @@
 #include "avcodec.h"
 #include "internal.h"
 #include "mpegvideo.h"
-#include "qsv.h"
+#include "qsv_internal.h"
 #include "qsvdec.h"
 
 typedef struct QSVDecMpegContext {
@@ -80,7 +80,7 @@ static av_cold int qsv_dec_init(AVCodecContext *avctx)
     return ret;
 
 fail:
-    ff_qsv_dec_close(q->qsv);
+    ff_qsv_dec_close(avctx, q->qsv);
     av_freep(&bs.Data);
 
     return (ret < 0) ? ret : AVERROR(ENOMEM);
@@ -101,7 +101,7 @@ static int qsv_dec_close(AVCodecContext *avctx)
     int ret              = 0;
 
     if (!avctx->internal->is_copy)
-        ret = ff_qsv_dec_close(q->qsv);
+        ret = ff_qsv_dec_close(avctx, q->qsv);
 
     return ret;
 }
@@ -118,6 +118,10 @@ static void qsv_dec_flush(AVCodecContext *avctx)
 static const AVOption options[] = {
     { "async_depth", "Number which limits internal frame buffering", OFFSET(options.async_depth), AV_OPT_TYPE_INT, { .i64 = ASYNC_DEPTH_DEFAULT }, 0, INT_MAX, VD },
     { "timeout", "Maximum timeout in milliseconds when the device has been busy", OFFSET(options.timeout), AV_OPT_TYPE_INT, { .i64 = TIMEOUT_DEFAULT }, 0, INT_MAX, VD },
+    { "nonblock", "Only return frames the device has already completed", OFFSET(options.nonblock), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, VD },
+    { "session_group", "Share one device scheduler with the QSV codecs of the same nonzero group", OFFSET(options.session_group), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, VD },
+    { "time_blocked", "Output only: microseconds spent waiting for the device", OFFSET(mem.time_blocked), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, VD },
+    { "time_busy", "Output only: microseconds slept while the device was busy", OFFSET(mem.time_busy), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, VD },
     { NULL },
 };
 
@@ -31,7 +31,7 @@
 #include "libavutil/imgutils.h"
 #include "internal.h"
 #include "avcodec.h"
-#include "qsv.h"
+#include "qsv_internal.h"
 #include "qsvenc.h"
 
 static int init_video_param(AVCodecContext *avctx, QSVEncContext *q)
@@ -220,14 +220,13 @@ static int init_video_param(AVCodecContext *avctx, QSVEncContext *q)
 
 int ff_qsv_enc_init(AVCodecContext *avctx, QSVEncContext *q)
 {
-    mfxIMPL impl   = MFX_IMPL_AUTO_ANY;
-    mfxVersion ver = { { QSV_VERSION_MINOR, QSV_VERSION_MAJOR } };
+    mfxIMPL impl = MFX_IMPL_AUTO_ANY;
     int ret;
 
-    if ((ret = MFXInit(impl, &ver, &q->session)) < 0) {
-        av_log(avctx, AV_LOG_DEBUG, "MFXInit(): %d\n", ret);
-        return ff_qsv_error(ret);
-    }
+    if ((ret = ff_qsv_init_session(avctx, &q->session,
+                                   &q->options.session_group)) < 0)
+        return ret;
+    q->joined = ret;
 
     MFXQueryIMPL(q->session, &impl);
 
@@ -244,6 +243,10 @@ int ff_qsv_enc_init(AVCodecContext *avctx, QSVEncContext *q)
     q->param.IOPattern  = MFX_IOPATTERN_IN_SYSTEM_MEMORY;
     q->param.AsyncDepth = q->options.async_depth;
 
+    // output only, not settings
+    q->time_blocked = 0;
+    q->time_busy    = 0;
+
     if ((ret = init_video_param(avctx, q)) < 0)
         return ret;
 
@@ -317,20 +320,44 @@ static void free_surface_pool(QSVEncContext *q)
     }
 }
 
+/**
+ * QSV uses a single pitch for both NV12 planes, which has to be a multiple
+ * of 16, and may read each plane down to the 32-row aligned height. Frames
+ * from av_frame_get_buffer() or the libavfilter frame pool satisfy this.
+ */
+static int is_qsv_aligned(AVFrame *frame)
+{
+    int height = FFALIGN(frame->height, 32);
+    int i;
+
+    if (frame->linesize[0] <= 0 || frame->linesize[0] % 16 ||
+        frame->linesize[1] != frame->linesize[0])
+        return 0;
+
+    for (i = 0; i < 2; i++) {
+        AVBufferRef *buf = av_frame_get_plane_buffer(frame, i);
+        int rows         = i ? height >> 1 : height;
+
+        if (!buf || frame->data[i] < buf->data ||
+            frame->data[i] + (size_t)frame->linesize[0] * rows >
+            buf->data + buf->size)
+            return 0;
+    }
+
+    return 1;
+}
+
 static AVFrame *clone_aligned_frame(AVCodecContext *avctx, AVFrame *frame)
 {
-    int width    = frame->linesize[0];
-    int height   = FFALIGN(frame->height, 32);
-    int size     = width * height;
     AVFrame *ret = NULL;
 
-    // check AVFrame buffer alignment for QSV
-    if (!(width % 16) && frame->buf[0] && (frame->buf[0]->size >= size)) {
+    if (is_qsv_aligned(frame)) {
         if (!(ret = av_frame_clone(frame))) {
             av_log(avctx, AV_LOG_ERROR, "av_frame_clone() failed\n");
             goto fail;
         }
     } else {
+        av_log(avctx, AV_LOG_DEBUG, "Copying unaligned input frame\n");
         if (!(ret = av_frame_alloc())) {
             av_log(avctx, AV_LOG_ERROR, "av_frame_alloc() failed\n");
             goto fail;
@@ -566,30 +593,89 @@ static void print_interlace_msg(AVCodecContext *avctx, QSVEncContext *q)
     }
 }
 
-int ff_qsv_enc_frame(AVCodecContext *avctx, QSVEncContext *q,
-                     AVPacket *pkt, const AVFrame *frame, int *got_packet)
+/**
+ * Move the oldest buffer from the sync queue to the dts queue once the
+ * device has completed it.
+ */
+static int sync_buffer(AVCodecContext *avctx, QSVEncContext *q, int block)
 {
-    mfxFrameSurface1 *insurf = NULL;
-    QSVEncBuffer *outbuf     = NULL;
-    int busymsec             = 0;
-    int ret;
+    QSVEncBuffer *outbuf;
+    int ret = ff_qsv_sync(avctx, q->session, q->pending_sync->sync, block,
+                          &q->time_blocked);
 
-    *got_packet = 0;
+    if (ret == AVERROR(EAGAIN))
+        return ret;
 
-    if (frame) {
-        av_log(avctx, AV_LOG_DEBUG, "frame->pts: %"PRId64"\n", frame->pts);
+    outbuf = dequeue_buffer(&q->pending_sync, &q->pending_sync_end,
+                            &q->nb_sync);
+    if (ret < 0)
+        return ret;
 
-        if (q->first_pts == AV_NOPTS_VALUE)
-            q->first_pts = frame->pts;
-        else if (q->pts_delay == AV_NOPTS_VALUE)
-            q->pts_delay = frame->pts - q->first_pts;
+    print_frametype(avctx, q, &outbuf->bs, 6);
 
-        insurf = get_surface_from_frame(avctx, q, frame);
-        if (!insurf)
-            return AVERROR(ENOMEM);
+    if (outbuf->bs.FrameType & MFX_FRAMETYPE_REF ||
+        outbuf->bs.FrameType & MFX_FRAMETYPE_xREF) {
+        outbuf->dts = AV_NOPTS_VALUE;
+    } else {
+        outbuf->dts = outbuf->bs.TimeStamp;
+        fill_buffer_dts(q, q->pending_dts_end, outbuf->dts);
     }
 
-    outbuf = get_buffer(q);
+    enqueue_buffer(&q->pending_dts, &q->pending_dts_end, NULL, outbuf);
+
+    return 0;
+}
+
+static void enqueue_surface(QSVEncContext *q, mfxFrameSurface1 *surf)
+{
+    QSVEncSurfaceList *list = (QSVEncSurfaceList *)surf;
+
+    // keep the pool from handing the surface out again while queued
+    surf->Data.Locked++;
+
+    list->prev = q->pending_enc_end;
+    list->next = NULL;
+    if (q->pending_enc_end)
+        q->pending_enc_end->next = list;
+    else
+        q->pending_enc = list;
+    q->pending_enc_end = list;
+    q->nb_enc++;
+}
+
+static void dequeue_surface(QSVEncContext *q)
+{
+    QSVEncSurfaceList *list = q->pending_enc;
+
+    q->pending_enc = list->next;
+    if (q->pending_enc)
+        q->pending_enc->prev = NULL;
+    else
+        q->pending_enc_end = NULL;
+    q->nb_enc--;
+
+    list->prev = list->next = NULL;
+    list->surface.Data.Locked--;
+}
+
+/**
+ * Submit one surface, or NULL to drain the encoder.
+ *
+ * @param wait if the device is busy, wait until it accepts the surface,
+ *             otherwise return AVERROR(EAGAIN)
+ * @return 0 once the surface was taken, a negative error code otherwise
+ */
+static int submit_surface(AVCodecContext *avctx, QSVEncContext *q,
+                          mfxFrameSurface1 *insurf, int wait)
+{
+    QSVEncBuffer *outbuf;
+    int busymsec = 0;
+    int64_t t;
+    int ret;
+
+    if (!(outbuf = get_buffer(q)))
+        return AVERROR(ENOMEM);
+
     do {
         ret = MFXVideoENCODE_EncodeFrameAsync(q->session, NULL, insurf,
                                               &outbuf->bs, &outbuf->sync);
@@ -597,47 +683,104 @@ int ff_qsv_enc_frame(AVCodecContext *avctx, QSVEncContext *q,
                "MFXVideoENCODE_EncodeFrameAsync(): %d\n", ret);
 
         if (ret == MFX_WRN_DEVICE_BUSY) {
+            if (!wait)
+                return AVERROR(EAGAIN);
+            // Completing our oldest task is what frees the device,
+            // wait for it rather than polling the submission.
+            if (q->options.nonblock && q->pending_sync) {
+                if ((ret = sync_buffer(avctx, q, 1)) < 0)
+                    return ret;
+                ret = MFX_WRN_DEVICE_BUSY;
+                continue;
+            }
             if (busymsec > q->options.timeout) {
                 av_log(avctx, AV_LOG_WARNING, "Timeout, device is so busy\n");
                 break;
             }
+            t = av_gettime();
             av_usleep(1000);
+            q->time_busy += av_gettime() - t;
             busymsec++;
         }
     } while (ret == MFX_WRN_DEVICE_BUSY);
 
-    if (ret == MFX_WRN_INCOMPATIBLE_VIDEO_PARAM && frame->interlaced_frame)
+    if (ret == MFX_WRN_INCOMPATIBLE_VIDEO_PARAM && insurf &&
+        ((AVFrame *)insurf->Data.MemId)->interlaced_frame)
         print_interlace_msg(avctx, q);
 
-    ret = ret == MFX_ERR_MORE_DATA ? 0 : ff_qsv_error(ret);
-
     if (outbuf->sync)
         enqueue_buffer(&q->pending_sync, &q->pending_sync_end, &q->nb_sync,
                        outbuf);
 
-    outbuf = NULL;
-    if (q->pending_sync &&
-        (q->nb_sync >= q->req.NumFrameMin || !frame))
-        outbuf = dequeue_buffer(&q->pending_sync, &q->pending_sync_end,
-                                &q->nb_sync);
-    if (outbuf) {
-        ret = MFXVideoCORE_SyncOperation(q->session, outbuf->sync,
-                                         SYNC_TIME_DEFAULT);
-        av_log(avctx, AV_LOG_DEBUG, "MFXVideoCORE_SyncOperation(): %d\n", ret);
-        if ((ret = ff_qsv_error(ret)) < 0)
-            return ret;
+    return ret == MFX_ERR_MORE_DATA ? 0 : ff_qsv_error(ret);
+}
+
+int ff_qsv_enc_frame(AVCodecContext *avctx, QSVEncContext *q,
+                     AVPacket *pkt, const AVFrame *frame, int *got_packet)
+{
+    mfxFrameSurface1 *insurf = NULL;
+    QSVEncBuffer *outbuf     = NULL;
+    int ret;
 
-        print_frametype(avctx, q, &outbuf->bs, 6);
+    *got_packet = 0;
 
-        if (outbuf->bs.FrameType & MFX_FRAMETYPE_REF ||
-            outbuf->bs.FrameType & MFX_FRAMETYPE_xREF) {
-            outbuf->dts = AV_NOPTS_VALUE;
-        } else {
-            outbuf->dts = outbuf->bs.TimeStamp;
-            fill_buffer_dts(q, q->pending_dts_end, outbuf->dts);
+    if (frame) {
+        av_log(avctx, AV_LOG_DEBUG, "frame->pts: %"PRId64"\n", frame->pts);
+
+        if (q->first_pts == AV_NOPTS_VALUE)
+            q->first_pts = frame->pts;
+        else if (q->pts_delay == AV_NOPTS_VALUE)
+            q->pts_delay = frame->pts - q->first_pts;
+
+        insurf = get_surface_from_frame(avctx, q, frame);
+        if (!insurf)
+            return AVERROR(ENOMEM);
+    }
+
+    if (q->options.nonblock) {
+        // Frames the device is too busy to take stay queued for the next
+        // call. Only draining, or a queue longer than the number of tasks
+        // the device can hold, waits for the device to accept them.
+        if (insurf)
+            enqueue_surface(q, insurf);
+
+        ret = 0;
+        while (q->pending_enc) {
+            int wait = !frame ||
+                       q->nb_enc > q->req.NumFrameMin + q->param.AsyncDepth;
+
+            ret = submit_surface(avctx, q, &q->pending_enc->surface, wait);
+            if (ret == AVERROR(EAGAIN)) {
+                ret = 0;
+                break;
+            }
+            dequeue_surface(q);
+            if (ret < 0)
+                break;
         }
+        if (!frame && !q->pending_enc && !ret)
+            ret = submit_surface(avctx, q, NULL, 1);
+    } else {
+        ret = submit_surface(avctx, q, insurf, 1);
+    }
 
-        enqueue_buffer(&q->pending_dts, &q->pending_dts_end, NULL, outbuf);
+    if (q->options.nonblock) {
+        // collect whatever the device has finished, wait only when too
+        // many tasks are in flight or when draining
+        while (q->pending_sync) {
+            int block = !frame ||
+                        q->nb_sync >= q->req.NumFrameMin + q->param.AsyncDepth;
+            int err   = sync_buffer(avctx, q, block);
+
+            if (err == AVERROR(EAGAIN))
+                break;
+            if (err < 0)
+                return err;
+        }
+    } else if (q->pending_sync &&
+               (q->nb_sync >= q->req.NumFrameMin || !frame)) {
+        if ((ret = sync_buffer(avctx, q, 1)) < 0)
+            return ret;
     }
 
     outbuf = NULL;
@@ -674,10 +817,14 @@ int ff_qsv_enc_frame(AVCodecContext *avctx, QSVEncContext *q,
 
 int ff_qsv_enc_close(AVCodecContext *avctx, QSVEncContext *q)
 {
+    av_log(avctx, AV_LOG_VERBOSE,
+           "%"PRId64" us blocked on the device, %"PRId64" us busy-waiting\n",
+           q->time_blocked, q->time_busy);
+
     MFXVideoENCODE_Close(q->session);
     av_log(avctx, AV_LOG_DEBUG, "MFXVideoENCODE_Close()\n");
 
-    MFXClose(q->session);
+    ff_qsv_close_session(q->session, q->joined, q->options.session_group);
     av_log(avctx, AV_LOG_DEBUG, "MFXClose()\n");
 
     free_surface_pool(q);
@@ -50,6 +50,8 @@ typedef struct QSVEncBuffer {
 typedef struct QSVEncOptions {
     int async_depth;
     int timeout;
+    int nonblock;
+    int session_group;
     int qpi;
     int qpp;
     int qpb;
@@ -68,6 +70,7 @@ typedef struct QSVEncOptions {
 typedef struct QSVEncContext {
     AVClass *class;
     mfxSession session;
+    int joined;                 ///< session is joined to a parent session
     mfxVideoParam param;
     mfxFrameAllocRequest req;
     mfxExtCodingOption extco;
@@ -80,10 +83,13 @@ typedef struct QSVEncContext {
     QSVEncOptions options;
     QSVEncSurfaceList *surf_pool;
     QSVEncSurfaceList *pending_enc, *pending_enc_end;
+    int nb_enc;
     QSVEncBuffer *buf_pool;
     QSVEncBuffer *pending_sync, *pending_sync_end;
     int nb_sync;
     QSVEncBuffer *pending_dts, *pending_dts_end;
+    int64_t time_blocked;               ///< us spent waiting on sync points, output only
+    int64_t time_busy;                  ///< us slept while the device was busy, output only
 } QSVEncContext;
 
 int ff_qsv_enc_init(AVCodecContext *avctx, QSVEncContext *q);
@@ -28,12 +28,13 @@
 #include "avcodec.h"
 #include "internal.h"
 #include "h264.h"
-#include "qsv.h"
+#include "qsv_internal.h"
 #include "qsvenc.h"
 
 typedef struct QSVH264EncContext {
     AVClass *class;
     QSVEncOptions options;
+    QSVEncContext mem;
     QSVEncContext *qsv;
 } QSVH264EncContext;
 
@@ -41,8 +42,7 @@ static av_cold int qsv_enc_init(AVCodecContext *avctx)
 {
     QSVH264EncContext *q = avctx->priv_data;
 
-    if (!(q->qsv = av_mallocz(sizeof(*q->qsv))))
-        return AVERROR(ENOMEM);
+    q->qsv = &q->mem;
 
     q->qsv->options = q->options;
 
@@ -62,10 +62,8 @@ static av_cold int qsv_enc_close(AVCodecContext *avctx)
     QSVH264EncContext *q = avctx->priv_data;
     int ret              = 0;
 
-    if (!avctx->internal->is_copy) {
+    if (!avctx->internal->is_copy)
         ret = ff_qsv_enc_close(avctx, q->qsv);
-        av_freep(&q->qsv);
-    }
 
     return ret;
 }
@@ -75,6 +73,10 @@ static av_cold int qsv_enc_close(AVCodecContext *avctx)
 static const AVOption options[] = {
     { "async_depth", "Number which limits internal frame buffering", OFFSET(options.async_depth), AV_OPT_TYPE_INT, { .i64 = ASYNC_DEPTH_DEFAULT }, 0, INT_MAX, VE },
     { "timeout", "Maximum timeout in milliseconds when the device has been busy", OFFSET(options.timeout), AV_OPT_TYPE_INT, { .i64 = TIMEOUT_DEFAULT }, 0, INT_MAX, VE },
+    { "nonblock", "Only return frames the device has already completed", OFFSET(options.nonblock), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, VE },
+    { "session_group", "Share one device scheduler with the QSV codecs of the same nonzero group", OFFSET(options.session_group), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, VE },
+    { "time_blocked", "Output only: microseconds spent waiting for the device", OFFSET(mem.time_blocked), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, VE },
+    { "time_busy", "Output only: microseconds slept while the device was busy", OFFSET(mem.time_busy), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, VE },
     { "qpi", NULL, OFFSET(options.qpi), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 51, VE },
     { "qpp", NULL, OFFSET(options.qpp), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 51, VE },
     { "qpb", NULL, OFFSET(options.qpb), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 51, VE },
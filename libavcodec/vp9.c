@@ -24,6 +24,7 @@
 #include "avcodec.h"
 #include "get_bits.h"
 #include "internal.h"
+#include "thread.h"
 #include "videodsp.h"
 #include "vp56.h"
 #include "vp9.h"
@@ -68,6 +69,16 @@ struct VP9mvrefPair {
     int8_t ref[2];
 };
 
+typedef struct VP9Frame {
+    ThreadFrame tf;
+    AVBufferRef *segmentation_map_buf;
+    AVBufferRef *mv_buf;
+    uint8_t *segmentation_map;
+    struct VP9mvrefPair *mv;
+    unsigned cols, rows;
+    int uses_2pass;
+} VP9Frame;
+
 struct VP9Filter {
     uint8_t level[8 * 8];
     uint8_t /* bit=col */ mask[2 /* 0=y, 1=uv */][2 /* 0=col, 1=row */]
@@ -93,7 +104,8 @@ typedef struct VP9Context {
     VP56RangeCoder c;
     VP56RangeCoder *c_b;
     unsigned c_b_size;
-    VP9Block b;
+    VP9Block *b, *b_base, *b_end;
+    int pass;
 
     // bitstream header
     uint8_t profile;
@@ -116,7 +128,14 @@ typedef struct VP9Context {
     uint8_t refidx[3];
     uint8_t signbias[3];
     uint8_t varcompref[2];
-    AVFrame *refs[8], *f, *fb[10];
+
+    // frames
+#define CUR_FRAME  0
+#define LAST_FRAME 1
+    VP9Frame frames[2];
+    ThreadFrame refs[8], next_refs[8];
+    AVFrame *f;
+    AVBufferPool *segmentation_map_pool, *mv_pool;
 
     struct {
         uint8_t level;
@@ -213,19 +232,22 @@ typedef struct VP9Context {
 
     // whole-frame cache
     uint8_t *intra_pred_data[3];
-    uint8_t *segmentation_map;
-    struct VP9mvrefPair *mv[2];
     struct VP9Filter *lflvl;
     DECLARE_ALIGNED(32, uint8_t, edge_emu_buffer)[71*80];
 
-    // block reconstruction intermediates
-    DECLARE_ALIGNED(32, int16_t, block)[4096];
-    DECLARE_ALIGNED(32, int16_t, uvblock)[2][1024];
-    uint8_t eob[256];
-    uint8_t uveob[2][64];
+    // block reconstruction intermediates; these hold a single block
+    // normally, or all blocks of a frame when decoding in two passes
+    int block_alloc_sbs;
+    int16_t *block_base, *block, *uvblock_base[2], *uvblock[2];
+    uint8_t *eob_base, *uveob_base[2], *eob, *uveob[2];
     VP56mv min_mv, max_mv;
     DECLARE_ALIGNED(32, uint8_t, tmp_y)[64*64];
     DECLARE_ALIGNED(32, uint8_t, tmp_uv)[2][32*32];
+
+    // per-tile-column copies of this context for slice threading
+    struct VP9Context *tile_ctx;
+    int *tile_res;
+    int nb_tile_ctx;
 } VP9Context;
 
 static const uint8_t bwh_tab[2][N_BS_SIZES][2] = {
@@ -241,22 +263,25 @@ static const uint8_t bwh_tab[2][N_BS_SIZES][2] = {
 static int update_size(AVCodecContext *ctx, int w, int h)
 {
     VP9Context *s = ctx->priv_data;
+    unsigned cols = (w + 7) >> 3, rows = (h + 7) >> 3;
     uint8_t *p;
 
-    if (s->above_partition_ctx && w == ctx->width && h == ctx->height)
-        return 0;
-
     ctx->width  = w;
     ctx->height = h;
+    // compare against our own size rather than ctx->width/height, since in
+    // frame threads those are copied over from the other threads
+    if (s->above_partition_ctx && cols == s->cols && rows == s->rows)
+        return 0;
+
     s->sb_cols  = (w + 63) >> 6;
     s->sb_rows  = (h + 63) >> 6;
-    s->cols     = (w + 7) >> 3;
-    s->rows     = (h + 7) >> 3;
+    s->cols     = cols;
+    s->rows     = rows;
 
 #define assign(var, type, n) var = (type) p; p += s->sb_cols * n * sizeof(*var)
     av_free(s->above_partition_ctx);
-    p = av_malloc(s->sb_cols * (240 + sizeof(*s->lflvl) + 16 * sizeof(*s->above_mv_ctx) +
-                                64 * s->sb_rows * (1 + sizeof(*s->mv[0]) * 2)));
+    p = av_malloc(s->sb_cols * (240 + sizeof(*s->lflvl) * s->sb_rows +
+                                16 * sizeof(*s->above_mv_ctx)));
     if (!p)
         return AVERROR(ENOMEM);
     assign(s->above_partition_ctx, uint8_t *,              8);
@@ -274,13 +299,134 @@ static int update_size(AVCodecContext *ctx, int w, int h)
     assign(s->above_comp_ctx,      uint8_t *,              8);
     assign(s->above_ref_ctx,       uint8_t *,              8);
     assign(s->above_filter_ctx,    uint8_t *,              8);
-    assign(s->lflvl,               struct VP9Filter *,     1);
+    assign(s->lflvl,               struct VP9Filter *,     s->sb_rows);
     assign(s->above_mv_ctx,        VP56mv(*)[2],          16);
-    assign(s->segmentation_map,    uint8_t *,             64 * s->sb_rows);
-    assign(s->mv[0],               struct VP9mvrefPair *, 64 * s->sb_rows);
-    assign(s->mv[1],               struct VP9mvrefPair *, 64 * s->sb_rows);
 #undef assign
 
+    // per-frame segmentation map and motion vectors, kept with the frame so
+    // that the next frame (possibly in another thread) can reference them
+    av_buffer_pool_uninit(&s->segmentation_map_pool);
+    av_buffer_pool_uninit(&s->mv_pool);
+    s->segmentation_map_pool = av_buffer_pool_init(64 * s->sb_cols * s->sb_rows,
+                                                   av_buffer_allocz);
+    s->mv_pool = av_buffer_pool_init(64 * s->sb_cols * s->sb_rows *
+                                     sizeof(struct VP9mvrefPair), NULL);
+    if (!s->segmentation_map_pool || !s->mv_pool)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static void set_block_base_ptrs(VP9Context *s)
+{
+    int sbs = s->block_alloc_sbs;
+
+    s->uvblock_base[0] = s->block_base + sbs * 64 * 64;
+    s->uvblock_base[1] = s->uvblock_base[0] + sbs * 32 * 32;
+    s->eob_base        = (uint8_t *) (s->uvblock_base[1] + sbs * 32 * 32);
+    s->uveob_base[0]   = s->eob_base + sbs * 256;
+    s->uveob_base[1]   = s->uveob_base[0] + sbs * 128;
+}
+
+static int update_block_buffers(VP9Context *s, int sbs)
+{
+    if (s->block_base && s->block_alloc_sbs == sbs)
+        return 0;
+
+    av_free(s->b_base);
+    av_free(s->block_base);
+    s->b_base     = av_malloc(sizeof(VP9Block) * 64 * sbs);
+    s->block_base = av_mallocz(sbs * (64 * 64 + 32 * 32 * 2) * sizeof(int16_t) +
+                               sbs * (256 + 128 * 2));
+    if (!s->b_base || !s->block_base) {
+        av_freep(&s->b_base);
+        av_freep(&s->block_base);
+        s->block_alloc_sbs = 0;
+        return AVERROR(ENOMEM);
+    }
+    s->block_alloc_sbs = sbs;
+    set_block_base_ptrs(s);
+
+    return 0;
+}
+
+static void reset_block_ptrs(VP9Context *s)
+{
+    s->b          = s->b_base;
+    s->block      = s->block_base;
+    s->uvblock[0] = s->uvblock_base[0];
+    s->uvblock[1] = s->uvblock_base[1];
+    s->eob        = s->eob_base;
+    s->uveob[0]   = s->uveob_base[0];
+    s->uveob[1]   = s->uveob_base[1];
+}
+
+static void next_block_ptrs(VP9Context *s)
+{
+    int w4 = bwh_tab[1][s->b->bs][0], h4 = bwh_tab[1][s->b->bs][1];
+
+    s->b++;
+    s->block      += w4 * h4 * 64;
+    s->uvblock[0] += w4 * h4 * 16;
+    s->uvblock[1] += w4 * h4 * 16;
+    s->eob        += w4 * h4 * 4;
+    // keep the chroma eobs 16-bit aligned for the 16x16/32x32 transforms
+    s->uveob[0]   += FFALIGN(w4 * h4, 2);
+    s->uveob[1]   += FFALIGN(w4 * h4, 2);
+}
+
+static int vp9_alloc_frame(AVCodecContext *ctx, VP9Frame *f)
+{
+    VP9Context *s = ctx->priv_data;
+    int res;
+
+    if ((res = ff_thread_get_buffer(ctx, &f->tf, AV_GET_BUFFER_FLAG_REF)) < 0)
+        return res;
+    f->cols = s->cols;
+    f->rows = s->rows;
+    if (!(f->mv_buf = av_buffer_pool_get(s->mv_pool)))
+        goto fail;
+
+    if (!(f->segmentation_map_buf = av_buffer_pool_get(s->segmentation_map_pool)))
+        goto fail;
+
+    f->segmentation_map = f->segmentation_map_buf->data;
+    f->mv               = (struct VP9mvrefPair *) f->mv_buf->data;
+
+    return 0;
+
+fail:
+    av_buffer_unref(&f->mv_buf);
+    ff_thread_release_buffer(ctx, &f->tf);
+    return AVERROR(ENOMEM);
+}
+
+static void vp9_unref_frame(AVCodecContext *ctx, VP9Frame *f)
+{
+    ff_thread_release_buffer(ctx, &f->tf);
+    av_buffer_unref(&f->segmentation_map_buf);
+    av_buffer_unref(&f->mv_buf);
+    f->segmentation_map = NULL;
+    f->mv               = NULL;
+}
+
+static int vp9_ref_frame(AVCodecContext *ctx, VP9Frame *dst, VP9Frame *src)
+{
+    int res;
+
+    if ((res = ff_thread_ref_frame(&dst->tf, &src->tf)) < 0)
+        return res;
+    if (!(dst->segmentation_map_buf = av_buffer_ref(src->segmentation_map_buf)) ||
+        !(dst->mv_buf = av_buffer_ref(src->mv_buf))) {
+        vp9_unref_frame(ctx, dst);
+        return AVERROR(ENOMEM);
+    }
+    dst->segmentation_map = src->segmentation_map;
+    dst->mv               = src->mv;
+    dst->cols             = src->cols;
+    dst->rows             = src->rows;
+    dst->uses_2pass       = src->uses_2pass;
+
     return 0;
 }
 
@@ -384,7 +530,7 @@ static int decode_frame_header(AVCodecContext *ctx,
     s->last_invisible = s->invisible;
     s->invisible      = !get_bits1(&s->gb);
     s->errorres       = get_bits1(&s->gb);
-    // FIXME disable this upon resolution change
+    // this is further restricted to same-size frames in vp9_decode_frame()
     s->use_last_frame_mvs = !s->errorres && !s->last_invisible;
     if (s->keyframe) {
         if (get_bits_long(&s->gb, 24) != VP9_SYNCCODE) { // synccode
@@ -424,20 +570,21 @@ static int decode_frame_header(AVCodecContext *ctx,
             s->signbias[1]    = get_bits1(&s->gb);
             s->refidx[2]      = get_bits(&s->gb, 3);
             s->signbias[2]    = get_bits1(&s->gb);
-            if (!s->refs[s->refidx[0]] || !s->refs[s->refidx[1]] ||
-                !s->refs[s->refidx[2]]) {
+            if (!s->refs[s->refidx[0]].f->data[0] ||
+                !s->refs[s->refidx[1]].f->data[0] ||
+                !s->refs[s->refidx[2]].f->data[0]) {
                 av_log(ctx, AV_LOG_ERROR, "Not all references are available\n");
                 return AVERROR_INVALIDDATA;
             }
             if (get_bits1(&s->gb)) {
-                w = s->refs[s->refidx[0]]->width;
-                h = s->refs[s->refidx[0]]->height;
+                w = s->refs[s->refidx[0]].f->width;
+                h = s->refs[s->refidx[0]].f->height;
             } else if (get_bits1(&s->gb)) {
-                w = s->refs[s->refidx[1]]->width;
-                h = s->refs[s->refidx[1]]->height;
+                w = s->refs[s->refidx[1]].f->width;
+                h = s->refs[s->refidx[1]].f->height;
             } else if (get_bits1(&s->gb)) {
-                w = s->refs[s->refidx[2]]->width;
-                h = s->refs[s->refidx[2]]->height;
+                w = s->refs[s->refidx[2]].f->width;
+                h = s->refs[s->refidx[2]].f->height;
             } else {
                 w = get_bits(&s->gb, 16) + 1;
                 h = get_bits(&s->gb, 16) + 1;
@@ -474,9 +621,21 @@ static int decode_frame_header(AVCodecContext *ctx,
     s->filter.level = get_bits(&s->gb, 6);
     sharp = get_bits(&s->gb, 3);
     // if sharpness changed, reinit lim/mblim LUTs. if it didn't change, keep
-    // the old cache values since they are still valid
-    if (s->filter.sharpness != sharp)
-        memset(s->filter.lim_lut, 0, sizeof(s->filter.lim_lut));
+    // the old values since they are still valid
+    if (s->filter.sharpness != sharp) {
+        for (i = 1; i < 64; i++) {
+            int limit = i;
+
+            if (sharp > 0) {
+                limit >>= (sharp + 3) >> 2;
+                limit = FFMIN(limit, 9 - sharp);
+            }
+            limit = FFMAX(limit, 1);
+
+            s->filter.lim_lut[i]   = limit;
+            s->filter.mblim_lut[i] = 2 * (i + 2) + limit;
+        }
+    }
     s->filter.sharpness = sharp;
     if ((s->lf_delta.enabled = get_bits1(&s->gb))) {
         if (get_bits1(&s->gb)) {
@@ -857,7 +1016,7 @@ static void find_ref_mvs(VP9Context *s,
         [BS_4x4]   = {{  0, -1 }, { -1,  0 }, { -1, -1 }, {  0, -2 },
                       { -2,  0 }, { -1, -2 }, { -2, -1 }, { -2, -2 }},
     };
-    VP9Block *const b = &s->b;
+    VP9Block *b = s->b;
     int row = b->row, col = b->col, row7 = b->row7;
     const int8_t (*p)[2] = mv_ref_blk_off[b->bs];
 #define INVALID_MV 0x80008000U
@@ -918,7 +1077,7 @@ static void find_ref_mvs(VP9Context *s,
     } while (0)
 
         if (row > 0) {
-            struct VP9mvrefPair *mv = &s->mv[0][(row - 1) * s->sb_cols * 8 + col];
+            struct VP9mvrefPair *mv = &s->frames[CUR_FRAME].mv[(row - 1) * s->sb_cols * 8 + col];
             if (mv->ref[0] == ref) {
                 RETURN_MV(s->above_mv_ctx[2 * col + (sb & 1)][0]);
             } else if (mv->ref[1] == ref) {
@@ -926,7 +1085,7 @@ static void find_ref_mvs(VP9Context *s,
             }
         }
         if (col > s->tiling.tile_col_start) {
-            struct VP9mvrefPair *mv = &s->mv[0][row * s->sb_cols * 8 + col - 1];
+            struct VP9mvrefPair *mv = &s->frames[CUR_FRAME].mv[row * s->sb_cols * 8 + col - 1];
             if (mv->ref[0] == ref) {
                 RETURN_MV(s->left_mv_ctx[2 * row7 + (sb >> 1)][0]);
             } else if (mv->ref[1] == ref) {
@@ -943,7 +1102,7 @@ static void find_ref_mvs(VP9Context *s,
         int c = p[i][0] + col, r = p[i][1] + row;
 
         if (c >= s->tiling.tile_col_start && c < s->cols && r >= 0 && r < s->rows) {
-            struct VP9mvrefPair *mv = &s->mv[0][r * s->sb_cols * 8 + c];
+            struct VP9mvrefPair *mv = &s->frames[CUR_FRAME].mv[r * s->sb_cols * 8 + c];
 
             if (mv->ref[0] == ref) {
                 RETURN_MV(mv->mv[0]);
@@ -955,7 +1114,10 @@ static void find_ref_mvs(VP9Context *s,
 
     // MV at this position in previous frame, using same reference frame
     if (s->use_last_frame_mvs) {
-        struct VP9mvrefPair *mv = &s->mv[1][row * s->sb_cols * 8 + col];
+        struct VP9mvrefPair *mv = &s->frames[LAST_FRAME].mv[row * s->sb_cols * 8 + col];
+
+        if (!s->frames[LAST_FRAME].uses_2pass)
+            ff_thread_await_progress(&s->frames[LAST_FRAME].tf, row >> 3, 0);
 
         if (mv->ref[0] == ref) {
             RETURN_MV(mv->mv[0]);
@@ -979,7 +1141,7 @@ static void find_ref_mvs(VP9Context *s,
         int c = p[i][0] + col, r = p[i][1] + row;
 
         if (c >= s->tiling.tile_col_start && c < s->cols && r >= 0 && r < s->rows) {
-            struct VP9mvrefPair *mv = &s->mv[0][r * s->sb_cols * 8 + c];
+            struct VP9mvrefPair *mv = &s->frames[CUR_FRAME].mv[r * s->sb_cols * 8 + c];
 
             if (mv->ref[0] != ref && mv->ref[0] >= 0) {
                 RETURN_SCALE_MV(mv->mv[0], s->signbias[mv->ref[0]] != s->signbias[ref]);
@@ -992,7 +1154,9 @@ static void find_ref_mvs(VP9Context *s,
 
     // MV at this position in previous frame, using different reference frame
     if (s->use_last_frame_mvs) {
-        struct VP9mvrefPair *mv = &s->mv[1][row * s->sb_cols * 8 + col];
+        struct VP9mvrefPair *mv = &s->frames[LAST_FRAME].mv[row * s->sb_cols * 8 + col];
+
+        // no need to await_progress, because we already did that above
 
         if (mv->ref[0] != ref && mv->ref[0] >= 0) {
             RETURN_SCALE_MV(mv->mv[0], s->signbias[mv->ref[0]] != s->signbias[ref]);
@@ -1064,7 +1228,7 @@ static av_always_inline int read_mv_component(VP9Context *s, int idx, int hp)
 static void fill_mv(VP9Context *s,
                     VP56mv *mv, int mode, int sb)
 {
-    VP9Block *const b = &s->b;
+    VP9Block *b = s->b;
 
     if (mode == ZEROMV) {
         memset(mv, 0, sizeof(*mv) * 2);
@@ -1134,7 +1298,7 @@ static void fill_mv(VP9Context *s,
     }
 }
 
-static void decode_mode(AVCodecContext *ctx)
+static void decode_mode(VP9Context *s)
 {
     static const uint8_t left_ctx[N_BS_SIZES] = {
         0x0, 0x8, 0x0, 0x8, 0xc, 0x8, 0xc, 0xe, 0xc, 0xe, 0xf, 0xe, 0xf
@@ -1146,8 +1310,7 @@ static void decode_mode(AVCodecContext *ctx)
         TX_32X32, TX_32X32, TX_32X32, TX_32X32, TX_16X16, TX_16X16,
         TX_16X16, TX_8X8, TX_8X8, TX_8X8, TX_4X4, TX_4X4, TX_4X4
     };
-    VP9Context *s = ctx->priv_data;
-    VP9Block *const b = &s->b;
+    VP9Block *b = s->b;
     int row = b->row, col = b->col, row7 = b->row7;
     enum TxfmMode max_tx = max_tx_for_bl_bp[b->bs];
     int w4 = FFMIN(s->cols - col, bwh_tab[1][b->bs][0]);
@@ -1164,11 +1327,12 @@ static void decode_mode(AVCodecContext *ctx)
                 vp56_rac_get_prob_branchy(&s->c,
                     s->prob.segpred[s->above_segpred_ctx[col] +
                                     s->left_segpred_ctx[row7]]))) {
+        uint8_t *segmap = s->frames[CUR_FRAME].segmentation_map;
         int pred = 8, x;
 
         for (y = 0; y < h4; y++)
             for (x = 0; x < w4; x++)
-                pred = FFMIN(pred, s->segmentation_map[(y + row) * 8 * s->sb_cols + x + col]);
+                pred = FFMIN(pred, segmap[(y + row) * 8 * s->sb_cols + x + col]);
         b->seg_id = pred;
 
         memset(&s->above_segpred_ctx[col], 1, w4);
@@ -1182,7 +1346,7 @@ static void decode_mode(AVCodecContext *ctx)
     }
     if ((s->segmentation.enabled && s->segmentation.update_map) || s->keyframe) {
         for (y = 0; y < h4; y++)
-            memset(&s->segmentation_map[(y + row) * 8 * s->sb_cols + col],
+            memset(&s->frames[CUR_FRAME].segmentation_map[(y + row) * 8 * s->sb_cols + col],
                    b->seg_id, w4);
     }
 
@@ -1757,24 +1921,25 @@ static void decode_mode(AVCodecContext *ctx)
     // FIXME kinda ugly
     for (y = 0; y < h4; y++) {
         int x, o = (row + y) * s->sb_cols * 8 + col;
+        struct VP9mvrefPair *mv = &s->frames[CUR_FRAME].mv[o];
 
         if (b->intra) {
             for (x = 0; x < w4; x++) {
-                s->mv[0][o + x].ref[0] =
-                s->mv[0][o + x].ref[1] = -1;
+                mv[x].ref[0] =
+                mv[x].ref[1] = -1;
             }
         } else if (b->comp) {
             for (x = 0; x < w4; x++) {
-                s->mv[0][o + x].ref[0] = b->ref[0];
-                s->mv[0][o + x].ref[1] = b->ref[1];
-                AV_COPY32(&s->mv[0][o + x].mv[0], &b->mv[3][0]);
-                AV_COPY32(&s->mv[0][o + x].mv[1], &b->mv[3][1]);
+                mv[x].ref[0] = b->ref[0];
+                mv[x].ref[1] = b->ref[1];
+                AV_COPY32(&mv[x].mv[0], &b->mv[3][0]);
+                AV_COPY32(&mv[x].mv[1], &b->mv[3][1]);
             }
         } else {
             for (x = 0; x < w4; x++) {
-                s->mv[0][o + x].ref[0] = b->ref[0];
-                s->mv[0][o + x].ref[1] = -1;
-                AV_COPY32(&s->mv[0][o + x].mv[0], &b->mv[3][0]);
+                mv[x].ref[0] = b->ref[0];
+                mv[x].ref[1] = -1;
+                AV_COPY32(&mv[x].mv[0], &b->mv[3][0]);
             }
         }
     }
@@ -1888,10 +2053,9 @@ static int decode_coeffs_b(VP56RangeCoder *c, int16_t *coef, int n_coeffs,
     return i;
 }
 
-static int decode_coeffs(AVCodecContext *ctx)
+static int decode_coeffs(VP9Context *s)
 {
-    VP9Context *s = ctx->priv_data;
-    VP9Block *const b = &s->b;
+    VP9Block *b = s->b;
     int row = b->row, col = b->col;
     uint8_t (*p)[6][11] = s->prob.coef[b->tx][0 /* y */][!b->intra];
     unsigned (*c)[6][3] = s->counts.coef[b->tx][0 /* y */][!b->intra];
@@ -2132,10 +2296,9 @@ static av_always_inline int check_intra_mode(VP9Context *s, int mode, uint8_t **
     return mode;
 }
 
-static void intra_recon(AVCodecContext *ctx, ptrdiff_t y_off, ptrdiff_t uv_off)
+static void intra_recon(VP9Context *s, ptrdiff_t y_off, ptrdiff_t uv_off)
 {
-    VP9Context *s = ctx->priv_data;
-    VP9Block *const b = &s->b;
+    VP9Block *b = s->b;
     int row = b->row, col = b->col;
     int w4 = bwh_tab[1][b->bs][0] << 1, step1d = 1 << b->tx, n;
     int h4 = bwh_tab[1][b->bs][1] << 1, x, y, step = 1 << (b->tx * 2);
@@ -2154,7 +2317,7 @@ static void intra_recon(AVCodecContext *ctx, ptrdiff_t y_off, ptrdiff_t uv_off)
             LOCAL_ALIGNED_16(uint8_t, a_buf, [48]);
             uint8_t *a = &a_buf[16], l[32];
             enum TxfmType txtp = vp9_intra_txfm_type[mode];
-            int eob = b->tx > TX_8X8 ? AV_RN16A(&s->eob[n]) : s->eob[n];
+            int eob = b->skip ? 0 : b->tx > TX_8X8 ? AV_RN16A(&s->eob[n]) : s->eob[n];
 
             mode = check_intra_mode(s, mode, &a, ptr_r, s->f->linesize[0],
                                     ptr, b->y_stride, l,
@@ -2184,7 +2347,7 @@ static void intra_recon(AVCodecContext *ctx, ptrdiff_t y_off, ptrdiff_t uv_off)
                 int mode = b->uvmode;
                 LOCAL_ALIGNED_16(uint8_t, a_buf, [48]);
                 uint8_t *a = &a_buf[16], l[32];
-                int eob = b->uvtx > TX_8X8 ? AV_RN16A(&s->uveob[p][n]) : s->uveob[p][n];
+                int eob = b->skip ? 0 : b->uvtx > TX_8X8 ? AV_RN16A(&s->uveob[p][n]) : s->uveob[p][n];
 
                 mode = check_intra_mode(s, mode, &a, ptr_r, s->f->linesize[1],
                                         ptr, b->uv_stride, l,
@@ -2203,16 +2366,21 @@ static void intra_recon(AVCodecContext *ctx, ptrdiff_t y_off, ptrdiff_t uv_off)
 static av_always_inline void mc_luma_dir(VP9Context *s, vp9_mc_func (*mc)[2],
                                          uint8_t *dst, ptrdiff_t dst_stride,
                                          const uint8_t *ref, ptrdiff_t ref_stride,
+                                         ThreadFrame *ref_frame,
                                          ptrdiff_t y, ptrdiff_t x, const VP56mv *mv,
                                          int bw, int bh, int w, int h)
 {
-    int mx = mv->x, my = mv->y;
+    int mx = mv->x, my = mv->y, th;
 
     y += my >> 3;
     x += mx >> 3;
     ref += y * ref_stride + x;
     mx &= 7;
     my &= 7;
+    // the last 7 pixel rows of each sb64 row can still be changed by the
+    // loopfilter of the next sb64 row, hence the +7
+    th = (y + bh + 4 * !!my + 7) >> 6;
+    ff_thread_await_progress(ref_frame, FFMAX(th, 0), 0);
     // FIXME bilinear filter only needs 0/1 pixels, not 3/4
     if (x < !!mx * 3 || y < !!my * 3 ||
         x + !!mx * 4 > w - bw || y + !!my * 4 > h - bh) {
@@ -2232,10 +2400,11 @@ static av_always_inline void mc_chroma_dir(VP9Context *s, vp9_mc_func (*mc)[2],
                                            ptrdiff_t dst_stride,
                                            const uint8_t *ref_u, ptrdiff_t src_stride_u,
                                            const uint8_t *ref_v, ptrdiff_t src_stride_v,
+                                           ThreadFrame *ref_frame,
                                            ptrdiff_t y, ptrdiff_t x, const VP56mv *mv,
                                            int bw, int bh, int w, int h)
 {
-    int mx = mv->x, my = mv->y;
+    int mx = mv->x, my = mv->y, th;
 
     y += my >> 4;
     x += mx >> 4;
@@ -2243,6 +2412,9 @@ static av_always_inline void mc_chroma_dir(VP9Context *s, vp9_mc_func (*mc)[2],
     ref_v += y * src_stride_v + x;
     mx &= 15;
     my &= 15;
+    // see mc_luma_dir(); chroma sb64 rows are 32 pixels high
+    th = (y + bh + 4 * !!my + 7) >> 5;
+    ff_thread_await_progress(ref_frame, FFMAX(th, 0), 0);
     // FIXME bilinear filter only needs 0/1 pixels, not 3/4
     if (x < !!mx * 3 || y < !!my * 3 ||
         x + !!mx * 4 > w - bw || y + !!my * 4 > h - bh) {
@@ -2265,17 +2437,17 @@ static av_always_inline void mc_chroma_dir(VP9Context *s, vp9_mc_func (*mc)[2],
     }
 }
 
-static void inter_recon(AVCodecContext *ctx)
+static void inter_recon(AVCodecContext *ctx, VP9Context *s)
 {
     static const uint8_t bwlog_tab[2][N_BS_SIZES] = {
         { 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4 },
         { 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 4, 4 },
     };
-    VP9Context *s = ctx->priv_data;
-    VP9Block *const b = &s->b;
+    VP9Block *b = s->b;
     int row = b->row, col = b->col;
-    AVFrame *ref1 = s->refs[s->refidx[b->ref[0]]];
-    AVFrame *ref2 = b->comp ? s->refs[s->refidx[b->ref[1]]] : NULL;
+    ThreadFrame *tref1 = &s->refs[s->refidx[b->ref[0]]];
+    ThreadFrame *tref2 = b->comp ? &s->refs[s->refidx[b->ref[1]]] : NULL;
+    AVFrame *ref1 = tref1->f, *ref2 = b->comp ? tref2->f : NULL;
     int w = ctx->width, h = ctx->height;
     ptrdiff_t ls_y = b->y_stride, ls_uv = b->uv_stride;
 
@@ -2283,36 +2455,36 @@ static void inter_recon(AVCodecContext *ctx)
     if (b->bs > BS_8x8) {
         if (b->bs == BS_8x4) {
             mc_luma_dir(s, s->dsp.mc[3][b->filter][0], b->dst[0], ls_y,
-                        ref1->data[0], ref1->linesize[0],
+                        ref1->data[0], ref1->linesize[0], tref1,
                         row << 3, col << 3, &b->mv[0][0], 8, 4, w, h);
             mc_luma_dir(s, s->dsp.mc[3][b->filter][0],
                         b->dst[0] + 4 * ls_y, ls_y,
-                        ref1->data[0], ref1->linesize[0],
+                        ref1->data[0], ref1->linesize[0], tref1,
                         (row << 3) + 4, col << 3, &b->mv[2][0], 8, 4, w, h);
 
             if (b->comp) {
                 mc_luma_dir(s, s->dsp.mc[3][b->filter][1], b->dst[0], ls_y,
-                            ref2->data[0], ref2->linesize[0],
+                            ref2->data[0], ref2->linesize[0], tref2,
                             row << 3, col << 3, &b->mv[0][1], 8, 4, w, h);
                 mc_luma_dir(s, s->dsp.mc[3][b->filter][1],
                             b->dst[0] + 4 * ls_y, ls_y,
-                            ref2->data[0], ref2->linesize[0],
+                            ref2->data[0], ref2->linesize[0], tref2,
                             (row << 3) + 4, col << 3, &b->mv[2][1], 8, 4, w, h);
             }
         } else if (b->bs == BS_4x8) {
             mc_luma_dir(s, s->dsp.mc[4][b->filter][0], b->dst[0], ls_y,
-                        ref1->data[0], ref1->linesize[0],
+                        ref1->data[0], ref1->linesize[0], tref1,
                         row << 3, col << 3, &b->mv[0][0], 4, 8, w, h);
             mc_luma_dir(s, s->dsp.mc[4][b->filter][0], b->dst[0] + 4, ls_y,
-                        ref1->data[0], ref1->linesize[0],
+                        ref1->data[0], ref1->linesize[0], tref1,
                         row << 3, (col << 3) + 4, &b->mv[1][0], 4, 8, w, h);
 
             if (b->comp) {
                 mc_luma_dir(s, s->dsp.mc[4][b->filter][1], b->dst[0], ls_y,
-                            ref2->data[0], ref2->linesize[0],
+                            ref2->data[0], ref2->linesize[0], tref2,
                             row << 3, col << 3, &b->mv[0][1], 4, 8, w, h);
                 mc_luma_dir(s, s->dsp.mc[4][b->filter][1], b->dst[0] + 4, ls_y,
-                            ref2->data[0], ref2->linesize[0],
+                            ref2->data[0], ref2->linesize[0], tref2,
                             row << 3, (col << 3) + 4, &b->mv[1][1], 4, 8, w, h);
             }
         } else {
@@ -2321,34 +2493,34 @@ static void inter_recon(AVCodecContext *ctx)
             // FIXME if two horizontally adjacent blocks have the same MV,
             // do a w8 instead of a w4 call
             mc_luma_dir(s, s->dsp.mc[4][b->filter][0], b->dst[0], ls_y,
-                        ref1->data[0], ref1->linesize[0],
+                        ref1->data[0], ref1->linesize[0], tref1,
                         row << 3, col << 3, &b->mv[0][0], 4, 4, w, h);
             mc_luma_dir(s, s->dsp.mc[4][b->filter][0], b->dst[0] + 4, ls_y,
-                        ref1->data[0], ref1->linesize[0],
+                        ref1->data[0], ref1->linesize[0], tref1,
                         row << 3, (col << 3) + 4, &b->mv[1][0], 4, 4, w, h);
             mc_luma_dir(s, s->dsp.mc[4][b->filter][0],
                         b->dst[0] + 4 * ls_y, ls_y,
-                        ref1->data[0], ref1->linesize[0],
+                        ref1->data[0], ref1->linesize[0], tref1,
                         (row << 3) + 4, col << 3, &b->mv[2][0], 4, 4, w, h);
             mc_luma_dir(s, s->dsp.mc[4][b->filter][0],
                         b->dst[0] + 4 * ls_y + 4, ls_y,
-                        ref1->data[0], ref1->linesize[0],
+                        ref1->data[0], ref1->linesize[0], tref1,
                         (row << 3) + 4, (col << 3) + 4, &b->mv[3][0], 4, 4, w, h);
 
             if (b->comp) {
                 mc_luma_dir(s, s->dsp.mc[4][b->filter][1], b->dst[0], ls_y,
-                            ref2->data[0], ref2->linesize[0],
+                            ref2->data[0], ref2->linesize[0], tref2,
                             row << 3, col << 3, &b->mv[0][1], 4, 4, w, h);
                 mc_luma_dir(s, s->dsp.mc[4][b->filter][1], b->dst[0] + 4, ls_y,
-                            ref2->data[0], ref2->linesize[0],
+                            ref2->data[0], ref2->linesize[0], tref2,
                             row << 3, (col << 3) + 4, &b->mv[1][1], 4, 4, w, h);
                 mc_luma_dir(s, s->dsp.mc[4][b->filter][1],
                             b->dst[0] + 4 * ls_y, ls_y,
-                            ref2->data[0], ref2->linesize[0],
+                            ref2->data[0], ref2->linesize[0], tref2,
                             (row << 3) + 4, col << 3, &b->mv[2][1], 4, 4, w, h);
                 mc_luma_dir(s, s->dsp.mc[4][b->filter][1],
                             b->dst[0] + 4 * ls_y + 4, ls_y,
-                            ref2->data[0], ref2->linesize[0],
+                            ref2->data[0], ref2->linesize[0], tref2,
                             (row << 3) + 4, (col << 3) + 4, &b->mv[3][1], 4, 4, w, h);
             }
         }
@@ -2357,12 +2529,12 @@ static void inter_recon(AVCodecContext *ctx)
         int bw = bwh_tab[0][b->bs][0] * 4, bh = bwh_tab[0][b->bs][1] * 4;
 
         mc_luma_dir(s, s->dsp.mc[bwl][b->filter][0], b->dst[0], ls_y,
-                    ref1->data[0], ref1->linesize[0],
+                    ref1->data[0], ref1->linesize[0], tref1,
                     row << 3, col << 3, &b->mv[0][0],bw, bh, w, h);
 
         if (b->comp)
             mc_luma_dir(s, s->dsp.mc[bwl][b->filter][1], b->dst[0], ls_y,
-                        ref2->data[0], ref2->linesize[0],
+                        ref2->data[0], ref2->linesize[0], tref2,
                         row << 3, col << 3, &b->mv[0][1], bw, bh, w, h);
     }
 
@@ -2384,7 +2556,7 @@ static void inter_recon(AVCodecContext *ctx)
         mc_chroma_dir(s, s->dsp.mc[bwl][b->filter][0],
                       b->dst[1], b->dst[2], ls_uv,
                       ref1->data[1], ref1->linesize[1],
-                      ref1->data[2], ref1->linesize[2],
+                      ref1->data[2], ref1->linesize[2], tref1,
                       row << 2, col << 2, &mvuv, bw, bh, w, h);
 
         if (b->comp) {
@@ -2397,7 +2569,7 @@ static void inter_recon(AVCodecContext *ctx)
             mc_chroma_dir(s, s->dsp.mc[bwl][b->filter][1],
                           b->dst[1], b->dst[2], ls_uv,
                           ref2->data[1], ref2->linesize[1],
-                          ref2->data[2], ref2->linesize[2],
+                          ref2->data[2], ref2->linesize[2], tref2,
                           row << 2, col << 2, &mvuv, bw, bh, w, h);
         }
     }
@@ -2582,42 +2754,14 @@ static av_always_inline void mask_edges(struct VP9Filter *lflvl, int is_uv,
     }
 }
 
-static int decode_b(AVCodecContext *ctx, int row, int col,
-                    struct VP9Filter *lflvl, ptrdiff_t yoff, ptrdiff_t uvoff,
-                    enum BlockLevel bl, enum BlockPartition bp)
+static void recon_b(AVCodecContext *ctx, VP9Context *s, struct VP9Filter *lflvl,
+                    ptrdiff_t yoff, ptrdiff_t uvoff)
 {
-    VP9Context *s = ctx->priv_data;
-    VP9Block *const b = &s->b;
-    enum BlockSize bs = bl * 3 + bp;
-    int res, y, w4 = bwh_tab[1][bs][0], h4 = bwh_tab[1][bs][1], lvl;
+    VP9Block *b = s->b;
+    int row = b->row, col = b->col;
+    int y, w4 = bwh_tab[1][b->bs][0], h4 = bwh_tab[1][b->bs][1], lvl;
     int emu[2];
 
-    b->row = row;
-    b->row7 = row & 7;
-    b->col = col;
-    b->col7 = col & 7;
-    s->min_mv.x = -(128 + col * 64);
-    s->min_mv.y = -(128 + row * 64);
-    s->max_mv.x = 128 + (s->cols - col - w4) * 64;
-    s->max_mv.y = 128 + (s->rows - row - h4) * 64;
-    b->bs = bs;
-    decode_mode(ctx);
-    b->uvtx = b->tx - (w4 * 2 == (1 << b->tx) || h4 * 2 == (1 << b->tx));
-
-    if (!b->skip) {
-        if ((res = decode_coeffs(ctx)) < 0)
-            return res;
-    } else {
-        int pl;
-
-        memset(&s->above_y_nnz_ctx[col * 2], 0, w4 * 2);
-        memset(&s->left_y_nnz_ctx[(row & 7) << 1], 0, h4 * 2);
-        for (pl = 0; pl < 2; pl++) {
-            memset(&s->above_uv_nnz_ctx[pl][col], 0, w4);
-            memset(&s->left_uv_nnz_ctx[pl][row & 7], 0, h4);
-        }
-    }
-
     // emulated overhangs if the stride of the target buffer can't hold. This
     // allows to support emu-edge and so on even if we have large block
     // overhangs
@@ -2642,9 +2786,9 @@ static int decode_b(AVCodecContext *ctx, int row, int col,
         b->uv_stride = s->f->linesize[1];
     }
     if (b->intra) {
-        intra_recon(ctx, yoff, uvoff);
+        intra_recon(s, yoff, uvoff);
     } else {
-        inter_recon(ctx);
+        inter_recon(ctx, s);
     }
     if (emu[0]) {
         int w = FFMIN(s->cols - col, w4) * 8, h = FFMIN(s->rows - row, h4) * 8, n, o = 0;
@@ -2691,31 +2835,73 @@ static int decode_b(AVCodecContext *ctx, int row, int col,
                    s->cols & 1 && col + w4 >= s->cols ? s->cols & 7 : 0,
                    s->rows & 1 && row + h4 >= s->rows ? s->rows & 7 : 0,
                    b->uvtx, skip_inter);
+    }
+}
 
-        if (!s->filter.lim_lut[lvl]) {
-            int sharp = s->filter.sharpness;
-            int limit = lvl;
+static int decode_b(AVCodecContext *ctx, VP9Context *s, int row, int col,
+                    struct VP9Filter *lflvl, ptrdiff_t yoff, ptrdiff_t uvoff,
+                    enum BlockLevel bl, enum BlockPartition bp)
+{
+    VP9Block *b = s->b;
+    enum BlockSize bs = bl * 3 + bp;
+    int res, w4 = bwh_tab[1][bs][0], h4 = bwh_tab[1][bs][1];
 
-            if (sharp > 0) {
-                limit >>= (sharp + 3) >> 2;
-                limit = FFMIN(limit, 9 - sharp);
-            }
-            limit = FFMAX(limit, 1);
+    b->row = row;
+    b->row7 = row & 7;
+    b->col = col;
+    b->col7 = col & 7;
+    s->min_mv.x = -(128 + col * 64);
+    s->min_mv.y = -(128 + row * 64);
+    s->max_mv.x = 128 + (s->cols - col - w4) * 64;
+    s->max_mv.y = 128 + (s->rows - row - h4) * 64;
+    b->bs = bs;
+    decode_mode(s);
+    b->uvtx = b->tx - (w4 * 2 == (1 << b->tx) || h4 * 2 == (1 << b->tx));
+
+    if (!b->skip) {
+        if ((res = decode_coeffs(s)) < 0)
+            return res;
+    } else {
+        int pl;
 
-            s->filter.lim_lut[lvl] = limit;
-            s->filter.mblim_lut[lvl] = 2 * (lvl + 2) + limit;
+        memset(&s->above_y_nnz_ctx[col * 2], 0, w4 * 2);
+        memset(&s->left_y_nnz_ctx[(row & 7) << 1], 0, h4 * 2);
+        for (pl = 0; pl < 2; pl++) {
+            memset(&s->above_uv_nnz_ctx[pl][col], 0, w4);
+            memset(&s->left_uv_nnz_ctx[pl][row & 7], 0, h4);
         }
     }
 
+    // in the first of two passes, only store the block for reconstruction
+    // once the probabilities for the next frame have been adapted
+    if (s->pass == 1) {
+        next_block_ptrs(s);
+    } else {
+        recon_b(ctx, s, lflvl, yoff, uvoff);
+    }
+
     return 0;
 }
 
-static int decode_sb(AVCodecContext *ctx, int row, int col, struct VP9Filter *lflvl,
-                     ptrdiff_t yoff, ptrdiff_t uvoff, enum BlockLevel bl)
+// reconstruct the blocks of one sb64 that were stored in the first pass
+static void recon_sb(AVCodecContext *ctx, VP9Context *s, int row, int col,
+                     struct VP9Filter *lflvl)
+{
+    ptrdiff_t ls_y = s->f->linesize[0], ls_uv = s->f->linesize[1];
+
+    while (s->b < s->b_end && (s->b->row & ~7) == row && (s->b->col & ~7) == col) {
+        recon_b(ctx, s, lflvl, s->b->row * 8 * ls_y + s->b->col * 8,
+                s->b->row * 4 * ls_uv + s->b->col * 4);
+        next_block_ptrs(s);
+    }
+}
+
+static int decode_sb(AVCodecContext *ctx, VP9Context *s, int row, int col,
+                     struct VP9Filter *lflvl, ptrdiff_t yoff, ptrdiff_t uvoff,
+                     enum BlockLevel bl)
 {
-    VP9Context *s = ctx->priv_data;
     int c = ((s->above_partition_ctx[col] >> (3 - bl)) & 1) |
-            (((s->left_partition_ctx[row & 0x7] >> (3 - bl)) & 1) << 1), res;
+            (((s->left_partition_ctx[row & 0x7] >> (3 - bl)) & 1) << 1), res = 0;
     const uint8_t *p = s->keyframe ? vp9_default_kf_partition_probs[bl][c] :
                                      s->prob.p.partition[bl][c];
     enum BlockPartition bp;
@@ -2723,37 +2909,37 @@ static int decode_sb(AVCodecContext *ctx, int row, int col, struct VP9Filter *lf
 
     if (bl == BL_8X8) {
         bp = vp8_rac_get_tree(&s->c, vp9_partition_tree, p);
-        res = decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp);
+        res = decode_b(ctx, s, row, col, lflvl, yoff, uvoff, bl, bp);
     } else if (col + hbs < s->cols) {
         if (row + hbs < s->rows) {
             bp = vp8_rac_get_tree(&s->c, vp9_partition_tree, p);
             switch (bp) {
             case PARTITION_NONE:
-                res = decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp);
+                res = decode_b(ctx, s, row, col, lflvl, yoff, uvoff, bl, bp);
                 break;
             case PARTITION_H:
-                if (!(res = decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp))) {
+                if (!(res = decode_b(ctx, s, row, col, lflvl, yoff, uvoff, bl, bp))) {
                     yoff  += hbs * 8 * s->f->linesize[0];
                     uvoff += hbs * 4 * s->f->linesize[1];
-                    res = decode_b(ctx, row + hbs, col, lflvl, yoff, uvoff, bl, bp);
+                    res = decode_b(ctx, s, row + hbs, col, lflvl, yoff, uvoff, bl, bp);
                 }
                 break;
             case PARTITION_V:
-                if (!(res = decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp))) {
+                if (!(res = decode_b(ctx, s, row, col, lflvl, yoff, uvoff, bl, bp))) {
                     yoff  += hbs * 8;
                     uvoff += hbs * 4;
-                    res = decode_b(ctx, row, col + hbs, lflvl, yoff, uvoff, bl, bp);
+                    res = decode_b(ctx, s, row, col + hbs, lflvl, yoff, uvoff, bl, bp);
                 }
                 break;
             case PARTITION_SPLIT:
-                if (!(res = decode_sb(ctx, row, col, lflvl, yoff, uvoff, bl + 1))) {
-                    if (!(res = decode_sb(ctx, row, col + hbs, lflvl,
+                if (!(res = decode_sb(ctx, s, row, col, lflvl, yoff, uvoff, bl + 1))) {
+                    if (!(res = decode_sb(ctx, s, row, col + hbs, lflvl,
                                           yoff + 8 * hbs, uvoff + 4 * hbs, bl + 1))) {
                         yoff  += hbs * 8 * s->f->linesize[0];
                         uvoff += hbs * 4 * s->f->linesize[1];
-                        if (!(res = decode_sb(ctx, row + hbs, col, lflvl,
+                        if (!(res = decode_sb(ctx, s, row + hbs, col, lflvl,
                                               yoff, uvoff, bl + 1)))
-                            res = decode_sb(ctx, row + hbs, col + hbs, lflvl,
+                            res = decode_sb(ctx, s, row + hbs, col + hbs, lflvl,
                                             yoff + 8 * hbs, uvoff + 4 * hbs, bl + 1);
                     }
                 }
@@ -2761,29 +2947,29 @@ static int decode_sb(AVCodecContext *ctx, int row, int col, struct VP9Filter *lf
             }
         } else if (vp56_rac_get_prob_branchy(&s->c, p[1])) {
             bp = PARTITION_SPLIT;
-            if (!(res = decode_sb(ctx, row, col, lflvl, yoff, uvoff, bl + 1)))
-                res = decode_sb(ctx, row, col + hbs, lflvl,
+            if (!(res = decode_sb(ctx, s, row, col, lflvl, yoff, uvoff, bl + 1)))
+                res = decode_sb(ctx, s, row, col + hbs, lflvl,
                                 yoff + 8 * hbs, uvoff + 4 * hbs, bl + 1);
         } else {
             bp = PARTITION_H;
-            res = decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp);
+            res = decode_b(ctx, s, row, col, lflvl, yoff, uvoff, bl, bp);
         }
     } else if (row + hbs < s->rows) {
         if (vp56_rac_get_prob_branchy(&s->c, p[2])) {
             bp = PARTITION_SPLIT;
-            if (!(res = decode_sb(ctx, row, col, lflvl, yoff, uvoff, bl + 1))) {
+            if (!(res = decode_sb(ctx, s, row, col, lflvl, yoff, uvoff, bl + 1))) {
                 yoff  += hbs * 8 * s->f->linesize[0];
                 uvoff += hbs * 4 * s->f->linesize[1];
-                res = decode_sb(ctx, row + hbs, col, lflvl,
+                res = decode_sb(ctx, s, row + hbs, col, lflvl,
                                 yoff, uvoff, bl + 1);
             }
         } else {
             bp = PARTITION_V;
-            res = decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp);
+            res = decode_b(ctx, s, row, col, lflvl, yoff, uvoff, bl, bp);
         }
     } else {
         bp = PARTITION_SPLIT;
-        res = decode_sb(ctx, row, col, lflvl, yoff, uvoff, bl + 1);
+        res = decode_sb(ctx, s, row, col, lflvl, yoff, uvoff, bl + 1);
     }
     s->counts.partition[bl][c][bp]++;
 
@@ -3274,22 +3460,294 @@ static void adapt_probs(VP9Context *s)
     }
 }
 
+static void copy_segmentation_map_row(VP9Context *s, int row)
+{
+    // the segmentation map persists across frames, so carry this row of sb64s
+    // over from the previous frame before it is (partially) overwritten
+    VP9Frame *last = &s->frames[LAST_FRAME];
+    uint8_t *dst = s->frames[CUR_FRAME].segmentation_map + row * 8 * s->sb_cols;
+
+    if (!last->tf.f->data[0]) {
+        memset(dst, 0, 64 * s->sb_cols);
+        return;
+    }
+    if (!last->uses_2pass)
+        ff_thread_await_progress(&last->tf, row >> 3, 0);
+    memcpy(dst, last->segmentation_map + row * 8 * s->sb_cols, 64 * s->sb_cols);
+}
+
+static void backup_intra_pred(VP9Context *s, int row, int col_start, int col_end,
+                              ptrdiff_t yoff, ptrdiff_t uvoff)
+{
+    // backup pre-loopfilter reconstruction data for intra
+    // prediction of next row of sb64s
+    if (row + 8 < s->rows) {
+        int w = FFMIN(col_end, s->cols) - col_start;
+
+        memcpy(s->intra_pred_data[0] + col_start * 8,
+               s->f->data[0] + yoff + 63 * s->f->linesize[0] + col_start * 8,
+               8 * w);
+        memcpy(s->intra_pred_data[1] + col_start * 4,
+               s->f->data[1] + uvoff + 31 * s->f->linesize[1] + col_start * 4,
+               4 * w);
+        memcpy(s->intra_pred_data[2] + col_start * 4,
+               s->f->data[2] + uvoff + 31 * s->f->linesize[2] + col_start * 4,
+               4 * w);
+    }
+}
+
+static void loopfilter_sbrow(AVCodecContext *ctx, VP9Context *s, int row,
+                             ptrdiff_t yoff, ptrdiff_t uvoff)
+{
+    struct VP9Filter *lflvl = s->lflvl + (row >> 3) * s->sb_cols;
+    int col;
+
+    if (!s->filter.level)
+        return;
+    for (col = 0; col < s->cols; col += 8, yoff += 64, uvoff += 32, lflvl++)
+        loopfilter_sb(ctx, lflvl, row, col, yoff, uvoff);
+}
+
+// decode (or, in the second pass, reconstruct) one row of sb64s of a tile
+static int decode_tile_sbrow(AVCodecContext *ctx, VP9Context *s, int row,
+                             int tile_col, ptrdiff_t yoff, ptrdiff_t uvoff)
+{
+    struct VP9Filter *lflvl;
+    int col, res;
+
+    set_tile_offset(&s->tiling.tile_col_start, &s->tiling.tile_col_end,
+                    tile_col, s->tiling.log2_tile_cols, s->sb_cols);
+    lflvl  = s->lflvl + (row >> 3) * s->sb_cols + (s->tiling.tile_col_start >> 3);
+    yoff  += s->tiling.tile_col_start * 8;
+    uvoff += s->tiling.tile_col_start * 4;
+
+    if (s->pass == 2) {
+        for (col = s->tiling.tile_col_start;
+             col < s->tiling.tile_col_end;
+             col += 8, lflvl++) {
+            memset(lflvl->mask, 0, sizeof(lflvl->mask));
+            recon_sb(ctx, s, row, col, lflvl);
+        }
+        return 0;
+    }
+
+    memset(s->left_partition_ctx, 0, 8);
+    memset(s->left_skip_ctx, 0, 8);
+    if (s->keyframe || s->intraonly) {
+        memset(s->left_mode_ctx, DC_PRED, 16);
+    } else {
+        memset(s->left_mode_ctx, NEARESTMV, 8);
+    }
+    memset(s->left_y_nnz_ctx, 0, 16);
+    memset(s->left_uv_nnz_ctx, 0, 16);
+    memset(s->left_segpred_ctx, 0, 8);
+
+    memcpy(&s->c, &s->c_b[tile_col], sizeof(s->c));
+    for (col = s->tiling.tile_col_start;
+         col < s->tiling.tile_col_end;
+         col += 8, yoff += 64, uvoff += 32, lflvl++) {
+        // FIXME integrate with lf code (i.e. zero after each
+        // use, similar to invtxfm coefficients, or similar)
+        memset(lflvl->mask, 0, sizeof(lflvl->mask));
+
+        if ((res = decode_sb(ctx, s, row, col, lflvl, yoff, uvoff, BL_64X64)) < 0)
+            return res;
+    }
+    memcpy(&s->c_b[tile_col], &s->c, sizeof(s->c));
+
+    return 0;
+}
+
+// slice thread job: decode one tile column of the current tile row in a
+// private copy of the decoder context
+static int decode_tile_col(AVCodecContext *ctx, void *arg, int tile_col,
+                           int threadnr)
+{
+    VP9Context *s = ctx->priv_data, *td = &s->tile_ctx[tile_col];
+    VP9Block *b_base = td->b_base;
+    int16_t *block_base = td->block_base;
+    ptrdiff_t yoff, uvoff;
+    int row, res;
+
+    // everything but the block buffers is shared with the main context
+    memcpy(td, s, sizeof(*td));
+    td->tile_ctx        = NULL;
+    td->tile_res        = NULL;
+    td->nb_tile_ctx     = 0;
+    td->b_base          = b_base;
+    td->block_base      = block_base;
+    td->block_alloc_sbs = 1;
+    set_block_base_ptrs(td);
+    reset_block_ptrs(td);
+    memset(&td->counts, 0, sizeof(td->counts));
+
+    yoff  = s->tiling.tile_row_start * 8 * s->f->linesize[0];
+    uvoff = s->tiling.tile_row_start * 4 * s->f->linesize[1];
+    for (row = s->tiling.tile_row_start;
+         row < s->tiling.tile_row_end;
+         row += 8, yoff += s->f->linesize[0] * 64,
+         uvoff += s->f->linesize[1] * 32) {
+        if ((res = decode_tile_sbrow(ctx, td, row, tile_col, yoff, uvoff)) < 0)
+            return res;
+        backup_intra_pred(td, row, td->tiling.tile_col_start,
+                          td->tiling.tile_col_end, yoff, uvoff);
+    }
+
+    return 0;
+}
+
+static int decode_tiles(AVCodecContext *ctx, const uint8_t *data, int size,
+                        int last_in_packet)
+{
+    VP9Context *s = ctx->priv_data;
+    int slice_threads = ctx->active_thread_type & FF_THREAD_SLICE &&
+                        s->tiling.tile_cols > 1;
+    int res, tile_row, tile_col, row, i;
+    ptrdiff_t yoff, uvoff;
+
+    if (slice_threads && s->nb_tile_ctx < s->tiling.tile_cols) {
+        VP9Context *tile_ctx = av_realloc_array(s->tile_ctx, s->tiling.tile_cols,
+                                                sizeof(*s->tile_ctx));
+        int *tile_res;
+
+        if (!tile_ctx)
+            return AVERROR(ENOMEM);
+        s->tile_ctx = tile_ctx;
+        if (!(tile_res = av_realloc_array(s->tile_res, s->tiling.tile_cols,
+                                          sizeof(*s->tile_res))))
+            return AVERROR(ENOMEM);
+        s->tile_res = tile_res;
+        for (i = s->nb_tile_ctx; i < s->tiling.tile_cols; i++) {
+            memset(&s->tile_ctx[i], 0, sizeof(*s->tile_ctx));
+            if ((res = update_block_buffers(&s->tile_ctx[i], 1)) < 0)
+                return res;
+            s->nb_tile_ctx = i + 1;
+        }
+    }
+
+    do {
+        yoff = uvoff = 0;
+        reset_block_ptrs(s);
+        for (tile_row = 0; tile_row < s->tiling.tile_rows; tile_row++) {
+            set_tile_offset(&s->tiling.tile_row_start, &s->tiling.tile_row_end,
+                            tile_row, s->tiling.log2_tile_rows, s->sb_rows);
+            // the second pass only reconstructs the blocks stored in the first
+            for (tile_col = 0; s->pass != 2 && tile_col < s->tiling.tile_cols;
+                 tile_col++) {
+                unsigned tile_size;
+
+                if (tile_col == s->tiling.tile_cols - 1 &&
+                    tile_row == s->tiling.tile_rows - 1) {
+                    tile_size = size;
+                } else {
+                    tile_size = AV_RB32(data);
+                    data += 4;
+                    size -= 4;
+                }
+                if (tile_size > size)
+                    return AVERROR_INVALIDDATA;
+                ff_vp56_init_range_decoder(&s->c_b[tile_col], data, tile_size);
+                if (vp56_rac_get_prob_branchy(&s->c_b[tile_col], 128)) // marker bit
+                    return AVERROR_INVALIDDATA;
+                data += tile_size;
+                size -= tile_size;
+            }
+
+            if (slice_threads) {
+                if (!s->keyframe)
+                    for (row = s->tiling.tile_row_start;
+                         row < s->tiling.tile_row_end; row += 8)
+                        copy_segmentation_map_row(s, row);
+                ctx->execute2(ctx, decode_tile_col, NULL, s->tile_res,
+                              s->tiling.tile_cols);
+                for (tile_col = 0; tile_col < s->tiling.tile_cols; tile_col++) {
+                    unsigned *dst = (unsigned *) &s->counts;
+                    unsigned *src = (unsigned *) &s->tile_ctx[tile_col].counts;
+
+                    if (s->tile_res[tile_col] < 0)
+                        return s->tile_res[tile_col];
+                    for (i = 0; i < sizeof(s->counts) / sizeof(unsigned); i++)
+                        dst[i] += src[i];
+                }
+
+                // the loopfilter crosses tile boundaries, so it can only run
+                // once all tile columns of this tile row are done
+                for (row = s->tiling.tile_row_start;
+                     row < s->tiling.tile_row_end;
+                     row += 8, yoff += s->f->linesize[0] * 64,
+                     uvoff += s->f->linesize[1] * 32) {
+                    loopfilter_sbrow(ctx, s, row, yoff, uvoff);
+                    ff_thread_report_progress(&s->frames[CUR_FRAME].tf, row >> 3, 0);
+                }
+                continue;
+            }
+
+            for (row = s->tiling.tile_row_start;
+                 row < s->tiling.tile_row_end;
+                 row += 8, yoff += s->f->linesize[0] * 64,
+                 uvoff += s->f->linesize[1] * 32) {
+                if (s->pass != 2 && !s->keyframe)
+                    copy_segmentation_map_row(s, row);
+
+                for (tile_col = 0; tile_col < s->tiling.tile_cols; tile_col++)
+                    if ((res = decode_tile_sbrow(ctx, s, row, tile_col,
+                                                 yoff, uvoff)) < 0)
+                        return res;
+
+                if (s->pass == 1)
+                    continue;
+
+                backup_intra_pred(s, row, 0, s->cols, yoff, uvoff);
+
+                // loopfilter one row
+                loopfilter_sbrow(ctx, s, row, yoff, uvoff);
+
+                ff_thread_report_progress(&s->frames[CUR_FRAME].tf, row >> 3, 0);
+            }
+        }
+
+        if (s->pass == 1)
+            s->b_end = s->b;
+
+        // bw adaptivity; in frame threads, the next frame can start decoding
+        // as soon as the adapted probabilities are known, and the
+        // reconstruction is done in a second pass
+        if (s->pass < 2 && s->refreshctx && !s->parallelmode) {
+            adapt_probs(s);
+            if (last_in_packet)
+                ff_thread_finish_setup(ctx);
+        }
+    } while (s->pass++ == 1);
+
+    return 0;
+}
+
 static int vp9_decode_frame(AVCodecContext *ctx, void *out_pic,
-                            int *got_frame, const uint8_t *data, int size)
+                            int *got_frame, const uint8_t *data, int size,
+                            int last_in_packet)
 {
     VP9Context *s = ctx->priv_data;
-    int res, tile_row, tile_col, i, ref, row, col;
-    ptrdiff_t yoff = 0, uvoff = 0;
-    //AVFrame *prev_frame = s->f; // for segmentation map
+    int res, i, ref;
+
+    // unless refreshed below, the references are passed on unchanged
+    for (i = 0; i < 8; i++) {
+        ff_thread_release_buffer(ctx, &s->next_refs[i]);
+        if (s->refs[i].f->data[0] &&
+            (res = ff_thread_ref_frame(&s->next_refs[i], &s->refs[i])) < 0)
+            return res;
+    }
 
     if ((res = decode_frame_header(ctx, data, size, &ref)) < 0) {
         return res;
     } else if (res == 0) {
-        if (!s->refs[ref]) {
+        if (!s->refs[ref].f->data[0]) {
             av_log(ctx, AV_LOG_ERROR, "Requested reference %d not available\n", ref);
             return AVERROR_INVALIDDATA;
         }
-        if ((res = av_frame_ref(out_pic, s->refs[ref])) < 0)
+        if (last_in_packet)
+            ff_thread_finish_setup(ctx);
+        ff_thread_await_progress(&s->refs[ref], INT_MAX, 0);
+        if ((res = av_frame_ref(out_pic, s->refs[ref].f)) < 0)
             return res;
         *got_frame = 1;
         return 0;
@@ -3297,28 +3755,41 @@ static int vp9_decode_frame(AVCodecContext *ctx, void *out_pic,
     data += res;
     size -= res;
 
-    // discard old references
-    for (i = 0; i < 10; i++) {
-        AVFrame *f = s->fb[i];
-        if (f->data[0] && f != s->f &&
-            f != s->refs[0] && f != s->refs[1] &&
-            f != s->refs[2] && f != s->refs[3] &&
-            f != s->refs[4] && f != s->refs[5] &&
-            f != s->refs[6] && f != s->refs[7])
-            av_frame_unref(f);
-    }
-
-    // find unused reference
-    for (i = 0; i < 10; i++)
-        if (!s->fb[i]->data[0])
-            break;
-    s->f = s->fb[i];
-    if ((res = ff_get_buffer(ctx, s->f,
-                             s->refreshrefmask ? AV_GET_BUFFER_FLAG_REF : 0)) < 0)
+    // the previous frame provides the segmentation map and (if the size
+    // did not change) the co-located motion vectors
+    vp9_unref_frame(ctx, &s->frames[LAST_FRAME]);
+    FFSWAP(VP9Frame, s->frames[CUR_FRAME], s->frames[LAST_FRAME]);
+    if (s->frames[LAST_FRAME].tf.f->data[0] &&
+        (s->frames[LAST_FRAME].cols != s->cols ||
+         s->frames[LAST_FRAME].rows != s->rows))
+        vp9_unref_frame(ctx, &s->frames[LAST_FRAME]);
+    s->use_last_frame_mvs &= !!s->frames[LAST_FRAME].tf.f->data[0];
+
+    if ((res = vp9_alloc_frame(ctx, &s->frames[CUR_FRAME])) < 0)
         return res;
+    s->f = s->frames[CUR_FRAME].tf.f;
     s->f->key_frame = s->keyframe;
     s->f->pict_type = s->keyframe ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_P;
 
+    // ref frame setup
+    for (i = 0; i < 8; i++) {
+        if (s->refreshrefmask & (1 << i)) {
+            ff_thread_release_buffer(ctx, &s->next_refs[i]);
+            if ((res = ff_thread_ref_frame(&s->next_refs[i],
+                                           &s->frames[CUR_FRAME].tf)) < 0)
+                return res;
+        }
+    }
+
+    // with backward adaptation, the next frame in another thread depends on
+    // the symbol counts of the whole frame; decode all symbols in a first
+    // pass so it can start while we reconstruct the frame in a second pass
+    s->pass = s->frames[CUR_FRAME].uses_2pass =
+        ctx->active_thread_type & FF_THREAD_FRAME && s->refreshctx &&
+        !s->parallelmode && last_in_packet;
+    if ((res = update_block_buffers(s, s->pass ? s->sb_cols * s->sb_rows : 1)) < 0)
+        return res;
+
     // main tile decode loop
     memset(s->above_partition_ctx, 0, s->cols);
     memset(s->above_skip_ctx, 0, s->cols);
@@ -3331,117 +3802,40 @@ static int vp9_decode_frame(AVCodecContext *ctx, void *out_pic,
     memset(s->above_uv_nnz_ctx[0], 0, s->sb_cols * 8);
     memset(s->above_uv_nnz_ctx[1], 0, s->sb_cols * 8);
     memset(s->above_segpred_ctx, 0, s->cols);
-    for (tile_row = 0; tile_row < s->tiling.tile_rows; tile_row++) {
-        set_tile_offset(&s->tiling.tile_row_start, &s->tiling.tile_row_end,
-                        tile_row, s->tiling.log2_tile_rows, s->sb_rows);
-        for (tile_col = 0; tile_col < s->tiling.tile_cols; tile_col++) {
-            unsigned tile_size;
-
-            if (tile_col == s->tiling.tile_cols - 1 &&
-                tile_row == s->tiling.tile_rows - 1) {
-                tile_size = size;
-            } else {
-                tile_size = AV_RB32(data);
-                data += 4;
-                size -= 4;
-            }
-            if (tile_size > size)
-                return AVERROR_INVALIDDATA;
-            ff_vp56_init_range_decoder(&s->c_b[tile_col], data, tile_size);
-            if (vp56_rac_get_prob_branchy(&s->c_b[tile_col], 128)) // marker bit
-                return AVERROR_INVALIDDATA;
-            data += tile_size;
-            size -= tile_size;
-        }
-
-        for (row = s->tiling.tile_row_start;
-             row < s->tiling.tile_row_end;
-             row += 8, yoff += s->f->linesize[0] * 64,
-             uvoff += s->f->linesize[1] * 32) {
-            struct VP9Filter *lflvl_ptr = s->lflvl;
-            ptrdiff_t yoff2 = yoff, uvoff2 = uvoff;
 
-            for (tile_col = 0; tile_col < s->tiling.tile_cols; tile_col++) {
-                set_tile_offset(&s->tiling.tile_col_start, &s->tiling.tile_col_end,
-                                tile_col, s->tiling.log2_tile_cols, s->sb_cols);
+    // fw adaptivity (probability maintenance between frames in parallel
+    // decoding mode) does not depend on the frame data
+    if (s->refreshctx && s->parallelmode) {
+        int j, k, l, m;
 
-                memset(s->left_partition_ctx, 0, 8);
-                memset(s->left_skip_ctx, 0, 8);
-                if (s->keyframe || s->intraonly) {
-                    memset(s->left_mode_ctx, DC_PRED, 16);
-                } else {
-                    memset(s->left_mode_ctx, NEARESTMV, 8);
-                }
-                memset(s->left_y_nnz_ctx, 0, 16);
-                memset(s->left_uv_nnz_ctx, 0, 16);
-                memset(s->left_segpred_ctx, 0, 8);
-
-                memcpy(&s->c, &s->c_b[tile_col], sizeof(s->c));
-                for (col = s->tiling.tile_col_start;
-                     col < s->tiling.tile_col_end;
-                     col += 8, yoff2 += 64, uvoff2 += 32, lflvl_ptr++) {
-                    // FIXME integrate with lf code (i.e. zero after each
-                    // use, similar to invtxfm coefficients, or similar)
-                    memset(lflvl_ptr->mask, 0, sizeof(lflvl_ptr->mask));
-
-                    if ((res = decode_sb(ctx, row, col, lflvl_ptr,
-                                         yoff2, uvoff2, BL_64X64)) < 0)
-                        return res;
-                }
-                memcpy(&s->c_b[tile_col], &s->c, sizeof(s->c));
-            }
-
-            // backup pre-loopfilter reconstruction data for intra
-            // prediction of next row of sb64s
-            if (row + 8 < s->rows) {
-                memcpy(s->intra_pred_data[0],
-                       s->f->data[0] + yoff + 63 * s->f->linesize[0],
-                       8 * s->cols);
-                memcpy(s->intra_pred_data[1],
-                       s->f->data[1] + uvoff + 31 * s->f->linesize[1],
-                       4 * s->cols);
-                memcpy(s->intra_pred_data[2],
-                       s->f->data[2] + uvoff + 31 * s->f->linesize[2],
-                       4 * s->cols);
-            }
-
-            // loopfilter one row
-            if (s->filter.level) {
-                yoff2 = yoff;
-                uvoff2 = uvoff;
-                lflvl_ptr = s->lflvl;
-                for (col = 0; col < s->cols;
-                     col += 8, yoff2 += 64, uvoff2 += 32, lflvl_ptr++) {
-                    loopfilter_sb(ctx, lflvl_ptr, row, col, yoff2, uvoff2);
-                }
-            }
+        // coefficient probabilities of transform sizes above txfmmode were
+        // not set up for this frame, so they are left as they are
+        for (i = 0; i < 4; i++) {
+            for (j = 0; j < 2; j++)
+                for (k = 0; k < 2; k++)
+                    for (l = 0; l < 6; l++)
+                        for (m = 0; m < 6; m++)
+                            memcpy(s->prob_ctx[s->framectxid].coef[i][j][k][l][m],
+                                   s->prob.coef[i][j][k][l][m], 3);
+            if (s->txfmmode == i)
+                break;
         }
+        s->prob_ctx[s->framectxid].p = s->prob.p;
     }
+    if ((!s->refreshctx || s->parallelmode) && last_in_packet)
+        ff_thread_finish_setup(ctx);
 
-    // bw adaptivity (or in case of parallel decoding mode, fw adaptivity
-    // probability maintenance between frames)
-    if (s->refreshctx) {
-        if (s->parallelmode) {
-            int i, j, k, l, m;
+    res = decode_tiles(ctx, data, size, last_in_packet);
+    ff_thread_report_progress(&s->frames[CUR_FRAME].tf, INT_MAX, 0);
+    if (res < 0)
+        return res;
 
-            for (i = 0; i < 4; i++)
-                for (j = 0; j < 2; j++)
-                    for (k = 0; k < 2; k++)
-                        for (l = 0; l < 6; l++)
-                            for (m = 0; m < 6; m++)
-                                memcpy(s->prob_ctx[s->framectxid].coef[i][j][k][l][m],
-                                       s->prob.coef[i][j][k][l][m], 3);
-            s->prob_ctx[s->framectxid].p = s->prob.p;
-        } else {
-            adapt_probs(s);
-        }
+    for (i = 0; i < 8; i++) {
+        ff_thread_release_buffer(ctx, &s->refs[i]);
+        if (s->next_refs[i].f->data[0] &&
+            (res = ff_thread_ref_frame(&s->refs[i], &s->next_refs[i])) < 0)
+            return res;
     }
-    FFSWAP(struct VP9mvrefPair *, s->mv[0], s->mv[1]);
-
-    // ref frame setup
-    for (i = 0; i < 8; i++)
-        if (s->refreshrefmask & (1 << i))
-            s->refs[i] = s->f;
 
     if (!s->invisible) {
         if ((res = av_frame_ref(out_pic, s->f)) < 0)
@@ -3481,7 +3875,7 @@ static int vp9_decode_packet(AVCodecContext *avctx, void *out_pic,
                             return AVERROR_INVALIDDATA; \
                         } \
                         res = vp9_decode_frame(avctx, out_pic, got_frame, \
-                                               data, sz); \
+                                               data, sz, !n_frames); \
                         if (res < 0) \
                             return res; \
                         data += sz; \
@@ -3498,7 +3892,7 @@ static int vp9_decode_packet(AVCodecContext *avctx, void *out_pic,
     }
     // if we get here, there was no valid superframe index, i.e. this is just
     // one whole single frame - decode it as such from the complete input buf
-    if ((res = vp9_decode_frame(avctx, out_pic, got_frame, data, size)) < 0)
+    if ((res = vp9_decode_frame(avctx, out_pic, got_frame, data, size, 1)) < 0)
         return res;
     return size;
 }
@@ -3508,31 +3902,97 @@ static void vp9_decode_flush(AVCodecContext *ctx)
     VP9Context *s = ctx->priv_data;
     int i;
 
-    for (i = 0; i < 10; i++)
-        if (s->fb[i]->data[0])
-            av_frame_unref(s->fb[i]);
+    for (i = 0; i < 2; i++)
+        vp9_unref_frame(ctx, &s->frames[i]);
     for (i = 0; i < 8; i++)
-        s->refs[i] = NULL;
+        ff_thread_release_buffer(ctx, &s->refs[i]);
     s->f = NULL;
 }
 
-static av_cold int vp9_decode_init(AVCodecContext *ctx)
+static av_cold int init_frames(AVCodecContext *ctx)
 {
     VP9Context *s = ctx->priv_data;
     int i;
 
-    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-    ff_vp9dsp_init(&s->dsp);
-    ff_videodsp_init(&s->vdsp, 8);
-    for (i = 0; i < 10; i++) {
-        s->fb[i] = av_frame_alloc();
-        if (!s->fb[i]) {
+    for (i = 0; i < 2; i++) {
+        s->frames[i].tf.f = av_frame_alloc();
+        if (!s->frames[i].tf.f) {
             av_log(ctx, AV_LOG_ERROR, "Failed to allocate frame buffer %d\n", i);
             return AVERROR(ENOMEM);
         }
     }
+    for (i = 0; i < 8; i++) {
+        s->refs[i].f      = av_frame_alloc();
+        s->next_refs[i].f = av_frame_alloc();
+        if (!s->refs[i].f || !s->next_refs[i].f) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to allocate frame buffer %d\n", i);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    return 0;
+}
+
+static av_cold int vp9_decode_free(AVCodecContext *ctx);
+
+static av_cold int vp9_decode_init(AVCodecContext *ctx)
+{
+    VP9Context *s = ctx->priv_data;
+    int res;
+
+    ctx->internal->allocate_progress = 1;
+    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    ff_vp9dsp_init(&s->dsp);
+    ff_videodsp_init(&s->vdsp, 8);
     s->filter.sharpness = -1;
 
+    if ((res = init_frames(ctx)) < 0) {
+        vp9_decode_free(ctx);
+        return res;
+    }
+
+    return 0;
+}
+
+static av_cold int vp9_decode_init_thread_copy(AVCodecContext *ctx)
+{
+    int res;
+
+    if ((res = init_frames(ctx)) < 0) {
+        vp9_decode_free(ctx);
+        return res;
+    }
+
+    return 0;
+}
+
+static int vp9_decode_update_thread_context(AVCodecContext *dst,
+                                            const AVCodecContext *src)
+{
+    VP9Context *s = dst->priv_data, *ssrc = src->priv_data;
+    int i, res;
+
+    for (i = 0; i < 2; i++) {
+        vp9_unref_frame(dst, &s->frames[i]);
+        if (ssrc->frames[i].tf.f->data[0] &&
+            (res = vp9_ref_frame(dst, &s->frames[i], &ssrc->frames[i])) < 0)
+            return res;
+    }
+    for (i = 0; i < 8; i++) {
+        ff_thread_release_buffer(dst, &s->refs[i]);
+        if (ssrc->next_refs[i].f->data[0] &&
+            (res = ff_thread_ref_frame(&s->refs[i], &ssrc->next_refs[i])) < 0)
+            return res;
+    }
+
+    s->keyframe  = ssrc->keyframe;
+    s->invisible = ssrc->invisible;
+    s->intraonly = ssrc->intraonly;
+    memcpy(&s->prob_ctx, &ssrc->prob_ctx, sizeof(s->prob_ctx));
+    memcpy(&s->lf_delta, &ssrc->lf_delta, sizeof(s->lf_delta));
+    memcpy(&s->segmentation, &ssrc->segmentation, sizeof(s->segmentation));
+    memcpy(&s->filter, &ssrc->filter, sizeof(s->filter));
+
     return 0;
 }
 
@@ -3541,10 +4001,18 @@ static av_cold int vp9_decode_free(AVCodecContext *ctx)
     VP9Context *s = ctx->priv_data;
     int i;
 
-    for (i = 0; i < 10; i++) {
-        if (s->fb[i]->data[0])
-            av_frame_unref(s->fb[i]);
-        av_frame_free(&s->fb[i]);
+    for (i = 0; i < 2; i++) {
+        if (s->frames[i].tf.f)
+            vp9_unref_frame(ctx, &s->frames[i]);
+        av_frame_free(&s->frames[i].tf.f);
+    }
+    for (i = 0; i < 8; i++) {
+        if (s->refs[i].f)
+            ff_thread_release_buffer(ctx, &s->refs[i]);
+        av_frame_free(&s->refs[i].f);
+        if (s->next_refs[i].f)
+            ff_thread_release_buffer(ctx, &s->next_refs[i]);
+        av_frame_free(&s->next_refs[i].f);
     }
     av_freep(&s->above_partition_ctx);
     s->above_skip_ctx = s->above_txfm_ctx = s->above_mode_ctx = NULL;
@@ -3553,9 +4021,19 @@ static av_cold int vp9_decode_free(AVCodecContext *ctx)
     s->above_segpred_ctx = s->above_intra_ctx = s->above_comp_ctx = NULL;
     s->above_ref_ctx = s->above_filter_ctx = NULL;
     s->above_mv_ctx = NULL;
-    s->segmentation_map = NULL;
-    s->mv[0] = s->mv[1] = NULL;
     s->lflvl = NULL;
+    av_buffer_pool_uninit(&s->segmentation_map_pool);
+    av_buffer_pool_uninit(&s->mv_pool);
+    av_freep(&s->b_base);
+    av_freep(&s->block_base);
+    s->block_alloc_sbs = 0;
+    for (i = 0; i < s->nb_tile_ctx; i++) {
+        av_freep(&s->tile_ctx[i].b_base);
+        av_freep(&s->tile_ctx[i].block_base);
+    }
+    av_freep(&s->tile_ctx);
+    av_freep(&s->tile_res);
+    s->nb_tile_ctx = 0;
     av_freep(&s->c_b);
     s->c_b_size = 0;
 
@@ -3571,6 +4049,9 @@ AVCodec ff_vp9_decoder = {
   .init                  = vp9_decode_init,
   .close                 = vp9_decode_free,
   .decode                = vp9_decode_packet,
-  .capabilities          = CODEC_CAP_DR1,
+  .capabilities          = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS |
+                           CODEC_CAP_SLICE_THREADS,
   .flush                 = vp9_decode_flush,
+  .init_thread_copy      = ONLY_IF_THREADS_ENABLED(vp9_decode_init_thread_copy),
+  .update_thread_context = ONLY_IF_THREADS_ENABLED(vp9_decode_update_thread_context),
 };
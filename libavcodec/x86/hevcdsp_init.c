@@ -0,0 +1,2821 @@
+/*
+ * HEVC DSP functions, SSE2 optimized
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/atomic.h"
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/hevc.h"
+#include "libavcodec/hevcdsp.h"
+#include "constants.h"
+
+#if HAVE_SSE2_INLINE
+
+#define W8(c)    { c, c, c, c, c, c, c, c }
+#define P4(a, b) { a, b, a, b, a, b, a, b }
+
+/* Luma interpolation filters, one broadcast row per tap. The zero outer tap
+ * of the quarter-sample filters is dropped so that no pixel outside of
+ * ff_hevc_qpel_extra_before/after is read; qpel_pairs pads it back for
+ * the pmaddwd based vertical pass. */
+DECLARE_ALIGNED(16, static const int16_t, qpel_taps)[3][8][8] = {
+    { W8(-1), W8( 4), W8(-10), W8(58), W8( 17), W8( -5), W8( 1), W8( 0) },
+    { W8(-1), W8( 4), W8(-11), W8(40), W8( 40), W8(-11), W8( 4), W8(-1) },
+    { W8( 1), W8(-5), W8( 17), W8(58), W8(-10), W8(  4), W8(-1), W8( 0) },
+};
+
+DECLARE_ALIGNED(16, static const int16_t, qpel_pairs)[3][4][8] = {
+    { P4(-1,  4), P4(-10, 58), P4( 17, -5), P4( 1,  0) },
+    { P4(-1,  4), P4(-11, 40), P4( 40,-11), P4( 4, -1) },
+    { P4( 1, -5), P4( 17, 58), P4(-10,  4), P4(-1,  0) },
+};
+
+DECLARE_ALIGNED(16, static const int16_t, pw_2)[8]    = W8(2);
+DECLARE_ALIGNED(16, static const int16_t, pw_1023)[8] = W8(1023);
+DECLARE_ALIGNED(16, static const uint8_t, pb_1f)[16] = {
+    0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f,
+    0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f,
+};
+
+/* inverse transform rounding, indexed by the shift of the pass; pq_shift
+ * also serves the first pass of the 10-bit interpolation filters */
+DECLARE_ALIGNED(16, static const int32_t, pd_round)[13][4] = {
+    [ 7] = {   64,   64,   64,   64 },
+    [10] = {  512,  512,  512,  512 },
+    [12] = { 2048, 2048, 2048, 2048 },
+};
+DECLARE_ALIGNED(16, static const uint64_t, pq_shift)[13][2] = {
+    [ 2] = {  2 },
+    [ 7] = {  7 },
+    [10] = { 10 },
+    [12] = { 12 },
+};
+
+/**
+ * Inverse transform coefficients, laid out for the two passes.
+ * cols holds the transposed matrix, so that the pair of factors applied
+ * to rows 2m and 2m+1 for output row i is one dword at cols[i][2m].
+ * rows holds, for each group of (up to) 8 output columns and each pair of
+ * input columns, the interleaved factors in pmaddwd order.
+ */
+typedef struct HEVCTransformTable {
+    DECLARE_ALIGNED(16, int16_t, cols)[32 * 32];
+    DECLARE_ALIGNED(16, int16_t, rows)[32 * 32];
+} HEVCTransformTable;
+
+static HEVCTransformTable idct_tab[4];
+static HEVCTransformTable dst_tab;
+/* NULL, idct_tab while being built, idct_tab + 1 once ready */
+static void *volatile transform_init_state;
+
+static const int8_t dst_matrix[4][4] = {
+    { 29,  55,  74,  84 },
+    { 74,  74,   0, -74 },
+    { 84, -29, -74,  55 },
+    { 55, -84,  74, -29 },
+};
+
+/* MC */
+
+/* dst[0..7] = sum of taps[i] * src[i * step + 0..7] */
+static av_always_inline void filter8_u8(int16_t *dst, const uint8_t *src,
+                                        x86_reg step, const int16_t *taps,
+                                        x86_reg ntaps)
+{
+    __asm__ volatile(
+        "pxor      %%xmm0, %%xmm0       \n\t"
+        "pxor      %%xmm7, %%xmm7       \n\t"
+        "1:                             \n\t"
+        "movq        (%1), %%xmm1       \n\t"
+        "punpcklbw %%xmm7, %%xmm1       \n\t"
+        "pmullw      (%2), %%xmm1       \n\t"
+        "paddw     %%xmm1, %%xmm0       \n\t"
+        "add           %4, %1           \n\t"
+        "add          $16, %2           \n\t"
+        "dec           %3               \n\t"
+        "jnz 1b                         \n\t"
+        "movdqu    %%xmm0, (%0)         \n\t"
+        : "+&r"(dst), "+&r"(src), "+&r"(taps), "+&r"(ntaps)
+        : "r"(step)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm7",) "memory"
+    );
+}
+
+/* dst[0..7] = (sum of pairs[m] * tmp[(2m, 2m+1) * MAX_PB_SIZE + 0..7]) >> 6,
+ * truncated to 16 bits like the C stores */
+static av_always_inline void filter8_s16(int16_t *dst, const int16_t *tmp,
+                                         const int16_t *pairs, x86_reg npairs)
+{
+    __asm__ volatile(
+        "pxor      %%xmm0, %%xmm0       \n\t"
+        "pxor      %%xmm1, %%xmm1       \n\t"
+        "1:                             \n\t"
+        "movdqu      (%1), %%xmm2       \n\t"
+        "movdqu  %c4(%1), %%xmm3        \n\t"
+        "movdqa    %%xmm2, %%xmm4       \n\t"
+        "punpcklwd %%xmm3, %%xmm2       \n\t"
+        "punpckhwd %%xmm3, %%xmm4       \n\t"
+        "pmaddwd     (%2), %%xmm2       \n\t"
+        "pmaddwd     (%2), %%xmm4       \n\t"
+        "paddd     %%xmm2, %%xmm0       \n\t"
+        "paddd     %%xmm4, %%xmm1       \n\t"
+        "add           %5, %1           \n\t"
+        "add          $16, %2           \n\t"
+        "dec           %3               \n\t"
+        "jnz 1b                         \n\t"
+        "psrad         $6, %%xmm0       \n\t"
+        "psrad         $6, %%xmm1       \n\t"
+        "pslld        $16, %%xmm0       \n\t"
+        "pslld        $16, %%xmm1       \n\t"
+        "psrad        $16, %%xmm0       \n\t"
+        "psrad        $16, %%xmm1       \n\t"
+        "packssdw  %%xmm1, %%xmm0       \n\t"
+        "movdqu    %%xmm0, (%0)         \n\t"
+        : "+&r"(dst), "+&r"(tmp), "+&r"(pairs), "+&r"(npairs)
+        : "i"(MAX_PB_SIZE * sizeof(int16_t)),
+          "i"(2 * MAX_PB_SIZE * sizeof(int16_t))
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",) "memory"
+    );
+}
+
+static void filter_u8_rows(int16_t *dst, ptrdiff_t dststride,
+                           const uint8_t *src, ptrdiff_t srcstride,
+                           ptrdiff_t step, int width, int height,
+                           const int16_t (*taps)[8], int ntaps)
+{
+    int x, y, i;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8)
+            filter8_u8(dst + x, src + x, step, taps[0], ntaps);
+        for (; x < width; x++) {
+            int sum = 0;
+            for (i = 0; i < ntaps; i++)
+                sum += taps[i][0] * src[x + i * step];
+            dst[x] = sum;
+        }
+        src += srcstride;
+        dst += dststride;
+    }
+}
+
+static void filter_s16_rows(int16_t *dst, ptrdiff_t dststride,
+                            const int16_t *tmp, int width, int height,
+                            const int16_t (*pairs)[8], int npairs)
+{
+    int x, y, m;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8)
+            filter8_s16(dst + x, tmp + x, pairs[0], npairs);
+        for (; x < width; x++) {
+            int sum = 0;
+            for (m = 0; m < npairs; m++)
+                sum += pairs[m][0] * tmp[x + 2 * m * MAX_PB_SIZE] +
+                       pairs[m][1] * tmp[x + (2 * m + 1) * MAX_PB_SIZE];
+            dst[x] = sum >> 6;
+        }
+        tmp += MAX_PB_SIZE;
+        dst += dststride;
+    }
+}
+
+static void put_hevc_pixels_8_sse2(int16_t *dst, ptrdiff_t dststride,
+                                   uint8_t *src, ptrdiff_t srcstride,
+                                   int width, int height)
+{
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            __asm__ volatile(
+                "movq        (%1), %%xmm0   \n\t"
+                "pxor      %%xmm1, %%xmm1   \n\t"
+                "punpcklbw %%xmm1, %%xmm0   \n\t"
+                "psllw         $6, %%xmm0   \n\t"
+                "movdqu    %%xmm0, (%0)     \n\t"
+                :: "r"(dst + x), "r"(src + x)
+                : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"
+            );
+        }
+        for (; x < width; x++)
+            dst[x] = src[x] << 6;
+        src += srcstride;
+        dst += dststride;
+    }
+}
+
+/* Separable filtering, with the horizontal pass into a temporary
+ * buffer laid out like the C version's. */
+static av_always_inline void mc_hv(int16_t *dst, ptrdiff_t dststride,
+                                   const uint8_t *src, ptrdiff_t srcstride,
+                                   int width, int height,
+                                   const int16_t (*taps_h)[8], int ntaps_h,
+                                   const int16_t (*pairs_v)[8], int ntaps_v,
+                                   int before_h, int before_v)
+{
+    DECLARE_ALIGNED(16, int16_t, tmp)[(MAX_PB_SIZE + 8) * MAX_PB_SIZE];
+    int rows = height + ntaps_v - 1;
+
+    filter_u8_rows(tmp, MAX_PB_SIZE, src - before_v * srcstride - before_h,
+                   srcstride, 1, width, rows, taps_h, ntaps_h);
+    if (ntaps_v & 1)
+        memset(tmp + rows * MAX_PB_SIZE, 0, MAX_PB_SIZE * sizeof(*tmp));
+    filter_s16_rows(dst, dststride, tmp, width, height,
+                    pairs_v, (ntaps_v + 1) >> 1);
+}
+
+#define QPEL_NTAPS(f)  (ff_hevc_qpel_extra[f] + 1)
+#define QPEL_BEFORE(f) ff_hevc_qpel_extra_before[f]
+
+#define PUT_HEVC_QPEL_H(H)                                                      \
+static void put_hevc_qpel_h ## H ## _8_sse2(int16_t *dst, ptrdiff_t dststride,  \
+                                            uint8_t *src, ptrdiff_t srcstride,  \
+                                            int width, int height,              \
+                                            int16_t *mcbuffer)                  \
+{                                                                               \
+    filter_u8_rows(dst, dststride, src - QPEL_BEFORE(H), srcstride, 1,          \
+                   width, height, qpel_taps[H - 1], QPEL_NTAPS(H));             \
+}
+
+#define PUT_HEVC_QPEL_V(V)                                                      \
+static void put_hevc_qpel_v ## V ## _8_sse2(int16_t *dst, ptrdiff_t dststride,  \
+                                            uint8_t *src, ptrdiff_t srcstride,  \
+                                            int width, int height,              \
+                                            int16_t *mcbuffer)                  \
+{                                                                               \
+    filter_u8_rows(dst, dststride, src - QPEL_BEFORE(V) * srcstride,            \
+                   srcstride, srcstride, width, height,                         \
+                   qpel_taps[V - 1], QPEL_NTAPS(V));                            \
+}
+
+#define PUT_HEVC_QPEL_HV(H, V)                                                  \
+static void put_hevc_qpel_h ## H ## v ## V ## _8_sse2(int16_t *dst,             \
+                                                      ptrdiff_t dststride,      \
+                                                      uint8_t *src,             \
+                                                      ptrdiff_t srcstride,      \
+                                                      int width, int height,    \
+                                                      int16_t *mcbuffer)        \
+{                                                                               \
+    mc_hv(dst, dststride, src, srcstride, width, height,                        \
+          qpel_taps[H - 1], QPEL_NTAPS(H), qpel_pairs[V - 1], QPEL_NTAPS(V),    \
+          QPEL_BEFORE(H), QPEL_BEFORE(V));                                      \
+}
+
+static void put_hevc_qpel_pixels_8_sse2(int16_t *dst, ptrdiff_t dststride,
+                                        uint8_t *src, ptrdiff_t srcstride,
+                                        int width, int height,
+                                        int16_t *mcbuffer)
+{
+    put_hevc_pixels_8_sse2(dst, dststride, src, srcstride, width, height);
+}
+
+PUT_HEVC_QPEL_H(1)
+PUT_HEVC_QPEL_H(2)
+PUT_HEVC_QPEL_H(3)
+PUT_HEVC_QPEL_V(1)
+PUT_HEVC_QPEL_V(2)
+PUT_HEVC_QPEL_V(3)
+PUT_HEVC_QPEL_HV(1, 1)
+PUT_HEVC_QPEL_HV(1, 2)
+PUT_HEVC_QPEL_HV(1, 3)
+PUT_HEVC_QPEL_HV(2, 1)
+PUT_HEVC_QPEL_HV(2, 2)
+PUT_HEVC_QPEL_HV(2, 3)
+PUT_HEVC_QPEL_HV(3, 1)
+PUT_HEVC_QPEL_HV(3, 2)
+PUT_HEVC_QPEL_HV(3, 3)
+
+static void epel_taps(int16_t (*taps)[8], int m)
+{
+    const int8_t *filter = ff_hevc_epel_filters[m - 1];
+    int i, j;
+
+    for (i = 0; i < 4; i++)
+        for (j = 0; j < 8; j++)
+            taps[i][j] = filter[i];
+}
+
+static void epel_pairs(int16_t (*pairs)[8], int m)
+{
+    const int8_t *filter = ff_hevc_epel_filters[m - 1];
+    int i, j;
+
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < 8; j += 2) {
+            pairs[i][j]     = filter[2 * i];
+            pairs[i][j + 1] = filter[2 * i + 1];
+        }
+}
+
+static void put_hevc_epel_pixels_8_sse2(int16_t *dst, ptrdiff_t dststride,
+                                        uint8_t *src, ptrdiff_t srcstride,
+                                        int width, int height, int mx, int my,
+                                        int16_t *mcbuffer)
+{
+    put_hevc_pixels_8_sse2(dst, dststride, src, srcstride, width, height);
+}
+
+static void put_hevc_epel_h_8_sse2(int16_t *dst, ptrdiff_t dststride,
+                                   uint8_t *src, ptrdiff_t srcstride,
+                                   int width, int height, int mx, int my,
+                                   int16_t *mcbuffer)
+{
+    DECLARE_ALIGNED(16, int16_t, taps)[4][8];
+
+    epel_taps(taps, mx);
+    filter_u8_rows(dst, dststride, src - EPEL_EXTRA_BEFORE, srcstride, 1,
+                   width, height, taps, 4);
+}
+
+static void put_hevc_epel_v_8_sse2(int16_t *dst, ptrdiff_t dststride,
+                                   uint8_t *src, ptrdiff_t srcstride,
+                                   int width, int height, int mx, int my,
+                                   int16_t *mcbuffer)
+{
+    DECLARE_ALIGNED(16, int16_t, taps)[4][8];
+
+    epel_taps(taps, my);
+    filter_u8_rows(dst, dststride, src - EPEL_EXTRA_BEFORE * srcstride,
+                   srcstride, srcstride, width, height, taps, 4);
+}
+
+static void put_hevc_epel_hv_8_sse2(int16_t *dst, ptrdiff_t dststride,
+                                    uint8_t *src, ptrdiff_t srcstride,
+                                    int width, int height, int mx, int my,
+                                    int16_t *mcbuffer)
+{
+    DECLARE_ALIGNED(16, int16_t, taps)[4][8];
+    DECLARE_ALIGNED(16, int16_t, pairs)[2][8];
+
+    epel_taps(taps, mx);
+    epel_pairs(pairs, my);
+    mc_hv(dst, dststride, src, srcstride, width, height,
+          taps, 4, pairs, 4, EPEL_EXTRA_BEFORE, EPEL_EXTRA_BEFORE);
+}
+
+/* dst[0..7] = (sum of pairs[m] * src[(2m, 2m+1) * step + 0..7]) >> shift
+ * over 16-bit pixels, with 32-bit sums; an odd last tap is paired with zero
+ * rather than reading the pixel after it */
+static av_always_inline void filter8_u16(int16_t *dst, const uint16_t *src,
+                                         x86_reg step, const int16_t *pairs,
+                                         x86_reg npairs, x86_reg odd,
+                                         const uint64_t *shift)
+{
+    __asm__ volatile(
+        "pxor      %%xmm0, %%xmm0       \n\t"
+        "pxor      %%xmm1, %%xmm1       \n\t"
+        "1:                             \n\t"
+        "movdqu      (%0), %%xmm2       \n\t"
+        "movdqu   (%0,%4), %%xmm3       \n\t"
+        "movdqa    %%xmm2, %%xmm4       \n\t"
+        "punpcklwd %%xmm3, %%xmm2       \n\t"
+        "punpckhwd %%xmm3, %%xmm4       \n\t"
+        "pmaddwd     (%1), %%xmm2       \n\t"
+        "pmaddwd     (%1), %%xmm4       \n\t"
+        "paddd     %%xmm2, %%xmm0       \n\t"
+        "paddd     %%xmm4, %%xmm1       \n\t"
+        "lea    (%0,%4,2), %0           \n\t"
+        "add          $16, %1           \n\t"
+        "dec           %2               \n\t"
+        "jnz 1b                         \n\t"
+        "test          %5, %5           \n\t"
+        "jz 2f                          \n\t"
+        "movdqu      (%0), %%xmm2       \n\t"
+        "pxor      %%xmm3, %%xmm3       \n\t"
+        "movdqa    %%xmm2, %%xmm4       \n\t"
+        "punpcklwd %%xmm3, %%xmm2       \n\t"
+        "punpckhwd %%xmm3, %%xmm4       \n\t"
+        "pmaddwd     (%1), %%xmm2       \n\t"
+        "pmaddwd     (%1), %%xmm4       \n\t"
+        "paddd     %%xmm2, %%xmm0       \n\t"
+        "paddd     %%xmm4, %%xmm1       \n\t"
+        "2:                             \n\t"
+        "psrad         %6, %%xmm0       \n\t"
+        "psrad         %6, %%xmm1       \n\t"
+        "packssdw  %%xmm1, %%xmm0       \n\t"
+        "movdqu    %%xmm0, (%3)         \n\t"
+        : "+&r"(src), "+&r"(pairs), "+&r"(npairs)
+        : "r"(dst), "r"(step), "r"(odd), "m"(*shift)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",) "memory"
+    );
+}
+
+static void filter_u16_rows(int16_t *dst, ptrdiff_t dststride,
+                            const uint16_t *src, ptrdiff_t srcstride,
+                            ptrdiff_t step, int width, int height,
+                            const int16_t (*pairs)[8], int ntaps, int shift)
+{
+    int x, y, i;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8)
+            filter8_u16(dst + x, src + x, step * sizeof(*src), pairs[0],
+                        ntaps >> 1, ntaps & 1, pq_shift[shift]);
+        for (; x < width; x++) {
+            int sum = 0;
+            for (i = 0; i < ntaps; i++)
+                sum += pairs[i >> 1][i & 1] * src[x + i * step];
+            dst[x] = sum >> shift;
+        }
+        src += srcstride;
+        dst += dststride;
+    }
+}
+
+static void put_hevc_pixels_10_sse2(int16_t *dst, ptrdiff_t dststride,
+                                    uint8_t *_src, ptrdiff_t srcstride,
+                                    int width, int height)
+{
+    uint16_t *src = (uint16_t *)_src;
+    int x, y;
+
+    srcstride /= sizeof(*src);
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            __asm__ volatile(
+                "movdqu      (%1), %%xmm0   \n\t"
+                "psllw         $4, %%xmm0   \n\t"
+                "movdqu    %%xmm0, (%0)     \n\t"
+                :: "r"(dst + x), "r"(src + x)
+                : XMM_CLOBBERS("%xmm0",) "memory"
+            );
+        }
+        for (; x < width; x++)
+            dst[x] = src[x] << 4;
+        src += srcstride;
+        dst += dststride;
+    }
+}
+
+/* 10-bit pixels need 32-bit sums, so both passes use pmaddwd and the
+ * horizontal one drops the 2 extra bits of precision like the C code. */
+static av_always_inline void mc_hv_10(int16_t *dst, ptrdiff_t dststride,
+                                      const uint16_t *src, ptrdiff_t srcstride,
+                                      int width, int height,
+                                      const int16_t (*pairs_h)[8], int ntaps_h,
+                                      const int16_t (*pairs_v)[8], int ntaps_v,
+                                      int before_h, int before_v)
+{
+    DECLARE_ALIGNED(16, int16_t, tmp)[(MAX_PB_SIZE + 8) * MAX_PB_SIZE];
+    int rows = height + ntaps_v - 1;
+
+    filter_u16_rows(tmp, MAX_PB_SIZE, src - before_v * srcstride - before_h,
+                    srcstride, 1, width, rows, pairs_h, ntaps_h, 2);
+    if (ntaps_v & 1)
+        memset(tmp + rows * MAX_PB_SIZE, 0, MAX_PB_SIZE * sizeof(*tmp));
+    filter_s16_rows(dst, dststride, tmp, width, height,
+                    pairs_v, (ntaps_v + 1) >> 1);
+}
+
+#define PUT_HEVC_QPEL_H_10(H)                                                   \
+static void put_hevc_qpel_h ## H ## _10_sse2(int16_t *dst, ptrdiff_t dststride, \
+                                             uint8_t *src, ptrdiff_t srcstride, \
+                                             int width, int height,             \
+                                             int16_t *mcbuffer)                 \
+{                                                                               \
+    filter_u16_rows(dst, dststride, (uint16_t *)src - QPEL_BEFORE(H),           \
+                    srcstride / 2, 1, width, height,                            \
+                    qpel_pairs[H - 1], QPEL_NTAPS(H), 2);                       \
+}
+
+#define PUT_HEVC_QPEL_V_10(V)                                                   \
+static void put_hevc_qpel_v ## V ## _10_sse2(int16_t *dst, ptrdiff_t dststride, \
+                                             uint8_t *src, ptrdiff_t srcstride, \
+                                             int width, int height,             \
+                                             int16_t *mcbuffer)                 \
+{                                                                               \
+    filter_u16_rows(dst, dststride,                                             \
+                    (uint16_t *)src - QPEL_BEFORE(V) * (srcstride / 2),         \
+                    srcstride / 2, srcstride / 2, width, height,                \
+                    qpel_pairs[V - 1], QPEL_NTAPS(V), 2);                       \
+}
+
+#define PUT_HEVC_QPEL_HV_10(H, V)                                               \
+static void put_hevc_qpel_h ## H ## v ## V ## _10_sse2(int16_t *dst,            \
+                                                       ptrdiff_t dststride,     \
+                                                       uint8_t *src,            \
+                                                       ptrdiff_t srcstride,     \
+                                                       int width, int height,   \
+                                                       int16_t *mcbuffer)       \
+{                                                                               \
+    mc_hv_10(dst, dststride, (uint16_t *)src, srcstride / 2, width, height,     \
+             qpel_pairs[H - 1], QPEL_NTAPS(H), qpel_pairs[V - 1], QPEL_NTAPS(V),\
+             QPEL_BEFORE(H), QPEL_BEFORE(V));                                   \
+}
+
+static void put_hevc_qpel_pixels_10_sse2(int16_t *dst, ptrdiff_t dststride,
+                                         uint8_t *src, ptrdiff_t srcstride,
+                                         int width, int height,
+                                         int16_t *mcbuffer)
+{
+    put_hevc_pixels_10_sse2(dst, dststride, src, srcstride, width, height);
+}
+
+PUT_HEVC_QPEL_H_10(1)
+PUT_HEVC_QPEL_H_10(2)
+PUT_HEVC_QPEL_H_10(3)
+PUT_HEVC_QPEL_V_10(1)
+PUT_HEVC_QPEL_V_10(2)
+PUT_HEVC_QPEL_V_10(3)
+PUT_HEVC_QPEL_HV_10(1, 1)
+PUT_HEVC_QPEL_HV_10(1, 2)
+PUT_HEVC_QPEL_HV_10(1, 3)
+PUT_HEVC_QPEL_HV_10(2, 1)
+PUT_HEVC_QPEL_HV_10(2, 2)
+PUT_HEVC_QPEL_HV_10(2, 3)
+PUT_HEVC_QPEL_HV_10(3, 1)
+PUT_HEVC_QPEL_HV_10(3, 2)
+PUT_HEVC_QPEL_HV_10(3, 3)
+
+static void put_hevc_epel_pixels_10_sse2(int16_t *dst, ptrdiff_t dststride,
+                                         uint8_t *src, ptrdiff_t srcstride,
+                                         int width, int height, int mx, int my,
+                                         int16_t *mcbuffer)
+{
+    put_hevc_pixels_10_sse2(dst, dststride, src, srcstride, width, height);
+}
+
+static void put_hevc_epel_h_10_sse2(int16_t *dst, ptrdiff_t dststride,
+                                    uint8_t *src, ptrdiff_t srcstride,
+                                    int width, int height, int mx, int my,
+                                    int16_t *mcbuffer)
+{
+    DECLARE_ALIGNED(16, int16_t, pairs)[2][8];
+
+    epel_pairs(pairs, mx);
+    filter_u16_rows(dst, dststride, (uint16_t *)src - EPEL_EXTRA_BEFORE,
+                    srcstride / 2, 1, width, height, pairs, 4, 2);
+}
+
+static void put_hevc_epel_v_10_sse2(int16_t *dst, ptrdiff_t dststride,
+                                    uint8_t *src, ptrdiff_t srcstride,
+                                    int width, int height, int mx, int my,
+                                    int16_t *mcbuffer)
+{
+    DECLARE_ALIGNED(16, int16_t, pairs)[2][8];
+
+    epel_pairs(pairs, my);
+    filter_u16_rows(dst, dststride,
+                    (uint16_t *)src - EPEL_EXTRA_BEFORE * (srcstride / 2),
+                    srcstride / 2, srcstride / 2, width, height, pairs, 4, 2);
+}
+
+static void put_hevc_epel_hv_10_sse2(int16_t *dst, ptrdiff_t dststride,
+                                     uint8_t *src, ptrdiff_t srcstride,
+                                     int width, int height, int mx, int my,
+                                     int16_t *mcbuffer)
+{
+    DECLARE_ALIGNED(16, int16_t, pairs_h)[2][8];
+    DECLARE_ALIGNED(16, int16_t, pairs_v)[2][8];
+
+    epel_pairs(pairs_h, mx);
+    epel_pairs(pairs_v, my);
+    mc_hv_10(dst, dststride, (uint16_t *)src, srcstride / 2, width, height,
+             pairs_h, 4, pairs_v, 4, EPEL_EXTRA_BEFORE, EPEL_EXTRA_BEFORE);
+}
+
+/* Prediction */
+
+static void put_unweighted_pred_8_sse2(uint8_t *dst, ptrdiff_t dststride,
+                                       int16_t *src, ptrdiff_t srcstride,
+                                       int width, int height)
+{
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            __asm__ volatile(
+                "movdqu      (%1), %%xmm0   \n\t"
+                "paddsw        %2, %%xmm0   \n\t"
+                "psraw         $6, %%xmm0   \n\t"
+                "packuswb  %%xmm0, %%xmm0   \n\t"
+                "movq      %%xmm0, (%0)     \n\t"
+                :: "r"(dst + x), "r"(src + x), "m"(ff_pw_32)
+                : XMM_CLOBBERS("%xmm0",) "memory"
+            );
+        }
+        for (; x < width; x++)
+            dst[x] = av_clip_uint8((src[x] + 32) >> 6);
+        dst += dststride;
+        src += srcstride;
+    }
+}
+
+static void put_weighted_pred_avg_8_sse2(uint8_t *dst, ptrdiff_t dststride,
+                                         int16_t *src1, int16_t *src2,
+                                         ptrdiff_t srcstride,
+                                         int width, int height)
+{
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            __asm__ volatile(
+                "movdqu      (%1), %%xmm0   \n\t"
+                "movdqu      (%2), %%xmm1   \n\t"
+                "paddsw    %%xmm1, %%xmm0   \n\t"
+                "paddsw        %3, %%xmm0   \n\t"
+                "psraw         $7, %%xmm0   \n\t"
+                "packuswb  %%xmm0, %%xmm0   \n\t"
+                "movq      %%xmm0, (%0)     \n\t"
+                :: "r"(dst + x), "r"(src1 + x), "r"(src2 + x), "m"(ff_pw_64)
+                : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"
+            );
+        }
+        for (; x < width; x++)
+            dst[x] = av_clip_uint8((src1[x] + src2[x] + 64) >> 7);
+        dst  += dststride;
+        src1 += srcstride;
+        src2 += srcstride;
+    }
+}
+
+static void put_unweighted_pred_10_sse2(uint8_t *_dst, ptrdiff_t dststride,
+                                        int16_t *src, ptrdiff_t srcstride,
+                                        int width, int height)
+{
+    uint16_t *dst = (uint16_t *)_dst;
+    int x, y;
+
+    dststride /= sizeof(*dst);
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            __asm__ volatile(
+                "movdqu      (%1), %%xmm0   \n\t"
+                "pxor      %%xmm1, %%xmm1   \n\t"
+                "paddsw        %2, %%xmm0   \n\t"
+                "psraw         $4, %%xmm0   \n\t"
+                "pmaxsw    %%xmm1, %%xmm0   \n\t"
+                "pminsw        %3, %%xmm0   \n\t"
+                "movdqu    %%xmm0, (%0)     \n\t"
+                :: "r"(dst + x), "r"(src + x), "m"(ff_pw_8), "m"(*pw_1023)
+                : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"
+            );
+        }
+        for (; x < width; x++)
+            dst[x] = av_clip_uintp2((src[x] + 8) >> 4, 10);
+        dst += dststride;
+        src += srcstride;
+    }
+}
+
+static void put_weighted_pred_avg_10_sse2(uint8_t *_dst, ptrdiff_t dststride,
+                                          int16_t *src1, int16_t *src2,
+                                          ptrdiff_t srcstride,
+                                          int width, int height)
+{
+    uint16_t *dst = (uint16_t *)_dst;
+    int x, y;
+
+    dststride /= sizeof(*dst);
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            __asm__ volatile(
+                "movdqu      (%1), %%xmm0   \n\t"
+                "movdqu      (%2), %%xmm1   \n\t"
+                "paddsw    %%xmm1, %%xmm0   \n\t"
+                "pxor      %%xmm1, %%xmm1   \n\t"
+                "paddsw        %3, %%xmm0   \n\t"
+                "psraw         $5, %%xmm0   \n\t"
+                "pmaxsw    %%xmm1, %%xmm0   \n\t"
+                "pminsw        %4, %%xmm0   \n\t"
+                "movdqu    %%xmm0, (%0)     \n\t"
+                :: "r"(dst + x), "r"(src1 + x), "r"(src2 + x),
+                   "m"(ff_pw_16), "m"(*pw_1023)
+                : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"
+            );
+        }
+        for (; x < width; x++)
+            dst[x] = av_clip_uintp2((src1[x] + src2[x] + 16) >> 5, 10);
+        dst  += dststride;
+        src1 += srcstride;
+        src2 += srcstride;
+    }
+}
+
+/* Inverse transform */
+
+/* First pass, over the columns of all rows at once:
+ * tmp[i][c] = clip_int16((sum of M[k][i] * src[k][c] + 64) >> 7) */
+static av_always_inline void transform_cols(int16_t *tmp, const int16_t *src,
+                                            const HEVCTransformTable *tab,
+                                            int n)
+{
+    x86_reg stride = n * sizeof(int16_t);
+    int i, c;
+
+    for (i = 0; i < n; i++) {
+        for (c = 0; c < n; c += 8) {
+            const int16_t *s = src + c;
+            const int16_t *p = tab->cols + i * n;
+            int16_t *d       = tmp + i * n + c;
+            x86_reg cnt      = n >> 1;
+
+            if (n == 4) {
+                __asm__ volatile(
+                    "pxor      %%xmm0, %%xmm0       \n\t"
+                    "1:                             \n\t"
+                    "movq        (%1), %%xmm2       \n\t"
+                    "movq    (%1,%4), %%xmm3        \n\t"
+                    "movd        (%2), %%xmm4       \n\t"
+                    "punpcklwd %%xmm3, %%xmm2       \n\t"
+                    "pshufd $0, %%xmm4, %%xmm4      \n\t"
+                    "pmaddwd   %%xmm4, %%xmm2       \n\t"
+                    "paddd     %%xmm2, %%xmm0       \n\t"
+                    "lea   (%1,%4,2), %1            \n\t"
+                    "add           $4, %2           \n\t"
+                    "dec           %3               \n\t"
+                    "jnz 1b                         \n\t"
+                    "paddd         %5, %%xmm0       \n\t"
+                    "psrad         %6, %%xmm0       \n\t"
+                    "packssdw  %%xmm0, %%xmm0       \n\t"
+                    "movq      %%xmm0, (%0)         \n\t"
+                    : "+&r"(d), "+&r"(s), "+&r"(p), "+&r"(cnt)
+                    : "r"(stride), "m"(*pd_round[7]), "m"(*pq_shift[7])
+                    : XMM_CLOBBERS("%xmm0", "%xmm2", "%xmm3", "%xmm4",)
+                      "memory"
+                );
+            } else {
+                __asm__ volatile(
+                    "pxor      %%xmm0, %%xmm0       \n\t"
+                    "pxor      %%xmm1, %%xmm1       \n\t"
+                    "1:                             \n\t"
+                    "movdqu      (%1), %%xmm2       \n\t"
+                    "movdqu  (%1,%4), %%xmm3        \n\t"
+                    "movd        (%2), %%xmm4       \n\t"
+                    "movdqa    %%xmm2, %%xmm5       \n\t"
+                    "punpcklwd %%xmm3, %%xmm2       \n\t"
+                    "punpckhwd %%xmm3, %%xmm5       \n\t"
+                    "pshufd $0, %%xmm4, %%xmm4      \n\t"
+                    "pmaddwd   %%xmm4, %%xmm2       \n\t"
+                    "pmaddwd   %%xmm4, %%xmm5       \n\t"
+                    "paddd     %%xmm2, %%xmm0       \n\t"
+                    "paddd     %%xmm5, %%xmm1       \n\t"
+                    "lea   (%1,%4,2), %1            \n\t"
+                    "add           $4, %2           \n\t"
+                    "dec           %3               \n\t"
+                    "jnz 1b                         \n\t"
+                    "paddd         %5, %%xmm0       \n\t"
+                    "paddd         %5, %%xmm1       \n\t"
+                    "psrad         %6, %%xmm0       \n\t"
+                    "psrad         %6, %%xmm1       \n\t"
+                    "packssdw  %%xmm1, %%xmm0       \n\t"
+                    "movdqu    %%xmm0, (%0)         \n\t"
+                    : "+&r"(d), "+&r"(s), "+&r"(p), "+&r"(cnt)
+                    : "r"(stride), "m"(*pd_round[7]), "m"(*pq_shift[7])
+                    : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                                   "%xmm4", "%xmm5",) "memory"
+                );
+            }
+        }
+    }
+}
+
+/* sums the products of one row of tmp with a group of up to 8 columns of the
+ * matrix, leaving the scaled and clipped residuals in xmm0 */
+#define TRANSFORM_ROW_SUM                                                       \
+    "pxor      %%xmm0, %%xmm0       \n\t"                                       \
+    "pxor      %%xmm1, %%xmm1       \n\t"                                       \
+    "1:                             \n\t"                                       \
+    "movd        (%1), %%xmm2       \n\t"                                       \
+    "pshufd $0, %%xmm2, %%xmm2      \n\t"                                       \
+    "movdqa      (%2), %%xmm3       \n\t"                                       \
+    "pmaddwd   %%xmm2, %%xmm3       \n\t"                                       \
+    "paddd     %%xmm3, %%xmm0       \n\t"                                       \
+    "cmp          $16, %4           \n\t"                                       \
+    "je 2f                          \n\t"                                       \
+    "pmaddwd   16(%2), %%xmm2       \n\t"                                       \
+    "paddd     %%xmm2, %%xmm1       \n\t"                                       \
+    "2:                             \n\t"                                       \
+    "add           $4, %1           \n\t"                                       \
+    "add           %4, %2           \n\t"                                       \
+    "dec           %3               \n\t"                                       \
+    "jnz 1b                         \n\t"                                       \
+    "paddd         %5, %%xmm0       \n\t"                                       \
+    "paddd         %5, %%xmm1       \n\t"                                       \
+    "psrad         %6, %%xmm0       \n\t"                                       \
+    "psrad         %6, %%xmm1       \n\t"                                       \
+    "packssdw  %%xmm1, %%xmm0       \n\t"
+
+#define TRANSFORM_ROW_OPERANDS                                                  \
+    : "+&r"(d), "+&r"(s), "+&r"(p), "+&r"(cnt)                                  \
+    : "r"(pstep), "m"(*pd_round[shift]), "m"(*pq_shift[shift]),                 \
+      "m"(*pw_1023)                                                             \
+    : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",) "memory"
+
+/* Second pass, along each row, added to the prediction:
+ * dst[r][j] = clip_pixel(dst[r][j] + clip_int16((sum of M[k][j] * tmp[r][k] + add) >> shift)) */
+static av_always_inline void transform_rows_add(uint8_t *_dst, ptrdiff_t stride,
+                                                const int16_t *tmp,
+                                                const HEVCTransformTable *tab,
+                                                int n, int bit_depth)
+{
+    const int shift     = 20 - bit_depth;
+    const x86_reg pstep = FFMIN(n, 8) * 2 * sizeof(int16_t);
+    int r, j;
+
+    for (r = 0; r < n; r++) {
+        for (j = 0; j < n; j += 8) {
+            const int16_t *s = tmp + r * n;
+            const int16_t *p = tab->rows + j * n;
+            uint8_t *d       = _dst + (j << (bit_depth > 8));
+            x86_reg cnt      = n >> 1;
+
+            switch ((bit_depth > 8) * 2 + (n > 4)) {
+            case 0:
+                __asm__ volatile(
+                    TRANSFORM_ROW_SUM
+                    "movd        (%0), %%xmm2       \n\t"
+                    "pxor      %%xmm3, %%xmm3       \n\t"
+                    "punpcklbw %%xmm3, %%xmm2       \n\t"
+                    "paddsw    %%xmm2, %%xmm0       \n\t"
+                    "packuswb  %%xmm0, %%xmm0       \n\t"
+                    "movd      %%xmm0, (%0)         \n\t"
+                    TRANSFORM_ROW_OPERANDS
+                );
+                break;
+            case 1:
+                __asm__ volatile(
+                    TRANSFORM_ROW_SUM
+                    "movq        (%0), %%xmm2       \n\t"
+                    "pxor      %%xmm3, %%xmm3       \n\t"
+                    "punpcklbw %%xmm3, %%xmm2       \n\t"
+                    "paddsw    %%xmm2, %%xmm0       \n\t"
+                    "packuswb  %%xmm0, %%xmm0       \n\t"
+                    "movq      %%xmm0, (%0)         \n\t"
+                    TRANSFORM_ROW_OPERANDS
+                );
+                break;
+            case 2:
+                __asm__ volatile(
+                    TRANSFORM_ROW_SUM
+                    "movq        (%0), %%xmm2       \n\t"
+                    "pxor      %%xmm3, %%xmm3       \n\t"
+                    "paddsw    %%xmm2, %%xmm0       \n\t"
+                    "pmaxsw    %%xmm3, %%xmm0       \n\t"
+                    "pminsw        %7, %%xmm0       \n\t"
+                    "movq      %%xmm0, (%0)         \n\t"
+                    TRANSFORM_ROW_OPERANDS
+                );
+                break;
+            case 3:
+                __asm__ volatile(
+                    TRANSFORM_ROW_SUM
+                    "movdqu      (%0), %%xmm2       \n\t"
+                    "pxor      %%xmm3, %%xmm3       \n\t"
+                    "paddsw    %%xmm2, %%xmm0       \n\t"
+                    "pmaxsw    %%xmm3, %%xmm0       \n\t"
+                    "pminsw        %7, %%xmm0       \n\t"
+                    "movdqu    %%xmm0, (%0)         \n\t"
+                    TRANSFORM_ROW_OPERANDS
+                );
+                break;
+            }
+        }
+        _dst += stride;
+    }
+}
+
+#define TRANSFORM_ADD(name, tab, n, depth)                                      \
+static void name ## _ ## depth ## _sse2(uint8_t *dst, int16_t *coeffs,          \
+                                        ptrdiff_t stride)                       \
+{                                                                               \
+    DECLARE_ALIGNED(16, int16_t, tmp)[n * n];                                   \
+                                                                                \
+    transform_cols(tmp, coeffs, tab, n);                                        \
+    transform_rows_add(dst, stride, tmp, tab, n, depth);                        \
+}
+
+TRANSFORM_ADD(transform_4x4_luma_add, &dst_tab,      4,  8)
+TRANSFORM_ADD(transform_4x4_add,      &idct_tab[0],  4,  8)
+TRANSFORM_ADD(transform_8x8_add,      &idct_tab[1],  8,  8)
+TRANSFORM_ADD(transform_16x16_add,    &idct_tab[2], 16,  8)
+TRANSFORM_ADD(transform_32x32_add,    &idct_tab[3], 32,  8)
+TRANSFORM_ADD(transform_4x4_luma_add, &dst_tab,      4, 10)
+TRANSFORM_ADD(transform_4x4_add,      &idct_tab[0],  4, 10)
+TRANSFORM_ADD(transform_8x8_add,      &idct_tab[1],  8, 10)
+TRANSFORM_ADD(transform_16x16_add,    &idct_tab[2], 16, 10)
+TRANSFORM_ADD(transform_32x32_add,    &idct_tab[3], 32, 10)
+
+static av_cold void init_transform_table(HEVCTransformTable *tab,
+                                         const int8_t *m, int mstride,
+                                         int kstep, int n)
+{
+    const int w = FFMIN(n, 8);
+    int i, k, j;
+
+#define M(k, i) m[(k) * kstep * mstride + (i)]
+    for (i = 0; i < n; i++)
+        for (k = 0; k < n; k++)
+            tab->cols[i * n + k] = M(k, i);
+
+    for (j = 0; j < n; j += w)
+        for (k = 0; k < n; k += 2)
+            for (i = 0; i < w; i++) {
+                tab->rows[(j * n + k * w) + 2 * i]     = M(k,     j + i);
+                tab->rows[(j * n + k * w) + 2 * i + 1] = M(k + 1, j + i);
+            }
+#undef M
+}
+
+/* Several decoders may be initialized concurrently, so the tables are built
+ * by the first caller only and the others wait until they are complete. */
+static av_cold void init_transform_tables(void)
+{
+    void *state;
+    int i;
+
+    while ((state = avpriv_atomic_ptr_cas(&transform_init_state, NULL, idct_tab)))
+        if (state == idct_tab + 1)
+            return;
+
+    for (i = 0; i < 4; i++)
+        init_transform_table(&idct_tab[i], &ff_hevc_transform[0][0], 32,
+                             8 >> i, 4 << i);
+    init_transform_table(&dst_tab, &dst_matrix[0][0], 4, 1, 4);
+
+    avpriv_atomic_ptr_cas(&transform_init_state, idct_tab, idct_tab + 1);
+}
+
+/* Loop filter */
+
+static av_always_inline int get_pixel(const uint8_t *p, ptrdiff_t i, int pixel)
+{
+    return pixel > 1 ? ((const uint16_t *)p)[i] : p[i];
+}
+
+static av_always_inline void put_pixel(uint8_t *p, ptrdiff_t i, int v,
+                                      int pixel)
+{
+    if (pixel > 1)
+        ((uint16_t *)p)[i] = v;
+    else
+        p[i] = v;
+}
+
+/* Filters the chroma edge between rows p0 = pix - stride and q0 = pix,
+ * 8 pixels wide, with per-lane tc and p/q masks. */
+static av_always_inline void loop_filter_chroma8(uint8_t *pix, x86_reg stride,
+                                                 const int16_t *tc,
+                                                 const int16_t *mask)
+{
+    __asm__ volatile(
+        "pxor      %%xmm7, %%xmm7       \n\t"
+        "neg           %1               \n\t"
+        "movq    (%0,%1,2), %%xmm0      \n\t" // p1
+        "movq     (%0,%1), %%xmm1       \n\t" // p0
+        "neg           %1               \n\t"
+        "movq        (%0), %%xmm2       \n\t" // q0
+        "movq     (%0,%1), %%xmm3       \n\t" // q1
+        "punpcklbw %%xmm7, %%xmm0       \n\t"
+        "punpcklbw %%xmm7, %%xmm1       \n\t"
+        "punpcklbw %%xmm7, %%xmm2       \n\t"
+        "punpcklbw %%xmm7, %%xmm3       \n\t"
+        "movdqa    %%xmm2, %%xmm4       \n\t"
+        "psubw     %%xmm1, %%xmm4       \n\t"
+        "psllw         $2, %%xmm4       \n\t"
+        "paddw     %%xmm0, %%xmm4       \n\t"
+        "psubw     %%xmm3, %%xmm4       \n\t"
+        "paddw         %4, %%xmm4       \n\t"
+        "psraw         $3, %%xmm4       \n\t"
+        "movdqa      (%2), %%xmm5       \n\t"
+        "pminsw    %%xmm5, %%xmm4       \n\t"
+        "psubw     %%xmm5, %%xmm7       \n\t"
+        "pmaxsw    %%xmm7, %%xmm4       \n\t"
+        "movdqa    %%xmm4, %%xmm5       \n\t"
+        "pand        (%3), %%xmm4       \n\t"
+        "pand      16(%3), %%xmm5       \n\t"
+        "paddw     %%xmm4, %%xmm1       \n\t"
+        "psubw     %%xmm5, %%xmm2       \n\t"
+        "packuswb  %%xmm1, %%xmm1       \n\t"
+        "packuswb  %%xmm2, %%xmm2       \n\t"
+        "neg           %1               \n\t"
+        "movq      %%xmm1, (%0,%1)      \n\t"
+        "neg           %1               \n\t"
+        "movq      %%xmm2, (%0)         \n\t"
+        : "+r"(pix), "+r"(stride)
+        : "r"(tc), "r"(mask), "m"(ff_pw_4)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                       "%xmm5", "%xmm7",) "memory"
+    );
+}
+
+/* Same as loop_filter_chroma8() on 10-bit pixels. */
+static av_always_inline void loop_filter_chroma8_10(uint16_t *pix,
+                                                    x86_reg stride,
+                                                    const int16_t *tc,
+                                                    const int16_t *mask)
+{
+    __asm__ volatile(
+        "pxor      %%xmm7, %%xmm7       \n\t"
+        "neg           %1               \n\t"
+        "movdqu  (%0,%1,2), %%xmm0      \n\t" // p1
+        "movdqu   (%0,%1), %%xmm1       \n\t" // p0
+        "neg           %1               \n\t"
+        "movdqu      (%0), %%xmm2       \n\t" // q0
+        "movdqu   (%0,%1), %%xmm3       \n\t" // q1
+        "movdqa    %%xmm2, %%xmm4       \n\t"
+        "psubw     %%xmm1, %%xmm4       \n\t"
+        "psllw         $2, %%xmm4       \n\t"
+        "paddw     %%xmm0, %%xmm4       \n\t"
+        "psubw     %%xmm3, %%xmm4       \n\t"
+        "paddw         %4, %%xmm4       \n\t"
+        "psraw         $3, %%xmm4       \n\t"
+        "movdqa      (%2), %%xmm5       \n\t"
+        "pminsw    %%xmm5, %%xmm4       \n\t"
+        "psubw     %%xmm5, %%xmm7       \n\t"
+        "pmaxsw    %%xmm7, %%xmm4       \n\t"
+        "movdqa    %%xmm4, %%xmm5       \n\t"
+        "pand        (%3), %%xmm4       \n\t"
+        "pand      16(%3), %%xmm5       \n\t"
+        "paddw     %%xmm4, %%xmm1       \n\t"
+        "psubw     %%xmm5, %%xmm2       \n\t"
+        "pxor      %%xmm7, %%xmm7       \n\t"
+        "pmaxsw    %%xmm7, %%xmm1       \n\t"
+        "pmaxsw    %%xmm7, %%xmm2       \n\t"
+        "pminsw        %5, %%xmm1       \n\t"
+        "pminsw        %5, %%xmm2       \n\t"
+        "neg           %1               \n\t"
+        "movdqu    %%xmm1, (%0,%1)      \n\t"
+        "neg           %1               \n\t"
+        "movdqu    %%xmm2, (%0)         \n\t"
+        : "+r"(pix), "+r"(stride)
+        : "r"(tc), "r"(mask), "m"(ff_pw_4), "m"(*pw_1023)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                       "%xmm5", "%xmm7",) "memory"
+    );
+}
+
+static int loop_filter_chroma_params(int16_t *tc, int16_t (*mask)[8],
+                                     const int *_tc, const uint8_t *no_p,
+                                     const uint8_t *no_q)
+{
+    int i, j, active = 0;
+
+    for (j = 0; j < 2; j++) {
+        int on = _tc[j] > 0;
+        for (i = 4 * j; i < 4 * j + 4; i++) {
+            tc[i]      = on ? _tc[j] : 0;
+            mask[0][i] = on && !no_p[j] ? -1 : 0;
+            mask[1][i] = on && !no_q[j] ? -1 : 0;
+        }
+        active |= on;
+    }
+    return active;
+}
+
+static void hevc_h_loop_filter_chroma_8_sse2(uint8_t *pix, ptrdiff_t stride,
+                                             int *_tc, uint8_t *no_p,
+                                             uint8_t *no_q)
+{
+    DECLARE_ALIGNED(16, int16_t, tc)[8];
+    DECLARE_ALIGNED(16, int16_t, mask)[2][8];
+
+    if (loop_filter_chroma_params(tc, mask, _tc, no_p, no_q))
+        loop_filter_chroma8(pix, stride, tc, mask[0]);
+}
+
+static void hevc_v_loop_filter_chroma_8_sse2(uint8_t *pix, ptrdiff_t stride,
+                                             int *_tc, uint8_t *no_p,
+                                             uint8_t *no_q)
+{
+    DECLARE_ALIGNED(16, int16_t, tc)[8];
+    DECLARE_ALIGNED(16, int16_t, mask)[2][8];
+    DECLARE_ALIGNED(8, uint8_t, buf)[4][8];
+    int i, k;
+
+    if (!loop_filter_chroma_params(tc, mask, _tc, no_p, no_q))
+        return;
+
+    for (i = 0; i < 8; i++)
+        for (k = 0; k < 4; k++)
+            buf[k][i] = pix[i * stride + k - 2];
+    loop_filter_chroma8(buf[2], 8, tc, mask[0]);
+    for (i = 0; i < 8; i++) {
+        if (mask[0][i])
+            pix[i * stride - 1] = buf[1][i];
+        if (mask[1][i])
+            pix[i * stride]     = buf[2][i];
+    }
+}
+
+static void hevc_h_loop_filter_chroma_10_sse2(uint8_t *pix, ptrdiff_t stride,
+                                              int *_tc, uint8_t *no_p,
+                                              uint8_t *no_q)
+{
+    DECLARE_ALIGNED(16, int16_t, tc)[8];
+    DECLARE_ALIGNED(16, int16_t, mask)[2][8];
+
+    if (loop_filter_chroma_params(tc, mask, _tc, no_p, no_q)) {
+        int i;
+        for (i = 0; i < 8; i++)
+            tc[i] <<= 2;
+        loop_filter_chroma8_10((uint16_t *)pix, stride, tc, mask[0]);
+    }
+}
+
+static void hevc_v_loop_filter_chroma_10_sse2(uint8_t *_pix, ptrdiff_t stride,
+                                              int *_tc, uint8_t *no_p,
+                                              uint8_t *no_q)
+{
+    DECLARE_ALIGNED(16, int16_t, tc)[8];
+    DECLARE_ALIGNED(16, int16_t, mask)[2][8];
+    DECLARE_ALIGNED(16, uint16_t, buf)[4][8];
+    uint16_t *pix = (uint16_t *)_pix;
+    int i, k;
+
+    if (!loop_filter_chroma_params(tc, mask, _tc, no_p, no_q))
+        return;
+
+    stride /= sizeof(*pix);
+    for (i = 0; i < 8; i++) {
+        tc[i] <<= 2;
+        for (k = 0; k < 4; k++)
+            buf[k][i] = pix[i * stride + k - 2];
+    }
+    loop_filter_chroma8_10(buf[2], 16, tc, mask[0]);
+    for (i = 0; i < 8; i++) {
+        if (mask[0][i])
+            pix[i * stride - 1] = buf[1][i];
+        if (mask[1][i])
+            pix[i * stride]     = buf[2][i];
+    }
+}
+
+/* The luma filter works on 8 lines of 8 lanes of words, p3 to q3 across
+ * the edge, each lane being one position along it. The per-segment
+ * decisions are made in C as they only look at 2 of the 4 lanes; the
+ * filters then run on all lanes with the results masked in.
+ * Parameter rows: tc, 2 * tc, tc >> 1, 10 * tc, pixel max, then the lane
+ * masks for strong p/q, normal p0/q0 and normal p1/q1 filtering. */
+#define LF_NB_PARAMS 11
+
+/* sets the 4 lanes of segment j */
+#define LF_SET_PARAM(k, v) \
+    AV_WN64A(&par[k][4 * j], (uint16_t)(v) * 0x0001000100010001ULL)
+
+static av_always_inline int loop_filter_luma_params(int16_t (*par)[8],
+                                                    int16_t (*l)[8],
+                                                    const int *_beta,
+                                                    const int *_tc,
+                                                    const uint8_t *no_p,
+                                                    const uint8_t *no_q,
+                                                    int bit_depth)
+{
+    int j, modes = 0;
+
+    for (j = 0; j < 2; j++) {
+        const int a    = 4 * j, b = 4 * j + 3;
+        const int dp0  = FFABS(l[1][a] - 2 * l[2][a] + l[3][a]);
+        const int dq0  = FFABS(l[6][a] - 2 * l[5][a] + l[4][a]);
+        const int dp3  = FFABS(l[1][b] - 2 * l[2][b] + l[3][b]);
+        const int dq3  = FFABS(l[6][b] - 2 * l[5][b] + l[4][b]);
+        const int d0   = dp0 + dq0;
+        const int d3   = dp3 + dq3;
+        const int beta = _beta[j] << (bit_depth - 8);
+        const int tc   = _tc[j]   << (bit_depth - 8);
+        int strong = 0, normal = 0, nd_p = 0, nd_q = 0;
+
+        if (d0 + d3 < beta) {
+            const int beta_3 = beta >> 3;
+            const int beta_2 = beta >> 2;
+            const int tc25   = (tc * 5 + 1) >> 1;
+
+            strong = FFABS(l[0][a] - l[3][a]) + FFABS(l[7][a] - l[4][a]) < beta_3 &&
+                     FFABS(l[3][a] - l[4][a]) < tc25 &&
+                     FFABS(l[0][b] - l[3][b]) + FFABS(l[7][b] - l[4][b]) < beta_3 &&
+                     FFABS(l[3][b] - l[4][b]) < tc25 &&
+                     (d0 << 1) < beta_2 && (d3 << 1) < beta_2;
+            normal = !strong;
+            nd_p   = dp0 + dp3 < ((beta + (beta >> 1)) >> 3);
+            nd_q   = dq0 + dq3 < ((beta + (beta >> 1)) >> 3);
+        }
+        LF_SET_PARAM( 0, tc);
+        LF_SET_PARAM( 1, tc << 1);
+        LF_SET_PARAM( 2, tc >> 1);
+        LF_SET_PARAM( 3, tc * 10);
+        LF_SET_PARAM( 4, (1 << bit_depth) - 1);
+        LF_SET_PARAM( 5, -(strong && !no_p[j]));
+        LF_SET_PARAM( 6, -(strong && !no_q[j]));
+        LF_SET_PARAM( 7, -(normal && !no_p[j]));
+        LF_SET_PARAM( 8, -(normal && !no_q[j]));
+        LF_SET_PARAM( 9, -(normal && !no_p[j] && nd_p));
+        LF_SET_PARAM(10, -(normal && !no_q[j] && nd_q));
+        modes |= strong | normal << 1;
+    }
+    return modes;
+}
+
+/* new = clip(xmm1, old - 2 * tc, old + 2 * tc), stored to the lanes of
+ * out[line] selected by the mask at par row m */
+#define LF_STRONG_STORE(line, m)                                                \
+    "movdqa  " line "(%1), %%xmm2       \n\t"                                   \
+    "movdqa    %%xmm2, %%xmm3       \n\t"                                       \
+    "psubw     16(%2), %%xmm2       \n\t"                                       \
+    "paddw     16(%2), %%xmm3       \n\t"                                       \
+    "pmaxsw    %%xmm2, %%xmm1       \n\t"                                       \
+    "pminsw    %%xmm3, %%xmm1       \n\t"                                       \
+    "movdqa  " line "(%0), %%xmm2       \n\t"                                   \
+    "pxor      %%xmm2, %%xmm1       \n\t"                                       \
+    "pand    " m "(%2), %%xmm1       \n\t"                                      \
+    "pxor      %%xmm2, %%xmm1       \n\t"                                       \
+    "movdqa    %%xmm1, " line "(%0)     \n\t"
+
+static av_always_inline void loop_filter_luma_strong(int16_t (*out)[8],
+                                                     int16_t (*l)[8],
+                                                     int16_t (*par)[8])
+{
+    __asm__ volatile(
+        "movdqa    32(%1), %%xmm0       \n\t" // p1 + p0 + q0
+        "paddw     48(%1), %%xmm0       \n\t"
+        "paddw     64(%1), %%xmm0       \n\t"
+        "movdqa    16(%1), %%xmm1       \n\t" // p1: p2 + p1 + p0 + q0 + 2 >> 2
+        "paddw     %%xmm0, %%xmm1       \n\t"
+        "paddw         %3, %%xmm1       \n\t"
+        "psrlw         $2, %%xmm1       \n\t"
+        LF_STRONG_STORE("32", "80")
+        "movdqa    %%xmm0, %%xmm1       \n\t" // p0: p2 + 2 * (p1 + p0 + q0) + q1 + 4 >> 3
+        "paddw     %%xmm1, %%xmm1       \n\t"
+        "paddw     16(%1), %%xmm1       \n\t"
+        "paddw     80(%1), %%xmm1       \n\t"
+        "paddw         %4, %%xmm1       \n\t"
+        "psrlw         $3, %%xmm1       \n\t"
+        LF_STRONG_STORE("48", "80")
+        "movdqa      (%1), %%xmm1       \n\t" // p2: 2 * p3 + 3 * p2 + p1 + p0 + q0 + 4 >> 3
+        "paddw     %%xmm1, %%xmm1       \n\t"
+        "movdqa    16(%1), %%xmm2       \n\t"
+        "paddw     %%xmm2, %%xmm1       \n\t"
+        "paddw     %%xmm2, %%xmm1       \n\t"
+        "paddw     %%xmm2, %%xmm1       \n\t"
+        "paddw     %%xmm0, %%xmm1       \n\t"
+        "paddw         %4, %%xmm1       \n\t"
+        "psrlw         $3, %%xmm1       \n\t"
+        LF_STRONG_STORE("16", "80")
+        "movdqa    48(%1), %%xmm0       \n\t" // p0 + q0 + q1
+        "paddw     64(%1), %%xmm0       \n\t"
+        "paddw     80(%1), %%xmm0       \n\t"
+        "movdqa    96(%1), %%xmm1       \n\t" // q1: p0 + q0 + q1 + q2 + 2 >> 2
+        "paddw     %%xmm0, %%xmm1       \n\t"
+        "paddw         %3, %%xmm1       \n\t"
+        "psrlw         $2, %%xmm1       \n\t"
+        LF_STRONG_STORE("80", "96")
+        "movdqa    %%xmm0, %%xmm1       \n\t" // q0: p1 + 2 * (p0 + q0 + q1) + q2 + 4 >> 3
+        "paddw     %%xmm1, %%xmm1       \n\t"
+        "paddw     32(%1), %%xmm1       \n\t"
+        "paddw     96(%1), %%xmm1       \n\t"
+        "paddw         %4, %%xmm1       \n\t"
+        "psrlw         $3, %%xmm1       \n\t"
+        LF_STRONG_STORE("64", "96")
+        "movdqa   112(%1), %%xmm1       \n\t" // q2: 2 * q3 + 3 * q2 + q1 + q0 + p0 + 4 >> 3
+        "paddw     %%xmm1, %%xmm1       \n\t"
+        "movdqa    96(%1), %%xmm2       \n\t"
+        "paddw     %%xmm2, %%xmm1       \n\t"
+        "paddw     %%xmm2, %%xmm1       \n\t"
+        "paddw     %%xmm2, %%xmm1       \n\t"
+        "paddw     %%xmm0, %%xmm1       \n\t"
+        "paddw         %4, %%xmm1       \n\t"
+        "psrlw         $3, %%xmm1       \n\t"
+        LF_STRONG_STORE("96", "96")
+        :: "r"(out), "r"(l), "r"(par), "m"(*pw_2), "m"(ff_pw_4)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",) "memory"
+    );
+}
+
+/* xmm2 = clip(xmm2, 0, max), stored to the lanes of out[line] selected by
+ * the mask at par row m and the |delta0| < 10 * tc mask in xmm7 */
+#define LF_NORMAL_STORE(line, m)                                                \
+    "pxor      %%xmm3, %%xmm3       \n\t"                                       \
+    "pmaxsw    %%xmm3, %%xmm2       \n\t"                                       \
+    "pminsw    64(%2), %%xmm2       \n\t"                                       \
+    "movdqa  " line "(%0), %%xmm3       \n\t"                                   \
+    "movdqa  " m "(%2), %%xmm4       \n\t"                                      \
+    "pand      %%xmm7, %%xmm4       \n\t"                                       \
+    "pxor      %%xmm3, %%xmm2       \n\t"                                       \
+    "pand      %%xmm4, %%xmm2       \n\t"                                       \
+    "pxor      %%xmm3, %%xmm2       \n\t"                                       \
+    "movdqa    %%xmm2, " line "(%0)     \n\t"
+
+static av_always_inline void loop_filter_luma_normal(int16_t (*out)[8],
+                                                     int16_t (*l)[8],
+                                                     int16_t (*par)[8])
+{
+    __asm__ volatile(
+        "movdqa    64(%1), %%xmm0       \n\t" // delta0 = 9 * (q0 - p0) - 3 * (q1 - p1) + 8 >> 4
+        "psubw     48(%1), %%xmm0       \n\t"
+        "movdqa    %%xmm0, %%xmm1       \n\t"
+        "psllw         $3, %%xmm1       \n\t"
+        "paddw     %%xmm0, %%xmm1       \n\t"
+        "movdqa    80(%1), %%xmm0       \n\t"
+        "psubw     32(%1), %%xmm0       \n\t"
+        "psubw     %%xmm0, %%xmm1       \n\t"
+        "psubw     %%xmm0, %%xmm1       \n\t"
+        "psubw     %%xmm0, %%xmm1       \n\t"
+        "paddw         %3, %%xmm1       \n\t"
+        "psraw         $4, %%xmm1       \n\t"
+        "pxor      %%xmm6, %%xmm6       \n\t" // xmm7 = |delta0| < 10 * tc
+        "psubw     %%xmm1, %%xmm6       \n\t"
+        "pmaxsw    %%xmm1, %%xmm6       \n\t"
+        "movdqa    48(%2), %%xmm7       \n\t"
+        "pcmpgtw   %%xmm6, %%xmm7       \n\t"
+        "pxor      %%xmm6, %%xmm6       \n\t" // delta0 = clip(delta0, -tc, tc)
+        "psubw       (%2), %%xmm6       \n\t"
+        "pminsw      (%2), %%xmm1       \n\t"
+        "pmaxsw    %%xmm6, %%xmm1       \n\t"
+        "movdqa    48(%1), %%xmm2       \n\t" // p0 + delta0
+        "paddw     %%xmm1, %%xmm2       \n\t"
+        LF_NORMAL_STORE("48", "112")
+        "movdqa    64(%1), %%xmm2       \n\t" // q0 - delta0
+        "psubw     %%xmm1, %%xmm2       \n\t"
+        LF_NORMAL_STORE("64", "128")
+        "pxor      %%xmm6, %%xmm6       \n\t" // -(tc >> 1)
+        "psubw     32(%2), %%xmm6       \n\t"
+        "movdqa    16(%1), %%xmm2       \n\t" // p1 + clip((p2 + p0 + 1 >> 1) - p1 + delta0 >> 1)
+        "pavgw     48(%1), %%xmm2       \n\t"
+        "psubw     32(%1), %%xmm2       \n\t"
+        "paddw     %%xmm1, %%xmm2       \n\t"
+        "psraw         $1, %%xmm2       \n\t"
+        "pminsw    32(%2), %%xmm2       \n\t"
+        "pmaxsw    %%xmm6, %%xmm2       \n\t"
+        "paddw     32(%1), %%xmm2       \n\t"
+        LF_NORMAL_STORE("32", "144")
+        "movdqa    96(%1), %%xmm2       \n\t" // q1 + clip((q2 + q0 + 1 >> 1) - q1 - delta0 >> 1)
+        "pavgw     64(%1), %%xmm2       \n\t"
+        "psubw     80(%1), %%xmm2       \n\t"
+        "psubw     %%xmm1, %%xmm2       \n\t"
+        "psraw         $1, %%xmm2       \n\t"
+        "pminsw    32(%2), %%xmm2       \n\t"
+        "pmaxsw    %%xmm6, %%xmm2       \n\t"
+        "paddw     80(%1), %%xmm2       \n\t"
+        LF_NORMAL_STORE("80", "160")
+        :: "r"(out), "r"(l), "r"(par), "m"(ff_pw_8)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                       "%xmm6", "%xmm7",) "memory"
+    );
+}
+
+/* Whether the edge is left alone in both segments; this is checked on the
+ * picture itself as it is the common case. xstride crosses the edge and
+ * both strides are in pixels. */
+static av_always_inline int loop_filter_luma_skip(const uint8_t *pix,
+                                                  ptrdiff_t xstride,
+                                                  ptrdiff_t ystride,
+                                                  const int *beta,
+                                                  int bit_depth)
+{
+    const int pixel = bit_depth > 8 ? 2 : 1;
+    int j, k;
+
+    for (j = 0; j < 2; j++) {
+        int d = 0;
+
+        for (k = 0; k < 4; k += 3) {
+            const uint8_t *p = pix + (4 * j + k) * ystride * pixel;
+            d += FFABS(get_pixel(p, -3 * xstride, pixel) -
+                       2 * get_pixel(p, -2 * xstride, pixel) +
+                       get_pixel(p, -xstride, pixel)) +
+                 FFABS(get_pixel(p, 2 * xstride, pixel) -
+                       2 * get_pixel(p, xstride, pixel) +
+                       get_pixel(p, 0, pixel));
+        }
+        if (d < beta[j] << (bit_depth - 8))
+            return 0;
+    }
+    return 1;
+}
+
+/* Filters l into out; returns 0 if nothing was to be filtered, in which
+ * case out is left unset. */
+static av_always_inline int loop_filter_luma(int16_t (*out)[8],
+                                             int16_t (*l)[8],
+                                             const int *beta, const int *tc,
+                                             const uint8_t *no_p,
+                                             const uint8_t *no_q,
+                                             int bit_depth)
+{
+    DECLARE_ALIGNED(16, int16_t, par)[LF_NB_PARAMS][8];
+    int modes = loop_filter_luma_params(par, l, beta, tc, no_p, no_q,
+                                        bit_depth);
+
+    if (!modes)
+        return 0;
+    memcpy(out, l, 8 * sizeof(*l));
+    if (modes & 1)
+        loop_filter_luma_strong(out, l, par);
+    if (modes & 2)
+        loop_filter_luma_normal(out, l, par);
+    return 1;
+}
+
+/* l[0..n-1][0..7] = src[(0..n-1) * stride + 0..7] */
+static av_always_inline void load_u8_rows(int16_t (*l)[8], const uint8_t *src,
+                                          x86_reg stride, x86_reg n)
+{
+    __asm__ volatile(
+        "pxor      %%xmm7, %%xmm7       \n\t"
+        "1:                             \n\t"
+        "movq        (%1), %%xmm0       \n\t"
+        "punpcklbw %%xmm7, %%xmm0       \n\t"
+        "movdqa    %%xmm0, (%0)         \n\t"
+        "add          $16, %0           \n\t"
+        "add           %3, %1           \n\t"
+        "dec           %2               \n\t"
+        "jnz 1b                         \n\t"
+        : "+&r"(l), "+&r"(src), "+&r"(n)
+        : "r"(stride)
+        : XMM_CLOBBERS("%xmm0", "%xmm7",) "memory"
+    );
+}
+
+/* dst[(0..n-1) * stride + 0..7] = l[0..n-1][0..7], which are in range */
+static av_always_inline void store_u8_rows(uint8_t *dst, x86_reg stride,
+                                           const int16_t (*l)[8], x86_reg n)
+{
+    __asm__ volatile(
+        "1:                             \n\t"
+        "movdqa      (%1), %%xmm0       \n\t"
+        "packuswb  %%xmm0, %%xmm0       \n\t"
+        "movq      %%xmm0, (%0)         \n\t"
+        "add          $16, %1           \n\t"
+        "add           %3, %0           \n\t"
+        "dec           %2               \n\t"
+        "jnz 1b                         \n\t"
+        : "+&r"(dst), "+&r"(l), "+&r"(n)
+        : "r"(stride)
+        : XMM_CLOBBERS("%xmm0",) "memory"
+    );
+}
+
+#define TRANSPOSE_4ROWS                                                         \
+    "movdqu      (%1), %%xmm0       \n\t"                                       \
+    "add           %3, %1           \n\t"                                       \
+    "movdqu      (%1), %%xmm1       \n\t"                                       \
+    "add           %3, %1           \n\t"                                       \
+    "movdqu      (%1), %%xmm2       \n\t"                                       \
+    "add           %3, %1           \n\t"                                       \
+    "movdqu      (%1), %%xmm3       \n\t"                                       \
+    "add           %3, %1           \n\t"                                       \
+    "movdqa    %%xmm0, %%xmm4       \n\t"                                       \
+    "punpcklwd %%xmm1, %%xmm0       \n\t"                                       \
+    "punpckhwd %%xmm1, %%xmm4       \n\t"                                       \
+    "movdqa    %%xmm2, %%xmm5       \n\t"                                       \
+    "punpcklwd %%xmm3, %%xmm2       \n\t"                                       \
+    "punpckhwd %%xmm3, %%xmm5       \n\t"                                       \
+    "movdqa    %%xmm0, %%xmm1       \n\t"                                       \
+    "punpckldq %%xmm2, %%xmm0       \n\t"                                       \
+    "punpckhdq %%xmm2, %%xmm1       \n\t"                                       \
+    "movdqa    %%xmm4, %%xmm3       \n\t"                                       \
+    "punpckldq %%xmm5, %%xmm4       \n\t"                                       \
+    "punpckhdq %%xmm5, %%xmm3       \n\t"
+
+#define TRANSPOSE_2COLS(tmp, reg)                                               \
+    "movdqa " #tmp "(%4), %%xmm2    \n\t"                                       \
+    "movdqa    %%xmm2, %%xmm5       \n\t"                                       \
+    "punpcklqdq " reg ", %%xmm2     \n\t"                                       \
+    "punpckhqdq " reg ", %%xmm5     \n\t"                                       \
+    "movdqu    %%xmm2, (%0)         \n\t"                                       \
+    "add           %2, %0           \n\t"                                       \
+    "movdqu    %%xmm5, (%0)         \n\t"                                       \
+    "add           %2, %0           \n\t"
+
+/* Transposes the 8x8 block of words at src into dst; the strides are in
+ * bytes. The first half of the rows goes through tmp. */
+static av_always_inline void transpose8x8_16(int16_t *dst, x86_reg dststride,
+                                             const int16_t *src,
+                                             x86_reg srcstride,
+                                             int16_t (*tmp)[8])
+{
+    __asm__ volatile(
+        TRANSPOSE_4ROWS
+        "movdqa    %%xmm0,   (%4)       \n\t"
+        "movdqa    %%xmm1, 16(%4)       \n\t"
+        "movdqa    %%xmm4, 32(%4)       \n\t"
+        "movdqa    %%xmm3, 48(%4)       \n\t"
+        TRANSPOSE_4ROWS
+        TRANSPOSE_2COLS( 0, "%%xmm0")
+        TRANSPOSE_2COLS(16, "%%xmm1")
+        TRANSPOSE_2COLS(32, "%%xmm4")
+        TRANSPOSE_2COLS(48, "%%xmm3")
+        : "+&r"(dst), "+&r"(src)
+        : "r"(dststride), "r"(srcstride), "r"(tmp)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                       "%xmm5",) "memory"
+    );
+}
+
+static void hevc_h_loop_filter_luma_8_sse2(uint8_t *pix, ptrdiff_t stride,
+                                           int *beta, int *tc,
+                                           uint8_t *no_p, uint8_t *no_q)
+{
+    DECLARE_ALIGNED(16, int16_t, l)[8][8];
+    DECLARE_ALIGNED(16, int16_t, out)[8][8];
+
+    if (loop_filter_luma_skip(pix, stride, 1, beta, 8))
+        return;
+    load_u8_rows(l, pix - 4 * stride, stride, 8);
+    if (!loop_filter_luma(out, l, beta, tc, no_p, no_q, 8))
+        return;
+    store_u8_rows(pix - 3 * stride, stride, out + 1, 6);
+}
+
+static void hevc_v_loop_filter_luma_8_sse2(uint8_t *pix, ptrdiff_t stride,
+                                           int *beta, int *tc,
+                                           uint8_t *no_p, uint8_t *no_q)
+{
+    DECLARE_ALIGNED(16, int16_t, l)[8][8];
+    DECLARE_ALIGNED(16, int16_t, out)[8][8];
+    DECLARE_ALIGNED(16, int16_t, rows)[8][8];
+    DECLARE_ALIGNED(16, int16_t, tmp)[4][8];
+
+    if (loop_filter_luma_skip(pix, 1, stride, beta, 8))
+        return;
+    load_u8_rows(rows, pix - 4, stride, 8);
+    transpose8x8_16(l[0], sizeof(l[0]), rows[0], sizeof(rows[0]), tmp);
+    if (!loop_filter_luma(out, l, beta, tc, no_p, no_q, 8))
+        return;
+    /* p3 and q3 are written back unchanged */
+    transpose8x8_16(rows[0], sizeof(rows[0]), out[0], sizeof(out[0]), tmp);
+    store_u8_rows(pix - 4, stride, rows, 8);
+}
+
+static void hevc_h_loop_filter_luma_10_sse2(uint8_t *_pix, ptrdiff_t stride,
+                                            int *beta, int *tc,
+                                            uint8_t *no_p, uint8_t *no_q)
+{
+    DECLARE_ALIGNED(16, int16_t, l)[8][8];
+    DECLARE_ALIGNED(16, int16_t, out)[8][8];
+    uint16_t *pix = (uint16_t *)_pix;
+    int k;
+
+    stride /= sizeof(*pix);
+    if (loop_filter_luma_skip(_pix, stride, 1, beta, 10))
+        return;
+    for (k = 0; k < 8; k++)
+        memcpy(l[k], pix + (k - 4) * stride, sizeof(l[k]));
+    if (!loop_filter_luma(out, l, beta, tc, no_p, no_q, 10))
+        return;
+    for (k = 1; k < 7; k++)
+        memcpy(pix + (k - 4) * stride, out[k], sizeof(out[k]));
+}
+
+static void hevc_v_loop_filter_luma_10_sse2(uint8_t *_pix, ptrdiff_t stride,
+                                            int *beta, int *tc,
+                                            uint8_t *no_p, uint8_t *no_q)
+{
+    DECLARE_ALIGNED(16, int16_t, l)[8][8];
+    DECLARE_ALIGNED(16, int16_t, out)[8][8];
+    DECLARE_ALIGNED(16, int16_t, tmp)[4][8];
+    int16_t *pix = (int16_t *)_pix - 4;
+
+    if (loop_filter_luma_skip(_pix, 1, stride / 2, beta, 10))
+        return;
+    transpose8x8_16(l[0], sizeof(l[0]), pix, stride, tmp);
+    if (!loop_filter_luma(out, l, beta, tc, no_p, no_q, 10))
+        return;
+    /* p3 and q3 are written back unchanged */
+    transpose8x8_16(pix, stride, out[0], sizeof(out[0]), tmp);
+}
+
+/* SAO */
+
+/* The area of the band filter for each class, as in the C version */
+static void sao_band_area(int *init_x, int *init_y, int *width, int *height,
+                          const int *borders, int chroma, int class)
+{
+    *init_x = *init_y = 0;
+    switch (class) {
+    case 0:
+        if (!borders[2])
+            *width -= ((8 >> chroma) + 2);
+        if (!borders[3])
+            *height -= ((4 >> chroma) + 2);
+        break;
+    case 1:
+        *init_y = -(4 >> chroma) - 2;
+        if (!borders[2])
+            *width -= ((8 >> chroma) + 2);
+        *height = (4 >> chroma) + 2;
+        break;
+    case 2:
+        *init_x = -(8 >> chroma) - 2;
+        *width  =  (8 >> chroma) + 2;
+        if (!borders[3])
+            *height -= ((4 >> chroma) + 2);
+        break;
+    case 3:
+        *init_y = -(4 >> chroma) - 2;
+        *init_x = -(8 >> chroma) - 2;
+        *width  =  (8 >> chroma) + 2;
+        *height =  (4 >> chroma) + 2;
+        break;
+    }
+}
+
+static void sao_band_filter_8_sse2(uint8_t *dst, uint8_t *src,
+                                   ptrdiff_t stride, SAOParams *sao,
+                                   int *borders, int width, int height,
+                                   int c_idx, int class)
+{
+    DECLARE_ALIGNED(16, int8_t, bands)[4][16];
+    DECLARE_ALIGNED(16, int8_t, offsets)[4][16];
+    int offset_table[32] = { 0 };
+    int chroma = !!c_idx;
+    int *sao_offset_val = sao->offset_val[c_idx];
+    int sao_left_class  = sao->band_position[c_idx];
+    int init_y, init_x;
+    int k, x, y;
+
+    sao_band_area(&init_x, &init_y, &width, &height, borders, chroma, class);
+    dst = dst + (init_y * stride + init_x);
+    src = src + (init_y * stride + init_x);
+    for (k = 0; k < 4; k++) {
+        offset_table[(k + sao_left_class) & 31] = sao_offset_val[k + 1];
+        memset(bands[k],   (k + sao_left_class) & 31,  16);
+        memset(offsets[k], sao_offset_val[k + 1], 16);
+    }
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 16 <= width; x += 16) {
+            __asm__ volatile(
+                "movdqu      (%1), %%xmm0       \n\t"
+                "movdqa    %%xmm0, %%xmm1       \n\t"
+                "psrlw         $3, %%xmm1       \n\t"
+                "pand          %4, %%xmm1       \n\t"
+                "movdqa    %%xmm1, %%xmm2       \n\t"
+                "movdqa    %%xmm1, %%xmm3       \n\t"
+                "movdqa    %%xmm1, %%xmm4       \n\t"
+                "pcmpeqb     (%2), %%xmm1       \n\t"
+                "pcmpeqb   16(%2), %%xmm2       \n\t"
+                "pcmpeqb   32(%2), %%xmm3       \n\t"
+                "pcmpeqb   48(%2), %%xmm4       \n\t"
+                "pand        (%3), %%xmm1       \n\t"
+                "pand      16(%3), %%xmm2       \n\t"
+                "pand      32(%3), %%xmm3       \n\t"
+                "pand      48(%3), %%xmm4       \n\t"
+                "por       %%xmm2, %%xmm1       \n\t"
+                "por       %%xmm4, %%xmm3       \n\t"
+                "por       %%xmm3, %%xmm1       \n\t"
+                "pxor      %%xmm7, %%xmm7       \n\t"
+                "movdqa    %%xmm0, %%xmm2       \n\t"
+                "punpcklbw %%xmm7, %%xmm0       \n\t"
+                "punpckhbw %%xmm7, %%xmm2       \n\t"
+                "movdqa    %%xmm1, %%xmm3       \n\t"
+                "punpcklbw %%xmm1, %%xmm1       \n\t"
+                "punpckhbw %%xmm3, %%xmm3       \n\t"
+                "psraw         $8, %%xmm1       \n\t"
+                "psraw         $8, %%xmm3       \n\t"
+                "paddw     %%xmm1, %%xmm0       \n\t"
+                "paddw     %%xmm3, %%xmm2       \n\t"
+                "packuswb  %%xmm2, %%xmm0       \n\t"
+                "movdqu    %%xmm0, (%0)         \n\t"
+                :: "r"(dst + x), "r"(src + x), "r"(bands), "r"(offsets),
+                   "m"(*pb_1f)
+                : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                               "%xmm7",) "memory"
+            );
+        }
+        for (; x < width; x++)
+            dst[x] = av_clip_uint8(src[x] + offset_table[src[x] >> 3]);
+        dst += stride;
+        src += stride;
+    }
+}
+
+
+static void sao_band_filter_10_sse2(uint8_t *_dst, uint8_t *_src,
+                                    ptrdiff_t stride, SAOParams *sao,
+                                    int *borders, int width, int height,
+                                    int c_idx, int class)
+{
+    DECLARE_ALIGNED(16, int16_t, bands)[4][8];
+    DECLARE_ALIGNED(16, int16_t, offsets)[4][8];
+    uint16_t *dst = (uint16_t *)_dst;
+    uint16_t *src = (uint16_t *)_src;
+    int offset_table[32] = { 0 };
+    int chroma = !!c_idx;
+    int *sao_offset_val = sao->offset_val[c_idx];
+    int sao_left_class  = sao->band_position[c_idx];
+    int init_y, init_x;
+    int k, x, y;
+
+    sao_band_area(&init_x, &init_y, &width, &height, borders, chroma, class);
+
+    stride /= sizeof(*dst);
+    dst = dst + (init_y * stride + init_x);
+    src = src + (init_y * stride + init_x);
+    for (k = 0; k < 4; k++) {
+        offset_table[(k + sao_left_class) & 31] = sao_offset_val[k + 1];
+        for (x = 0; x < 8; x++) {
+            bands[k][x]   = (k + sao_left_class) & 31;
+            offsets[k][x] = sao_offset_val[k + 1];
+        }
+    }
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            __asm__ volatile(
+                "movdqu      (%1), %%xmm0       \n\t"
+                "movdqa    %%xmm0, %%xmm1       \n\t"
+                "psrlw         $5, %%xmm1       \n\t"
+                "movdqa    %%xmm1, %%xmm2       \n\t"
+                "movdqa    %%xmm1, %%xmm3       \n\t"
+                "movdqa    %%xmm1, %%xmm4       \n\t"
+                "pcmpeqw     (%2), %%xmm1       \n\t"
+                "pcmpeqw   16(%2), %%xmm2       \n\t"
+                "pcmpeqw   32(%2), %%xmm3       \n\t"
+                "pcmpeqw   48(%2), %%xmm4       \n\t"
+                "pand        (%3), %%xmm1       \n\t"
+                "pand      16(%3), %%xmm2       \n\t"
+                "pand      32(%3), %%xmm3       \n\t"
+                "pand      48(%3), %%xmm4       \n\t"
+                "por       %%xmm2, %%xmm1       \n\t"
+                "por       %%xmm4, %%xmm3       \n\t"
+                "por       %%xmm3, %%xmm1       \n\t"
+                "paddw     %%xmm1, %%xmm0       \n\t"
+                "pxor      %%xmm7, %%xmm7       \n\t"
+                "pmaxsw    %%xmm7, %%xmm0       \n\t"
+                "pminsw        %4, %%xmm0       \n\t"
+                "movdqu    %%xmm0, (%0)         \n\t"
+                :: "r"(dst + x), "r"(src + x), "r"(bands), "r"(offsets),
+                   "m"(*pw_1023)
+                : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                               "%xmm7",) "memory"
+            );
+        }
+        for (; x < width; x++)
+            dst[x] = av_clip_uintp2(src[x] + offset_table[src[x] >> 5], 10);
+        dst += stride;
+        src += stride;
+    }
+}
+
+#define SAO_BAND_FILTER(class, depth)                                           \
+static void sao_band_filter_ ## class ## _ ## depth ## _sse2(uint8_t *dst,      \
+                                                             uint8_t *src,      \
+                                                             ptrdiff_t stride,  \
+                                                             SAOParams *sao,    \
+                                                             int *borders,      \
+                                                             int width,         \
+                                                             int height,        \
+                                                             int c_idx)         \
+{                                                                               \
+    sao_band_filter_ ## depth ## _sse2(dst, src, stride, sao, borders,          \
+                                       width, height, c_idx, class);            \
+}
+
+SAO_BAND_FILTER(0,  8)
+SAO_BAND_FILTER(1,  8)
+SAO_BAND_FILTER(2,  8)
+SAO_BAND_FILTER(3,  8)
+SAO_BAND_FILTER(0, 10)
+SAO_BAND_FILTER(1, 10)
+SAO_BAND_FILTER(2, 10)
+SAO_BAND_FILTER(3, 10)
+
+/* The edge offset of each pixel is looked up from the sum of the signs of
+ * its differences to the two neighbours, a and b bytes away. The offsets
+ * are laid out by that sum, -2 to 2. */
+DECLARE_ALIGNED(16, static const int16_t, sao_edge_sums)[5][8] = {
+    W8(-2), W8(-1), W8(0), W8(1), W8(2),
+};
+
+typedef void (*SAOEdgeRowsFunc)(uint8_t *dst, const uint8_t *src,
+                                ptrdiff_t stride, ptrdiff_t a, ptrdiff_t b,
+                                int width, int height,
+                                const int *sao_offset_val);
+
+static const uint8_t sao_edge_idx[] = { 1, 2, 0, 3, 4 };
+
+#define SAO_CMP(a, b) (((a) > (b)) - ((a) < (b)))
+
+/* xmm0 += offset of the sum of sign(xmm0 - xmm1) and sign(xmm0 - xmm2) */
+#define SAO_EDGE_OFFSET                                                         \
+    "movdqa    %%xmm0, %%xmm3       \n\t"                                       \
+    "pcmpgtw   %%xmm1, %%xmm3       \n\t"                                       \
+    "pcmpgtw   %%xmm0, %%xmm1       \n\t"                                       \
+    "psubw     %%xmm3, %%xmm1       \n\t"                                       \
+    "movdqa    %%xmm0, %%xmm3       \n\t"                                       \
+    "pcmpgtw   %%xmm2, %%xmm3       \n\t"                                       \
+    "pcmpgtw   %%xmm0, %%xmm2       \n\t"                                       \
+    "psubw     %%xmm3, %%xmm2       \n\t"                                       \
+    "paddw     %%xmm2, %%xmm1       \n\t"                                       \
+    "movdqa    %%xmm1, %%xmm5       \n\t"                                       \
+    "pcmpeqw     (%5), %%xmm5       \n\t"                                       \
+    "pand        (%4), %%xmm5       \n\t"                                       \
+    "movdqa    %%xmm1, %%xmm3       \n\t"                                       \
+    "pcmpeqw   16(%5), %%xmm3       \n\t"                                       \
+    "pand      16(%4), %%xmm3       \n\t"                                       \
+    "por       %%xmm3, %%xmm5       \n\t"                                       \
+    "movdqa    %%xmm1, %%xmm3       \n\t"                                       \
+    "pcmpeqw   32(%5), %%xmm3       \n\t"                                       \
+    "pand      32(%4), %%xmm3       \n\t"                                       \
+    "por       %%xmm3, %%xmm5       \n\t"                                       \
+    "movdqa    %%xmm1, %%xmm3       \n\t"                                       \
+    "pcmpeqw   48(%5), %%xmm3       \n\t"                                       \
+    "pand      48(%4), %%xmm3       \n\t"                                       \
+    "por       %%xmm3, %%xmm5       \n\t"                                       \
+    "pcmpeqw   64(%5), %%xmm1       \n\t"                                       \
+    "pand      64(%4), %%xmm1       \n\t"                                       \
+    "por       %%xmm1, %%xmm5       \n\t"                                       \
+    "paddw     %%xmm5, %%xmm0       \n\t"
+
+static void sao_edge_offsets(int16_t (*offsets)[8], const int *sao_offset_val)
+{
+    int k, x;
+
+    for (k = 0; k < 5; k++)
+        for (x = 0; x < 8; x++)
+            offsets[k][x] = sao_offset_val[sao_edge_idx[k]];
+}
+
+static void sao_edge_rows_8_sse2(uint8_t *dst, const uint8_t *src,
+                                 ptrdiff_t stride, ptrdiff_t a, ptrdiff_t b,
+                                 int width, int height,
+                                 const int *sao_offset_val)
+{
+    DECLARE_ALIGNED(16, int16_t, offsets)[5][8];
+    int x, y;
+
+    sao_edge_offsets(offsets, sao_offset_val);
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            __asm__ volatile(
+                "pxor      %%xmm7, %%xmm7       \n\t"
+                "movq        (%1), %%xmm0       \n\t"
+                "movq     (%1,%2), %%xmm1       \n\t"
+                "movq     (%1,%3), %%xmm2       \n\t"
+                "punpcklbw %%xmm7, %%xmm0       \n\t"
+                "punpcklbw %%xmm7, %%xmm1       \n\t"
+                "punpcklbw %%xmm7, %%xmm2       \n\t"
+                SAO_EDGE_OFFSET
+                "packuswb  %%xmm0, %%xmm0       \n\t"
+                "movq      %%xmm0, (%0)         \n\t"
+                :: "r"(dst + x), "r"(src + x), "r"((x86_reg)a),
+                   "r"((x86_reg)b), "r"(offsets), "r"(sao_edge_sums)
+                : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm5",
+                               "%xmm7",) "memory"
+            );
+        }
+        for (; x < width; x++) {
+            int k = 2 + SAO_CMP(src[x], src[x + a]) +
+                        SAO_CMP(src[x], src[x + b]);
+            dst[x] = av_clip_uint8(src[x] + sao_offset_val[sao_edge_idx[k]]);
+        }
+        dst += stride;
+        src += stride;
+    }
+}
+
+static void sao_edge_rows_10_sse2(uint8_t *_dst, const uint8_t *_src,
+                                  ptrdiff_t stride, ptrdiff_t a, ptrdiff_t b,
+                                  int width, int height,
+                                  const int *sao_offset_val)
+{
+    DECLARE_ALIGNED(16, int16_t, offsets)[5][8];
+    uint16_t *dst = (uint16_t *)_dst;
+    const uint16_t *src = (const uint16_t *)_src;
+    int x, y;
+
+    sao_edge_offsets(offsets, sao_offset_val);
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            __asm__ volatile(
+                "movdqu      (%1), %%xmm0       \n\t"
+                "movdqu   (%1,%2), %%xmm1       \n\t"
+                "movdqu   (%1,%3), %%xmm2       \n\t"
+                SAO_EDGE_OFFSET
+                "pxor      %%xmm7, %%xmm7       \n\t"
+                "pmaxsw    %%xmm7, %%xmm0       \n\t"
+                "pminsw        %6, %%xmm0       \n\t"
+                "movdqu    %%xmm0, (%0)         \n\t"
+                :: "r"(dst + x), "r"(src + x), "r"((x86_reg)a),
+                   "r"((x86_reg)b), "r"(offsets), "r"(sao_edge_sums),
+                   "m"(*pw_1023)
+                : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm5",
+                               "%xmm7",) "memory"
+            );
+        }
+        for (; x < width; x++) {
+            int k = 2 + SAO_CMP(src[x], src[x + a / 2]) +
+                        SAO_CMP(src[x], src[x + b / 2]);
+            dst[x] = av_clip_uintp2(src[x] + sao_offset_val[sao_edge_idx[k]], 10);
+        }
+        dst += stride / 2;
+        src += stride / 2;
+    }
+}
+
+/* Edge filter of the classes 0 (the bulk of the CTB) and 1 (the strip above
+ * it), with the border handling of the C version and the inner area
+ * done by rows(). The other classes only cover a few pixels and are left
+ * to C. */
+static av_always_inline void sao_edge_filter(uint8_t *dst, uint8_t *src,
+                                             ptrdiff_t stride, SAOParams *sao,
+                                             int *borders, int width,
+                                             int height, int c_idx,
+                                             uint8_t vert_edge,
+                                             uint8_t horiz_edge,
+                                             uint8_t diag_edge, int class,
+                                             int bit_depth,
+                                             SAOEdgeRowsFunc rows)
+{
+    static const int8_t pos[4][2][2] = {
+        { { -1,  0 }, {  1, 0 } }, // horizontal
+        { {  0, -1 }, {  0, 1 } }, // vertical
+        { { -1, -1 }, {  1, 1 } }, // 45 degree
+        { {  1, -1 }, { -1, 1 } }, // 135 degree
+    };
+    const int pixel = bit_depth > 8 ? 2 : 1;
+    const int max   = (1 << bit_depth) - 1;
+    int chroma = !!c_idx;
+    int *sao_offset_val = sao->offset_val[c_idx];
+    int sao_eo_class    = sao->eo_class[c_idx];
+    int offset_val      = sao_offset_val[0];
+    int init_x = 0, init_y = 0;
+    int x, y, save;
+    ptrdiff_t a, b;
+
+    stride /= pixel;
+    if (!borders[2])
+        width -= (8 >> chroma) + 2;
+    if (class == 1) {
+        dst   -= ((4 >> chroma) + 2) * stride * pixel;
+        src   -= ((4 >> chroma) + 2) * stride * pixel;
+        height = (4 >> chroma) + 2;
+    } else if (!borders[3]) {
+        height -= (4 >> chroma) + 2;
+    }
+
+    if (sao_eo_class != SAO_EO_VERT) {
+        if (borders[0]) {
+            for (y = 0; y < height; y++)
+                put_pixel(dst, y * stride,
+                          av_clip(get_pixel(src, y * stride, pixel) + offset_val,
+                                  0, max), pixel);
+            init_x = 1;
+        }
+        if (borders[2]) {
+            for (y = 0; y < height; y++)
+                put_pixel(dst, y * stride + width - 1,
+                          av_clip(get_pixel(src, y * stride + width - 1, pixel) +
+                                  offset_val, 0, max), pixel);
+            width--;
+        }
+    }
+    if (class == 0 && sao_eo_class != SAO_EO_HORIZ) {
+        if (borders[1]) {
+            for (x = init_x; x < width; x++)
+                put_pixel(dst, x, av_clip(get_pixel(src, x, pixel) + offset_val,
+                                          0, max), pixel);
+            init_y = 1;
+        }
+        if (borders[3]) {
+            ptrdiff_t y_stride = stride * (height - 1);
+            for (x = init_x; x < width; x++)
+                put_pixel(dst, x + y_stride,
+                          av_clip(get_pixel(src, x + y_stride, pixel) +
+                                  offset_val, 0, max), pixel);
+            height--;
+        }
+    }
+
+    a = (pos[sao_eo_class][0][0] + pos[sao_eo_class][0][1] * stride) * pixel;
+    b = (pos[sao_eo_class][1][0] + pos[sao_eo_class][1][1] * stride) * pixel;
+    if (width > init_x && height > init_y)
+        rows(dst + (init_y * stride + init_x) * pixel,
+             src + (init_y * stride + init_x) * pixel, stride * pixel, a, b,
+             width - init_x, height - init_y, sao_offset_val);
+
+    // Restore pixels that can't be modified
+    if (class == 0) {
+        save = !diag_edge && sao_eo_class == SAO_EO_135D &&
+               !borders[0] && !borders[1];
+        if (vert_edge && sao_eo_class != SAO_EO_VERT)
+            for (y = init_y + save; y < height; y++)
+                put_pixel(dst, y * stride, get_pixel(src, y * stride, pixel),
+                          pixel);
+        if (horiz_edge && sao_eo_class != SAO_EO_HORIZ)
+            for (x = init_x + save; x < width; x++)
+                put_pixel(dst, x, get_pixel(src, x, pixel), pixel);
+        if (diag_edge && sao_eo_class == SAO_EO_135D)
+            put_pixel(dst, 0, get_pixel(src, 0, pixel), pixel);
+    } else {
+        ptrdiff_t y_stride = stride * (height - 1);
+        save = !diag_edge && sao_eo_class == SAO_EO_45D && !borders[0];
+        if (vert_edge && sao_eo_class != SAO_EO_VERT)
+            for (y = init_y; y < height - save; y++)
+                put_pixel(dst, y * stride, get_pixel(src, y * stride, pixel),
+                          pixel);
+        if (horiz_edge && sao_eo_class != SAO_EO_HORIZ)
+            for (x = init_x + save; x < width; x++)
+                put_pixel(dst, y_stride + x, get_pixel(src, y_stride + x, pixel),
+                          pixel);
+        if (diag_edge && sao_eo_class == SAO_EO_45D)
+            put_pixel(dst, y_stride, get_pixel(src, y_stride, pixel), pixel);
+    }
+}
+
+#define SAO_EDGE_FILTER(class, depth, opt)                                      \
+static void sao_edge_filter_ ## class ## _ ## depth ## _ ## opt(uint8_t *dst,   \
+                                                    uint8_t *src,               \
+                                                    ptrdiff_t stride,           \
+                                                    SAOParams *sao,             \
+                                                    int *borders, int width,    \
+                                                    int height, int c_idx,      \
+                                                    uint8_t vert_edge,          \
+                                                    uint8_t horiz_edge,         \
+                                                    uint8_t diag_edge)          \
+{                                                                               \
+    sao_edge_filter(dst, src, stride, sao, borders, width, height, c_idx,       \
+                    vert_edge, horiz_edge, diag_edge, class, depth,             \
+                    sao_edge_rows_ ## depth ## _ ## opt);                       \
+}
+
+SAO_EDGE_FILTER(0,  8, sse2)
+SAO_EDGE_FILTER(1,  8, sse2)
+SAO_EDGE_FILTER(0, 10, sse2)
+SAO_EDGE_FILTER(1, 10, sse2)
+
+#if HAVE_SSSE3_INLINE
+
+/* 8-bit interpolation with pmaddubsw on pairs of pixels and taps. The
+ * horizontal filters load the 8 + ntaps - 1 pixels they need with two
+ * overlapping movq, at 0 and ntaps - 1, and shuffle the pairs out of them;
+ * the zero tap of the 7-tap filters gets a zero pixel. */
+#define B8P(a, b) { a, b, a, b, a, b, a, b, a, b, a, b, a, b, a, b }
+
+DECLARE_ALIGNED(16, static const int8_t, qpel_btaps)[3][4][16] = {
+    { B8P(-1,  4), B8P(-10, 58), B8P( 17, -5), B8P( 1,  0) },
+    { B8P(-1,  4), B8P(-11, 40), B8P( 40,-11), B8P( 4, -1) },
+    { B8P( 1, -5), B8P( 17, 58), B8P(-10,  4), B8P(-1,  0) },
+};
+
+#define SHUF(n, j)       ((j) < 8 ? (j) : (j) + 9 - (n))
+#define SHUF_PAIR(n, m, i) SHUF(n, (i) + 2 * (m)),                              \
+                         (2 * (m) + 1 < (n) ? SHUF(n, (i) + 2 * (m) + 1) : 0x80)
+#define SHUF_TAPS(n, m) {                                                       \
+    SHUF_PAIR(n, m, 0), SHUF_PAIR(n, m, 1), SHUF_PAIR(n, m, 2),                 \
+    SHUF_PAIR(n, m, 3), SHUF_PAIR(n, m, 4), SHUF_PAIR(n, m, 5),                 \
+    SHUF_PAIR(n, m, 6), SHUF_PAIR(n, m, 7) }
+
+/* for 4, 7 and 8 taps */
+DECLARE_ALIGNED(16, static const uint8_t, shuf_taps)[3][4][16] = {
+    { SHUF_TAPS(4, 0), SHUF_TAPS(4, 1) },
+    { SHUF_TAPS(7, 0), SHUF_TAPS(7, 1), SHUF_TAPS(7, 2), SHUF_TAPS(7, 3) },
+    { SHUF_TAPS(8, 0), SHUF_TAPS(8, 1), SHUF_TAPS(8, 2), SHUF_TAPS(8, 3) },
+};
+
+DECLARE_ALIGNED(16, static const uint8_t, pb_2)[16] = {
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+};
+DECLARE_ALIGNED(16, static const uint8_t, pb_80)[16] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+static av_always_inline void filter8_u8_h_ssse3(int16_t *dst,
+                                                const uint8_t *src,
+                                                x86_reg hi,
+                                                const uint8_t *shuf,
+                                                const int8_t *taps,
+                                                x86_reg npairs)
+{
+    __asm__ volatile(
+        "movq        (%3), %%xmm0       \n\t"
+        "movq     (%3,%5), %%xmm1       \n\t"
+        "punpcklqdq %%xmm1, %%xmm0      \n\t"
+        "pxor      %%xmm2, %%xmm2       \n\t"
+        "1:                             \n\t"
+        "movdqa    %%xmm0, %%xmm1       \n\t"
+        "pshufb      (%0), %%xmm1       \n\t"
+        "pmaddubsw   (%1), %%xmm1       \n\t"
+        "paddw     %%xmm1, %%xmm2       \n\t"
+        "add          $16, %0           \n\t"
+        "add          $16, %1           \n\t"
+        "dec           %2               \n\t"
+        "jnz 1b                         \n\t"
+        "movdqu    %%xmm2, (%4)         \n\t"
+        : "+&r"(shuf), "+&r"(taps), "+&r"(npairs)
+        : "r"(src), "r"(dst), "r"(hi)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",) "memory"
+    );
+}
+
+static av_always_inline void filter8_u8_v_ssse3(int16_t *dst,
+                                                const uint8_t *src,
+                                                x86_reg stride,
+                                                const int8_t *taps,
+                                                x86_reg npairs, x86_reg odd)
+{
+    __asm__ volatile(
+        "pxor      %%xmm0, %%xmm0       \n\t"
+        "1:                             \n\t"
+        "movq        (%0), %%xmm1       \n\t"
+        "movq     (%0,%5), %%xmm2       \n\t"
+        "punpcklbw %%xmm2, %%xmm1       \n\t"
+        "pmaddubsw   (%1), %%xmm1       \n\t"
+        "paddw     %%xmm1, %%xmm0       \n\t"
+        "lea    (%0,%5,2), %0           \n\t"
+        "add          $16, %1           \n\t"
+        "dec           %2               \n\t"
+        "jnz 1b                         \n\t"
+        "test          %4, %4           \n\t"
+        "jz 2f                          \n\t"
+        "movq        (%0), %%xmm1       \n\t"
+        "pxor      %%xmm2, %%xmm2       \n\t"
+        "punpcklbw %%xmm2, %%xmm1       \n\t"
+        "pmaddubsw   (%1), %%xmm1       \n\t"
+        "paddw     %%xmm1, %%xmm0       \n\t"
+        "2:                             \n\t"
+        "movdqu    %%xmm0, (%3)         \n\t"
+        : "+&r"(src), "+&r"(taps), "+&r"(npairs)
+        : "r"(dst), "r"(odd), "r"(stride)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",) "memory"
+    );
+}
+
+static void mc_h_ssse3(int16_t *dst, ptrdiff_t dststride,
+                       const uint8_t *src, ptrdiff_t srcstride,
+                       int width, int height,
+                       const int8_t (*taps)[16], int ntaps)
+{
+    const uint8_t (*shuf)[16] = shuf_taps[ntaps == 4 ? 0 : ntaps - 6];
+    int x, y, i;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8)
+            filter8_u8_h_ssse3(dst + x, src + x, ntaps - 1, shuf[0], taps[0],
+                               (ntaps + 1) >> 1);
+        for (; x < width; x++) {
+            int sum = 0;
+            for (i = 0; i < ntaps; i++)
+                sum += taps[i >> 1][i & 1] * src[x + i];
+            dst[x] = sum;
+        }
+        src += srcstride;
+        dst += dststride;
+    }
+}
+
+static void mc_v_ssse3(int16_t *dst, ptrdiff_t dststride,
+                       const uint8_t *src, ptrdiff_t srcstride,
+                       int width, int height,
+                       const int8_t (*taps)[16], int ntaps)
+{
+    int x, y, i;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8)
+            filter8_u8_v_ssse3(dst + x, src + x, srcstride, taps[0],
+                               ntaps >> 1, ntaps & 1);
+        for (; x < width; x++) {
+            int sum = 0;
+            for (i = 0; i < ntaps; i++)
+                sum += taps[i >> 1][i & 1] * src[x + i * srcstride];
+            dst[x] = sum;
+        }
+        src += srcstride;
+        dst += dststride;
+    }
+}
+
+typedef void (*FilterS16RowsFunc)(int16_t *dst, ptrdiff_t dststride,
+                                  const int16_t *tmp, int width, int height,
+                                  const int16_t (*pairs)[8], int npairs);
+
+static av_always_inline void mc_hv_ssse3(int16_t *dst, ptrdiff_t dststride,
+                                         const uint8_t *src,
+                                         ptrdiff_t srcstride,
+                                         int width, int height,
+                                         const int8_t (*taps_h)[16],
+                                         int ntaps_h,
+                                         const int16_t (*pairs_v)[8],
+                                         int ntaps_v, int before_h,
+                                         int before_v,
+                                         FilterS16RowsFunc filter_v)
+{
+    DECLARE_ALIGNED(16, int16_t, tmp)[(MAX_PB_SIZE + 8) * MAX_PB_SIZE];
+    int rows = height + ntaps_v - 1;
+
+    mc_h_ssse3(tmp, MAX_PB_SIZE, src - before_v * srcstride - before_h,
+               srcstride, width, rows, taps_h, ntaps_h);
+    if (ntaps_v & 1)
+        memset(tmp + rows * MAX_PB_SIZE, 0, MAX_PB_SIZE * sizeof(*tmp));
+    filter_v(dst, dststride, tmp, width, height, pairs_v, (ntaps_v + 1) >> 1);
+}
+
+static void epel_btaps(int8_t (*taps)[16], int m)
+{
+    const int8_t *filter = ff_hevc_epel_filters[m - 1];
+    int i, j;
+
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < 16; j += 2) {
+            taps[i][j]     = filter[2 * i];
+            taps[i][j + 1] = filter[2 * i + 1];
+        }
+}
+
+/* The vertical pass of the 2D filters is shared with SSE2, unless a wider
+ * version is given. */
+#define PUT_HEVC_MC_8(opt, mc_v, filter_s16)                                    \
+static void put_hevc_qpel_v1_8_ ## opt(int16_t *dst, ptrdiff_t dststride,       \
+                                       uint8_t *src, ptrdiff_t srcstride,       \
+                                       int width, int height,                   \
+                                       int16_t *mcbuffer)                       \
+{                                                                               \
+    mc_v(dst, dststride, src - QPEL_BEFORE(1) * srcstride, srcstride,           \
+         width, height, qpel_btaps[0], QPEL_NTAPS(1));                          \
+}                                                                               \
+                                                                                \
+static void put_hevc_qpel_v2_8_ ## opt(int16_t *dst, ptrdiff_t dststride,       \
+                                       uint8_t *src, ptrdiff_t srcstride,       \
+                                       int width, int height,                   \
+                                       int16_t *mcbuffer)                       \
+{                                                                               \
+    mc_v(dst, dststride, src - QPEL_BEFORE(2) * srcstride, srcstride,           \
+         width, height, qpel_btaps[1], QPEL_NTAPS(2));                          \
+}                                                                               \
+                                                                                \
+static void put_hevc_qpel_v3_8_ ## opt(int16_t *dst, ptrdiff_t dststride,       \
+                                       uint8_t *src, ptrdiff_t srcstride,       \
+                                       int width, int height,                   \
+                                       int16_t *mcbuffer)                       \
+{                                                                               \
+    mc_v(dst, dststride, src - QPEL_BEFORE(3) * srcstride, srcstride,           \
+         width, height, qpel_btaps[2], QPEL_NTAPS(3));                          \
+}                                                                               \
+                                                                                \
+PUT_HEVC_QPEL_HV_8(1, 1, opt, filter_s16)                                       \
+PUT_HEVC_QPEL_HV_8(1, 2, opt, filter_s16)                                       \
+PUT_HEVC_QPEL_HV_8(1, 3, opt, filter_s16)                                       \
+PUT_HEVC_QPEL_HV_8(2, 1, opt, filter_s16)                                       \
+PUT_HEVC_QPEL_HV_8(2, 2, opt, filter_s16)                                       \
+PUT_HEVC_QPEL_HV_8(2, 3, opt, filter_s16)                                       \
+PUT_HEVC_QPEL_HV_8(3, 1, opt, filter_s16)                                       \
+PUT_HEVC_QPEL_HV_8(3, 2, opt, filter_s16)                                       \
+PUT_HEVC_QPEL_HV_8(3, 3, opt, filter_s16)                                       \
+                                                                                \
+static void put_hevc_epel_v_8_ ## opt(int16_t *dst, ptrdiff_t dststride,        \
+                                      uint8_t *src, ptrdiff_t srcstride,        \
+                                      int width, int height, int mx, int my,    \
+                                      int16_t *mcbuffer)                        \
+{                                                                               \
+    DECLARE_ALIGNED(16, int8_t, taps)[2][16];                                   \
+                                                                                \
+    epel_btaps(taps, my);                                                       \
+    mc_v(dst, dststride, src - EPEL_EXTRA_BEFORE * srcstride, srcstride,        \
+         width, height, taps, 4);                                               \
+}                                                                               \
+                                                                                \
+static void put_hevc_epel_hv_8_ ## opt(int16_t *dst, ptrdiff_t dststride,       \
+                                       uint8_t *src, ptrdiff_t srcstride,       \
+                                       int width, int height, int mx, int my,   \
+                                       int16_t *mcbuffer)                       \
+{                                                                               \
+    DECLARE_ALIGNED(16, int8_t, taps)[2][16];                                   \
+    DECLARE_ALIGNED(16, int16_t, pairs)[2][8];                                  \
+                                                                                \
+    epel_btaps(taps, mx);                                                       \
+    epel_pairs(pairs, my);                                                      \
+    mc_hv_ssse3(dst, dststride, src, srcstride, width, height, taps, 4,         \
+                pairs, 4, EPEL_EXTRA_BEFORE, EPEL_EXTRA_BEFORE, filter_s16);    \
+}
+
+#define PUT_HEVC_QPEL_HV_8(H, V, opt, filter_s16)                               \
+static void put_hevc_qpel_h ## H ## v ## V ## _8_ ## opt(int16_t *dst,          \
+                                                         ptrdiff_t dststride,   \
+                                                         uint8_t *src,          \
+                                                         ptrdiff_t srcstride,   \
+                                                         int width, int height, \
+                                                         int16_t *mcbuffer)     \
+{                                                                               \
+    mc_hv_ssse3(dst, dststride, src, srcstride, width, height,                  \
+                qpel_btaps[H - 1], QPEL_NTAPS(H), qpel_pairs[V - 1],            \
+                QPEL_NTAPS(V), QPEL_BEFORE(H), QPEL_BEFORE(V), filter_s16);     \
+}
+
+#define PUT_HEVC_QPEL_H_8(H)                                                    \
+static void put_hevc_qpel_h ## H ## _8_ssse3(int16_t *dst, ptrdiff_t dststride, \
+                                             uint8_t *src, ptrdiff_t srcstride, \
+                                             int width, int height,             \
+                                             int16_t *mcbuffer)                 \
+{                                                                               \
+    mc_h_ssse3(dst, dststride, src - QPEL_BEFORE(H), srcstride, width, height,  \
+               qpel_btaps[H - 1], QPEL_NTAPS(H));                               \
+}
+
+PUT_HEVC_QPEL_H_8(1)
+PUT_HEVC_QPEL_H_8(2)
+PUT_HEVC_QPEL_H_8(3)
+PUT_HEVC_MC_8(ssse3, mc_v_ssse3, filter_s16_rows)
+
+static void put_hevc_epel_h_8_ssse3(int16_t *dst, ptrdiff_t dststride,
+                                    uint8_t *src, ptrdiff_t srcstride,
+                                    int width, int height, int mx, int my,
+                                    int16_t *mcbuffer)
+{
+    DECLARE_ALIGNED(16, int8_t, taps)[2][16];
+
+    epel_btaps(taps, mx);
+    mc_h_ssse3(dst, dststride, src - EPEL_EXTRA_BEFORE, srcstride,
+               width, height, taps, 4);
+}
+
+/* 16 pixels at a time on bytes: the signs come from signed compares of the
+ * pixels biased by 0x80, the offsets from a pshufb lookup, and the signed
+ * saturating add on the biased pixels clips like av_clip_uint8(). 8-bit
+ * edge offsets are within [-7, 7]. */
+static void sao_edge_rows_8_ssse3(uint8_t *dst, const uint8_t *src,
+                                  ptrdiff_t stride, ptrdiff_t a, ptrdiff_t b,
+                                  int width, int height,
+                                  const int *sao_offset_val)
+{
+    DECLARE_ALIGNED(16, int8_t, offsets)[16] = { 0 };
+    int k, x, y;
+
+    for (k = 0; k < 5; k++)
+        offsets[k] = sao_offset_val[sao_edge_idx[k]];
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 16 <= width; x += 16) {
+            __asm__ volatile(
+                "movdqa        %5, %%xmm7       \n\t"
+                "movdqu      (%1), %%xmm0       \n\t"
+                "movdqu   (%1,%2), %%xmm1       \n\t"
+                "movdqu   (%1,%3), %%xmm2       \n\t"
+                "pxor      %%xmm7, %%xmm0       \n\t"
+                "pxor      %%xmm7, %%xmm1       \n\t"
+                "pxor      %%xmm7, %%xmm2       \n\t"
+                "movdqa    %%xmm0, %%xmm3       \n\t"
+                "pcmpgtb   %%xmm1, %%xmm3       \n\t"
+                "pcmpgtb   %%xmm0, %%xmm1       \n\t"
+                "psubb     %%xmm3, %%xmm1       \n\t"
+                "movdqa    %%xmm0, %%xmm3       \n\t"
+                "pcmpgtb   %%xmm2, %%xmm3       \n\t"
+                "pcmpgtb   %%xmm0, %%xmm2       \n\t"
+                "psubb     %%xmm3, %%xmm2       \n\t"
+                "paddb     %%xmm2, %%xmm1       \n\t"
+                "paddb         %6, %%xmm1       \n\t"
+                "movdqa      (%4), %%xmm3       \n\t"
+                "pshufb    %%xmm1, %%xmm3       \n\t"
+                "paddsb    %%xmm3, %%xmm0       \n\t"
+                "pxor      %%xmm7, %%xmm0       \n\t"
+                "movdqu    %%xmm0, (%0)         \n\t"
+                :: "r"(dst + x), "r"(src + x), "r"((x86_reg)a),
+                   "r"((x86_reg)b), "r"(offsets), "m"(*pb_80), "m"(*pb_2)
+                : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                               "%xmm7",) "memory"
+            );
+        }
+        for (; x < width; x++) {
+            int k = 2 + SAO_CMP(src[x], src[x + a]) +
+                        SAO_CMP(src[x], src[x + b]);
+            dst[x] = av_clip_uint8(src[x] + sao_offset_val[sao_edge_idx[k]]);
+        }
+        dst += stride;
+        src += stride;
+    }
+}
+
+SAO_EDGE_FILTER(0, 8, ssse3)
+SAO_EDGE_FILTER(1, 8, ssse3)
+
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+
+/* The AVX2 versions do 16 columns at a time and leave the rest to the
+ * narrower ones, after clearing the upper halves of the ymm registers. */
+
+static av_always_inline void filter16_u8_v_avx2(int16_t *dst,
+                                                const uint8_t *src,
+                                                x86_reg stride,
+                                                const int8_t *taps,
+                                                x86_reg npairs, x86_reg odd)
+{
+    __asm__ volatile(
+        "vpxor         %%ymm0, %%ymm0, %%ymm0   \n\t"
+        "1:                                     \n\t"
+        "vmovdqu          (%0), %%xmm1          \n\t"
+        "vmovdqu       (%0,%5), %%xmm2          \n\t"
+        "vbroadcasti128   (%1), %%ymm3          \n\t"
+        "vpunpckhbw    %%xmm2, %%xmm1, %%xmm4   \n\t"
+        "vpunpcklbw    %%xmm2, %%xmm1, %%xmm1   \n\t"
+        "vinserti128 $1, %%xmm4, %%ymm1, %%ymm1 \n\t"
+        "vpmaddubsw    %%ymm3, %%ymm1, %%ymm1   \n\t"
+        "vpaddw        %%ymm1, %%ymm0, %%ymm0   \n\t"
+        "lea        (%0,%5,2), %0               \n\t"
+        "add              $16, %1               \n\t"
+        "dec               %2                   \n\t"
+        "jnz 1b                                 \n\t"
+        "test              %4, %4               \n\t"
+        "jz 2f                                  \n\t"
+        "vmovdqu          (%0), %%xmm1          \n\t"
+        "vpxor         %%xmm2, %%xmm2, %%xmm2   \n\t"
+        "vbroadcasti128   (%1), %%ymm3          \n\t"
+        "vpunpckhbw    %%xmm2, %%xmm1, %%xmm4   \n\t"
+        "vpunpcklbw    %%xmm2, %%xmm1, %%xmm1   \n\t"
+        "vinserti128 $1, %%xmm4, %%ymm1, %%ymm1 \n\t"
+        "vpmaddubsw    %%ymm3, %%ymm1, %%ymm1   \n\t"
+        "vpaddw        %%ymm1, %%ymm0, %%ymm0   \n\t"
+        "2:                                     \n\t"
+        "vmovdqu       %%ymm0, (%3)             \n\t"
+        : "+&r"(src), "+&r"(taps), "+&r"(npairs)
+        : "r"(dst), "r"(odd), "r"(stride)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",) "memory"
+    );
+}
+
+static void mc_v_avx2(int16_t *dst, ptrdiff_t dststride,
+                      const uint8_t *src, ptrdiff_t srcstride,
+                      int width, int height,
+                      const int8_t (*taps)[16], int ntaps)
+{
+    int w16 = width & ~15;
+    int x, y;
+
+    if (w16) {
+        for (y = 0; y < height; y++)
+            for (x = 0; x < w16; x += 16)
+                filter16_u8_v_avx2(dst + y * dststride + x,
+                                   src + y * srcstride + x, srcstride,
+                                   taps[0], ntaps >> 1, ntaps & 1);
+        __asm__ volatile("vzeroupper");
+    }
+    if (w16 < width)
+        mc_v_ssse3(dst + w16, dststride, src + w16, srcstride,
+                   width - w16, height, taps, ntaps);
+}
+
+/* Same as filter8_s16() for 16 columns; the in-lane unpacks and pack
+ * cancel out, so the results come out in order. */
+static av_always_inline void filter16_s16_avx2(int16_t *dst, const int16_t *tmp,
+                                               const int16_t *pairs,
+                                               x86_reg npairs)
+{
+    __asm__ volatile(
+        "vpxor         %%ymm0, %%ymm0, %%ymm0   \n\t"
+        "vpxor         %%ymm1, %%ymm1, %%ymm1   \n\t"
+        "1:                                     \n\t"
+        "vmovdqu          (%1), %%ymm2          \n\t"
+        "vmovdqu       %c4(%1), %%ymm3          \n\t"
+        "vbroadcasti128   (%2), %%ymm5          \n\t"
+        "vpunpckhwd    %%ymm3, %%ymm2, %%ymm4   \n\t"
+        "vpunpcklwd    %%ymm3, %%ymm2, %%ymm2   \n\t"
+        "vpmaddwd      %%ymm5, %%ymm2, %%ymm2   \n\t"
+        "vpmaddwd      %%ymm5, %%ymm4, %%ymm4   \n\t"
+        "vpaddd        %%ymm2, %%ymm0, %%ymm0   \n\t"
+        "vpaddd        %%ymm4, %%ymm1, %%ymm1   \n\t"
+        "add               %5, %1               \n\t"
+        "add              $16, %2               \n\t"
+        "dec               %3                   \n\t"
+        "jnz 1b                                 \n\t"
+        "vpsrad            $6, %%ymm0, %%ymm0   \n\t"
+        "vpsrad            $6, %%ymm1, %%ymm1   \n\t"
+        "vpslld           $16, %%ymm0, %%ymm0   \n\t"
+        "vpslld           $16, %%ymm1, %%ymm1   \n\t"
+        "vpsrad           $16, %%ymm0, %%ymm0   \n\t"
+        "vpsrad           $16, %%ymm1, %%ymm1   \n\t"
+        "vpackssdw     %%ymm1, %%ymm0, %%ymm0   \n\t"
+        "vmovdqu       %%ymm0, (%0)             \n\t"
+        : "+&r"(dst), "+&r"(tmp), "+&r"(pairs), "+&r"(npairs)
+        : "i"(MAX_PB_SIZE * sizeof(int16_t)),
+          "i"(2 * MAX_PB_SIZE * sizeof(int16_t))
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                       "%xmm5",) "memory"
+    );
+}
+
+static void filter_s16_rows_avx2(int16_t *dst, ptrdiff_t dststride,
+                                 const int16_t *tmp, int width, int height,
+                                 const int16_t (*pairs)[8], int npairs)
+{
+    int w16 = width & ~15;
+    int x, y;
+
+    if (w16) {
+        for (y = 0; y < height; y++)
+            for (x = 0; x < w16; x += 16)
+                filter16_s16_avx2(dst + y * dststride + x,
+                                  tmp + y * MAX_PB_SIZE + x, pairs[0], npairs);
+        __asm__ volatile("vzeroupper");
+    }
+    if (w16 < width)
+        filter_s16_rows(dst + w16, dststride, tmp + w16, width - w16, height,
+                        pairs, npairs);
+}
+
+PUT_HEVC_MC_8(avx2, mc_v_avx2, filter_s16_rows_avx2)
+
+static void put_unweighted_pred_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                                       int16_t *src, ptrdiff_t srcstride,
+                                       int width, int height)
+{
+    int w16 = width & ~15;
+    int x, y;
+
+    if (w16) {
+        for (y = 0; y < height; y++)
+            for (x = 0; x < w16; x += 16) {
+                __asm__ volatile(
+                    "vbroadcasti128    %2, %%ymm1           \n\t"
+                    "vpaddsw         (%1), %%ymm1, %%ymm0   \n\t"
+                    "vpsraw            $6, %%ymm0, %%ymm0   \n\t"
+                    "vextracti128 $1, %%ymm0, %%xmm1        \n\t"
+                    "vpackuswb     %%xmm1, %%xmm0, %%xmm0   \n\t"
+                    "vmovdqu       %%xmm0, (%0)             \n\t"
+                    :: "r"(dst + y * dststride + x),
+                       "r"(src + y * srcstride + x), "m"(ff_pw_32)
+                    : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"
+                );
+            }
+        __asm__ volatile("vzeroupper");
+    }
+    if (w16 < width)
+        put_unweighted_pred_8_sse2(dst + w16, dststride, src + w16, srcstride,
+                                   width - w16, height);
+}
+
+static void put_weighted_pred_avg_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                                         int16_t *src1, int16_t *src2,
+                                         ptrdiff_t srcstride,
+                                         int width, int height)
+{
+    int w16 = width & ~15;
+    int x, y;
+
+    if (w16) {
+        for (y = 0; y < height; y++)
+            for (x = 0; x < w16; x += 16) {
+                __asm__ volatile(
+                    "vbroadcasti128    %3, %%ymm1           \n\t"
+                    "vmovdqu         (%1), %%ymm0           \n\t"
+                    "vpaddsw         (%2), %%ymm0, %%ymm0   \n\t"
+                    "vpaddsw       %%ymm1, %%ymm0, %%ymm0   \n\t"
+                    "vpsraw            $7, %%ymm0, %%ymm0   \n\t"
+                    "vextracti128 $1, %%ymm0, %%xmm1        \n\t"
+                    "vpackuswb     %%xmm1, %%xmm0, %%xmm0   \n\t"
+                    "vmovdqu       %%xmm0, (%0)             \n\t"
+                    :: "r"(dst + y * dststride + x),
+                       "r"(src1 + y * srcstride + x),
+                       "r"(src2 + y * srcstride + x), "m"(ff_pw_64)
+                    : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"
+                );
+            }
+        __asm__ volatile("vzeroupper");
+    }
+    if (w16 < width)
+        put_weighted_pred_avg_8_sse2(dst + w16, dststride, src1 + w16,
+                                     src2 + w16, srcstride,
+                                     width - w16, height);
+}
+
+static void put_unweighted_pred_10_avx2(uint8_t *_dst, ptrdiff_t dststride,
+                                        int16_t *src, ptrdiff_t srcstride,
+                                        int width, int height)
+{
+    uint16_t *dst = (uint16_t *)_dst;
+    int w16 = width & ~15;
+    int x, y;
+
+    if (w16) {
+        for (y = 0; y < height; y++)
+            for (x = 0; x < w16; x += 16) {
+                __asm__ volatile(
+                    "vbroadcasti128    %2, %%ymm1           \n\t"
+                    "vpaddsw         (%1), %%ymm1, %%ymm0   \n\t"
+                    "vpsraw            $4, %%ymm0, %%ymm0   \n\t"
+                    "vpxor         %%ymm1, %%ymm1, %%ymm1   \n\t"
+                    "vpmaxsw       %%ymm1, %%ymm0, %%ymm0   \n\t"
+                    "vbroadcasti128    %3, %%ymm1           \n\t"
+                    "vpminsw       %%ymm1, %%ymm0, %%ymm0   \n\t"
+                    "vmovdqu       %%ymm0, (%0)             \n\t"
+                    :: "r"(dst + y * (dststride / 2) + x),
+                       "r"(src + y * srcstride + x),
+                       "m"(ff_pw_8), "m"(*pw_1023)
+                    : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"
+                );
+            }
+        __asm__ volatile("vzeroupper");
+    }
+    if (w16 < width)
+        put_unweighted_pred_10_sse2((uint8_t *)(dst + w16), dststride,
+                                    src + w16, srcstride, width - w16, height);
+}
+
+static void put_weighted_pred_avg_10_avx2(uint8_t *_dst, ptrdiff_t dststride,
+                                          int16_t *src1, int16_t *src2,
+                                          ptrdiff_t srcstride,
+                                          int width, int height)
+{
+    uint16_t *dst = (uint16_t *)_dst;
+    int w16 = width & ~15;
+    int x, y;
+
+    if (w16) {
+        for (y = 0; y < height; y++)
+            for (x = 0; x < w16; x += 16) {
+                __asm__ volatile(
+                    "vbroadcasti128    %3, %%ymm1           \n\t"
+                    "vmovdqu         (%1), %%ymm0           \n\t"
+                    "vpaddsw         (%2), %%ymm0, %%ymm0   \n\t"
+                    "vpaddsw       %%ymm1, %%ymm0, %%ymm0   \n\t"
+                    "vpsraw            $5, %%ymm0, %%ymm0   \n\t"
+                    "vpxor         %%ymm1, %%ymm1, %%ymm1   \n\t"
+                    "vpmaxsw       %%ymm1, %%ymm0, %%ymm0   \n\t"
+                    "vbroadcasti128    %4, %%ymm1           \n\t"
+                    "vpminsw       %%ymm1, %%ymm0, %%ymm0   \n\t"
+                    "vmovdqu       %%ymm0, (%0)             \n\t"
+                    :: "r"(dst + y * (dststride / 2) + x),
+                       "r"(src1 + y * srcstride + x),
+                       "r"(src2 + y * srcstride + x),
+                       "m"(ff_pw_16), "m"(*pw_1023)
+                    : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"
+                );
+            }
+        __asm__ volatile("vzeroupper");
+    }
+    if (w16 < width)
+        put_weighted_pred_avg_10_sse2((uint8_t *)(dst + w16), dststride,
+                                      src1 + w16, src2 + w16, srcstride,
+                                      width - w16, height);
+}
+
+#endif /* HAVE_AVX2_INLINE && ARCH_X86_64 */
+#endif /* HAVE_SSSE3_INLINE */
+
+#endif /* HAVE_SSE2_INLINE */
+
+av_cold void ff_hevc_dsp_init_x86(HEVCDSPContext *c, const int bit_depth)
+{
+#if HAVE_SSE2_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (!INLINE_SSE2(cpu_flags) || (bit_depth != 8 && bit_depth != 10))
+        return;
+
+    init_transform_tables();
+
+    if (bit_depth == 8) {
+        c->transform_4x4_luma_add = transform_4x4_luma_add_8_sse2;
+        c->transform_add[0]       = transform_4x4_add_8_sse2;
+        c->transform_add[1]       = transform_8x8_add_8_sse2;
+        c->transform_add[2]       = transform_16x16_add_8_sse2;
+        c->transform_add[3]       = transform_32x32_add_8_sse2;
+
+        c->sao_band_filter[0] = sao_band_filter_0_8_sse2;
+        c->sao_band_filter[1] = sao_band_filter_1_8_sse2;
+        c->sao_band_filter[2] = sao_band_filter_2_8_sse2;
+        c->sao_band_filter[3] = sao_band_filter_3_8_sse2;
+
+        c->put_hevc_qpel[0][0] = put_hevc_qpel_pixels_8_sse2;
+        c->put_hevc_qpel[0][1] = put_hevc_qpel_h1_8_sse2;
+        c->put_hevc_qpel[0][2] = put_hevc_qpel_h2_8_sse2;
+        c->put_hevc_qpel[0][3] = put_hevc_qpel_h3_8_sse2;
+        c->put_hevc_qpel[1][0] = put_hevc_qpel_v1_8_sse2;
+        c->put_hevc_qpel[1][1] = put_hevc_qpel_h1v1_8_sse2;
+        c->put_hevc_qpel[1][2] = put_hevc_qpel_h2v1_8_sse2;
+        c->put_hevc_qpel[1][3] = put_hevc_qpel_h3v1_8_sse2;
+        c->put_hevc_qpel[2][0] = put_hevc_qpel_v2_8_sse2;
+        c->put_hevc_qpel[2][1] = put_hevc_qpel_h1v2_8_sse2;
+        c->put_hevc_qpel[2][2] = put_hevc_qpel_h2v2_8_sse2;
+        c->put_hevc_qpel[2][3] = put_hevc_qpel_h3v2_8_sse2;
+        c->put_hevc_qpel[3][0] = put_hevc_qpel_v3_8_sse2;
+        c->put_hevc_qpel[3][1] = put_hevc_qpel_h1v3_8_sse2;
+        c->put_hevc_qpel[3][2] = put_hevc_qpel_h2v3_8_sse2;
+        c->put_hevc_qpel[3][3] = put_hevc_qpel_h3v3_8_sse2;
+
+        c->put_hevc_epel[0][0] = put_hevc_epel_pixels_8_sse2;
+        c->put_hevc_epel[0][1] = put_hevc_epel_h_8_sse2;
+        c->put_hevc_epel[1][0] = put_hevc_epel_v_8_sse2;
+        c->put_hevc_epel[1][1] = put_hevc_epel_hv_8_sse2;
+
+        c->put_unweighted_pred   = put_unweighted_pred_8_sse2;
+        c->put_weighted_pred_avg = put_weighted_pred_avg_8_sse2;
+
+        c->hevc_h_loop_filter_chroma = hevc_h_loop_filter_chroma_8_sse2;
+        c->hevc_v_loop_filter_chroma = hevc_v_loop_filter_chroma_8_sse2;
+        c->hevc_h_loop_filter_luma   = hevc_h_loop_filter_luma_8_sse2;
+        c->hevc_v_loop_filter_luma   = hevc_v_loop_filter_luma_8_sse2;
+
+        c->sao_edge_filter[0] = sao_edge_filter_0_8_sse2;
+        c->sao_edge_filter[1] = sao_edge_filter_1_8_sse2;
+    } else {
+        c->transform_4x4_luma_add = transform_4x4_luma_add_10_sse2;
+        c->transform_add[0]       = transform_4x4_add_10_sse2;
+        c->transform_add[1]       = transform_8x8_add_10_sse2;
+        c->transform_add[2]       = transform_16x16_add_10_sse2;
+        c->transform_add[3]       = transform_32x32_add_10_sse2;
+
+        c->sao_band_filter[0] = sao_band_filter_0_10_sse2;
+        c->sao_band_filter[1] = sao_band_filter_1_10_sse2;
+        c->sao_band_filter[2] = sao_band_filter_2_10_sse2;
+        c->sao_band_filter[3] = sao_band_filter_3_10_sse2;
+
+        c->sao_edge_filter[0] = sao_edge_filter_0_10_sse2;
+        c->sao_edge_filter[1] = sao_edge_filter_1_10_sse2;
+
+        c->put_hevc_qpel[0][0] = put_hevc_qpel_pixels_10_sse2;
+        c->put_hevc_qpel[0][1] = put_hevc_qpel_h1_10_sse2;
+        c->put_hevc_qpel[0][2] = put_hevc_qpel_h2_10_sse2;
+        c->put_hevc_qpel[0][3] = put_hevc_qpel_h3_10_sse2;
+        c->put_hevc_qpel[1][0] = put_hevc_qpel_v1_10_sse2;
+        c->put_hevc_qpel[1][1] = put_hevc_qpel_h1v1_10_sse2;
+        c->put_hevc_qpel[1][2] = put_hevc_qpel_h2v1_10_sse2;
+        c->put_hevc_qpel[1][3] = put_hevc_qpel_h3v1_10_sse2;
+        c->put_hevc_qpel[2][0] = put_hevc_qpel_v2_10_sse2;
+        c->put_hevc_qpel[2][1] = put_hevc_qpel_h1v2_10_sse2;
+        c->put_hevc_qpel[2][2] = put_hevc_qpel_h2v2_10_sse2;
+        c->put_hevc_qpel[2][3] = put_hevc_qpel_h3v2_10_sse2;
+        c->put_hevc_qpel[3][0] = put_hevc_qpel_v3_10_sse2;
+        c->put_hevc_qpel[3][1] = put_hevc_qpel_h1v3_10_sse2;
+        c->put_hevc_qpel[3][2] = put_hevc_qpel_h2v3_10_sse2;
+        c->put_hevc_qpel[3][3] = put_hevc_qpel_h3v3_10_sse2;
+
+        c->put_hevc_epel[0][0] = put_hevc_epel_pixels_10_sse2;
+        c->put_hevc_epel[0][1] = put_hevc_epel_h_10_sse2;
+        c->put_hevc_epel[1][0] = put_hevc_epel_v_10_sse2;
+        c->put_hevc_epel[1][1] = put_hevc_epel_hv_10_sse2;
+
+        c->put_unweighted_pred   = put_unweighted_pred_10_sse2;
+        c->put_weighted_pred_avg = put_weighted_pred_avg_10_sse2;
+
+        c->hevc_h_loop_filter_chroma = hevc_h_loop_filter_chroma_10_sse2;
+        c->hevc_v_loop_filter_chroma = hevc_v_loop_filter_chroma_10_sse2;
+        c->hevc_h_loop_filter_luma   = hevc_h_loop_filter_luma_10_sse2;
+        c->hevc_v_loop_filter_luma   = hevc_v_loop_filter_luma_10_sse2;
+    }
+
+#if HAVE_SSSE3_INLINE
+    if (INLINE_SSSE3(cpu_flags) && bit_depth == 8) {
+        c->put_hevc_qpel[0][1] = put_hevc_qpel_h1_8_ssse3;
+        c->put_hevc_qpel[0][2] = put_hevc_qpel_h2_8_ssse3;
+        c->put_hevc_qpel[0][3] = put_hevc_qpel_h3_8_ssse3;
+        c->put_hevc_qpel[1][0] = put_hevc_qpel_v1_8_ssse3;
+        c->put_hevc_qpel[1][1] = put_hevc_qpel_h1v1_8_ssse3;
+        c->put_hevc_qpel[1][2] = put_hevc_qpel_h2v1_8_ssse3;
+        c->put_hevc_qpel[1][3] = put_hevc_qpel_h3v1_8_ssse3;
+        c->put_hevc_qpel[2][0] = put_hevc_qpel_v2_8_ssse3;
+        c->put_hevc_qpel[2][1] = put_hevc_qpel_h1v2_8_ssse3;
+        c->put_hevc_qpel[2][2] = put_hevc_qpel_h2v2_8_ssse3;
+        c->put_hevc_qpel[2][3] = put_hevc_qpel_h3v2_8_ssse3;
+        c->put_hevc_qpel[3][0] = put_hevc_qpel_v3_8_ssse3;
+        c->put_hevc_qpel[3][1] = put_hevc_qpel_h1v3_8_ssse3;
+        c->put_hevc_qpel[3][2] = put_hevc_qpel_h2v3_8_ssse3;
+        c->put_hevc_qpel[3][3] = put_hevc_qpel_h3v3_8_ssse3;
+
+        c->put_hevc_epel[0][1] = put_hevc_epel_h_8_ssse3;
+        c->put_hevc_epel[1][0] = put_hevc_epel_v_8_ssse3;
+        c->put_hevc_epel[1][1] = put_hevc_epel_hv_8_ssse3;
+
+        c->sao_edge_filter[0] = sao_edge_filter_0_8_ssse3;
+        c->sao_edge_filter[1] = sao_edge_filter_1_8_ssse3;
+    }
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+    if (INLINE_AVX2(cpu_flags)) {
+        if (bit_depth == 8) {
+            c->put_hevc_qpel[1][0] = put_hevc_qpel_v1_8_avx2;
+            c->put_hevc_qpel[1][1] = put_hevc_qpel_h1v1_8_avx2;
+            c->put_hevc_qpel[1][2] = put_hevc_qpel_h2v1_8_avx2;
+            c->put_hevc_qpel[1][3] = put_hevc_qpel_h3v1_8_avx2;
+            c->put_hevc_qpel[2][0] = put_hevc_qpel_v2_8_avx2;
+            c->put_hevc_qpel[2][1] = put_hevc_qpel_h1v2_8_avx2;
+            c->put_hevc_qpel[2][2] = put_hevc_qpel_h2v2_8_avx2;
+            c->put_hevc_qpel[2][3] = put_hevc_qpel_h3v2_8_avx2;
+            c->put_hevc_qpel[3][0] = put_hevc_qpel_v3_8_avx2;
+            c->put_hevc_qpel[3][1] = put_hevc_qpel_h1v3_8_avx2;
+            c->put_hevc_qpel[3][2] = put_hevc_qpel_h2v3_8_avx2;
+            c->put_hevc_qpel[3][3] = put_hevc_qpel_h3v3_8_avx2;
+
+            c->put_hevc_epel[1][0] = put_hevc_epel_v_8_avx2;
+            c->put_hevc_epel[1][1] = put_hevc_epel_hv_8_avx2;
+
+            c->put_unweighted_pred   = put_unweighted_pred_8_avx2;
+            c->put_weighted_pred_avg = put_weighted_pred_avg_8_avx2;
+        } else {
+            c->put_unweighted_pred   = put_unweighted_pred_10_avx2;
+            c->put_weighted_pred_avg = put_weighted_pred_avg_10_avx2;
+        }
+    }
+#endif /* HAVE_AVX2_INLINE && ARCH_X86_64 */
+#endif /* HAVE_SSSE3_INLINE */
+#endif /* HAVE_SSE2_INLINE */
+}
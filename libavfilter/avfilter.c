@@ -35,6 +35,7 @@
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
+#include "framepool.h"
 #include "internal.h"
 
 static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame);
@@ -165,6 +166,7 @@ void avfilter_link_free(AVFilterLink **link)
         return;
 
     av_frame_free(&(*link)->partial_buf);
+    ff_video_frame_pool_uninit((FFVideoFramePool **)&(*link)->video_frame_pool);
 
     av_freep(link);
 }
@@ -428,10 +430,17 @@ void ff_update_link_current_pts(AVFilterLink *link, int64_t pts)
 {
     if (pts == AV_NOPTS_VALUE)
         return;
+    if (!link->graph) {
+        link->current_pts = av_rescale_q(pts, link->time_base, AV_TIME_BASE_Q);
+        return;
+    }
+    /* the heap of sink links reads current_pts of the other sink links */
+    ff_graph_lock(link->graph);
     link->current_pts = av_rescale_q(pts, link->time_base, AV_TIME_BASE_Q);
     /* TODO use duration */
-    if (link->graph && link->age_index >= 0)
+    if (link->age_index >= 0)
         ff_avfilter_graph_update_heap(link->graph, link);
+    ff_graph_unlock(link->graph);
 }
 
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags)
@@ -560,8 +569,9 @@ static const AVClass *filter_child_class_next(const AVClass *prev)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM
 static const AVOption avfilter_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
-        { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, "thread_type" },
-        { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .unit = "thread_type" },
+        { .i64 = AVFILTER_THREAD_SLICE | AVFILTER_THREAD_BRANCH }, 0, INT_MAX, FLAGS, "thread_type" },
+        { "slice",  NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE  }, .unit = "thread_type" },
+        { "branch", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_BRANCH }, .unit = "thread_type" },
     { "enable", "set enable expression", OFFSET(enable_str), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = FLAGS },
     { NULL },
 };
@@ -726,6 +736,7 @@ void avfilter_free(AVFilterContext *filter)
     av_expr_free(filter->enable);
     filter->enable = NULL;
     av_freep(&filter->var_values);
+    av_freep(&filter->internal->branch_rets);
     av_freep(&filter->internal);
     av_free(filter);
 }
@@ -817,7 +828,7 @@ int avfilter_init_filter(AVFilterContext *filter, const char *args, void *opaque
 
 int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
 {
-    int ret = 0;
+    int ret = 0, thread_type;
 
     ret = av_opt_set_dict(ctx, options);
     if (ret < 0) {
@@ -825,14 +836,17 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
         return ret;
     }
 
+    thread_type      = ctx->thread_type & ctx->graph->thread_type;
+    ctx->thread_type = 0;
     if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
-        ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_SLICE &&
+        thread_type & AVFILTER_THREAD_SLICE &&
         ctx->graph->internal->thread_execute) {
-        ctx->thread_type       = AVFILTER_THREAD_SLICE;
+        ctx->thread_type      |= AVFILTER_THREAD_SLICE;
         ctx->internal->execute = ctx->graph->internal->thread_execute;
-    } else {
-        ctx->thread_type = 0;
     }
+    if (thread_type & AVFILTER_THREAD_BRANCH &&
+        ctx->graph->internal->branch_execute)
+        ctx->thread_type |= AVFILTER_THREAD_BRANCH;
 
     if (ctx->filter->priv_class) {
         ret = av_opt_set_dict(ctx->priv, options);
@@ -1145,6 +1159,44 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
     }
 }
 
+static int filter_frame_branch(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AVFrame **frames = arg;
+    AVFrame *frame   = frames[jobnr];
+
+    if (!frame)
+        return 0;
+    frames[jobnr] = NULL;
+    return ff_filter_frame(ctx->outputs[jobnr], frame);
+}
+
+int ff_filter_frame_branches(AVFilterContext *ctx, AVFrame **frames)
+{
+    int *rets = ctx->internal->branch_rets;
+    int i, nb_frames = 0, ret = 0;
+
+    for (i = 0; i < ctx->nb_outputs; i++)
+        nb_frames += !!frames[i];
+
+    if (nb_frames > 1 && rets && ctx->thread_type & AVFILTER_THREAD_BRANCH &&
+        ctx->graph->internal->branch_execute(ctx, filter_frame_branch, frames,
+                                             rets, ctx->nb_outputs) >= 0) {
+        for (i = 0; i < ctx->nb_outputs; i++)
+            if (rets[i] < 0)
+                return rets[i];
+        return 0;
+    }
+
+    /* no threads available, e.g. nested branches: run them in order */
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        if (ret >= 0)
+            ret = filter_frame_branch(ctx, frames, i, ctx->nb_outputs);
+        else
+            av_frame_free(&frames[i]);
+    }
+    return ret;
+}
+
 const AVClass *avfilter_get_class(void)
 {
     return &avfilter_class;
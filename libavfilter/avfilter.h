@@ -621,6 +621,12 @@ typedef struct AVFilter {
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
 
+/**
+ * Process independent branches of the graph concurrently, e.g. the parts of
+ * the graph after the outputs of split.
+ */
+#define AVFILTER_THREAD_BRANCH (1 << 1)
+
 typedef struct AVFilterInternal AVFilterInternal;
 
 /** An instance of a filter */
@@ -854,6 +860,12 @@ struct AVFilterLink {
      * Number of past frames sent through the link.
      */
     int64_t frame_count;
+
+    /**
+     * A pointer to a FFVideoFramePool struct, used by the default video
+     * buffer allocator. Internal to the framework.
+     */
+    void *video_frame_pool;
 };
 
 /**
@@ -42,8 +42,9 @@
 #define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
 static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
-        { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, "thread_type" },
-        { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { .i64 = AVFILTER_THREAD_SLICE | AVFILTER_THREAD_BRANCH }, 0, INT_MAX, FLAGS, "thread_type" },
+        { "slice",  NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE  }, .flags = FLAGS, .unit = "thread_type" },
+        { "branch", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_BRANCH }, .flags = FLAGS, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, FLAGS },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
@@ -72,6 +73,19 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+int ff_graph_branch_thread_init(AVFilterGraph *graph)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_graph_lock(AVFilterGraph *graph)
+{
+}
+
+void ff_graph_unlock(AVFilterGraph *graph)
+{
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -1166,6 +1180,110 @@ static int graph_insert_fifos(AVFilterGraph *graph, AVClass *log_ctx)
     return 0;
 }
 
+static int filter_index(AVFilterGraph *graph, AVFilterContext *f)
+{
+    int i;
+
+    for (i = 0; i < graph->nb_filters; i++)
+        if (graph->filters[i] == f)
+            return i;
+    return -1;
+}
+
+/**
+ * Check whether the parts of the graph reachable from each output of f,
+ * without going through f, are disjoint. Only then can the outputs be
+ * processed concurrently.
+ */
+static int branches_independent(AVFilterGraph *graph, AVFilterContext *f,
+                                int *branch, int *stack)
+{
+    int i, j, n;
+
+    for (i = 0; i < graph->nb_filters; i++)
+        branch[i] = -1;
+
+    for (i = 0; i < f->nb_outputs; i++) {
+        int sp = 0;
+
+        if (!f->outputs[i] || f->outputs[i]->dst == f)
+            return 0;
+        n = filter_index(graph, f->outputs[i]->dst);
+        if (n < 0)
+            return 0;
+        if (branch[n] >= 0)
+            return 0;
+        branch[n]   = i;
+        stack[sp++] = n;
+
+        while (sp) {
+            AVFilterContext *cur = graph->filters[stack[--sp]];
+
+            for (j = 0; j < cur->nb_inputs + cur->nb_outputs; j++) {
+                AVFilterContext *next = j < cur->nb_inputs ?
+                                        cur->inputs[j]->src :
+                                        cur->outputs[j - cur->nb_inputs]->dst;
+
+                if (next == f)
+                    continue;
+                n = filter_index(graph, next);
+                if (n < 0)
+                    return 0;
+                if (branch[n] == i)
+                    continue;
+                if (branch[n] >= 0)
+                    return 0;
+                branch[n]   = i;
+                stack[sp++] = n;
+            }
+        }
+    }
+    return 1;
+}
+
+static int graph_config_branches(AVFilterGraph *graph, AVClass *log_ctx)
+{
+    int *branch, *stack;
+    int i, ret = 0;
+
+    if (!graph->internal->branch_execute)
+        return 0;
+
+    branch = av_malloc_array(graph->nb_filters, sizeof(*branch));
+    stack  = av_malloc_array(graph->nb_filters, sizeof(*stack));
+    if (!branch || !stack) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+
+        av_freep(&f->internal->branch_rets);
+        if (!(f->thread_type & AVFILTER_THREAD_BRANCH) || f->nb_outputs < 2 ||
+            !branches_independent(graph, f, branch, stack))
+            continue;
+
+        if ((ret = ff_graph_branch_thread_init(graph)) < 0)
+            goto end;
+        if (!graph->internal->branch_thread)
+            break;
+        f->internal->branch_rets = av_malloc_array(f->nb_outputs,
+                                                   sizeof(*f->internal->branch_rets));
+        if (!f->internal->branch_rets) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        av_log(log_ctx, AV_LOG_DEBUG, "Outputs of filter '%s' run concurrently\n",
+               f->name);
+    }
+
+end:
+    av_free(branch);
+    av_free(stack);
+    return ret;
+}
+
 int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
 {
     int ret;
@@ -1180,6 +1298,8 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = ff_avfilter_graph_config_pointers(graphctx, log_ctx)))
         return ret;
+    if ((ret = graph_config_branches(graphctx, log_ctx)) < 0)
+        return ret;
 
     return 0;
 }
@@ -0,0 +1,142 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/common.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "framepool.h"
+
+struct FFVideoFramePool {
+    int width;
+    int height;
+    enum AVPixelFormat format;
+    int align;
+    int linesize[4];
+    AVBufferPool *pools[4];
+};
+
+FFVideoFramePool *ff_video_frame_pool_init(AVBufferRef *(*alloc)(int size),
+                                           int width, int height,
+                                           enum AVPixelFormat format,
+                                           int align)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+    FFVideoFramePool *pool;
+    int i, ret;
+
+    if (!desc || av_image_check_size(width, height, 0, NULL) < 0)
+        return NULL;
+
+    pool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        return NULL;
+
+    pool->width  = width;
+    pool->height = height;
+    pool->format = format;
+    pool->align  = align;
+
+    for (i = 1; i <= align; i += i) {
+        ret = av_image_fill_linesizes(pool->linesize, format,
+                                      FFALIGN(width, i));
+        if (ret < 0)
+            goto fail;
+        if (!(pool->linesize[0] & (align - 1)))
+            break;
+    }
+
+    for (i = 0; i < 4 && pool->linesize[i]; i++) {
+        int h = FFALIGN(height, 32);
+        if (i == 1 || i == 2)
+            h = FF_CEIL_RSHIFT(h, desc->log2_chroma_h);
+
+        pool->linesize[i] = FFALIGN(pool->linesize[i], align);
+        pool->pools[i]    = av_buffer_pool_init(pool->linesize[i] * h + 16,
+                                                alloc);
+        if (!pool->pools[i])
+            goto fail;
+    }
+
+    if (desc->flags & AV_PIX_FMT_FLAG_PAL ||
+        desc->flags & AV_PIX_FMT_FLAG_PSEUDOPAL) {
+        av_buffer_pool_uninit(&pool->pools[1]);
+        pool->pools[1] = av_buffer_pool_init(1024, alloc);
+        if (!pool->pools[1])
+            goto fail;
+    }
+
+    return pool;
+
+fail:
+    ff_video_frame_pool_uninit(&pool);
+    return NULL;
+}
+
+void ff_video_frame_pool_uninit(FFVideoFramePool **pool)
+{
+    int i;
+
+    if (!pool || !*pool)
+        return;
+
+    for (i = 0; i < 4; i++)
+        av_buffer_pool_uninit(&(*pool)->pools[i]);
+
+    av_freep(pool);
+}
+
+void ff_video_frame_pool_get_config(FFVideoFramePool *pool,
+                                    int *width, int *height,
+                                    enum AVPixelFormat *format,
+                                    int *align)
+{
+    *width  = pool->width;
+    *height = pool->height;
+    *format = pool->format;
+    *align  = pool->align;
+}
+
+AVFrame *ff_video_frame_pool_get(FFVideoFramePool *pool)
+{
+    AVFrame *frame = av_frame_alloc();
+    int i;
+
+    if (!frame)
+        return NULL;
+
+    frame->width  = pool->width;
+    frame->height = pool->height;
+    frame->format = pool->format;
+
+    for (i = 0; i < 4 && pool->pools[i]; i++) {
+        frame->linesize[i] = pool->linesize[i];
+        frame->buf[i]      = av_buffer_pool_get(pool->pools[i]);
+        if (!frame->buf[i])
+            goto fail;
+        frame->data[i]     = frame->buf[i]->data;
+    }
+
+    frame->extended_data = frame->data;
+
+    return frame;
+
+fail:
+    av_frame_free(&frame);
+    return NULL;
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_FRAMEPOOL_H
+#define AVFILTER_FRAMEPOOL_H
+
+#include "libavutil/buffer.h"
+#include "libavutil/frame.h"
+
+/**
+ * Video frame pool. Frames are laid out as by av_frame_get_buffer(): every
+ * linesize is a multiple of the requested alignment and every plane is
+ * padded to a multiple of 32 luma rows, which is what hardware encoders
+ * such as QSV require to use the frame memory directly.
+ */
+typedef struct FFVideoFramePool FFVideoFramePool;
+
+/**
+ * Allocate and initialize a video frame pool.
+ *
+ * @param alloc  a function that will be used to allocate new frame buffers
+ *               when the pool is empty, e.g. av_buffer_alloc()
+ * @param align  the value used to align the linesizes
+ * @return newly created pool or NULL on failure
+ */
+FFVideoFramePool *ff_video_frame_pool_init(AVBufferRef *(*alloc)(int size),
+                                           int width, int height,
+                                           enum AVPixelFormat format,
+                                           int align);
+
+/**
+ * Deallocate the pool. Frames already returned by ff_video_frame_pool_get()
+ * stay valid, the memory is freed once they are all released.
+ */
+void ff_video_frame_pool_uninit(FFVideoFramePool **pool);
+
+/**
+ * Get the parameters the pool was initialized with.
+ */
+void ff_video_frame_pool_get_config(FFVideoFramePool *pool,
+                                    int *width, int *height,
+                                    enum AVPixelFormat *format,
+                                    int *align);
+
+/**
+ * Allocate a new AVFrame, reusing old buffers from the pool when available.
+ *
+ * @return a new frame or NULL on failure
+ */
+AVFrame *ff_video_frame_pool_get(FFVideoFramePool *pool);
+
+#endif /* AVFILTER_FRAMEPOOL_H */
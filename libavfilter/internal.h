@@ -147,10 +147,19 @@ struct AVFilterPad {
 struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
+    void *branch_thread;
+    avfilter_execute_func *branch_execute;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+
+    /**
+     * Return values of ff_filter_frame_branches(), one per output. Only
+     * allocated if the parts of the graph after each output are independent
+     * from each other and can be run concurrently.
+     */
+    int *branch_rets;
 };
 
 #if FF_API_AVFILTERBUFFER
@@ -334,6 +343,21 @@ int ff_buffersink_read_samples_compat(AVFilterContext *ctx, AVFilterBufferRef **
  */
 int ff_filter_frame(AVFilterLink *link, AVFrame *frame);
 
+/**
+ * Send one frame on each output of a filter.
+ *
+ * If branch threading is enabled and the parts of the graph after the
+ * outputs are independent from each other, the frames are processed
+ * concurrently, otherwise they are sent in order like with ff_filter_frame().
+ *
+ * @param frames array of ctx->nb_outputs frames; NULL entries are skipped.
+ *               All the frames are freed or passed on, even on error, and
+ *               the array entries are reset to NULL.
+ *
+ * @return >= 0 on success, the first error in output order otherwise
+ */
+int ff_filter_frame_branches(AVFilterContext *ctx, AVFrame **frames);
+
 /**
  * Flags for AVFilterLink.flags.
  */
@@ -0,0 +1,74 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_LUT3D_H
+#define AVFILTER_LUT3D_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "dualinput.h"
+
+enum interp_mode {
+    INTERPOLATE_NEAREST,
+    INTERPOLATE_TRILINEAR,
+    INTERPOLATE_TETRAHEDRAL,
+    NB_INTERP_MODE
+};
+
+struct rgbvec {
+    float r, g, b;
+};
+
+/* position of an input component value in the LUT */
+struct lutcoord {
+    int prev, next, near;
+    float d;            ///< distance from prev
+};
+
+/* 3D LUT don't often go up to level 32, but it is common to have a Hald CLUT
+ * of 512x512 (64x64x64) */
+#define MAX_LEVEL 64
+
+typedef struct LUT3DContext {
+    const AVClass *class;
+    enum interp_mode interpolation;
+    char *file;
+    uint8_t rgba_map[4];
+    int step;
+    int is16bit;
+    void (*interp_row)(const struct LUT3DContext *lut3d, uint8_t *dst,
+                       const uint8_t *src, int w, int copy_alpha);
+    struct rgbvec lut[MAX_LEVEL][MAX_LEVEL][MAX_LEVEL];
+    int lutsize;
+    struct lutcoord *coords;    ///< LUT position of every input component value
+    int coords_lutsize;         ///< lutsize the coords were computed for
+    int dense;
+    uint8_t *dense_lut;         ///< 8-bit output of every 24-bit RGB input
+#if CONFIG_HALDCLUT_FILTER
+    uint8_t clut_rgba_map[4];
+    int clut_step;
+    int clut_is16bit;
+    int clut_width;
+    FFDualInputContext dinput;
+#endif
+} LUT3DContext;
+
+void ff_lut3d_init_x86(LUT3DContext *lut3d);
+
+#endif /* AVFILTER_LUT3D_H */
@@ -59,8 +59,16 @@ typedef struct ThreadContext {
     pthread_mutex_t current_job_lock;
     int current_job;
     int done;
+
+    /* held while the workers run the jobs of one execute call */
+    pthread_mutex_t execute_lock;
 } ThreadContext;
 
+typedef struct BranchContext {
+    ThreadContext thread;
+    pthread_mutex_t graph_lock;
+} BranchContext;
+
 static void* attribute_align_arg worker(void *v)
 {
     ThreadContext *c = v;
@@ -106,6 +114,7 @@ static void slice_thread_uninit(ThreadContext *c)
          pthread_join(c->workers[i], NULL);
 
     pthread_mutex_destroy(&c->current_job_lock);
+    pthread_mutex_destroy(&c->execute_lock);
     pthread_cond_destroy(&c->current_job_cond);
     pthread_cond_destroy(&c->last_job_cond);
     av_freep(&c->workers);
@@ -117,15 +126,11 @@ static void slice_thread_park_workers(ThreadContext *c)
     pthread_mutex_unlock(&c->current_job_lock);
 }
 
-static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
-                          void *arg, int *ret, int nb_jobs)
+static void run_jobs(ThreadContext *c, AVFilterContext *ctx,
+                     avfilter_action_func *func, void *arg, int *ret, int nb_jobs)
 {
-    ThreadContext *c = ctx->graph->internal->thread;
     int dummy_ret;
 
-    if (nb_jobs <= 0)
-        return 0;
-
     pthread_mutex_lock(&c->current_job_lock);
 
     c->current_job = c->nb_threads;
@@ -143,6 +148,38 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
     pthread_cond_broadcast(&c->current_job_cond);
 
     slice_thread_park_workers(c);
+}
+
+static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
+                          void *arg, int *ret, int nb_jobs)
+{
+    ThreadContext *c = ctx->graph->internal->thread;
+
+    if (nb_jobs <= 0)
+        return 0;
+
+    /* filters in concurrent branches share the pool */
+    pthread_mutex_lock(&c->execute_lock);
+    run_jobs(c, ctx, func, arg, ret, nb_jobs);
+    pthread_mutex_unlock(&c->execute_lock);
+
+    return 0;
+}
+
+static int branch_execute(AVFilterContext *ctx, avfilter_action_func *func,
+                          void *arg, int *ret, int nb_jobs)
+{
+    BranchContext *b = ctx->graph->internal->branch_thread;
+
+    if (nb_jobs <= 0)
+        return 0;
+
+    /* Branches nested in a running branch are run by the calling thread,
+     * waiting for the pool there would deadlock. */
+    if (pthread_mutex_trylock(&b->thread.execute_lock))
+        return AVERROR(EBUSY);
+    run_jobs(&b->thread, ctx, func, arg, ret, nb_jobs);
+    pthread_mutex_unlock(&b->thread.execute_lock);
 
     return 0;
 }
@@ -175,6 +212,7 @@ static int thread_init_internal(ThreadContext *c, int nb_threads)
     pthread_cond_init(&c->current_job_cond, NULL);
     pthread_cond_init(&c->last_job_cond,    NULL);
 
+    pthread_mutex_init(&c->execute_lock, NULL);
     pthread_mutex_init(&c->current_job_lock, NULL);
     pthread_mutex_lock(&c->current_job_lock);
     for (i = 0; i < nb_threads; i++) {
@@ -220,12 +258,180 @@ int ff_graph_thread_init(AVFilterGraph *graph)
 
     graph->internal->thread_execute = thread_execute;
 
+    /* the branch pool is only created once a filter can use it, see
+     * ff_graph_branch_thread_init() */
+    if (graph->thread_type & AVFILTER_THREAD_BRANCH)
+        graph->internal->branch_execute = branch_execute;
+
+    return 0;
+}
+
+int ff_graph_branch_thread_init(AVFilterGraph *graph)
+{
+    BranchContext *b;
+    int ret;
+
+    if (graph->internal->branch_thread)
+        return 0;
+
+    b = av_mallocz(sizeof(*b));
+    if (!b)
+        return AVERROR(ENOMEM);
+
+    ret = thread_init_internal(&b->thread, graph->nb_threads);
+    if (ret <= 1) {
+        av_free(b);
+        return (ret == AVERROR(ENOMEM)) ? ret : 0;
+    }
+    pthread_mutex_init(&b->graph_lock, NULL);
+
+    graph->internal->branch_thread = b;
+
     return 0;
 }
 
 void ff_graph_thread_free(AVFilterGraph *graph)
 {
+    BranchContext *b = graph->internal->branch_thread;
+
     if (graph->internal->thread)
         slice_thread_uninit(graph->internal->thread);
     av_freep(&graph->internal->thread);
+
+    if (b) {
+        slice_thread_uninit(&b->thread);
+        pthread_mutex_destroy(&b->graph_lock);
+    }
+    av_freep(&graph->internal->branch_thread);
 }
+
+void ff_graph_lock(AVFilterGraph *graph)
+{
+    BranchContext *b = graph->internal->branch_thread;
+
+    if (b)
+        pthread_mutex_lock(&b->graph_lock);
+}
+
+void ff_graph_unlock(AVFilterGraph *graph)
+{
+    BranchContext *b = graph->internal->branch_thread;
+
+    if (b)
+        pthread_mutex_unlock(&b->graph_lock);
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/frame.h"
+#include "buffersink.h"
+
+#undef printf
+
+#define MAX_SINKS  4
+#define MAX_FRAMES 16
+
+static const char *graph_desc =
+    "testsrc=s=176x144:r=25:d=0.4,split=3[a][b][c];"
+    "[a]hflip,buffersink;"
+    "[b]vflip,buffersink;"
+    "[c]split[d][e];[d]negate,buffersink;[e]transpose,buffersink";
+
+static int run_graph(int nb_threads, uint32_t sums[MAX_SINKS][MAX_FRAMES],
+                     int nb_frames[MAX_SINKS], int *branch_threads)
+{
+    AVFilterGraph *graph = avfilter_graph_alloc();
+    AVFilterInOut *inputs = NULL, *outputs = NULL;
+    AVFilterContext *sinks[MAX_SINKS];
+    AVFrame *frame = av_frame_alloc();
+    int i, y, ret, eof = 0, nb_sinks = 0;
+
+    if (!graph || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    /* must be set before the first filter creates the graph thread pool */
+    graph->nb_threads = nb_threads;
+
+    if ((ret = avfilter_graph_parse2(graph, graph_desc, &inputs, &outputs)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+    *branch_threads = !!graph->internal->branch_thread;
+
+    for (i = 0; i < graph->nb_filters; i++)
+        if (!strcmp(graph->filters[i]->filter->name, "buffersink") &&
+            nb_sinks < MAX_SINKS)
+            sinks[nb_sinks++] = graph->filters[i];
+
+    while (!eof) {
+        ret = avfilter_graph_request_oldest(graph);
+        if (ret == AVERROR_EOF)
+            eof = 1;
+        else if (ret < 0)
+            goto end;
+
+        for (i = 0; i < nb_sinks; i++) {
+            while (av_buffersink_get_frame(sinks[i], frame) >= 0) {
+                uint32_t sum = 0;
+
+                for (y = 0; y < frame->height; y++)
+                    sum = av_adler32_update(sum, frame->data[0] + y * frame->linesize[0],
+                                            frame->width * 3);
+                if (nb_frames[i] < MAX_FRAMES)
+                    sums[i][nb_frames[i]++] = sum;
+                av_frame_unref(frame);
+            }
+        }
+    }
+    ret = nb_sinks;
+
+end:
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    avfilter_graph_free(&graph);
+    av_frame_free(&frame);
+    return ret;
+}
+
+int main(void)
+{
+    uint32_t serial[MAX_SINKS][MAX_FRAMES], threaded[MAX_SINKS][MAX_FRAMES];
+    int nb_serial[MAX_SINKS] = { 0 }, nb_threaded[MAX_SINKS] = { 0 };
+    int i, j, nb_sinks, branch_threads, errors = 0;
+
+    avfilter_register_all();
+
+    nb_sinks = run_graph(1, serial, nb_serial, &branch_threads);
+    if (nb_sinks < 0 || run_graph(4, threaded, nb_threaded, &branch_threads) < 0) {
+        fprintf(stderr, "Failed to run the filter graph\n");
+        return 1;
+    }
+    if (!branch_threads) {
+        fprintf(stderr, "No branch thread pool with 4 threads\n");
+        errors++;
+    }
+
+    for (i = 0; i < nb_sinks; i++) {
+        if (nb_threaded[i] != nb_serial[i]) {
+            fprintf(stderr, "sink %d: %d frames threaded, %d serial\n",
+                    i, nb_threaded[i], nb_serial[i]);
+            errors++;
+        }
+        for (j = 0; j < nb_serial[i]; j++) {
+            printf("sink %d frame %2d: 0x%08x\n", i, j, serial[i][j]);
+            if (j < nb_threaded[i] && threaded[i][j] != serial[i][j]) {
+                fprintf(stderr, "sink %d frame %d: 0x%08x threaded\n",
+                        i, j, threaded[i][j]);
+                errors++;
+            }
+        }
+    }
+
+    return !!errors;
+}
+
+#endif
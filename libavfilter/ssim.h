@@ -0,0 +1,47 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef AVFILTER_SSIM_H
+#define AVFILTER_SSIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct SSIMDSPContext {
+    /**
+     * Compute the sums of a line of w 4x4 blocks of two 8-bit images:
+     * sum of main pixels, sum of reference pixels, sum of their squares and
+     * sum of their products.
+     */
+    void (*ssim_4x4_line)(const uint8_t *main, ptrdiff_t main_stride,
+                          const uint8_t *ref, ptrdiff_t ref_stride,
+                          int (*sums)[4], int w);
+    /**
+     * Return the sum of the SSIM of the w 8x8 windows made of the 4x4
+     * blocks of two consecutive lines of sums.
+     */
+    float (*ssim_end_line)(const int (*sum0)[4], const int (*sum1)[4], int w);
+} SSIMDSPContext;
+
+void ff_ssim_init_x86(SSIMDSPContext *dsp);
+
+void ff_ssim_4x4_line_c(const uint8_t *main, ptrdiff_t main_stride,
+                        const uint8_t *ref, ptrdiff_t ref_stride,
+                        int (*sums)[4], int w);
+
+#endif /* AVFILTER_SSIM_H */
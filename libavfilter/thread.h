@@ -26,4 +26,21 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Create the worker pool running concurrent branches, if it does not exist
+ * yet. Only called once a filter of the graph has independent outputs, so
+ * that other graphs pay neither for the threads nor for the graph lock.
+ * If no more than one worker can be started, no pool is created and 0 is
+ * returned; the branches then run serially.
+ */
+int ff_graph_branch_thread_init(AVFilterGraph *graph);
+
+/**
+ * Lock the state shared by the whole graph, e.g. the heap of sink links,
+ * against concurrent updates from branches running in different threads.
+ */
+void ff_graph_lock(AVFilterGraph *graph);
+
+void ff_graph_unlock(AVFilterGraph *graph);
+
 #endif /* AVFILTER_THREAD_H */
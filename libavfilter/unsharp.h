@@ -55,7 +55,9 @@ typedef struct UnsharpFilterParam {
     int steps_y;                             ///< vertical step count
     int scalebits;                           ///< bits to shift pixel
     int32_t halfscale;                       ///< amount to add to pixel
-    uint32_t *sc[MAX_MATRIX_SIZE - 1];       ///< finite state machine storage
+    int sr_stride;                           ///< size of a row of sr and sc, in elements
+    uint32_t *sr;                            ///< horizontal sums, one row per thread
+    uint32_t *sc;                            ///< finite state machine storage, 2 * steps_y rows per thread
 } UnsharpFilterParam;
 
 typedef struct {
@@ -65,11 +67,27 @@ typedef struct {
     UnsharpFilterParam luma;   ///< luma parameters (width, height, amount)
     UnsharpFilterParam chroma; ///< chroma parameters (width, height, amount)
     int hsub, vsub;
+    int nb_threads;
     int opencl;
 #if CONFIG_OPENCL
     UnsharpOpenclContext opencl_ctx;
 #endif
     int (* apply_unsharp)(AVFilterContext *ctx, AVFrame *in, AVFrame *out);
+    /// DSP functions.
+    void (*blur_line_h)(uint32_t *sr, int width);
+    /// vertical blur of sr with the nb_lines rows of sc, stride in elements
+    void (*blur_lines_v)(uint32_t *sr, uint32_t *sc, ptrdiff_t sc_stride,
+                         int nb_lines, int width);
+    void (*unsharp_line)(uint8_t *dst, const uint8_t *src, const uint32_t *sr,
+                         int width, int32_t halfscale, int scalebits, int amount);
 } UnsharpContext;
 
+void ff_unsharp_init_x86(UnsharpContext *unsharp);
+
+void ff_unsharp_blur_line_h_c(uint32_t *sr, int width);
+void ff_unsharp_blur_lines_v_c(uint32_t *sr, uint32_t *sc, ptrdiff_t sc_stride,
+                               int nb_lines, int width);
+void ff_unsharp_line_c(uint8_t *dst, const uint8_t *src, const uint32_t *sr,
+                       int width, int32_t halfscale, int scalebits, int amount);
+
 #endif /* AVFILTER_UNSHARP_H */
@@ -150,6 +150,11 @@ typedef struct {
     FT_Library library;             ///< freetype font library handle
     FT_Face face;                   ///< freetype font face handle
     struct AVTreeNode *glyphs;      ///< rendered glyphs, stored using the UTF-32 char code
+    char *mask_text;                ///< expanded text rendered in text_mask
+    uint8_t *text_mask;             ///< all the glyphs of mask_text, 8 bits per pixel
+    unsigned int text_mask_size;    ///< allocated size of text_mask
+    int text_mask_w, text_mask_h;   ///< size of text_mask, also its linesize is text_mask_w
+    int text_mask_x, text_mask_y;   ///< position of text_mask relative to the text
     char *x_expr;                   ///< expression for x position
     char *y_expr;                   ///< expression for y position
     AVExpr *x_pexpr, *y_pexpr;      ///< parsed expressions for x and y
@@ -540,6 +545,10 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_tree_destroy(s->glyphs);
     s->glyphs = NULL;
 
+    av_freep(&s->mask_text);
+    av_freep(&s->text_mask);
+    s->text_mask_size = 0;
+
     FT_Done_Face(s->face);
     FT_Done_FreeType(s->library);
 
@@ -806,41 +815,109 @@ static int expand_text(AVFilterContext *ctx)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height, const uint8_t rgbcolor[4], FFDrawColor *color, int x, int y)
+static Glyph *get_drawn_glyph(DrawTextContext *s, const uint8_t **text, int *ret)
 {
-    char *text = s->expanded_text.str;
-    uint32_t code = 0;
-    int i, x1, y1;
-    uint8_t *p;
-    Glyph *glyph = NULL;
+    Glyph dummy = { 0 }, *glyph;
+    uint32_t code;
 
-    for (i = 0, p = text; *p; i++) {
-        Glyph dummy = { 0 };
-        GET_UTF8(code, *p++, continue;);
+    *ret = 0;
+    GET_UTF8(code, *(*text)++, return NULL;);
 
-        /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
-            continue;
+    /* skip new line chars, just go to new line */
+    if (is_newline(code) || code == '\t')
+        return NULL;
 
-        dummy.code = code;
-        glyph = av_tree_find(s->glyphs, &dummy, (void *)glyph_cmp, NULL);
+    dummy.code = code;
+    glyph = av_tree_find(s->glyphs, &dummy, (void *)glyph_cmp, NULL);
 
-        if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
-            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
-            return AVERROR(EINVAL);
+    if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
+        glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
+        *ret = AVERROR(EINVAL);
+    return glyph;
+}
+
+/**
+ * Render all the glyphs of the expanded text in a single 8-bit mask, so that
+ * the text is blended in one pass per color; the mask is kept as long as the
+ * expanded text does not change.
+ */
+static int render_text_mask(DrawTextContext *s)
+{
+    const char *text = s->expanded_text.str;
+    const uint8_t *p;
+    int x_min = INT_MAX, y_min = INT_MAX, x_max = INT_MIN, y_max = INT_MIN;
+    int i, x, y, ret;
+    Glyph *glyph;
+
+    if (s->mask_text && !strcmp(s->mask_text, text))
+        return 0;
+    av_freep(&s->mask_text);
+
+    for (i = 0, p = (const uint8_t *)text; *p; i++) {
+        glyph = get_drawn_glyph(s, &p, &ret);
+        if (ret < 0)
+            return ret;
+        if (!glyph)
+            continue;
+        x_min = FFMIN(x_min, s->positions[i].x);
+        y_min = FFMIN(y_min, s->positions[i].y);
+        x_max = FFMAX(x_max, s->positions[i].x + glyph->bitmap.width);
+        y_max = FFMAX(y_max, s->positions[i].y + glyph->bitmap.rows);
+    }
+    s->text_mask_x = x_min;
+    s->text_mask_y = y_min;
+    s->text_mask_w = FFMAX(x_max - x_min, 0);
+    s->text_mask_h = FFMAX(y_max - y_min, 0);
+    if (!s->text_mask_w || !s->text_mask_h)
+        goto end;
+
+    if (s->text_mask_w * s->text_mask_h > s->text_mask_size) {
+        s->text_mask_size = 0;
+        if ((ret = av_reallocp(&s->text_mask, s->text_mask_w * s->text_mask_h)) < 0)
+            return ret;
+        s->text_mask_size = s->text_mask_w * s->text_mask_h;
+    }
+    memset(s->text_mask, 0, s->text_mask_w * s->text_mask_h);
 
-        x1 = s->positions[i].x+s->x+x;
-        y1 = s->positions[i].y+s->y+y;
+    for (i = 0, p = (const uint8_t *)text; *p; i++) {
+        const uint8_t *src;
+        uint8_t *dst;
 
-        ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
-                      glyph->bitmap.buffer, glyph->bitmap.pitch,
-                      glyph->bitmap.width, glyph->bitmap.rows,
-                      glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
-                      0, x1, y1);
+        if (!(glyph = get_drawn_glyph(s, &p, &ret)))
+            continue;
+        src = glyph->bitmap.buffer;
+        dst = s->text_mask + (s->positions[i].y - y_min) * s->text_mask_w +
+                             (s->positions[i].x - x_min);
+        for (y = 0; y < glyph->bitmap.rows; y++) {
+            for (x = 0; x < glyph->bitmap.width; x++) {
+                int a = glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO ?
+                        (src[x >> 3] >> (~x & 7) & 1) * 255 : src[x];
+                /* overlapping glyphs are composited on top of each other */
+                dst[x] += a - (dst[x] * a + 127) / 255;
+            }
+            src += glyph->bitmap.pitch;
+            dst += s->text_mask_w;
+        }
     }
 
+end:
+    if (!(s->mask_text = av_strdup(text)))
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
+                       int width, int height, const uint8_t rgbcolor[4], FFDrawColor *color, int x, int y)
+{
+    if (!s->text_mask_w || !s->text_mask_h)
+        return 0;
+
+    ff_blend_mask(&s->dc, color,
+                  frame->data, frame->linesize, width, height,
+                  s->text_mask, s->text_mask_w,
+                  s->text_mask_w, s->text_mask_h, 3, 0,
+                  s->text_mask_x + s->x + x, s->text_mask_y + s->y + y);
+
     return 0;
 }
 
@@ -996,6 +1073,9 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
                            frame->data, frame->linesize, width, height,
                            s->x, s->y, box_w, box_h);
 
+    if ((ret = render_text_mask(s)) < 0)
+        return ret;
+
     if (s->shadowx || s->shadowy) {
         if ((ret = draw_glyphs(s, frame, width, height, s->shadowcolor.rgba,
                                &s->shadowcolor, s->shadowx, s->shadowy)) < 0)
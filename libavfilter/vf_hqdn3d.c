@@ -31,6 +31,7 @@
 #include "config.h"
 #include "libavutil/attributes.h"
 #include "libavutil/common.h"
+#include "libavutil/cpu.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
@@ -54,6 +55,24 @@ static uint32_t lowpass(int prev, int cur, int16_t *coef, int depth)
     return cur + coef[d];
 }
 
+typedef struct ThreadData {
+    uint8_t *src, *dst;
+    uint16_t *line_ant, *frame_ant;
+    uint16_t *row_lowpass;
+    int w, h, sstride, dstride;
+    int y_offset;               ///< row of the plane at src, for bands of rows
+    int16_t *spatial, *temporal;
+    int depth;
+} ThreadData;
+
+#define DEPTH_SWITCH(func, depth, ...) \
+    switch (depth) {\
+        case  8: func(__VA_ARGS__,  8); break;\
+        case  9: func(__VA_ARGS__,  9); break;\
+        case 10: func(__VA_ARGS__, 10); break;\
+        case 16: func(__VA_ARGS__, 16); break;\
+    }
+
 av_always_inline
 static void denoise_temporal(uint8_t *src, uint8_t *dst,
                              uint16_t *frame_ant,
@@ -76,6 +95,21 @@ static void denoise_temporal(uint8_t *src, uint8_t *dst,
     }
 }
 
+static int denoise_temporal_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+    const int slice_start = (td->h *  jobnr   ) / nb_jobs;
+    const int slice_end   = (td->h * (jobnr+1)) / nb_jobs;
+
+    DEPTH_SWITCH(denoise_temporal, td->depth,
+                 td->src + slice_start * td->sstride,
+                 td->dst + slice_start * td->dstride,
+                 td->frame_ant + slice_start * td->w,
+                 td->w, slice_end - slice_start, td->sstride, td->dstride,
+                 td->temporal);
+    return 0;
+}
+
 av_always_inline
 static void denoise_spatial(HQDN3DContext *s,
                             uint8_t *src, uint8_t *dst,
@@ -120,8 +154,132 @@ static void denoise_spatial(HQDN3DContext *s,
     }
 }
 
+/*
+ * The threaded spatial filter runs in two passes: the horizontal lowpass of
+ * each row only depends on the row itself, so it is done by bands of rows and
+ * stored in row_lowpass; the vertical and temporal lowpasses only depend on
+ * the pixels above, so they are done by bands of columns.
+ * Without threads, the SIMD row functions run the same two passes by bands
+ * of 8 rows, so that row_lowpass stays in cache.
+ * The threaded passes cost about 1.5 times the fused C filter and 1.1 times
+ * the banded passes in CPU time, so they are only used with at least
+ * MIN_SPATIAL_THREADS threads and as many cores.
+ */
+#define MIN_SPATIAL_THREADS 3
+
 av_always_inline
-static void denoise_depth(HQDN3DContext *s,
+static void denoise_spatial_h_cols(ThreadData *td, int y0, int y1,
+                                   int x0, int x1, int depth)
+{
+    int16_t *spatial = td->spatial + (256 << LUT_BITS);
+    uint16_t *pixel_ant = td->row_lowpass + y0 * td->w;
+    uint8_t *src = td->src + y0 * td->sstride;
+    long x, y;
+
+    for (y = y0; y < y1; y++) {
+        x = x0;
+        if (!x) {
+            /* the first line is filtered from its first pixel, the next ones
+             * from the left neighbor */
+            pixel_ant[0] = LOAD(0);
+            if (!(y + td->y_offset))
+                pixel_ant[0] = lowpass(pixel_ant[0], LOAD(0), spatial, depth);
+            x = 1;
+        }
+        for (; x < x1; x++)
+            pixel_ant[x] = lowpass(pixel_ant[x - 1], LOAD(x), spatial, depth);
+        src       += td->sstride;
+        pixel_ant += td->w;
+    }
+}
+
+av_always_inline
+static void denoise_spatial_h(HQDN3DContext *s, ThreadData *td,
+                              int slice_start, int slice_end, int depth)
+{
+    int y = slice_start;
+
+    /* the row functions filter 8 rows at once, from their 5th pixel on */
+    if (s->denoise_spatial_h_rows[depth] && td->w >= 12) {
+        const int x = 4 + ((td->w - 4) & ~7);
+
+        for (; y + 8 <= slice_end; y += 8) {
+            denoise_spatial_h_cols(td, y, y + 8, 0, 4, depth);
+            s->denoise_spatial_h_rows[depth](td->row_lowpass + y * td->w + 4, td->w,
+                                             td->src + y * td->sstride + 4 * (depth > 8 ? 2 : 1),
+                                             td->sstride, x - 4,
+                                             td->spatial + (256 << LUT_BITS));
+            denoise_spatial_h_cols(td, y, y + 8, x, td->w, depth);
+        }
+    }
+    denoise_spatial_h_cols(td, y, slice_end, 0, td->w, depth);
+}
+
+av_always_inline
+static void denoise_spatial_v(HQDN3DContext *s, ThreadData *td,
+                              int slice_start, int slice_end, int depth)
+{
+    int16_t *spatial  = td->spatial  + (256 << LUT_BITS);
+    int16_t *temporal = td->temporal + (256 << LUT_BITS);
+    uint16_t *line_ant  = td->line_ant;
+    uint16_t *frame_ant = td->frame_ant;
+    uint16_t *pixel_ant = td->row_lowpass;
+    uint8_t *dst = td->dst;
+    long x, y;
+    uint32_t tmp;
+
+    for (y = 0; y < td->h; y++) {
+        x = slice_start;
+        if (!(y + td->y_offset)) {
+            /* the first line has no top neighbor */
+            for (; x < slice_end; x++) {
+                line_ant[x] = tmp = pixel_ant[x];
+                frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+                STORE(x, tmp);
+            }
+        } else if (s->denoise_spatial_v_row[depth]) {
+            x += (slice_end - slice_start) & ~7;
+            s->denoise_spatial_v_row[depth](dst + slice_start * (depth > 8 ? 2 : 1),
+                                            line_ant + slice_start,
+                                            frame_ant + slice_start,
+                                            pixel_ant + slice_start,
+                                            x - slice_start, spatial, temporal);
+        }
+        for (; x < slice_end; x++) {
+            line_ant[x] = tmp = lowpass(line_ant[x], pixel_ant[x], spatial, depth);
+            frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+            STORE(x, tmp);
+        }
+        dst       += td->dstride;
+        frame_ant += td->w;
+        pixel_ant += td->w;
+    }
+}
+
+static int denoise_spatial_h_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+    const int slice_start = (td->h *  jobnr   ) / nb_jobs;
+    const int slice_end   = (td->h * (jobnr+1)) / nb_jobs;
+
+    DEPTH_SWITCH(denoise_spatial_h, td->depth, ctx->priv, td, slice_start, slice_end);
+    return 0;
+}
+
+static int denoise_spatial_v_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+    /* keep the columns of a slice on whole cache lines */
+    const int slice_start = ((td->w *  jobnr   ) / nb_jobs) & ~31;
+    const int slice_end   = jobnr == nb_jobs - 1 ? td->w :
+                            ((td->w * (jobnr+1)) / nb_jobs) & ~31;
+
+    DEPTH_SWITCH(denoise_spatial_v, td->depth, ctx->priv, td, slice_start, slice_end);
+    return 0;
+}
+
+av_always_inline
+static void denoise_depth(AVFilterContext *ctx,
                           uint8_t *src, uint8_t *dst,
                           uint16_t *line_ant, uint16_t **frame_ant_ptr,
                           int w, int h, int sstride, int dstride,
@@ -129,6 +287,8 @@ static void denoise_depth(HQDN3DContext *s,
 {
     // FIXME: For 16bit depth, frame_ant could be a pointer to the previous
     // filtered frame rather than a separate buffer.
+    HQDN3DContext *s = ctx->priv;
+    ThreadData td;
     long x, y;
     uint16_t *frame_ant = *frame_ant_ptr;
     if (!frame_ant) {
@@ -141,21 +301,48 @@ static void denoise_depth(HQDN3DContext *s,
         frame_ant = *frame_ant_ptr;
     }
 
-    if (spatial[0])
+    td.src         = src;
+    td.dst         = dst;
+    td.line_ant    = line_ant;
+    td.frame_ant   = frame_ant;
+    td.row_lowpass = s->row_lowpass;
+    td.w           = w;
+    td.h           = h;
+    td.sstride     = sstride;
+    td.dstride     = dstride;
+    td.spatial     = spatial;
+    td.temporal    = temporal;
+    td.depth       = depth;
+    td.y_offset    = 0;
+
+    if (spatial[0] && s->spatial_threads && w >= 64) {
+        ctx->internal->execute(ctx, denoise_spatial_h_slice, &td, NULL,
+                               FFMIN(h, s->nb_threads));
+        ctx->internal->execute(ctx, denoise_spatial_v_slice, &td, NULL,
+                               FFMIN(w >> 5, s->nb_threads));
+    } else if (spatial[0] && s->row_lowpass) {
+        /* the two passes by bands of rows, so that row_lowpass stays in
+         * cache, for the SIMD row functions */
+        for (y = 0; y < h; y += 8) {
+            ThreadData band = td;
+
+            band.src       = src + y * sstride;
+            band.dst       = dst + y * dstride;
+            band.frame_ant = frame_ant + y * w;
+            band.h         = FFMIN(h - y, 8);
+            band.y_offset  = y;
+            denoise_spatial_h_slice(ctx, &band, 0, 1);
+            denoise_spatial_v_slice(ctx, &band, 0, 1);
+        }
+    } else if (spatial[0])
         denoise_spatial(s, src, dst, line_ant, frame_ant,
                         w, h, sstride, dstride, spatial, temporal, depth);
     else
-        denoise_temporal(src, dst, frame_ant,
-                         w, h, sstride, dstride, temporal, depth);
+        ctx->internal->execute(ctx, denoise_temporal_slice, &td, NULL,
+                               FFMIN(h, s->nb_threads));
 }
 
-#define denoise(...) \
-    switch (s->depth) {\
-        case  8: denoise_depth(__VA_ARGS__,  8); break;\
-        case  9: denoise_depth(__VA_ARGS__,  9); break;\
-        case 10: denoise_depth(__VA_ARGS__, 10); break;\
-        case 16: denoise_depth(__VA_ARGS__, 16); break;\
-    }
+#define denoise(...) DEPTH_SWITCH(denoise_depth, s->depth, __VA_ARGS__)
 
 static int16_t *precalc_coefs(double dist25, int depth)
 {
@@ -211,6 +398,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->coefs[2]);
     av_freep(&s->coefs[3]);
     av_freep(&s->line);
+    av_freep(&s->row_lowpass);
     av_freep(&s->frame_prev[0]);
     av_freep(&s->frame_prev[1]);
     av_freep(&s->frame_prev[2]);
@@ -258,6 +446,8 @@ static int config_input(AVFilterLink *inlink)
     s->vsub  = desc->log2_chroma_h;
     s->depth = desc->comp[0].depth_minus1+1;
 
+    s->nb_threads = FFMAX(1, inlink->dst->graph->nb_threads);
+
     s->line = av_malloc(inlink->w * sizeof(*s->line));
     if (!s->line)
         return AVERROR(ENOMEM);
@@ -271,6 +461,17 @@ static int config_input(AVFilterLink *inlink)
     if (ARCH_X86)
         ff_hqdn3d_init_x86(s);
 
+    s->spatial_threads = FFMIN(s->nb_threads, av_cpu_count()) >= MIN_SPATIAL_THREADS;
+    if (s->spatial_threads) {
+        s->row_lowpass = av_malloc_array(inlink->w, inlink->h * sizeof(*s->row_lowpass));
+        if (!s->row_lowpass)
+            return AVERROR(ENOMEM);
+    } else if (!s->denoise_row[s->depth] && s->denoise_spatial_h_rows[s->depth]) {
+        s->row_lowpass = av_malloc_array(inlink->w, 8 * sizeof(*s->row_lowpass));
+        if (!s->row_lowpass)
+            return AVERROR(ENOMEM);
+    }
+
     return 0;
 }
 
@@ -298,7 +499,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
 
     for (c = 0; c < 3; c++) {
-        denoise(s, in->data[c], out->data[c],
+        denoise(ctx, in->data[c], out->data[c],
                 s->line, &s->frame_prev[c],
                 FF_CEIL_RSHIFT(in->width,  (!!c * s->hsub)),
                 FF_CEIL_RSHIFT(in->height, (!!c * s->vsub)),
@@ -359,5 +560,6 @@ AVFilter avfilter_vf_hqdn3d = {
     .query_formats = query_formats,
     .inputs        = avfilter_vf_hqdn3d_inputs,
     .outputs       = avfilter_vf_hqdn3d_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
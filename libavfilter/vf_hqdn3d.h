@@ -32,11 +32,19 @@ typedef struct {
     const AVClass *class;
     int16_t *coefs[4];
     uint16_t *line;
+    uint16_t *row_lowpass;      ///< horizontal lowpass of the rows, or of a band of 8 rows without threads
     uint16_t *frame_prev[3];
     double strength[4];
     int hsub, vsub;
     int depth;
+    int nb_threads;
+    int spatial_threads;        ///< whether the spatial filter is split in threaded passes
     void (*denoise_row[17])(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
+    /* horizontal lowpass of w pixels of 8 rows, continuing from the pixels
+     * before them in row_lowpass; w is a multiple of 8 */
+    void (*denoise_spatial_h_rows[17])(uint16_t *row_lowpass, ptrdiff_t lowpass_stride, const uint8_t *src, ptrdiff_t sstride, ptrdiff_t w, int16_t *spatial);
+    /* vertical and temporal lowpasses of a row, w is a multiple of 8 */
+    void (*denoise_spatial_v_row[17])(uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, const uint16_t *pixel_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
 } HQDN3DContext;
 
 #define LUMA_SPATIAL   0
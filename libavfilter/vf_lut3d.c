@@ -34,6 +34,7 @@
 #include "dualinput.h"
 #include "formats.h"
 #include "internal.h"
+#include "lut3d.h"
 #include "video.h"
 
 #define R 0
@@ -41,41 +42,6 @@
 #define B 2
 #define A 3
 
-enum interp_mode {
-    INTERPOLATE_NEAREST,
-    INTERPOLATE_TRILINEAR,
-    INTERPOLATE_TETRAHEDRAL,
-    NB_INTERP_MODE
-};
-
-struct rgbvec {
-    float r, g, b;
-};
-
-/* 3D LUT don't often go up to level 32, but it is common to have a Hald CLUT
- * of 512x512 (64x64x64) */
-#define MAX_LEVEL 64
-
-typedef struct LUT3DContext {
-    const AVClass *class;
-    enum interp_mode interpolation;
-    char *file;
-    uint8_t rgba_map[4];
-    int step;
-    int is16bit;
-    struct rgbvec (*interp_8) (const struct LUT3DContext*, uint8_t,  uint8_t,  uint8_t);
-    struct rgbvec (*interp_16)(const struct LUT3DContext*, uint16_t, uint16_t, uint16_t);
-    struct rgbvec lut[MAX_LEVEL][MAX_LEVEL][MAX_LEVEL];
-    int lutsize;
-#if CONFIG_HALDCLUT_FILTER
-    uint8_t clut_rgba_map[4];
-    int clut_step;
-    int clut_is16bit;
-    int clut_width;
-    FFDualInputContext dinput;
-#endif
-} LUT3DContext;
-
 #define OFFSET(x) offsetof(LUT3DContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 #define COMMON_OPTIONS \
@@ -100,15 +66,44 @@ static inline struct rgbvec lerp(const struct rgbvec *v0, const struct rgbvec *v
 
 #define NEAR(x) ((int)((x) + .5))
 #define PREV(x) ((int)(x))
-#define NEXT(x) (FFMIN((int)(x) + 1, lut3d->lutsize - 1))
+#define NEXT(x) (FFMIN((int)(x) + 1, lutsize - 1))
+
+/**
+ * Compute the LUT position of all the 2^nbits input component values.
+ */
+static int init_coords(LUT3DContext *lut3d, int nbits)
+{
+    const int lutsize = lut3d->lutsize;
+    const float scale = (1. / ((1<<nbits) - 1)) * (lutsize - 1);
+    int i;
+
+    if (lut3d->coords && lut3d->coords_lutsize == lutsize)
+        return 0;
+    av_freep(&lut3d->coords);
+    lut3d->coords = av_malloc((1 << nbits) * sizeof(*lut3d->coords));
+    if (!lut3d->coords)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < 1 << nbits; i++) {
+        const float s = i * scale;
+        struct lutcoord *c = &lut3d->coords[i];
+        c->prev = PREV(s);
+        c->next = NEXT(s);
+        c->near = NEAR(s);
+        c->d    = s - c->prev;
+    }
+    lut3d->coords_lutsize = lutsize;
+    return 0;
+}
 
 /**
  * Get the nearest defined point
  */
 static inline struct rgbvec interp_nearest(const LUT3DContext *lut3d,
-                                           const struct rgbvec *s)
+                                           const struct lutcoord *r,
+                                           const struct lutcoord *g,
+                                           const struct lutcoord *b)
 {
-    return lut3d->lut[NEAR(s->r)][NEAR(s->g)][NEAR(s->b)];
+    return lut3d->lut[r->near][g->near][b->near];
 }
 
 /**
@@ -116,11 +111,13 @@ static inline struct rgbvec interp_nearest(const LUT3DContext *lut3d,
  * @see https://en.wikipedia.org/wiki/Trilinear_interpolation
  */
 static inline struct rgbvec interp_trilinear(const LUT3DContext *lut3d,
-                                             const struct rgbvec *s)
+                                             const struct lutcoord *r,
+                                             const struct lutcoord *g,
+                                             const struct lutcoord *b)
 {
-    const int prev[] = {PREV(s->r), PREV(s->g), PREV(s->b)};
-    const int next[] = {NEXT(s->r), NEXT(s->g), NEXT(s->b)};
-    const struct rgbvec d = {s->r - prev[0], s->g - prev[1], s->b - prev[2]};
+    const int prev[] = {r->prev, g->prev, b->prev};
+    const int next[] = {r->next, g->next, b->next};
+    const struct rgbvec d = {r->d, g->d, b->d};
     const struct rgbvec c000 = lut3d->lut[prev[0]][prev[1]][prev[2]];
     const struct rgbvec c001 = lut3d->lut[prev[0]][prev[1]][next[2]];
     const struct rgbvec c010 = lut3d->lut[prev[0]][next[1]][prev[2]];
@@ -144,11 +141,13 @@ static inline struct rgbvec interp_trilinear(const LUT3DContext *lut3d,
  * @see http://www.filmlight.ltd.uk/pdf/whitepapers/FL-TL-TN-0057-SoftwareLib.pdf
  */
 static inline struct rgbvec interp_tetrahedral(const LUT3DContext *lut3d,
-                                               const struct rgbvec *s)
+                                               const struct lutcoord *r,
+                                               const struct lutcoord *g,
+                                               const struct lutcoord *b)
 {
-    const int prev[] = {PREV(s->r), PREV(s->g), PREV(s->b)};
-    const int next[] = {NEXT(s->r), NEXT(s->g), NEXT(s->b)};
-    const struct rgbvec d = {s->r - prev[0], s->g - prev[1], s->b - prev[2]};
+    const int prev[] = {r->prev, g->prev, b->prev};
+    const int next[] = {r->next, g->next, b->next};
+    const struct rgbvec d = {r->d, g->d, b->d};
     const struct rgbvec c000 = lut3d->lut[prev[0]][prev[1]][prev[2]];
     const struct rgbvec c111 = lut3d->lut[next[0]][next[1]][next[2]];
     struct rgbvec c;
@@ -196,15 +195,50 @@ static inline struct rgbvec interp_tetrahedral(const LUT3DContext *lut3d,
     return c;
 }
 
-#define DEFINE_INTERP_FUNC(name, nbits)                                     \
-static struct rgbvec interp_##nbits##_##name(const LUT3DContext *lut3d,     \
-                                             uint##nbits##_t r,             \
-                                             uint##nbits##_t g,             \
-                                             uint##nbits##_t b)             \
-{                                                                           \
-    const float scale = (1. / ((1<<nbits) - 1)) * (lut3d->lutsize - 1);     \
-    const struct rgbvec scaled_rgb = {r * scale, g * scale, b * scale};     \
-    return interp_##name(lut3d, &scaled_rgb);                               \
+#define DEFINE_INTERP_FUNC(name, nbits)                                             \
+static void interp_##nbits##_##name(const LUT3DContext *lut3d, uint8_t *dstrow,     \
+                                    const uint8_t *srcrow, int w, int copy_alpha)   \
+{                                                                                   \
+    const struct lutcoord *coords = lut3d->coords;                                  \
+    const int step = lut3d->step;                                                   \
+    const uint8_t r = lut3d->rgba_map[R];                                           \
+    const uint8_t g = lut3d->rgba_map[G];                                           \
+    const uint8_t b = lut3d->rgba_map[B];                                           \
+    const uint8_t a = lut3d->rgba_map[A];                                           \
+    uint##nbits##_t *dst = (uint##nbits##_t *)dstrow;                               \
+    const uint##nbits##_t *src = (const uint##nbits##_t *)srcrow;                   \
+    int x;                                                                          \
+                                                                                    \
+    for (x = 0; x < w * step; x += step) {                                          \
+        struct rgbvec vec = interp_##name(lut3d, &coords[src[x + r]],               \
+                                          &coords[src[x + g]], &coords[src[x + b]]);\
+        dst[x + r] = av_clip_uint##nbits(vec.r * (float)((1<<nbits) - 1));          \
+        dst[x + g] = av_clip_uint##nbits(vec.g * (float)((1<<nbits) - 1));          \
+        dst[x + b] = av_clip_uint##nbits(vec.b * (float)((1<<nbits) - 1));          \
+        if (copy_alpha && step == 4)                                                \
+            dst[x + a] = src[x + a];                                                \
+    }                                                                               \
+}
+
+/**
+ * Fill the dense LUT entries of all the inputs with red component r.
+ */
+#define DEFINE_FILL_DENSE_FUNC(name)                                                \
+static void fill_dense_##name(const LUT3DContext *lut3d, uint8_t *dst, int r)       \
+{                                                                                   \
+    const struct lutcoord *coords = lut3d->coords;                                  \
+    int g, b;                                                                       \
+                                                                                    \
+    for (g = 0; g < 256; g++) {                                                     \
+        for (b = 0; b < 256; b++) {                                                 \
+            struct rgbvec vec = interp_##name(lut3d, &coords[r],                    \
+                                              &coords[g], &coords[b]);              \
+            dst[0] = av_clip_uint8(vec.r * 255.f);                                  \
+            dst[1] = av_clip_uint8(vec.g * 255.f);                                  \
+            dst[2] = av_clip_uint8(vec.b * 255.f);                                  \
+            dst += 3;                                                               \
+        }                                                                           \
+    }                                                                               \
 }
 
 DEFINE_INTERP_FUNC(nearest,     8)
@@ -215,6 +249,31 @@ DEFINE_INTERP_FUNC(nearest,     16)
 DEFINE_INTERP_FUNC(trilinear,   16)
 DEFINE_INTERP_FUNC(tetrahedral, 16)
 
+DEFINE_FILL_DENSE_FUNC(nearest)
+DEFINE_FILL_DENSE_FUNC(trilinear)
+DEFINE_FILL_DENSE_FUNC(tetrahedral)
+
+static void interp_8_dense(const LUT3DContext *lut3d, uint8_t *dst,
+                           const uint8_t *src, int w, int copy_alpha)
+{
+    const uint8_t *dense_lut = lut3d->dense_lut;
+    const int step = lut3d->step;
+    const uint8_t r = lut3d->rgba_map[R];
+    const uint8_t g = lut3d->rgba_map[G];
+    const uint8_t b = lut3d->rgba_map[B];
+    const uint8_t a = lut3d->rgba_map[A];
+    int x;
+
+    for (x = 0; x < w * step; x += step) {
+        const uint8_t *vec = dense_lut + 3 * (src[x + r] << 16 | src[x + g] << 8 | src[x + b]);
+        dst[x + r] = vec[0];
+        dst[x + g] = vec[1];
+        dst[x + b] = vec[2];
+        if (copy_alpha && step == 4)
+            dst[x + a] = src[x + a];
+    }
+}
+
 #define MAX_LINE_SIZE 512
 
 static int skip_line(const char *p)
@@ -431,10 +490,30 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
+static int fill_dense(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const LUT3DContext *lut3d = ctx->priv;
+    const int start = (256 *  jobnr   ) / nb_jobs;
+    const int end   = (256 * (jobnr+1)) / nb_jobs;
+    int r;
+
+    for (r = start; r < end; r++) {
+        uint8_t *dst = lut3d->dense_lut + r * 256 * 256 * 3;
+        switch (lut3d->interpolation) {
+        case INTERPOLATE_NEAREST:     fill_dense_nearest    (lut3d, dst, r); break;
+        case INTERPOLATE_TRILINEAR:   fill_dense_trilinear  (lut3d, dst, r); break;
+        case INTERPOLATE_TETRAHEDRAL: fill_dense_tetrahedral(lut3d, dst, r); break;
+        }
+    }
+    return 0;
+}
+
 static int config_input(AVFilterLink *inlink)
 {
-    LUT3DContext *lut3d = inlink->dst->priv;
+    AVFilterContext *ctx = inlink->dst;
+    LUT3DContext *lut3d = ctx->priv;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int ret;
 
     switch (inlink->format) {
     case AV_PIX_FMT_RGB48:
@@ -448,8 +527,8 @@ static int config_input(AVFilterLink *inlink)
     lut3d->step = av_get_padded_bits_per_pixel(desc) >> (3 + lut3d->is16bit);
 
 #define SET_FUNC(name) do {                                     \
-    if (lut3d->is16bit) lut3d->interp_16 = interp_16_##name;    \
-    else                lut3d->interp_8  = interp_8_##name;     \
+    if (lut3d->is16bit) lut3d->interp_row = interp_16_##name;   \
+    else                lut3d->interp_row = interp_8_##name;    \
 } while (0)
 
     switch (lut3d->interpolation) {
@@ -460,44 +539,63 @@ static int config_input(AVFilterLink *inlink)
         av_assert0(0);
     }
 
+    if (ARCH_X86)
+        ff_lut3d_init_x86(lut3d);
+
+    if (lut3d->dense && !lut3d->is16bit) {
+        if ((ret = init_coords(lut3d, 8)) < 0)
+            return ret;
+        av_freep(&lut3d->dense_lut);
+        lut3d->dense_lut = av_malloc(256 * 256 * 256 * 3);
+        if (!lut3d->dense_lut)
+            return AVERROR(ENOMEM);
+        ctx->internal->execute(ctx, fill_dense, NULL, NULL,
+                               FFMIN(256, ctx->graph->nb_threads));
+        lut3d->interp_row = interp_8_dense;
+    }
+
     return 0;
 }
 
-#define FILTER(nbits) do {                                                                          \
-    uint8_t       *dstrow = out->data[0];                                                           \
-    const uint8_t *srcrow = in ->data[0];                                                           \
-                                                                                                    \
-    for (y = 0; y < inlink->h; y++) {                                                               \
-        uint##nbits##_t *dst = (uint##nbits##_t *)dstrow;                                           \
-        const uint##nbits##_t *src = (const uint##nbits##_t *)srcrow;                               \
-        for (x = 0; x < inlink->w * step; x += step) {                                              \
-            struct rgbvec vec = lut3d->interp_##nbits(lut3d, src[x + r], src[x + g], src[x + b]);   \
-            dst[x + r] = av_clip_uint##nbits(vec.r * (float)((1<<nbits) - 1));                      \
-            dst[x + g] = av_clip_uint##nbits(vec.g * (float)((1<<nbits) - 1));                      \
-            dst[x + b] = av_clip_uint##nbits(vec.b * (float)((1<<nbits) - 1));                      \
-            if (!direct && step == 4)                                                               \
-                dst[x + a] = src[x + a];                                                            \
-        }                                                                                           \
-        dstrow += out->linesize[0];                                                                 \
-        srcrow += in ->linesize[0];                                                                 \
-    }                                                                                               \
-} while (0)
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static int interp_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const LUT3DContext *lut3d = ctx->priv;
+    const AVFilterLink *inlink = ctx->inputs[0];
+    const ThreadData *td = arg;
+    const AVFrame *in  = td->in;
+    AVFrame *out = td->out;
+    const int slice_start = (inlink->h *  jobnr   ) / nb_jobs;
+    const int slice_end   = (inlink->h * (jobnr+1)) / nb_jobs;
+    uint8_t       *dstrow = out->data[0] + slice_start * out->linesize[0];
+    const uint8_t *srcrow = in ->data[0] + slice_start * in ->linesize[0];
+    int y;
+
+    for (y = slice_start; y < slice_end; y++) {
+        lut3d->interp_row(lut3d, dstrow, srcrow, inlink->w, in != out);
+        dstrow += out->linesize[0];
+        srcrow += in ->linesize[0];
+    }
+    return 0;
+}
 
 static AVFrame *apply_lut(AVFilterLink *inlink, AVFrame *in)
 {
-    int x, y, direct = 0;
     AVFilterContext *ctx = inlink->dst;
     LUT3DContext *lut3d = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
     AVFrame *out;
-    const int step = lut3d->step;
-    const uint8_t r = lut3d->rgba_map[R];
-    const uint8_t g = lut3d->rgba_map[G];
-    const uint8_t b = lut3d->rgba_map[B];
-    const uint8_t a = lut3d->rgba_map[A];
+    ThreadData td;
+
+    if (init_coords(lut3d, lut3d->is16bit ? 16 : 8) < 0) {
+        av_frame_free(&in);
+        return NULL;
+    }
 
     if (av_frame_is_writable(in)) {
-        direct = 1;
         out = in;
     } else {
         out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
@@ -508,10 +606,12 @@ static AVFrame *apply_lut(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, in);
     }
 
-    if (lut3d->is16bit) FILTER(16);
-    else                FILTER(8);
+    td.in  = in;
+    td.out = out;
+    ctx->internal->execute(ctx, interp_slice, &td, NULL,
+                           FFMIN(outlink->h, ctx->graph->nb_threads));
 
-    if (!direct)
+    if (out != in)
         av_frame_free(&in);
 
     return out;
@@ -529,6 +629,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 #if CONFIG_LUT3D_FILTER
 static const AVOption lut3d_options[] = {
     { "file", "set 3D LUT file name", OFFSET(file), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = FLAGS },
+    { "dense", "precompute the output of all the 8-bit inputs", OFFSET(dense), AV_OPT_TYPE_INT, {.i64=0}, 0, 1, FLAGS },
     COMMON_OPTIONS
 };
 
@@ -585,6 +686,13 @@ end:
     return ret;
 }
 
+static av_cold void lut3d_uninit(AVFilterContext *ctx)
+{
+    LUT3DContext *lut3d = ctx->priv;
+    av_freep(&lut3d->coords);
+    av_freep(&lut3d->dense_lut);
+}
+
 static const AVFilterPad lut3d_inputs[] = {
     {
         .name         = "default",
@@ -608,11 +716,13 @@ AVFilter avfilter_vf_lut3d = {
     .description   = NULL_IF_CONFIG_SMALL("Adjust colors using a 3D LUT."),
     .priv_size     = sizeof(LUT3DContext),
     .init          = lut3d_init,
+    .uninit        = lut3d_uninit,
     .query_formats = query_formats,
     .inputs        = lut3d_inputs,
     .outputs       = lut3d_outputs,
     .priv_class    = &lut3d_class,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
 
@@ -746,6 +856,7 @@ static av_cold void haldclut_uninit(AVFilterContext *ctx)
 {
     LUT3DContext *lut3d = ctx->priv;
     ff_dualinput_uninit(&lut3d->dinput);
+    av_freep(&lut3d->coords);
 }
 
 static const AVOption haldclut_options[] = {
@@ -791,6 +902,7 @@ AVFilter avfilter_vf_haldclut = {
     .inputs        = haldclut_inputs,
     .outputs       = haldclut_outputs,
     .priv_class    = &haldclut_class,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
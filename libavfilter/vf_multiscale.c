@@ -0,0 +1,295 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scale the input video to several sizes in one pass
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+#include "avfilter.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+typedef struct MultiScaleContext {
+    const AVClass *class;
+    char *sizes_str;
+    char *flags_str;
+    int flags;                  ///< sws flags
+    int nb_sizes;
+    int *w, *h;                 ///< output dimensions, one per output
+    struct SwsContext **sws;    ///< scaler of each output
+    int output_is_pal;          ///< set to 1 if the output format is paletted
+
+    /* arguments of sws_scale_multi() for the outputs which are not closed */
+    AVFrame **out;
+    struct SwsContext **active_sws;
+    uint8_t *const **dst;
+    const int **dst_stride;
+} MultiScaleContext;
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    MultiScaleContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int idx = FF_OUTLINK_IDX(outlink);
+    struct SwsContext *sws;
+    int ret;
+
+    outlink->w = s->w[idx];
+    outlink->h = s->h[idx];
+
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){ outlink->h * inlink->w,
+                                                              outlink->w * inlink->h },
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    s->output_is_pal = desc->flags & AV_PIX_FMT_FLAG_PAL ||
+                       desc->flags & AV_PIX_FMT_FLAG_PSEUDOPAL;
+
+    sws_freeContext(s->sws[idx]);
+    s->sws[idx] = sws = sws_alloc_context();
+    if (!sws)
+        return AVERROR(ENOMEM);
+
+    av_opt_set_int(sws, "srcw",       inlink->w,       0);
+    av_opt_set_int(sws, "srch",       inlink->h,       0);
+    av_opt_set_int(sws, "src_format", inlink->format,  0);
+    av_opt_set_int(sws, "dstw",       outlink->w,      0);
+    av_opt_set_int(sws, "dsth",       outlink->h,      0);
+    av_opt_set_int(sws, "dst_format", outlink->format, 0);
+    av_opt_set_int(sws, "sws_flags",  s->flags,        0);
+
+    if ((ret = sws_init_context(sws, NULL, NULL)) < 0)
+        return ret;
+
+    av_log(ctx, AV_LOG_VERBOSE, "output%d w:%d h:%d fmt:%s -> w:%d h:%d flags:0x%0x\n",
+           idx, inlink->w, inlink->h, av_get_pix_fmt_name(inlink->format),
+           outlink->w, outlink->h, s->flags);
+    return 0;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    char *sizes, *size, *saveptr = NULL;
+    int i, ret;
+
+    if (!s->sizes_str || !*s->sizes_str) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->nb_sizes = 1;
+    for (i = 0; s->sizes_str[i]; i++)
+        s->nb_sizes += s->sizes_str[i] == '|';
+
+    s->w          = av_calloc(s->nb_sizes, sizeof(*s->w));
+    s->h          = av_calloc(s->nb_sizes, sizeof(*s->h));
+    s->sws        = av_calloc(s->nb_sizes, sizeof(*s->sws));
+    s->out        = av_calloc(s->nb_sizes, sizeof(*s->out));
+    s->active_sws = av_calloc(s->nb_sizes, sizeof(*s->active_sws));
+    s->dst        = av_calloc(s->nb_sizes, sizeof(*s->dst));
+    s->dst_stride = av_calloc(s->nb_sizes, sizeof(*s->dst_stride));
+    sizes         = av_strdup(s->sizes_str);
+    if (!s->w || !s->h || !s->sws || !s->out || !s->active_sws ||
+        !s->dst || !s->dst_stride || !sizes) {
+        av_free(sizes);
+        return AVERROR(ENOMEM);
+    }
+
+    for (i = 0, size = av_strtok(sizes, "|", &saveptr); size;
+         i++, size = av_strtok(NULL, "|", &saveptr)) {
+        char name[32];
+        AVFilterPad pad = { 0 };
+
+        if ((ret = av_parse_video_size(&s->w[i], &s->h[i], size)) < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", size);
+            av_free(sizes);
+            return ret;
+        }
+
+        snprintf(name, sizeof(name), "output%d", i);
+        pad.type         = AVMEDIA_TYPE_VIDEO;
+        pad.name         = av_strdup(name);
+        pad.config_props = config_output;
+        if (!pad.name) {
+            av_free(sizes);
+            return AVERROR(ENOMEM);
+        }
+
+        ff_insert_outpad(ctx, i, &pad);
+    }
+    s->nb_sizes = i;
+    av_free(sizes);
+
+    if (s->flags_str) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+        if ((ret = av_opt_eval_flags(&class, o, s->flags_str, &s->flags)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    int i;
+
+    for (i = 0; i < ctx->nb_outputs; i++)
+        av_freep(&ctx->output_pads[i].name);
+    for (i = 0; s->sws && i < s->nb_sizes; i++)
+        sws_freeContext(s->sws[i]);
+    av_freep(&s->sws);
+    av_freep(&s->w);
+    av_freep(&s->h);
+    av_freep(&s->out);
+    av_freep(&s->active_sws);
+    av_freep(&s->dst);
+    av_freep(&s->dst_stride);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    AVFilterFormats *formats = NULL;
+    enum AVPixelFormat pix_fmt;
+    int ret;
+
+    /* all the outputs have the format of the input, so that the source lines
+     * are converted the same way for every output */
+    for (pix_fmt = 0; pix_fmt < AV_PIX_FMT_NB; pix_fmt++)
+        if (sws_isSupportedInput(pix_fmt) && sws_isSupportedOutput(pix_fmt) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0) {
+            ff_formats_unref(&formats);
+            return ret;
+        }
+    ff_set_common_formats(ctx, formats);
+
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    MultiScaleContext *s = ctx->priv;
+    AVFrame **out = s->out;
+    const uint8_t *src[4];
+    int i, nb_active = 0, ret = AVERROR_EOF;
+
+    for (i = 0; i < s->nb_sizes; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+
+        if (outlink->closed)
+            continue;
+
+        out[i] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out[i]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        av_frame_copy_props(out[i], in);
+        out[i]->width  = outlink->w;
+        out[i]->height = outlink->h;
+        av_reduce(&out[i]->sample_aspect_ratio.num, &out[i]->sample_aspect_ratio.den,
+                  (int64_t)in->sample_aspect_ratio.num * outlink->h * inlink->w,
+                  (int64_t)in->sample_aspect_ratio.den * outlink->w * inlink->h,
+                  INT_MAX);
+        if (s->output_is_pal)
+            avpriv_set_systematic_pal2((uint32_t *)out[i]->data[1], outlink->format);
+
+        s->active_sws[nb_active] = s->sws[i];
+        s->dst[nb_active]        = out[i]->data;
+        s->dst_stride[nb_active] = out[i]->linesize;
+        nb_active++;
+    }
+
+    if (nb_active) {
+        for (i = 0; i < 4; i++)
+            src[i] = in->data[i];
+        ret = sws_scale_multi(s->active_sws, nb_active, src, in->linesize,
+                              s->dst, s->dst_stride);
+        if (ret < 0)
+            goto end;
+    }
+
+    for (i = 0; i < s->nb_sizes; i++) {
+        if (!out[i])
+            continue;
+        ret = ff_filter_frame(ctx->outputs[i], out[i]);
+        out[i] = NULL;
+        if (ret < 0)
+            break;
+    }
+
+end:
+    for (i = 0; i < s->nb_sizes; i++)
+        av_frame_free(&out[i]);
+    av_frame_free(&in);
+    return ret;
+}
+
+#define OFFSET(x) offsetof(MultiScaleContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption multiscale_options[] = {
+    { "sizes", "set the '|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, { .str = NULL }, .flags = FLAGS },
+    { "flags", "Flags to pass to libswscale", OFFSET(flags_str), AV_OPT_TYPE_STRING, { .str = "bilinear" }, .flags = FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(multiscale);
+
+static const AVFilterPad multiscale_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = filter_frame,
+    },
+    { NULL }
+};
+
+AVFilter avfilter_vf_multiscale = {
+    .name          = "multiscale",
+    .description   = NULL_IF_CONFIG_SMALL("Scale the input video to several sizes in one pass."),
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .priv_size     = sizeof(MultiScaleContext),
+    .priv_class    = &multiscale_class,
+    .inputs        = multiscale_inputs,
+    .outputs       = NULL,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+};
@@ -38,6 +38,7 @@
 #include "dualinput.h"
 #include "drawutils.h"
 #include "video.h"
+#include "vf_overlay.h"
 
 static const char *const var_names[] = {
     "main_w",    "W", ///< width  of the main    video
@@ -96,6 +97,7 @@ typedef struct {
     enum EvalMode { EVAL_MODE_INIT, EVAL_MODE_FRAME, EVAL_MODE_NB } eval_mode;
 
     FFDualInputContext dinput;
+    OverlayDSPContext dsp;
 
     int main_pix_step[4];       ///< steps per pixel for each plane of the main output
     int overlay_pix_step[4];    ///< steps per pixel for each plane of the overlay
@@ -332,125 +334,231 @@ static int config_output(AVFilterLink *outlink)
 // ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)) is a faster version of: 255 * (x + y)
 #define UNPREMULTIPLY_ALPHA(x, y) ((((x) << 16) - ((x) << 9) + (x)) / ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)))
 
-/**
- * Blend image in src to destination buffer dst at position (x, y).
- */
-static void blend_image(AVFilterContext *ctx,
-                        AVFrame *dst, const AVFrame *src,
-                        int x, int y)
+void ff_overlay_blend_row_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int w)
 {
-    OverlayContext *s = ctx->priv;
-    int i, imax, j, jmax, k, kmax;
-    const int src_w = src->width;
-    const int src_h = src->height;
-    const int dst_w = dst->width;
-    const int dst_h = dst->height;
+    int k;
 
-    if (x >= dst_w || x+dst_w  < 0 ||
-        y >= dst_h || y+dst_h < 0)
-        return; /* no intersection */
+    for (k = 0; k < w; k++)
+        dst[k] = FAST_DIV255(dst[k] * (255 - alpha[k]) + src[k] * alpha[k]);
+}
 
-    if (s->main_is_packed_rgb) {
-        uint8_t alpha;          ///< the amount of overlay to blend on to main
-        const int dr = s->main_rgba_map[R];
-        const int dg = s->main_rgba_map[G];
-        const int db = s->main_rgba_map[B];
-        const int da = s->main_rgba_map[A];
-        const int dstep = s->main_pix_step[0];
-        const int sr = s->overlay_rgba_map[R];
-        const int sg = s->overlay_rgba_map[G];
-        const int sb = s->overlay_rgba_map[B];
-        const int sa = s->overlay_rgba_map[A];
-        const int sstep = s->overlay_pix_step[0];
-        const int main_has_alpha = s->main_has_alpha;
-        uint8_t *s, *sp, *d, *dp;
+void ff_overlay_blend_row_sub_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                                ptrdiff_t alpha_linesize, int w)
+{
+    int k;
 
-        i = FFMAX(-y, 0);
-        sp = src->data[0] + i     * src->linesize[0];
-        dp = dst->data[0] + (y+i) * dst->linesize[0];
+    for (k = 0; k < w; k++) {
+        const uint8_t *a = alpha + 2 * k;
+        int alpha_c = (a[0] + a[alpha_linesize] + a[1] + a[alpha_linesize + 1]) >> 2;
+        dst[k] = FAST_DIV255(dst[k] * (255 - alpha_c) + src[k] * alpha_c);
+    }
+}
 
-        for (imax = FFMIN(-y + dst_h, src_h); i < imax; i++) {
-            j = FFMAX(-x, 0);
-            s = sp + j     * sstep;
-            d = dp + (x+j) * dstep;
+void ff_overlay_blend_alpha_row_c(uint8_t *dst, const uint8_t *alpha, int w)
+{
+    int k;
 
-            for (jmax = FFMIN(-x + dst_w, src_w); j < jmax; j++) {
-                alpha = s[sa];
+    // apply alpha compositing: main_alpha += (1-main_alpha) * overlay_alpha
+    for (k = 0; k < w; k++)
+        dst[k] += FAST_DIV255((255 - dst[k]) * alpha[k]);
+}
 
-                // if the main channel has an alpha channel, alpha has to be calculated
-                // to create an un-premultiplied (straight) alpha value
-                if (main_has_alpha && alpha != 0 && alpha != 255) {
-                    uint8_t alpha_d = d[da];
-                    alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);
-                }
+void ff_overlay_blend_packed_row_c(uint8_t *dst, const uint8_t *src, int w, int alpha_pos)
+{
+    int k, c;
+
+    for (k = 0; k < w; k++, dst += 4, src += 4) {
+        int alpha = src[alpha_pos];
+
+        // create an un-premultiplied (straight) alpha value
+        if (alpha != 0 && alpha != 255)
+            alpha = UNPREMULTIPLY_ALPHA(alpha, dst[alpha_pos]);
+        for (c = 0; c < 4; c++)
+            if (c != alpha_pos)
+                dst[c] = FAST_DIV255(dst[c] * (255 - alpha) + src[c] * alpha);
+        dst[alpha_pos] += FAST_DIV255((255 - dst[alpha_pos]) * src[alpha_pos]);
+    }
+}
+
+typedef struct ThreadData {
+    AVFrame *dst;
+    const AVFrame *src;
+    int x, y;
+} ThreadData;
+
+static void blend_packed_rgb(OverlayContext *s, AVFrame *dst, const AVFrame *src,
+                             int x, int y, int i, int imax)
+{
+    uint8_t alpha;          ///< the amount of overlay to blend on to main
+    const int dr = s->main_rgba_map[R];
+    const int dg = s->main_rgba_map[G];
+    const int db = s->main_rgba_map[B];
+    const int da = s->main_rgba_map[A];
+    const int dstep = s->main_pix_step[0];
+    const int sr = s->overlay_rgba_map[R];
+    const int sg = s->overlay_rgba_map[G];
+    const int sb = s->overlay_rgba_map[B];
+    const int sa = s->overlay_rgba_map[A];
+    const int sstep = s->overlay_pix_step[0];
+    const int main_has_alpha = s->main_has_alpha;
+    const int j0   = FFMAX(-x, 0);
+    const int jmax = FFMIN(-x + dst->width, src->width);
+    uint8_t *sp, *dp;
+
+    sp = src->data[0] + i     * src->linesize[0];
+    dp = dst->data[0] + (y+i) * dst->linesize[0];
+
+    /* same component order on both sides: blend whole rows */
+    if (main_has_alpha && dstep == 4 && sstep == 4 &&
+        !memcmp(s->main_rgba_map, s->overlay_rgba_map, sizeof(s->main_rgba_map))) {
+        for (; i < imax; i++) {
+            s->dsp.blend_packed_row(dp + (x+j0) * 4, sp + j0 * 4, jmax - j0, da);
+            dp += dst->linesize[0];
+            sp += src->linesize[0];
+        }
+        return;
+    }
 
+    for (; i < imax; i++) {
+        uint8_t *s = sp + j0     * sstep;
+        uint8_t *d = dp + (x+j0) * dstep;
+        int j;
+
+        for (j = j0; j < jmax; j++) {
+            alpha = s[sa];
+
+            // if the main channel has an alpha channel, alpha has to be calculated
+            // to create an un-premultiplied (straight) alpha value
+            if (main_has_alpha && alpha != 0 && alpha != 255) {
+                uint8_t alpha_d = d[da];
+                alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);
+            }
+
+            switch (alpha) {
+            case 0:
+                break;
+            case 255:
+                d[dr] = s[sr];
+                d[dg] = s[sg];
+                d[db] = s[sb];
+                break;
+            default:
+                // main_value = main_value * (1 - alpha) + overlay_value * alpha
+                // since alpha is in the range 0-255, the result must divided by 255
+                d[dr] = FAST_DIV255(d[dr] * (255 - alpha) + s[sr] * alpha);
+                d[dg] = FAST_DIV255(d[dg] * (255 - alpha) + s[sg] * alpha);
+                d[db] = FAST_DIV255(d[db] * (255 - alpha) + s[sb] * alpha);
+            }
+            if (main_has_alpha) {
                 switch (alpha) {
                 case 0:
                     break;
                 case 255:
-                    d[dr] = s[sr];
-                    d[dg] = s[sg];
-                    d[db] = s[sb];
+                    d[da] = s[sa];
                     break;
                 default:
-                    // main_value = main_value * (1 - alpha) + overlay_value * alpha
-                    // since alpha is in the range 0-255, the result must divided by 255
-                    d[dr] = FAST_DIV255(d[dr] * (255 - alpha) + s[sr] * alpha);
-                    d[dg] = FAST_DIV255(d[dg] * (255 - alpha) + s[sg] * alpha);
-                    d[db] = FAST_DIV255(d[db] * (255 - alpha) + s[sb] * alpha);
+                    // apply alpha compositing: main_alpha += (1-main_alpha) * overlay_alpha
+                    d[da] += FAST_DIV255((255 - d[da]) * s[sa]);
                 }
-                if (main_has_alpha) {
-                    switch (alpha) {
-                    case 0:
-                        break;
-                    case 255:
-                        d[da] = s[sa];
-                        break;
-                    default:
-                        // apply alpha compositing: main_alpha += (1-main_alpha) * overlay_alpha
-                        d[da] += FAST_DIV255((255 - d[da]) * s[sa]);
-                    }
-                }
-                d += dstep;
-                s += sstep;
             }
-            dp += dst->linesize[0];
-            sp += src->linesize[0];
+            d += dstep;
+            s += sstep;
+        }
+        dp += dst->linesize[0];
+        sp += src->linesize[0];
+    }
+}
+
+/**
+ * Blend pixels k to kmax-1 of the row j of a plane, averaging the alpha of
+ * subsampled planes with whatever neighbours are available.
+ */
+static void blend_plane_pixels(uint8_t *d, const uint8_t *s, const uint8_t *a,
+                               int k, int kmax, int j, int hsub, int vsub,
+                               int src_wp, int src_hp, int alinesize,
+                               int main_has_alpha)
+{
+    for (; k < kmax; k++) {
+        int alpha_v, alpha_h, alpha;
+
+        // average alpha for color components, improve quality
+        if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {
+            alpha = (a[0] + a[alinesize] +
+                     a[1] + a[alinesize+1]) >> 2;
+        } else if (hsub || vsub) {
+            alpha_h = hsub && k+1 < src_wp ?
+                (a[0] + a[1]) >> 1 : a[0];
+            alpha_v = vsub && j+1 < src_hp ?
+                (a[0] + a[alinesize]) >> 1 : a[0];
+            alpha = (alpha_v + alpha_h) >> 1;
+        } else
+            alpha = a[0];
+        // if the main channel has an alpha channel, alpha has to be calculated
+        // to create an un-premultiplied (straight) alpha value
+        if (main_has_alpha && alpha != 0 && alpha != 255) {
+            // average alpha for color components, improve quality
+            uint8_t alpha_d;
+            if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {
+                alpha_d = (d[0] + d[alinesize] +
+                           d[1] + d[alinesize+1]) >> 2;
+            } else if (hsub || vsub) {
+                alpha_h = hsub && k+1 < src_wp ?
+                    (d[0] + d[1]) >> 1 : d[0];
+                alpha_v = vsub && j+1 < src_hp ?
+                    (d[0] + d[alinesize]) >> 1 : d[0];
+                alpha_d = (alpha_v + alpha_h) >> 1;
+            } else
+                alpha_d = d[0];
+            alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);
         }
+        *d = FAST_DIV255(*d * (255 - alpha) + *s * alpha);
+        s++;
+        d++;
+        a += 1 << hsub;
+    }
+}
+
+/**
+ * Blend the rows of the part of image in src overlapping dst at position
+ * (x, y) that belong to this job.
+ */
+static int blend_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OverlayContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *dst = td->dst;
+    const AVFrame *src = td->src;
+    const int x = td->x, y = td->y;
+    int i, imax, j, jmax, k, kmax, start;
+    const int src_w = src->width;
+    const int src_h = src->height;
+    const int dst_w = dst->width;
+    const int dst_h = dst->height;
+
+#define SLICE_START(start, end) ((start) + ((end) - (start)) *  jobnr      / nb_jobs)
+#define SLICE_END(start, end)   ((start) + ((end) - (start)) * (jobnr + 1) / nb_jobs)
+
+    if (s->main_is_packed_rgb) {
+        start = FFMAX(-y, 0);
+        imax  = FFMIN(-y + dst_h, src_h);
+        blend_packed_rgb(s, dst, src, x, y,
+                         SLICE_START(start, imax), SLICE_END(start, imax));
     } else {
         const int main_has_alpha = s->main_has_alpha;
         if (main_has_alpha) {
-            uint8_t alpha;          ///< the amount of overlay to blend on to main
-            uint8_t *s, *sa, *d, *da;
-
-            i = FFMAX(-y, 0);
+            uint8_t *sa, *da;
+
+            start = FFMAX(-y, 0);
+            imax  = FFMIN(-y + dst_h, src_h);
+            i     = SLICE_START(start, imax);
+            imax  = SLICE_END(start, imax);
+            j     = FFMAX(-x, 0);
+            jmax  = FFMIN(-x + dst_w, src_w);
             sa = src->data[3] + i     * src->linesize[3];
             da = dst->data[3] + (y+i) * dst->linesize[3];
 
-            for (imax = FFMIN(-y + dst_h, src_h); i < imax; i++) {
-                j = FFMAX(-x, 0);
-                s = sa + j;
-                d = da + x+j;
-
-                for (jmax = FFMIN(-x + dst_w, src_w); j < jmax; j++) {
-                    alpha = *s;
-                    if (alpha != 0 && alpha != 255) {
-                        uint8_t alpha_d = *d;
-                        alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);
-                    }
-                    switch (alpha) {
-                    case 0:
-                        break;
-                    case 255:
-                        *d = *s;
-                        break;
-                    default:
-                        // apply alpha compositing: main_alpha += (1-main_alpha) * overlay_alpha
-                        *d += FAST_DIV255((255 - *d) * *s);
-                    }
-                    d += 1;
-                    s += 1;
-                }
+            for (; i < imax; i++) {
+                s->dsp.blend_alpha_row(da + x+j, sa + j, jmax - j);
                 da += dst->linesize[3];
                 sa += src->linesize[3];
             }
@@ -464,56 +572,40 @@ static void blend_image(AVFilterContext *ctx,
             int dst_hp = FF_CEIL_RSHIFT(dst_h, vsub);
             int yp = y>>vsub;
             int xp = x>>hsub;
-            uint8_t *s, *sp, *d, *dp, *a, *ap;
+            uint8_t *s_, *sp, *d, *dp, *a, *ap;
 
-            j = FFMAX(-yp, 0);
+            start = FFMAX(-yp, 0);
+            jmax  = FFMIN(-yp + dst_hp, src_hp);
+            j     = SLICE_START(start, jmax);
+            jmax  = SLICE_END(start, jmax);
             sp = src->data[i] + j         * src->linesize[i];
             dp = dst->data[i] + (yp+j)    * dst->linesize[i];
             ap = src->data[3] + (j<<vsub) * src->linesize[3];
 
-            for (jmax = FFMIN(-yp + dst_hp, src_hp); j < jmax; j++) {
+            for (; j < jmax; j++) {
                 k = FFMAX(-xp, 0);
                 d = dp + xp+k;
-                s = sp + k;
+                s_ = sp + k;
                 a = ap + (k<<hsub);
-
-                for (kmax = FFMIN(-xp + dst_wp, src_wp); k < kmax; k++) {
-                    int alpha_v, alpha_h, alpha;
-
-                    // average alpha for color components, improve quality
-                    if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {
-                        alpha = (a[0] + a[src->linesize[3]] +
-                                 a[1] + a[src->linesize[3]+1]) >> 2;
-                    } else if (hsub || vsub) {
-                        alpha_h = hsub && k+1 < src_wp ?
-                            (a[0] + a[1]) >> 1 : a[0];
-                        alpha_v = vsub && j+1 < src_hp ?
-                            (a[0] + a[src->linesize[3]]) >> 1 : a[0];
-                        alpha = (alpha_v + alpha_h) >> 1;
-                    } else
-                        alpha = a[0];
-                    // if the main channel has an alpha channel, alpha has to be calculated
-                    // to create an un-premultiplied (straight) alpha value
-                    if (main_has_alpha && alpha != 0 && alpha != 255) {
-                        // average alpha for color components, improve quality
-                        uint8_t alpha_d;
-                        if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {
-                            alpha_d = (d[0] + d[src->linesize[3]] +
-                                       d[1] + d[src->linesize[3]+1]) >> 2;
-                        } else if (hsub || vsub) {
-                            alpha_h = hsub && k+1 < src_wp ?
-                                (d[0] + d[1]) >> 1 : d[0];
-                            alpha_v = vsub && j+1 < src_hp ?
-                                (d[0] + d[src->linesize[3]]) >> 1 : d[0];
-                            alpha_d = (alpha_v + alpha_h) >> 1;
-                        } else
-                            alpha_d = d[0];
-                        alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);
+                kmax = FFMIN(-xp + dst_wp, src_wp);
+
+                if (!main_has_alpha && !hsub && !vsub) {
+                    s->dsp.blend_row(d, s_, a, kmax - k);
+                } else {
+                    if (!main_has_alpha && hsub && vsub && j+1 < src_hp) {
+                        /* the last column has no right neighbour */
+                        int kfull = FFMIN(kmax, src_wp - 1);
+                        if (kfull > k) {
+                            s->dsp.blend_row_sub(d, s_, a, src->linesize[3], kfull - k);
+                            d  += kfull - k;
+                            s_ += kfull - k;
+                            a  += (kfull - k) << hsub;
+                            k   = kfull;
+                        }
                     }
-                    *d = FAST_DIV255(*d * (255 - alpha) + *s * alpha);
-                    s++;
-                    d++;
-                    a += 1 << hsub;
+                    blend_plane_pixels(d, s_, a, k, kmax, j, hsub, vsub,
+                                       src_wp, src_hp, src->linesize[3],
+                                       main_has_alpha);
                 }
                 dp += dst->linesize[i];
                 sp += src->linesize[i];
@@ -521,6 +613,33 @@ static void blend_image(AVFilterContext *ctx,
             }
         }
     }
+    return 0;
+}
+
+/**
+ * Blend image in src to destination buffer dst at position (x, y).
+ */
+static void blend_image(AVFilterContext *ctx,
+                        AVFrame *dst, const AVFrame *src,
+                        int x, int y)
+{
+    OverlayContext *s = ctx->priv;
+    ThreadData td = { .dst = dst, .src = src, .x = x, .y = y };
+    int nb_rows;
+
+    if (x >= dst->width || x+dst->width  < 0 ||
+        y >= dst->height || y+dst->height < 0)
+        return; /* no intersection */
+
+    nb_rows = FFMIN(-y + dst->height, src->height) - FFMAX(-y, 0);
+    if (nb_rows <= 0)
+        return;
+    /* the straight alpha of the color planes of a yuva main is computed from
+     * main pixels on the following rows, which must not be blended yet */
+    if (!s->main_is_packed_rgb && s->main_has_alpha)
+        nb_rows = 1;
+    ctx->internal->execute(ctx, blend_slice, &td, NULL,
+                           FFMIN(nb_rows, ctx->graph->nb_threads));
 }
 
 static AVFrame *do_blend(AVFilterContext *ctx, AVFrame *mainpic,
@@ -571,6 +690,13 @@ static av_cold int init(AVFilterContext *ctx)
         s->format = OVERLAY_FORMAT_RGB;
     }
     s->dinput.process = do_blend;
+
+    s->dsp.blend_row        = ff_overlay_blend_row_c;
+    s->dsp.blend_row_sub    = ff_overlay_blend_row_sub_c;
+    s->dsp.blend_alpha_row  = ff_overlay_blend_alpha_row_c;
+    s->dsp.blend_packed_row = ff_overlay_blend_packed_row_c;
+    if (ARCH_X86)
+        ff_overlay_init_x86(&s->dsp);
     return 0;
 }
 
@@ -633,5 +759,6 @@ AVFilter avfilter_vf_overlay = {
     .process_command = process_command,
     .inputs        = avfilter_vf_overlay_inputs,
     .outputs       = avfilter_vf_overlay_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
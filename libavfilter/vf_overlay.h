@@ -0,0 +1,58 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_OVERLAY_H
+#define AVFILTER_OVERLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Blending functions for one row of pixels.
+typedef struct OverlayDSPContext {
+    /**
+     * Blend a row of a plane with the overlay alpha of the same size:
+     * dst = (dst * (255 - alpha) + src * alpha) / 255
+     */
+    void (*blend_row)(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int w);
+    /**
+     * Same as blend_row for a plane subsampled 2x2 relative to the alpha
+     * plane, the alpha of each pixel is the average of the 2x2 alpha block.
+     */
+    void (*blend_row_sub)(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                          ptrdiff_t alpha_linesize, int w);
+    /**
+     * Composite a row of the overlay alpha onto the main alpha plane:
+     * dst += (255 - dst) * alpha / 255
+     */
+    void (*blend_alpha_row)(uint8_t *dst, const uint8_t *alpha, int w);
+    /**
+     * Blend a row of packed 32-bit pixels with alpha onto main pixels with
+     * the same component order, alpha_pos is the byte offset of alpha.
+     */
+    void (*blend_packed_row)(uint8_t *dst, const uint8_t *src, int w, int alpha_pos);
+} OverlayDSPContext;
+
+void ff_overlay_init_x86(OverlayDSPContext *dsp);
+
+void ff_overlay_blend_row_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int w);
+void ff_overlay_blend_row_sub_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                                ptrdiff_t alpha_linesize, int w);
+void ff_overlay_blend_alpha_row_c(uint8_t *dst, const uint8_t *alpha, int w);
+void ff_overlay_blend_packed_row_c(uint8_t *dst, const uint8_t *src, int w, int alpha_pos);
+
+#endif /* AVFILTER_OVERLAY_H */
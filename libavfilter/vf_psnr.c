@@ -32,6 +32,7 @@
 #include "drawutils.h"
 #include "formats.h"
 #include "internal.h"
+#include "psnr.h"
 #include "video.h"
 
 typedef struct PSNRContext {
@@ -48,11 +49,8 @@ typedef struct PSNRContext {
     int nb_components;
     int planewidth[4];
     int planeheight[4];
-
-    void (*compute_mse)(struct PSNRContext *s,
-                        const uint8_t *m[4], const int ml[4],
-                        const uint8_t *r[4], const int rl[4],
-                        int w, int h, double mse[4]);
+    uint64_t (*score)[4];           ///< sums of squared differences of each job
+    PSNRDSPContext dsp;
 } PSNRContext;
 
 #define OFFSET(x) offsetof(PSNRContext, x)
@@ -76,60 +74,60 @@ static inline double get_psnr(double mse, uint64_t nb_frames, int max)
     return 10.0 * log(pow2(max) / (mse / nb_frames)) / log(10.0);
 }
 
-static inline
-void compute_images_mse(PSNRContext *s,
-                        const uint8_t *main_data[4], const int main_linesizes[4],
-                        const uint8_t *ref_data[4], const int ref_linesizes[4],
-                        int w, int h, double mse[4])
+static uint64_t sse_line_8bit(const uint8_t *main_line, const uint8_t *ref_line, int outw)
 {
-    int i, c, j;
+    int j;
+    unsigned m2 = 0;
 
-    for (c = 0; c < s->nb_components; c++) {
-        const int outw = s->planewidth[c];
-        const int outh = s->planeheight[c];
-        const uint8_t *main_line = main_data[c];
-        const uint8_t *ref_line = ref_data[c];
-        const int ref_linesize = ref_linesizes[c];
-        const int main_linesize = main_linesizes[c];
-        uint64_t m = 0;
+    for (j = 0; j < outw; j++)
+        m2 += pow2(main_line[j] - ref_line[j]);
 
-        for (i = 0; i < outh; i++) {
-            int m2 = 0;
-            for (j = 0; j < outw; j++)
-                m2 += pow2(main_line[j] - ref_line[j]);
-            m += m2;
-            ref_line += ref_linesize;
-            main_line += main_linesize;
-        }
-        mse[c] = m / (double)(outw * outh);
-    }
+    return m2;
 }
 
-static inline
-void compute_images_mse_16bit(PSNRContext *s,
-                        const uint8_t *main_data[4], const int main_linesizes[4],
-                        const uint8_t *ref_data[4], const int ref_linesizes[4],
-                        int w, int h, double mse[4])
+static uint64_t sse_line_16bit(const uint8_t *_main_line, const uint8_t *_ref_line, int outw)
 {
-    int i, c, j;
+    int j;
+    uint64_t m2 = 0;
+    const uint16_t *main_line = (const uint16_t *)_main_line;
+    const uint16_t *ref_line = (const uint16_t *)_ref_line;
+
+    for (j = 0; j < outw; j++)
+        m2 += pow2(main_line[j] - ref_line[j]);
+
+    return m2;
+}
+
+typedef struct ThreadData {
+    const AVFrame *main, *ref;
+} ThreadData;
+
+static int compute_images_mse(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PSNRContext *s = ctx->priv;
+    ThreadData *td = arg;
+    int i, c;
 
     for (c = 0; c < s->nb_components; c++) {
         const int outw = s->planewidth[c];
         const int outh = s->planeheight[c];
-        const uint16_t *main_line = (uint16_t *)main_data[c];
-        const uint16_t *ref_line = (uint16_t *)ref_data[c];
-        const int ref_linesize = ref_linesizes[c] / 2;
-        const int main_linesize = main_linesizes[c] / 2;
+        const int slice_start = (outh *  jobnr   ) / nb_jobs;
+        const int slice_end   = (outh * (jobnr+1)) / nb_jobs;
+        const int ref_linesize = td->ref->linesize[c];
+        const int main_linesize = td->main->linesize[c];
+        const uint8_t *main_line = td->main->data[c] + main_linesize * slice_start;
+        const uint8_t *ref_line = td->ref->data[c] + ref_linesize * slice_start;
         uint64_t m = 0;
 
-        for (i = 0; i < outh; i++) {
-            for (j = 0; j < outw; j++)
-                m += pow2(main_line[j] - ref_line[j]);
+        for (i = slice_start; i < slice_end; i++) {
+            m += s->dsp.sse_line(main_line, ref_line, outw);
             ref_line += ref_linesize;
             main_line += main_linesize;
         }
-        mse[c] = m / (double)(outw * outh);
+        s->score[jobnr][c] = m;
     }
+
+    return 0;
 }
 
 static void set_meta(AVDictionary **metadata, const char *key, char comp, float d)
@@ -150,12 +148,22 @@ static AVFrame *do_psnr(AVFilterContext *ctx, AVFrame *main,
 {
     PSNRContext *s = ctx->priv;
     double comp_mse[4], mse = 0;
-    int j, c;
+    int i, j, c, nb_jobs;
     AVDictionary **metadata = avpriv_frame_get_metadatap(main);
+    ThreadData td;
 
-    s->compute_mse(s, (const uint8_t **)main->data, main->linesize,
-                      (const uint8_t **)ref->data, ref->linesize,
-                       main->width, main->height, comp_mse);
+    td.main = main;
+    td.ref  = ref;
+    nb_jobs = FFMIN(s->planeheight[1], ctx->graph->nb_threads);
+    ctx->internal->execute(ctx, compute_images_mse, &td, NULL, nb_jobs);
+
+    for (j = 0; j < s->nb_components; j++) {
+        uint64_t m = 0;
+
+        for (i = 0; i < nb_jobs; i++)
+            m += s->score[i][j];
+        comp_mse[j] = m / (double)(s->planewidth[j] * s->planeheight[j]);
+    }
 
     for (j = 0; j < s->nb_components; j++)
         mse += comp_mse[j];
@@ -297,7 +305,14 @@ static int config_input_ref(AVFilterLink *inlink)
     s->planewidth[1]  = s->planewidth[2]  = FF_CEIL_RSHIFT(inlink->w, desc->log2_chroma_w);
     s->planewidth[0]  = s->planewidth[3]  = inlink->w;
 
-    s->compute_mse = desc->comp[0].depth_minus1 > 7 ? compute_images_mse_16bit : compute_images_mse;
+    s->dsp.sse_line = desc->comp[0].depth_minus1 > 7 ? sse_line_16bit : sse_line_8bit;
+    if (ARCH_X86)
+        ff_psnr_init_x86(&s->dsp, desc->comp[0].depth_minus1 + 1);
+
+    av_freep(&s->score);
+    s->score = av_calloc(FFMAX(1, ctx->graph->nb_threads), sizeof(*s->score));
+    if (!s->score)
+        return AVERROR(ENOMEM);
 
     return 0;
 }
@@ -345,6 +360,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     ff_dualinput_uninit(&s->dinput);
 
+    av_freep(&s->score);
+
     if (s->stats_file)
         fclose(s->stats_file);
 }
@@ -383,4 +400,5 @@ AVFilter avfilter_vf_psnr = {
     .priv_class    = &psnr_class,
     .inputs        = psnr_inputs,
     .outputs       = psnr_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -329,6 +329,8 @@ static int config_props(AVFilterLink *outlink)
             if (!*s)
                 return AVERROR(ENOMEM);
 
+            av_opt_set_int(*s, "threads", ctx->graph->nb_threads, 0);
+
             if (scale->opts) {
                 AVDictionaryEntry *e = NULL;
 
@@ -379,13 +381,28 @@ fail:
     return ret;
 }
 
+typedef struct ThreadData {
+    struct SwsContext *sws;
+    const uint8_t **in;
+    uint8_t **out;
+    int *in_stride, *out_stride;
+} ThreadData;
+
+static int scale_band(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+
+    return sws_scale_band(td->sws, td->in, td->in_stride,
+                          td->out, td->out_stride, jobnr);
+}
+
 static int scale_slice(AVFilterLink *link, AVFrame *out_buf, AVFrame *cur_pic, struct SwsContext *sws, int y, int h, int mul, int field)
 {
     ScaleContext *scale = link->dst->priv;
     const uint8_t *in[4];
     uint8_t *out[4];
     int in_stride[4],out_stride[4];
-    int i;
+    int i, nb_bands = sws_get_band_count(sws);
 
     for(i=0; i<4; i++){
         int vsub= ((i+1)&2) ? scale->vsub : 0;
@@ -399,6 +416,12 @@ static int scale_slice(AVFilterLink *link, AVFrame *out_buf, AVFrame *cur_pic, s
     if(scale->output_is_pal)
         out[1] = out_buf->data[1];
 
+    if (nb_bands > 1 && !y) {
+        ThreadData td = { sws, in, out, in_stride, out_stride };
+        return link->dst->internal->execute(link->dst, scale_band, &td,
+                                            NULL, nb_bands);
+    }
+
     return sws_scale(sws, in, in_stride, y/mul, h,
                          out,out_stride);
 }
@@ -577,4 +600,5 @@ AVFilter avfilter_vf_scale = {
     .priv_class    = &scale_class,
     .inputs        = avfilter_vf_scale_inputs,
     .outputs       = avfilter_vf_scale_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -48,64 +48,101 @@
 #include "unsharp.h"
 #include "unsharp_opencl.h"
 
-static void apply_unsharp(      uint8_t *dst, int dst_stride,
-                          const uint8_t *src, int src_stride,
-                          int width, int height, UnsharpFilterParam *fp)
+/*
+ * The blur is separable: each row is blurred horizontally by 2 * steps_x
+ * passes adding neighbour pairs, then the blurred rows go through the
+ * 2 * steps_y stages of the vertical state machine.
+ */
+
+void ff_unsharp_blur_line_h_c(uint32_t *sr, int width)
 {
-    uint32_t **sc = fp->sc;
-    uint32_t sr[MAX_MATRIX_SIZE - 1], tmp1, tmp2;
+    int x;
 
-    int32_t res;
-    int x, y, z;
-    const uint8_t *src2 = NULL;  //silence a warning
-    const int amount = fp->amount;
+    for (x = 0; x < width; x++)
+        sr[x] += sr[x + 1];
+}
+
+void ff_unsharp_blur_lines_v_c(uint32_t *sr, uint32_t *sc, ptrdiff_t sc_stride,
+                               int nb_lines, int width)
+{
+    int x, z;
+
+    for (z = 0; z < nb_lines; z++, sc += sc_stride) {
+        for (x = 0; x < width; x++) {
+            uint32_t tmp = sr[x];
+            sr[x] += sc[x];
+            sc[x]  = tmp;
+        }
+    }
+}
+
+void ff_unsharp_line_c(uint8_t *dst, const uint8_t *src, const uint32_t *sr,
+                       int width, int32_t halfscale, int scalebits, int amount)
+{
+    int x;
+
+    for (x = 0; x < width; x++) {
+        int32_t res = (int32_t)src[x] + ((((int32_t)src[x] - (int32_t)((sr[x] + halfscale) >> scalebits)) * amount) >> 16);
+        dst[x] = av_clip_uint8(res);
+    }
+}
+
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static void apply_unsharp(UnsharpContext *unsharp,
+                                uint8_t *dst, int dst_stride,
+                          const uint8_t *src, int src_stride,
+                          int width, int height, UnsharpFilterParam *fp,
+                          int jobnr, int nb_jobs)
+{
     const int steps_x = fp->steps_x;
     const int steps_y = fp->steps_y;
-    const int scalebits = fp->scalebits;
-    const int32_t halfscale = fp->halfscale;
+    const int slice_start = (height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+    uint32_t *sr = fp->sr + jobnr * fp->sr_stride;
+    uint32_t *sc = fp->sc + jobnr * fp->sr_stride * 2 * steps_y;
+    int x, y, z;
 
-    if (!amount) {
-        av_image_copy_plane(dst, dst_stride, src, src_stride, width, height);
+    if (!fp->amount) {
+        av_image_copy_plane(dst + slice_start * dst_stride, dst_stride,
+                            src + slice_start * src_stride, src_stride,
+                            width, slice_end - slice_start);
         return;
     }
+    if (slice_start == slice_end)
+        return;
 
-    for (y = 0; y < 2 * steps_y; y++)
-        memset(sc[y], 0, sizeof(sc[y][0]) * (width + 2 * steps_x));
-
-    for (y = -steps_y; y < height + steps_y; y++) {
-        if (y < height)
-            src2 = src;
-
-        memset(sr, 0, sizeof(sr[0]) * (2 * steps_x - 1));
-        for (x = -steps_x; x < width + steps_x; x++) {
-            tmp1 = x <= 0 ? src2[0] : x >= width ? src2[width-1] : src2[x];
-            for (z = 0; z < steps_x * 2; z += 2) {
-                tmp2 = sr[z + 0] + tmp1; sr[z + 0] = tmp1;
-                tmp1 = sr[z + 1] + tmp2; sr[z + 1] = tmp2;
-            }
-            for (z = 0; z < steps_y * 2; z += 2) {
-                tmp2 = sc[z + 0][x + steps_x] + tmp1; sc[z + 0][x + steps_x] = tmp1;
-                tmp1 = sc[z + 1][x + steps_x] + tmp2; sc[z + 1][x + steps_x] = tmp2;
-            }
-            if (x >= steps_x && y >= steps_y) {
-                const uint8_t *srx = src - steps_y * src_stride + x - steps_x;
-                uint8_t *dsx       = dst - steps_y * dst_stride + x - steps_x;
-
-                res = (int32_t)*srx + ((((int32_t) * srx - (int32_t)((tmp1 + halfscale) >> scalebits)) * amount) >> 16);
-                *dsx = av_clip_uint8(res);
-            }
-        }
-        if (y >= 0) {
-            dst += dst_stride;
-            src += src_stride;
+    memset(sc, 0, sizeof(*sc) * fp->sr_stride * 2 * steps_y);
+
+    /* the rows above and below the slice only feed the state machine */
+    for (y = slice_start - steps_y; y < slice_end + steps_y; y++) {
+        const uint8_t *src2 = src + av_clip(y, 0, height - 1) * src_stride;
+
+        for (x = 0; x < steps_x; x++) {
+            sr[x]                   = src2[0];
+            sr[x + width + steps_x] = src2[width - 1];
         }
+        for (x = 0; x < width; x++)
+            sr[x + steps_x] = src2[x];
+        for (z = 0; z < 2 * steps_x; z++)
+            unsharp->blur_line_h(sr, width + 2 * steps_x - 1 - z);
+        unsharp->blur_lines_v(sr, sc, fp->sr_stride, 2 * steps_y, width);
+
+        if (y >= slice_start + steps_y)
+            unsharp->unsharp_line(dst + (y - steps_y) * dst_stride,
+                                  src + (y - steps_y) * src_stride, sr, width,
+                                  fp->halfscale, fp->scalebits, fp->amount);
     }
 }
 
-static int apply_unsharp_c(AVFilterContext *ctx, AVFrame *in, AVFrame *out)
+static int unsharp_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     AVFilterLink *inlink = ctx->inputs[0];
     UnsharpContext *unsharp = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in, *out = td->out;
     int i, plane_w[3], plane_h[3];
     UnsharpFilterParam *fp[3];
     plane_w[0] = inlink->w;
@@ -115,11 +152,24 @@ static int apply_unsharp_c(AVFilterContext *ctx, AVFrame *in, AVFrame *out)
     fp[0] = &unsharp->luma;
     fp[1] = fp[2] = &unsharp->chroma;
     for (i = 0; i < 3; i++) {
-        apply_unsharp(out->data[i], out->linesize[i], in->data[i], in->linesize[i], plane_w[i], plane_h[i], fp[i]);
+        apply_unsharp(unsharp, out->data[i], out->linesize[i], in->data[i], in->linesize[i],
+                      plane_w[i], plane_h[i], fp[i], jobnr, nb_jobs);
     }
     return 0;
 }
 
+static int apply_unsharp_c(AVFilterContext *ctx, AVFrame *in, AVFrame *out)
+{
+    UnsharpContext *unsharp = ctx->priv;
+    ThreadData td;
+
+    td.in  = in;
+    td.out = out;
+    ctx->internal->execute(ctx, unsharp_slice, &td, NULL,
+                           FFMIN(FF_CEIL_RSHIFT(in->height, unsharp->vsub), unsharp->nb_threads));
+    return 0;
+}
+
 static void set_filter_param(UnsharpFilterParam *fp, int msize_x, int msize_y, float amount)
 {
     fp->msize_x = msize_x;
@@ -142,6 +192,11 @@ static av_cold int init(AVFilterContext *ctx)
     set_filter_param(&unsharp->chroma, unsharp->cmsize_x, unsharp->cmsize_y, unsharp->camount);
 
     unsharp->apply_unsharp = apply_unsharp_c;
+    unsharp->blur_line_h   = ff_unsharp_blur_line_h_c;
+    unsharp->blur_lines_v  = ff_unsharp_blur_lines_v_c;
+    unsharp->unsharp_line  = ff_unsharp_line_c;
+    if (ARCH_X86)
+        ff_unsharp_init_x86(unsharp);
     if (!CONFIG_OPENCL && unsharp->opencl) {
         av_log(ctx, AV_LOG_ERROR, "OpenCL support was not enabled in this build, cannot be selected\n");
         return AVERROR(EINVAL);
@@ -168,9 +223,15 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
+static void free_filter_param(UnsharpFilterParam *fp)
+{
+    av_freep(&fp->sr);
+    av_freep(&fp->sc);
+}
+
 static int init_filter_param(AVFilterContext *ctx, UnsharpFilterParam *fp, const char *effect_type, int width)
 {
-    int z;
+    UnsharpContext *unsharp = ctx->priv;
     const char *effect = fp->amount == 0 ? "none" : fp->amount < 0 ? "blur" : "sharpen";
 
     if  (!(fp->msize_x & fp->msize_y & 1)) {
@@ -183,9 +244,12 @@ static int init_filter_param(AVFilterContext *ctx, UnsharpFilterParam *fp, const
     av_log(ctx, AV_LOG_VERBOSE, "effect:%s type:%s msize_x:%d msize_y:%d amount:%0.2f\n",
            effect, effect_type, fp->msize_x, fp->msize_y, fp->amount / 65535.0);
 
-    for (z = 0; z < 2 * fp->steps_y; z++)
-        if (!(fp->sc[z] = av_malloc(sizeof(*(fp->sc[z])) * (width + 2 * fp->steps_x))))
-            return AVERROR(ENOMEM);
+    free_filter_param(fp);
+    fp->sr_stride = width + 2 * fp->steps_x;
+    fp->sr = av_malloc_array(unsharp->nb_threads, sizeof(*fp->sr) * fp->sr_stride);
+    fp->sc = av_malloc_array(unsharp->nb_threads, sizeof(*fp->sc) * fp->sr_stride * 2 * fp->steps_y);
+    if (!fp->sr || !fp->sc)
+        return AVERROR(ENOMEM);
 
     return 0;
 }
@@ -198,6 +262,7 @@ static int config_props(AVFilterLink *link)
 
     unsharp->hsub = desc->log2_chroma_w;
     unsharp->vsub = desc->log2_chroma_h;
+    unsharp->nb_threads = FFMAX(1, link->dst->graph->nb_threads);
 
     ret = init_filter_param(link->dst, &unsharp->luma,   "luma",   link->w);
     if (ret < 0)
@@ -209,14 +274,6 @@ static int config_props(AVFilterLink *link)
     return 0;
 }
 
-static void free_filter_param(UnsharpFilterParam *fp)
-{
-    int z;
-
-    for (z = 0; z < 2 * fp->steps_y; z++)
-        av_free(fp->sc[z]);
-}
-
 static av_cold void uninit(AVFilterContext *ctx)
 {
     UnsharpContext *unsharp = ctx->priv;
@@ -308,5 +365,6 @@ AVFilter avfilter_vf_unsharp = {
     .query_formats = query_formats,
     .inputs        = avfilter_vf_unsharp_inputs,
     .outputs       = avfilter_vf_unsharp_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -29,6 +29,7 @@
 #include "libavutil/mem.h"
 
 #include "avfilter.h"
+#include "framepool.h"
 #include "internal.h"
 #include "video.h"
 
@@ -37,26 +38,34 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
     return ff_get_video_buffer(link->dst->outputs[0], w, h);
 }
 
-/* TODO: set the buffer's priv member to a context structure for the whole
- * filter chain.  This will allow for a buffer pool instead of the constant
- * alloc & free cycle currently implemented. */
+#define BUFFER_ALIGN 32
+
 AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
 {
-    AVFrame *frame = av_frame_alloc();
-    int ret;
-
-    if (!frame)
-        return NULL;
-
-    frame->width  = w;
-    frame->height = h;
-    frame->format = link->format;
-
-    ret = av_frame_get_buffer(frame, 32);
-    if (ret < 0)
-        av_frame_free(&frame);
-
-    return frame;
+    int pool_width  = 0;
+    int pool_height = 0;
+    int pool_align  = 0;
+    enum AVPixelFormat pool_format = AV_PIX_FMT_NONE;
+
+    if (link->video_frame_pool) {
+        ff_video_frame_pool_get_config(link->video_frame_pool,
+                                       &pool_width, &pool_height,
+                                       &pool_format, &pool_align);
+
+        if (pool_width != w || pool_height != h ||
+            pool_format != link->format || pool_align != BUFFER_ALIGN)
+            ff_video_frame_pool_uninit((FFVideoFramePool **)&link->video_frame_pool);
+    }
+
+    if (!link->video_frame_pool) {
+        link->video_frame_pool = ff_video_frame_pool_init(av_buffer_alloc, w, h,
+                                                          link->format,
+                                                          BUFFER_ALIGN);
+        if (!link->video_frame_pool)
+            return NULL;
+    }
+
+    return ff_video_frame_pool_get(link->video_frame_pool);
 }
 
 #if FF_API_AVFILTERBUFFER
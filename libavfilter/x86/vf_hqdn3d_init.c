@@ -22,6 +22,9 @@
 #include <stdint.h>
 
 #include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
 #include "libavfilter/vf_hqdn3d.h"
 #include "config.h"
 
@@ -30,6 +33,236 @@ void ff_hqdn3d_row_9_x86(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_
 void ff_hqdn3d_row_10_x86(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
 void ff_hqdn3d_row_16_x86(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
 
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+/*
+ * The lowpasses of 8 pixels at once, one per dword lane. The coefficients are
+ * fetched with vpgatherdd: each dword is read 2 bytes before the coefficient,
+ * so that the gather stays inside the table and the coefficient is in the
+ * high word.
+ */
+#define LOWPASS(prev, cur, coef)                                            \
+    "vpsubd          "cur", "prev", "prev"      \n\t"                       \
+    "vpsrad      %[dshift], "prev", "prev"      \n\t"                       \
+    "vpcmpeqd       %%ymm5, %%ymm5, %%ymm5      \n\t"                       \
+    "vpgatherdd     %%ymm5, -2("coef", "prev", 2), %%ymm4 \n\t"             \
+    "vpsrad            $16, %%ymm4, %%ymm4      \n\t"                       \
+    "vpaddd         %%ymm4, "cur", "cur"        \n\t"
+
+/* store the low 16 bits of the lanes of reg */
+#define STORE16(reg, mem)                                                   \
+    "vpand          %%ymm7, "reg", %%ymm5       \n\t"                       \
+    "vpackusdw      %%ymm5, %%ymm5, %%ymm5      \n\t"                       \
+    "vpermq          $0x08, %%ymm5, %%ymm5      \n\t"                       \
+    "vmovdqu        %%xmm5, "mem"               \n\t"
+
+/* store the low 8 bits of the lanes of reg */
+#define STORE8(reg, mem)                                                    \
+    "vpand          %%ymm3, "reg", %%ymm5       \n\t"                       \
+    "vpackusdw      %%ymm5, %%ymm5, %%ymm5      \n\t"                       \
+    "vpermq          $0x08, %%ymm5, %%ymm5      \n\t"                       \
+    "vpackuswb      %%xmm5, %%xmm5, %%xmm5      \n\t"                       \
+    "vmovq          %%xmm5, "mem"               \n\t"
+
+#define STORE_DST_8  STORE8("%%ymm0", "(%[dst], %[x])")
+#define STORE_DST_16 STORE16("%%ymm0", "(%[dst], %[x], 2)")
+
+#define LOAD_CONSTS                                                         \
+    "vpcmpeqd       %%ymm7, %%ymm7, %%ymm7      \n\t"                       \
+    "vpsrld            $16, %%ymm7, %%ymm7      \n\t"                       \
+    "vpsrld             $8, %%ymm7, %%ymm3      \n\t"
+
+/*
+ * Lowpass of column k of a block of 8 columns of 8 rows, from the previous
+ * column in ymm prev into ymm cur. The source pixels are gathered as the
+ * high part of a dword, so that the gather does not read past the pixel.
+ * ymm14 holds the offsets of the source rows, ymm8 the rounding bias and ymm9
+ * the low word mask.
+ */
+#define H_STEP(k, prev, cur)                                                \
+    "vpcmpeqd      %%ymm13, %%ymm13, %%ymm13    \n\t"                       \
+    "vpgatherdd    %%ymm13, %c[disp]+%c[bps]*"#k"(%[src], %%ymm14, 1), "cur" \n\t" \
+    "vpsrld    %[srcshift], "cur", "cur"        \n\t"                       \
+    "vpslld       %[shift], "cur", "cur"        \n\t"                       \
+    "vpaddd         %%ymm8, "cur", "cur"        \n\t"                       \
+    "vpsubd          "cur", "prev", %%ymm10     \n\t"                       \
+    "vpsrad      %[dshift], %%ymm10, %%ymm10    \n\t"                       \
+    "vpcmpeqd      %%ymm13, %%ymm13, %%ymm13    \n\t"                       \
+    "vpgatherdd    %%ymm13, -2(%[spatial], %%ymm10, 2), %%ymm12 \n\t"       \
+    "vpsrad            $16, %%ymm12, %%ymm12    \n\t"                       \
+    "vpaddd        %%ymm12, "cur", "cur"        \n\t"                       \
+    "vpand          %%ymm9, "cur", "cur"        \n\t"
+
+/*
+ * The rows are filtered in the lanes, the 8 columns are then transposed back
+ * to rows: pack the columns by pairs, then interleave the words, the dwords
+ * and the qwords. Each 128-bit lane of the result holds a row of 8 pixels,
+ * rows 0 to 3 in the low lanes and 4 to 7 in the high ones.
+ */
+#define H_ROWS(n)                                                         \
+    __asm__ volatile(                                                       \
+        "vpcmpeqd       %%ymm9, %%ymm9, %%ymm9      \n\t"                   \
+        "vpsrld            $16, %%ymm9, %%ymm9      \n\t"                   \
+        "vpbroadcastd   %[bias], %%ymm8             \n\t"                   \
+        "vmovdqu  32(%[offs]), %%ymm14              \n\t"                   \
+        "vpcmpeqd      %%ymm13, %%ymm13, %%ymm13    \n\t"                   \
+        "vpgatherdd    %%ymm13, -4(%[p], %%ymm14, 1), %%ymm15 \n\t"         \
+        "vpsrld            $16, %%ymm15, %%ymm15    \n\t"                   \
+        "vmovdqu      (%[offs]), %%ymm14            \n\t"                   \
+        "1:                                         \n\t"                   \
+        H_STEP(0, "%%ymm15", "%%ymm0")                                      \
+        H_STEP(1, "%%ymm0",  "%%ymm1")                                      \
+        H_STEP(2, "%%ymm1",  "%%ymm2")                                      \
+        H_STEP(3, "%%ymm2",  "%%ymm3")                                      \
+        H_STEP(4, "%%ymm3",  "%%ymm4")                                      \
+        H_STEP(5, "%%ymm4",  "%%ymm5")                                      \
+        H_STEP(6, "%%ymm5",  "%%ymm6")                                      \
+        H_STEP(7, "%%ymm6",  "%%ymm7")                                      \
+        "vmovdqa        %%ymm7, %%ymm15             \n\t"                   \
+        "vpackusdw      %%ymm1, %%ymm0, %%ymm0      \n\t"                   \
+        "vpackusdw      %%ymm3, %%ymm2, %%ymm1      \n\t"                   \
+        "vpackusdw      %%ymm5, %%ymm4, %%ymm2      \n\t"                   \
+        "vpackusdw      %%ymm7, %%ymm6, %%ymm3      \n\t"                   \
+        "vpunpcklwd     %%ymm1, %%ymm0, %%ymm4      \n\t"                   \
+        "vpunpckhwd     %%ymm1, %%ymm0, %%ymm5      \n\t"                   \
+        "vpunpcklwd     %%ymm3, %%ymm2, %%ymm6      \n\t"                   \
+        "vpunpckhwd     %%ymm3, %%ymm2, %%ymm7      \n\t"                   \
+        "vpunpcklwd     %%ymm5, %%ymm4, %%ymm0      \n\t"                   \
+        "vpunpckhwd     %%ymm5, %%ymm4, %%ymm1      \n\t"                   \
+        "vpunpcklwd     %%ymm7, %%ymm6, %%ymm2      \n\t"                   \
+        "vpunpckhwd     %%ymm7, %%ymm6, %%ymm3      \n\t"                   \
+        "vpunpcklqdq    %%ymm2, %%ymm0, %%ymm4      \n\t"                   \
+        "vpunpckhqdq    %%ymm2, %%ymm0, %%ymm5      \n\t"                   \
+        "vpunpcklqdq    %%ymm3, %%ymm1, %%ymm6      \n\t"                   \
+        "vpunpckhqdq    %%ymm3, %%ymm1, %%ymm7      \n\t"                   \
+        "vmovdqu        %%xmm4, (%[p])              \n\t"                   \
+        "vmovdqu        %%xmm5, (%[p], %[ls])       \n\t"                   \
+        "vmovdqu        %%xmm6, (%[p], %[ls], 2)    \n\t"                   \
+        "vmovdqu        %%xmm7, (%[p], %[ls3])      \n\t"                   \
+        "vextracti128 $1, %%ymm4, (%[q])            \n\t"                   \
+        "vextracti128 $1, %%ymm5, (%[q], %[ls])     \n\t"                   \
+        "vextracti128 $1, %%ymm6, (%[q], %[ls], 2)  \n\t"                   \
+        "vextracti128 $1, %%ymm7, (%[q], %[ls3])    \n\t"                   \
+        "add                $16, %[p]               \n\t"                   \
+        "add                $16, %[q]               \n\t"                   \
+        "add           $8*"#n", %[src]              \n\t"                   \
+        "sub                 $8, %[w]               \n\t"                   \
+        "jg 1b                                      \n\t"                   \
+        "vzeroupper                                 \n\t"                   \
+        : [p]"+&r"(row_lowpass), [q]"+&r"(q), [src]"+&r"(src), [w]"+&r"(w)  \
+        : [offs]"r"(offs), [ls]"r"(ls), [ls3]"r"(3 * ls),                   \
+          [spatial]"r"(spatial), [bias]"m"(bias),                           \
+          [disp]"i"(n - 4), [bps]"i"(n), [srcshift]"i"(32 - 8 * n),         \
+          [shift]"i"(16 - depth), [dshift]"i"(8 - lut_bits)                 \
+        : XMM_CLOBBERS("%xmm0",  "%xmm1",  "%xmm2",  "%xmm3",               \
+                       "%xmm4",  "%xmm5",  "%xmm6",  "%xmm7",               \
+                       "%xmm8",  "%xmm9",  "%xmm10", "%xmm12",              \
+                       "%xmm13", "%xmm14", "%xmm15",)                       \
+          "memory"                                                          \
+    )
+
+static av_always_inline void denoise_spatial_h_rows_avx2(uint16_t *row_lowpass,
+                                                         ptrdiff_t lowpass_stride,
+                                                         const uint8_t *src,
+                                                         ptrdiff_t sstride,
+                                                         ptrdiff_t w,
+                                                         int16_t *spatial,
+                                                         int depth)
+{
+    const int lut_bits = depth == 16 ? 8 : 4;
+    const int bias = ((1 << (16 - depth)) - 1) >> 1;
+    const x86_reg ls = 2 * lowpass_stride;
+    uint16_t *q = row_lowpass + 4 * lowpass_stride;
+    int32_t offs[16];
+    int i;
+
+    if (!w)
+        return;
+    for (i = 0; i < 8; i++) {
+        offs[i]     = i * sstride;
+        offs[i + 8] = i * ls;
+    }
+    if (depth == 8)
+        H_ROWS(1);
+    else
+        H_ROWS(2);
+}
+
+#define SPATIAL_V_ROW(store_dst)                                            \
+    __asm__ volatile(                                                       \
+        LOAD_CONSTS                                                         \
+        "1:                                         \n\t"                   \
+        "vpmovzxwd (%[pixel_ant], %[x], 2), %%ymm0  \n\t"                   \
+        "vpmovzxwd  (%[line_ant], %[x], 2), %%ymm1  \n\t"                   \
+        LOWPASS("%%ymm1", "%%ymm0", "%[spatial]")                           \
+        STORE16("%%ymm0", "(%[line_ant], %[x], 2)")                         \
+        "vpmovzxwd (%[frame_ant], %[x], 2), %%ymm1  \n\t"                   \
+        LOWPASS("%%ymm1", "%%ymm0", "%[temporal]")                          \
+        STORE16("%%ymm0", "(%[frame_ant], %[x], 2)")                        \
+        "vpsrld       %[shift], %%ymm0, %%ymm0      \n\t"                   \
+        store_dst                                                           \
+        "add                 $8, %[x]               \n\t"                   \
+        "jl 1b                                      \n\t"                   \
+        "vzeroupper                                 \n\t"                   \
+        : [x]"+&r"(x)                                                       \
+        : [dst]"r"(dst), [line_ant]"r"(line_ant + w),                       \
+          [frame_ant]"r"(frame_ant + w), [pixel_ant]"r"(pixel_ant + w),     \
+          [spatial]"r"(spatial), [temporal]"r"(temporal),                   \
+          [shift]"i"(16 - depth), [dshift]"i"(8 - lut_bits)                 \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm3", "%xmm4",                  \
+                       "%xmm5", "%xmm7",)                                   \
+          "memory"                                                          \
+    )
+
+static av_always_inline void denoise_spatial_v_row_avx2(uint8_t *dst,
+                                                        uint16_t *line_ant,
+                                                        uint16_t *frame_ant,
+                                                        const uint16_t *pixel_ant,
+                                                        ptrdiff_t w,
+                                                        int16_t *spatial,
+                                                        int16_t *temporal,
+                                                        int depth)
+{
+    const int lut_bits = depth == 16 ? 8 : 4;
+    x86_reg x = -w;
+
+    if (!w)
+        return;
+    if (depth == 8) {
+        dst += w;
+        SPATIAL_V_ROW(STORE_DST_8);
+    } else {
+        dst += 2 * w;
+        SPATIAL_V_ROW(STORE_DST_16);
+    }
+}
+
+#define DEFINE_ROWS_AVX2(depth)                                                     \
+static void denoise_spatial_h_rows_##depth##_avx2(uint16_t *row_lowpass,            \
+                                                  ptrdiff_t lowpass_stride,         \
+                                                  const uint8_t *src,               \
+                                                  ptrdiff_t sstride, ptrdiff_t w,   \
+                                                  int16_t *spatial)                 \
+{                                                                                   \
+    denoise_spatial_h_rows_avx2(row_lowpass, lowpass_stride, src, sstride, w,       \
+                                spatial, depth);                                    \
+}                                                                                   \
+                                                                                    \
+static void denoise_spatial_v_row_##depth##_avx2(uint8_t *dst, uint16_t *line_ant,  \
+                                                 uint16_t *frame_ant,               \
+                                                 const uint16_t *pixel_ant,         \
+                                                 ptrdiff_t w, int16_t *spatial,     \
+                                                 int16_t *temporal)                 \
+{                                                                                   \
+    denoise_spatial_v_row_avx2(dst, line_ant, frame_ant, pixel_ant, w,              \
+                               spatial, temporal, depth);                           \
+}
+
+DEFINE_ROWS_AVX2(8)
+DEFINE_ROWS_AVX2(9)
+DEFINE_ROWS_AVX2(10)
+DEFINE_ROWS_AVX2(16)
+#endif /* HAVE_AVX2_INLINE && ARCH_X86_64 */
+
 av_cold void ff_hqdn3d_init_x86(HQDN3DContext *hqdn3d)
 {
 #if HAVE_YASM
@@ -38,4 +271,16 @@ av_cold void ff_hqdn3d_init_x86(HQDN3DContext *hqdn3d)
     hqdn3d->denoise_row[10] = ff_hqdn3d_row_10_x86;
     hqdn3d->denoise_row[16] = ff_hqdn3d_row_16_x86;
 #endif
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+    if (INLINE_AVX2(av_get_cpu_flags())) {
+        hqdn3d->denoise_spatial_h_rows[ 8] = denoise_spatial_h_rows_8_avx2;
+        hqdn3d->denoise_spatial_h_rows[ 9] = denoise_spatial_h_rows_9_avx2;
+        hqdn3d->denoise_spatial_h_rows[10] = denoise_spatial_h_rows_10_avx2;
+        hqdn3d->denoise_spatial_h_rows[16] = denoise_spatial_h_rows_16_avx2;
+        hqdn3d->denoise_spatial_v_row[ 8] = denoise_spatial_v_row_8_avx2;
+        hqdn3d->denoise_spatial_v_row[ 9] = denoise_spatial_v_row_9_avx2;
+        hqdn3d->denoise_spatial_v_row[10] = denoise_spatial_v_row_10_avx2;
+        hqdn3d->denoise_spatial_v_row[16] = denoise_spatial_v_row_16_avx2;
+    }
+#endif
 }
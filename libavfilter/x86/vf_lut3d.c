@@ -0,0 +1,321 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/lut3d.h"
+
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+/*
+ * The kernels interpolate 8 pixels at once, with one lane per pixel. The
+ * components of the pixels and the LUT entries are fetched with gathers. The
+ * arithmetic is done in the same order as the C code, so that the output is
+ * bitexact. Nearest interpolation has no arithmetic to share between the
+ * lanes and is left to the C code.
+ */
+
+/*
+ * Load component c of the 8 pixels into ymm13, scaled to its float LUT
+ * coordinate. ymm8 holds the scale of the coordinates.
+ */
+#define LOAD_COMP(c)                                                        \
+    "vmovdqa  "#c"*32(%[offs]), %%ymm15         \n\t"                       \
+    "vpcmpeqd      %%ymm14, %%ymm14, %%ymm14    \n\t"                       \
+    "vpgatherdd    %%ymm14, (%[src], %%ymm15, 1), %%ymm13 \n\t"             \
+    "vpslld        %[shift], %%ymm13, %%ymm13   \n\t"                       \
+    "vpsrld        %[shift], %%ymm13, %%ymm13   \n\t"                       \
+    "vcvtdq2ps     %%ymm13, %%ymm13             \n\t"                       \
+    "vmulps         %%ymm8, %%ymm13, %%ymm13    \n\t"
+
+/* Fetch the 32-bit values at mem for the 8 pixels into dst. */
+#define GATHER(mem, dst)                                                    \
+    "vpcmpeqd      %%ymm15, %%ymm15, %%ymm15    \n\t"                       \
+    "vpgatherdd    %%ymm15, "mem", "dst"        \n\t"
+
+/* Multiply the indexes of the LUT entries in reg by 3, the float size of an
+ * entry, to use them as float offsets. */
+#define MUL3(reg)                                                           \
+    "vpslld             $1, "reg", %%ymm15      \n\t"                       \
+    "vpaddd        %%ymm15, "reg", "reg"        \n\t"
+
+/* Scale the output component in reg and store it truncated to out[k]. */
+#define STORE_COMP(reg, k)                                                  \
+    "vbroadcastss %[scale], %%ymm15             \n\t"                       \
+    "vmulps        %%ymm15, "reg", "reg"        \n\t"                       \
+    "vcvttps2dq      "reg", "reg"               \n\t"                       \
+    "vmovdqa         "reg", "#k"*32(%[out])     \n\t"
+
+#define LERP(v0, v1, f)                                                     \
+    "vsubps          "v0", "v1", "v1"           \n\t"                       \
+    "vmulps           "f", "v1", "v1"           \n\t"                       \
+    "vaddps          "v1", "v0", "v0"           \n\t"
+
+/*
+ * ymm0 holds the offsets of c000, ymm7 to ymm13 the ones of c100, c010,
+ * c110, c001, c101, c011 and c111, ymm4 to ymm6 the distances from prev.
+ */
+#define TRILINEAR_COMP(k)                                                   \
+    GATHER(#k"*4(%[lut], %%ymm0,  4)", "%%ymm1")                            \
+    GATHER(#k"*4(%[lut], %%ymm7,  4)", "%%ymm2")                            \
+    LERP("%%ymm1", "%%ymm2", "%%ymm4")                                      \
+    GATHER(#k"*4(%[lut], %%ymm8,  4)", "%%ymm2")                            \
+    GATHER(#k"*4(%[lut], %%ymm9,  4)", "%%ymm3")                            \
+    LERP("%%ymm2", "%%ymm3", "%%ymm4")                                      \
+    LERP("%%ymm1", "%%ymm2", "%%ymm5")                                      \
+    GATHER(#k"*4(%[lut], %%ymm10, 4)", "%%ymm2")                            \
+    GATHER(#k"*4(%[lut], %%ymm11, 4)", "%%ymm3")                            \
+    LERP("%%ymm2", "%%ymm3", "%%ymm4")                                      \
+    GATHER(#k"*4(%[lut], %%ymm12, 4)", "%%ymm3")                            \
+    GATHER(#k"*4(%[lut], %%ymm13, 4)", "%%ymm14")                           \
+    LERP("%%ymm3", "%%ymm14", "%%ymm4")                                     \
+    LERP("%%ymm2", "%%ymm3", "%%ymm5")                                      \
+    LERP("%%ymm1", "%%ymm2", "%%ymm6")                                      \
+    STORE_COMP("%%ymm1", k)
+
+/*
+ * ymm0, ymm12, ymm13 and ymm14 hold the offsets of c000, of the vertices
+ * after the first and the second step along the edges, and of c111. ymm1,
+ * ymm2, ymm3 and ymm8 hold their weights.
+ */
+#define TETRAHEDRAL_COMP(k)                                                 \
+    GATHER(#k"*4(%[lut], %%ymm0,  4)", "%%ymm4")                            \
+    "vmulps         %%ymm1, %%ymm4, %%ymm4      \n\t"                       \
+    GATHER(#k"*4(%[lut], %%ymm12, 4)", "%%ymm5")                            \
+    "vmulps         %%ymm2, %%ymm5, %%ymm5      \n\t"                       \
+    "vaddps         %%ymm5, %%ymm4, %%ymm4      \n\t"                       \
+    GATHER(#k"*4(%[lut], %%ymm13, 4)", "%%ymm5")                            \
+    "vmulps         %%ymm3, %%ymm5, %%ymm5      \n\t"                       \
+    "vaddps         %%ymm5, %%ymm4, %%ymm4      \n\t"                       \
+    GATHER(#k"*4(%[lut], %%ymm14, 4)", "%%ymm5")                            \
+    "vmulps         %%ymm8, %%ymm5, %%ymm5      \n\t"                       \
+    "vaddps         %%ymm5, %%ymm4, %%ymm4      \n\t"                       \
+    STORE_COMP("%%ymm4", k)
+
+/*
+ * Load the coordinates of component c into prev, the offset from prev to
+ * next into diff and the distance from prev into d, the same way as
+ * init_coords(). ymm9 holds 1 in each lane and ymm10 lutsize - 1.
+ */
+#define LOAD_COORD(c, prev, diff, d)                                        \
+    LOAD_COMP(c)                                                            \
+    "vcvttps2dq    %%ymm13, "prev"              \n\t"                       \
+    "vpaddd         %%ymm9, "prev", "diff"      \n\t"                       \
+    "vpminsd       %%ymm10, "diff", "diff"      \n\t"                       \
+    "vpsubd         "prev", "diff", "diff"      \n\t"                       \
+    "vcvtdq2ps      "prev", "d"                 \n\t"                       \
+    "vsubps            "d", %%ymm13, "d"        \n\t"
+
+#define LOAD_CONSTS                                                         \
+    "vbroadcastss %[coord_scale], %%ymm8        \n\t"                       \
+    "vpcmpeqd       %%ymm9, %%ymm9, %%ymm9      \n\t"                       \
+    "vpsrld            $31, %%ymm9, %%ymm9      \n\t"                       \
+    "vpbroadcastd %[lutmax], %%ymm10            \n\t"
+
+/*
+ * Load ymm0 with the float offsets of the prev entries, ymm1 to ymm3 with the
+ * offsets from them to the next entries along r, g and b, and ymm4 to ymm6
+ * with the distances from prev along r, g and b.
+ */
+#define LOAD_COORDS                                                         \
+    LOAD_CONSTS                                                             \
+    LOAD_COORD(0, "%%ymm0", "%%ymm1", "%%ymm4")                             \
+    LOAD_COORD(1, "%%ymm7", "%%ymm2", "%%ymm5")                             \
+    "vpslld             $6, %%ymm0, %%ymm0      \n\t"                       \
+    "vpaddd         %%ymm7, %%ymm0, %%ymm0      \n\t"                       \
+    LOAD_COORD(2, "%%ymm7", "%%ymm3", "%%ymm6")                             \
+    "vpslld             $6, %%ymm0, %%ymm0      \n\t"                       \
+    "vpaddd         %%ymm7, %%ymm0, %%ymm0      \n\t"                       \
+    "vpslld            $12, %%ymm1, %%ymm1      \n\t"                       \
+    "vpslld             $6, %%ymm2, %%ymm2      \n\t"                       \
+    MUL3("%%ymm0")                                                          \
+    MUL3("%%ymm1")                                                          \
+    MUL3("%%ymm2")                                                          \
+    MUL3("%%ymm3")
+
+#define LUT3D_ASM(code)                                                     \
+    __asm__ volatile(                                                       \
+        code                                                                \
+        "vzeroupper                                 \n\t"                   \
+        :: [src]"r"(src), [offs]"r"(offs), [lut]"r"(lut3d->lut),            \
+           [out]"r"(out), [scale]"m"(scale), [one]"m"(one),                 \
+           [coord_scale]"m"(coord_scale), [lutmax]"m"(lutmax),              \
+           [shift]"i"(32 - nbits)                                           \
+        : XMM_CLOBBERS("%xmm0",  "%xmm1",  "%xmm2",  "%xmm3",               \
+                       "%xmm4",  "%xmm5",  "%xmm6",  "%xmm7",               \
+                       "%xmm8",  "%xmm9",  "%xmm10", "%xmm11",              \
+                       "%xmm12", "%xmm13", "%xmm14", "%xmm15",)             \
+          "memory"                                                          \
+    )
+
+static av_always_inline void interp_row_avx2(const LUT3DContext *lut3d,
+                                             uint8_t *dstrow,
+                                             const uint8_t *srcrow,
+                                             int w, int copy_alpha,
+                                             int nbits, int interp)
+{
+    const int step = lut3d->step;
+    const int pixsize = step * nbits >> 3;
+    const uint8_t r = lut3d->rgba_map[0];
+    const uint8_t g = lut3d->rgba_map[1];
+    const uint8_t b = lut3d->rgba_map[2];
+    const uint8_t a = lut3d->rgba_map[3];
+    DECLARE_ALIGNED(32, int32_t, offs)[3][8];
+    DECLARE_ALIGNED(32, int32_t, out)[3][8];
+    /* same as in init_coords() */
+    const float coord_scale = (1. / ((1 << nbits) - 1)) * (lut3d->lutsize - 1);
+    const int lutmax = lut3d->lutsize - 1;
+    const float scale = (1 << nbits) - 1;
+    const float one = 1;
+    /* the gathers read 4 bytes at each component, so up to 3 bytes past the
+     * last pixel: the last pixels of the row are read from a copy */
+    uint8_t last[8 * 4 * 2 + 2] = { 0 };
+    int x, i;
+
+    for (i = 0; i < 8; i++) {
+        offs[0][i] = i * pixsize + r * nbits / 8;
+        offs[1][i] = i * pixsize + g * nbits / 8;
+        offs[2][i] = i * pixsize + b * nbits / 8;
+    }
+
+    for (x = 0; x < w; x += 8) {
+        const uint8_t *src = srcrow + x * pixsize;
+        const int n = FFMIN(w - x, 8);
+
+        if (x + 8 >= w) {
+            memcpy(last, src, n * pixsize);
+            src = last;
+        }
+
+        if (interp == INTERPOLATE_TRILINEAR) {
+            LUT3D_ASM(
+                LOAD_COORDS
+                "vpaddd         %%ymm1, %%ymm0, %%ymm7      \n\t"
+                "vpaddd         %%ymm2, %%ymm0, %%ymm8      \n\t"
+                "vpaddd         %%ymm2, %%ymm7, %%ymm9      \n\t"
+                "vpaddd         %%ymm3, %%ymm0, %%ymm10     \n\t"
+                "vpaddd         %%ymm3, %%ymm7, %%ymm11     \n\t"
+                "vpaddd         %%ymm3, %%ymm8, %%ymm12     \n\t"
+                "vpaddd         %%ymm3, %%ymm9, %%ymm13     \n\t"
+                TRILINEAR_COMP(0)
+                TRILINEAR_COMP(1)
+                TRILINEAR_COMP(2));
+        } else {
+            /*
+             * The vertices are picked with the comparisons of the C code,
+             * so that they match it where two distances are equal. The
+             * distances themselves are sorted with min and max.
+             */
+            LUT3D_ASM(
+                LOAD_COORDS
+                "vcmpgtps       %%ymm5, %%ymm4, %%ymm7      \n\t" // r > g
+                "vcmpgtps       %%ymm6, %%ymm5, %%ymm8      \n\t" // g > b
+                "vcmpgtps       %%ymm6, %%ymm4, %%ymm9      \n\t" // r > b
+                "vcmpgtps       %%ymm5, %%ymm6, %%ymm10     \n\t" // b > g
+                "vcmpgtps       %%ymm4, %%ymm6, %%ymm11     \n\t" // b > r
+                /* first step: r > g ? (r > b ? r : b) : (b > g ? b : g) */
+                "vblendvps      %%ymm9,  %%ymm1, %%ymm3, %%ymm12 \n\t"
+                "vblendvps      %%ymm10, %%ymm3, %%ymm2, %%ymm13 \n\t"
+                "vblendvps      %%ymm7, %%ymm12, %%ymm13, %%ymm12 \n\t"
+                /* last step: r > g ? (g > b ? b : g) : (b > r ? r : b) */
+                "vblendvps      %%ymm8,  %%ymm3, %%ymm2, %%ymm13 \n\t"
+                "vblendvps      %%ymm11, %%ymm1, %%ymm3, %%ymm14 \n\t"
+                "vblendvps      %%ymm7, %%ymm13, %%ymm14, %%ymm13 \n\t"
+                "vpaddd         %%ymm2, %%ymm1, %%ymm14     \n\t"
+                "vpaddd         %%ymm3, %%ymm14, %%ymm14    \n\t"
+                "vpsubd        %%ymm13, %%ymm14, %%ymm13    \n\t"
+                "vpaddd         %%ymm0, %%ymm12, %%ymm12    \n\t"
+                "vpaddd         %%ymm0, %%ymm13, %%ymm13    \n\t"
+                "vpaddd         %%ymm0, %%ymm14, %%ymm14    \n\t"
+                /* ymm9 = max, ymm7 = median, ymm8 = min */
+                "vmaxps         %%ymm5, %%ymm4, %%ymm7      \n\t"
+                "vminps         %%ymm5, %%ymm4, %%ymm8      \n\t"
+                "vmaxps         %%ymm6, %%ymm7, %%ymm9      \n\t"
+                "vminps         %%ymm6, %%ymm7, %%ymm7      \n\t"
+                "vmaxps         %%ymm8, %%ymm7, %%ymm7      \n\t"
+                "vminps         %%ymm6, %%ymm8, %%ymm8      \n\t"
+                "vbroadcastss    %[one], %%ymm1             \n\t"
+                "vsubps         %%ymm9, %%ymm1, %%ymm1      \n\t"
+                "vsubps         %%ymm7, %%ymm9, %%ymm2      \n\t"
+                "vsubps         %%ymm8, %%ymm7, %%ymm3      \n\t"
+                TETRAHEDRAL_COMP(0)
+                TETRAHEDRAL_COMP(1)
+                TETRAHEDRAL_COMP(2));
+        }
+
+        if (nbits == 8) {
+            uint8_t *dst = dstrow + x * step;
+            for (i = 0; i < n; i++) {
+                dst[r] = av_clip_uint8(out[0][i]);
+                dst[g] = av_clip_uint8(out[1][i]);
+                dst[b] = av_clip_uint8(out[2][i]);
+                if (copy_alpha && step == 4)
+                    dst[a] = src[i * pixsize + a];
+                dst += step;
+            }
+        } else {
+            uint16_t *dst = (uint16_t *)dstrow + x * step;
+            for (i = 0; i < n; i++) {
+                dst[r] = av_clip_uint16(out[0][i]);
+                dst[g] = av_clip_uint16(out[1][i]);
+                dst[b] = av_clip_uint16(out[2][i]);
+                if (copy_alpha && step == 4)
+                    dst[a] = ((const uint16_t *)src)[i * step + a];
+                dst += step;
+            }
+        }
+    }
+}
+
+#define DEFINE_INTERP_FUNC_AVX2(name, nbits, interp)                                \
+static void interp_##nbits##_##name##_avx2(const LUT3DContext *lut3d,               \
+                                           uint8_t *dst, const uint8_t *src,        \
+                                           int w, int copy_alpha)                   \
+{                                                                                   \
+    interp_row_avx2(lut3d, dst, src, w, copy_alpha, nbits, interp);                 \
+}
+
+DEFINE_INTERP_FUNC_AVX2(trilinear,   8,  INTERPOLATE_TRILINEAR)
+DEFINE_INTERP_FUNC_AVX2(tetrahedral, 8,  INTERPOLATE_TETRAHEDRAL)
+
+DEFINE_INTERP_FUNC_AVX2(trilinear,   16, INTERPOLATE_TRILINEAR)
+DEFINE_INTERP_FUNC_AVX2(tetrahedral, 16, INTERPOLATE_TETRAHEDRAL)
+#endif /* HAVE_AVX2_INLINE && ARCH_X86_64 */
+
+av_cold void ff_lut3d_init_x86(LUT3DContext *lut3d)
+{
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_AVX2(cpu_flags)) {
+#define SET_FUNC(name) do {                                             \
+    if (lut3d->is16bit) lut3d->interp_row = interp_16_##name##_avx2;    \
+    else                lut3d->interp_row = interp_8_##name##_avx2;     \
+} while (0)
+        switch (lut3d->interpolation) {
+        case INTERPOLATE_TRILINEAR:   SET_FUNC(trilinear);   break;
+        case INTERPOLATE_TETRAHEDRAL: SET_FUNC(tetrahedral); break;
+        }
+    }
+#endif
+}
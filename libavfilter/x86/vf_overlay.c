@@ -0,0 +1,560 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/vf_overlay.h"
+
+#if HAVE_SSE2_INLINE
+
+DECLARE_ALIGNED(16, static const uint16_t, pw_128)[8] = { 128, 128, 128, 128, 128, 128, 128, 128 };
+DECLARE_ALIGNED(16, static const uint16_t, pw_255)[8] = { 255, 255, 255, 255, 255, 255, 255, 255 };
+DECLARE_ALIGNED(16, static const uint16_t, pw_257)[8] = { 257, 257, 257, 257, 257, 257, 257, 257 };
+DECLARE_ALIGNED(16, static const float,    ps_255)[4]   = { 255.0,   255.0,   255.0,   255.0   };
+DECLARE_ALIGNED(16, static const float,    ps_65025)[4] = { 65025.0, 65025.0, 65025.0, 65025.0 };
+DECLARE_ALIGNED(16, static const uint32_t, pd_alpha0)[4] = { 0x000000ff, 0x000000ff, 0x000000ff, 0x000000ff };
+DECLARE_ALIGNED(16, static const uint32_t, pd_alpha3)[4] = { 0xff000000, 0xff000000, 0xff000000, 0xff000000 };
+
+/* Jump to label 2 if all the bytes of reg are zero, clobbers xmm3 and tmp;
+ * xmm7 must be zero. */
+#define SKIP_IF_ZERO(reg)                      \
+        "movdqa     "reg", %%xmm3       \n"    \
+        "pcmpeqb    %%xmm7, %%xmm3      \n"    \
+        "pmovmskb   %%xmm3, %k[tmp]     \n"    \
+        "cmp       $0xffff, %k[tmp]     \n"    \
+        "je 2f                          \n"
+
+/* xmm3 = (xmm0 * (255 - xmm2) + xmm1 * xmm2) / 255 with the rounding of
+ * FAST_DIV255() for 16 bytes, clobbers xmm0-xmm2, xmm4 and xmm5; xmm6 must
+ * hold pw_255 and xmm7 zero. 255 - a is computed as a ^ 255. */
+#define BLEND_16                               \
+        "movdqa     %%xmm0, %%xmm3      \n"    \
+        "movdqa     %%xmm1, %%xmm4      \n"    \
+        "movdqa     %%xmm2, %%xmm5      \n"    \
+        "punpcklbw  %%xmm7, %%xmm3      \n"    \
+        "punpcklbw  %%xmm7, %%xmm4      \n"    \
+        "punpcklbw  %%xmm7, %%xmm5      \n"    \
+        "pmullw     %%xmm5, %%xmm4      \n"    \
+        "pxor       %%xmm6, %%xmm5      \n"    \
+        "pmullw     %%xmm5, %%xmm3      \n"    \
+        "paddw      %%xmm4, %%xmm3      \n"    \
+        "paddw   %[pw_128], %%xmm3      \n"    \
+        "pmulhuw %[pw_257], %%xmm3      \n"    \
+        "punpckhbw  %%xmm7, %%xmm0      \n"    \
+        "punpckhbw  %%xmm7, %%xmm1      \n"    \
+        "punpckhbw  %%xmm7, %%xmm2      \n"    \
+        "pmullw     %%xmm2, %%xmm1      \n"    \
+        "pxor       %%xmm6, %%xmm2      \n"    \
+        "pmullw     %%xmm2, %%xmm0      \n"    \
+        "paddw      %%xmm1, %%xmm0      \n"    \
+        "paddw   %[pw_128], %%xmm0      \n"    \
+        "pmulhuw %[pw_257], %%xmm0      \n"    \
+        "packuswb   %%xmm0, %%xmm3      \n"
+
+static void overlay_blend_row_sse2(uint8_t *dst, const uint8_t *src,
+                                   const uint8_t *alpha, int w)
+{
+    intptr_t x, tmp;
+
+    if (w & 15) {
+        x = w & ~15;
+        ff_overlay_blend_row_c(dst + x, src + x, alpha + x, w - x);
+        w = x;
+    }
+    if (!w)
+        return;
+    x = -w;
+    __asm__ volatile(
+        "pxor       %%xmm7, %%xmm7      \n"
+        "movdqa  %[pw_255], %%xmm6      \n"
+        "1:                             \n"
+        "movdqu (%[a],%[x]), %%xmm2     \n"
+        SKIP_IF_ZERO("%%xmm2")
+        "movdqu (%[d],%[x]), %%xmm0     \n"
+        "movdqu (%[s],%[x]), %%xmm1     \n"
+        BLEND_16
+        "movdqu     %%xmm3, (%[d],%[x]) \n"
+        "2:                             \n"
+        "add           $16, %[x]        \n"
+        "jl 1b                          \n"
+        : [x]"+&r"(x), [tmp]"=&r"(tmp)
+        : [d]"r"(dst + w), [s]"r"(src + w), [a]"r"(alpha + w),
+          [pw_128]"m"(*pw_128), [pw_255]"m"(*pw_255), [pw_257]"m"(*pw_257)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+
+static void overlay_blend_alpha_row_sse2(uint8_t *dst, const uint8_t *alpha, int w)
+{
+    intptr_t x, tmp;
+
+    if (w & 15) {
+        x = w & ~15;
+        ff_overlay_blend_alpha_row_c(dst + x, alpha + x, w - x);
+        w = x;
+    }
+    if (!w)
+        return;
+    x = -w;
+    /* dst + (255 - dst) * a / 255 is the blend of dst with 255 */
+    __asm__ volatile(
+        "pxor       %%xmm7, %%xmm7      \n"
+        "movdqa  %[pw_255], %%xmm6      \n"
+        "1:                             \n"
+        "movdqu (%[a],%[x]), %%xmm2     \n"
+        SKIP_IF_ZERO("%%xmm2")
+        "movdqu (%[d],%[x]), %%xmm0     \n"
+        "pcmpeqb    %%xmm1, %%xmm1      \n"
+        BLEND_16
+        "movdqu     %%xmm3, (%[d],%[x]) \n"
+        "2:                             \n"
+        "add           $16, %[x]        \n"
+        "jl 1b                          \n"
+        : [x]"+&r"(x), [tmp]"=&r"(tmp)
+        : [d]"r"(dst + w), [a]"r"(alpha + w),
+          [pw_128]"m"(*pw_128), [pw_255]"m"(*pw_255), [pw_257]"m"(*pw_257)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+
+#if HAVE_6REGS
+static void overlay_blend_row_sub_sse2(uint8_t *dst, const uint8_t *src,
+                                       const uint8_t *alpha,
+                                       ptrdiff_t alpha_linesize, int w)
+{
+    intptr_t x, tmp;
+
+    if (w & 7) {
+        x = w & ~7;
+        ff_overlay_blend_row_sub_c(dst + x, src + x, alpha + 2 * x,
+                                   alpha_linesize, w - x);
+        w = x;
+    }
+    if (!w)
+        return;
+    x = -w;
+    __asm__ volatile(
+        "pxor       %%xmm7, %%xmm7      \n"
+        "movdqa  %[pw_255], %%xmm6      \n"
+        "1:                             \n"
+        "movdqu (%[a0],%[x],2), %%xmm1  \n"
+        "movdqu (%[a1],%[x],2), %%xmm2  \n"
+        "movdqa     %%xmm1, %%xmm4      \n"
+        "por        %%xmm2, %%xmm4      \n"
+        SKIP_IF_ZERO("%%xmm4")
+        "movdqa     %%xmm1, %%xmm4      \n" // average the 2x2 alpha blocks
+        "movdqa     %%xmm2, %%xmm5      \n"
+        "psrlw          $8, %%xmm1      \n"
+        "psrlw          $8, %%xmm2      \n"
+        "pand       %%xmm6, %%xmm4      \n"
+        "pand       %%xmm6, %%xmm5      \n"
+        "paddw      %%xmm4, %%xmm1      \n"
+        "paddw      %%xmm5, %%xmm2      \n"
+        "paddw      %%xmm1, %%xmm2      \n"
+        "psrlw          $2, %%xmm2      \n"
+        "movq   (%[d],%[x]), %%xmm0     \n"
+        "movq   (%[s],%[x]), %%xmm1     \n"
+        "punpcklbw  %%xmm7, %%xmm0      \n"
+        "punpcklbw  %%xmm7, %%xmm1      \n"
+        "pmullw     %%xmm2, %%xmm1      \n"
+        "pxor       %%xmm6, %%xmm2      \n"
+        "pmullw     %%xmm2, %%xmm0      \n"
+        "paddw      %%xmm1, %%xmm0      \n"
+        "paddw   %[pw_128], %%xmm0      \n"
+        "pmulhuw %[pw_257], %%xmm0      \n"
+        "packuswb   %%xmm0, %%xmm0      \n"
+        "movq       %%xmm0, (%[d],%[x]) \n"
+        "2:                             \n"
+        "add            $8, %[x]        \n"
+        "jl 1b                          \n"
+        : [x]"+&r"(x), [tmp]"=&r"(tmp)
+        : [d]"r"(dst + w), [s]"r"(src + w),
+          [a0]"r"(alpha + 2 * w), [a1]"r"(alpha + 2 * w + alpha_linesize),
+          [pw_128]"m"(*pw_128), [pw_255]"m"(*pw_255), [pw_257]"m"(*pw_257)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+
+/*
+ * The straight alpha 65025 * sa / (255 * (sa + da) - sa * da) is computed in
+ * single precision: all the terms are exact, and the quotient is never
+ * within half an ulp of the next integer, so truncating it matches the C
+ * integer division. sa == 0 would divide 0 by 0 and is masked out.
+ *
+ * The main alpha byte is then blended like the colors with sa as weight and
+ * 255 as overlay value, which is the same as da + (255 - da) * sa / 255.
+ */
+#define BLEND_PACKED(extract_alpha, alpha_mask)                 \
+    __asm__ volatile(                                           \
+        "pxor       %%xmm7, %%xmm7      \n"                     \
+        "movdqa  %[pw_255], %%xmm6      \n"                     \
+        "1:                             \n"                     \
+        "movdqu (%[s],%[x]), %%xmm1     \n"                     \
+        "movdqa     %%xmm1, %%xmm2      \n"                     \
+        "pand      %[mask], %%xmm2      \n"                     \
+        SKIP_IF_ZERO("%%xmm2")                                  \
+        "movdqu (%[d],%[x]), %%xmm0     \n"                     \
+        "movdqa     %%xmm1, %%xmm2      \n"                     \
+        "movdqa     %%xmm0, %%xmm3      \n"                     \
+        extract_alpha("%%xmm2")                                 \
+        extract_alpha("%%xmm3")                                 \
+        "movdqa     %%xmm2, %%xmm5      \n"                     \
+        "cvtdq2ps   %%xmm2, %%xmm2      \n"                     \
+        "cvtdq2ps   %%xmm3, %%xmm3      \n"                     \
+        "movaps     %%xmm2, %%xmm4      \n"                     \
+        "mulps      %%xmm3, %%xmm4      \n" /* sa * da       */ \
+        "addps      %%xmm2, %%xmm3      \n"                     \
+        "mulps   %[ps_255], %%xmm3      \n"                     \
+        "subps      %%xmm4, %%xmm3      \n"                     \
+        "mulps %[ps_65025], %%xmm2      \n"                     \
+        "divps      %%xmm3, %%xmm2      \n"                     \
+        "cvttps2dq  %%xmm2, %%xmm2      \n"                     \
+        "pcmpeqd    %%xmm7, %%xmm5      \n"                     \
+        "pandn      %%xmm2, %%xmm5      \n" /* straight alpha */\
+        "movdqa     %%xmm5, %%xmm2      \n"                     \
+        "pslld          $8, %%xmm2      \n"                     \
+        "por        %%xmm2, %%xmm5      \n"                     \
+        "movdqa     %%xmm5, %%xmm2      \n"                     \
+        "pslld         $16, %%xmm2      \n"                     \
+        "por        %%xmm5, %%xmm2      \n"                     \
+        "movdqa    %[mask], %%xmm4      \n"                     \
+        "pandn      %%xmm2, %%xmm4      \n"                     \
+        "movdqa    %[mask], %%xmm2      \n"                     \
+        "pand       %%xmm1, %%xmm2      \n"                     \
+        "por        %%xmm4, %%xmm2      \n"                     \
+        "por       %[mask], %%xmm1      \n"                     \
+        BLEND_16                                                \
+        "movdqu     %%xmm3, (%[d],%[x]) \n"                     \
+        "2:                             \n"                     \
+        "add           $16, %[x]        \n"                     \
+        "jl 1b                          \n"                     \
+        : [x]"+&r"(x), [tmp]"=&r"(tmp)                          \
+        : [d]"r"(dst + 4 * w), [s]"r"(src + 4 * w),             \
+          [mask]"m"(*alpha_mask),                               \
+          [pw_128]"m"(*pw_128), [pw_255]"m"(*pw_255),           \
+          [pw_257]"m"(*pw_257),                                 \
+          [ps_255]"m"(*ps_255), [ps_65025]"m"(*ps_65025)        \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",      \
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)     \
+          "memory"                                              \
+    )
+
+#define EXTRACT_ALPHA0(reg)                    \
+        "pslld         $24, "reg"       \n"    \
+        "psrld         $24, "reg"       \n"
+#define EXTRACT_ALPHA3(reg)                    \
+        "psrld         $24, "reg"       \n"
+
+static void overlay_blend_packed_row_sse2(uint8_t *dst, const uint8_t *src,
+                                          int w, int alpha_pos)
+{
+    intptr_t x, tmp;
+
+    if (alpha_pos != 0 && alpha_pos != 3) {
+        ff_overlay_blend_packed_row_c(dst, src, w, alpha_pos);
+        return;
+    }
+    if (w & 3) {
+        x = w & ~3;
+        ff_overlay_blend_packed_row_c(dst + 4 * x, src + 4 * x, w - x, alpha_pos);
+        w = x;
+    }
+    if (!w)
+        return;
+    x = -4 * w;
+    if (alpha_pos)
+        BLEND_PACKED(EXTRACT_ALPHA3, pd_alpha3);
+    else
+        BLEND_PACKED(EXTRACT_ALPHA0, pd_alpha0);
+}
+#endif /* HAVE_6REGS */
+
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+/* Jump to label 2 if all the bytes of reg are zero. */
+#define SKIP_IF_ZERO_AVX2(reg)                 \
+        "vptest     "reg", "reg"        \n"    \
+        "jz 2f                          \n"
+
+/* ymm6 = 255, ymm7 = 0, ymm8 = 128 and ymm9 = 257 in words */
+#define LOAD_CONSTS_AVX2                       \
+        "vpxor      %%ymm7, %%ymm7, %%ymm7 \n" \
+        "vpbroadcastw %[pw_255], %%ymm6 \n"    \
+        "vpbroadcastw %[pw_128], %%ymm8 \n"    \
+        "vpbroadcastw %[pw_257], %%ymm9 \n"
+
+/* BLEND_16 for 32 bytes, the unpacks and the final pack are all within
+ * 128-bit lanes so that the bytes come back in order. */
+#define BLEND_32                                            \
+        "vpunpcklbw %%ymm7, %%ymm0, %%ymm3  \n"             \
+        "vpunpcklbw %%ymm7, %%ymm1, %%ymm4  \n"             \
+        "vpunpcklbw %%ymm7, %%ymm2, %%ymm5  \n"             \
+        "vpmullw    %%ymm5, %%ymm4, %%ymm4  \n"             \
+        "vpxor      %%ymm6, %%ymm5, %%ymm5  \n"             \
+        "vpmullw    %%ymm5, %%ymm3, %%ymm3  \n"             \
+        "vpaddw     %%ymm4, %%ymm3, %%ymm3  \n"             \
+        "vpaddw     %%ymm8, %%ymm3, %%ymm3  \n"             \
+        "vpmulhuw   %%ymm9, %%ymm3, %%ymm3  \n"             \
+        "vpunpckhbw %%ymm7, %%ymm0, %%ymm0  \n"             \
+        "vpunpckhbw %%ymm7, %%ymm1, %%ymm1  \n"             \
+        "vpunpckhbw %%ymm7, %%ymm2, %%ymm2  \n"             \
+        "vpmullw    %%ymm2, %%ymm1, %%ymm1  \n"             \
+        "vpxor      %%ymm6, %%ymm2, %%ymm2  \n"             \
+        "vpmullw    %%ymm2, %%ymm0, %%ymm0  \n"             \
+        "vpaddw     %%ymm1, %%ymm0, %%ymm0  \n"             \
+        "vpaddw     %%ymm8, %%ymm0, %%ymm0  \n"             \
+        "vpmulhuw   %%ymm9, %%ymm0, %%ymm0  \n"             \
+        "vpackuswb  %%ymm0, %%ymm3, %%ymm3  \n"
+
+#define AVX2_CLOBBERS                                           \
+        XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",        \
+                     "%xmm4", "%xmm5", "%xmm6", "%xmm7",        \
+                     "%xmm8", "%xmm9", "%xmm10", "%xmm11",      \
+                     "%xmm12",)                                 \
+        "memory"
+
+static void overlay_blend_row_avx2(uint8_t *dst, const uint8_t *src,
+                                   const uint8_t *alpha, int w)
+{
+    intptr_t x;
+
+    if (w & 31) {
+        x = w & ~31;
+        overlay_blend_row_sse2(dst + x, src + x, alpha + x, w - x);
+        w = x;
+    }
+    if (!w)
+        return;
+    x = -w;
+    __asm__ volatile(
+        LOAD_CONSTS_AVX2
+        "1:                             \n"
+        "vmovdqu (%[a],%[x]), %%ymm2    \n"
+        SKIP_IF_ZERO_AVX2("%%ymm2")
+        "vmovdqu (%[d],%[x]), %%ymm0    \n"
+        "vmovdqu (%[s],%[x]), %%ymm1    \n"
+        BLEND_32
+        "vmovdqu    %%ymm3, (%[d],%[x]) \n"
+        "2:                             \n"
+        "add           $32, %[x]        \n"
+        "jl 1b                          \n"
+        "vzeroupper                     \n"
+        : [x]"+&r"(x)
+        : [d]"r"(dst + w), [s]"r"(src + w), [a]"r"(alpha + w),
+          [pw_128]"m"(*pw_128), [pw_255]"m"(*pw_255), [pw_257]"m"(*pw_257)
+        : AVX2_CLOBBERS
+    );
+}
+
+static void overlay_blend_alpha_row_avx2(uint8_t *dst, const uint8_t *alpha, int w)
+{
+    intptr_t x;
+
+    if (w & 31) {
+        x = w & ~31;
+        overlay_blend_alpha_row_sse2(dst + x, alpha + x, w - x);
+        w = x;
+    }
+    if (!w)
+        return;
+    x = -w;
+    __asm__ volatile(
+        LOAD_CONSTS_AVX2
+        "1:                             \n"
+        "vmovdqu (%[a],%[x]), %%ymm2    \n"
+        SKIP_IF_ZERO_AVX2("%%ymm2")
+        "vmovdqu (%[d],%[x]), %%ymm0    \n"
+        "vpcmpeqb   %%ymm1, %%ymm1, %%ymm1 \n"
+        BLEND_32
+        "vmovdqu    %%ymm3, (%[d],%[x]) \n"
+        "2:                             \n"
+        "add           $32, %[x]        \n"
+        "jl 1b                          \n"
+        "vzeroupper                     \n"
+        : [x]"+&r"(x)
+        : [d]"r"(dst + w), [a]"r"(alpha + w),
+          [pw_128]"m"(*pw_128), [pw_255]"m"(*pw_255), [pw_257]"m"(*pw_257)
+        : AVX2_CLOBBERS
+    );
+}
+
+static void overlay_blend_row_sub_avx2(uint8_t *dst, const uint8_t *src,
+                                       const uint8_t *alpha,
+                                       ptrdiff_t alpha_linesize, int w)
+{
+    intptr_t x;
+
+    if (w & 15) {
+        x = w & ~15;
+        overlay_blend_row_sub_sse2(dst + x, src + x, alpha + 2 * x,
+                                   alpha_linesize, w - x);
+        w = x;
+    }
+    if (!w)
+        return;
+    x = -w;
+    __asm__ volatile(
+        LOAD_CONSTS_AVX2
+        "1:                             \n"
+        "vmovdqu (%[a0],%[x],2), %%ymm1 \n"
+        "vmovdqu (%[a1],%[x],2), %%ymm2 \n"
+        "vpor       %%ymm2, %%ymm1, %%ymm4 \n"
+        SKIP_IF_ZERO_AVX2("%%ymm4")
+        "vpand      %%ymm6, %%ymm1, %%ymm4 \n" // average the 2x2 alpha blocks
+        "vpand      %%ymm6, %%ymm2, %%ymm5 \n"
+        "vpsrlw         $8, %%ymm1, %%ymm1 \n"
+        "vpsrlw         $8, %%ymm2, %%ymm2 \n"
+        "vpaddw     %%ymm4, %%ymm1, %%ymm1 \n"
+        "vpaddw     %%ymm5, %%ymm2, %%ymm2 \n"
+        "vpaddw     %%ymm1, %%ymm2, %%ymm2 \n"
+        "vpsrlw         $2, %%ymm2, %%ymm2 \n"
+        "vpmovzxbw (%[d],%[x]), %%ymm0  \n"
+        "vpmovzxbw (%[s],%[x]), %%ymm1  \n"
+        "vpmullw    %%ymm2, %%ymm1, %%ymm1 \n"
+        "vpxor      %%ymm6, %%ymm2, %%ymm2 \n"
+        "vpmullw    %%ymm2, %%ymm0, %%ymm0 \n"
+        "vpaddw     %%ymm1, %%ymm0, %%ymm0 \n"
+        "vpaddw     %%ymm8, %%ymm0, %%ymm0 \n"
+        "vpmulhuw   %%ymm9, %%ymm0, %%ymm0 \n"
+        "vpackuswb  %%ymm0, %%ymm0, %%ymm0 \n"
+        "vpermq  $0x08, %%ymm0, %%ymm0  \n"
+        "vmovdqu    %%xmm0, (%[d],%[x]) \n"
+        "2:                             \n"
+        "add           $16, %[x]        \n"
+        "jl 1b                          \n"
+        "vzeroupper                     \n"
+        : [x]"+&r"(x)
+        : [d]"r"(dst + w), [s]"r"(src + w),
+          [a0]"r"(alpha + 2 * w), [a1]"r"(alpha + 2 * w + alpha_linesize),
+          [pw_128]"m"(*pw_128), [pw_255]"m"(*pw_255), [pw_257]"m"(*pw_257)
+        : AVX2_CLOBBERS
+    );
+}
+
+/* BLEND_PACKED for 8 pixels, ymm10 holds the alpha mask */
+#define BLEND_PACKED_AVX2(extract_alpha, alpha_mask)                    \
+    __asm__ volatile(                                                   \
+        LOAD_CONSTS_AVX2                                                \
+        "vpbroadcastd  %[mask], %%ymm10 \n"                             \
+        "vbroadcastss  %[ps_255], %%ymm11 \n"                           \
+        "vbroadcastss  %[ps_65025], %%ymm12 \n"                         \
+        "1:                             \n"                             \
+        "vmovdqu (%[s],%[x]), %%ymm1    \n"                             \
+        "vpand     %%ymm10, %%ymm1, %%ymm2 \n"                          \
+        SKIP_IF_ZERO_AVX2("%%ymm2")                                     \
+        "vmovdqu (%[d],%[x]), %%ymm0    \n"                             \
+        extract_alpha("%%ymm1", "%%ymm2")                               \
+        extract_alpha("%%ymm0", "%%ymm3")                               \
+        "vmovdqa    %%ymm2, %%ymm5      \n"                             \
+        "vcvtdq2ps  %%ymm2, %%ymm2      \n"                             \
+        "vcvtdq2ps  %%ymm3, %%ymm3      \n"                             \
+        "vmulps     %%ymm3, %%ymm2, %%ymm4 \n" /* sa * da       */      \
+        "vaddps     %%ymm2, %%ymm3, %%ymm3 \n"                          \
+        "vmulps    %%ymm11, %%ymm3, %%ymm3 \n"                          \
+        "vsubps     %%ymm4, %%ymm3, %%ymm3 \n"                          \
+        "vmulps    %%ymm12, %%ymm2, %%ymm2 \n"                          \
+        "vdivps     %%ymm3, %%ymm2, %%ymm2 \n"                          \
+        "vcvttps2dq %%ymm2, %%ymm2      \n"                             \
+        "vpcmpeqd   %%ymm7, %%ymm5, %%ymm5 \n"                          \
+        "vpandn     %%ymm2, %%ymm5, %%ymm5 \n" /* straight alpha */     \
+        "vpslld         $8, %%ymm5, %%ymm2 \n"                          \
+        "vpor       %%ymm2, %%ymm5, %%ymm5 \n"                          \
+        "vpslld        $16, %%ymm5, %%ymm2 \n"                          \
+        "vpor       %%ymm5, %%ymm2, %%ymm2 \n"                          \
+        "vpandn     %%ymm2, %%ymm10, %%ymm4 \n"                         \
+        "vpand     %%ymm10, %%ymm1, %%ymm2 \n"                          \
+        "vpor       %%ymm4, %%ymm2, %%ymm2 \n"                          \
+        "vpor      %%ymm10, %%ymm1, %%ymm1 \n"                          \
+        BLEND_32                                                        \
+        "vmovdqu    %%ymm3, (%[d],%[x]) \n"                             \
+        "2:                             \n"                             \
+        "add           $32, %[x]        \n"                             \
+        "jl 1b                          \n"                             \
+        "vzeroupper                     \n"                             \
+        : [x]"+&r"(x)                                                   \
+        : [d]"r"(dst + 4 * w), [s]"r"(src + 4 * w),                     \
+          [mask]"m"(*alpha_mask),                                       \
+          [pw_128]"m"(*pw_128), [pw_255]"m"(*pw_255),                   \
+          [pw_257]"m"(*pw_257),                                         \
+          [ps_255]"m"(*ps_255), [ps_65025]"m"(*ps_65025)                \
+        : AVX2_CLOBBERS                                                 \
+    )
+
+#define EXTRACT_ALPHA0_AVX2(src, dst)          \
+        "vpslld        $24, "src", "dst" \n"   \
+        "vpsrld        $24, "dst", "dst" \n"
+#define EXTRACT_ALPHA3_AVX2(src, dst)          \
+        "vpsrld        $24, "src", "dst" \n"
+
+static void overlay_blend_packed_row_avx2(uint8_t *dst, const uint8_t *src,
+                                          int w, int alpha_pos)
+{
+    intptr_t x;
+
+    if (alpha_pos != 0 && alpha_pos != 3) {
+        ff_overlay_blend_packed_row_c(dst, src, w, alpha_pos);
+        return;
+    }
+    if (w & 7) {
+        x = w & ~7;
+        overlay_blend_packed_row_sse2(dst + 4 * x, src + 4 * x, w - x, alpha_pos);
+        w = x;
+    }
+    if (!w)
+        return;
+    x = -4 * w;
+    if (alpha_pos)
+        BLEND_PACKED_AVX2(EXTRACT_ALPHA3_AVX2, pd_alpha3);
+    else
+        BLEND_PACKED_AVX2(EXTRACT_ALPHA0_AVX2, pd_alpha0);
+}
+#endif /* HAVE_AVX2_INLINE && ARCH_X86_64 */
+
+#endif /* HAVE_SSE2_INLINE */
+
+av_cold void ff_overlay_init_x86(OverlayDSPContext *dsp)
+{
+#if HAVE_SSE2_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        dsp->blend_row        = overlay_blend_row_sse2;
+        dsp->blend_alpha_row  = overlay_blend_alpha_row_sse2;
+#if HAVE_6REGS
+        dsp->blend_row_sub    = overlay_blend_row_sub_sse2;
+        dsp->blend_packed_row = overlay_blend_packed_row_sse2;
+#endif
+    }
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+    if (INLINE_AVX2(cpu_flags)) {
+        dsp->blend_row        = overlay_blend_row_avx2;
+        dsp->blend_alpha_row  = overlay_blend_alpha_row_avx2;
+        dsp->blend_row_sub    = overlay_blend_row_sub_avx2;
+        dsp->blend_packed_row = overlay_blend_packed_row_avx2;
+    }
+#endif
+#endif
+}
@@ -0,0 +1,140 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/psnr.h"
+
+#if HAVE_SSE2_INLINE
+static uint64_t sse_line_8_sse2(const uint8_t *buf, const uint8_t *ref, int w)
+{
+    uint64_t m = 0;
+    uint32_t sum;
+    intptr_t x;
+    int i, n;
+
+    /* the 32-bit sum of a chunk can not overflow */
+    for (i = 0; i < (w & ~15); i += n) {
+        n = FFMIN((w & ~15) - i, 1 << 16);
+        x = -n;
+        __asm__ volatile(
+            "pxor      %%xmm6, %%xmm6       \n"
+            "pxor      %%xmm7, %%xmm7       \n"
+            "1:                             \n"
+            "movdqu   (%2,%0), %%xmm0       \n"
+            "movdqu   (%3,%0), %%xmm1       \n"
+            "movdqa    %%xmm0, %%xmm2       \n"
+            "movdqa    %%xmm1, %%xmm3       \n"
+            "punpcklbw %%xmm7, %%xmm0       \n"
+            "punpckhbw %%xmm7, %%xmm2       \n"
+            "punpcklbw %%xmm7, %%xmm1       \n"
+            "punpckhbw %%xmm7, %%xmm3       \n"
+            "psubw     %%xmm1, %%xmm0       \n"
+            "psubw     %%xmm3, %%xmm2       \n"
+            "pmaddwd   %%xmm0, %%xmm0       \n"
+            "pmaddwd   %%xmm2, %%xmm2       \n"
+            "paddd     %%xmm0, %%xmm6       \n"
+            "paddd     %%xmm2, %%xmm6       \n"
+            "add          $16, %0           \n"
+            "jl 1b                          \n"
+            "pshufd $0x0e, %%xmm6, %%xmm0   \n"
+            "paddd     %%xmm0, %%xmm6       \n"
+            "pshufd $0x01, %%xmm6, %%xmm0   \n"
+            "paddd     %%xmm0, %%xmm6       \n"
+            "movd      %%xmm6, %1           \n"
+            : "+&r"(x), "=r"(sum)
+            : "r"(buf + i + n), "r"(ref + i + n)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                           "%xmm6", "%xmm7",)
+              "memory"
+        );
+        m += sum;
+    }
+    for (; i < w; i++)
+        m += (buf[i] - ref[i]) * (buf[i] - ref[i]);
+
+    return m;
+}
+#if HAVE_AVX2_INLINE
+static uint64_t sse_line_8_avx2(const uint8_t *buf, const uint8_t *ref, int w)
+{
+    uint64_t m = 0;
+    uint32_t sum;
+    intptr_t x;
+    int i, n;
+
+    for (i = 0; i < (w & ~31); i += n) {
+        n = FFMIN((w & ~31) - i, 1 << 16);
+        x = -n;
+        __asm__ volatile(
+            "vpxor     %%ymm6, %%ymm6, %%ymm6 \n"
+            "vpxor     %%ymm7, %%ymm7, %%ymm7 \n"
+            "1:                             \n"
+            "vpmovzxbw   (%2,%0), %%ymm0    \n"
+            "vpmovzxbw 16(%2,%0), %%ymm2    \n"
+            "vpmovzxbw   (%3,%0), %%ymm1    \n"
+            "vpmovzxbw 16(%3,%0), %%ymm3    \n"
+            "vpsubw    %%ymm1, %%ymm0, %%ymm0 \n"
+            "vpsubw    %%ymm3, %%ymm2, %%ymm2 \n"
+            "vpmaddwd  %%ymm0, %%ymm0, %%ymm0 \n"
+            "vpmaddwd  %%ymm2, %%ymm2, %%ymm2 \n"
+            "vpaddd    %%ymm0, %%ymm6, %%ymm6 \n"
+            "vpaddd    %%ymm2, %%ymm7, %%ymm7 \n"
+            "add          $32, %0           \n"
+            "jl 1b                          \n"
+            "vpaddd    %%ymm7, %%ymm6, %%ymm6 \n"
+            "vextracti128 $1, %%ymm6, %%xmm0 \n"
+            "vpaddd    %%xmm0, %%xmm6, %%xmm6 \n"
+            "vpshufd $0x0e, %%xmm6, %%xmm0  \n"
+            "vpaddd    %%xmm0, %%xmm6, %%xmm6 \n"
+            "vpshufd $0x01, %%xmm6, %%xmm0  \n"
+            "vpaddd    %%xmm0, %%xmm6, %%xmm6 \n"
+            "vmovd     %%xmm6, %1           \n"
+            "vzeroupper                     \n"
+            : "+&r"(x), "=r"(sum)
+            : "r"(buf + i + n), "r"(ref + i + n)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                           "%xmm6", "%xmm7",)
+              "memory"
+        );
+        m += sum;
+    }
+    if (i < w)
+        m += sse_line_8_sse2(buf + i, ref + i, w - i);
+
+    return m;
+}
+#endif /* HAVE_AVX2_INLINE */
+#endif /* HAVE_SSE2_INLINE */
+
+av_cold void ff_psnr_init_x86(PSNRDSPContext *dsp, int bpp)
+{
+#if HAVE_SSE2_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2 && bpp <= 8)
+        dsp->sse_line = sse_line_8_sse2;
+#if HAVE_AVX2_INLINE
+    if (INLINE_AVX2(cpu_flags) && bpp <= 8)
+        dsp->sse_line = sse_line_8_avx2;
+#endif
+#endif
+}
@@ -0,0 +1,186 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/ssim.h"
+
+#if HAVE_SSE2_INLINE
+#define SSIM_4X4X2_ROW                                                 \
+    "movq        (%0), %%xmm0       \n"                                \
+    "movq        (%1), %%xmm1       \n"                                \
+    "add          %2, %0            \n"                                \
+    "add          %3, %1            \n"                                \
+    "punpcklbw %%xmm7, %%xmm0       \n"                                \
+    "punpcklbw %%xmm7, %%xmm1       \n"                                \
+    "paddw     %%xmm0, %%xmm4       \n" /* s1 */                       \
+    "paddw     %%xmm1, %%xmm5       \n" /* s2 */                       \
+    "movdqa    %%xmm0, %%xmm2       \n"                                \
+    "pmaddwd   %%xmm1, %%xmm2       \n"                                \
+    "paddd     %%xmm2, %%xmm3       \n" /* s12 */                      \
+    "pmaddwd   %%xmm0, %%xmm0       \n"                                \
+    "pmaddwd   %%xmm1, %%xmm1       \n"                                \
+    "paddd     %%xmm0, %%xmm6       \n" /* ss */                       \
+    "paddd     %%xmm1, %%xmm6       \n"
+
+/* sums of two horizontally adjacent 4x4 blocks */
+static void ssim_4x4x2_sse2(const uint8_t *main, ptrdiff_t main_stride,
+                            const uint8_t *ref, ptrdiff_t ref_stride,
+                            int (*sums)[4])
+{
+    __asm__ volatile(
+        "pxor      %%xmm3, %%xmm3       \n"
+        "pxor      %%xmm4, %%xmm4       \n"
+        "pxor      %%xmm5, %%xmm5       \n"
+        "pxor      %%xmm6, %%xmm6       \n"
+        "pxor      %%xmm7, %%xmm7       \n"
+        SSIM_4X4X2_ROW
+        SSIM_4X4X2_ROW
+        SSIM_4X4X2_ROW
+        SSIM_4X4X2_ROW
+        /* each accumulator holds 2 partial sums per block, add and
+         * transpose them to s1, s2, ss, s12 of each block */
+        "pcmpeqw   %%xmm7, %%xmm7       \n"
+        "psrlw        $15, %%xmm7       \n"
+        "pmaddwd   %%xmm7, %%xmm4       \n"
+        "pmaddwd   %%xmm7, %%xmm5       \n"
+        "movdqa    %%xmm4, %%xmm0       \n"
+        "punpckldq %%xmm5, %%xmm4       \n"
+        "punpckhdq %%xmm5, %%xmm0       \n"
+        "movdqa    %%xmm6, %%xmm1       \n"
+        "punpckldq %%xmm3, %%xmm6       \n"
+        "punpckhdq %%xmm3, %%xmm1       \n"
+        "movdqa    %%xmm4, %%xmm2       \n"
+        "punpcklqdq %%xmm6, %%xmm4      \n"
+        "punpckhqdq %%xmm6, %%xmm2      \n"
+        "paddd     %%xmm2, %%xmm4       \n"
+        "movdqa    %%xmm0, %%xmm2       \n"
+        "punpcklqdq %%xmm1, %%xmm0      \n"
+        "punpckhqdq %%xmm1, %%xmm2      \n"
+        "paddd     %%xmm2, %%xmm0       \n"
+        "movdqu    %%xmm4,   (%4)       \n"
+        "movdqu    %%xmm0, 16(%4)       \n"
+        : "+&r"(main), "+&r"(ref)
+        : "r"(main_stride), "r"(ref_stride), "r"(sums)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+
+static void ssim_4x4_line_sse2(const uint8_t *main, ptrdiff_t main_stride,
+                               const uint8_t *ref, ptrdiff_t ref_stride,
+                               int (*sums)[4], int w)
+{
+    int z;
+
+    for (z = 0; z < (w & ~1); z += 2)
+        ssim_4x4x2_sse2(main + 4 * z, main_stride, ref + 4 * z, ref_stride,
+                        sums + z);
+    if (w & 1)
+        ff_ssim_4x4_line_c(main + 4 * z, main_stride, ref + 4 * z, ref_stride,
+                           sums + z, 1);
+}
+#if HAVE_AVX2_INLINE
+#define SSIM_4X4X4_ROW                                                 \
+    "vpmovzxbw   (%0), %%ymm0       \n"                                \
+    "vpmovzxbw   (%1), %%ymm1       \n"                                \
+    "add          %2, %0            \n"                                \
+    "add          %3, %1            \n"                                \
+    "vpaddw    %%ymm0, %%ymm4, %%ymm4 \n" /* s1 */                     \
+    "vpaddw    %%ymm1, %%ymm5, %%ymm5 \n" /* s2 */                     \
+    "vpmaddwd  %%ymm1, %%ymm0, %%ymm2 \n"                              \
+    "vpaddd    %%ymm2, %%ymm3, %%ymm3 \n" /* s12 */                    \
+    "vpmaddwd  %%ymm0, %%ymm0, %%ymm0 \n"                              \
+    "vpmaddwd  %%ymm1, %%ymm1, %%ymm1 \n"                              \
+    "vpaddd    %%ymm0, %%ymm6, %%ymm6 \n" /* ss */                     \
+    "vpaddd    %%ymm1, %%ymm6, %%ymm6 \n"
+
+/* sums of four horizontally adjacent 4x4 blocks, the transpose of
+ * ssim_4x4x2_sse2 leaves blocks 0 and 2 in ymm4, 1 and 3 in ymm0 */
+static void ssim_4x4x4_avx2(const uint8_t *main, ptrdiff_t main_stride,
+                            const uint8_t *ref, ptrdiff_t ref_stride,
+                            int (*sums)[4])
+{
+    __asm__ volatile(
+        "vpxor     %%ymm3, %%ymm3, %%ymm3 \n"
+        "vpxor     %%ymm4, %%ymm4, %%ymm4 \n"
+        "vpxor     %%ymm5, %%ymm5, %%ymm5 \n"
+        "vpxor     %%ymm6, %%ymm6, %%ymm6 \n"
+        SSIM_4X4X4_ROW
+        SSIM_4X4X4_ROW
+        SSIM_4X4X4_ROW
+        SSIM_4X4X4_ROW
+        "vpcmpeqw  %%ymm7, %%ymm7, %%ymm7 \n"
+        "vpsrlw       $15, %%ymm7, %%ymm7 \n"
+        "vpmaddwd  %%ymm7, %%ymm4, %%ymm4 \n"
+        "vpmaddwd  %%ymm7, %%ymm5, %%ymm5 \n"
+        "vpunpckhdq %%ymm5, %%ymm4, %%ymm0 \n"
+        "vpunpckldq %%ymm5, %%ymm4, %%ymm4 \n"
+        "vpunpckhdq %%ymm3, %%ymm6, %%ymm1 \n"
+        "vpunpckldq %%ymm3, %%ymm6, %%ymm6 \n"
+        "vpunpckhqdq %%ymm6, %%ymm4, %%ymm2 \n"
+        "vpunpcklqdq %%ymm6, %%ymm4, %%ymm4 \n"
+        "vpaddd    %%ymm2, %%ymm4, %%ymm4 \n"
+        "vpunpckhqdq %%ymm1, %%ymm0, %%ymm2 \n"
+        "vpunpcklqdq %%ymm1, %%ymm0, %%ymm0 \n"
+        "vpaddd    %%ymm2, %%ymm0, %%ymm0 \n"
+        "vperm2i128 $0x20, %%ymm0, %%ymm4, %%ymm1 \n"
+        "vperm2i128 $0x31, %%ymm0, %%ymm4, %%ymm2 \n"
+        "vmovdqu   %%ymm1,   (%4)       \n"
+        "vmovdqu   %%ymm2, 32(%4)       \n"
+        "vzeroupper                     \n"
+        : "+&r"(main), "+&r"(ref)
+        : "r"(main_stride), "r"(ref_stride), "r"(sums)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+
+static void ssim_4x4_line_avx2(const uint8_t *main, ptrdiff_t main_stride,
+                               const uint8_t *ref, ptrdiff_t ref_stride,
+                               int (*sums)[4], int w)
+{
+    int z;
+
+    for (z = 0; z < (w & ~3); z += 4)
+        ssim_4x4x4_avx2(main + 4 * z, main_stride, ref + 4 * z, ref_stride,
+                        sums + z);
+    if (w & 3)
+        ssim_4x4_line_sse2(main + 4 * z, main_stride, ref + 4 * z, ref_stride,
+                           sums + z, w & 3);
+}
+#endif /* HAVE_AVX2_INLINE */
+#endif /* HAVE_SSE2_INLINE */
+
+av_cold void ff_ssim_init_x86(SSIMDSPContext *dsp)
+{
+#if HAVE_SSE2_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2)
+        dsp->ssim_4x4_line = ssim_4x4_line_sse2;
+#if HAVE_AVX2_INLINE
+    if (INLINE_AVX2(cpu_flags))
+        dsp->ssim_4x4_line = ssim_4x4_line_avx2;
+#endif
+#endif
+}
@@ -0,0 +1,309 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/unsharp.h"
+
+#if HAVE_SSE2_INLINE
+static void unsharp_blur_line_h_sse2(uint32_t *sr, int width)
+{
+    const int tail = width & 7;
+    intptr_t x;
+
+    width -= tail;
+    if (width) {
+        x = -4 * width;
+        /* sr[x + 8] is only written by the next iteration, and the tail
+         * after the whole loop */
+        __asm__ volatile(
+            "1:                             \n"
+            "movdqu   (%1,%0), %%xmm0       \n"
+            "movdqu 16(%1,%0), %%xmm1       \n"
+            "movdqu  4(%1,%0), %%xmm2       \n"
+            "movdqu 20(%1,%0), %%xmm3       \n"
+            "paddd     %%xmm2, %%xmm0       \n"
+            "paddd     %%xmm3, %%xmm1       \n"
+            "movdqu    %%xmm0,   (%1,%0)    \n"
+            "movdqu    %%xmm1, 16(%1,%0)    \n"
+            "add          $32, %0           \n"
+            "jl 1b                          \n"
+            : "+&r"(x)
+            : "r"(sr + width)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)
+              "memory"
+        );
+    }
+    if (tail)
+        ff_unsharp_blur_line_h_c(sr + width, tail);
+}
+
+/* the rows of sc are walked for each block of columns, so that the block of
+ * sr stays in registers */
+static void unsharp_blur_lines_v_sse2(uint32_t *sr, uint32_t *sc, ptrdiff_t sc_stride,
+                                      int nb_lines, int width)
+{
+    intptr_t x, z;
+    uint32_t *p;
+
+    if (width & 7) {
+        x = width & ~7;
+        ff_unsharp_blur_lines_v_c(sr + x, sc + x, sc_stride, nb_lines, width - x);
+        width = x;
+    }
+    if (!width || !nb_lines)
+        return;
+    x = -4 * width;
+    __asm__ volatile(
+        "1:                             \n"
+        "movdqu   (%[sr],%[x]), %%xmm0  \n"
+        "movdqu 16(%[sr],%[x]), %%xmm1  \n"
+        "mov         %[sc], %[p]        \n"
+        "mov          %[n], %[z]        \n"
+        "2:                             \n"
+        "movdqu    (%[p],%[x]), %%xmm2  \n"
+        "movdqu  16(%[p],%[x]), %%xmm3  \n"
+        "movdqu    %%xmm0,   (%[p],%[x]) \n"
+        "movdqu    %%xmm1, 16(%[p],%[x]) \n"
+        "paddd     %%xmm2, %%xmm0       \n"
+        "paddd     %%xmm3, %%xmm1       \n"
+        "add     %[stride], %[p]        \n"
+        "dec          %[z]              \n"
+        "jg 2b                          \n"
+        "movdqu    %%xmm0,   (%[sr],%[x]) \n"
+        "movdqu    %%xmm1, 16(%[sr],%[x]) \n"
+        "add          $32, %[x]         \n"
+        "jl 1b                          \n"
+        : [x]"+&r"(x), [p]"=&r"(p), [z]"=&r"(z)
+        : [sr]"r"(sr + width), [sc]"r"(sc + width),
+          [stride]"rm"((x86_reg)(4 * sc_stride)), [n]"rm"((x86_reg)nb_lines)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)
+          "memory"
+    );
+}
+
+/*
+ * amount is split as amount_hi * 65536 + amount_lo with amount_lo a signed
+ * 16-bit value, so that (diff * amount) >> 16 is computed exactly as
+ * diff * amount_hi + ((diff * amount_lo) >> 16) with 16-bit multiplies.
+ */
+static void unsharp_line_sse2(uint8_t *dst, const uint8_t *src, const uint32_t *sr,
+                              int width, int32_t halfscale, int scalebits, int amount)
+{
+    const int amount_hi = (amount + 32768) >> 16;
+    const int amount_lo = amount - amount_hi * 65536;
+    intptr_t x;
+
+    /* no shift of 32 bits or more in SSE2 matches the C code */
+    if ((width & 7) || scalebits > 31) {
+        x = scalebits > 31 ? 0 : width & ~7;
+        ff_unsharp_line_c(dst + x, src + x, sr + x, width - x,
+                          halfscale, scalebits, amount);
+        width = x;
+    }
+    if (!width)
+        return;
+    x = -width;
+    __asm__ volatile(
+        "movd         %4, %%xmm4        \n"
+        "pshufd $0,%%xmm4, %%xmm4       \n" // halfscale
+        "movd         %5, %%xmm5        \n" // scalebits
+        "movd         %6, %%xmm6        \n"
+        "pshuflw $0,%%xmm6, %%xmm6      \n"
+        "punpcklqdq %%xmm6, %%xmm6      \n" // amount_hi
+        "movd         %7, %%xmm7        \n"
+        "pshuflw $0,%%xmm7, %%xmm7      \n"
+        "punpcklqdq %%xmm7, %%xmm7      \n" // amount_lo
+        "1:                             \n"
+        "movdqu   (%3,%0,4), %%xmm0     \n"
+        "movdqu 16(%3,%0,4), %%xmm1     \n"
+        "paddd    %%xmm4, %%xmm0        \n"
+        "paddd    %%xmm4, %%xmm1        \n"
+        "psrld    %%xmm5, %%xmm0        \n"
+        "psrld    %%xmm5, %%xmm1        \n"
+        "packssdw %%xmm1, %%xmm0        \n" // blurred pixels
+        "movq    (%2,%0), %%xmm1        \n"
+        "pxor     %%xmm2, %%xmm2        \n"
+        "punpcklbw %%xmm2, %%xmm1       \n"
+        "movdqa   %%xmm1, %%xmm2        \n"
+        "psubw    %%xmm0, %%xmm2        \n" // diff = src - blurred
+        "movdqa   %%xmm2, %%xmm3        \n"
+        "pmullw   %%xmm6, %%xmm2        \n"
+        "pmulhw   %%xmm7, %%xmm3        \n"
+        "paddw    %%xmm2, %%xmm1        \n"
+        "paddw    %%xmm3, %%xmm1        \n"
+        "packuswb %%xmm1, %%xmm1        \n"
+        "movq     %%xmm1, (%1,%0)       \n"
+        "add          $8, %0            \n"
+        "jl 1b                          \n"
+        : "+&r"(x)
+        : "r"(dst + width), "r"(src + width), "r"(sr + width),
+          "rm"(halfscale), "rm"(scalebits), "rm"(amount_hi), "rm"(amount_lo)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+
+#if HAVE_AVX2_INLINE
+static void unsharp_blur_line_h_avx2(uint32_t *sr, int width)
+{
+    const int tail = width & 15;
+    intptr_t x;
+
+    width -= tail;
+    if (width) {
+        x = -4 * width;
+        __asm__ volatile(
+            "1:                             \n"
+            "vmovdqu   (%1,%0), %%ymm0      \n"
+            "vmovdqu 32(%1,%0), %%ymm1      \n"
+            "vpaddd   4(%1,%0), %%ymm0, %%ymm0 \n"
+            "vpaddd  36(%1,%0), %%ymm1, %%ymm1 \n"
+            "vmovdqu    %%ymm0,   (%1,%0)   \n"
+            "vmovdqu    %%ymm1, 32(%1,%0)   \n"
+            "add           $64, %0          \n"
+            "jl 1b                          \n"
+            "vzeroupper                     \n"
+            : "+&r"(x)
+            : "r"(sr + width)
+            : XMM_CLOBBERS("%xmm0", "%xmm1",)
+              "memory"
+        );
+    }
+    if (tail)
+        unsharp_blur_line_h_sse2(sr + width, tail);
+}
+
+static void unsharp_blur_lines_v_avx2(uint32_t *sr, uint32_t *sc, ptrdiff_t sc_stride,
+                                      int nb_lines, int width)
+{
+    intptr_t x, z;
+    uint32_t *p;
+
+    if (width & 15) {
+        x = width & ~15;
+        unsharp_blur_lines_v_sse2(sr + x, sc + x, sc_stride, nb_lines, width - x);
+        width = x;
+    }
+    if (!width || !nb_lines)
+        return;
+    x = -4 * width;
+    __asm__ volatile(
+        "1:                             \n"
+        "vmovdqu   (%[sr],%[x]), %%ymm0 \n"
+        "vmovdqu 32(%[sr],%[x]), %%ymm1 \n"
+        "mov         %[sc], %[p]        \n"
+        "mov          %[n], %[z]        \n"
+        "2:                             \n"
+        "vmovdqu    (%[p],%[x]), %%ymm2 \n"
+        "vmovdqu  32(%[p],%[x]), %%ymm3 \n"
+        "vmovdqu    %%ymm0,   (%[p],%[x]) \n"
+        "vmovdqu    %%ymm1, 32(%[p],%[x]) \n"
+        "vpaddd     %%ymm2, %%ymm0, %%ymm0 \n"
+        "vpaddd     %%ymm3, %%ymm1, %%ymm1 \n"
+        "add     %[stride], %[p]        \n"
+        "dec          %[z]              \n"
+        "jg 2b                          \n"
+        "vmovdqu    %%ymm0,   (%[sr],%[x]) \n"
+        "vmovdqu    %%ymm1, 32(%[sr],%[x]) \n"
+        "add           $64, %[x]        \n"
+        "jl 1b                          \n"
+        "vzeroupper                     \n"
+        : [x]"+&r"(x), [p]"=&r"(p), [z]"=&r"(z)
+        : [sr]"r"(sr + width), [sc]"r"(sc + width),
+          [stride]"rm"((x86_reg)(4 * sc_stride)), [n]"rm"((x86_reg)nb_lines)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)
+          "memory"
+    );
+}
+
+/* unsharp_line_sse2 for 16 pixels, the in-lane packs are put back in order
+ * with vpermq */
+static void unsharp_line_avx2(uint8_t *dst, const uint8_t *src, const uint32_t *sr,
+                              int width, int32_t halfscale, int scalebits, int amount)
+{
+    const int amount_hi = (amount + 32768) >> 16;
+    const int amount_lo = amount - amount_hi * 65536;
+    intptr_t x;
+
+    if ((width & 15) || scalebits > 31) {
+        x = scalebits > 31 ? 0 : width & ~15;
+        unsharp_line_sse2(dst + x, src + x, sr + x, width - x,
+                          halfscale, scalebits, amount);
+        width = x;
+    }
+    if (!width)
+        return;
+    x = -width;
+    __asm__ volatile(
+        "vpbroadcastd %4, %%ymm4        \n" // halfscale
+        "vmovd        %5, %%xmm5        \n" // scalebits
+        "vpbroadcastw %6, %%ymm6        \n" // amount_hi
+        "vpbroadcastw %7, %%ymm7        \n" // amount_lo
+        "1:                             \n"
+        "vpaddd   (%3,%0,4), %%ymm4, %%ymm0 \n"
+        "vpaddd 32(%3,%0,4), %%ymm4, %%ymm1 \n"
+        "vpsrld   %%xmm5, %%ymm0, %%ymm0 \n"
+        "vpsrld   %%xmm5, %%ymm1, %%ymm1 \n"
+        "vpackssdw %%ymm1, %%ymm0, %%ymm0 \n"
+        "vpermq $0xd8, %%ymm0, %%ymm0   \n" // blurred pixels
+        "vpmovzxbw (%2,%0), %%ymm1      \n"
+        "vpsubw   %%ymm0, %%ymm1, %%ymm2 \n" // diff = src - blurred
+        "vpmulhw  %%ymm7, %%ymm2, %%ymm3 \n"
+        "vpmullw  %%ymm6, %%ymm2, %%ymm2 \n"
+        "vpaddw   %%ymm2, %%ymm1, %%ymm1 \n"
+        "vpaddw   %%ymm3, %%ymm1, %%ymm1 \n"
+        "vpackuswb %%ymm1, %%ymm1, %%ymm1 \n"
+        "vpermq $0x08, %%ymm1, %%ymm1   \n"
+        "vmovdqu  %%xmm1, (%1,%0)       \n"
+        "add         $16, %0            \n"
+        "jl 1b                          \n"
+        "vzeroupper                     \n"
+        : "+&r"(x)
+        : "r"(dst + width), "r"(src + width), "r"(sr + width),
+          "m"(halfscale), "m"(scalebits), "m"(amount_hi), "m"(amount_lo)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+#endif /* HAVE_AVX2_INLINE */
+#endif /* HAVE_SSE2_INLINE */
+
+av_cold void ff_unsharp_init_x86(UnsharpContext *unsharp)
+{
+#if HAVE_SSE2_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        unsharp->blur_line_h  = unsharp_blur_line_h_sse2;
+        unsharp->blur_lines_v = unsharp_blur_lines_v_sse2;
+        unsharp->unsharp_line = unsharp_line_sse2;
+    }
+#if HAVE_AVX2_INLINE
+    if (INLINE_AVX2(cpu_flags)) {
+        unsharp->blur_line_h  = unsharp_blur_line_h_avx2;
+        unsharp->blur_lines_v = unsharp_blur_lines_v_avx2;
+        unsharp->unsharp_line = unsharp_line_avx2;
+    }
+#endif
+#endif
+}
@@ -0,0 +1,618 @@
+/*
+ * Asynchronous read-ahead protocol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Asynchronous read-ahead protocol.
+ *
+ * A background thread reads the nested protocol into a ring buffer ahead
+ * of the reader, so that I/O latency overlaps with the processing of the
+ * data already read. Seeks inside the buffered window, and short forward
+ * seeks, are served from the ring buffer without touching the nested
+ * protocol.
+ */
+
+#include <pthread.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/opt.h"
+#include "libavutil/time.h"
+#include "url.h"
+
+#define READ_CHUNK_SIZE   32768
+#define SHORT_SEEK_THRESHOLD 65536
+
+typedef struct Context {
+    const AVClass *class;
+    URLContext *inner;
+
+    /* user options */
+    int buffer_size;
+    int read_back_size;
+
+    /* ring buffer, byte at logical position pos is stored at
+       buf[pos % buffer_size] */
+    uint8_t *buf;
+    int64_t start_pos;          /**< oldest position kept in the buffer */
+    int64_t end_pos;            /**< position after the newest byte    */
+    int64_t read_pos;           /**< position of the reader            */
+    int64_t logical_size;
+
+    int io_eof_reached;
+    int io_error;
+
+    int seek_request;
+    int64_t seek_pos;
+    int seek_completed;
+    int64_t seek_ret;
+
+    int abort_request;
+    AVIOInterruptCB interrupt_callback;
+
+    /* statistics */
+    int64_t bytes_read;
+    int nb_underruns;
+    int nb_buffer_seeks;
+    int nb_inner_seeks;
+    int64_t min_fill;           /**< lowest fill level since the last report */
+    int64_t next_fill_report;   /**< read position of the next fill report   */
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_wakeup_main;
+    pthread_cond_t cond_wakeup_background;
+    pthread_t async_buffer_thread;
+} Context;
+
+static int async_check_interrupt(void *arg)
+{
+    URLContext *h = arg;
+    Context *c = h->priv_data;
+
+    if (c->abort_request)
+        return 1;
+
+    if (ff_check_interrupt(&c->interrupt_callback))
+        c->abort_request = 1;
+
+    return c->abort_request;
+}
+
+/**
+ * Return the number of bytes the background thread may write without
+ * overwriting data ahead of the reader or inside the read-back window.
+ */
+static int ring_space(Context *c)
+{
+    int64_t keep = FFMAX(c->start_pos, c->read_pos - c->read_back_size);
+    return c->buffer_size - (c->end_pos - keep);
+}
+
+static void *async_buffer_task(void *arg)
+{
+    URLContext *h = arg;
+    Context *c = h->priv_data;
+
+    while (1) {
+        int64_t end;
+        int space, to_read, ret;
+
+        pthread_mutex_lock(&c->mutex);
+        if (c->abort_request) {
+            pthread_mutex_unlock(&c->mutex);
+            break;
+        }
+
+        if (c->seek_request) {
+            int64_t seek_pos = c->seek_pos;
+
+            pthread_mutex_unlock(&c->mutex);
+            ret = ffurl_seek(c->inner, seek_pos, SEEK_SET);
+            pthread_mutex_lock(&c->mutex);
+
+            if (ret >= 0) {
+                c->start_pos      = ret;
+                c->end_pos        = ret;
+                c->read_pos       = ret;
+                c->io_eof_reached = 0;
+                c->io_error       = 0;
+            }
+            c->seek_ret       = ret;
+            c->seek_request   = 0;
+            c->seek_completed = 1;
+            pthread_cond_signal(&c->cond_wakeup_main);
+            pthread_mutex_unlock(&c->mutex);
+            continue;
+        }
+
+        space = ring_space(c);
+        if (c->io_eof_reached || space <= 0) {
+            pthread_cond_signal(&c->cond_wakeup_main);
+            pthread_cond_wait(&c->cond_wakeup_background, &c->mutex);
+            pthread_mutex_unlock(&c->mutex);
+            continue;
+        }
+
+        /* Reserve the area to be written: the oldest data it overwrites
+           must not be reachable by a backward seek in the meantime. */
+        end     = c->end_pos;
+        to_read = FFMIN3(space, READ_CHUNK_SIZE,
+                         c->buffer_size - (int)(end % c->buffer_size));
+        c->start_pos = FFMAX(c->start_pos, end + to_read - c->buffer_size);
+        pthread_mutex_unlock(&c->mutex);
+
+        ret = ffurl_read(c->inner, c->buf + end % c->buffer_size, to_read);
+
+        pthread_mutex_lock(&c->mutex);
+        if (ret > 0) {
+            c->end_pos += ret;
+        } else {
+            c->io_eof_reached = 1;
+            if (ret < 0 && ret != AVERROR_EOF)
+                c->io_error = ret;
+        }
+        pthread_cond_signal(&c->cond_wakeup_main);
+        pthread_mutex_unlock(&c->mutex);
+    }
+
+    return NULL;
+}
+
+static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
+{
+    Context *c = h->priv_data;
+    AVIOInterruptCB interrupt_callback = { .callback = async_check_interrupt, .opaque = h };
+    int ret;
+
+    av_strstart(arg, "async:", &arg);
+
+    if (c->read_back_size >= c->buffer_size) {
+        av_log(h, AV_LOG_ERROR, "The read-back size must be smaller than "
+               "the buffer size\n");
+        return AVERROR(EINVAL);
+    }
+
+    c->buf = av_malloc(c->buffer_size);
+    if (!c->buf)
+        return AVERROR(ENOMEM);
+
+    /* wrap the interrupt callback */
+    c->interrupt_callback = h->interrupt_callback;
+    ret = ffurl_open(&c->inner, arg, flags, &interrupt_callback, options);
+    if (ret != 0) {
+        av_log(h, AV_LOG_ERROR, "ffurl_open failed : %s, %s\n", av_err2str(ret), arg);
+        goto url_fail;
+    }
+
+    c->logical_size = ffurl_size(c->inner);
+    h->is_streamed  = c->inner->is_streamed;
+
+    ret = pthread_mutex_init(&c->mutex, NULL);
+    if (ret != 0) {
+        av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
+        ret = AVERROR(ret);
+        goto mutex_fail;
+    }
+
+    ret = pthread_cond_init(&c->cond_wakeup_main, NULL);
+    if (ret != 0) {
+        av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", strerror(ret));
+        ret = AVERROR(ret);
+        goto cond_wakeup_main_fail;
+    }
+
+    ret = pthread_cond_init(&c->cond_wakeup_background, NULL);
+    if (ret != 0) {
+        av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", strerror(ret));
+        ret = AVERROR(ret);
+        goto cond_wakeup_background_fail;
+    }
+
+    ret = pthread_create(&c->async_buffer_thread, NULL, async_buffer_task, h);
+    if (ret) {
+        av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", strerror(ret));
+        ret = AVERROR(ret);
+        goto thread_fail;
+    }
+
+    return 0;
+
+thread_fail:
+    pthread_cond_destroy(&c->cond_wakeup_background);
+cond_wakeup_background_fail:
+    pthread_cond_destroy(&c->cond_wakeup_main);
+cond_wakeup_main_fail:
+    pthread_mutex_destroy(&c->mutex);
+mutex_fail:
+    ffurl_close(c->inner);
+url_fail:
+    av_freep(&c->buf);
+    return ret;
+}
+
+static int async_close(URLContext *h)
+{
+    Context *c = h->priv_data;
+    int ret;
+
+    pthread_mutex_lock(&c->mutex);
+    c->abort_request = 1;
+    pthread_cond_signal(&c->cond_wakeup_background);
+    pthread_mutex_unlock(&c->mutex);
+
+    ret = pthread_join(c->async_buffer_thread, NULL);
+    if (ret != 0)
+        av_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", strerror(ret));
+
+    av_log(h, AV_LOG_VERBOSE, "%"PRId64" bytes read, %d buffer underruns, "
+           "%d seeks in buffer, %d seeks in the input\n",
+           c->bytes_read, c->nb_underruns, c->nb_buffer_seeks, c->nb_inner_seeks);
+
+    pthread_cond_destroy(&c->cond_wakeup_background);
+    pthread_cond_destroy(&c->cond_wakeup_main);
+    pthread_mutex_destroy(&c->mutex);
+    ffurl_close(c->inner);
+    av_freep(&c->buf);
+
+    return 0;
+}
+
+/**
+ * Wait until the background thread signals progress, or 10ms elapsed.
+ * Must be called with the mutex locked.
+ */
+static int async_wait(URLContext *h)
+{
+    Context *c = h->priv_data;
+    int64_t t = av_gettime() + 10000;
+    struct timespec tv = { .tv_sec  =  t / 1000000,
+                           .tv_nsec = (t % 1000000) * 1000 };
+
+    if (async_check_interrupt(h))
+        return AVERROR_EXIT;
+    pthread_cond_signal(&c->cond_wakeup_background);
+    pthread_cond_timedwait(&c->cond_wakeup_main, &c->mutex, &tv);
+    return 0;
+}
+
+static int async_read(URLContext *h, unsigned char *buf, int size)
+{
+    Context *c = h->priv_data;
+    int ret, waited = 0;
+
+    if (size <= 0)
+        return 0;
+
+    pthread_mutex_lock(&c->mutex);
+    while (1) {
+        int avail = FFMIN(c->end_pos - c->read_pos, size);
+
+        if (avail > 0) {
+            int offset = c->read_pos % c->buffer_size;
+            int len    = FFMIN(avail, c->buffer_size - offset);
+
+            memcpy(buf, c->buf + offset, len);
+            memcpy(buf + len, c->buf, avail - len);
+            c->read_pos   += avail;
+            c->bytes_read += avail;
+            c->min_fill    = FFMIN(c->min_fill, c->end_pos - c->read_pos);
+            if (c->read_pos >= c->next_fill_report) {
+                av_log(h, AV_LOG_DEBUG, "Buffer fill level %"PRId64", lowest "
+                       "%"PRId64" of %d bytes at %"PRId64"\n", c->end_pos - c->read_pos,
+                       c->min_fill, c->buffer_size, c->read_pos);
+                c->min_fill         = c->end_pos - c->read_pos;
+                c->next_fill_report = c->read_pos + c->buffer_size;
+            }
+            pthread_cond_signal(&c->cond_wakeup_background);
+            ret = avail;
+            break;
+        }
+        if (c->io_eof_reached) {
+            ret = c->io_error ? c->io_error : AVERROR_EOF;
+            break;
+        }
+        if (!waited++) {
+            c->nb_underruns++;
+            av_log(h, AV_LOG_DEBUG, "Buffer empty at %"PRId64", lowest fill "
+                   "level since the last report %"PRId64" of %d bytes\n",
+                   c->read_pos, c->min_fill, c->buffer_size);
+        }
+        if ((ret = async_wait(h)) < 0)
+            break;
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+static int64_t async_seek(URLContext *h, int64_t pos, int whence)
+{
+    Context *c = h->priv_data;
+    int64_t ret;
+
+    if (whence == AVSEEK_SIZE) {
+        return c->logical_size;
+    } else if (whence == SEEK_CUR) {
+        pos += c->read_pos;
+    } else if (whence == SEEK_END) {
+        if (c->logical_size <= 0)
+            return AVERROR(EINVAL);
+        pos += c->logical_size;
+    } else if (whence != SEEK_SET) {
+        return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    pthread_mutex_lock(&c->mutex);
+
+    /* short forward seek: let the background thread catch up and drop the
+       data in between, which is cheaper than restarting the input */
+    while (pos > c->end_pos && pos - c->end_pos <= SHORT_SEEK_THRESHOLD &&
+           !c->io_eof_reached) {
+        c->read_pos = c->end_pos;
+        if ((ret = async_wait(h)) < 0)
+            goto end;
+    }
+
+    if (pos >= c->start_pos && pos <= c->end_pos) {
+        c->read_pos = pos;
+        c->nb_buffer_seeks++;
+        pthread_cond_signal(&c->cond_wakeup_background);
+        ret = pos;
+        goto end;
+    }
+
+    if (h->is_streamed) {
+        ret = AVERROR(ESPIPE);
+        goto end;
+    }
+
+    c->seek_request   = 1;
+    c->seek_pos       = pos;
+    c->seek_completed = 0;
+    c->nb_inner_seeks++;
+    while (!c->seek_completed) {
+        if ((ret = async_wait(h)) < 0)
+            goto end;
+    }
+    ret = c->seek_ret;
+
+end:
+    pthread_mutex_unlock(&c->mutex);
+    return ret;
+}
+
+#define OFFSET(x) offsetof(Context, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+
+static const AVOption options[] = {
+    { "async_buffer_size", "Set the size of the read-ahead ring buffer in bytes", OFFSET(buffer_size), AV_OPT_TYPE_INT, { .i64 = 4 * 1024 * 1024 }, 2 * READ_CHUNK_SIZE, INT_MAX, D },
+    { "async_read_back_size", "Set the amount of already read data kept for backward seeks, in bytes", OFFSET(read_back_size), AV_OPT_TYPE_INT, { .i64 = 256 * 1024 }, 0, INT_MAX, D },
+    { NULL },
+};
+
+static const AVClass async_context_class = {
+    .class_name = "async",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+URLProtocol ff_async_protocol = {
+    .name                = "async",
+    .url_open2           = async_open,
+    .url_read            = async_read,
+    .url_seek            = async_seek,
+    .url_close           = async_close,
+    .priv_data_size      = sizeof(Context),
+    .priv_data_class     = &async_context_class,
+};
+
+#ifdef TEST
+
+#define TEST_STREAM_SIZE  (256 * 1024)
+#define TEST_SEEK_BACK    (2048)
+#define TEST_SEEK_FORWARD (40000)
+#define TEST_SEEK_PAST_END (40000)
+
+typedef struct TestContext {
+    const AVClass *class;
+    int64_t logical_pos;
+    int64_t logical_size;
+} TestContext;
+
+static int async_test_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
+{
+    TestContext *c = h->priv_data;
+    c->logical_pos  = 0;
+    c->logical_size = TEST_STREAM_SIZE;
+    return 0;
+}
+
+static int async_test_close(URLContext *h)
+{
+    return 0;
+}
+
+static int async_test_read(URLContext *h, unsigned char *buf, int size)
+{
+    TestContext *c = h->priv_data;
+    int i;
+    int read_len = 0;
+
+    if (c->logical_pos >= c->logical_size)
+        return AVERROR_EOF;
+
+    for (i = 0; i < size; ++i) {
+        buf[i] = c->logical_pos & 0xFF;
+
+        c->logical_pos++;
+        read_len++;
+
+        if (c->logical_pos >= c->logical_size)
+            break;
+    }
+
+    return read_len;
+}
+
+static int64_t async_test_seek(URLContext *h, int64_t pos, int whence)
+{
+    TestContext *c = h->priv_data;
+    int64_t new_logical_pos;
+
+    if (whence == AVSEEK_SIZE) {
+        return c->logical_size;
+    } else if (whence == SEEK_CUR) {
+        new_logical_pos = pos + c->logical_pos;
+    } else if (whence == SEEK_SET){
+        new_logical_pos = pos;
+    } else {
+        return AVERROR(EINVAL);
+    }
+    if (new_logical_pos < 0)
+        return AVERROR(EINVAL);
+
+    c->logical_pos = new_logical_pos;
+    return new_logical_pos;
+}
+
+static const AVClass async_test_context_class = {
+    .class_name = "Async-Test",
+    .item_name  = av_default_item_name,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+URLProtocol ff_async_test_protocol = {
+    .name                = "async-test",
+    .url_open2           = async_test_open,
+    .url_read            = async_test_read,
+    .url_seek            = async_test_seek,
+    .url_close           = async_test_close,
+    .priv_data_size      = sizeof(TestContext),
+    .priv_data_class     = &async_test_context_class,
+};
+
+static int read_all(URLContext *h, int64_t pos)
+{
+    unsigned char buf[4096];
+    int64_t read_len = 0;
+    int i, ret;
+
+    while (1) {
+        ret = ffurl_read(h, buf, sizeof(buf));
+        if (ret == AVERROR_EOF || ret == 0)
+            break;
+        if (ret < 0) {
+            printf("read-error: %d at %"PRId64"\n", ret, pos);
+            return ret;
+        }
+        for (i = 0; i < ret; i++) {
+            if (buf[i] != (pos & 0xFF)) {
+                printf("read-mismatch: actual %d, expecting %d, at %"PRId64"\n",
+                       (int)buf[i], (int)(pos & 0xFF), pos);
+                return AVERROR_INVALIDDATA;
+            }
+            pos++;
+        }
+        read_len += ret;
+    }
+    printf("read: %"PRId64"\n", read_len);
+    return 0;
+}
+
+/* wait until the background thread has filled the ring buffer */
+static void wait_buffer_full(URLContext *h)
+{
+    Context *c = h->priv_data;
+    int full;
+
+    do {
+        av_usleep(1000);
+        pthread_mutex_lock(&c->mutex);
+        full = c->io_eof_reached || ring_space(c) <= 0;
+        pthread_mutex_unlock(&c->mutex);
+    } while (!full);
+}
+
+int main(void)
+{
+    URLContext   *h = NULL;
+    AVDictionary *opts = NULL;
+    Context      *c;
+    unsigned char buf[100];
+    int64_t       pos;
+    int           ret, nb_seeks;
+
+    ffurl_register_protocol(&ff_async_protocol, sizeof(ff_async_protocol));
+    ffurl_register_protocol(&ff_async_test_protocol, sizeof(ff_async_test_protocol));
+
+    /* a buffer much smaller than the input */
+    av_dict_set(&opts, "async_buffer_size", "65536", 0);
+    av_dict_set(&opts, "async_read_back_size", "4096", 0);
+    ret = ffurl_open(&h, "async:async-test:", AVIO_FLAG_READ, NULL, &opts);
+    av_dict_free(&opts);
+    printf("open: %d\n", ret);
+    if (ret < 0)
+        return 1;
+
+    printf("size: %"PRId64"\n", ffurl_size(h));
+    if (read_all(h, 0) < 0)
+        goto fail;
+
+    /* backward seek inside the read-back window */
+    pos = ffurl_seek(h, -TEST_SEEK_BACK, SEEK_END);
+    printf("seek: %"PRId64"\n", pos);
+    if (read_all(h, pos) < 0)
+        goto fail;
+
+    /* seek outside of the buffer */
+    pos = ffurl_seek(h, 0, SEEK_SET);
+    printf("seek: %"PRId64"\n", pos);
+    ret = ffurl_read(h, buf, sizeof(buf));
+    printf("read: %d\n", ret);
+
+    /* short forward seek */
+    pos = ffurl_seek(h, TEST_SEEK_FORWARD, SEEK_CUR);
+    printf("seek: %"PRId64"\n", pos);
+    if (read_all(h, pos) < 0)
+        goto fail;
+
+    /* short forward seek past the buffered data: waits for the background
+       thread instead of seeking the input */
+    pos = ffurl_seek(h, 0, SEEK_SET);
+    printf("seek: %"PRId64"\n", pos);
+    ret = ffurl_read(h, buf, sizeof(buf));
+    printf("read: %d\n", ret);
+    wait_buffer_full(h);
+    c        = h->priv_data;
+    nb_seeks = c->nb_inner_seeks;
+    pos = ffurl_seek(h, c->end_pos + TEST_SEEK_PAST_END, SEEK_SET);
+    printf("seek: %"PRId64", input seeks: %d\n", pos, c->nb_inner_seeks - nb_seeks);
+    read_all(h, pos);
+
+fail:
+    ffurl_close(h);
+    return 0;
+}
+
+#endif
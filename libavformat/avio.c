@@ -427,6 +427,15 @@ int ffurl_shutdown(URLContext *h, int flags)
     return h->prot->url_shutdown(h, flags);
 }
 
+int ffurl_read_direct(URLContext *h, const uint8_t **data, int size)
+{
+    if (!(h->flags & AVIO_FLAG_READ))
+        return AVERROR(EIO);
+    if (!h->prot->url_read_direct)
+        return AVERROR(ENOSYS);
+    return h->prot->url_read_direct(h, data, size);
+}
+
 int ff_check_interrupt(AVIOInterruptCB *cb)
 {
     int ret;
@@ -146,6 +146,13 @@ typedef struct AVIOContext {
      * This field is internal to libavformat and access from outside is not allowed.
      */
     int writeout_count;
+
+    /**
+     * Access the data of the underlying protocol without copying, may be NULL.
+     * Used by ffio_read_indirect() while the buffer is empty.
+     * This field is internal to libavformat and access from outside is not allowed.
+     */
+    int (*read_direct)(void *opaque, const uint8_t **data, int size);
 } AVIOContext;
 
 /* unbuffered I/O */
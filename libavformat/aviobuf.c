@@ -480,6 +480,7 @@ int avio_r8(AVIOContext *s)
 int avio_read(AVIOContext *s, unsigned char *buf, int size)
 {
     int len, size1;
+    const uint8_t *data;
 
     size1 = size;
     while (size > 0) {
@@ -487,7 +488,18 @@ int avio_read(AVIOContext *s, unsigned char *buf, int size)
         if (len > size)
             len = size;
         if (len == 0 || s->write_flag) {
-            if((s->direct || size > s->buffer_size) && !s->update_checksum){
+            if (s->read_direct && !s->write_flag && !s->update_checksum &&
+                (len = s->read_direct(s->opaque, &data, size)) > 0) {
+                /* copy from the protocol's memory straight to the caller,
+                 * bypassing the buffer */
+                memcpy(buf, data, len);
+                s->pos += len;
+                s->bytes_read += len;
+                size -= len;
+                buf += len;
+                s->buf_ptr = s->buffer;
+                s->buf_end = s->buffer;
+            } else if((s->direct || size > s->buffer_size) && !s->update_checksum){
                 if(s->read_packet)
                     len = s->read_packet(s->opaque, buf, size);
                 if (len <= 0) {
@@ -531,6 +543,35 @@ int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsig
         *data = s->buf_ptr;
         s->buf_ptr += size;
         return size;
+    } else if (s->read_direct && !s->write_flag && !s->update_checksum && size > 0) {
+        int len = s->buf_end - s->buf_ptr;
+        const uint8_t *p;
+        int ret;
+
+        /* Use up what is left in the buffer and take the rest straight from
+         * the protocol. The buffer stays empty, so that the following reads
+         * do not have to copy anything. */
+        memcpy(buf, s->buf_ptr, len);
+        s->buf_ptr = s->buf_end = s->buffer;
+        ret = s->read_direct(s->opaque, &p, size - len);
+        if (ret > 0) {
+            s->pos        += ret;
+            s->bytes_read += ret;
+            if (ret == size) {
+                *data = p;
+                return size;
+            }
+            memcpy(buf + len, p, ret);
+            len += ret;
+        }
+        *data = buf;
+        if (len < size) {
+            ret = avio_read(s, buf + len, size - len);
+            if (ret < 0)
+                return len ? len : ret;
+            len += ret;
+        }
+        return len;
     } else {
         *data = buf;
         return avio_read(s, buf, size);
@@ -727,6 +768,8 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
         return AVERROR(ENOMEM);
     }
     (*s)->direct = h->flags & AVIO_FLAG_DIRECT;
+    if (h->prot->url_read_direct)
+        (*s)->read_direct = (void*)ffurl_read_direct;
     (*s)->seekable = h->is_streamed ? 0 : AVIO_SEEKABLE_NORMAL;
     (*s)->max_packet_size = max_packet_size;
     if(h->prot) {
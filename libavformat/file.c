@@ -32,6 +32,9 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -51,11 +54,25 @@ typedef struct FileContext {
     int fd;
     int trunc;
     int blocksize;
+#if HAVE_MMAP
+    int use_mmap;
+    uint8_t *map;           ///< mapping of the whole file, NULL if not mapped
+    int64_t map_size;
+    int64_t pos;            ///< read position when mapped
+    int64_t prefetch_end;   ///< end of the range last passed to MADV_WILLNEED
+    long page_size;
+#endif
 } FileContext;
 
+/* amount of data asked to be read ahead of the position in mmap mode */
+#define MMAP_PREFETCH_SIZE (4 << 20)
+
 static const AVOption file_options[] = {
     { "truncate", "Truncate existing files on write", offsetof(FileContext, trunc), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
+#if HAVE_MMAP
+    { "mmap", "Read regular files through a memory mapping", offsetof(FileContext, use_mmap), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+#endif
     { NULL }
 };
 
@@ -78,11 +95,57 @@ static const AVClass pipe_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if HAVE_MMAP
+static void file_prefetch(FileContext *c)
+{
+#ifdef MADV_WILLNEED
+    int64_t start, end;
+
+    if (c->pos + MMAP_PREFETCH_SIZE / 2 <= c->prefetch_end ||
+        c->prefetch_end >= c->map_size)
+        return;
+    start = FFMAX(c->prefetch_end, c->pos) & ~(int64_t)(c->page_size - 1);
+    end   = FFMIN(c->pos + MMAP_PREFETCH_SIZE, c->map_size);
+    madvise(c->map + start, end - start, MADV_WILLNEED);
+    c->prefetch_end = end;
+#endif
+}
+
+static int file_read_direct(URLContext *h, const uint8_t **data, int size)
+{
+    FileContext *c = h->priv_data;
+
+    if (!c->map || c->pos >= c->map_size)
+        return 0;
+    size = FFMIN(size, c->map_size - c->pos);
+    *data = c->map + c->pos;
+    c->pos += size;
+    file_prefetch(c);
+    return size;
+}
+#endif
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int r;
     size = FFMIN(size, c->blocksize);
+#if HAVE_MMAP
+    if (c->map) {
+        const uint8_t *data;
+        if ((r = file_read_direct(h, &data, size)) > 0) {
+            memcpy(buf, data, r);
+            return r;
+        }
+        /* the file has grown past the mapping */
+        if (lseek(c->fd, c->pos, SEEK_SET) < 0)
+            return AVERROR(errno);
+        r = read(c->fd, buf, size);
+        if (r > 0)
+            c->pos += r;
+        return (-1 == r)?AVERROR(errno):r;
+    }
+#endif
     r = read(c->fd, buf, size);
     return (-1 == r)?AVERROR(errno):r;
 }
@@ -158,6 +221,31 @@ static int file_open(URLContext *h, const char *filename, int flags)
 
     h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
 
+#if HAVE_MMAP
+    if (c->use_mmap && !(flags & AVIO_FLAG_WRITE) && !h->is_streamed &&
+        S_ISREG(st.st_mode) && st.st_size > 0 && st.st_size <= SIZE_MAX) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            av_log(h, AV_LOG_WARNING, "mmap failed: %s, reading the file instead\n",
+                   av_err2str(AVERROR(errno)));
+        } else {
+            av_log(h, AV_LOG_DEBUG, "Reading the file through a mapping of "
+                   "%"PRId64" bytes\n", (int64_t)st.st_size);
+            c->map          = map;
+            c->map_size     = st.st_size;
+            c->pos          = 0;
+            c->prefetch_end = 0;
+            c->page_size    = sysconf(_SC_PAGESIZE);
+            if (c->page_size <= 0)
+                c->page_size = 4096;
+#ifdef MADV_SEQUENTIAL
+            madvise(c->map, c->map_size, MADV_SEQUENTIAL);
+#endif
+            file_prefetch(c);
+        }
+    }
+#endif
+
     return 0;
 }
 
@@ -173,6 +261,27 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+#if HAVE_MMAP
+    if (c->map) {
+        if (whence == SEEK_CUR) {
+            pos += c->pos;
+        } else if (whence == SEEK_END) {
+            struct stat st;
+            if (fstat(c->fd, &st) < 0)
+                return AVERROR(errno);
+            pos += st.st_size;
+        } else if (whence != SEEK_SET) {
+            return AVERROR(EINVAL);
+        }
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        c->pos          = pos;
+        c->prefetch_end = pos;
+        file_prefetch(c);
+        return pos;
+    }
+#endif
+
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
@@ -181,6 +290,10 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
+#if HAVE_MMAP
+    if (c->map)
+        munmap(c->map, c->map_size);
+#endif
     return close(c->fd);
 }
 
@@ -195,6 +308,9 @@ URLProtocol ff_file_protocol = {
     .url_check           = file_check,
     .priv_data_size      = sizeof(FileContext),
     .priv_data_class     = &file_class,
+#if HAVE_MMAP
+    .url_read_direct     = file_read_direct,
+#endif
 };
 
 #endif /* CONFIG_FILE_PROTOCOL */
@@ -137,6 +137,9 @@ struct MpegTSContext {
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
+
+    /** PES payload buffers, one pool per power of two size class */
+    AVBufferPool *pools[32];
 };
 
 static const AVOption mpegtsraw_options[] = {
@@ -732,6 +735,18 @@ static int mpegts_set_stream_info(AVStream *st, PESContext *pes,
     return 0;
 }
 
+static AVBufferRef *buffer_pool_get(MpegTSContext *ts, int size)
+{
+    int index = av_log2(size + FF_INPUT_BUFFER_PADDING_SIZE);
+    if (!ts->pools[index]) {
+        int pool_size = FFMIN(MAX_PES_PAYLOAD + FF_INPUT_BUFFER_PADDING_SIZE, 2 << index);
+        ts->pools[index] = av_buffer_pool_init(pool_size, NULL);
+        if (!ts->pools[index])
+            return NULL;
+    }
+    return av_buffer_pool_get(ts->pools[index]);
+}
+
 static void new_pes_packet(PESContext *pes, AVPacket *pkt)
 {
     av_init_packet(pkt);
@@ -905,8 +920,7 @@ static int mpegts_push_data(MpegTSFilter *filter,
                         pes->total_size = MAX_PES_PAYLOAD;
 
                     /* allocate pes buffer */
-                    pes->buffer = av_buffer_alloc(pes->total_size +
-                                                  FF_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = buffer_pool_get(ts, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
 
@@ -1034,7 +1048,7 @@ static int mpegts_push_data(MpegTSFilter *filter,
                 if (pes->data_index > 0 && pes->data_index+buf_size > pes->total_size) {
                     new_pes_packet(pes, ts->pkt);
                     pes->total_size = MAX_PES_PAYLOAD;
-                    pes->buffer = av_buffer_alloc(pes->total_size + FF_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = buffer_pool_get(ts, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
                     ts->stop_parse = 1;
@@ -1848,6 +1862,21 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
         }
     }
 
+    if (tss->type == MPEGTS_PES) {
+        PESContext *pes = tss->u.pes_filter.opaque;
+        /* skip the payload of discarded streams without parsing it, and
+           resume at the next PES start if the stream is enabled again */
+        if (pes->st && pes->st->discard == AVDISCARD_ALL &&
+            (!pes->sub_st || pes->sub_st->discard == AVDISCARD_ALL)) {
+            if (pes->state != MPEGTS_SKIP) {
+                av_buffer_unref(&pes->buffer);
+                pes->data_index = 0;
+                pes->state = MPEGTS_SKIP;
+            }
+            return 0;
+        }
+    }
+
     if (!has_payload)
         return 0;
     p = packet + 4;
@@ -2301,6 +2330,9 @@ static void mpegts_free(MpegTSContext *ts)
 
     for(i=0;i<NB_PID_MAX;i++)
         if (ts->pids[i]) mpegts_close_filter(ts, ts->pids[i]);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(ts->pools); i++)
+        av_buffer_pool_uninit(&ts->pools[i]);
 }
 
 static int mpegts_read_close(AVFormatContext *s)
@@ -25,6 +25,7 @@
  */
 
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() with glibc */
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -55,6 +56,7 @@
 
 #define UDP_TX_BUF_SIZE 32768
 #define UDP_MAX_PKT_SIZE 65536
+#define UDP_MAX_BATCH 1024
 
 typedef struct {
     const AVClass *class;
@@ -79,6 +81,26 @@ typedef struct {
     pthread_cond_t cond;
     int thread_started;
 #endif
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    uint8_t *batch_buf;
+#endif
+    int recv_batch;
+    int send_batch;
+    int64_t nb_datagrams;
+    int64_t nb_batches;
+    int64_t nb_dropped;
+    int max_batch;
+
+    /* Paced output variables */
+    int64_t bitrate;
+    int64_t burst_bits;
+    int close_req;
+    int nb_queued;
+    int max_queued;
+    int64_t nb_late;
+    int64_t max_late;
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
     char *local_addr;
@@ -98,8 +120,12 @@ static const AVOption options[] = {
 {"ttl", "Set the time to live value (for multicast only)", OFFSET(ttl), AV_OPT_TYPE_INT, {.i64 = 16}, 0, INT_MAX, E },
 {"connect", "Should connect() be called on socket", OFFSET(is_connected), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D|E },
 /* TODO 'sources', 'block' option */
-{"fifo_size", "Set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
+{"fifo_size", "Set the UDP circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D|E },
 {"overrun_nonfatal", "Survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D },
+{"recv_batch", "Set the maximum number of datagrams read per system call by the receiving thread", OFFSET(recv_batch), AV_OPT_TYPE_INT, {.i64 = 16}, 1, UDP_MAX_BATCH, D },
+{"bitrate", "Send at most this many bits per second, through a sending thread", OFFSET(bitrate), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E },
+{"burst_bits", "Set the number of bits which may be sent ahead of the bitrate schedule", OFFSET(burst_bits), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E },
+{"send_batch", "Set the maximum number of datagrams written per system call by the sending thread", OFFSET(send_batch), AV_OPT_TYPE_INT, {.i64 = 16}, 1, UDP_MAX_BATCH, E },
 {"timeout", "In read mode: if no data arrived in more than this time interval, raise error", OFFSET(timeout), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, D },
 {NULL}
 };
@@ -436,6 +462,40 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+/**
+ * Receive one or more datagrams from the socket.
+ * Each datagram is stored with its size as a 4 bytes little-endian
+ * prefix, ready to be written to the circular buffer.
+ * @return the number of datagrams received, or a negative value on error
+ */
+static int circular_buffer_recv(UDPContext *s)
+{
+    int len;
+
+#if HAVE_RECVMMSG
+    if (s->msgs) {
+        int i, n = recvmmsg(s->udp_fd, s->msgs, s->recv_batch, MSG_WAITFORONE, NULL);
+        for (i = 0; i < n; i++)
+            AV_WL32(s->batch_buf + i * (UDP_MAX_PKT_SIZE + 4), s->msgs[i].msg_len);
+        return n;
+    }
+#endif
+    len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
+    if (len < 0)
+        return len;
+    AV_WL32(s->tmp, len);
+    return 1;
+}
+
+static uint8_t *circular_buffer_datagram(UDPContext *s, int i)
+{
+#if HAVE_RECVMMSG
+    if (s->msgs)
+        return (uint8_t *)s->iov[i].iov_base - 4;
+#endif
+    return s->tmp;
+}
+
 static void *circular_buffer_task( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -450,41 +510,184 @@ static void *circular_buffer_task( void *_URLContext)
         goto end;
     }
     while(1) {
-        int len;
+        int i, n;
 
         pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
+        n = circular_buffer_recv(s);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
+        if (n < 0) {
             if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
                 s->circular_buffer_error = ff_neterrno();
                 goto end;
             }
             continue;
         }
-        AV_WL32(s->tmp, len);
+        s->nb_batches++;
+        s->nb_datagrams += n;
+        s->max_batch = FFMAX(s->max_batch, n);
+
+        /* publish the whole batch under a single lock */
+        for (i = 0; i < n; i++) {
+            uint8_t *dg = circular_buffer_datagram(s, i);
+            int len = AV_RL32(dg);
+
+            if(av_fifo_space(s->fifo) < len + 4) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    s->nb_dropped++;
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    s->circular_buffer_error = AVERROR(EIO);
+                    goto end;
+                }
+            }
+            av_fifo_generic_write(s->fifo, dg, len+4, NULL);
+        }
+        pthread_cond_signal(&s->cond);
+    }
 
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
+end:
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
+
+/**
+ * Send the n datagrams previously read from the circular buffer.
+ * @param len size of the datagram stored in s->tmp when not batching
+ */
+static int circular_buffer_send(UDPContext *s, int n, int len)
+{
+    int ret;
+
+#if HAVE_SENDMMSG
+    if (s->msgs) {
+        int sent = 0;
+        while (sent < n) {
+            ret = sendmmsg(s->udp_fd, s->msgs + sent, n - sent, 0);
+            if (ret < 0) {
+                if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR))
+                    return ff_neterrno();
                 continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
             }
+            sent += ret;
+        }
+        return 0;
+    }
+#endif
+    do {
+        if (!s->is_connected)
+            ret = sendto(s->udp_fd, s->tmp, len, 0,
+                         (struct sockaddr *) &s->dest_addr, s->dest_addr_len);
+        else
+            ret = send(s->udp_fd, s->tmp, len, 0);
+    } while (ret < 0 && (ff_neterrno() == AVERROR(EAGAIN) || ff_neterrno() == AVERROR(EINTR)));
+    return ret < 0 ? ff_neterrno() : 0;
+}
+
+static void *circular_buffer_task_tx(void *_URLContext)
+{
+    URLContext *h = _URLContext;
+    UDPContext *s = h->priv_data;
+    int64_t start = 0, sent_bits = 0;
+    /* time the queue last became non-empty */
+    int64_t filled = 0;
+    /* tolerated lateness before the schedule is restarted */
+    int64_t slack = FFMAX(1000, av_rescale(8 * h->max_packet_size, 1000000, s->bitrate));
+    int batch = 1, idle = 1;
+
+#if HAVE_SENDMMSG
+    if (s->msgs)
+        batch = s->send_batch;
+#endif
+    pthread_mutex_lock(&s->mutex);
+    if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
+        av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
+        s->circular_buffer_error = AVERROR(EIO);
+        goto end;
+    }
+    while (1) {
+        int n = 0, len = 0, ret;
+        int64_t now, sched, due;
+
+        if (!av_fifo_size(s->fifo)) {
+            if (s->close_req)
+                break;
+            idle = 1;
+            pthread_cond_wait(&s->cond, &s->mutex);
+            continue;
+        }
+
+        now = av_gettime();
+        if (idle) {
+            filled = now;
+            idle   = 0;
+        }
+        if (!start)
+            start = now;
+        /* sched is when the next datagram is due at the nominal bitrate,
+           due is the earliest time it may be sent given burst_bits */
+        sched = start + av_rescale(sent_bits, 1000000, s->bitrate);
+        due   = start + av_rescale(sent_bits - s->burst_bits, 1000000, s->bitrate);
+        if (now < due) {
+            pthread_mutex_unlock(&s->mutex);
+            av_usleep(due - now);
+            pthread_mutex_lock(&s->mutex);
+            continue;
+        }
+        if (now - sched > slack) {
+            /* Restart the schedule instead of bursting to catch up. This
+               thread is only late if the datagrams were already queued at
+               the scheduled time, not if the muxer left the queue empty. */
+            if (filled <= sched) {
+                s->nb_late++;
+                s->max_late = FFMAX(s->max_late, now - sched);
+            }
+            start     = now;
+            sent_bits = 0;
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
+
+        /* take all the datagrams which are due, up to the batch size */
+        do {
+            uint8_t tmp[4], *dg = s->tmp;
+
+            av_fifo_generic_read(s->fifo, tmp, 4, NULL);
+            len = AV_RL32(tmp);
+#if HAVE_SENDMMSG
+            if (s->msgs) {
+                dg = s->iov[n].iov_base;
+                s->iov[n].iov_len = len;
+            }
+#endif
+            av_fifo_generic_read(s->fifo, dg, len, NULL);
+            sent_bits += 8 * len;
+            n++;
+        } while (n < batch && av_fifo_size(s->fifo) &&
+                 start + av_rescale(sent_bits - s->burst_bits, 1000000, s->bitrate) <= now);
+        s->nb_queued -= n;
         pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+
+        ret = circular_buffer_send(s, n, len);
+
+        pthread_mutex_lock(&s->mutex);
+        if (ret < 0) {
+            s->circular_buffer_error = ret;
+            goto end;
+        }
+        s->nb_batches++;
+        s->nb_datagrams += n;
+        s->max_batch = FFMAX(s->max_batch, n);
     }
 
 end:
@@ -492,6 +695,30 @@ end:
     pthread_mutex_unlock(&s->mutex);
     return NULL;
 }
+
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+/**
+ * Allocate the message headers and buffers for nb datagrams of size bytes,
+ * each datagram being preceded by offset bytes of scratch space.
+ */
+static int udp_alloc_batch(UDPContext *s, int nb, int size, int offset)
+{
+    int i;
+
+    s->msgs      = av_mallocz(nb * sizeof(*s->msgs));
+    s->iov       = av_malloc (nb * sizeof(*s->iov));
+    s->batch_buf = av_malloc (nb * (size + offset));
+    if (!s->msgs || !s->iov || !s->batch_buf)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < nb; i++) {
+        s->iov[i].iov_base = s->batch_buf + i * (size + offset) + offset;
+        s->iov[i].iov_len  = size;
+        s->msgs[i].msg_hdr.msg_iov    = &s->iov[i];
+        s->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    return 0;
+}
+#endif
 #endif
 
 static int parse_source_list(char *buf, char **sources, int *num_sources,
@@ -593,11 +820,50 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                                   FF_ARRAY_ELEMS(exclude_sources)))
                 goto fail;
         }
+        if (av_find_info_tag(buf, sizeof(buf), "recv_batch", p)) {
+            s->recv_batch = av_clip(strtol(buf, NULL, 10), 1, UDP_MAX_BATCH);
+            if (!HAVE_RECVMMSG)
+                av_log(h, AV_LOG_WARNING,
+                       "'recv_batch' option was set but it is not supported "
+                       "on this build (recvmmsg support is required)\n");
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "send_batch", p)) {
+            s->send_batch = av_clip(strtol(buf, NULL, 10), 1, UDP_MAX_BATCH);
+            if (!HAVE_SENDMMSG)
+                av_log(h, AV_LOG_WARNING,
+                       "'send_batch' option was set but it is not supported "
+                       "on this build (sendmmsg support is required)\n");
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "bitrate", p)) {
+            s->bitrate = strtoll(buf, NULL, 10);
+            if (s->bitrate < 0) {
+                av_log(h, AV_LOG_ERROR, "Invalid bitrate %s\n", buf);
+                goto fail;
+            }
+            if (!HAVE_PTHREAD_CANCEL)
+                av_log(h, AV_LOG_WARNING,
+                       "'bitrate' option was set but it is not supported "
+                       "on this build (pthread support is required)\n");
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "burst_bits", p)) {
+            s->burst_bits = strtoll(buf, NULL, 10);
+            if (s->burst_bits < 0) {
+                av_log(h, AV_LOG_ERROR, "Invalid burst_bits %s\n", buf);
+                goto fail;
+            }
+        }
         if (!is_output && av_find_info_tag(buf, sizeof(buf), "timeout", p))
             s->timeout = strtol(buf, NULL, 10);
     }
     /* handling needed to support options picking from both AVOption and URL */
     s->circular_buffer_size *= 188;
+#if HAVE_PTHREAD_CANCEL
+    if (is_output && s->bitrate && !s->circular_buffer_size) {
+        av_log(h, AV_LOG_ERROR, "The bitrate option needs a circular buffer, "
+               "fifo_size must not be 0\n");
+        goto fail;
+    }
+#endif
     if (flags & AVIO_FLAG_WRITE) {
         h->max_packet_size = s->packet_size;
     } else {
@@ -710,11 +976,32 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     s->udp_fd = udp_fd;
 
 #if HAVE_PTHREAD_CANCEL
-    if (!is_output && s->circular_buffer_size) {
+    if (s->circular_buffer_size && (!is_output || s->bitrate)) {
         int ret;
 
         /* start the task going */
         s->fifo = av_fifo_alloc(s->circular_buffer_size);
+        if (!s->fifo)
+            goto fail;
+        if (is_output && (h->max_packet_size <= 0 || h->max_packet_size > UDP_MAX_PKT_SIZE))
+            h->max_packet_size = UDP_MAX_PKT_SIZE;
+#if HAVE_RECVMMSG
+        if (!is_output && s->recv_batch > 1 &&
+            udp_alloc_batch(s, s->recv_batch, UDP_MAX_PKT_SIZE, 4) < 0)
+            goto fail;
+#endif
+#if HAVE_SENDMMSG
+        if (is_output && s->send_batch > 1) {
+            if (udp_alloc_batch(s, s->send_batch, h->max_packet_size, 0) < 0)
+                goto fail;
+            if (!s->is_connected) {
+                for (i = 0; i < s->send_batch; i++) {
+                    s->msgs[i].msg_hdr.msg_name    = &s->dest_addr;
+                    s->msgs[i].msg_hdr.msg_namelen = s->dest_addr_len;
+                }
+            }
+        }
+#endif
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -725,7 +1012,8 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", strerror(ret));
             goto cond_fail;
         }
-        ret = pthread_create(&s->circular_buffer_thread, NULL, circular_buffer_task, h);
+        ret = pthread_create(&s->circular_buffer_thread, NULL,
+                             is_output ? circular_buffer_task_tx : circular_buffer_task, h);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", strerror(ret));
             goto thread_fail;
@@ -745,6 +1033,11 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_free(s->fifo);
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+    av_freep(&s->batch_buf);
+#endif
     for (i = 0; i < num_include_sources; i++)
         av_freep(&include_sources[i]);
     for (i = 0; i < num_exclude_sources; i++)
@@ -816,6 +1109,39 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     UDPContext *s = h->priv_data;
     int ret;
 
+#if HAVE_PTHREAD_CANCEL
+    if (s->fifo) {
+        uint8_t tmp[4];
+
+        if (size > h->max_packet_size || size + 4 > s->circular_buffer_size) {
+            av_log(h, AV_LOG_ERROR, "Datagram of %d bytes too large for the "
+                   "packet size or the circular buffer\n", size);
+            return AVERROR(EINVAL);
+        }
+        pthread_mutex_lock(&s->mutex);
+        while (!s->circular_buffer_error && av_fifo_space(s->fifo) < size + 4) {
+            if (h->flags & AVIO_FLAG_NONBLOCK) {
+                pthread_mutex_unlock(&s->mutex);
+                return AVERROR(EAGAIN);
+            }
+            pthread_cond_wait(&s->cond, &s->mutex);
+        }
+        if (s->circular_buffer_error) {
+            int err = s->circular_buffer_error;
+            pthread_mutex_unlock(&s->mutex);
+            return err;
+        }
+        AV_WL32(tmp, size);
+        av_fifo_generic_write(s->fifo, tmp, 4, NULL);
+        av_fifo_generic_write(s->fifo, (uint8_t *)buf, size, NULL);
+        s->nb_queued++;
+        s->max_queued = FFMAX(s->max_queued, s->nb_queued);
+        pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+        return size;
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
         if (ret < 0)
@@ -839,18 +1165,43 @@ static int udp_close(URLContext *h)
 
     if (s->is_multicast && (h->flags & AVIO_FLAG_READ))
         udp_leave_multicast_group(s->udp_fd, (struct sockaddr *)&s->dest_addr);
-    closesocket(s->udp_fd);
 #if HAVE_PTHREAD_CANCEL
     if (s->thread_started) {
-        pthread_cancel(s->circular_buffer_thread);
+        if (h->flags & AVIO_FLAG_READ) {
+            pthread_cancel(s->circular_buffer_thread);
+        } else {
+            /* let the sending thread flush the queued datagrams */
+            pthread_mutex_lock(&s->mutex);
+            s->close_req = 1;
+            pthread_cond_signal(&s->cond);
+            pthread_mutex_unlock(&s->mutex);
+        }
         ret = pthread_join(s->circular_buffer_thread, NULL);
         if (ret != 0)
             av_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", strerror(ret));
         pthread_mutex_destroy(&s->mutex);
         pthread_cond_destroy(&s->cond);
+        if (h->flags & AVIO_FLAG_READ)
+            av_log(h, s->nb_dropped ? AV_LOG_WARNING : AV_LOG_VERBOSE,
+                   "%"PRId64" datagrams received in %"PRId64" system calls "
+                   "(max %d per call), %"PRId64" dropped\n",
+                   s->nb_datagrams, s->nb_batches, s->max_batch, s->nb_dropped);
+        else
+            av_log(h, AV_LOG_VERBOSE,
+                   "%"PRId64" datagrams sent in %"PRId64" system calls "
+                   "(max %d per call), max queue depth %d datagrams, "
+                   "%"PRId64" late (max %"PRId64" us)\n",
+                   s->nb_datagrams, s->nb_batches, s->max_batch, s->max_queued,
+                   s->nb_late, s->max_late);
     }
 #endif
+    closesocket(s->udp_fd);
     av_fifo_free(s->fifo);
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+    av_freep(&s->batch_buf);
+#endif
     return 0;
 }
 
@@ -865,3 +1216,115 @@ URLProtocol ff_udp_protocol = {
     .priv_data_class     = &udp_context_class,
     .flags               = URL_PROTOCOL_FLAG_NETWORK,
 };
+
+#ifdef TEST
+
+#define TEST_DATAGRAMS 200
+#define TEST_SIZE      1316
+/* one datagram per millisecond */
+#define TEST_BITRATE   (8 * TEST_SIZE * 1000)
+
+/* Wait until the sending thread has sent nb datagrams. */
+static void wait_sent(URLContext *h, int64_t nb)
+{
+    UDPContext *s = h->priv_data;
+
+    pthread_mutex_lock(&s->mutex);
+    while (s->nb_datagrams < nb && !s->circular_buffer_error) {
+        pthread_mutex_unlock(&s->mutex);
+        av_usleep(1000);
+        pthread_mutex_lock(&s->mutex);
+    }
+    pthread_mutex_unlock(&s->mutex);
+}
+
+/**
+ * Send TEST_DATAGRAMS datagrams to port through the paced output, pausing
+ * for gap microseconds once the first half is sent, and check that rx gets
+ * them all in order no faster than the bitrate allows.
+ */
+static int test_paced_output(URLContext *rx, int port, int burst, int gap)
+{
+    char url[256];
+    uint8_t buf[TEST_SIZE];
+    URLContext *tx;
+    int64_t start, elapsed, min_time, max_late;
+    int i, ret;
+
+    snprintf(url, sizeof(url), "udp://127.0.0.1:%d?bitrate=%d&burst_bits=%d",
+             port, TEST_BITRATE, 8 * TEST_SIZE * burst);
+    if ((ret = ffurl_open(&tx, url, AVIO_FLAG_WRITE, NULL, NULL)) < 0) {
+        printf("open: %d\n", ret);
+        return ret;
+    }
+
+    start = av_gettime();
+    for (i = 0; i < TEST_DATAGRAMS; i++) {
+        if (gap && i == TEST_DATAGRAMS / 2) {
+            /* leave the queue empty for a while */
+            wait_sent(tx, i);
+            av_usleep(gap);
+        }
+        memset(buf, i, sizeof(buf));
+        AV_WB32(buf, i);
+        if ((ret = ffurl_write(tx, buf, sizeof(buf))) < 0) {
+            printf("write: %d\n", ret);
+            ffurl_close(tx);
+            return ret;
+        }
+    }
+    wait_sent(tx, TEST_DATAGRAMS);
+    elapsed = av_gettime() - start;
+    max_late = ((UDPContext *)tx->priv_data)->max_late;
+    ffurl_close(tx);
+
+    for (i = 0; i < TEST_DATAGRAMS; i++) {
+        ret = ffurl_read(rx, buf, sizeof(buf));
+        if (ret != TEST_SIZE || AV_RB32(buf) != i || buf[TEST_SIZE - 1] != (i & 0xFF)) {
+            printf("datagram %d: read %d bytes, got #%d\n", i, ret,
+                   ret >= 4 ? (int)AV_RB32(buf) : -1);
+            return AVERROR_INVALIDDATA;
+        }
+    }
+
+    /* the schedule restarts after the gap, with a new burst */
+    if (gap)
+        min_time = 2 * (TEST_DATAGRAMS / 2 - 1 - burst) * 1000 + gap;
+    else
+        min_time = (TEST_DATAGRAMS - 1 - burst) * 1000;
+    printf("burst %d, gap %d ms: %d datagrams in order, %s",
+           burst, gap / 1000, TEST_DATAGRAMS,
+           elapsed >= min_time ? "paced" : "too fast");
+    /* the gap is the muxer being idle, not the sending thread being late */
+    if (gap)
+        printf(", %s", max_late < gap / 2 ? "idle time not late" : "idle time late");
+    printf("\n");
+    return 0;
+}
+
+int main(void)
+{
+    URLContext *rx;
+    int ret;
+
+    avformat_network_init();
+    ffurl_register_protocol(&ff_udp_protocol, sizeof(ff_udp_protocol));
+
+    ret = ffurl_open(&rx, "udp://127.0.0.1:0?timeout=1000000", AVIO_FLAG_READ,
+                     NULL, NULL);
+    if (ret < 0) {
+        printf("open: %d\n", ret);
+        return 1;
+    }
+
+    ret = test_paced_output(rx, ff_udp_get_local_port(rx), 0, 0);
+    if (ret >= 0)
+        ret = test_paced_output(rx, ff_udp_get_local_port(rx), 0, 100000);
+    if (ret >= 0)
+        ret = test_paced_output(rx, ff_udp_get_local_port(rx), 20, 0);
+
+    ffurl_close(rx);
+    avformat_network_deinit();
+    return ret < 0;
+}
+#endif
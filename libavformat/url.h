@@ -89,6 +89,15 @@ typedef struct URLProtocol {
     const AVClass *priv_data_class;
     int flags;
     int (*url_check)(URLContext *h, int mask);
+    /**
+     * Make up to size bytes of data available at *data without copying
+     * them, and advance the position past them. Only for protocols which
+     * keep their whole content in memory; the data must stay valid until
+     * the protocol is closed.
+     * Return the number of bytes available, 0 if no data can be provided
+     * this way at the current position, or a negative AVERROR code.
+     */
+    int (*url_read_direct)(URLContext *h, const uint8_t **data, int size);
 } URLProtocol;
 
 /**
@@ -224,6 +233,17 @@ int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles);
  */
 int ffurl_shutdown(URLContext *h, int flags);
 
+/**
+ * Read up to size bytes from the resource without copying them.
+ *
+ * @param data set to the location of the data on success, it stays valid
+ *             until h is closed
+ * @return the number of bytes available at *data, 0 if the data at the
+ * current position cannot be accessed directly, AVERROR(ENOSYS) if the
+ * protocol does not support it, or another negative AVERROR code
+ */
+int ffurl_read_direct(URLContext *h, const uint8_t **data, int size);
+
 /**
  * Register the URLProtocol protocol.
  *
@@ -45,6 +45,7 @@
 #define AV_CPU_FLAG_AVX          0x4000 ///< AVX functions: requires OS support even if YMM registers aren't used
 #define AV_CPU_FLAG_XOP          0x0400 ///< Bulldozer XOP functions
 #define AV_CPU_FLAG_FMA4         0x0800 ///< Bulldozer FMA4 functions
+#define AV_CPU_FLAG_AVX2         0x8000 ///< AVX2 functions: requires OS support even if YMM registers aren't used
 // #if LIBAVUTIL_VERSION_MAJOR <52
 #define AV_CPU_FLAG_CMOV      0x1001000 ///< supports cmov instruction
 // #else
@@ -74,6 +74,8 @@ static const AVOption swscale_options[] = {
     { "bayer",           "bayer dither",                  0,                 AV_OPT_TYPE_CONST,  { .i64  = SWS_DITHER_BAYER  }, INT_MIN, INT_MAX,        VE, "sws_dither" },
     { "ed",              "error diffusion",               0,                 AV_OPT_TYPE_CONST,  { .i64  = SWS_DITHER_ED     }, INT_MIN, INT_MAX,        VE, "sws_dither" },
 
+    { "threads",         "number of output bands for sws_scale_band()", OFFSET(nb_threads), AV_OPT_TYPE_INT, { .i64 = 1             }, 0,       INT_MAX,        VE },
+
     { NULL }
 };
 
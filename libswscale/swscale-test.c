@@ -31,6 +31,8 @@
 #include "libavutil/crc.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/lfg.h"
+#include "libavutil/cpu.h"
+#include "libavutil/time.h"
 #include "swscale.h"
 
 /* HACK Duplicated from swscale_internal.h.
@@ -338,6 +340,81 @@ static int fileTest(uint8_t *ref[4], int refStride[4], int w, int h, FILE *fp,
     return 0;
 }
 
+/* Each case is chosen so that its time is dominated by the named kernels. */
+static const struct {
+    const char *kernel;
+    enum AVPixelFormat src, dst;
+    int srcW, srcH, dstW, dstH, flags;
+} bench_cases[] = {
+    { "hscale 4 taps, plane1",  AV_PIX_FMT_GRAY8,   AV_PIX_FMT_GRAY8,   1920, 1080, 1280, 1080, SWS_BILINEAR },
+    { "hscale 8 taps, plane1",  AV_PIX_FMT_GRAY8,   AV_PIX_FMT_GRAY8,   1920, 1080, 1280, 1080, SWS_BICUBIC  },
+    { "hscale 8->19",           AV_PIX_FMT_GRAY8,   AV_PIX_FMT_GRAY16LE, 1920, 1080, 1280, 1080, SWS_BICUBIC },
+    { "yuv2planeX 8-bit",       AV_PIX_FMT_GRAY8,   AV_PIX_FMT_GRAY8,   1920, 1080, 1920,  720, SWS_BICUBIC | SWS_ACCURATE_RND },
+    { "yuv420p scale",          AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV420P, 1920, 1080, 1280,  720, SWS_BICUBIC },
+    { "nv12 -> yuv420p scale",  AV_PIX_FMT_NV12,    AV_PIX_FMT_YUV420P, 1920, 1080, 1280,  720, SWS_BICUBIC },
+    { "yuv420p -> rgb32",       AV_PIX_FMT_YUV420P, AV_PIX_FMT_RGB32,   1920, 1080, 1920, 1080, SWS_BICUBIC },
+    { "yuv420p -> bgr32",       AV_PIX_FMT_YUV420P, AV_PIX_FMT_BGR32,   1920, 1080, 1920, 1080, SWS_BICUBIC },
+    { "nv12 -> rgb32",          AV_PIX_FMT_NV12,    AV_PIX_FMT_RGB32,   1920, 1080, 1920, 1080, SWS_BICUBIC },
+    { "rgb32 -> yuv420p",       AV_PIX_FMT_RGB32,   AV_PIX_FMT_YUV420P, 1920, 1080, 1920, 1080, SWS_BICUBIC },
+};
+
+static int benchmark(int iterations)
+{
+    int i, n;
+
+    printf("%-24s %14s\n", "kernel", "Mpixels/s");
+    for (i = 0; i < FF_ARRAY_ELEMS(bench_cases); i++) {
+        uint8_t *src[4], *dst[4];
+        int srcStride[4], dstStride[4];
+        struct SwsContext *sws;
+        int64_t t;
+        AVLFG rand;
+        int size, x;
+
+        av_lfg_init(&rand, 1);
+        size = av_image_alloc(src, srcStride, bench_cases[i].srcW,
+                              bench_cases[i].srcH, bench_cases[i].src, 32);
+        if (size < 0)
+            return -1;
+        for (x = 0; x < size; x++)
+            src[0][x] = av_lfg_get(&rand);
+        if (av_image_alloc(dst, dstStride, bench_cases[i].dstW,
+                           bench_cases[i].dstH, bench_cases[i].dst, 32) < 0) {
+            av_freep(&src[0]);
+            return -1;
+        }
+        sws = sws_getContext(bench_cases[i].srcW, bench_cases[i].srcH,
+                             bench_cases[i].src, bench_cases[i].dstW,
+                             bench_cases[i].dstH, bench_cases[i].dst,
+                             bench_cases[i].flags, NULL, NULL, NULL);
+        if (!sws) {
+            fprintf(stderr, "Failed to get %s ---> %s\n",
+                    av_get_pix_fmt_name(bench_cases[i].src),
+                    av_get_pix_fmt_name(bench_cases[i].dst));
+            av_freep(&src[0]);
+            av_freep(&dst[0]);
+            return -1;
+        }
+
+        sws_scale(sws, (const uint8_t * const *)src, srcStride, 0,
+                  bench_cases[i].srcH, dst, dstStride);
+        t = av_gettime();
+        for (n = 0; n < iterations; n++)
+            sws_scale(sws, (const uint8_t * const *)src, srcStride, 0,
+                      bench_cases[i].srcH, dst, dstStride);
+        t = FFMAX(av_gettime() - t, 1);
+
+        printf("%-24s %14.1f\n", bench_cases[i].kernel,
+               (double)bench_cases[i].dstW * bench_cases[i].dstH * iterations / t);
+        fflush(stdout);
+
+        sws_freeContext(sws);
+        av_freep(&src[0]);
+        av_freep(&dst[0]);
+    }
+    return 0;
+}
+
 #define W 96
 #define H 96
 
@@ -356,6 +433,7 @@ int main(int argc, char **argv)
     AVLFG rand;
     int res = -1;
     int i;
+    int bench = 0;
     FILE *fp = NULL;
 
     if (!rgb_data || !data)
@@ -382,6 +460,20 @@ int main(int argc, char **argv)
                 fprintf(stderr, "invalid pixel format %s\n", argv[i + 1]);
                 return -1;
             }
+        } else if (!strcmp(argv[i], "-cpuflags")) {
+            unsigned cpuflags = av_get_cpu_flags();
+
+            if (av_parse_cpu_caps(&cpuflags, argv[i + 1]) < 0) {
+                fprintf(stderr, "invalid cpu flags %s\n", argv[i + 1]);
+                return -1;
+            }
+            av_force_cpu_flags(cpuflags);
+        } else if (!strcmp(argv[i], "-bench")) {
+            bench = atoi(argv[i + 1]);
+            if (bench <= 0) {
+                fprintf(stderr, "invalid iteration count %s\n", argv[i + 1]);
+                return -1;
+            }
         } else {
 bad_option:
             fprintf(stderr, "bad option or argument missing (%s)\n", argv[i]);
@@ -389,6 +481,12 @@ bad_option:
         }
     }
 
+    if (bench) {
+        av_free(rgb_data);
+        res = benchmark(bench);
+        goto error;
+    }
+
     sws = sws_getContext(W / 12, H / 12, AV_PIX_FMT_RGB32, W, H,
                          AV_PIX_FMT_YUVA420P, SWS_BILINEAR, NULL, NULL, NULL);
 
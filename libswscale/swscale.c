@@ -235,31 +235,51 @@ static void hyscale_fast_c(SwsContext *c, int16_t *dst, int dstWidth,
         dst[i] = src[srcW-1]*128;
 }
 
+/**
+ * Return the luma or alpha source line in a format the horizontal scaler
+ * can read, converting it if needed. The converted lines are shared between
+ * the contexts of a sws_scale_multi() call.
+ */
+static av_always_inline const uint8_t *lum_input(SwsContext *c,
+                                                 const uint8_t *src_in[4],
+                                                 int y, uint32_t *pal,
+                                                 int isAlpha)
+{
+    void (*toYV12)(uint8_t *, const uint8_t *, const uint8_t *, const uint8_t *, int, uint32_t *) =
+        isAlpha ? c->alpToYV12 : c->lumToYV12;
+    void (*readPlanar)(uint8_t *, const uint8_t *[4], int, int32_t *) =
+        isAlpha ? c->readAlpPlanar : c->readLumPlanar;
+    const uint8_t *src = src_in[isAlpha ? 3 : 0];
+    SwsRowCache *lines = c->in_lines;
+    const int plane    = isAlpha ? 2 : 0;
+    uint8_t *buf       = c->formatConvBuffer;
+
+    if (!toYV12 && !readPlanar)
+        return src;
+
+    if (lines && lines->data[plane]) {
+        buf = lines->data[plane] + y * lines->stride[plane];
+        if (lines->serial[plane][y] == lines->cur_serial)
+            return buf;
+        lines->serial[plane][y] = lines->cur_serial;
+    }
+
+    if (toYV12)
+        toYV12(buf, src, src_in[1], src_in[2], c->srcW, pal);
+    else
+        readPlanar(buf, src_in, c->srcW, isAlpha ? NULL : c->input_rgb2yuv_table);
+    return buf;
+}
+
 // *** horizontal scale Y line to temp buffer
 static av_always_inline void hyscale(SwsContext *c, int16_t *dst, int dstWidth,
-                                     const uint8_t *src_in[4],
+                                     const uint8_t *src,
                                      int srcW, int xInc,
                                      const int16_t *hLumFilter,
                                      const int32_t *hLumFilterPos,
-                                     int hLumFilterSize,
-                                     uint8_t *formatConvBuffer,
-                                     uint32_t *pal, int isAlpha)
+                                     int hLumFilterSize, int isAlpha)
 {
-    void (*toYV12)(uint8_t *, const uint8_t *, const uint8_t *, const uint8_t *, int, uint32_t *) =
-        isAlpha ? c->alpToYV12 : c->lumToYV12;
     void (*convertRange)(int16_t *, int) = isAlpha ? NULL : c->lumConvertRange;
-    const uint8_t *src = src_in[isAlpha ? 3 : 0];
-
-    if (toYV12) {
-        toYV12(formatConvBuffer, src, src_in[1], src_in[2], srcW, pal);
-        src = formatConvBuffer;
-    } else if (c->readLumPlanar && !isAlpha) {
-        c->readLumPlanar(formatConvBuffer, src_in, srcW, c->input_rgb2yuv_table);
-        src = formatConvBuffer;
-    } else if (c->readAlpPlanar && isAlpha) {
-        c->readAlpPlanar(formatConvBuffer, src_in, srcW, NULL);
-        src = formatConvBuffer;
-    }
 
     if (!c->hyscale_fast) {
         c->hyScale(c, dst, dstWidth, src, hLumFilter,
@@ -291,30 +311,48 @@ static void hcscale_fast_c(SwsContext *c, int16_t *dst1, int16_t *dst2,
     }
 }
 
+/**
+ * Chroma counterpart of lum_input(), the converted U and V lines are
+ * returned in src1 and src2.
+ */
+static av_always_inline void chr_input(SwsContext *c, const uint8_t *src_in[4],
+                                       int y, uint32_t *pal,
+                                       const uint8_t **src1,
+                                       const uint8_t **src2)
+{
+    SwsRowCache *lines = c->in_lines;
+    uint8_t *buf       = c->formatConvBuffer;
+    const int offset   = FFALIGN(c->srcW * 2 + 78, 16);
+
+    *src1 = src_in[1];
+    *src2 = src_in[2];
+    if (!c->chrToYV12 && !c->readChrPlanar)
+        return;
+
+    if (lines && lines->data[1]) {
+        buf = lines->data[1] + y * lines->stride[1];
+        if (lines->serial[1][y] == lines->cur_serial)
+            goto done;
+        lines->serial[1][y] = lines->cur_serial;
+    }
+
+    if (c->chrToYV12)
+        c->chrToYV12(buf, buf + offset, src_in[0], src_in[1], src_in[2], c->chrSrcW, pal);
+    else
+        c->readChrPlanar(buf, buf + offset, src_in, c->chrSrcW, c->input_rgb2yuv_table);
+done:
+    *src1 = buf;
+    *src2 = buf + offset;
+}
+
 static av_always_inline void hcscale(SwsContext *c, int16_t *dst1,
                                      int16_t *dst2, int dstWidth,
-                                     const uint8_t *src_in[4],
+                                     const uint8_t *src1, const uint8_t *src2,
                                      int srcW, int xInc,
                                      const int16_t *hChrFilter,
                                      const int32_t *hChrFilterPos,
-                                     int hChrFilterSize,
-                                     uint8_t *formatConvBuffer, uint32_t *pal)
+                                     int hChrFilterSize)
 {
-    const uint8_t *src1 = src_in[1], *src2 = src_in[2];
-    if (c->chrToYV12) {
-        uint8_t *buf2 = formatConvBuffer +
-                        FFALIGN(srcW*2+78, 16);
-        c->chrToYV12(formatConvBuffer, buf2, src_in[0], src1, src2, srcW, pal);
-        src1= formatConvBuffer;
-        src2= buf2;
-    } else if (c->readChrPlanar) {
-        uint8_t *buf2 = formatConvBuffer +
-                        FFALIGN(srcW*2+78, 16);
-        c->readChrPlanar(formatConvBuffer, buf2, src_in, srcW, c->input_rgb2yuv_table);
-        src1 = formatConvBuffer;
-        src2 = buf2;
-    }
-
     if (!c->hcscale_fast) {
         c->hcScale(c, dst1, dstWidth, src1, hChrFilter, hChrFilterPos, hChrFilterSize);
         c->hcScale(c, dst2, dstWidth, src2, hChrFilter, hChrFilterPos, hChrFilterSize);
@@ -326,6 +364,30 @@ static av_always_inline void hcscale(SwsContext *c, int16_t *dst1,
         c->chrConvertRange(dst1, dst2, dstWidth);
 }
 
+/**
+ * Point the ring buffer entries of a horizontally scaled line to its shared
+ * copy.
+ *
+ * @return 1 if the line still has to be scaled for the current picture
+ */
+static int map_shared_line(SwsRowCache *lines, int plane, int y,
+                           int16_t **ring, int16_t **ring2, int index,
+                           int size, ptrdiff_t offset2)
+{
+    uint8_t *line = lines->data[plane] + y * lines->stride[plane];
+
+    if (index >= size)
+        index -= size;
+    ring[index] = ring[index + size] = (int16_t *)line;
+    if (ring2)
+        ring2[index] = ring2[index + size] = (int16_t *)(line + offset2);
+
+    if (lines->serial[plane][y] == lines->cur_serial)
+        return 0;
+    lines->serial[plane][y] = lines->cur_serial;
+    return 1;
+}
+
 #define DEBUG_SWSCALE_BUFFERS 0
 #define DEBUG_BUFFERS(...)                      \
     if (DEBUG_SWSCALE_BUFFERS)                  \
@@ -364,7 +426,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     int16_t **alpPixBuf              = c->alpPixBuf;
     const int vLumBufSize            = c->vLumBufSize;
     const int vChrBufSize            = c->vChrBufSize;
-    uint8_t *formatConvBuffer        = c->formatConvBuffer;
+    SwsRowCache *hs_lines            = c->hs_lines;
     uint32_t *pal                    = c->pal_yuv;
     yuv2planar1_fn yuv2plane1        = c->yuv2plane1;
     yuv2planarX_fn yuv2planeX        = c->yuv2planeX;
@@ -443,7 +505,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     if (srcSliceY == 0) {
         lumBufIndex  = -1;
         chrBufIndex  = -1;
-        dstY         = 0;
+        dstY         = c->dstBandStart;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
@@ -453,7 +515,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     }
     lastDstY = dstY;
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < c->dstBandEnd; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         uint8_t *dest[4]  = {
             dst[0] + dstStride[0] * dstY,
@@ -512,13 +574,19 @@ static int swscale(SwsContext *c, const uint8_t *src[],
             av_assert0(lumBufIndex < 2 * vLumBufSize);
             av_assert0(lastInLumBuf + 1 - srcSliceY < srcSliceH);
             av_assert0(lastInLumBuf + 1 - srcSliceY >= 0);
-            hyscale(c, lumPixBuf[lumBufIndex], dstW, src1, srcW, lumXInc,
-                    hLumFilter, hLumFilterPos, hLumFilterSize,
-                    formatConvBuffer, pal, 0);
-            if (CONFIG_SWSCALE_ALPHA && alpPixBuf)
-                hyscale(c, alpPixBuf[lumBufIndex], dstW, src1, srcW,
-                        lumXInc, hLumFilter, hLumFilterPos, hLumFilterSize,
-                        formatConvBuffer, pal, 1);
+            if (!hs_lines ||
+                map_shared_line(hs_lines, 0, lastInLumBuf + 1, lumPixBuf, NULL,
+                                lumBufIndex, vLumBufSize, 0))
+                hyscale(c, lumPixBuf[lumBufIndex], dstW,
+                        lum_input(c, src1, lastInLumBuf + 1, pal, 0), srcW,
+                        lumXInc, hLumFilter, hLumFilterPos, hLumFilterSize, 0);
+            if (CONFIG_SWSCALE_ALPHA && alpPixBuf &&
+                (!hs_lines ||
+                 map_shared_line(hs_lines, 2, lastInLumBuf + 1, alpPixBuf, NULL,
+                                 lumBufIndex, vLumBufSize, 0)))
+                hyscale(c, alpPixBuf[lumBufIndex], dstW,
+                        lum_input(c, src1, lastInLumBuf + 1, pal, 1), srcW,
+                        lumXInc, hLumFilter, hLumFilterPos, hLumFilterSize, 1);
             lastInLumBuf++;
             DEBUG_BUFFERS("\t\tlumBufIndex %d: lastInLumBuf: %d\n",
                           lumBufIndex, lastInLumBuf);
@@ -536,11 +604,18 @@ static int swscale(SwsContext *c, const uint8_t *src[],
             av_assert0(lastInChrBuf + 1 - chrSrcSliceY >= 0);
             // FIXME replace parameters through context struct (some at least)
 
-            if (c->needs_hcscale)
+            if (c->needs_hcscale &&
+                (!hs_lines ||
+                 map_shared_line(hs_lines, 1, lastInChrBuf + 1, chrUPixBuf,
+                                 chrVPixBuf, chrBufIndex, vChrBufSize,
+                                 c->uv_offx2))) {
+                const uint8_t *srcU, *srcV;
+
+                chr_input(c, src1, lastInChrBuf + 1, pal, &srcU, &srcV);
                 hcscale(c, chrUPixBuf[chrBufIndex], chrVPixBuf[chrBufIndex],
-                        chrDstW, src1, chrSrcW, chrXInc,
-                        hChrFilter, hChrFilterPos, hChrFilterSize,
-                        formatConvBuffer, pal);
+                        chrDstW, srcU, srcV, chrSrcW, chrXInc,
+                        hChrFilter, hChrFilterPos, hChrFilterSize);
+            }
             lastInChrBuf++;
             DEBUG_BUFFERS("\t\tchrBufIndex %d: lastInChrBuf: %d\n",
                           chrBufIndex, lastInChrBuf);
@@ -1112,3 +1187,314 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     return ret;
 }
 
+
+int attribute_align_arg sws_scale_band(struct SwsContext *c,
+                                       const uint8_t * const src[],
+                                       const int srcStride[],
+                                       uint8_t *const dst[],
+                                       const int dstStride[], int band)
+{
+    if (!c->nb_band_ctx)
+        return band ? AVERROR(EINVAL) : sws_scale(c, src, srcStride, 0, c->srcH, dst, dstStride);
+
+    if (band < 0 || band >= c->nb_band_ctx)
+        return AVERROR(EINVAL);
+
+    return sws_scale(c->band_ctx[band], src, srcStride, 0, c->srcH, dst, dstStride);
+}
+
+/**
+ * (Re)allocate one plane of a row cache, return 1 if the lines were
+ * reallocated and 0 if the current ones were kept.
+ */
+static int alloc_cache_plane(SwsRowCache *lines, int plane, int nb_lines,
+                             int stride)
+{
+    if (lines->data[plane] && lines->nb_lines[plane] == nb_lines &&
+        lines->stride[plane] == stride)
+        return 0;
+
+    av_freep(&lines->data[plane]);
+    av_freep(&lines->serial[plane]);
+    lines->nb_lines[plane] = lines->stride[plane] = 0;
+    if (!nb_lines)
+        return 0;
+
+    lines->data[plane]   = av_malloc(nb_lines * stride);
+    lines->serial[plane] = av_mallocz(nb_lines * sizeof(*lines->serial[plane]));
+    if (!lines->data[plane] || !lines->serial[plane]) {
+        av_freep(&lines->data[plane]);
+        av_freep(&lines->serial[plane]);
+        return AVERROR(ENOMEM);
+    }
+    lines->nb_lines[plane] = nb_lines;
+    lines->stride[plane]   = stride;
+    return 1;
+}
+
+void ff_sws_free_row_cache(SwsRowCache *lines)
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+        alloc_cache_plane(lines, i, 0, 0);
+}
+
+static int has_lum_conversion(SwsContext *c)
+{
+    return c->lumToYV12 || c->readLumPlanar;
+}
+
+static int has_chr_conversion(SwsContext *c)
+{
+    return c->needs_hcscale && (c->chrToYV12 || c->readChrPlanar);
+}
+
+static int has_alp_conversion(SwsContext *c)
+{
+    return c->alpPixBuf && (c->alpToYV12 || c->readAlpPlanar);
+}
+
+static int can_share_lines(SwsContext *c)
+{
+    return c->swscale == swscale && !c->srcXYZ && !c->dstXYZ;
+}
+
+/**
+ * Check if two contexts read and convert the source lines the same way.
+ */
+static int same_input(SwsContext *a, SwsContext *b)
+{
+    return a->srcFormat        == b->srcFormat        &&
+           a->srcW             == b->srcW             &&
+           a->srcH             == b->srcH             &&
+           a->chrSrcW          == b->chrSrcW          &&
+           a->chrSrcH          == b->chrSrcH          &&
+           a->chrSrcVSubSample == b->chrSrcVSubSample &&
+           a->needs_hcscale    == b->needs_hcscale    &&
+           !a->alpPixBuf       == !b->alpPixBuf       &&
+           a->src0Alpha        == b->src0Alpha        &&
+           a->lumToYV12        == b->lumToYV12        &&
+           a->chrToYV12        == b->chrToYV12        &&
+           a->alpToYV12        == b->alpToYV12        &&
+           a->readLumPlanar    == b->readLumPlanar    &&
+           a->readChrPlanar    == b->readChrPlanar    &&
+           a->readAlpPlanar    == b->readAlpPlanar    &&
+           !memcmp(a->input_rgb2yuv_table, b->input_rgb2yuv_table,
+                   sizeof(a->input_rgb2yuv_table));
+}
+
+/**
+ * Check if two contexts output the same horizontally scaled lines.
+ */
+static int same_hscale(SwsContext *a, SwsContext *b)
+{
+    return same_input(a, b)                           &&
+           a->dstW            == b->dstW              &&
+           a->chrDstW         == b->chrDstW           &&
+           a->dstBpc          == b->dstBpc            &&
+           a->uv_offx2        == b->uv_offx2          &&
+           a->lumXInc         == b->lumXInc           &&
+           a->chrXInc         == b->chrXInc           &&
+           a->hLumFilterSize  == b->hLumFilterSize    &&
+           a->hChrFilterSize  == b->hChrFilterSize    &&
+           a->hyScale         == b->hyScale           &&
+           a->hcScale         == b->hcScale           &&
+           a->hyscale_fast    == b->hyscale_fast      &&
+           a->hcscale_fast    == b->hcscale_fast      &&
+           a->lumConvertRange == b->lumConvertRange   &&
+           a->chrConvertRange == b->chrConvertRange   &&
+           !memcmp(a->hLumFilter, b->hLumFilter,
+                   a->dstW * a->hLumFilterSize * sizeof(*a->hLumFilter)) &&
+           !memcmp(a->hChrFilter, b->hChrFilter,
+                   a->chrDstW * a->hChrFilterSize * sizeof(*a->hChrFilter)) &&
+           !memcmp(a->hLumFilterPos, b->hLumFilterPos,
+                   a->dstW * sizeof(*a->hLumFilterPos)) &&
+           !memcmp(a->hChrFilterPos, b->hChrFilterPos,
+                   a->chrDstW * sizeof(*a->hChrFilterPos));
+}
+
+static int init_input_cache(SwsContext *c)
+{
+    SwsRowCache *lines = &c->input_cache;
+    int stride = FFALIGN(c->srcW * 2 + 78, 16);
+    int ret;
+
+    if ((ret = alloc_cache_plane(lines, 0, has_lum_conversion(c) ? c->srcH : 0,
+                                 stride)) < 0 ||
+        (ret = alloc_cache_plane(lines, 1, has_chr_conversion(c) ? c->chrSrcH : 0,
+                                 stride * 2)) < 0 ||
+        (ret = alloc_cache_plane(lines, 2, has_alp_conversion(c) ? c->srcH : 0,
+                                 stride)) < 0)
+        return ret;
+
+    lines->cur_serial++;
+    c->in_lines = lines;
+    return 0;
+}
+
+static int init_scaled_cache(SwsContext *c)
+{
+    SwsRowCache *lines = &c->scaled_cache;
+    int dst_stride = c->uv_offx2 - 16;
+    int i, j, ret;
+
+    if ((ret = alloc_cache_plane(lines, 0, c->srcH, dst_stride + 16)) < 0 ||
+        (ret = alloc_cache_plane(lines, 2, c->alpPixBuf ? c->srcH : 0,
+                                 dst_stride + 16)) < 0)
+        return ret;
+
+    ret = alloc_cache_plane(lines, 1, c->needs_hcscale ? c->chrSrcH : 0,
+                            dst_stride * 2 + 32);
+    if (ret < 0)
+        return ret;
+    // same padding as the chroma ring buffer, see sws_init_context()
+    for (i = 0; ret && i < c->chrSrcH; i++) {
+        uint8_t *line = lines->data[1] + i * lines->stride[1];
+        if (c->dstBpc > 14)
+            for (j = 0; j < dst_stride / 2 + 1; j++)
+                ((int32_t *)line)[j] = 1 << 18;
+        else
+            for (j = 0; j < dst_stride + 1; j++)
+                ((int16_t *)line)[j] = 1 << 14;
+    }
+
+    lines->cur_serial++;
+    c->hs_lines = lines;
+    return 0;
+}
+
+/**
+ * Allocate the ring buffers pointing to the shared scaled lines. They start
+ * as copies of the context's own ring buffers, so lines which are never
+ * scaled, like the chroma lines of gray sources, keep their default value.
+ */
+static int init_cache_ring(SwsContext *c)
+{
+    int lum_size = c->vLumBufSize * 3 * sizeof(int16_t *);
+    int chr_size = c->vChrBufSize * 3 * sizeof(int16_t *);
+
+    if (!c->lumCacheBuf) {
+        c->lumCacheBuf  = av_malloc(lum_size);
+        c->chrUCacheBuf = av_malloc(chr_size);
+        c->chrVCacheBuf = av_malloc(chr_size);
+        if (c->alpPixBuf)
+            c->alpCacheBuf = av_malloc(lum_size);
+        if (!c->lumCacheBuf || !c->chrUCacheBuf || !c->chrVCacheBuf ||
+            (c->alpPixBuf && !c->alpCacheBuf))
+            return AVERROR(ENOMEM);
+    }
+
+    memcpy(c->lumCacheBuf,  c->lumPixBuf,  lum_size);
+    memcpy(c->chrUCacheBuf, c->chrUPixBuf, chr_size);
+    memcpy(c->chrVCacheBuf, c->chrVPixBuf, chr_size);
+    if (c->alpPixBuf)
+        memcpy(c->alpCacheBuf, c->alpPixBuf, lum_size);
+    return 0;
+}
+
+static void swap_ring_buffers(SwsContext *c)
+{
+    FFSWAP(int16_t **, c->lumPixBuf,  c->lumCacheBuf);
+    FFSWAP(int16_t **, c->chrUPixBuf, c->chrUCacheBuf);
+    FFSWAP(int16_t **, c->chrVPixBuf, c->chrVCacheBuf);
+    if (c->alpPixBuf)
+        FFSWAP(int16_t **, c->alpPixBuf, c->alpCacheBuf);
+}
+
+/**
+ * Find the groups of contexts which can share converted or scaled lines and
+ * point them to the lines of the first context of their group.
+ */
+static int init_shared_lines(SwsContext *c[], int nb_ctx)
+{
+    int i, j, ret;
+
+    for (i = 0; i < nb_ctx; i++)
+        c[i]->in_lines = c[i]->hs_lines = NULL;
+
+    for (i = 1; i < nb_ctx; i++) {
+        if (!can_share_lines(c[i]))
+            continue;
+
+        for (j = 0; j < i; j++) {
+            if (!can_share_lines(c[j]) || !same_input(c[j], c[i]))
+                continue;
+            if (has_lum_conversion(c[j]) || has_chr_conversion(c[j]) ||
+                has_alp_conversion(c[j])) {
+                if (!c[j]->in_lines && (ret = init_input_cache(c[j])) < 0)
+                    return ret;
+                c[i]->in_lines = c[j]->in_lines;
+            }
+            break;
+        }
+
+        for (j = 0; j < i; j++) {
+            if (!can_share_lines(c[j]) || !same_hscale(c[j], c[i]))
+                continue;
+            if (!c[j]->hs_lines) {
+                if ((ret = init_scaled_cache(c[j])) < 0 ||
+                    (ret = init_cache_ring(c[j])) < 0)
+                    return ret;
+            }
+            if ((ret = init_cache_ring(c[i])) < 0)
+                return ret;
+            c[i]->hs_lines = c[j]->hs_lines;
+            break;
+        }
+    }
+    return 0;
+}
+
+int attribute_align_arg sws_scale_multi(struct SwsContext *c[], int nb_ctx,
+                                        const uint8_t *const src[],
+                                        const int srcStride[],
+                                        uint8_t *const *dst[],
+                                        const int *dstStride[])
+{
+    const AVPixFmtDescriptor *desc;
+    /* lines fed to every context in turn, small enough for the source lines
+     * to still be in the cache when the next context reads them */
+    int step = 16;
+    int i, y, ret = 0;
+
+    if (nb_ctx <= 0)
+        return AVERROR(EINVAL);
+    for (i = 1; i < nb_ctx; i++)
+        if (c[i]->srcW != c[0]->srcW || c[i]->srcH != c[0]->srcH ||
+            c[i]->srcFormat != c[0]->srcFormat)
+            return AVERROR(EINVAL);
+    for (i = 0; i < nb_ctx; i++)
+        step = FFMAX(step, 1 << c[i]->chrSrcVSubSample);
+    desc = av_pix_fmt_desc_get(c[0]->srcFormat);
+
+    if ((ret = init_shared_lines(c, nb_ctx)) < 0)
+        goto end;
+
+    for (y = 0; y < c[0]->srcH; y += step) {
+        const uint8_t *slice[4];
+        int h = FFMIN(step, c[0]->srcH - y);
+
+        for (i = 0; i < 4; i++) {
+            int vsub = i == 1 || i == 2 ? desc->log2_chroma_h : 0;
+            slice[i] = src[i] && !(i == 1 && usePal(c[0]->srcFormat)) ?
+                       src[i] + (y >> vsub) * srcStride[i] : src[i];
+        }
+
+        for (i = 0; i < nb_ctx; i++) {
+            if (c[i]->hs_lines)
+                swap_ring_buffers(c[i]);
+            ret = sws_scale(c[i], slice, srcStride, y, h, dst[i], dstStride[i]);
+            if (c[i]->hs_lines)
+                swap_ring_buffers(c[i]);
+            if (ret < 0)
+                goto end;
+        }
+    }
+    ret = 0;
+
+end:
+    for (i = 0; i < nb_ctx; i++)
+        c[i]->in_lines = c[i]->hs_lines = NULL;
+    return ret;
+}
@@ -227,6 +227,52 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
               const int srcStride[], int srcSliceY, int srcSliceH,
               uint8_t *const dst[], const int dstStride[]);
 
+/**
+ * Return the number of bands the output of a context initialized with the
+ * "threads" option is split into, 1 if it is not split.
+ */
+int sws_get_band_count(struct SwsContext *c);
+
+/**
+ * Scale one band of the output picture from the whole source picture.
+ *
+ * The bands are independent from each other, so different bands of the
+ * same picture may be scaled at the same time from different threads.
+ * All the bands of a picture must have been output before the next
+ * picture is started.
+ *
+ * @param band      index of the band to output, between 0 and
+ *                  sws_get_band_count() - 1
+ * @return          a negative error code on failure, the height of the
+ *                  output band otherwise
+ */
+int sws_scale_band(struct SwsContext *c, const uint8_t *const src[],
+                   const int srcStride[], uint8_t *const dst[],
+                   const int dstStride[], int band);
+
+/**
+ * Scale the same source picture with several contexts in one pass.
+ *
+ * The source is fed to the contexts in turn, a few lines at a time, so that
+ * each source line is read from memory only once. Contexts which convert
+ * the source the same way share the converted lines, and contexts which
+ * also have the same destination width and horizontal filter share the
+ * horizontally scaled lines. The output is identical to calling sws_scale()
+ * with each context on the whole picture.
+ *
+ * All the contexts must have the same source dimensions and format.
+ *
+ * @param c         array of nb_ctx scaling contexts
+ * @param src       the planes of the source picture
+ * @param srcStride the strides of the source planes
+ * @param dst       array of nb_ctx destination plane arrays, one per context
+ * @param dstStride array of nb_ctx destination stride arrays
+ * @return          0 on success, a negative error code otherwise
+ */
+int sws_scale_multi(struct SwsContext *c[], int nb_ctx,
+                    const uint8_t *const src[], const int srcStride[],
+                    uint8_t *const *dst[], const int *dstStride[]);
+
 /**
  * @param dstRange flag indicating the while-black range of the output (1=jpeg / 0=mpeg)
  * @param srcRange flag indicating the while-black range of the input (1=jpeg / 0=mpeg)
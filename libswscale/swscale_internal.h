@@ -263,6 +263,20 @@ typedef void (*yuv2anyX_fn)(struct SwsContext *c, const int16_t *lumFilter,
                             const int16_t **alpSrc, uint8_t **dest,
                             int dstW, int y);
 
+/**
+ * Lines shared between the contexts of a sws_scale_multi() call that read
+ * the same source. Each line is computed once per picture, by the first
+ * context that needs it. Planes are indexed 0 for luma, 1 for chroma (U and
+ * V in the same line) and 2 for alpha.
+ */
+typedef struct SwsRowCache {
+    uint8_t *data[3];             ///< Lines of each plane, NULL if the plane is not shared.
+    int stride[3];                ///< Size in bytes of a line of each plane.
+    int nb_lines[3];              ///< Number of lines allocated for each plane.
+    unsigned *serial[3];          ///< Picture serial each line was last computed for.
+    unsigned cur_serial;          ///< Serial of the picture being scaled.
+} SwsRowCache;
+
 /* This struct should be aligned on at least a 32-byte boundary. */
 typedef struct SwsContext {
     /**
@@ -360,6 +374,8 @@ typedef struct SwsContext {
     int canMMXEXTBeUsed;
 
     int dstY;                     ///< Last destination vertical line output from last slice.
+    int dstBandStart;             ///< First destination line output by this context.
+    int dstBandEnd;               ///< Destination line after the last one output by this context.
     int flags;                    ///< Flags passed by the user to select scaler algorithm, optimizations, subsampling, etc...
     void *yuvTable;             // pointer to the yuv->rgb table start so it can be freed()
     uint8_t *table_rV[256 + 2*YUVRGB_TABLE_HEADROOM];
@@ -603,10 +619,35 @@ typedef struct SwsContext {
     int needs_hcscale; ///< Set if there are chroma planes to be converted.
 
     SwsDither dither;
+
+    int nb_threads;               ///< Number of output bands requested by the user, 0 for one per CPU.
+    struct SwsContext **band_ctx; ///< Child contexts, one per output band, see sws_scale_band().
+    int nb_band_ctx;              ///< Number of child contexts in band_ctx.
+
+    /**
+     * @name Lines shared by sws_scale_multi().
+     * The first context of a group of contexts with the same input conversion
+     * owns the converted source lines, the first one of a group with the
+     * same horizontal scaler owns the scaled lines. During the call, the
+     * ring buffers of the latter point to those shared lines instead of
+     * their own.
+     */
+    //@{
+    SwsRowCache input_cache;      ///< Converted source lines owned by this context.
+    SwsRowCache scaled_cache;     ///< Horizontally scaled lines owned by this context.
+    SwsRowCache *in_lines;        ///< Converted source lines used by the current call, or NULL.
+    SwsRowCache *hs_lines;        ///< Horizontally scaled lines used by the current call, or NULL.
+    int16_t **lumCacheBuf;        ///< Ring buffers swapped with lumPixBuf and friends when hs_lines is set.
+    int16_t **chrUCacheBuf;
+    int16_t **chrVCacheBuf;
+    int16_t **alpCacheBuf;
+    //@}
 } SwsContext;
 //FIXME check init (where 0)
 
 SwsFunc ff_yuv2rgb_get_func_ptr(SwsContext *c);
+
+void ff_sws_free_row_cache(SwsRowCache *lines);
 int ff_yuv2rgb_c_init_tables(SwsContext *c, const int inv_table[4],
                              int fullRange, int brightness,
                              int contrast, int saturation);
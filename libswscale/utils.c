@@ -964,6 +964,12 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
 {
     const AVPixFmtDescriptor *desc_dst;
     const AVPixFmtDescriptor *desc_src;
+    int i;
+
+    for (i = 0; i < c->nb_band_ctx; i++)
+        sws_setColorspaceDetails(c->band_ctx[i], inv_table, srcRange, table,
+                                 dstRange, brightness, contrast, saturation);
+
     memmove(c->srcColorspaceTable, inv_table, sizeof(int) * 4);
     memmove(c->dstColorspaceTable, table, sizeof(int) * 4);
 
@@ -1088,6 +1094,102 @@ SwsContext *sws_alloc_context(void)
     return c;
 }
 
+static void free_band_contexts(SwsContext *c)
+{
+    int i;
+
+    for (i = 0; i < c->nb_band_ctx; i++)
+        sws_freeContext(c->band_ctx[i]);
+    av_freep(&c->band_ctx);
+    c->nb_band_ctx = 0;
+}
+
+/**
+ * Allocate the per-band contexts of a context with the threads option set
+ * and copy the user parameters to them, before sws_init_context() replaces
+ * some of those with internal equivalents.
+ */
+static int alloc_band_contexts(SwsContext *c)
+{
+    int nb_bands = c->nb_threads ? c->nb_threads : av_cpu_count();
+    int i;
+
+    /* bands of less than 16 lines are not worth the extra contexts */
+    nb_bands = FFMIN(nb_bands, c->dstH / 16);
+    if (nb_bands < 2)
+        return 0;
+
+    c->band_ctx = av_mallocz(nb_bands * sizeof(*c->band_ctx));
+    if (!c->band_ctx)
+        return AVERROR(ENOMEM);
+    c->nb_band_ctx = nb_bands;
+
+    for (i = 0; i < nb_bands; i++) {
+        SwsContext *b = c->band_ctx[i] = sws_alloc_context();
+        if (!b)
+            return AVERROR(ENOMEM);
+
+        b->srcW          = c->srcW;
+        b->srcH          = c->srcH;
+        b->dstW          = c->dstW;
+        b->dstH          = c->dstH;
+        b->srcFormat     = c->srcFormat;
+        b->dstFormat     = c->dstFormat;
+        b->srcRange      = c->srcRange;
+        b->dstRange      = c->dstRange;
+        b->flags         = c->flags & ~SWS_PRINT_INFO;
+        b->param[0]      = c->param[0];
+        b->param[1]      = c->param[1];
+        b->src_v_chr_pos = c->src_v_chr_pos;
+        b->src_h_chr_pos = c->src_h_chr_pos;
+        b->dst_v_chr_pos = c->dst_v_chr_pos;
+        b->dst_h_chr_pos = c->dst_h_chr_pos;
+        b->dither        = c->dither;
+        b->nb_threads    = 1;
+    }
+    return 0;
+}
+
+/**
+ * Initialize the band contexts and split the destination picture between
+ * them. Each band context runs the whole vertical scaler with its own ring
+ * buffers and only outputs its lines, so the bands overlap in the source
+ * lines they read but never share any state.
+ */
+static int init_band_contexts(SwsContext *c, SwsFilter *srcFilter,
+                              SwsFilter *dstFilter)
+{
+    int align = 1 << c->chrDstVSubSample;
+    int i, ret;
+
+    if (!c->nb_band_ctx)
+        return 0;
+
+    /* error diffusion carries state from one line to the next and the XYZ
+     * conversions work on whole pictures */
+    if (c->dither == SWS_DITHER_ED || c->srcXYZ || c->dstXYZ) {
+        free_band_contexts(c);
+        return 0;
+    }
+
+    for (i = 0; i < c->nb_band_ctx; i++) {
+        SwsContext *b = c->band_ctx[i];
+
+        if ((ret = sws_init_context(b, srcFilter, dstFilter)) < 0)
+            return ret;
+        b->dstBandStart = c->dstH * i / c->nb_band_ctx & ~(align - 1);
+        b->dstBandEnd   = c->dstH * (i + 1) / c->nb_band_ctx & ~(align - 1);
+    }
+    c->band_ctx[c->nb_band_ctx - 1]->dstBandEnd = c->dstH;
+
+    return 0;
+}
+
+int sws_get_band_count(struct SwsContext *c)
+{
+    return FFMAX(c->nb_band_ctx, 1);
+}
+
 av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                              SwsFilter *dstFilter)
 {
@@ -1112,6 +1214,10 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
     if (!rgb15to16)
         sws_rgb2rgb_init();
 
+    /* the parameters are modified below, copy them to the band contexts first */
+    if (alloc_band_contexts(c) < 0)
+        goto fail;
+
     unscaled = (srcW == dstW && srcH == dstH);
 
     c->srcRange |= handle_jpeg(&c->srcFormat);
@@ -1318,6 +1424,7 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
         ff_get_unscaled_swscale(c);
 
         if (c->swscale) {
+            free_band_contexts(c);
             if (flags & SWS_PRINT_INFO)
                 av_log(c, AV_LOG_INFO,
                        "using unscaled %s -> %s special converter\n",
@@ -1509,7 +1616,9 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
     c->vChrBufSize = c->vChrFilterSize;
     for (i = 0; i < dstH; i++) {
         int chrI      = (int64_t)i * c->chrDstH / dstH;
-        int nextSlice = FFMAX(c->vLumFilterPos[i] + c->vLumFilterSize - 1,
+        /* swscale() waits for the luma lines of the whole chroma line pair */
+        int lumI      = FFMIN(i | ((1 << c->chrDstVSubSample) - 1), dstH - 1);
+        int nextSlice = FFMAX(c->vLumFilterPos[lumI] + c->vLumFilterSize - 1,
                               ((c->vChrFilterPos[chrI] + c->vChrFilterSize - 1)
                                << c->chrSrcVSubSample));
 
@@ -1633,6 +1742,11 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                c->chrXInc, c->chrYInc);
     }
 
+    c->dstBandStart = 0;
+    c->dstBandEnd   = dstH;
+    if (init_band_contexts(c, srcFilter, dstFilter) < 0)
+        goto fail;
+
     c->swscale = ff_getSwsFunc(c);
     return 0;
 fail: // FIXME replace things by appropriate error codes
@@ -1991,6 +2105,8 @@ void sws_freeContext(SwsContext *c)
     if (!c)
         return;
 
+    free_band_contexts(c);
+
     if (c->lumPixBuf) {
         for (i = 0; i < c->vLumBufSize; i++)
             av_freep(&c->lumPixBuf[i]);
@@ -2049,6 +2165,13 @@ void sws_freeContext(SwsContext *c)
     av_freep(&c->yuvTable);
     av_freep(&c->formatConvBuffer);
 
+    ff_sws_free_row_cache(&c->input_cache);
+    ff_sws_free_row_cache(&c->scaled_cache);
+    av_freep(&c->lumCacheBuf);
+    av_freep(&c->chrUCacheBuf);
+    av_freep(&c->chrVCacheBuf);
+    av_freep(&c->alpCacheBuf);
+
     av_free(c);
 }
 
@@ -271,6 +271,219 @@ static void yuv2yuvX_sse3(const int16_t *filter, int filterSize,
 }
 #endif
 
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+/*
+ * Horizontal scaling of 8 output pixels from 8-bit input, filterSize must be
+ * a multiple of 4. Each group of 4 taps is fetched for all 8 pixels with one
+ * gather, the sums are left in ymm6 in output order.
+ */
+#define HSCALE8_AVX2(out)                                                   \
+    __asm__ volatile(                                                       \
+        "vmovdqu          (%5), %%ymm7          \n\t"                       \
+        "vpxor         %%ymm6, %%ymm6, %%ymm6   \n\t"                       \
+        "vpxor         %%ymm4, %%ymm4, %%ymm4   \n\t"                       \
+        "lea       (%3, %3, 2), %%"REG_a"       \n\t"                       \
+        "lea       (%1, %3, 4), %%"REG_d"       \n\t"                       \
+        "1:                                     \n\t"                       \
+        "vpcmpeqd      %%ymm5, %%ymm5, %%ymm5   \n\t"                       \
+        "vpgatherdd    %%ymm5, (%0, %%ymm7, 1), %%ymm0 \n\t"                \
+        "vmovq            (%1), %%xmm1          \n\t"                       \
+        "vmovhps      (%1, %3), %%xmm1, %%xmm1  \n\t"                       \
+        "vmovq        (%%"REG_d"), %%xmm2       \n\t"                       \
+        "vmovhps      (%%"REG_d", %3), %%xmm2, %%xmm2 \n\t"                 \
+        "vinserti128 $1, %%xmm2, %%ymm1, %%ymm1 \n\t"                       \
+        "vmovq     (%1, %3, 2), %%xmm3          \n\t"                       \
+        "vmovhps   (%1, %%"REG_a"), %%xmm3, %%xmm3 \n\t"                    \
+        "vmovq     (%%"REG_d", %3, 2), %%xmm2   \n\t"                       \
+        "vmovhps   (%%"REG_d", %%"REG_a"), %%xmm2, %%xmm2 \n\t"             \
+        "vinserti128 $1, %%xmm2, %%ymm3, %%ymm3 \n\t"                       \
+        "vpunpckhbw    %%ymm4, %%ymm0, %%ymm2   \n\t"                       \
+        "vpunpcklbw    %%ymm4, %%ymm0, %%ymm0   \n\t"                       \
+        "vpmaddwd      %%ymm1, %%ymm0, %%ymm0   \n\t"                       \
+        "vpmaddwd      %%ymm3, %%ymm2, %%ymm2   \n\t"                       \
+        "vphaddd       %%ymm2, %%ymm0, %%ymm0   \n\t"                       \
+        "vpaddd        %%ymm0, %%ymm6, %%ymm6   \n\t"                       \
+        "add               $4, %0               \n\t"                       \
+        "add               $8, %1               \n\t"                       \
+        "add               $8, %%"REG_d"        \n\t"                       \
+        "sub               $1, %2               \n\t"                       \
+        "jg 1b                                  \n\t"                       \
+        out                                                                 \
+        : "+&r"(s), "+&r"(f), "+&r"(n)                                      \
+        : "r"((x86_reg)filterSize * 2), "r"(dst + i), "r"(filterPos + i),   \
+          "m"(max)                                                          \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",                  \
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)                 \
+          "%"REG_a, "%"REG_d, "memory"                                      \
+    )
+
+static void hscale8to15_avx2(SwsContext *c, int16_t *dst, int dstW,
+                             const uint8_t *src, const int16_t *filter,
+                             const int32_t *filterPos, int filterSize)
+{
+    const int max = 0;
+    int i, j;
+
+    for (i = 0; i + 8 <= dstW; i += 8) {
+        const uint8_t *s = src;
+        const int16_t *f = filter + i * filterSize;
+        x86_reg n = filterSize >> 2;
+        HSCALE8_AVX2(
+            "vpsrad            $7, %%ymm6, %%ymm6   \n\t"
+            "vpackssdw     %%ymm6, %%ymm6, %%ymm6   \n\t"
+            "vpermq        $0x08, %%ymm6, %%ymm6    \n\t"
+            "vmovdqu       %%xmm6, (%4)             \n\t");
+    }
+    __asm__ volatile("vzeroupper");
+    for (; i < dstW; i++) {
+        int val = 0;
+        for (j = 0; j < filterSize; j++)
+            val += src[filterPos[i] + j] * filter[filterSize * i + j];
+        dst[i] = FFMIN(val >> 7, (1 << 15) - 1);
+    }
+}
+
+static void hscale8to19_avx2(SwsContext *c, int16_t *_dst, int dstW,
+                             const uint8_t *src, const int16_t *filter,
+                             const int32_t *filterPos, int filterSize)
+{
+    int32_t *dst = (int32_t *)_dst;
+    const int max = (1 << 19) - 1;
+    int i, j;
+
+    for (i = 0; i + 8 <= dstW; i += 8) {
+        const uint8_t *s = src;
+        const int16_t *f = filter + i * filterSize;
+        x86_reg n = filterSize >> 2;
+        HSCALE8_AVX2(
+            "vpbroadcastd     %6, %%ymm5            \n\t"
+            "vpsrad            $3, %%ymm6, %%ymm6   \n\t"
+            "vpminsd       %%ymm5, %%ymm6, %%ymm6   \n\t"
+            "vmovdqu       %%ymm6, (%4)             \n\t");
+    }
+    __asm__ volatile("vzeroupper");
+    for (; i < dstW; i++) {
+        int val = 0;
+        for (j = 0; j < filterSize; j++)
+            val += src[filterPos[i] + j] * filter[filterSize * i + j];
+        dst[i] = FFMIN(val >> 3, (1 << 19) - 1);
+    }
+}
+
+/*
+ * Same rounding as yuv2planeX_8_c: the taps are interleaved in pairs so that
+ * pmaddwd accumulates exactly the 32-bit sums of the C code.
+ */
+static void yuv2planeX_8_avx2(const int16_t *filter, int filterSize,
+                              const int16_t **src, uint8_t *dest, int dstW,
+                              const uint8_t *dither, int offset)
+{
+    int32_t dith[16];
+    int i, j;
+
+    for (i = 0; i < 8; i++)
+        dith[(i & 3) + (i & 4) * 2] =
+        dith[(i & 3) + (i & 4) * 2 + 4] = dither[(i + offset) & 7] << 12;
+
+    for (i = 0; i + 16 <= dstW; i += 16) {
+        const int16_t **s = src;
+        const int16_t *f  = filter;
+        x86_reg n = filterSize >> 1;
+        __asm__ volatile(
+            "vmovdqu         (%4), %%ymm6           \n\t"
+            "vmovdqu       32(%4), %%ymm7           \n\t"
+            "test              %2, %2               \n\t"
+            "jz 2f                                  \n\t"
+            "1:                                     \n\t"
+            "mov              (%0), %%"REG_a"       \n\t"
+            "mov             8(%0), %%"REG_d"       \n\t"
+            "vmovdqu   (%%"REG_a", %5, 2), %%ymm0   \n\t"
+            "vmovdqu   (%%"REG_d", %5, 2), %%ymm1   \n\t"
+            "vpbroadcastd     (%1), %%ymm2          \n\t"
+            "vpunpckhwd    %%ymm1, %%ymm0, %%ymm3   \n\t"
+            "vpunpcklwd    %%ymm1, %%ymm0, %%ymm0   \n\t"
+            "vpmaddwd      %%ymm2, %%ymm0, %%ymm0   \n\t"
+            "vpmaddwd      %%ymm2, %%ymm3, %%ymm3   \n\t"
+            "vpaddd        %%ymm0, %%ymm6, %%ymm6   \n\t"
+            "vpaddd        %%ymm3, %%ymm7, %%ymm7   \n\t"
+            "add              $16, %0               \n\t"
+            "add               $4, %1               \n\t"
+            "sub               $1, %2               \n\t"
+            "jg 1b                                  \n\t"
+            "2:                                     \n\t"
+            "testl             $1, %6               \n\t"
+            "jz 3f                                  \n\t"
+            "mov              (%0), %%"REG_a"       \n\t"
+            "vmovdqu   (%%"REG_a", %5, 2), %%ymm0   \n\t"
+            "movzwl           (%1), %%edx           \n\t"
+            "vmovd          %%edx, %%xmm2           \n\t"
+            "vpbroadcastd  %%xmm2, %%ymm2           \n\t"
+            "vpxor         %%ymm1, %%ymm1, %%ymm1   \n\t"
+            "vpunpckhwd    %%ymm1, %%ymm0, %%ymm3   \n\t"
+            "vpunpcklwd    %%ymm1, %%ymm0, %%ymm0   \n\t"
+            "vpmaddwd      %%ymm2, %%ymm0, %%ymm0   \n\t"
+            "vpmaddwd      %%ymm2, %%ymm3, %%ymm3   \n\t"
+            "vpaddd        %%ymm0, %%ymm6, %%ymm6   \n\t"
+            "vpaddd        %%ymm3, %%ymm7, %%ymm7   \n\t"
+            "3:                                     \n\t"
+            "vpsrad           $19, %%ymm6, %%ymm6   \n\t"
+            "vpsrad           $19, %%ymm7, %%ymm7   \n\t"
+            "vpackssdw     %%ymm7, %%ymm6, %%ymm6   \n\t"
+            "vpackuswb     %%ymm6, %%ymm6, %%ymm6   \n\t"
+            "vpermq        $0x08, %%ymm6, %%ymm6    \n\t"
+            "vmovdqu       %%xmm6, (%3)             \n\t"
+            : "+&r"(s), "+&r"(f), "+&r"(n)
+            : "r"(dest + i), "r"(dith), "r"((x86_reg)i), "r"(filterSize)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                           "%xmm6", "%xmm7",)
+              "%"REG_a, "%"REG_d, "memory"
+        );
+    }
+    __asm__ volatile("vzeroupper");
+    for (; i < dstW; i++) {
+        int val = dither[(i + offset) & 7] << 12;
+        for (j = 0; j < filterSize; j++)
+            val += src[j][i] * filter[j];
+        dest[i] = av_clip_uint8(val >> 19);
+    }
+}
+
+static void yuv2plane1_8_avx2(const int16_t *src, uint8_t *dest, int dstW,
+                              const uint8_t *dither, int offset)
+{
+    int16_t dith[16];
+    x86_reg i;
+
+    for (i = 0; i < 16; i++)
+        dith[i] = dither[(i + offset) & 7];
+
+    /* src is at most 32767, so the saturating add clips like the C code */
+    if (dstW >= 32) {
+        i = -(dstW & ~31);
+        __asm__ volatile(
+            "vmovdqu          (%3), %%ymm2          \n\t"
+            "1:                                     \n\t"
+            "vpaddsw     (%1, %0, 2), %%ymm2, %%ymm0 \n\t"
+            "vpaddsw   32(%1, %0, 2), %%ymm2, %%ymm1 \n\t"
+            "vpsraw            $7, %%ymm0, %%ymm0   \n\t"
+            "vpsraw            $7, %%ymm1, %%ymm1   \n\t"
+            "vpackuswb     %%ymm1, %%ymm0, %%ymm0   \n\t"
+            "vpermq        $0xd8, %%ymm0, %%ymm0    \n\t"
+            "vmovdqu       %%ymm0, (%2, %0)         \n\t"
+            "add              $32, %0               \n\t"
+            "jl 1b                                  \n\t"
+            "vzeroupper                             \n\t"
+            : "+&r"(i)
+            : "r"(src + (dstW & ~31)), "r"(dest + (dstW & ~31)), "r"(dith)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",)
+              "memory"
+        );
+    }
+    for (i = dstW & ~31; i < dstW; i++)
+        dest[i] = av_clip_uint8((src[i] + dither[(i + offset) & 7]) >> 7);
+}
+#endif /* HAVE_AVX2_INLINE && ARCH_X86_64 */
+
 #endif /* HAVE_INLINE_ASM */
 
 #define SCALE_FUNC(filter_n, from_bpc, to_bpc, opt) \
@@ -577,4 +790,21 @@ switch(c->dstBpc){ \
             break;
         }
     }
+
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+    if (INLINE_AVX2(cpu_flags)) {
+        if (c->srcBpc == 8) {
+            if (!(c->hLumFilterSize & 3))
+                c->hyScale = c->dstBpc <= 14 ? hscale8to15_avx2 : hscale8to19_avx2;
+            if (!(c->hChrFilterSize & 3))
+                c->hcScale = c->dstBpc <= 14 ? hscale8to15_avx2 : hscale8to19_avx2;
+        }
+        if (c->dstBpc == 8) {
+            c->yuv2plane1 = yuv2plane1_8_avx2;
+            /* the MMX vertical filter layout is only read by the MMX code */
+            if (!c->use_mmx_vfilter)
+                c->yuv2planeX = yuv2planeX_8_avx2;
+        }
+    }
+#endif
 }
@@ -66,6 +66,155 @@ DECLARE_ASM_CONST(8, uint64_t, pb_07) = 0x0707070707070707ULL;
 #include "yuv2rgb_template.c"
 #endif /* HAVE_MMXEXT_INLINE */
 
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+/* interleave the even and odd pixels packed in each 128-bit lane */
+DECLARE_ALIGNED(32, static const uint8_t, shuf_even_odd)[32] = {
+    0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15,
+    0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15,
+};
+
+/*
+ * Same arithmetic as the MMX YUV2RGB core for 32 pixels at a time.
+ * Output: ymm6 - B, ymm7 - R, ymm0 - G, in pixel order within each lane.
+ */
+#define YUV2RGB_AVX2                                     \
+    "vmovdqu     (%2, %0, 2), %%ymm0            \n\t"     \
+    "vpmovzxbw       (%3, %0), %%ymm2            \n\t"     \
+    "vpmovzxbw       (%4, %0), %%ymm3            \n\t"     \
+    "vpsrlw          $8, %%ymm0, %%ymm1          \n\t"     \
+    "vpsllw          $8, %%ymm0, %%ymm0          \n\t"     \
+    "vpsllw          $3, %%ymm1, %%ymm1          \n\t"     \
+    "vpsrlw          $5, %%ymm0, %%ymm0          \n\t"     \
+    "vpsllw          $3, %%ymm2, %%ymm2          \n\t"     \
+    "vpsllw          $3, %%ymm3, %%ymm3          \n\t"     \
+    "vpbroadcastq "U_OFFSET"(%5), %%ymm4         \n\t"     \
+    "vpsubsw     %%ymm4, %%ymm2, %%ymm2          \n\t"     \
+    "vpbroadcastq "V_OFFSET"(%5), %%ymm4         \n\t"     \
+    "vpsubsw     %%ymm4, %%ymm3, %%ymm3          \n\t"     \
+    "vpbroadcastq "Y_OFFSET"(%5), %%ymm4         \n\t"     \
+    "vpsubw      %%ymm4, %%ymm0, %%ymm0          \n\t"     \
+    "vpsubw      %%ymm4, %%ymm1, %%ymm1          \n\t"     \
+    "vpbroadcastq "Y_COEFF"(%5), %%ymm4          \n\t"     \
+    "vpmulhw     %%ymm4, %%ymm0, %%ymm0          \n\t"     \
+    "vpmulhw     %%ymm4, %%ymm1, %%ymm1          \n\t"     \
+    "vpbroadcastq "UG_COEFF"(%5), %%ymm4         \n\t"     \
+    "vpmulhw     %%ymm4, %%ymm2, %%ymm5          \n\t"     \
+    "vpbroadcastq "VG_COEFF"(%5), %%ymm4         \n\t"     \
+    "vpmulhw     %%ymm4, %%ymm3, %%ymm6          \n\t"     \
+    "vpaddsw     %%ymm6, %%ymm5, %%ymm5          \n\t"     \
+    "vpbroadcastq "UB_COEFF"(%5), %%ymm4         \n\t"     \
+    "vpmulhw     %%ymm4, %%ymm2, %%ymm2          \n\t"     \
+    "vpbroadcastq "VR_COEFF"(%5), %%ymm4         \n\t"     \
+    "vpmulhw     %%ymm4, %%ymm3, %%ymm3          \n\t"     \
+    "vmovdqu            %6, %%ymm4               \n\t"     \
+    "vpaddsw     %%ymm2, %%ymm0, %%ymm6          \n\t"     \
+    "vpaddsw     %%ymm2, %%ymm1, %%ymm7          \n\t"     \
+    "vpackuswb   %%ymm7, %%ymm6, %%ymm6          \n\t"     \
+    "vpshufb     %%ymm4, %%ymm6, %%ymm6          \n\t"     \
+    "vpaddsw     %%ymm3, %%ymm0, %%ymm7          \n\t"     \
+    "vpaddsw     %%ymm3, %%ymm1, %%ymm8          \n\t"     \
+    "vpackuswb   %%ymm8, %%ymm7, %%ymm7          \n\t"     \
+    "vpshufb     %%ymm4, %%ymm7, %%ymm7          \n\t"     \
+    "vpaddsw     %%ymm5, %%ymm0, %%ymm0          \n\t"     \
+    "vpaddsw     %%ymm5, %%ymm1, %%ymm1          \n\t"     \
+    "vpackuswb   %%ymm1, %%ymm0, %%ymm0          \n\t"     \
+    "vpshufb     %%ymm4, %%ymm0, %%ymm0          \n\t"     \
+
+#define RGB_PACK32_AVX2(first, third)                    \
+    "vpcmpeqb    %%ymm8, %%ymm8, %%ymm8          \n\t"     \
+    "vpunpcklbw  %%ymm0, %%ymm"first", %%ymm1    \n\t"     \
+    "vpunpckhbw  %%ymm0, %%ymm"first", %%ymm2    \n\t"     \
+    "vpunpcklbw  %%ymm8, %%ymm"third", %%ymm3    \n\t"     \
+    "vpunpckhbw  %%ymm8, %%ymm"third", %%ymm4    \n\t"     \
+    "vpunpcklwd  %%ymm3, %%ymm1, %%ymm5          \n\t"     \
+    "vpunpckhwd  %%ymm3, %%ymm1, %%ymm6          \n\t"     \
+    "vpunpcklwd  %%ymm4, %%ymm2, %%ymm7          \n\t"     \
+    "vpunpckhwd  %%ymm4, %%ymm2, %%ymm8          \n\t"     \
+    "vperm2i128  $0x20, %%ymm6, %%ymm5, %%ymm1   \n\t"     \
+    "vperm2i128  $0x20, %%ymm8, %%ymm7, %%ymm2   \n\t"     \
+    "vperm2i128  $0x31, %%ymm6, %%ymm5, %%ymm3   \n\t"     \
+    "vperm2i128  $0x31, %%ymm8, %%ymm7, %%ymm4   \n\t"     \
+    "vmovdqu     %%ymm1,   (%1, %0, 8)           \n\t"     \
+    "vmovdqu     %%ymm2, 32(%1, %0, 8)           \n\t"     \
+    "vmovdqu     %%ymm3, 64(%1, %0, 8)           \n\t"     \
+    "vmovdqu     %%ymm4, 96(%1, %0, 8)           \n\t"     \
+
+/* C version of the MMX arithmetic for the pixels left after the SIMD loop */
+static av_always_inline void yuv2rgb32_tail(SwsContext *c, uint8_t *image,
+                                            const uint8_t *py, const uint8_t *pu,
+                                            const uint8_t *pv, int w, int bgr)
+{
+    const int yoff = (int16_t)c->yOffset,  yc  = (int16_t)c->yCoeff;
+    const int uoff = (int16_t)c->uOffset,  voff = (int16_t)c->vOffset;
+    const int ubc  = (int16_t)c->ubCoeff,  ugc = (int16_t)c->ugCoeff;
+    const int vgc  = (int16_t)c->vgCoeff,  vrc = (int16_t)c->vrCoeff;
+    int x, i;
+
+    for (x = 0; x < w; x += 2) {
+        int u  = av_clip_int16((pu[x >> 1] << 3) - uoff);
+        int v  = av_clip_int16((pv[x >> 1] << 3) - voff);
+        int ub = (u * ubc) >> 16;
+        int vr = (v * vrc) >> 16;
+        int cg = av_clip_int16(((u * ugc) >> 16) + ((v * vgc) >> 16));
+        for (i = x; i < x + 2; i++) {
+            int y = (((py[i] << 3) - yoff) * yc) >> 16;
+            int b = av_clip_uint8(y + ub);
+            int r = av_clip_uint8(y + vr);
+            image[4 * i + 0] = bgr ? r : b;
+            image[4 * i + 1] = av_clip_uint8(y + cg);
+            image[4 * i + 2] = bgr ? b : r;
+            image[4 * i + 3] = 255;
+        }
+    }
+}
+
+#define YUV2RGB32_FUNC_AVX2(name, first, third, bgr)                        \
+static int name(SwsContext *c, const uint8_t *src[], int srcStride[],       \
+                int srcSliceY, int srcSliceH,                               \
+                uint8_t *dst[], int dstStride[])                            \
+{                                                                           \
+    int y, h_size, vshift, w;                                               \
+                                                                            \
+    h_size = (c->dstW + 7) & ~7;                                            \
+    if (h_size * 4 > FFABS(dstStride[0]))                                   \
+        h_size -= 8;                                                        \
+    w = h_size & ~31;                                                       \
+                                                                            \
+    vshift = c->srcFormat != AV_PIX_FMT_YUV422P;                            \
+                                                                            \
+    for (y = 0; y < srcSliceH; y++) {                                       \
+        uint8_t *image    = dst[0] + (y + srcSliceY) * dstStride[0];        \
+        const uint8_t *py = src[0] +               y * srcStride[0];        \
+        const uint8_t *pu = src[1] +   (y >> vshift) * srcStride[1];        \
+        const uint8_t *pv = src[2] +   (y >> vshift) * srcStride[2];        \
+        x86_reg index = -w / 2;                                             \
+                                                                            \
+        if (w)                                                              \
+            __asm__ volatile (                                              \
+                "1:                                     \n\t"              \
+                YUV2RGB_AVX2                                                \
+                RGB_PACK32_AVX2(first, third)                               \
+                "add        $16, %0                     \n\t"              \
+                "jl 1b                                  \n\t"              \
+                : "+&r"(index)                                              \
+                : "r"(image + 4 * w), "r"(py + w), "r"(pu + w / 2),         \
+                  "r"(pv + w / 2), "r"(&c->redDither), "m"(*shuf_even_odd)  \
+                : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",          \
+                               "%xmm4", "%xmm5", "%xmm6", "%xmm7",          \
+                               "%xmm8",)                                    \
+                  "memory"                                                  \
+            );                                                              \
+        yuv2rgb32_tail(c, image + 4 * w, py + w, pu + w / 2, pv + w / 2,    \
+                       h_size - w, bgr);                                    \
+    }                                                                       \
+    __asm__ volatile ("vzeroupper");                                        \
+    return srcSliceH;                                                       \
+}
+
+YUV2RGB32_FUNC_AVX2(yuv420_rgb32_avx2, "6", "7", 0)
+YUV2RGB32_FUNC_AVX2(yuv420_bgr32_avx2, "7", "6", 1)
+#endif /* HAVE_AVX2_INLINE && ARCH_X86_64 */
+
 #endif /* HAVE_INLINE_ASM */
 
 av_cold SwsFunc ff_yuv2rgb_init_x86(SwsContext *c)
@@ -73,6 +222,21 @@ av_cold SwsFunc ff_yuv2rgb_init_x86(SwsContext *c)
 #if HAVE_MMX_INLINE
     int cpu_flags = av_get_cpu_flags();
 
+#if HAVE_AVX2_INLINE && ARCH_X86_64
+    if (cpu_flags & AV_CPU_FLAG_AVX2) {
+        switch (c->dstFormat) {
+        case AV_PIX_FMT_RGB32:
+            if (c->srcFormat != AV_PIX_FMT_YUVA420P)
+                return yuv420_rgb32_avx2;
+            break;
+        case AV_PIX_FMT_BGR32:
+            if (c->srcFormat != AV_PIX_FMT_YUVA420P)
+                return yuv420_bgr32_avx2;
+            break;
+        }
+    }
+#endif
+
 #if HAVE_MMXEXT_INLINE
     if (cpu_flags & AV_CPU_FLAG_MMXEXT) {
         switch (c->dstFormat) {
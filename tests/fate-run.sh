@@ -180,6 +180,11 @@ pixdesc(){
     done
 }
 
+stats_filter(){
+    stats_file=${outfile}.stats
+    ffmpeg -filter_complex "$1=stats_file=$stats_file" -f null - && cat $stats_file
+}
+
 pixfmts(){
     filter=${test#filter-pixfmts-}
     filter=${filter%_*}
@@ -51,6 +51,10 @@ FATE_LAVF-$(call ENCDEC,  XBM,                   IMAGE2)             += xbm
 FATE_LAVF-$(call ENCDEC,  XWD,                   IMAGE2)             += xwd
 FATE_LAVF-$(CONFIG_YUV4MPEGPIPE_MUXER)                               += yuv4mpeg
 
+ifdef HAVE_MMAP
+FATE_LAVF-$(call ENCDEC2, MPEG2VIDEO, MP2,       MPEGTS)             += ts_mmap
+endif
+
 FATE_LAVF += $(FATE_LAVF-yes:%=fate-lavf-%)
 FATE_LAVF_PIXFMT-$(CONFIG_SCALE_FILTER) += fate-lavf-pixfmt
 FATE_LAVF += $(FATE_LAVF_PIXFMT-yes)
@@ -72,6 +72,12 @@ fate-filter-overlay_yuv420: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex
 FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER OVERLAY_FILTER) += fate-filter-overlay_yuv444
 fate-filter-overlay_yuv444: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(SRC_PATH)/tests/filtergraphs/overlay_yuv444
 
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER FORMAT_FILTER LUTYUV_FILTER ALPHAMERGE_FILTER OVERLAY_FILTER) += fate-filter-overlay_alpha_yuv420
+fate-filter-overlay_alpha_yuv420: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(SRC_PATH)/tests/filtergraphs/overlay_alpha_yuv420
+
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER FORMAT_FILTER LUTYUV_FILTER ALPHAMERGE_FILTER OVERLAY_FILTER) += fate-filter-overlay_alpha_rgba
+fate-filter-overlay_alpha_rgba: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(SRC_PATH)/tests/filtergraphs/overlay_alpha_rgba
+
 FATE_FILTER_VSYNTH-$(CONFIG_PHASE_FILTER) += fate-filter-phase
 fate-filter-phase: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf phase
 
@@ -144,6 +150,12 @@ fate-filter-scale200: CMD = video_filter "scale=w=200:h=200"
 FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale500
 fate-filter-scale500: CMD = video_filter "scale=w=500:h=500"
 
+FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale500-threads
+fate-filter-scale500-threads: CMD = video_filter "scale=w=500:h=500:threads=4"
+
+FATE_FILTER_VSYNTH-$(CONFIG_MULTISCALE_FILTER) += fate-filter-multiscale
+fate-filter-multiscale: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(SRC_PATH)/tests/filtergraphs/multiscale
+
 FATE_FILTER_VSYNTH-$(CONFIG_VFLIP_FILTER) += fate-filter-vflip
 fate-filter-vflip: CMD = video_filter "vflip"
 
@@ -322,6 +334,29 @@ fate-filter-metadata-ebur128: CMD = run $(FILTER_METADATA_COMMAND) "amovie='$(SR
 
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
 
-fate-vfilter: $(FATE_FILTER-yes) $(FATE_FILTER_VSYNTH-yes)
+# compare testsrc against a noisy copy, odd sizes exercise the row tails
+FILTER_STATS_GRAPH = sws_flags=+accurate_rnd+bitexact;testsrc=s=351x287:d=0.4,format=yuv420p,split[a][b];[b]noise=alls=12:allf=t[n];[a][n]
+FILTER_STATS_DEPS = TESTSRC_FILTER FORMAT_FILTER SCALE_FILTER SPLIT_FILTER NOISE_FILTER \
+                    NULL_MUXER RAWVIDEO_ENCODER
+
+FATE_FILTER_STATS-$(call ALLYES, PSNR_FILTER $(FILTER_STATS_DEPS)) += fate-filter-psnr
+fate-filter-psnr: CMD = stats_filter "$(FILTER_STATS_GRAPH)psnr"
+
+FATE_FILTER_STATS-$(call ALLYES, SSIM_FILTER $(FILTER_STATS_DEPS)) += fate-filter-ssim
+fate-filter-ssim: CMD = stats_filter "$(FILTER_STATS_GRAPH)ssim"
+
+FATE_FFMPEG += $(FATE_FILTER_STATS-yes)
+
+BRANCH_THREADS_DEPS = TESTSRC_FILTER SPLIT_FILTER HFLIP_FILTER VFLIP_FILTER \
+                      NEGATE_FILTER TRANSPOSE_FILTER
+ifdef HAVE_THREADS
+FATE_FILTER_BRANCH-$(call ALLYES, $(BRANCH_THREADS_DEPS)) += fate-filter-branch-threads
+fate-filter-branch-threads: libavfilter/pthread-test$(EXESUF)
+fate-filter-branch-threads: CMD = run libavfilter/pthread-test
+endif
+
+FATE-yes += $(FATE_FILTER_BRANCH-yes)
+
+fate-vfilter: $(FATE_FILTER-yes) $(FATE_FILTER_STATS-yes) $(FATE_FILTER_BRANCH-yes) $(FATE_FILTER_VSYNTH-yes)
 
 fate-filter: fate-afilter fate-vfilter $(FATE_METADATA_FILTER-yes)
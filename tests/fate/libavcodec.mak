@@ -9,6 +9,12 @@ fate-idct8x8: CMD = run libavcodec/dct-test -i
 fate-idct8x8: CMP = null
 fate-idct8x8: REF = /dev/null
 
+FATE_LIBAVCODEC-$(CONFIG_HEVC_DECODER) += fate-hevcdsp
+fate-hevcdsp: libavcodec/hevcdsp-test$(EXESUF)
+fate-hevcdsp: CMD = run libavcodec/hevcdsp-test
+fate-hevcdsp: CMP = null
+fate-hevcdsp: REF = /dev/null
+
 FATE_LIBAVCODEC-yes += fate-iirfilter
 fate-iirfilter: libavcodec/iirfilter-test$(EXESUF)
 fate-iirfilter: CMD = run libavcodec/iirfilter-test
@@ -1,7 +1,17 @@
+FATE_LIBAVFORMAT-$(CONFIG_ASYNC_PROTOCOL) += fate-async
+fate-async: libavformat/async-test$(EXESUF)
+fate-async: CMD = run libavformat/async-test
+
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/noproxy-test$(EXESUF)
 fate-noproxy: CMD = run libavformat/noproxy-test
 
+ifdef HAVE_PTHREAD_CANCEL
+FATE_LIBAVFORMAT-$(CONFIG_UDP_PROTOCOL) += fate-udp
+fate-udp: libavformat/udp-test$(EXESUF)
+fate-udp: CMD = run libavformat/udp-test
+endif
+
 FATE_LIBAVFORMAT-yes += fate-srtp
 fate-srtp: libavformat/srtp-test$(EXESUF)
 fate-srtp: CMD = run libavformat/srtp-test
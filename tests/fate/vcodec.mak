@@ -218,6 +218,24 @@ fate-vsynth%-qtrlegray:          CODEC   = qtrle
 fate-vsynth%-qtrlegray:          ENCOPTS = -pix_fmt gray
 fate-vsynth%-qtrlegray:          FMT     = mov
 
+FATE_QSV = qsv-h264 qsv-mpeg2
+
+FATE_VCODEC-$(call ALLYES, QSV_SW H264_QSV_ENCODER H264_QSV_DECODER H264_MUXER H264_DEMUXER) += qsv-h264
+fate-vsynth%-qsv-h264:           CODEC   = h264_qsv
+fate-vsynth%-qsv-h264:           FMT     = h264
+
+FATE_VCODEC-$(call ALLYES, QSV_SW H264_QSV_ENCODER H264_QSV_DECODER H264_MUXER H264_DEMUXER) += qsv-h264-nonblock
+fate-vsynth%-qsv-h264-nonblock:  CODEC   = h264_qsv
+fate-vsynth%-qsv-h264-nonblock:  ENCOPTS = -nonblock 1
+fate-vsynth%-qsv-h264-nonblock:  FMT     = h264
+fate-vsynth%-qsv-h264-nonblock:  DECINOPTS = -c:v $(CODEC) -nonblock 1
+
+FATE_VCODEC-$(call ALLYES, QSV_SW MPEG2_QSV_ENCODER MPEG2_QSV_DECODER MPEG2VIDEO_MUXER MPEGVIDEO_DEMUXER) += qsv-mpeg2
+fate-vsynth%-qsv-mpeg2:          CODEC   = mpeg2_qsv
+fate-vsynth%-qsv-mpeg2:          FMT     = mpeg2video
+
+$(FATE_QSV:%=fate-vsynth\%-%): DECINOPTS = -c:v $(CODEC)
+
 FATE_VCODEC-$(call ENCDEC, RAWVIDEO, AVI) += rgb
 fate-vsynth%-rgb:                CODEC   = rawvideo
 fate-vsynth%-rgb:                ENCOPTS = -pix_fmt bgr24
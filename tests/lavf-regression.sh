@@ -94,6 +94,12 @@ if [ -n "$do_ts" ] ; then
 do_lavf ts "" "-ab 64k -mpegts_transport_stream_id 42"
 fi
 
+if [ -n "$do_ts_mmap" ] ; then
+file=${outfile}lavf.mmap.ts
+do_avconv $file $DEC_OPTS -f image2 -vcodec pgmyuv -i $raw_src $DEC_OPTS -ar 44100 -f s16le -i $pcm_src $ENC_OPTS -b:a 64k -t 1 -qscale:v 10 -ab 64k -mpegts_transport_stream_id 42
+do_avconv_crc $file $DEC_OPTS -mmap 1 -i $target_path/$file
+fi
+
 if [ -n "$do_swf" ] ; then
 do_lavf swf "" "-an"
 fi
@@ -0,0 +1,381 @@
+/*
+ * QSV wrapper benchmark against the software MFX stand-in
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Measure the per-frame cost of the QSV wrappers. The device is emulated
+ * by the software stand-in (configure --enable-qsv-sw), whose counters
+ * tell how much of the time spent in libavcodec was device work or
+ * waiting for it; the remainder is wrapper overhead. Device latency and
+ * busy behaviour are set through MFXSW_LATENCY, MFXSW_BUSY_INTERVAL and
+ * MFXSW_SURFACE_HOLD, see compat/mfx/mfxsw.h.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/dict.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/time.h"
+#include "compat/mfx/mfxsw.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h> /* for getopt */
+#endif
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+typedef struct BenchResult {
+    int frames;
+    int64_t wall;
+    MFXSWStats stats;
+    int64_t time_blocked;
+    int64_t time_busy;
+} BenchResult;
+
+static const char *async_depth;
+static int nonblock;
+static int session_group;
+
+static void usage(void)
+{
+    printf("QSV wrapper benchmark\n");
+    printf("usage: qsvbench [options] [input_file]\n");
+    printf("Decodes input_file with the native and the QSV decoder if given,\n"
+           "then encodes synthetic frames with the QSV encoders.\n");
+    printf("options:\n");
+    printf("  -n frames      number of frames to encode (default 100)\n");
+    printf("  -s WxH         size of the encoded frames (default 1280x720)\n");
+    printf("  -a depth       async_depth passed to the QSV codecs\n");
+    printf("  -b             use the nonblocking mode of the QSV codecs\n");
+    printf("  -g             join the sessions of all QSV codecs\n");
+    printf("  -h             print this help\n");
+}
+
+static void print_result(const char *name, const BenchResult *r, int qsv)
+{
+    int n = FFMAX(r->frames, 1);
+
+    printf("%-16s %6d frames %10.1f us/frame", name, r->frames,
+           (double)r->wall / n);
+    if (qsv) {
+        int64_t overhead = r->wall - r->stats.device_time - r->stats.sync_wait;
+        printf(" device %8.1f wait %8.1f overhead %8.1f us/frame busy %"PRId64,
+               (double)r->stats.device_time / n, (double)r->stats.sync_wait / n,
+               (double)overhead / n, r->stats.busy);
+        printf(" blocked %8.1f busy-waiting %8.1f us/frame",
+               (double)r->time_blocked / n, (double)r->time_busy / n);
+    }
+    printf("\n");
+}
+
+static AVCodecContext *open_codec(AVCodec *codec, const AVCodecContext *par)
+{
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    AVDictionary *opts = NULL;
+
+    if (!avctx)
+        return NULL;
+
+    if (par && avcodec_copy_context(avctx, par) < 0)
+        goto fail;
+
+    // only the QSV codecs know about these, others ignore them
+    if (async_depth)
+        av_dict_set(&opts, "async_depth", async_depth, 0);
+    if (nonblock)
+        av_dict_set(&opts, "nonblock", "1", 0);
+    if (session_group)
+        av_dict_set(&opts, "session_group", "1", 0);
+
+    if (avcodec_open2(avctx, codec, &opts) < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Could not open %s\n", codec->name);
+        goto fail;
+    }
+
+    av_dict_free(&opts);
+    return avctx;
+fail:
+    av_dict_free(&opts);
+    avcodec_close(avctx);
+    av_free(avctx);
+    return NULL;
+}
+
+static void close_codec(AVCodecContext *avctx, BenchResult *r)
+{
+    if (r) {
+        av_opt_get_int(avctx, "time_blocked", AV_OPT_SEARCH_CHILDREN,
+                       &r->time_blocked);
+        av_opt_get_int(avctx, "time_busy", AV_OPT_SEARCH_CHILDREN,
+                       &r->time_busy);
+    }
+    avcodec_close(avctx);
+    av_free(avctx);
+}
+
+static int bench_decode(const char *filename, AVCodec *codec, BenchResult *r)
+{
+    AVFormatContext *fmt = NULL;
+    AVCodecContext *avctx = NULL;
+    AVFrame *frame = NULL;
+    AVPacket pkt;
+    int st_index, got_frame, ret;
+    int64_t t;
+
+    memset(r, 0, sizeof(*r));
+
+    if ((ret = avformat_open_input(&fmt, filename, NULL, NULL)) < 0 ||
+        (ret = avformat_find_stream_info(fmt, NULL)) < 0)
+        goto end;
+    if ((ret = st_index = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO,
+                                              -1, -1, NULL, 0)) < 0)
+        goto end;
+    if (!(avctx = open_codec(codec, fmt->streams[st_index]->codec)) ||
+        !(frame = avcodec_alloc_frame())) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    MFXSW_ResetStats();
+
+    while (av_read_frame(fmt, &pkt) >= 0) {
+        if (pkt.stream_index == st_index) {
+            AVPacket tmp = pkt;
+            while (tmp.size > 0) {
+                t   = av_gettime();
+                ret = avcodec_decode_video2(avctx, frame, &got_frame, &tmp);
+                r->wall += av_gettime() - t;
+                if (ret < 0)
+                    break;
+                r->frames += got_frame;
+                tmp.data  += ret;
+                tmp.size  -= ret;
+            }
+        }
+        av_free_packet(&pkt);
+    }
+
+    av_init_packet(&pkt);
+    pkt.data = NULL;
+    pkt.size = 0;
+    do {
+        t   = av_gettime();
+        ret = avcodec_decode_video2(avctx, frame, &got_frame, &pkt);
+        r->wall += av_gettime() - t;
+        r->frames += got_frame;
+    } while (ret >= 0 && got_frame);
+
+    MFXSW_GetStats(&r->stats);
+    ret = 0;
+
+end:
+    avcodec_free_frame(&frame);
+    if (avctx)
+        close_codec(avctx, r);
+    avformat_close_input(&fmt);
+    return ret;
+}
+
+static void fill_frame(AVFrame *frame, int n)
+{
+    int x, y;
+
+    for (y = 0; y < frame->height; y++)
+        for (x = 0; x < frame->width; x++)
+            frame->data[0][y * frame->linesize[0] + x] = x + y + n * 3;
+    for (y = 0; y < frame->height / 2; y++)
+        for (x = 0; x < frame->width / 2; x++) {
+            frame->data[1][y * frame->linesize[1] + 2 * x    ] = 128 + y + n * 2;
+            frame->data[1][y * frame->linesize[1] + 2 * x + 1] = 64 + x + n * 5;
+        }
+}
+
+static int bench_encode(AVCodec *codec, int width, int height, int nb_frames,
+                        BenchResult *r)
+{
+    AVCodecContext *par = avcodec_alloc_context3(NULL);
+    AVCodecContext *avctx = NULL;
+    AVFrame *frame = avcodec_alloc_frame();
+    AVPacket pkt;
+    int i, got_packet, ret = AVERROR(ENOMEM);
+    int64_t t;
+
+    memset(r, 0, sizeof(*r));
+
+    if (!par || !frame)
+        goto end;
+
+    par->width     = width;
+    par->height    = height;
+    par->pix_fmt   = AV_PIX_FMT_NV12;
+    par->time_base = (AVRational){ 1, 25 };
+    par->gop_size  = 12;
+
+    if (!(avctx = open_codec(codec, par)))
+        goto end;
+
+    frame->width  = width;
+    frame->height = height;
+    frame->format = AV_PIX_FMT_NV12;
+    if ((ret = av_image_alloc(frame->data, frame->linesize, width, height,
+                              AV_PIX_FMT_NV12, 32)) < 0)
+        goto end;
+
+    MFXSW_ResetStats();
+
+    for (i = 0; i <= nb_frames; i++) {
+        AVFrame *in = NULL;
+
+        if (i < nb_frames) {
+            fill_frame(frame, i);
+            frame->pts = i;
+            in = frame;
+        }
+
+        do {
+            av_init_packet(&pkt);
+            pkt.data = NULL;
+            pkt.size = 0;
+
+            t   = av_gettime();
+            ret = avcodec_encode_video2(avctx, &pkt, in, &got_packet);
+            r->wall += av_gettime() - t;
+            if (ret < 0)
+                goto end;
+            if (got_packet) {
+                r->frames++;
+                av_free_packet(&pkt);
+            }
+        } while (!in && got_packet);
+    }
+
+    MFXSW_GetStats(&r->stats);
+    ret = 0;
+
+end:
+    if (frame)
+        av_freep(&frame->data[0]);
+    avcodec_free_frame(&frame);
+    if (avctx)
+        close_codec(avctx, r);
+    av_free(par);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    static const char * const encoders[] = { "h264_qsv", "mpeg2_qsv" };
+    int width = 1280, height = 720, nb_frames = 100;
+    BenchResult r;
+    int i, opt;
+
+    while ((opt = getopt(argc, argv, "hn:s:a:bg")) != -1) {
+        switch (opt) {
+        case 'n':
+            nb_frames = atoi(optarg);
+            break;
+        case 's':
+            if (av_parse_video_size(&width, &height, optarg) < 0) {
+                fprintf(stderr, "Invalid size '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'a':
+            async_depth = optarg;
+            break;
+        case 'b':
+            nonblock = 1;
+            break;
+        case 'g':
+            session_group = 1;
+            break;
+        case 'h':
+            usage();
+            return 0;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    av_register_all();
+    av_log_set_level(AV_LOG_WARNING);
+
+    if (optind < argc) {
+        const char *filename = argv[optind];
+        AVFormatContext *fmt = NULL;
+        enum AVCodecID codec_id;
+        AVCodec *native, *qsv;
+        char name[32];
+        int st;
+
+        if (avformat_open_input(&fmt, filename, NULL, NULL) < 0 ||
+            avformat_find_stream_info(fmt, NULL) < 0 ||
+            (st = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1,
+                                      NULL, 0)) < 0) {
+            fprintf(stderr, "Could not find a video stream in '%s'\n", filename);
+            avformat_close_input(&fmt);
+            return 1;
+        }
+        codec_id = fmt->streams[st]->codec->codec_id;
+        avformat_close_input(&fmt);
+
+        native = avcodec_find_decoder(codec_id);
+        snprintf(name, sizeof(name), "%s_qsv",
+                 codec_id == AV_CODEC_ID_MPEG2VIDEO ? "mpeg2" :
+                 avcodec_get_name(codec_id));
+        qsv = avcodec_find_decoder_by_name(name);
+
+        if (!native || !qsv) {
+            fprintf(stderr, "No native and QSV decoder for %s\n",
+                    avcodec_get_name(codec_id));
+            return 1;
+        }
+
+        if (bench_decode(filename, native, &r) < 0)
+            return 1;
+        print_result(native->name, &r, 0);
+        if (bench_decode(filename, qsv, &r) < 0)
+            return 1;
+        print_result(qsv->name, &r, 1);
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(encoders); i++) {
+        AVCodec *codec = avcodec_find_encoder_by_name(encoders[i]);
+
+        if (!codec)
+            continue;
+        if (bench_encode(codec, width, height, nb_frames, &r) < 0) {
+            fprintf(stderr, "Encoding with %s failed\n", encoders[i]);
+            return 1;
+        }
+        print_result(codec->name, &r, 1);
+    }
+
+    return 0;
+}